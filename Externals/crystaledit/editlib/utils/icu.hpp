@@ -73,7 +73,7 @@ class ICUBreakIterator
 {
 public:
 	ICUBreakIterator(UBreakIteratorType type, const char* locale, const UChar* text, int32_t textLength)
-		: m_iter(nullptr), m_type(type), m_text(text), m_i(0), m_textLength(textLength)
+		: m_iter(nullptr), m_type(type), m_text(text), m_text8(nullptr), m_i(0), m_textLength(textLength)
 	{
 		if (ICULoader::IsLoaded())
 		{
@@ -107,6 +107,12 @@ public:
 		}
 	}
 
+	/** @brief Iterator over UTF-8 text, without ICU, for builds where tchar_t is char. */
+	ICUBreakIterator(UBreakIteratorType type, const char* text, int32_t textLength)
+		: m_iter(nullptr), m_type(type), m_text(nullptr), m_text8(text), m_i(0), m_textLength(textLength)
+	{
+	}
+
 	~ICUBreakIterator()
 	{
 		if (m_iter)
@@ -116,6 +122,7 @@ public:
 	UErrorCode setText(const UChar* text, int32_t textLength)
 	{
 		m_text = text;
+		m_text8 = nullptr;
 		m_textLength = textLength;
 		m_i = 0;
 		UErrorCode status = U_ZERO_ERROR;
@@ -124,6 +131,14 @@ public:
 		return status;
 	}
 
+	void setText(const char* text, int32_t textLength)
+	{
+		m_text = nullptr;
+		m_text8 = text;
+		m_textLength = textLength;
+		m_i = 0;
+	}
+
 	int first()
 	{
 		if (m_iter)
@@ -189,6 +204,21 @@ public:
 		return m_pCharacterBreakIterator<N>.get();
 	}
 
+	static ICUBreakIterator *getCharacterBreakIterator(const char * text, int32_t textLength)
+	{
+		return getCharacterBreakIterator<1>(text, textLength);
+	}
+
+	template<int N>
+	static ICUBreakIterator *getCharacterBreakIterator(const char * text, int32_t textLength)
+	{
+		if (!m_pCharacterBreakIterator<N>)
+			m_pCharacterBreakIterator<N>.reset(new ICUBreakIterator(UBRK_CHARACTER, text, textLength));
+		else
+			m_pCharacterBreakIterator<N>->setText(text, textLength);
+		return m_pCharacterBreakIterator<N>.get();
+	}
+
 	static ICUBreakIterator *getWordBreakIterator(const UChar * text, int32_t textLength)
 	{
 		if (!m_pWordBreakIterator)
@@ -198,14 +228,39 @@ public:
 		return m_pWordBreakIterator.get();
 	}
 
-#define GLEN(i) ((m_text[(i)] != '\r') ? \
-	(U16_IS_SURROGATE(m_text[(i)]) ? 2 : 1) : \
-	(((i) < m_textLength - 1 && m_text[(i) + 1] == '\n') ? 2 : 1))
-#define GLENP(i) ((m_text[(i)] != '\n') ? \
-	(U16_IS_SURROGATE(m_text[(i)]) ? 2 : 1) : \
-	(((i) > 0 && m_text[(i) - 1] == '\r') ? 2 : 1))
-
 private:
+	/** @brief Code unit @p i of the UTF-16 or UTF-8 text. */
+	unsigned CU(int i) const
+	{
+		return m_text8 ? static_cast<unsigned char>(m_text8[i]) : m_text[i];
+	}
+
+	/** @brief Length of the character starting at @p i, CR+LF is one character. */
+	int GLEN(int i) const
+	{
+		if (CU(i) == '\r')
+			return (i < m_textLength - 1 && CU(i + 1) == '\n') ? 2 : 1;
+		if (!m_text8)
+			return U16_IS_SURROGATE(m_text[i]) ? 2 : 1;
+		int len = 1;
+		while (i + len < m_textLength && (CU(i + len) & 0xC0) == 0x80)
+			++len;
+		return len;
+	}
+
+	/** @brief Length of the character ending at @p i, CR+LF is one character. */
+	int GLENP(int i) const
+	{
+		if (CU(i) == '\n')
+			return (i > 0 && CU(i - 1) == '\r') ? 2 : 1;
+		if (!m_text8)
+			return U16_IS_SURROGATE(m_text[i]) ? 2 : 1;
+		int len = 1;
+		while (i - len >= 0 && (CU(i - len + 1) & 0xC0) == 0x80)
+			++len;
+		return len;
+	}
+
 	int mynext()
 	{
 		if (m_type == UBRK_CHARACTER)
@@ -242,21 +297,21 @@ private:
 		{
 			int nPos = offset;
 			int nPrevPos;
-			while (nPos > 0 && xisspace(m_text[nPrevPos = nPos - GLENP(nPos - 1)]))
+			while (nPos > 0 && xisspace(CU(nPrevPos = nPos - GLENP(nPos - 1))))
 				nPos = nPrevPos;
 			if (nPos > 0)
 			{
 				nPrevPos = nPos - GLENP(nPos - 1);
 				nPos = nPrevPos;
-				if (xisalnum(m_text[nPos]))
+				if (xisalnum(CU(nPos)))
 				{
-					while (nPos > 0 && xisalnum(m_text[nPrevPos = nPos - GLENP(nPos - 1)]))
+					while (nPos > 0 && xisalnum(CU(nPrevPos = nPos - GLENP(nPos - 1))))
 						nPos = nPrevPos;
 				}
 				else
 				{
-					while (nPos > 0 && !xisalnum(m_text[nPrevPos = nPos - GLENP(nPos - 1)])
-						&& !xisspace(m_text[nPrevPos]))
+					while (nPos > 0 && !xisalnum(CU(nPrevPos = nPos - GLENP(nPos - 1)))
+						&& !xisspace(CU(nPrevPos)))
 						nPos = nPrevPos;
 				}
 			}
@@ -274,15 +329,15 @@ private:
 		else if (m_type == UBRK_WORD)
 		{
 			int nPos = offset;
-			if (xisalnum(m_text[nPos]))
+			if (xisalnum(CU(nPos)))
 			{
-				while (nPos < m_textLength && xisalnum(m_text[nPos]))
+				while (nPos < m_textLength && xisalnum(CU(nPos)))
 					nPos += GLEN(nPos);
 			}
 			else
 			{
-				while (nPos < m_textLength && !xisalnum(m_text[nPos])
-					&& !iswspace(m_text[nPos]))
+				while (nPos < m_textLength && !xisalnum(CU(nPos))
+					&& !iswspace(CU(nPos)))
 					nPos += GLEN(nPos);
 			}
 			m_i = nPos;
@@ -292,6 +347,7 @@ private:
 	UBreakIterator* m_iter;
 	UBreakIteratorType m_type;
 	const UChar *m_text;
+	const char *m_text8; /**< UTF-8 text, m_text is nullptr then */
 	int m_i;
 	int m_textLength;
 	static const UChar *kCustomRules;
@@ -64,6 +64,9 @@ bool IsMBSTrail (const tchar_t* pszChars, int nCol)
   if (*current >= 0xDC00 && *current <= 0xDFFF) // surrogate pair 
     return true;
   return false;
+#elif !defined(_WIN32)
+  // Strings are UTF-8
+  return (static_cast<unsigned char>(pszChars[nCol]) & 0xC0) == 0x80;
 #else // _UNICODE
   const unsigned char *string = (const unsigned char *) pszChars;
   const unsigned char *current = string + nCol;
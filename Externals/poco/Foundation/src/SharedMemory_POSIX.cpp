@@ -64,7 +64,7 @@ SharedMemoryImpl::SharedMemoryImpl(const std::string& name, std::size_t size, Sh
 
 
 SharedMemoryImpl::SharedMemoryImpl(const Poco::File& file, SharedMemory::AccessMode mode, const void* addrHint):
-	_size(size),
+	_size(0),
 	_fd(-1),
 	_address(0),
 	_access(mode),
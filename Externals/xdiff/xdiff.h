@@ -86,6 +86,14 @@ typedef struct s_xpparam {
 	/* See Documentation/diff-options.txt. */
 	char **anchors;
 	size_t anchors_nr;
+
+	/*
+	 * Equivalence classes of the lines of the two files computed by the
+	 * caller, or NULL. Lines are split at '\n' only and two lines are in
+	 * the same class if and only if they match under flags.
+	 */
+	int const *classes1, *classes2;
+	long nclasses1, nclasses2;
 } xpparam_t;
 
 typedef struct s_xdemitcb {
@@ -48,12 +48,13 @@ typedef struct s_xdlclassifier {
 	long alloc;
 	long count;
 	long flags;
+	int preclassified;
 } xdlclassifier_t;
 
 
 
 
-static int xdl_init_classifier(xdlclassifier_t *cf, long size, long flags);
+static int xdl_init_classifier(xdlclassifier_t *cf, long size, xpparam_t const *xpp);
 static void xdl_free_classifier(xdlclassifier_t *cf);
 static int xdl_classify_record(unsigned int pass, xdlclassifier_t *cf, xrecord_t **rhash,
 			       unsigned int hbits, xrecord_t *rec);
@@ -68,8 +69,9 @@ static int xdl_optimize_ctxs(xdlclassifier_t *cf, xdfile_t *xdf1, xdfile_t *xdf2
 
 
 
-static int xdl_init_classifier(xdlclassifier_t *cf, long size, long flags) {
-	cf->flags = flags;
+static int xdl_init_classifier(xdlclassifier_t *cf, long size, xpparam_t const *xpp) {
+	cf->flags = xpp->flags;
+	cf->preclassified = xpp->classes1 && xpp->classes2;
 
 	cf->hbits = xdl_hashbits((unsigned int) size);
 	cf->hsize = 1 << cf->hbits;
@@ -118,8 +120,9 @@ static int xdl_classify_record(unsigned int pass, xdlclassifier_t *cf, xrecord_t
 	hi = (long) XDL_HASHLONG(rec->ha, cf->hbits);
 	for (rcrec = cf->rchash[hi]; rcrec; rcrec = rcrec->next)
 		if (rcrec->ha == rec->ha &&
-				xdl_recmatch(rcrec->line, rcrec->size,
-					rec->ptr, rec->size, cf->flags))
+				(cf->preclassified ||
+				 xdl_recmatch(rcrec->line, rcrec->size,
+					rec->ptr, rec->size, cf->flags)))
 			break;
 
 	if (!rcrec) {
@@ -169,6 +172,8 @@ static int xdl_prepare_ctx(unsigned int pass, mmfile_t *mf, long narec, xpparam_
 	unsigned long *ha;
 	char *rchg;
 	long *rindex;
+	int const *classes;
+	long nclasses;
 
 	ha = NULL;
 	rindex = NULL;
@@ -191,11 +196,24 @@ static int xdl_prepare_ctx(unsigned int pass, mmfile_t *mf, long narec, xpparam_
 		memset(rhash, 0, hsize * sizeof(xrecord_t *));
 	}
 
+	classes = (pass == 1) ? xpp->classes1 : xpp->classes2;
+	nclasses = (pass == 1) ? xpp->nclasses1 : xpp->nclasses2;
+	if (!xpp->classes1 || !xpp->classes2)
+		classes = NULL;
+
 	nrec = 0;
 	if ((cur = blk = xdl_mmfile_first(mf, &bsize)) != NULL) {
 		for (top = blk + bsize; cur < top; ) {
 			prev = cur;
-			hav = xdl_hash_record(&cur, top, xpp->flags);
+			if (classes) {
+				/* The class replaces the hash, only split the line */
+				if (nrec >= nclasses)
+					goto abort;
+				cur = memchr(cur, '\n', top - cur);
+				cur = cur ? cur + 1 : top;
+				hav = (unsigned long) classes[nrec];
+			} else
+				hav = xdl_hash_record(&cur, top, xpp->flags);
 			if (nrec >= narec) {
 				narec *= 2;
 				if (!(rrecs = (xrecord_t **) xdl_realloc(recs, narec * sizeof(xrecord_t *))))
@@ -215,6 +233,9 @@ static int xdl_prepare_ctx(unsigned int pass, mmfile_t *mf, long narec, xpparam_
 		}
 	}
 
+	if (classes && nrec != nclasses)
+		goto abort;
+
 	if (!(rchg = (char *) xdl_malloc((nrec + 2) * sizeof(char))))
 		goto abort;
 	memset(rchg, 0, (nrec + 2) * sizeof(char));
@@ -280,7 +301,7 @@ int xdl_prepare_env(mmfile_t *mf1, mmfile_t *mf2, xpparam_t const *xpp,
 	enl2 = xdl_guess_lines(mf2, sample) + 1;
 
 	if (XDF_DIFF_ALG(xpp->flags) != XDF_HISTOGRAM_DIFF &&
-	    xdl_init_classifier(&cf, enl1 + enl2 + 1, xpp->flags) < 0)
+	    xdl_init_classifier(&cf, enl1 + enl2 + 1, xpp) < 0)
 		return -1;
 
 	if (xdl_prepare_ctx(1, mf1, enl1, xpp, &cf, &xe->xdf1) < 0) {
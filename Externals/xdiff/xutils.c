@@ -536,14 +536,22 @@ int xdl_fall_back_diff(xdfenv_t *diff_env, xpparam_t const *xpp,
 	 */
 	mmfile_t subfile1, subfile2;
 	xdfenv_t env;
-
+	xpparam_t subxpp = *xpp;
+
+	/* The classes of the lines in the ranges, if xpp has them for the whole files */
+	if (subxpp.classes1 && subxpp.classes2) {
+		subxpp.classes1 += line1 - 1;
+		subxpp.nclasses1 = count1;
+		subxpp.classes2 += line2 - 1;
+		subxpp.nclasses2 = count2;
+	}
 	subfile1.ptr = (char *)diff_env->xdf1.recs[line1 - 1]->ptr;
 	subfile1.size = diff_env->xdf1.recs[line1 + count1 - 2]->ptr +
 		diff_env->xdf1.recs[line1 + count1 - 2]->size - subfile1.ptr;
 	subfile2.ptr = (char *)diff_env->xdf2.recs[line2 - 1]->ptr;
 	subfile2.size = diff_env->xdf2.recs[line2 + count2 - 2]->ptr +
 		diff_env->xdf2.recs[line2 + count2 - 2]->size - subfile2.ptr;
-	if (xdl_do_diff(&subfile1, &subfile2, xpp, &env) < 0)
+	if (xdl_do_diff(&subfile1, &subfile2, &subxpp, &env) < 0)
 		return -1;
 
 	memcpy(diff_env->xdf1.rchg + line1 - 1, env.xdf1.rchg, count1);
@@ -6,6 +6,7 @@
 
 #include "pch.h"
 #include "ExConverter.h"
+#ifdef _WIN32
 #include <windows.h>
 #include <mlang.h>
 #include <memory>
@@ -330,3 +331,15 @@ IExconverter *Exconverter::getInstance()
 	return m_pexconv;
 }
 
+#else
+
+/**
+ * @brief MLang is not available outside Windows, callers fall back to
+ * their own conversions when there is no converter.
+ */
+IExconverter *Exconverter::getInstance()
+{
+	return nullptr;
+}
+
+#endif
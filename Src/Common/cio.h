@@ -24,6 +24,7 @@ namespace cio
 	ssize_t read(int fd, void* buf, size_t size);
 	ssize_t write(int fd, const void* buf, size_t size);
 	constexpr auto close = ::_close;
+	constexpr auto lseek = ::_lseeki64;
 	constexpr auto fstat = ::myfstat;
 	constexpr auto pipe = ::_pipe;
 #else
@@ -31,12 +32,14 @@ namespace cio
 #define _SH_DENYNO (0)
 #define _S_IREAD  (S_IRUSR | S_IRGRP | S_IROTH)
 #define _S_IWRITE (S_IWUSR | S_IWGRP | S_IWOTH)
+	typedef ::ssize_t ssize_t;
 	typedef struct stat stat;
 	inline int read_i(int fd, void* buf, unsigned size) { return (int)::read(fd, buf, size); }
 	inline int write_i(int fd, const void* buf, unsigned size) { return (int)::write(fd, buf, size); }
 	constexpr auto read = ::read;
 	constexpr auto write = ::write;
 	constexpr auto close = ::close;
+	constexpr auto lseek = ::lseek;
 	constexpr auto fstat = ::fstat;
 	constexpr auto pipe = ::pipe;
 #endif
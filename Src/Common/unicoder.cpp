@@ -16,8 +16,14 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 
 #include "pch.h"
 #include "unicoder.h"
+#ifdef _WIN32
 #include <windows.h>
 #include <winnls.h>
+#else
+#include <iconv.h>
+#include <cerrno>
+#include <cwctype>
+#endif
 #include <cassert>
 #include <memory>
 #include <Poco/UnicodeConverter.h>
@@ -26,7 +32,7 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 
 using Poco::UnicodeConverter;
 
-#if (WINVER < 0x0600)
+#if defined(_WIN32) && (WINVER < 0x0600)
 typedef enum _NORM_FORM { NormalizationOther = 0, NormalizationC = 0x1, NormalizationD = 0x2, NormalizationKC = 0x5, NormalizationKD = 0x6 } NORM_FORM;
 extern "C" __declspec(dllimport) int WINAPI NormalizeString(NORM_FORM NormForm, LPCWSTR lpSrcString, int cwSrcLength, LPWSTR lpDstString, int cwDstLength);
 #endif
@@ -34,6 +40,117 @@ extern "C" __declspec(dllimport) int WINAPI NormalizeString(NORM_FORM NormForm,
 namespace ucr
 {
 
+#ifndef _WIN32
+// Codepages of the Windows API, the ANSI codepage is UTF-8 outside Windows
+constexpr int CP_ACP = 0;
+constexpr int CP_OEMCP = 1;
+constexpr int CP_THREAD_ACP = 3;
+constexpr int CP_UTF8 = CP_UTF_8;
+
+static int GetACP()
+{
+	return CP_UTF8;
+}
+
+static int NormalizeCodepage(int cp);
+
+/**
+ * @brief Name of a codepage for iconv().
+ */
+static std::string GetIconvName(int codepage)
+{
+	switch (codepage)
+	{
+	case CP_UTF8: return "UTF-8";
+	case CP_UCS2LE: return "UTF-16LE";
+	case CP_UCS2BE: return "UTF-16BE";
+	case 20127: return "ASCII";
+	case 20932: case 51932: return "EUC-JP";
+	case 50220: case 50221: case 50222: return "ISO-2022-JP";
+	case 51949: return "EUC-KR";
+	case 52936: return "HZ";
+	case 54936: return "GB18030";
+	case 10000: return "MACINTOSH";
+	case 20866: return "KOI8-R";
+	case 21866: return "KOI8-U";
+	}
+	if (codepage >= 28591 && codepage <= 28605)
+		return "ISO-8859-" + std::to_string(codepage - 28590);
+	return "CP" + std::to_string(codepage);
+}
+
+static bool IsValidCodePage(int codepage)
+{
+	iconv_t cd = iconv_open("UTF-8", GetIconvName(codepage).c_str());
+	if (cd == reinterpret_cast<iconv_t>(-1))
+		return false;
+	iconv_close(cd);
+	return true;
+}
+
+/**
+ * @brief Convert bytes from one codepage to another with iconv().
+ * Invalid or unmappable input is replaced with '?' and sets the lossy flag.
+ */
+static bool IconvConvert(int cpin, int cpout, const char* src, size_t srclen, std::string& dest, bool* lossy)
+{
+	dest.clear();
+	iconv_t cd = iconv_open(GetIconvName(cpout).c_str(), GetIconvName(cpin).c_str());
+	if (cd == reinterpret_cast<iconv_t>(-1))
+		return false;
+	const size_t unit = (cpin == CP_UCS2LE || cpin == CP_UCS2BE) ? 2 : 1;
+	char outbuf[4096];
+	char* in = const_cast<char*>(src);
+	size_t inleft = srclen;
+	while (inleft > 0)
+	{
+		char* out = outbuf;
+		size_t outleft = sizeof(outbuf);
+		const size_t res = iconv(cd, &in, &inleft, &out, &outleft);
+		dest.append(outbuf, out - outbuf);
+		if (res == static_cast<size_t>(-1) && errno != E2BIG)
+		{
+			// Invalid or incomplete input sequence
+			if (lossy)
+				*lossy = true;
+			std::string replacement;
+			IconvConvert(CP_UTF8, cpout, "?", 1, replacement, nullptr);
+			dest += replacement;
+			const size_t skip = (std::min)(unit, inleft);
+			in += skip;
+			inleft -= skip;
+		}
+		else if (res != static_cast<size_t>(-1) && res > 0 && lossy)
+		{
+			// Irreversible conversions
+			*lossy = true;
+		}
+	}
+	char* out = outbuf;
+	size_t outleft = sizeof(outbuf);
+	iconv(cd, nullptr, nullptr, &out, &outleft);
+	dest.append(outbuf, out - outbuf);
+	iconv_close(cd);
+	return true;
+}
+
+/**
+ * @brief Convert bytes from one codepage to another into a buffer.
+ */
+static bool IconvConvert(int cpin, int cpout, const unsigned char* src, size_t srcbytes, buffer* dest)
+{
+	std::string out;
+	bool lossy = false;
+	const bool result = IconvConvert(cpin, cpout, reinterpret_cast<const char*>(src), srcbytes, out, &lossy);
+	dest->resize(out.size() + 2);
+	memcpy(dest->ptr, out.data(), out.size());
+	dest->ptr[out.size()] = 0;
+	dest->ptr[out.size() + 1] = 0;
+	dest->size = out.size();
+	return result;
+}
+#endif
+
 // store the default codepage as specified by user in options
 static int f_nDefaultCodepage = GetACP();
 
@@ -306,6 +423,7 @@ void maketchar(String & ch, unsigned unich, bool & lossy, unsigned codepage)
 		ch = (tchar_t)unich;
 		return;
 	}
+#ifdef _WIN32
 	wchar_t wch = (wchar_t)unich;
 	if (!lossy)
 	{
@@ -332,6 +450,14 @@ void maketchar(String & ch, unsigned unich, bool & lossy, unsigned codepage)
 		return;
 	}
 	ch = _T("?");
+#else
+	unsigned char utf8[8];
+	const std::string u8(reinterpret_cast<char *>(utf8), Ucs4_to_Utf8(unich, utf8));
+	if (EqualCodepages(codepage, CP_UTF8))
+		ch = u8;
+	else if (!IconvConvert(CP_UTF8, codepage, u8.data(), u8.size(), ch, &lossy) || ch.empty())
+		ch = _T("?");
+#endif
 #endif
 }
 
@@ -353,6 +479,7 @@ unsigned byteToUnicode(unsigned char ch, unsigned codepage)
 	if (ch < 0x80)
 		return ch;
 
+#ifdef _WIN32
 	DWORD flags = 0;
 	wchar_t wbuff;
 	int n = MultiByteToWideChar(codepage, flags, (const char*) & ch, 1, &wbuff, 1);
@@ -360,6 +487,13 @@ unsigned byteToUnicode(unsigned char ch, unsigned codepage)
 		return wbuff;
 	else
 		return '?';
+#else
+	std::string u8;
+	bool lossy = false;
+	if (!IconvConvert(codepage, CP_UTF8, reinterpret_cast<const char *>(&ch), 1, u8, &lossy) || u8.empty() || lossy)
+		return '?';
+	return GetUtf8Char(reinterpret_cast<unsigned char *>(&u8[0]));
+#endif
 }
 
 /**
@@ -429,7 +563,7 @@ unsigned get_unicode_char(unsigned char * ptr, UNICODESET codeset, int codepage)
 	switch (codeset)
 	{
 	case UCS2LE:
-		ch = *((WORD *)ptr);
+		ch = *((uint16_t *)ptr);
 		break;
 	case UCS2BE:
 		ch = (ptr[0] << 8) + ptr[1];
@@ -690,6 +824,34 @@ int CrossConvert(const char* src, unsigned srclen, char* dest, unsigned destsize
 {
 	assert(destsize > 1);
 
+#ifndef _WIN32
+	if (srclen == -1)
+	{
+		if (cpin == CP_UCS2LE || cpin == CP_UCS2BE)
+		{
+			srclen = 0;
+			while (src[srclen] != 0 || src[srclen + 1] != 0)
+				srclen += 2;
+		}
+		else
+			srclen = static_cast<unsigned>(strlen(src));
+	}
+	std::string out;
+	bool defaulted = false;
+	if (!IconvConvert(cpin, cpout, src, srclen, out, &defaulted))
+	{
+		dest[0] = '?';
+		return 1;
+	}
+	const unsigned n = (std::min)(static_cast<unsigned>(out.size()), destsize - 2);
+	memcpy(dest, out.data(), n);
+	dest[n] = 0;
+	dest[n + 1] = 0;
+	if (lossy)
+		*lossy = defaulted;
+	return n;
+#else
+
 	// Convert input to Unicode, using specified codepage
 	DWORD flags = 0;
 	int wlen = srclen * 2 + 6;
@@ -764,6 +926,7 @@ int CrossConvert(const char* src, unsigned srclen, char* dest, unsigned destsize
 	if (lossy)
 		*lossy = !!defaulted;
 	return n;
+#endif
 }
 
 /**
@@ -824,7 +987,7 @@ unsigned char *convertTtoUTF8(const tchar_t *src, int srcbytes/* = -1*/)
 {
 	buffer buf(256);
 	convertTtoUTF8(&buf, src, srcbytes);
-	return (unsigned char *)_strdup((const char *)buf.ptr);
+	return (unsigned char *)strdup((const char *)buf.ptr);
 }
 
 tchar_t *convertUTF8toT(buffer * buf, const char *src, int srcbytes/* = -1*/)
@@ -971,7 +1134,7 @@ bool convert(UNICODESET unicoding1, int codepage1, const unsigned char * src, si
 	{
 		// simple byte copy
 		dest->resize(srcbytes + 2);
-		CopyMemory(dest->ptr, src, srcbytes);
+		memcpy(dest->ptr, src, srcbytes);
 		dest->ptr[srcbytes] = 0;
 		dest->ptr[srcbytes+1] = 0;
 		dest->size = srcbytes;
@@ -1010,6 +1173,7 @@ bool convert(UNICODESET unicoding1, int codepage1, const unsigned char * src, si
 		int destcp = (unicoding2 == UTF8 ? CP_UTF8 : codepage2);
 		if (destcp == CP_ACP || IsValidCodePage(destcp))
 		{
+#ifdef _WIN32
 			DWORD flags = 0;
 			int bytes = WideCharToMultiByte(destcp, flags, (LPCWSTR)src, static_cast<int>(srcbytes/2), 0, 0, nullptr, nullptr);
 			dest->resize(bytes + 2);
@@ -1019,6 +1183,9 @@ bool convert(UNICODESET unicoding1, int codepage1, const unsigned char * src, si
 			dest->ptr[bytes+1] = 0;
 			dest->size = bytes;
 			return losses==0;
+#else
+			return IconvConvert(CP_UCS2LE, NormalizeCodepage(destcp), src, srcbytes, dest);
+#endif
 		}
 		else
 		{
@@ -1028,7 +1195,7 @@ bool convert(UNICODESET unicoding1, int codepage1, const unsigned char * src, si
 			IExconverter *pexconv = Exconverter::getInstance();
 			if (pexconv != nullptr)
 			{
-				bool result = pexconv->convertFromUnicode(destcp, (LPWSTR)src, &srcsize, (char *)dest->ptr, &dstsize);
+				bool result = pexconv->convertFromUnicode(destcp, (wchar_t *)src, &srcsize, (char *)dest->ptr, &dstsize);
 				dest->ptr[dstsize] = 0;
 				dest->ptr[dstsize+1] = 0;
 				dest->size = dstsize;
@@ -1044,6 +1211,7 @@ bool convert(UNICODESET unicoding1, int codepage1, const unsigned char * src, si
 		int srccp = (unicoding1 == UTF8 ? CP_UTF8 : codepage1);
 		if (srccp == CP_ACP || IsValidCodePage(srccp))
 		{
+#ifdef _WIN32
 			DWORD flags = 0;
 			int wchars = MultiByteToWideChar(srccp, flags, (LPCSTR)src, static_cast<int>(srcbytes), 0, 0);
 			dest->resize((wchars + 1) *2);
@@ -1052,6 +1220,10 @@ bool convert(UNICODESET unicoding1, int codepage1, const unsigned char * src, si
 			dest->ptr[wchars * 2 + 1] = 0;
 			dest->size = wchars * 2;
 			return true;
+#else
+			IconvConvert(NormalizeCodepage(srccp), CP_UCS2LE, src, srcbytes, dest);
+			return true;
+#endif
 		}
 		else
 		{
@@ -1061,7 +1233,7 @@ bool convert(UNICODESET unicoding1, int codepage1, const unsigned char * src, si
 			IExconverter *pexconv = Exconverter::getInstance();
 			if (pexconv != nullptr)
 			{
-				bool result = pexconv->convertToUnicode(srccp, (LPCSTR)src, &srcsize, (LPWSTR)dest->ptr, &dstsize);
+				bool result = pexconv->convertToUnicode(srccp, (const char *)src, &srcsize, (wchar_t *)dest->ptr, &dstsize);
 				dest->ptr[dstsize * sizeof(wchar_t)] = 0;
 				dest->ptr[dstsize * sizeof(wchar_t) + 1] = 0;
 				dest->size = dstsize * sizeof(wchar_t);
@@ -1081,6 +1253,7 @@ bool convert(UNICODESET unicoding1, int codepage1, const unsigned char * src, si
  */
 static void convert(const std::wstring& from, unsigned codepage, std::string& to)
 {
+#ifdef _WIN32
 	int len = WideCharToMultiByte(codepage, 0, from.c_str(), static_cast<int>(from.length()), 0, 0, 0, 0);
 	if (len)
 	{
@@ -1091,6 +1264,19 @@ static void convert(const std::wstring& from, unsigned codepage, std::string& to
 	{
 		to.clear();
 	}
+#else
+	// wchar_t holds UCS-4 outside Windows
+	std::string u8;
+	for (wchar_t wch : from)
+	{
+		unsigned char utf8[8];
+		u8.append(reinterpret_cast<char *>(utf8), Ucs4_to_Utf8(static_cast<unsigned>(wch), utf8));
+	}
+	if (EqualCodepages(codepage, CP_UTF8))
+		to = u8;
+	else if (!IconvConvert(CP_UTF8, NormalizeCodepage(codepage), u8.data(), u8.size(), to, nullptr))
+		to.clear();
+#endif
 }
 
 /**
@@ -1250,6 +1436,7 @@ UNICODESET DetermineEncoding(const unsigned char *pBuffer, uint64_t size, bool *
  */
 static int NormalizeCodepage(int cp)
 {
+#ifdef _WIN32
 	if (cp == CP_THREAD_ACP) // should only happen on Win2000+
 	{
 		tchar_t buff[32];
@@ -1261,6 +1448,10 @@ static int NormalizeCodepage(int cp)
 	}
 	if (cp == CP_ACP) cp = GetACP();
 	if (cp == CP_OEMCP) cp = GetOEMCP();
+#else
+	if (cp == CP_THREAD_ACP || cp == CP_ACP || cp == CP_OEMCP)
+		cp = GetACP();
+#endif
 	return cp;
 }
 
@@ -1283,6 +1474,7 @@ void setDefaultCodepage(int cp)
 	f_nDefaultCodepage = cp;
 }
 
+#ifdef _WIN32
 typedef int (WINAPI* PFN_NormalizeString)(_NORM_FORM NormForm, LPCWSTR lpSrcString, int cwSrcLength, LPWSTR lpDstString, int cwDstLength);
 
 static PFN_NormalizeString GetNormalizeStringProc()
@@ -1306,6 +1498,10 @@ String normalizeString(const String& str, NORMFORM form)
 	if (str.empty())
 		return str;
 
+#ifndef _WIN32
+	// No normalization tables without normaliz.dll
+	return str;
+#else
 	PFN_NormalizeString pNormalizeString = GetNormalizeStringProc();
 	if (!pNormalizeString)
 		return str;
@@ -1377,8 +1573,12 @@ String normalizeString(const String& str, NORMFORM form)
 		return str;
 	}
 #endif
+#endif
 }
 
+#endif
+
+#ifdef _WIN32
 using LCMapStringEx_t = int (WINAPI*)(LPCWSTR lpLocaleName, DWORD dwMapFlags, LPCWSTR lpSrcStr, int cchSrc, LPWSTR lpDestStr, int cchDest, LPNLSVERSIONINFO lpVersionInformation, LPVOID lpReserved, LPARAM sortHandle);
 
 static String LCMapStringAuto(const String& input, unsigned mapFlags)
@@ -1417,6 +1617,48 @@ static String LCMapStringAuto(const String& input, unsigned mapFlags)
 
 	return result;
 }
+#else
+enum
+{
+	LCMAP_LOWERCASE = 0x00000100,
+	LCMAP_UPPERCASE = 0x00000200,
+	LCMAP_HIRAGANA = 0x00100000,
+	LCMAP_KATAKANA = 0x00200000,
+	LCMAP_HALFWIDTH = 0x00400000,
+	LCMAP_FULLWIDTH = 0x00800000,
+	LCMAP_SIMPLIFIED_CHINESE = 0x02000000,
+	LCMAP_TRADITIONAL_CHINESE = 0x04000000,
+};
+
+/**
+ * @brief Map the characters of an UTF-8 string.
+ * Only the case mappings are available without the Windows NLS tables,
+ * other mappings return the input.
+ */
+static String LCMapStringAuto(const String& input, unsigned mapFlags)
+{
+	if (input.empty() || (mapFlags != LCMAP_UPPERCASE && mapFlags != LCMAP_LOWERCASE))
+		return input;
+
+	String result;
+	result.reserve(input.size());
+	for (size_t i = 0; i < input.size();)
+	{
+		int chlen = Utf8len_fromLeadByte(static_cast<unsigned char>(input[i]));
+		if (chlen < 1 || i + chlen > input.size())
+		{
+			result += input[i++];
+			continue;
+		}
+		unsigned ch = GetUtf8Char(reinterpret_cast<unsigned char *>(const_cast<char *>(&input[i])));
+		ch = (mapFlags == LCMAP_UPPERCASE) ? std::towupper(ch) : std::towlower(ch);
+		unsigned char utf8[8];
+		result.append(reinterpret_cast<char *>(utf8), Ucs4_to_Utf8(ch, utf8));
+		i += chlen;
+	}
+	return result;
+}
+#endif
 
 String toUpper(const String& s)
 {
@@ -9,12 +9,148 @@
 #include "DiffItem.h"
 #include "PathContext.h"
 #include "IAbortable.h"
+#include "ContentHashCache.h"
+#include "ByteComparator.h"
 #include "cio.h"
+#include "diff.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
 
 namespace CompareEngines
 {
 
-BinaryCompare::BinaryCompare() : m_piAbortable(nullptr)
+/** @brief Files smaller than this are read, mapping them costs more than it saves. */
+static const int64_t MinMappedFileSize = 1024 * 1024;
+/** @brief Size of the window mapped from each file, kept small enough for 32-bit address space. */
+static const size_t MappingWindowSize = (sizeof(void *) >= 8 ? 256 : 32) * 1024 * 1024;
+/** @brief Bytes compared between abort checks. */
+static const size_t MappedCompareStep = 4 * 1024 * 1024;
+/** @brief Size of each block read by compare_sampled(). */
+static const size_t SampleBlockSize = 64 * 1024;
+/** @brief Files smaller than this are not sampled, reading them whole costs little more. */
+static const int64_t MinSampledFileSize = 16 * 1024 * 1024;
+/** @brief Result of the compare steps that didn't decide, the next step compares the files. */
+static const int NOT_COMPARED = -1;
+
+/** @brief Settings for compare_files(). */
+struct CompareFilesOptions
+{
+	bool bMemoryMapping; /**< Map large files instead of reading them */
+	int nSampleBlocks; /**< Blocks sampled before a full compare, 0 to not sample */
+	bool bTrustSamples; /**< Report SAME when all samples match */
+};
+
+namespace
+{
+
+/**
+ * @brief Read-only view of a window of an open file.
+ * Only one window is mapped at a time, mapping another unmaps the previous.
+ */
+class FileMappingWindow
+{
+public:
+	explicit FileMappingWindow(int fd);
+	~FileMappingWindow();
+	FileMappingWindow(const FileMappingWindow&) = delete;
+	FileMappingWindow& operator=(const FileMappingWindow&) = delete;
+	bool IsOpen() const;
+	const char *Map(int64_t offset, size_t len);
+private:
+	void Unmap();
+	void *m_pView; /**< Begin of the mapped window (aligned down from the requested offset) */
+	size_t m_viewSize; /**< Size of the mapped window */
+#ifdef _WIN32
+	HANDLE m_hMapping;
+#else
+	int m_fd;
+#endif
+};
+
+FileMappingWindow::FileMappingWindow(int fd) : m_pView(nullptr), m_viewSize(0)
+{
+#ifdef _WIN32
+	m_hMapping = CreateFileMapping(reinterpret_cast<HANDLE>(_get_osfhandle(fd)), nullptr, PAGE_READONLY, 0, 0, nullptr);
+#else
+	m_fd = fd;
+#endif
+}
+
+FileMappingWindow::~FileMappingWindow()
+{
+	Unmap();
+#ifdef _WIN32
+	if (m_hMapping != nullptr)
+		CloseHandle(m_hMapping);
+#endif
+}
+
+bool FileMappingWindow::IsOpen() const
+{
+#ifdef _WIN32
+	return m_hMapping != nullptr;
+#else
+	return m_fd != -1;
+#endif
+}
+
+/**
+ * @brief Map @p len bytes of the file from @p offset.
+ * Pages that a truncation of the file cuts off read as newlines, see
+ * guard_mapping(), so the compare finds the file changed instead of crashing.
+ * @return Pointer to the byte at @p offset, or nullptr if mapping failed.
+ */
+const char *FileMappingWindow::Map(int64_t offset, size_t len)
+{
+	Unmap();
+#ifdef _WIN32
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	const size_t delta = static_cast<size_t>(offset % si.dwAllocationGranularity);
+	const uint64_t viewOffset = static_cast<uint64_t>(offset) - delta;
+	m_pView = MapViewOfFile(m_hMapping, FILE_MAP_READ,
+		static_cast<DWORD>(viewOffset >> 32), static_cast<DWORD>(viewOffset), len + delta);
+	if (m_pView == nullptr)
+		return nullptr;
+#else
+	const size_t delta = static_cast<size_t>(offset % sysconf(_SC_PAGESIZE));
+	void *pView = mmap(nullptr, len + delta, PROT_READ, MAP_SHARED, m_fd, offset - delta);
+	if (pView == MAP_FAILED)
+		return nullptr;
+	// Unless a truncation of the file can't crash, read it instead
+	if (!guard_mapping(static_cast<char *>(pView), len + delta))
+	{
+		munmap(pView, len + delta);
+		return nullptr;
+	}
+	madvise(pView, len + delta, MADV_SEQUENTIAL);
+	m_pView = pView;
+#endif
+	m_viewSize = len + delta;
+	return static_cast<const char *>(m_pView) + delta;
+}
+
+void FileMappingWindow::Unmap()
+{
+	if (m_pView == nullptr)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(m_pView);
+#else
+	unguard_mapping(static_cast<char *>(m_pView));
+	munmap(m_pView, m_viewSize);
+#endif
+	m_pView = nullptr;
+	m_viewSize = 0;
+}
+
+}
+
+BinaryCompare::BinaryCompare() : m_piAbortable(nullptr), m_pContentHashCache(nullptr), m_bMemoryMapping(false)
+	, m_nSampleBlocks(0), m_bTrustSamples(false)
 {
 }
 
@@ -29,16 +165,288 @@ void BinaryCompare::SetAbortable(const IAbortable * piAbortable)
 	m_piAbortable = const_cast<IAbortable*>(piAbortable);
 }
 
-static int compare_files(const String& file1, const String& file2, IAbortable *piAbortable)
+/**
+ * @brief Set content hash cache.
+ * @param [in] pCache Cache to consult and fill, or nullptr to always read files.
+ */
+void BinaryCompare::SetContentHashCache(ContentHashCache * pCache)
+{
+	m_pContentHashCache = pCache;
+}
+
+/**
+ * @brief Set whether files are memory-mapped.
+ * @param [in] bMemoryMapping Map files of 1 MB or more window by window
+ * instead of reading them into buffers.
+ */
+void BinaryCompare::SetMemoryMapping(bool bMemoryMapping)
+{
+	m_bMemoryMapping = bMemoryMapping;
+}
+
+/**
+ * @brief Set sampling of large files.
+ * Before reading whole files of equal size (16 MB or more), the head,
+ * the tail and evenly spaced blocks between them are compared, so that
+ * most differing files are found different after a few reads.
+ * @param [in] nSampleBlocks Number of blocks between head and tail for
+ * files up to 1 GB, larger files get more. 0 disables sampling.
+ * @param [in] bTrustSamples If true, files whose samples all match are
+ * reported identical without reading them whole.
+ */
+void BinaryCompare::SetSampling(int nSampleBlocks, bool bTrustSamples)
+{
+	m_nSampleBlocks = nSampleBlocks;
+	m_bTrustSamples = bTrustSamples;
+}
+
+/**
+ * @brief Read the rest of a file into its hasher.
+ * @return DIFFCODE::DIFF, or DIFFCODE::CMPERR/CMPABORT if reading failed.
+ */
+static int hash_rest(int fd, char *buf, size_t bufsize, ContentHashCache::Hasher& hasher, IAbortable *piAbortable)
+{
+	for (;;)
+	{
+		if (piAbortable && piAbortable->ShouldAbort())
+			return DIFFCODE::CMPABORT;
+		int size = cio::read_i(fd, buf, static_cast<unsigned>(bufsize));
+		if (size <= 0)
+			return size < 0 ? DIFFCODE::CMPERR : DIFFCODE::DIFF;
+		hasher.Update(buf, size);
+	}
+}
+
+/**
+ * @brief Hash and compare one step of two mapped windows.
+ * Reading a mapped file that became unreadable (network drive disconnected,
+ * file truncated by another process) raises an in-page error on Windows,
+ * which is turned into a compare error here.
+ * @param [out] same Length of the common prefix.
+ * @return false if the mapped memory couldn't be read.
+ */
+static bool compare_mapped_step(const char *p1, const char *p2, size_t len, ContentHashCache::Hasher *hashers, size_t& same)
+{
+#ifdef _MSC_VER
+	__try
+	{
+#endif
+		if (hashers)
+		{
+			hashers[0].Update(p1, len);
+			hashers[1].Update(p2, len);
+		}
+		same = ByteComparator::FindMismatch(p1, p2, len);
+#ifdef _MSC_VER
+	}
+	__except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+	{
+		return false;
+	}
+#endif
+	return true;
+}
+
+/** @brief Hash @p len bytes of a mapped window, see compare_mapped_step(). */
+static bool hash_mapped_step(const char *p, size_t len, ContentHashCache::Hasher& hasher)
+{
+#ifdef _MSC_VER
+	__try
+	{
+#endif
+		hasher.Update(p, len);
+#ifdef _MSC_VER
+	}
+	__except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+	{
+		return false;
+	}
+#endif
+	return true;
+}
+
+/**
+ * @brief Hash a mapped file from @p offset to @p size.
+ * @return DIFFCODE::DIFF, or DIFFCODE::CMPERR/CMPABORT if reading failed.
+ */
+static int hash_mapped_rest(FileMappingWindow& view, int64_t offset, int64_t size, ContentHashCache::Hasher& hasher, IAbortable *piAbortable)
+{
+	while (offset < size)
+	{
+		const size_t len = static_cast<size_t>((std::min)(static_cast<int64_t>(MappingWindowSize), size - offset));
+		const char *p = view.Map(offset, len);
+		if (p == nullptr)
+			return DIFFCODE::CMPERR;
+		for (size_t pos = 0; pos < len; pos += MappedCompareStep)
+		{
+			if (piAbortable && piAbortable->ShouldAbort())
+				return DIFFCODE::CMPABORT;
+			if (!hash_mapped_step(p + pos, (std::min)(MappedCompareStep, len - pos), hasher))
+				return DIFFCODE::CMPERR;
+		}
+		offset += len;
+	}
+	return DIFFCODE::DIFF;
+}
+
+/**
+ * @brief Compare two open files by mapping them window by window.
+ * @return DIFFCODE, or NOT_COMPARED if files couldn't be mapped and nothing was compared yet.
+ */
+static int compare_mapped(int fd1, int fd2, int64_t size1, int64_t size2, IAbortable *piAbortable,
+	ContentHashCache::Hasher *hashers, int64_t *pFirstDiffOffset)
+{
+	FileMappingWindow view1(fd1), view2(fd2);
+	if (!view1.IsOpen() || !view2.IsOpen())
+		return NOT_COMPARED;
+	const int64_t size = (std::min)(size1, size2);
+	int64_t offset = 0;
+	int64_t diffOffset = -1;
+	while (offset < size && diffOffset == -1)
+	{
+		const size_t len = static_cast<size_t>((std::min)(static_cast<int64_t>(MappingWindowSize), size - offset));
+		const char *p1 = view1.Map(offset, len);
+		const char *p2 = view2.Map(offset, len);
+		if (p1 == nullptr || p2 == nullptr)
+			return (offset == 0) ? NOT_COMPARED : DIFFCODE::CMPERR;
+		for (size_t pos = 0; pos < len; pos += MappedCompareStep)
+		{
+			if (piAbortable && piAbortable->ShouldAbort())
+				return DIFFCODE::CMPABORT;
+			const size_t step = (std::min)(MappedCompareStep, len - pos);
+			size_t same;
+			if (!compare_mapped_step(p1 + pos, p2 + pos, step, hashers, same))
+				return DIFFCODE::CMPERR;
+			if (same < step)
+			{
+				diffOffset = offset + pos + same;
+				// Hash the rest of this step so that both digests cover it
+				offset += pos + step;
+				break;
+			}
+		}
+		if (diffOffset == -1)
+			offset += len;
+	}
+	if (diffOffset == -1)
+	{
+		if (size1 == size2)
+			return DIFFCODE::SAME;
+		diffOffset = size;
+	}
+	if (pFirstDiffOffset)
+		*pFirstDiffOffset = diffOffset;
+	// Finish both digests so that the next compare needn't read the files
+	int code = DIFFCODE::DIFF;
+	if (hashers)
+	{
+		code = hash_mapped_rest(view1, offset, size1, hashers[0], piAbortable);
+		if (code == DIFFCODE::DIFF)
+			code = hash_mapped_rest(view2, offset, size2, hashers[1], piAbortable);
+	}
+	return code;
+}
+
+/**
+ * @brief Number of blocks compare_sampled() reads from a file of @p size bytes.
+ * @p nSampleBlocks for files up to 1 GB, twice that up to 16 GB and four times beyond.
+ */
+static int sample_count(int64_t size, int nSampleBlocks)
+{
+	const int64_t GB = 1024 * 1024 * 1024;
+	if (size <= GB)
+		return nSampleBlocks;
+	return (size <= 16 * GB) ? nSampleBlocks * 2 : nSampleBlocks * 4;
+}
+
+/**
+ * @brief Compare the head, the tail and evenly spaced blocks of two files of equal size.
+ * Leaves both files positioned at the beginning.
+ * @param [out] pFirstDiffOffset Offset of the first differing byte, if it is in the head block.
+ * @return DIFFCODE::DIFF if a sample differs, DIFFCODE::SAME if all match,
+ * or DIFFCODE::CMPERR/CMPABORT.
+ */
+static int compare_sampled(int fd1, int fd2, int64_t size, int nSampleBlocks, IAbortable *piAbortable, int64_t *pFirstDiffOffset)
+{
+	std::vector<char> buf1(SampleBlockSize), buf2(SampleBlockSize);
+	const int nSamples = sample_count(size, nSampleBlocks);
+	const int64_t lastBlock = size - SampleBlockSize;
+	int code = DIFFCODE::SAME;
+	// Head and tail first, a changed header or appended trailer is the most common difference
+	for (int i = -1; i <= nSamples && code == DIFFCODE::SAME; ++i)
+	{
+		if (piAbortable && piAbortable->ShouldAbort())
+		{
+			code = DIFFCODE::CMPABORT;
+			break;
+		}
+		int64_t offset;
+		if (i == -1)
+			offset = 0;
+		else if (i == 0)
+			offset = lastBlock;
+		else
+			offset = (lastBlock * i / (nSamples + 1)) & ~static_cast<int64_t>(4095);
+		if (cio::lseek(fd1, offset, SEEK_SET) != offset || cio::lseek(fd2, offset, SEEK_SET) != offset)
+		{
+			code = DIFFCODE::CMPERR;
+			break;
+		}
+		const int size1 = cio::read_i(fd1, buf1.data(), static_cast<unsigned>(SampleBlockSize));
+		const int size2 = cio::read_i(fd2, buf2.data(), static_cast<unsigned>(SampleBlockSize));
+		if (size1 < 0 || size2 < 0)
+		{
+			code = DIFFCODE::CMPERR;
+			break;
+		}
+		const size_t same = ByteComparator::FindMismatch(buf1.data(), buf2.data(), (std::min)(size1, size2));
+		if (size1 != size2 || same < static_cast<size_t>(size1))
+		{
+			code = DIFFCODE::DIFF;
+			if (offset == 0 && pFirstDiffOffset)
+				*pFirstDiffOffset = same;
+		}
+	}
+	if (cio::lseek(fd1, 0, SEEK_SET) != 0 || cio::lseek(fd2, 0, SEEK_SET) != 0)
+		code = DIFFCODE::CMPERR;
+	return code;
+}
+
+/**
+ * @brief Compare two files byte per byte.
+ * @param [in] options Memory mapping and sampling settings.
+ * @param [out] pInfo Offset of the first differing byte, and whether sampling decided.
+ * @return DIFFCODE
+ */
+static int compare_files(const String& file1, const String& file2, IAbortable *piAbortable,
+	ContentHashCache::Hasher *hashers, const CompareFilesOptions& options, BinaryCompare::CompareInfo *pInfo)
 {
 	const size_t bufsize = 1024 * 256;
-	int code;
+	int code = NOT_COMPARED;
 	int fd1 = -1, fd2 = -1;
+	int64_t *pFirstDiffOffset = pInfo ? &pInfo->firstDiffOffset : nullptr;
 	
 	cio::tsopen_s(&fd1, file1, O_BINARY | O_RDONLY, _SH_DENYNO, _S_IREAD);
 	cio::tsopen_s(&fd2, file2, O_BINARY | O_RDONLY, _SH_DENYNO, _S_IREAD);
-	if (fd1 != -1 && fd2 != -1)
+	cio::stat st1, st2;
+	if (fd1 != -1 && fd2 != -1 && (options.bMemoryMapping || options.nSampleBlocks > 0) &&
+		cio::fstat(fd1, &st1) == 0 && cio::fstat(fd2, &st2) == 0)
 	{
+		if (options.nSampleBlocks > 0 && st1.st_size == st2.st_size && st1.st_size >= MinSampledFileSize)
+		{
+			code = compare_sampled(fd1, fd2, st1.st_size, options.nSampleBlocks, piAbortable, pFirstDiffOffset);
+			if (code == DIFFCODE::SAME && !options.bTrustSamples)
+				code = NOT_COMPARED;
+			else if (pInfo && (code == DIFFCODE::SAME || code == DIFFCODE::DIFF))
+				pInfo->bSampledOnly = true;
+		}
+		if (code == NOT_COMPARED && options.bMemoryMapping &&
+			st1.st_size >= MinMappedFileSize && st2.st_size >= MinMappedFileSize)
+			code = compare_mapped(fd1, fd2, st1.st_size, st2.st_size, piAbortable, hashers, pFirstDiffOffset);
+	}
+	if (code == NOT_COMPARED && fd1 != -1 && fd2 != -1)
+	{
+		int64_t offset = 0;
 		for (;;)
 		{
 			if (piAbortable && piAbortable->ShouldAbort())
@@ -50,6 +458,13 @@ static int compare_files(const String& file1, const String& file2, IAbortable *p
 			char buf2[bufsize];
 			int size1 = cio::read_i(fd1, buf1, sizeof(buf1));
 			int size2 = cio::read_i(fd2, buf2, sizeof(buf2));
+			if (hashers)
+			{
+				if (size1 > 0)
+					hashers[0].Update(buf1, size1);
+				if (size2 > 0)
+					hashers[1].Update(buf2, size2);
+			}
 			if (size1 <= 0 || size2 <= 0)
 			{
 				if (size1 < 0 || size2 < 0)
@@ -57,17 +472,39 @@ static int compare_files(const String& file1, const String& file2, IAbortable *p
 				else if (size1 == size2)
 					code = DIFFCODE::SAME;
 				else
+				{
 					code = DIFFCODE::DIFF;
+					if (pFirstDiffOffset)
+						*pFirstDiffOffset = offset;
+					// One file ended, finish the digest of the longer one
+					if (hashers)
+					{
+						code = (size1 > 0) ?
+							hash_rest(fd1, buf1, sizeof(buf1), hashers[0], piAbortable) :
+							hash_rest(fd2, buf2, sizeof(buf2), hashers[1], piAbortable);
+					}
+				}
 				break;
 			}
-			if (size1 != size2 || memcmp(buf1, buf2, size1) != 0)
+			const size_t same = ByteComparator::FindMismatch(buf1, buf2, (std::min)(size1, size2));
+			if (size1 != size2 || same < static_cast<size_t>(size1))
 			{
 				code = DIFFCODE::DIFF;
+				if (pFirstDiffOffset)
+					*pFirstDiffOffset = offset + same;
+				// Finish both digests so that the next compare needn't read the files
+				if (hashers)
+				{
+					code = hash_rest(fd1, buf1, sizeof(buf1), hashers[0], piAbortable);
+					if (code == DIFFCODE::DIFF)
+						code = hash_rest(fd2, buf2, sizeof(buf2), hashers[1], piAbortable);
+				}
 				break;
 			}
+			offset += size1;
 		}
 	}
-	else
+	else if (code == NOT_COMPARED)
 	{
 		code = DIFFCODE::CMPERR;
 	}
@@ -79,13 +516,59 @@ static int compare_files(const String& file1, const String& file2, IAbortable *p
 	return code;
 }
 
+/**
+ * @brief Compare two files by their cached content digests.
+ * A file without a valid cache record is read once to compute its digest,
+ * if neither has one the files are compared and both digests are recorded.
+ * @return DIFFCODE
+ */
+unsigned BinaryCompare::CompareFilesCached(const PathContext& files, const DIFFITEM &di, int p1, int p2, CompareInfo *pInfo) const
+{
+	const int sides[2] = { p1, p2 };
+	ContentHashCache::Entry entries[2];
+	bool bCached[2];
+	for (int i = 0; i < 2; ++i)
+		bCached[i] = m_pContentHashCache->Lookup(files[sides[i]], di.diffFileInfo[sides[i]], entries[i]);
+	if (!bCached[0] && !bCached[1])
+	{
+		ContentHashCache::Hasher hashers[2];
+		CompareInfo info;
+		const CompareFilesOptions options = { m_bMemoryMapping, m_nSampleBlocks, m_bTrustSamples };
+		int code = compare_files(files[p1], files[p2], m_piAbortable, hashers, options, &info);
+		if (pInfo)
+			*pInfo = info;
+		// Files decided by sampling weren't read whole, there are no digests to record
+		if ((code == DIFFCODE::SAME || code == DIFFCODE::DIFF) && !info.bSampledOnly)
+		{
+			for (int i = 0; i < 2; ++i)
+			{
+				hashers[i].Finish(entries[i]);
+				m_pContentHashCache->Store(files[sides[i]], di.diffFileInfo[sides[i]], entries[i]);
+			}
+		}
+		return code;
+	}
+	for (int i = 0; i < 2; ++i)
+	{
+		if (bCached[i])
+			continue;
+		if (!ContentHashCache::HashFile(files[sides[i]], entries[i], m_piAbortable))
+			return (m_piAbortable && m_piAbortable->ShouldAbort()) ? DIFFCODE::CMPABORT : DIFFCODE::CMPERR;
+		m_pContentHashCache->Store(files[sides[i]], di.diffFileInfo[sides[i]], entries[i]);
+	}
+	return memcmp(entries[0].digest, entries[1].digest, sizeof(entries[0].digest)) == 0 ? DIFFCODE::SAME : DIFFCODE::DIFF;
+}
+
 /**
  * @brief Compare two specified files, byte-by-byte
  * @param [in] di Diffitem info.
+ * @param [out] pInfo Offset of the first differing byte (two-way compare
+ * only) and whether sampling alone decided the result.
  * @return DIFFCODE
  */
-int BinaryCompare::CompareFiles(const PathContext& files, const DIFFITEM &di) const
+int BinaryCompare::CompareFiles(const PathContext& files, const DIFFITEM &di, CompareInfo *pInfo) const
 {
+	CompareInfo info;
 	auto cmp = [&](int p1, int p2) -> unsigned
 	{
 		if (di.diffFileInfo[p1].size == DirItem::FILE_SIZE_NONE &&
@@ -97,31 +580,56 @@ int BinaryCompare::CompareFiles(const PathContext& files, const DIFFITEM &di) co
 			(di.diffFileInfo[p1].size != di.diffFileInfo[p2].size &&
 			 di.diffFileInfo[p1].size != 0 && di.diffFileInfo[p2].size != 0))
 			return DIFFCODE::DIFF;
-		return compare_files(files[p1], files[p2], m_piAbortable);
+		CompareInfo pairInfo;
+		unsigned code;
+		if (m_pContentHashCache != nullptr)
+			code = CompareFilesCached(files, di, p1, p2, &pairInfo);
+		else
+		{
+			const CompareFilesOptions options = { m_bMemoryMapping, m_nSampleBlocks, m_bTrustSamples };
+			code = compare_files(files[p1], files[p2], m_piAbortable, nullptr, options, &pairInfo);
+		}
+		info.firstDiffOffset = pairInfo.firstDiffOffset;
+		info.bSampledOnly = info.bSampledOnly || pairInfo.bSampledOnly;
+		return code;
 	};
 	switch (files.GetSize())
 	{
 	case 2:
-		return cmp(0, 1);
+	{
+		unsigned code = cmp(0, 1);
+		if (pInfo)
+			*pInfo = info;
+		return code;
+	}
 	case 3:
+	{
 		unsigned code10 = cmp(1, 0);
 		unsigned code12 = cmp(1, 2);
 		unsigned code02 = DIFFCODE::SAME;
+		unsigned code;
 		if (code10 == DIFFCODE::SAME && code12 == DIFFCODE::SAME)
-			return DIFFCODE::SAME;
+			code = DIFFCODE::SAME;
 		else if (code10 == DIFFCODE::SAME && code12 == DIFFCODE::DIFF)
-			return DIFFCODE::DIFF | DIFFCODE::DIFF3RDONLY;
+			code = DIFFCODE::DIFF | DIFFCODE::DIFF3RDONLY;
 		else if (code10 == DIFFCODE::DIFF && code12 == DIFFCODE::SAME)
-			return DIFFCODE::DIFF | DIFFCODE::DIFF1STONLY;
-		else if (code10 == DIFFCODE::DIFF && code12 == DIFFCODE::DIFF)
+			code = DIFFCODE::DIFF | DIFFCODE::DIFF1STONLY;
+		else
 		{
-			code02 = cmp(0, 2);
-			if (code02 == DIFFCODE::SAME)
-				return DIFFCODE::DIFF | DIFFCODE::DIFF2NDONLY;
+			if (code10 == DIFFCODE::DIFF && code12 == DIFFCODE::DIFF)
+				code02 = cmp(0, 2);
+			if (code10 == DIFFCODE::DIFF && code12 == DIFFCODE::DIFF && code02 == DIFFCODE::SAME)
+				code = DIFFCODE::DIFF | DIFFCODE::DIFF2NDONLY;
+			else if (code10 == DIFFCODE::CMPERR || code12 == DIFFCODE::CMPERR || code02 == DIFFCODE::CMPERR)
+				code = DIFFCODE::CMPERR;
+			else
+				code = DIFFCODE::DIFF;
 		}
-		if (code10 == DIFFCODE::CMPERR || code12 == DIFFCODE::CMPERR || code02 == DIFFCODE::CMPERR)
-			return DIFFCODE::CMPERR;
-		return DIFFCODE::DIFF;
+		// The pairwise offsets don't tell where the three files first differ
+		if (pInfo)
+			pInfo->bSampledOnly = info.bSampledOnly;
+		return code;
+	}
 	}
 	return DIFFCODE::CMPERR;
 }
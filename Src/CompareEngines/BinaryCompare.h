@@ -5,9 +5,12 @@
  */
 #pragma once
 
+#include <cstdint>
+
 class DIFFITEM;
 class PathContext;
 class IAbortable;
+class ContentHashCache;
 
 namespace CompareEngines
 {
@@ -19,12 +22,27 @@ namespace CompareEngines
 class BinaryCompare
 {
 public:
+	/** @brief Details of the compare of two files. */
+	struct CompareInfo
+	{
+		int64_t firstDiffOffset = -1; /**< Offset of the first differing byte, or -1 if not known */
+		bool bSampledOnly = false; /**< Result was decided from sampled blocks without reading whole files */
+	};
+
 	BinaryCompare();
 	~BinaryCompare();
 	void SetAbortable(const IAbortable * piAbortable);
-	int CompareFiles(const PathContext& files, const DIFFITEM &di) const;
+	void SetContentHashCache(ContentHashCache * pCache);
+	void SetMemoryMapping(bool bMemoryMapping);
+	void SetSampling(int nSampleBlocks, bool bTrustSamples);
+	int CompareFiles(const PathContext& files, const DIFFITEM &di, CompareInfo *pInfo = nullptr) const;
 private:
+	unsigned CompareFilesCached(const PathContext& files, const DIFFITEM &di, int p1, int p2, CompareInfo *pInfo) const;
 	IAbortable * m_piAbortable;
+	ContentHashCache * m_pContentHashCache;
+	bool m_bMemoryMapping; /**< Map large files instead of reading them */
+	int m_nSampleBlocks; /**< Blocks sampled before a full compare, 0 to not sample */
+	bool m_bTrustSamples; /**< Report SAME when all samples match, without a full compare */
 };
 
 } // namespace CompareEngines
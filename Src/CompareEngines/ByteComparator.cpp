@@ -6,11 +6,27 @@
 
 #include "pch.h"
 #include "ByteComparator.h"
+#include <algorithm>
 #include <cassert>
 #include "UnicodeString.h"
 #include "FileTextStats.h"
 #include "CompareOptions.h"
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BYTECOMPARATOR_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_SSE2
+#define TARGET_AVX2
+#else
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+using CompareEngines::ByteComparator;
+
 /**
  * @brief Returns if given char is EOL byte.
  * @param [in] ch Char to test.
@@ -32,6 +48,217 @@ static inline bool iswsch(tchar_t ch)
 	return ch == ' ' || ch == '\t';
 }
 
+/**
+ * @brief Counts of the bytes TextScan() is interested in.
+ * crs and lfs include the CR and LF bytes of CR+LF pairs.
+ */
+struct ByteCounts
+{
+	size_t zeros;
+	size_t crs;
+	size_t lfs;
+	size_t crlfs;
+};
+
+static void CountBytesScalar(const char *ptr, const char *end, ByteCounts& counts)
+{
+	for (; ptr < end; ++ptr)
+	{
+		const char ch = *ptr;
+		if (ch == 0)
+			++counts.zeros;
+		else if (ch == '\n')
+			++counts.lfs;
+		else if (ch == '\r')
+		{
+			++counts.crs;
+			if (ptr + 1 < end && ptr[1] == '\n')
+				++counts.crlfs;
+		}
+	}
+}
+
+/**
+ * @brief Returns length of the common prefix of two buffers.
+ */
+static size_t FindMismatchScalar(const char *ptr0, const char *ptr1, size_t len)
+{
+	size_t i = 0;
+	while (i < len && ptr0[i] == ptr1[i])
+		++i;
+	return i;
+}
+
+#ifdef BYTECOMPARATOR_X86
+
+static inline unsigned CountTrailingZeros(unsigned mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+/** @brief Sum of the 16 byte lanes of @p acc. */
+TARGET_SSE2 static inline size_t SumBytes(__m128i acc)
+{
+	const __m128i sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+	return _mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+}
+
+/**
+ * @brief SSE2 version of CountBytesScalar(), 32 bytes per iteration.
+ * The compare masks (0 or -1) are subtracted from byte lane accumulators,
+ * which are summed before they can overflow.
+ */
+TARGET_SSE2 static void CountBytesSse2(const char *ptr, const char *end, ByteCounts& counts)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i lf = _mm_set1_epi8('\n');
+	// The CR+LF test reads one byte past the 32 bytes
+	while (end - ptr > 32)
+	{
+		__m128i accZeros = zero, accCrs = zero, accLfs = zero, accCrlfs = zero;
+		for (int n = 0; n < 127 && end - ptr > 32; ++n, ptr += 32)
+		{
+			for (int half = 0; half < 32; half += 16)
+			{
+				const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr + half));
+				const __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr + half + 1));
+				const __m128i isCr = _mm_cmpeq_epi8(v, cr);
+				accZeros = _mm_sub_epi8(accZeros, _mm_cmpeq_epi8(v, zero));
+				accCrs = _mm_sub_epi8(accCrs, isCr);
+				accLfs = _mm_sub_epi8(accLfs, _mm_cmpeq_epi8(v, lf));
+				accCrlfs = _mm_sub_epi8(accCrlfs, _mm_and_si128(isCr, _mm_cmpeq_epi8(next, lf)));
+			}
+		}
+		counts.zeros += SumBytes(accZeros);
+		counts.crs += SumBytes(accCrs);
+		counts.lfs += SumBytes(accLfs);
+		counts.crlfs += SumBytes(accCrlfs);
+	}
+	CountBytesScalar(ptr, end, counts);
+}
+
+TARGET_SSE2 static size_t FindMismatchSse2(const char *ptr0, const char *ptr1, size_t len)
+{
+	size_t i = 0;
+	for (; i + 32 <= len; i += 32)
+	{
+		const __m128i eq0 = _mm_cmpeq_epi8(
+			_mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr0 + i)),
+			_mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr1 + i)));
+		const __m128i eq1 = _mm_cmpeq_epi8(
+			_mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr0 + i + 16)),
+			_mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr1 + i + 16)));
+		const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(eq0)) |
+			(static_cast<unsigned>(_mm_movemask_epi8(eq1)) << 16);
+		if (mask != 0xFFFFFFFFu)
+			return i + CountTrailingZeros(~mask);
+	}
+	return i + FindMismatchScalar(ptr0 + i, ptr1 + i, len - i);
+}
+
+TARGET_AVX2 static inline size_t SumBytes(__m256i acc)
+{
+	const __m256i sums = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+	const __m128i sums128 = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+	return _mm_cvtsi128_si32(sums128) + _mm_cvtsi128_si32(_mm_srli_si128(sums128, 8));
+}
+
+/** @brief AVX2 version of CountBytesSse2(). */
+TARGET_AVX2 static void CountBytesAvx2(const char *ptr, const char *end, ByteCounts& counts)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i cr = _mm256_set1_epi8('\r');
+	const __m256i lf = _mm256_set1_epi8('\n');
+	while (end - ptr > 32)
+	{
+		__m256i accZeros = zero, accCrs = zero, accLfs = zero, accCrlfs = zero;
+		for (int n = 0; n < 255 && end - ptr > 32; ++n, ptr += 32)
+		{
+			const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr));
+			const __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr + 1));
+			const __m256i isCr = _mm256_cmpeq_epi8(v, cr);
+			accZeros = _mm256_sub_epi8(accZeros, _mm256_cmpeq_epi8(v, zero));
+			accCrs = _mm256_sub_epi8(accCrs, isCr);
+			accLfs = _mm256_sub_epi8(accLfs, _mm256_cmpeq_epi8(v, lf));
+			accCrlfs = _mm256_sub_epi8(accCrlfs, _mm256_and_si256(isCr, _mm256_cmpeq_epi8(next, lf)));
+		}
+		counts.zeros += SumBytes(accZeros);
+		counts.crs += SumBytes(accCrs);
+		counts.lfs += SumBytes(accLfs);
+		counts.crlfs += SumBytes(accCrlfs);
+	}
+	CountBytesScalar(ptr, end, counts);
+}
+
+TARGET_AVX2 static size_t FindMismatchAvx2(const char *ptr0, const char *ptr1, size_t len)
+{
+	size_t i = 0;
+	for (; i + 32 <= len; i += 32)
+	{
+		const __m256i eq = _mm256_cmpeq_epi8(
+			_mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr0 + i)),
+			_mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr1 + i)));
+		const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(eq));
+		if (mask != 0xFFFFFFFFu)
+			return i + CountTrailingZeros(~mask);
+	}
+	return i + FindMismatchScalar(ptr0 + i, ptr1 + i, len - i);
+}
+
+#endif // BYTECOMPARATOR_X86
+
+/**
+ * @brief Returns the best instruction set supported by CPU and OS.
+ */
+static ByteComparator::SIMD_LEVEL DetectSimdLevel()
+{
+#if defined(BYTECOMPARATOR_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	const int maxLeaf = info[0];
+	__cpuid(info, 1);
+	if ((info[3] & (1 << 26)) == 0)
+		return ByteComparator::SIMD_NONE;
+	// AVX2 also needs the OS to save the YMM registers (OSXSAVE, XCR0)
+	if (maxLeaf >= 7 && (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6)
+	{
+		__cpuidex(info, 7, 0);
+		if ((info[1] & (1 << 5)) != 0)
+			return ByteComparator::SIMD_AVX2;
+	}
+	return ByteComparator::SIMD_SSE2;
+#elif defined(BYTECOMPARATOR_X86)
+	if (__builtin_cpu_supports("avx2"))
+		return ByteComparator::SIMD_AVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return ByteComparator::SIMD_SSE2;
+	return ByteComparator::SIMD_NONE;
+#else
+	return ByteComparator::SIMD_NONE;
+#endif
+}
+
+static const ByteComparator::SIMD_LEVEL s_supportedSimdLevel = DetectSimdLevel();
+static ByteComparator::SIMD_LEVEL s_simdLevel = s_supportedSimdLevel;
+
+static void CountBytes(const char *ptr, const char *end, ByteCounts& counts)
+{
+#ifdef BYTECOMPARATOR_X86
+	if (s_simdLevel == ByteComparator::SIMD_AVX2)
+		return CountBytesAvx2(ptr, end, counts);
+	if (s_simdLevel == ByteComparator::SIMD_SSE2)
+		return CountBytesSse2(ptr, end, counts);
+#endif
+	CountBytesScalar(ptr, end, counts);
+}
+
 /**
  * @brief Calculates statistics from given buffer.
  * This function calculates EOL byte and zero-byte statistics from given
@@ -59,6 +286,18 @@ static void TextScan(FileTextStats & stats, const char *ptr, const char *end, bo
 			++stats.ncrs;
 		}
 	}
+	if (s_simdLevel != ByteComparator::SIMD_NONE)
+	{
+		ByteCounts counts = {};
+		CountBytes(ptr, end, counts);
+		stats.nzeros += static_cast<int>(counts.zeros);
+		stats.ncrlfs += static_cast<int>(counts.crlfs);
+		stats.nlfs += static_cast<int>(counts.lfs - counts.crlfs);
+		// A CR ending the buffer but not the file is counted when the next buffer is scanned
+		const bool pendingCr = !eof && ptr < end && end[-1] == '\r';
+		stats.ncrs += static_cast<int>(counts.crs - counts.crlfs - (pendingCr ? 1 : 0));
+		return;
+	}
 	for (; ptr < end; ++ptr)
 	{
 		char ch = *ptr;
@@ -129,6 +368,49 @@ ByteComparator::ByteComparator(const QuickCompareOptions * options)
 		m_ignore_all_space = true;
 	else
 		m_ignore_all_space = false;
+
+	m_bytewise = !m_ignore_case && !m_ignore_eol_diff && !m_ignore_blank_lines &&
+		!m_ignore_numbers && !m_ignore_space_change && !m_ignore_all_space;
+}
+
+/**
+ * @brief Returns instruction set used by the compare kernels.
+ */
+ByteComparator::SIMD_LEVEL ByteComparator::GetSimdLevel()
+{
+	return s_simdLevel;
+}
+
+/**
+ * @brief Selects instruction set used by the compare kernels.
+ * The level is limited to what the CPU supports. Meant for tests and
+ * benchmarks, don't call while compare threads are running.
+ * @param [in] level Requested instruction set.
+ * @return Previous instruction set.
+ */
+ByteComparator::SIMD_LEVEL ByteComparator::SetSimdLevel(SIMD_LEVEL level)
+{
+	SIMD_LEVEL prev = s_simdLevel;
+	s_simdLevel = (level < s_supportedSimdLevel) ? level : s_supportedSimdLevel;
+	return prev;
+}
+
+/**
+ * @brief Returns length of the common prefix of two buffers.
+ * @param [in] ptr0 Pointer to the first buffer.
+ * @param [in] ptr1 Pointer to the second buffer.
+ * @param [in] len Number of bytes to compare.
+ * @return Offset of the first differing byte, or @p len if buffers are identical.
+ */
+size_t ByteComparator::FindMismatch(const char *ptr0, const char *ptr1, size_t len)
+{
+#ifdef BYTECOMPARATOR_X86
+	if (s_simdLevel == SIMD_AVX2)
+		return FindMismatchAvx2(ptr0, ptr1, len);
+	if (s_simdLevel == SIMD_SSE2)
+		return FindMismatchSse2(ptr0, ptr1, len);
+#endif
+	return FindMismatchScalar(ptr0, ptr1, len);
 }
 
 static const char* SkipBlankLines(const char* p, const char* end)
@@ -381,6 +663,19 @@ ByteComparator::COMP_RESULT ByteComparator::CompareBuffers(
 			}
 		}
 
+		if (m_bytewise && s_simdLevel != SIMD_NONE)
+		{
+			// Skip the common prefix with the vector kernel
+			const size_t len = FindMismatch(ptr0, ptr1, (std::min)(end0 - ptr0, end1 - ptr1));
+			if (len > 0)
+			{
+				ptr0 += len;
+				ptr1 += len;
+				m_bol0 = iseolch(ptr0[-1]);
+				m_bol1 = iseolch(ptr1[-1]);
+			}
+		}
+
 		if (ptr0 == end0 || ptr1 == end1)
 		{
 			if (ptr0 == end0 && ptr1 == end1)
@@ -5,6 +5,7 @@
  */
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 class QuickCompareOptions;
@@ -38,6 +39,18 @@ public:
 		NEED_MORE_BOTH, /**< Both buffers need more data */
 	} COMP_RESULT;
 
+	/** @brief Instruction sets for the byte-exact compare and text scan kernels. */
+	enum SIMD_LEVEL
+	{
+		SIMD_NONE, /**< Portable scalar code */
+		SIMD_SSE2, /**< 128-bit SSE2 */
+		SIMD_AVX2, /**< 256-bit AVX2 */
+	};
+
+	static SIMD_LEVEL GetSimdLevel();
+	static SIMD_LEVEL SetSimdLevel(SIMD_LEVEL level);
+	static size_t FindMismatch(const char *ptr0, const char *ptr1, size_t len);
+
 	COMP_RESULT CompareBuffers(FileTextStats & stats0, FileTextStats & stats1,
 			const char* &ptr0, const char* &ptr1, const char* end0, const char* end1,
 			bool eof0, bool eof1, int64_t offset0, int64_t offset1);
@@ -54,6 +67,7 @@ private:
 	bool m_ignore_all_space; /**< Ignore all whitespace changes */
 	bool m_ignore_eol_diff; /**< Ignore differences in EOL bytes */
 	bool m_ignore_blank_lines; /**< Ignore blank lines */
+	bool m_bytewise; /**< No ignore options, buffers must match byte per byte */
 	// state
 	bool m_wsflag; /**< ignore_space_change & in a whitespace area */
 	bool m_eol0; /**< 0-side has an eol */
@@ -16,6 +16,7 @@
 #include "diff.h"
 #include "ByteComparator.h"
 #include "DiffFileData.h"
+#include "ContentHashCache.h"
 
 namespace CompareEngines
 {
@@ -68,9 +69,12 @@ void ByteCompare::SetAbortable(const IAbortable * piAbortable)
 
 /**
  * @brief Compare two specified files, byte-by-byte
+ * @param [in] diffData Opened files to compare.
+ * @param [in,out] hashers If not nullptr, two hashers fed with all bytes read
+ *  from the files. Their digests are complete if the result has text flags.
  * @return DIFFCODE
  */
-int ByteCompare::CompareFiles(DiffFileData* diffData)
+int ByteCompare::CompareFiles(DiffFileData* diffData, ContentHashCache::Hasher *hashers)
 {
 	diffData->m_textStats[0].clear();
 	diffData->m_textStats[1].clear();
@@ -115,19 +119,21 @@ int ByteCompare::CompareFiles(DiffFileData* diffData)
 		// load or update buffers as appropriate
 		for (i = 0; i < 2; ++i)
 		{
-			if (!eof[i] && bfstart[i] == sizeof(buff[i])/sizeof(buff[i][0]))
+			if (!eof[i] && bfstart[i] == WMCMPBUFF)
 			{
 				bfstart[i] = bfend[i] = 0;
 			}
-			if (!eof[i] && bfend[i] < sizeof(buff[i])/sizeof(buff[i][0]) - 1)
+			if (!eof[i] && bfend[i] < WMCMPBUFF - 1)
 			{
 				// Assume our blocks are in range of int
-				int space = sizeof(buff[i])/sizeof(buff[i][0]) - (int) bfend[i];
+				int space = WMCMPBUFF - (int) bfend[i];
 				int rtn = cio::read_i(diffData->m_inf[i].desc, &buff[i][bfend[i]], space);
 				if (rtn == -1)
 					return DIFFCODE::CMPERR;
 				if (rtn < space)
 					eof[i] = true;
+				if (hashers != nullptr && rtn > 0)
+					hashers[i].Update(&buff[i][bfend[i]], rtn);
 				bfend[i] += rtn;
 				if (m_pOptions->m_bIgnoreMissingTrailingEol)
 				{
@@ -148,6 +154,8 @@ int ByteCompare::CompareFiles(DiffFileData* diffData)
 					lasteol[1] = lasteol[0];
 					diffData->m_FileLocation[1] = diffData->m_FileLocation[0];
 					memcpy(&buff[1][bfend[1] - rtn], &buff[0][bfend[0] - rtn], rtn);
+					if (hashers != nullptr && rtn > 0)
+						hashers[1].Update(&buff[1][bfend[1] - rtn], rtn);
 					break;
 				}
 			}
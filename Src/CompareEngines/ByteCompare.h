@@ -7,6 +7,7 @@
 
 #include <memory>
 #include "FileTextStats.h"
+#include "ContentHashCache.h"
 
 class CompareOptions;
 class QuickCompareOptions;
@@ -31,7 +32,7 @@ public:
 	void SetAdditionalOptions(bool stopAfterFirstDiff);
 	void SetAbortable(const IAbortable * piAbortable);
 
-	int CompareFiles(DiffFileData* diffData);
+	int CompareFiles(DiffFileData* diffData, ContentHashCache::Hasher *hashers = nullptr);
 
 private:
 	std::unique_ptr<QuickCompareOptions> m_pOptions; /**< Compare options for diffutils. */
@@ -82,6 +82,16 @@ void DiffUtils::ClearSubstitutionList()
 	m_pDiffWrapper->SetSubstitutionList(nullptr);
 }
 
+/**
+ * @brief Set the paths of the compared files.
+ * Only their number matters: the pairs of a 3-way compare are never
+ * streamed, their lines are read again to merge their changes.
+ */
+void DiffUtils::SetPaths(const PathContext& files)
+{
+	m_pDiffWrapper->SetPaths(files, false);
+}
+
 void DiffUtils::SetCodepage(int codepage)
 {
 	m_pDiffWrapper->SetCodepage(codepage);
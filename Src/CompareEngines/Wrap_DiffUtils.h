@@ -13,6 +13,7 @@ class CompareOptions;
 struct FileTextStats;
 class CDiffWrapper;
 struct DiffFileData;
+class PathContext;
 
 namespace CompareEngines
 {
@@ -37,6 +38,7 @@ public:
 	void ClearFilterList();
 	void SetSubstitutionList(std::shared_ptr<SubstitutionList> plist);
 	void ClearSubstitutionList();
+	void SetPaths(const PathContext& files);
 
 	int CompareFiles(DiffFileData* diffData);
 	bool Diff2Files(struct change ** diffs, DiffFileData *diffData,
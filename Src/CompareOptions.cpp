@@ -117,6 +117,9 @@ void DiffutilsOptions::SetFromDiffOptions(const DIFFOPTIONS & options)
 	case 4:
 		m_diffAlgorithm = DIFF_ALGORITHM_NONE;
 		break;
+	case 5:
+		m_diffAlgorithm = DIFF_ALGORITHM_STREAMING;
+		break;
 	default:
 		throw "Unknown diff algorithm value!";
 	}
@@ -33,6 +33,7 @@ enum DiffAlgorithm
 	DIFF_ALGORITHM_PATIENCE = 2,
 	DIFF_ALGORITHM_HISTOGRAM = 3,
 	DIFF_ALGORITHM_NONE = 4,
+	DIFF_ALGORITHM_STREAMING = 5,
 };
 
 /**
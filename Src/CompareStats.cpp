@@ -17,6 +17,7 @@ CompareStats::CompareStats(int nDirs)
 , m_nComparedItems(0)
 , m_state(STATE_IDLE)
 , m_bCompareDone(false)
+, m_bCollectDone(false)
 , m_nDirs(nDirs)
 , m_counts()
 , m_nIdleCompareThreadCount(0)
@@ -82,6 +83,7 @@ void CompareStats::Reset()
 	m_nTotalItems = 0;
 	m_nComparedItems = 0;
 	m_bCompareDone = false;
+	m_bCollectDone = false;
 	m_rgThreadState.clear();
 }
 
@@ -93,7 +95,10 @@ void CompareStats::SetCompareState(CompareStats::CMP_STATE state)
 {
 	// New compare starting so reset ready status
 	if (state == STATE_START)
+	{
 		m_bCompareDone = false;
+		m_bCollectDone = false;
+	}
 	// Compare ready
 	if (state == STATE_IDLE && m_state == STATE_COMPARE)
 		m_bCompareDone = true;
@@ -107,6 +107,9 @@ public:
 	void SetCompareState(CompareStats::CMP_STATE state);
 	CompareStats::CMP_STATE GetCompareState() const;
 	bool IsCompareDone() const { return m_bCompareDone; }
+	/** @brief Set when all items have been collected; until then GetTotalItems() still grows. */
+	void SetCollectDone(bool bCollectDone) { m_bCollectDone = bCollectDone; }
+	bool IsCollectDone() const { return m_bCollectDone; }
 	CompareStats::RESULT GetResultFromCode(unsigned diffcode) const;
 	void Swap(int idx1, int idx2);
 	int GetCompareDirs() const { return m_nDirs; }
@@ -117,6 +120,7 @@ private:
 	std::atomic_int m_nComparedItems; /**< Compared items so far */
 	CMP_STATE m_state; /**< State for compare (idle, collect, compare,..) */
 	bool m_bCompareDone; /**< Have we finished last compare? */
+	std::atomic_bool m_bCollectDone; /**< Have all items to compare been collected? */
 	int m_nDirs; /**< number of directories to compare */
 	struct ThreadState
 	{
@@ -0,0 +1,493 @@
+/**
+ * @file  ContentHashCache.cpp
+ *
+ * @brief Implementation of ContentHashCache class.
+ */
+
+#include "pch.h"
+#include "ContentHashCache.h"
+#include <cstring>
+#include <algorithm>
+#include <Poco/SharedMemory.h>
+#include "DirItem.h"
+#include "IAbortable.h"
+#include "TFile.h"
+#include "cio.h"
+#include "unicoder.h"
+
+#ifdef _WIN64
+#include <windows.h>
+#include <bcrypt.h>
+#pragma comment(lib, "bcrypt.lib")
+
+/** @brief SHA-256 provider shared by all hashers. */
+static BCRYPT_ALG_HANDLE GetSha256Algorithm()
+{
+	static BCRYPT_ALG_HANDLE hAlg = []
+	{
+		BCRYPT_ALG_HANDLE h = nullptr;
+		if (BCryptOpenAlgorithmProvider(&h, BCRYPT_SHA256_ALGORITHM, nullptr, 0) != 0)
+			h = nullptr;
+		return h;
+	}();
+	return hAlg;
+}
+#endif
+
+/** @brief Identifies the cache file format, change when Record changes. */
+static const char CacheMagic[8] = { 'W', 'M', 'H', 'A', 'S', 'H', '0', '1' };
+
+/** @brief Files modified less than this before Load() are not stored. */
+static const Poco::Timestamp::TimeDiff RacyMargin = 2 * Poco::Timestamp::resolution();
+
+/** @brief Read buffer size used by HashFile(). */
+static const int HashBufferSize = 256 * 1024;
+
+struct CacheHeader
+{
+	char magic[8];
+	uint32_t recordSize;
+	uint32_t reserved[5];
+};
+
+struct ContentHashCache::Record
+{
+	Key key; /**< Digest of the file path */
+	int64_t size; /**< File size */
+	int64_t mtime; /**< Modification time in microseconds since the epoch */
+	int64_t ctime; /**< Creation time in microseconds since the epoch */
+	uint8_t digest[32]; /**< SHA-256 of the file content */
+	int32_t stats[4]; /**< ncrs, nlfs, ncrlfs and nzeros of the file content */
+	uint64_t check; /**< Check value of the fields above */
+};
+
+static_assert(sizeof(CacheHeader) == 32, "CacheHeader must be packed");
+
+/**
+ * @brief FNV-1a hash used as record check value.
+ */
+static uint64_t CheckValue(const void *data, size_t len)
+{
+	const unsigned char *p = static_cast<const unsigned char *>(data);
+	uint64_t h = 14695981039346656037ULL;
+	for (size_t i = 0; i < len; ++i)
+		h = (h ^ p[i]) * 1099511628211ULL;
+	return h;
+}
+
+static bool IsValidRecord(const void *rec, size_t size, uint64_t check)
+{
+	return CheckValue(rec, size - sizeof(uint64_t)) == check;
+}
+
+ContentHashCache::Hasher::Hasher()
+: m_hHash(nullptr)
+, m_sha(Poco::SHA2Engine::SHA_256)
+, m_cr(false)
+{
+#ifdef _WIN64
+	BCRYPT_ALG_HANDLE hAlg = GetSha256Algorithm();
+	BCRYPT_HASH_HANDLE hHash = nullptr;
+	if (hAlg != nullptr && BCryptCreateHash(hAlg, &hHash, nullptr, 0, nullptr, 0, 0) == 0)
+		m_hHash = hHash;
+#endif
+}
+
+ContentHashCache::Hasher::~Hasher()
+{
+#ifdef _WIN64
+	if (m_hHash != nullptr)
+		BCryptDestroyHash(m_hHash);
+#endif
+}
+
+/**
+ * @brief Add next block of file content.
+ */
+void ContentHashCache::Hasher::Update(const void *data, size_t len)
+{
+#ifdef _WIN64
+	if (m_hHash != nullptr)
+		BCryptHashData(m_hHash, static_cast<PUCHAR>(const_cast<void *>(data)), static_cast<ULONG>(len), 0);
+	else
+#endif
+		m_sha.update(data, static_cast<unsigned>(len));
+	const char *ptr = static_cast<const char *>(data);
+	const char *end = ptr + len;
+	if (m_cr && ptr < end)
+	{
+		if (*ptr == '\n')
+		{
+			++m_stats.ncrlfs;
+			++ptr;
+		}
+		else
+		{
+			++m_stats.ncrs;
+		}
+		m_cr = false;
+	}
+	for (; ptr < end; ++ptr)
+	{
+		const char ch = *ptr;
+		if (ch == 0)
+			++m_stats.nzeros;
+		else if (ch == '\n')
+			++m_stats.nlfs;
+		else if (ch == '\r')
+		{
+			if (ptr + 1 == end)
+				m_cr = true;
+			else if (ptr[1] == '\n')
+			{
+				++m_stats.ncrlfs;
+				++ptr;
+			}
+			else
+				++m_stats.ncrs;
+		}
+	}
+}
+
+/**
+ * @brief Finish the digest after all content is added.
+ */
+void ContentHashCache::Hasher::Finish(Entry& entry)
+{
+	if (m_cr)
+	{
+		++m_stats.ncrs;
+		m_cr = false;
+	}
+#ifdef _WIN64
+	if (m_hHash != nullptr)
+	{
+		BCryptFinishHash(m_hHash, entry.digest, sizeof(entry.digest), 0);
+		BCryptDestroyHash(m_hHash);
+		m_hHash = nullptr;
+	}
+	else
+#endif
+	{
+		const Poco::DigestEngine::Digest& digest = m_sha.digest();
+		std::copy_n(digest.begin(), (std::min)(digest.size(), sizeof(entry.digest)), entry.digest);
+	}
+	entry.stats = m_stats;
+	m_stats.clear();
+}
+
+/**
+ * @brief Constructor.
+ * @param [in] filepath Path of the cache file.
+ * @param [in] nMaxSize Size limit of the cache file in bytes.
+ */
+ContentHashCache::ContentHashCache(const String& filepath, int64_t nMaxSize)
+: m_filepath(filepath)
+, m_nMaxSize((std::max)(nMaxSize, static_cast<int64_t>(sizeof(CacheHeader) + 64 * sizeof(Record))))
+, m_pRecords(nullptr)
+, m_nRecords(0)
+, m_nHits(0)
+, m_nMisses(0)
+{
+}
+
+ContentHashCache::~ContentHashCache() = default;
+
+/**
+ * @brief Map the cache file and index its records.
+ * Must be called before a compare starts using the cache.
+ * @return false if there is no valid cache file (the cache starts empty).
+ */
+bool ContentHashCache::Load()
+{
+	Poco::FastMutex::ScopedLock lock(m_mutex);
+	m_loadTime.update();
+	m_pMapping.reset();
+	m_pRecords = nullptr;
+	m_nRecords = 0;
+	m_index.clear();
+	m_stored.clear();
+	m_used.clear();
+	m_nHits = m_nMisses = 0;
+
+	try
+	{
+		TFile file(m_filepath);
+		if (!file.exists() || file.getSize() < sizeof(CacheHeader))
+			return false;
+		m_pMapping.reset(new Poco::SharedMemory(file, Poco::SharedMemory::AM_READ));
+	}
+	catch (...)
+	{
+		m_pMapping.reset();
+		return false;
+	}
+
+	const char *begin = m_pMapping->begin();
+	const size_t size = m_pMapping->end() - begin;
+	const CacheHeader *header = reinterpret_cast<const CacheHeader *>(begin);
+	if (size < sizeof(CacheHeader) ||
+		memcmp(header->magic, CacheMagic, sizeof(CacheMagic)) != 0 ||
+		header->recordSize != sizeof(Record))
+	{
+		m_pMapping.reset();
+		return false;
+	}
+
+	m_pRecords = reinterpret_cast<const Record *>(begin + sizeof(CacheHeader));
+	m_nRecords = (size - sizeof(CacheHeader)) / sizeof(Record);
+	m_used.assign(m_nRecords, false);
+	m_index.reserve(m_nRecords);
+	for (size_t i = 0; i < m_nRecords; ++i)
+	{
+		if (IsValidRecord(&m_pRecords[i], sizeof(Record), m_pRecords[i].check))
+			m_index[m_pRecords[i].key] = i;
+	}
+	return true;
+}
+
+/**
+ * @brief Write records stored since Load() to the cache file.
+ * Appends the records, or rewrites the file when it would exceed the size
+ * limit. Releases the mapping, Load() must be called again to reuse the cache.
+ * @return false if writing the cache file failed.
+ */
+bool ContentHashCache::Save()
+{
+	Poco::FastMutex::ScopedLock lock(m_mutex);
+	if (m_stored.empty())
+	{
+		m_pMapping.reset();
+		m_pRecords = nullptr;
+		m_nRecords = 0;
+		m_index.clear();
+		m_used.clear();
+		return true;
+	}
+
+	const size_t mappedSize = m_pMapping ? m_pMapping->end() - m_pMapping->begin() : 0;
+	const int64_t newSize = static_cast<int64_t>(sizeof(CacheHeader) + (m_nRecords + m_stored.size()) * sizeof(Record));
+	if (!m_pMapping || (mappedSize - sizeof(CacheHeader)) % sizeof(Record) != 0 || newSize > m_nMaxSize)
+		return Rewrite();
+
+	std::vector<Record> records;
+	records.reserve(m_stored.size());
+	for (const auto& stored : m_stored)
+		records.push_back(*stored.second);
+	m_pMapping.reset();
+	m_pRecords = nullptr;
+	m_nRecords = 0;
+	m_index.clear();
+	m_used.clear();
+	m_stored.clear();
+
+	int fd = -1;
+	cio::tsopen_s(&fd, m_filepath, O_BINARY | O_WRONLY | O_APPEND, _SH_DENYNO, _S_IREAD | _S_IWRITE);
+	if (fd == -1)
+		return false;
+	const size_t len = records.size() * sizeof(Record);
+	const bool bSuccess = static_cast<size_t>(cio::write(fd, records.data(), len)) == len;
+	cio::close(fd);
+	return bSuccess;
+}
+
+/**
+ * @brief Rewrite the cache file keeping the records most likely to be hit.
+ * Records stored or hit since Load() are kept first, then the most recently
+ * written other records, up to 3/4 of the size limit so that the following
+ * compares can append again.
+ */
+bool ContentHashCache::Rewrite()
+{
+	const size_t nMaxRecords = static_cast<size_t>((m_nMaxSize * 3 / 4 - static_cast<int64_t>(sizeof(CacheHeader))) / static_cast<int64_t>(sizeof(Record)));
+	std::vector<Record> records;
+	records.reserve((std::min)(nMaxRecords, m_stored.size() + m_index.size()));
+	for (const auto& stored : m_stored)
+	{
+		if (records.size() < nMaxRecords)
+			records.push_back(*stored.second);
+	}
+	std::vector<size_t> unused;
+	for (const auto& indexed : m_index)
+	{
+		if (m_stored.find(indexed.first) != m_stored.end())
+			continue;
+		if (!m_used[indexed.second])
+			unused.push_back(indexed.second);
+		else if (records.size() < nMaxRecords)
+			records.push_back(m_pRecords[indexed.second]);
+	}
+	std::sort(unused.begin(), unused.end(), std::greater<size_t>());
+	for (size_t i = 0; i < unused.size() && records.size() < nMaxRecords; ++i)
+		records.push_back(m_pRecords[unused[i]]);
+
+	m_pMapping.reset();
+	m_pRecords = nullptr;
+	m_nRecords = 0;
+	m_index.clear();
+	m_used.clear();
+	m_stored.clear();
+
+	CacheHeader header{};
+	memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+	header.recordSize = sizeof(Record);
+
+	const String tmpPath = m_filepath + _T(".tmp");
+	int fd = -1;
+	cio::tsopen_s(&fd, tmpPath, O_BINARY | O_WRONLY | O_CREAT | O_TRUNC, _SH_DENYNO, _S_IREAD | _S_IWRITE);
+	if (fd == -1)
+		return false;
+	const size_t len = records.size() * sizeof(Record);
+	bool bSuccess = static_cast<size_t>(cio::write(fd, &header, sizeof(header))) == sizeof(header) &&
+		(len == 0 || static_cast<size_t>(cio::write(fd, records.data(), len)) == len);
+	cio::close(fd);
+	try
+	{
+		TFile file(tmpPath);
+		if (bSuccess)
+			file.renameTo(m_filepath);
+		else
+			file.remove();
+	}
+	catch (...)
+	{
+		bSuccess = false;
+	}
+	return bSuccess;
+}
+
+/**
+ * @brief Find the cached content of a file.
+ * @param [in] filepath Full path of the file.
+ * @param [in] item Size and times of the file from the folder scan.
+ * @param [out] entry Cached content digest and statistics.
+ * @return true if the file has a record with the same size and times.
+ */
+bool ContentHashCache::Lookup(const String& filepath, const DirItem& item, Entry& entry)
+{
+	if (item.size == DirItem::FILE_SIZE_NONE)
+		return false;
+	const Key key = MakeKey(filepath);
+	Poco::FastMutex::ScopedLock lock(m_mutex);
+	const Record *rec = nullptr;
+	size_t index = SIZE_MAX;
+	auto itStored = m_stored.find(key);
+	if (itStored != m_stored.end())
+	{
+		rec = itStored->second.get();
+	}
+	else
+	{
+		auto it = m_index.find(key);
+		if (it != m_index.end())
+		{
+			index = it->second;
+			rec = &m_pRecords[index];
+		}
+	}
+	if (rec == nullptr ||
+		rec->size != static_cast<int64_t>(item.size) ||
+		rec->mtime != item.mtime.epochMicroseconds() ||
+		rec->ctime != item.ctime.epochMicroseconds())
+	{
+		++m_nMisses;
+		return false;
+	}
+	if (index != SIZE_MAX)
+		m_used[index] = true;
+	memcpy(entry.digest, rec->digest, sizeof(entry.digest));
+	entry.stats.ncrs = rec->stats[0];
+	entry.stats.nlfs = rec->stats[1];
+	entry.stats.ncrlfs = rec->stats[2];
+	entry.stats.nzeros = rec->stats[3];
+	++m_nHits;
+	return true;
+}
+
+/**
+ * @brief Record the content of a file read to the end.
+ * Files modified within a couple of seconds before Load() are not recorded,
+ * as they may change again without changing the stamp seen by the scan.
+ * @param [in] filepath Full path of the file.
+ * @param [in] item Size and times of the file from the folder scan.
+ * @param [in] entry Content digest and statistics of the file.
+ * @return true if the record was stored.
+ */
+bool ContentHashCache::Store(const String& filepath, const DirItem& item, const Entry& entry)
+{
+	if (item.size == DirItem::FILE_SIZE_NONE || item.mtime >= m_loadTime - RacyMargin)
+		return false;
+	std::unique_ptr<Record> rec(new Record);
+	MakeRecord(*rec, MakeKey(filepath), item, entry);
+	Poco::FastMutex::ScopedLock lock(m_mutex);
+	m_stored[rec->key] = std::move(rec);
+	return true;
+}
+
+/**
+ * @brief Compute the content digest and statistics of a file.
+ * @return false if the file couldn't be read or the compare was aborted.
+ */
+bool ContentHashCache::HashFile(const String& filepath, Entry& entry, IAbortable *piAbortable)
+{
+	int fd = -1;
+	cio::tsopen_s(&fd, filepath, O_BINARY | O_RDONLY, _SH_DENYNO, _S_IREAD);
+	if (fd == -1)
+		return false;
+	std::unique_ptr<char[]> buf(new char[HashBufferSize]);
+	Hasher hasher;
+	bool bSuccess = true;
+	for (;;)
+	{
+		if (piAbortable != nullptr && piAbortable->ShouldAbort())
+		{
+			bSuccess = false;
+			break;
+		}
+		const int size = cio::read_i(fd, buf.get(), HashBufferSize);
+		if (size <= 0)
+		{
+			bSuccess = (size == 0);
+			break;
+		}
+		hasher.Update(buf.get(), size);
+	}
+	cio::close(fd);
+	if (bSuccess)
+		hasher.Finish(entry);
+	return bSuccess;
+}
+
+/**
+ * @brief Digest of the file path used as record key.
+ * Paths are case-insensitive on Windows, so they are lowercased there.
+ */
+ContentHashCache::Key ContentHashCache::MakeKey(const String& filepath)
+{
+#ifdef _WIN32
+	const std::string path = ucr::toUTF8(strutils::makelower(filepath));
+#else
+	const std::string path = ucr::toUTF8(filepath);
+#endif
+	Poco::SHA2Engine sha(Poco::SHA2Engine::SHA_256);
+	sha.update(path);
+	const Poco::DigestEngine::Digest& digest = sha.digest();
+	Key key;
+	memcpy(key.h, digest.data(), sizeof(key.h));
+	return key;
+}
+
+void ContentHashCache::MakeRecord(Record& rec, const Key& key, const DirItem& item, const Entry& entry)
+{
+	memset(&rec, 0, sizeof(rec));
+	rec.key = key;
+	rec.size = item.size;
+	rec.mtime = item.mtime.epochMicroseconds();
+	rec.ctime = item.ctime.epochMicroseconds();
+	memcpy(rec.digest, entry.digest, sizeof(rec.digest));
+	rec.stats[0] = entry.stats.ncrs;
+	rec.stats[1] = entry.stats.nlfs;
+	rec.stats[2] = entry.stats.ncrlfs;
+	rec.stats[3] = entry.stats.nzeros;
+	rec.check = CheckValue(&rec, sizeof(Record) - sizeof(uint64_t));
+}
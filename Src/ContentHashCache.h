@@ -0,0 +1,112 @@
+/**
+ * @file  ContentHashCache.h
+ *
+ * @brief Declaration of ContentHashCache class.
+ */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <Poco/Mutex.h>
+#include <Poco/SHA2Engine.h>
+#include <Poco/Timestamp.h>
+#include "UnicodeString.h"
+#include "FileTextStats.h"
+
+struct DirItem;
+class IAbortable;
+namespace Poco { class SharedMemory; }
+
+/**
+ * @brief Persistent cache of file content digests for folder compare.
+ *
+ * Records a SHA-256 digest and the EOL/zero-byte statistics of every file
+ * read to the end by a content compare, keyed by the file path and stamped
+ * with the size, modification time and creation time seen by the folder
+ * scan. A later compare whose files carry the same stamps can decide SAME
+ * (and, for byte-exact compare methods, DIFF) from the digests without
+ * opening the files.
+ *
+ * The cache file is a header followed by fixed size records. It is mapped
+ * read-only by Load(); Save() appends the records stored during the compare,
+ * or rewrites the file when it would grow beyond the size limit. A record
+ * written later replaces an earlier one for the same path, and records
+ * whose check value doesn't match (e.g. torn writes) are ignored.
+ *
+ * Lookup() and Store() may be called from several compare threads.
+ */
+class ContentHashCache
+{
+public:
+	/** @brief Cached information about the content of one file. */
+	struct Entry
+	{
+		uint8_t digest[32]; /**< SHA-256 of the file content */
+		FileTextStats stats; /**< EOL and zero-byte counts of the file content */
+	};
+
+	/**
+	 * @brief Computes an Entry from file content fed in consecutive blocks.
+	 * Uses the CNG SHA-256 provider where available, which is several
+	 * times faster than Poco::SHA2Engine on CPUs with SHA extensions.
+	 */
+	class Hasher
+	{
+	public:
+		Hasher();
+		Hasher(const Hasher&) = delete;
+		~Hasher();
+		void Update(const void *data, size_t len);
+		void Finish(Entry& entry);
+	private:
+		void *m_hHash; /**< CNG hash handle, or nullptr to use m_sha */
+		Poco::SHA2Engine m_sha;
+		FileTextStats m_stats;
+		bool m_cr; /**< Did the previous block end with CR? */
+	};
+
+	ContentHashCache(const String& filepath, int64_t nMaxSize);
+	~ContentHashCache();
+
+	bool Load();
+	bool Save();
+
+	bool Lookup(const String& filepath, const DirItem& item, Entry& entry);
+	bool Store(const String& filepath, const DirItem& item, const Entry& entry);
+
+	static bool HashFile(const String& filepath, Entry& entry, IAbortable *piAbortable);
+
+	int GetHitCount() const { return m_nHits; }
+	int GetMissCount() const { return m_nMisses; }
+
+private:
+	struct Key
+	{
+		uint64_t h[2];
+		bool operator==(const Key& other) const { return h[0] == other.h[0] && h[1] == other.h[1]; }
+	};
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const { return static_cast<size_t>(key.h[0]); }
+	};
+	struct Record;
+
+	static Key MakeKey(const String& filepath);
+	static void MakeRecord(Record& rec, const Key& key, const DirItem& item, const Entry& entry);
+	bool Rewrite();
+
+	String m_filepath; /**< Path of the cache file */
+	int64_t m_nMaxSize; /**< Size limit of the cache file in bytes */
+	Poco::Timestamp m_loadTime; /**< Files modified after this (less a margin) are not stored */
+	std::unique_ptr<Poco::SharedMemory> m_pMapping; /**< Read-only view of the cache file */
+	const Record *m_pRecords; /**< Records in the mapped cache file */
+	size_t m_nRecords; /**< Number of records in the mapped cache file */
+	std::unordered_map<Key, size_t, KeyHash> m_index; /**< Key -> latest record index in the mapped file */
+	std::unordered_map<Key, std::unique_ptr<Record>, KeyHash> m_stored; /**< Records stored since Load() */
+	std::vector<bool> m_used; /**< Mapped records hit since Load() */
+	int m_nHits;
+	int m_nMisses;
+	Poco::FastMutex m_mutex;
+};
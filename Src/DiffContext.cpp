@@ -20,6 +20,7 @@
 #include "DiffWrapper.h"
 #include "FilterEngine/FilterExpression.h"
 #include "RenameMoveDetection.h"
+#include "ContentHashCache.h"
 #include "DebugNew.h"
 
 using Poco::FastMutex;
@@ -56,6 +57,9 @@ CDiffContext::CDiffContext(const PathContext & paths, int compareMethod)
 , m_iGuessEncodingType(0)
 , m_nQuickCompareLimit(0)
 , m_nBinaryCompareLimit(0)
+, m_bBinaryCompareMemoryMapping(false)
+, m_nBinaryCompareSampleBlocks(0)
+, m_bBinaryCompareTrustSamples(false)
 , m_bTrustFileMetadata(true)
 , m_bEnableImageCompare(false)
 , m_pImgfileFilter(nullptr)
@@ -102,7 +106,7 @@ bool CDiffContext::UpdateInfoFromDiskHalf(DIFFITEM &di, int nIndex)
 	if (!dfi.Update(filepath))
 		return false;
 	UpdateVersion(di, nIndex);
-	dfi.encoding = codepage_detect::Guess(filepath, m_iGuessEncodingType);
+	dfi.GetEncodingRef() = codepage_detect::Guess(filepath, m_iGuessEncodingType);
 	return true;
 }
 
@@ -139,7 +143,7 @@ void CDiffContext::UpdateVersion(DIFFITEM &di, int nIndex) const
 	DiffFileInfo & dfi = di.diffFileInfo[nIndex];
 	if (!di.diffcode.exists(nIndex) || di.diffcode.isDirectory() || !CheckFileForVersion(paths::FindExtension(di.diffFileInfo[nIndex].filename)))
 	{
-		dfi.version.SetFileVersionNone();
+		dfi.GetVersionRef().SetFileVersionNone();
 		return;
 	}
 	
@@ -151,7 +155,7 @@ void CDiffContext::UpdateVersion(DIFFITEM &di, int nIndex) const
 	unsigned verMS = 0;
 	unsigned verLS = 0;
 	if (ver.GetFixedFileVersion(verMS, verLS))
-		dfi.version.SetFileVersion(verMS, verLS);
+		dfi.GetVersionRef().SetFileVersion(verMS, verLS);
 }
 
 /**
@@ -281,54 +285,87 @@ void CDiffContext::CreateDuplicateValueMap()
 	if (!m_pPropertySystem)
 		return;
 	const int nDirs = GetCompareDirs();
+	const size_t nProperties = m_pPropertySystem->GetCanonicalNames().size();
 	m_duplicateValues.clear();
-	m_duplicateValues.resize(m_pPropertySystem->GetCanonicalNames().size());
+	m_duplicateValues.resize(nProperties);
+
+	// The hash values are digests of the whole files, so the finder only
+	// compares them between files of the same size. Hash.XXH3 isn't
+	// computed by the folder compare: the finder reads only the files
+	// which share their size, and sets the value of those it reads whole
+	struct Occurrence
+	{
+		DigestKey value;
+		PropertyValues *pValues; /**< Values to set the digest in, if the finder reads the file */
+		int pane;
+		bool nonpaired;
+	};
+	std::vector<DuplicateFinder> finders(nProperties);
+	std::vector<std::vector<Occurrence>> occurrences(nProperties);
 	DIFFITEM *pos = GetFirstDiffPosition();
-	std::vector<int> currentGroupId(m_duplicateValues.size());
 	while (pos != nullptr)
 	{
 		const DIFFITEM& di = GetNextDiffPosition(pos);
+		PathContext tFiles;
 		for (int pane = 0; pane < nDirs; ++pane)
 		{
-			const PropertyValues* pValues = di.diffFileInfo[pane].m_pAdditionalProperties.get();
+			PropertyValues* pValues = di.diffFileInfo[pane].GetAdditionalProperties();
 			if (pValues)
 			{
-				for (size_t j = 0; j < pValues->GetSize(); ++j)
+				for (size_t j = 0; j < pValues->GetSize() && j < nProperties; ++j)
 				{
-					if (pValues->IsHashValue(j) )
+					if (m_pPropertySystem->IsDuplicateDigest(static_cast<unsigned>(j)))
+					{
+						if (di.diffcode.exists(pane) && !di.diffcode.isDirectory())
+						{
+							if (tFiles.GetSize() == 0)
+								GetComparePaths(di, tFiles);
+							finders[j].AddFile(tFiles[pane], static_cast<int64_t>(di.diffFileInfo[pane].size));
+							occurrences[j].push_back({ DigestKey(), pValues, pane, !di.diffcode.existAll() });
+						}
+					}
+					else if (pValues->IsHashValue(j) )
 					{
 						std::vector<uint8_t> value = pValues->GetHashValue(j);
 						if (!value.empty())
 						{
-							auto it = m_duplicateValues[j].find(value);
-							if (it == m_duplicateValues[j].end())
-							{
-								DuplicateInfo info{};
-								++info.count[pane];
-								info.nonpaired = !di.diffcode.existAll();
-								m_duplicateValues[j].insert_or_assign(value, info);
-							}
-							else
-							{
-								if (it->second.groupid == 0)
-								{
-									int count = 0;
-									for (int k = 0; k < nDirs; ++k)
-										count += it->second.count[k];
-									if (count > 0)
-									{
-										++currentGroupId[j];
-										it->second.groupid = currentGroupId[j];
-									}
-								}
-								++it->second.count[pane];
-								if (!it->second.nonpaired && !di.diffcode.existAll())
-									it->second.nonpaired = true;
-							}
+							finders[j].AddDigest(static_cast<int64_t>(di.diffFileInfo[pane].size), value.data(), value.size());
+							occurrences[j].push_back({ DigestKey(value), nullptr, pane, !di.diffcode.existAll() });
 						}
 					}
 				}
 			}
 		}
 	}
+
+	// Only the values shared by several files are kept
+	for (size_t j = 0; j < nProperties; ++j)
+	{
+		const int nGroups = finders[j].Find();
+		std::vector<uint8_t> digest;
+		for (size_t i = 0; i < occurrences[j].size(); ++i)
+		{
+			Occurrence& occurrence = occurrences[j][i];
+			if (occurrence.pValues == nullptr)
+				continue;
+			if (!finders[j].GetFullDigest(i, digest))
+				digest.clear();
+			occurrence.pValues->SetHashValue(j, digest);
+			occurrence.value = DigestKey(digest);
+		}
+		if (nGroups == 0)
+			continue;
+		for (size_t i = 0; i < occurrences[j].size(); ++i)
+		{
+			const int groupid = finders[j].GetGroup(i);
+			if (groupid == 0)
+				continue;
+			const Occurrence& occurrence = occurrences[j][i];
+			DuplicateInfo& info = m_duplicateValues[j][occurrence.value];
+			info.groupid = groupid;
+			++info.count[occurrence.pane];
+			if (occurrence.nonpaired)
+				info.nonpaired = true;
+		}
+	}
 }
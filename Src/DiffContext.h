@@ -13,6 +13,7 @@
 #include "FilterList.h"
 #include "SubstitutionList.h"
 #include "PropertySystem.h"
+#include "DuplicateFinder.h"
 
 class PackingInfo;
 class PrediffingInfo;
@@ -22,6 +23,7 @@ class IAbortable;
 class CDiffWrapper;
 class CompareOptions;
 class RenameMoveDetection;
+class ContentHashCache;
 struct FilterExpression;
 struct DIFFOPTIONS;
 
@@ -193,6 +195,28 @@ public:
 
 	int m_nBinaryCompareLimit;
 
+	/**
+	 * Memory-map files for binary compare.
+	 * Files of 1 MB or more are mapped window by window and compared in
+	 * place instead of being read into buffers.
+	 */
+	bool m_bBinaryCompareMemoryMapping;
+
+	/**
+	 * Blocks sampled by binary compare before reading whole files.
+	 * Files of equal size (16 MB or more) are first compared by their head,
+	 * tail and this many blocks between, 0 disables sampling.
+	 */
+	int m_nBinaryCompareSampleBlocks;
+
+	/**
+	 * Trust binary compare samples.
+	 * When set, files whose sampled blocks all match are reported identical
+	 * without reading them whole. Faster, but misses differences between
+	 * the samples.
+	 */
+	bool m_bBinaryCompareTrustSamples;
+
 	/**
 	 * Trust file metadata (timestamp + size) to skip content comparison.
 	 * When enabled, files with matching timestamps AND sizes are assumed
@@ -201,6 +225,14 @@ public:
 	 */
 	bool m_bTrustFileMetadata;
 
+	/**
+	 * Persistent cache of file content digests.
+	 * When set, quick and binary compares record the digests of the files
+	 * they read, and decide unchanged files from the recorded digests in
+	 * later compares without reading them.
+	 */
+	std::unique_ptr<ContentHashCache> m_pContentHashCache;
+
 	/**
 	 * Walk into unique folders and add contents.
 	 * This enables/disables walking into unique folders. If we don't walk into
@@ -221,7 +253,7 @@ public:
 	std::shared_ptr<FilterList> m_pFilterList; /**< Filter list for line filters */
 	std::shared_ptr<SubstitutionList> m_pSubstitutionList; /// list for Substitution Filters
 	std::unique_ptr<PropertySystem> m_pPropertySystem; /**< pointer to Property System */
-	std::vector<std::map<std::vector<uint8_t>, DuplicateInfo>> m_duplicateValues; /**< Number of duplicate hash values */
+	std::vector<DigestMap<DuplicateInfo>> m_duplicateValues; /**< Number of duplicate hash values, only the values of several files */
 	std::vector<String> m_vCurrentlyHiddenItems; /**< The list of currently hidden items */
 	std::unique_ptr<FilterExpression> m_pAdditionalCompareExpression; /** Additional compare condition applied in folder comparison */
 	std::unique_ptr<RenameMoveDetection> m_pRenameMoveDetection; /** Move detection object */
@@ -43,6 +43,47 @@ bool DiffFileData::OpenFiles(const String& szFilepath1, const String& szFilepath
 	return b;
 }
 
+/**
+ * @brief Let diffutils read side @p index from @p content instead of the file.
+ * @p content must stay unchanged until the files are closed. Several
+ * DiffFileData objects, also on different threads, may share the same content.
+ * Call after OpenFiles(), which still opens and stats the file.
+ */
+void DiffFileData::SetPreloadedContent(int index, const std::vector<char>& content)
+{
+	m_inf[index].preloaded = content.data();
+	m_inf[index].preloaded_size = content.size();
+	m_inf[index].preloaded_pos = 0;
+}
+
+/**
+ * @brief Read the whole content of a regular file.
+ * @param [in] maxSize Size from which the file isn't read.
+ * @return false if the file can't be read, isn't a regular file, or
+ * isn't smaller than @p maxSize.
+ */
+bool DiffFileData::ReadContent(const String& szFilepath, std::vector<char>& content, int64_t maxSize)
+{
+	int fd = -1;
+	cio::tsopen_s(&fd, szFilepath, O_RDONLY | O_BINARY, _SH_DENYNO, _S_IREAD);
+	if (fd < 0)
+		return false;
+	cio::stat st;
+	bool ok = cio::fstat(fd, &st) == 0 && (st.st_mode & S_IFMT) == S_IFREG && st.st_size < maxSize;
+	if (ok)
+	{
+		content.resize(static_cast<size_t>(st.st_size));
+		size_t pos = 0;
+		cio::ssize_t r = 0;
+		while (pos < content.size() && (r = cio::read(fd, content.data() + pos, content.size() - pos)) > 0)
+			pos += r;
+		content.resize(pos);
+		ok = r >= 0;
+	}
+	cio::close(fd);
+	return ok;
+}
+
 /** @brief stash away true names for display, before opening files */
 void DiffFileData::SetDisplayFilepaths(const String& szTrueFilepath1, const String& szTrueFilepath2)
 {
@@ -7,6 +7,8 @@
  */
 #pragma once
 
+#include <cstdint>
+#include <vector>
 #include "FileLocation.h"
 #include "FileTextStats.h"
 
@@ -29,6 +31,8 @@ struct DiffFileData
 	~DiffFileData();
 
 	bool OpenFiles(const String& szFilepath1, const String& szFilepath2);
+	void SetPreloadedContent(int index, const std::vector<char>& content);
+	static bool ReadContent(const String& szFilepath, std::vector<char>& content, int64_t maxSize = INT64_MAX);
 	void Reset();
 	void Close() { Reset(); }
 	void SetDisplayFilepaths(const String& szTrueFilepath1, const String& szTrueFilepath2);
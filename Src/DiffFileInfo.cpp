@@ -9,13 +9,84 @@
 #include "DiffFileInfo.h"
 #include "DebugNew.h"
 
+/** @brief Details of the files which have none. */
+static const DiffFileDetails EmptyDetails;
+
+DiffFileInfo::DiffFileInfo(DiffFileInfo&& other) noexcept
+: DirItem(std::move(other))
+, m_pDetails(other.m_pDetails.exchange(nullptr))
+{
+}
+
+DiffFileInfo& DiffFileInfo::operator=(DiffFileInfo&& other) noexcept
+{
+	if (this != &other)
+	{
+		DirItem::operator=(std::move(other));
+		delete m_pDetails.exchange(other.m_pDetails.exchange(nullptr));
+	}
+	return *this;
+}
+
+DiffFileInfo::~DiffFileInfo()
+{
+	delete m_pDetails.load(std::memory_order_relaxed);
+}
+
 /**
  * @brief Clears FileInfo data.
  */
 void DiffFileInfo::ClearPartial()
 {
 	DirItem::ClearPartial();
-	version.Clear();
-	encoding.Clear();
-	m_textStats.clear();
+	if (DiffFileDetails *pDetails = m_pDetails.load(std::memory_order_acquire))
+	{
+		pDetails->version.Clear();
+		pDetails->encoding.Clear();
+		pDetails->m_textStats.clear();
+	}
+}
+
+/**
+ * @brief Free the additional property values, the details are kept.
+ */
+void DiffFileInfo::ClearAdditionalProperties()
+{
+	if (DiffFileDetails *pDetails = m_pDetails.load(std::memory_order_acquire))
+		pDetails->m_pAdditionalProperties.reset();
+}
+
+/**
+ * @brief Copy the version, encoding and text stats of @p src, but not its
+ * additional property values.
+ */
+void DiffFileInfo::CopyDetails(const DiffFileInfo& src)
+{
+	if (!src.HasDetails() && !HasDetails())
+		return;
+	const DiffFileDetails& details = src.GetDetails();
+	DiffFileDetails& dst = GetDetailsRef();
+	dst.version = details.version;
+	dst.encoding = details.encoding;
+	dst.m_textStats = details.m_textStats;
+}
+
+const DiffFileDetails& DiffFileInfo::GetDetails() const
+{
+	const DiffFileDetails *pDetails = m_pDetails.load(std::memory_order_acquire);
+	return pDetails ? *pDetails : EmptyDetails;
+}
+
+DiffFileDetails& DiffFileInfo::GetDetailsRef()
+{
+	DiffFileDetails *pDetails = m_pDetails.load(std::memory_order_acquire);
+	if (pDetails == nullptr)
+	{
+		DiffFileDetails *pNew = new DiffFileDetails;
+		if (m_pDetails.compare_exchange_strong(pDetails, pNew, std::memory_order_acq_rel))
+			pDetails = pNew;
+		else
+			delete pNew; // Set by another thread meanwhile
+	}
+	return *pDetails;
 }
@@ -6,6 +6,7 @@
  */
 #pragma once
 
+#include <atomic>
 #include "DirItem.h"
 #include "FileVersion.h"
 #include "FileTextEncoding.h"
@@ -13,28 +14,59 @@
 #include "PropertySystem.h"
 
 /**
- * @brief Information for file.
- * This class expands DirItem class with encoding information and
- * text stats information.
- * @sa DirItem.
+ * @brief Information of a file which only some items have.
+ * It is allocated when one of its fields is first set, so the items
+ * compared by date or size, and the unused third side of a 2-way compare,
+ * don't carry it.
  */
-struct DiffFileInfo : public DirItem
+struct DiffFileDetails
 {
-// data
 	FileVersion version; /**< string of fixed file version, eg, 1.2.3.4 */
 	FileTextEncoding encoding; /**< unicode or codepage info */
 	FileTextStats m_textStats; /**< EOL, zero-byte etc counts */
 	std::unique_ptr<PropertyValues> m_pAdditionalProperties; /**< Additional Property values */
+};
 
-	// We could stash a pointer here to the parent DIFFITEM
-	// but, I ran into trouble with, I think, the DIFFITEM copy constructor
-
+/**
+ * @brief Information for file.
+ * This class expands DirItem class with encoding information and
+ * text stats information.
+ * The Get*() accessors return default values for a file without details,
+ * the Get*Ref() accessors allocate the details first.
+ * @sa DirItem.
+ */
+struct DiffFileInfo : public DirItem
+{
 // methods
 
-	DiffFileInfo() = default;
+	DiffFileInfo() : m_pDetails(nullptr) {}
+	DiffFileInfo(DiffFileInfo&& other) noexcept;
+	DiffFileInfo& operator=(DiffFileInfo&& other) noexcept;
+	~DiffFileInfo();
 	//void Clear();
 	void ClearPartial();
 	bool IsEditableEncoding() const;
+
+	bool HasDetails() const { return m_pDetails.load(std::memory_order_acquire) != nullptr; }
+	const FileVersion& GetVersion() const { return GetDetails().version; }
+	FileVersion& GetVersionRef() { return GetDetailsRef().version; }
+	const FileTextEncoding& GetEncoding() const { return GetDetails().encoding; }
+	FileTextEncoding& GetEncodingRef() { return GetDetailsRef().encoding; }
+	const FileTextStats& GetTextStats() const { return GetDetails().m_textStats; }
+	FileTextStats& GetTextStatsRef() { return GetDetailsRef().m_textStats; }
+	PropertyValues *GetAdditionalProperties() const { return GetDetails().m_pAdditionalProperties.get(); }
+	std::unique_ptr<PropertyValues>& GetAdditionalPropertiesRef() { return GetDetailsRef().m_pAdditionalProperties; }
+	void ClearAdditionalProperties();
+	void CopyDetails(const DiffFileInfo& src);
+
+private:
+	const DiffFileDetails& GetDetails() const;
+	DiffFileDetails& GetDetailsRef();
+
+// data
+	/** Details, or nullptr until one is set. Set once with a compare-exchange,
+	 * the version is read and set lazily from several threads. */
+	std::atomic<DiffFileDetails *> m_pDetails;
 };
 
 /**
@@ -42,5 +74,5 @@ struct DiffFileInfo : public DirItem
  */
 inline bool DiffFileInfo::IsEditableEncoding() const
 {
-	return !encoding.m_bom;
+	return !GetEncoding().m_bom;
 }
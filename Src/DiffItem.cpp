@@ -14,8 +14,9 @@ DIFFITEM DIFFITEM::emptyitem;
 /** @brief DIFFITEM's destructor */
 DIFFITEM::~DIFFITEM()
 {
-	RemoveChildren();
+	DeleteChildren();
 	assert(children == nullptr);
+	delete m_pFolderCounts.load(std::memory_order_relaxed);
 }
 
 /** @brief Return path to left/right file, including all but file name */
@@ -88,6 +89,24 @@ std::vector<const DIFFITEM*> DIFFITEM::GetAncestors() const
 
 /** @brief Remove and delete all children DIFFITEM entries */
 void DIFFITEM::RemoveChildren()
+{
+	FolderCounts *counts = m_pFolderCounts.load(std::memory_order_acquire);
+	if (counts != nullptr)
+	{
+		if (m_countedKind.load(std::memory_order_relaxed) != FolderCounts::FILTERED)
+		{
+			int delta[FolderCounts::KIND_COUNT] = {};
+			AddSubtreeCounts(delta, -1);
+			AddToAncestors(delta);
+		}
+		for (auto& count : counts->count)
+			count.store(0, std::memory_order_relaxed);
+	}
+	DeleteChildren();
+}
+
+/** @brief Delete all children, without updating the counts of the ancestors */
+void DIFFITEM::DeleteChildren()
 {
 	DIFFITEM *pRem = children;
 	while (pRem != nullptr)
@@ -116,7 +135,7 @@ void DIFFITEM::ClearAllAdditionalProperties()
 {
 	const int n = diffcode.isThreeway() ? 3 : 2;
 	for (int i = 0; i < n; ++i)
-		diffFileInfo[i].m_pAdditionalProperties.reset();
+		diffFileInfo[i].ClearAdditionalProperties();
 	if (HasChildren())
 	{
 		for (DIFFITEM *p = children; p != nullptr; p = p->Flink)
@@ -183,10 +202,21 @@ void DIFFITEM::AddChildToParent(DIFFITEM *p)
 	else
 		// More siblings
 		children->AppendSibling(p);
+
+	p->m_countedKind.store(FolderCounts::GetKind(p->diffcode), std::memory_order_relaxed);
+	int delta[FolderCounts::KIND_COUNT] = {};
+	p->AddContribution(delta, 1);
+	p->AddToAncestors(delta);
 }
 
 void DIFFITEM::DelinkFromSiblings()
 {
+	if (parent != nullptr)
+	{
+		int delta[FolderCounts::KIND_COUNT] = {};
+		AddContribution(delta, -1);
+		AddToAncestors(delta);
+	}
 	if (parent != nullptr && parent->children != nullptr)
 	{
 		// If `this` is at end of Sibling linkage, fix First Child's end link
@@ -210,6 +240,120 @@ void DIFFITEM::DelinkFromSiblings()
 	Flink = Blink = nullptr;
 }
 
+/**
+ * @brief Return the counts of the items below this folder item.
+ * The counts are all zero for a file item or an empty folder.
+ */
+const FolderCounts& DIFFITEM::GetFolderCounts() const
+{
+	static const FolderCounts emptyCounts;
+	const FolderCounts *counts = m_pFolderCounts.load(std::memory_order_acquire);
+	return counts != nullptr ? *counts : emptyCounts;
+}
+
+FolderCounts &DIFFITEM::GetFolderCountsRef()
+{
+	FolderCounts *counts = m_pFolderCounts.load(std::memory_order_acquire);
+	if (counts == nullptr)
+	{
+		FolderCounts *newCounts = new FolderCounts();
+		if (m_pFolderCounts.compare_exchange_strong(counts, newCounts, std::memory_order_acq_rel))
+			counts = newCounts;
+		else
+			delete newCounts;
+	}
+	return *counts;
+}
+
+/**
+ * @brief Update the counts of the ancestors after the result of this item changed.
+ * Call this after changing `diffcode` of an item in the tree. It may be
+ * called from several compare threads at once, for different items.
+ */
+void DIFFITEM::UpdateFolderCounts()
+{
+	const FolderCounts::Kind kind = FolderCounts::GetKind(diffcode);
+	const unsigned char oldKind = m_countedKind.load(std::memory_order_relaxed);
+	if (kind == oldKind)
+		return;
+	m_countedKind.store(kind, std::memory_order_relaxed);
+	int delta[FolderCounts::KIND_COUNT] = {};
+	--delta[oldKind];
+	++delta[kind];
+	// The items below a folder are counted only while it isn't filtered
+	if ((oldKind == FolderCounts::FILTERED) != (kind == FolderCounts::FILTERED))
+		AddSubtreeCounts(delta, kind == FolderCounts::FILTERED ? -1 : 1);
+	AddToAncestors(delta);
+}
+
+/**
+ * @brief Add what this item counts for in its ancestors to @p delta.
+ * That is its own kind, and the items below it unless it is filtered.
+ */
+void DIFFITEM::AddContribution(int delta[], int sign) const
+{
+	const unsigned char kind = m_countedKind.load(std::memory_order_relaxed);
+	delta[kind] += sign;
+	if (kind != FolderCounts::FILTERED)
+		AddSubtreeCounts(delta, sign);
+}
+
+/** @brief Add the counts of the items below this item to @p delta */
+void DIFFITEM::AddSubtreeCounts(int delta[], int sign) const
+{
+	const FolderCounts *counts = m_pFolderCounts.load(std::memory_order_acquire);
+	if (counts != nullptr)
+	{
+		for (int k = 0; k < FolderCounts::KIND_COUNT; ++k)
+			delta[k] += sign * counts->Get(static_cast<FolderCounts::Kind>(k));
+	}
+}
+
+/**
+ * @brief Add @p delta to the counts of the ancestors of this item.
+ * Stops at the first filtered ancestor, the items below it are not counted
+ * further up.
+ */
+void DIFFITEM::AddToAncestors(const int delta[]) const
+{
+	bool changed = false;
+	for (int k = 0; k < FolderCounts::KIND_COUNT; ++k)
+		changed = changed || delta[k] != 0;
+	if (!changed)
+		return;
+	for (DIFFITEM *p = parent; p != nullptr; p = p->parent)
+	{
+		FolderCounts &counts = p->GetFolderCountsRef();
+		for (int k = 0; k < FolderCounts::KIND_COUNT; ++k)
+		{
+			if (delta[k] != 0)
+				counts.count[k].fetch_add(delta[k], std::memory_order_relaxed);
+		}
+		if (p->m_countedKind.load(std::memory_order_relaxed) == FolderCounts::FILTERED)
+			break;
+	}
+}
+
+/**
+ * @brief Return the kind of result an item is counted as in the folder counts.
+ * This is how the folder status has always classified the items: filtered
+ * first, then unique, then same or different.
+ */
+FolderCounts::Kind FolderCounts::GetKind(const DIFFCODE& diffcode)
+{
+	if (diffcode.diffcode == 0)
+		return NONE;
+	if (diffcode.isResultFiltered())
+		return FILTERED;
+	if (!diffcode.existAll())
+		return UNIQUE;
+	if (diffcode.isResultSame())
+		return SAME;
+	if (diffcode.isResultDiff())
+		return DIFF;
+	return NONE;
+}
+
 void DIFFCODE::swap(int idx1, int idx2)
 {
 	bool e[3] = { false, false, false };
@@ -5,8 +5,11 @@
  */
 #pragma once
 
+#include <atomic>
 #include "DiffFileInfo.h"
 
+class DiffItemArena;
+
 // Uncomment this to show debug information in the folder comparison window.
 // We don't use _DEBUG since the mapping of the setting (OPT_DIRVIEW_COLUMN_ORDERS or OPT_DIRVIEW3_COLUMN_ORDERS) shifts if this feature is enabled.
 //#define SHOW_DIFFITEM_DEBUG_INFO
@@ -167,6 +170,31 @@ public:
 	void swap(int idx1, int idx2);
 };
 
+/**
+ * @brief Compare results of the items below a folder item, by kind.
+ * A folder counts all the items of its subtree, except the items below its
+ * filtered subfolders; the filtered subfolders themselves are counted.
+ * The counts are kept up to date while the items are compared, see
+ * DIFFITEM::UpdateFolderCounts(), so reading them doesn't walk the subtree.
+ */
+struct FolderCounts
+{
+	enum Kind : unsigned char
+	{
+		NONE,		/**< Not compared (yet), or compare error */
+		SAME,
+		DIFF,
+		UNIQUE,		/**< Missing from one side at least */
+		FILTERED,
+		KIND_COUNT
+	};
+
+	std::atomic<int> count[KIND_COUNT]{};
+
+	int Get(Kind kind) const { return count[kind].load(std::memory_order_relaxed); }
+	static Kind GetKind(const DIFFCODE& diffcode);
+};
+
 enum ViewCustomFlags
 {
 	// No valid values are 0
@@ -259,8 +287,23 @@ public:
 	void Swap(int idx1, int idx2);
 	void ClearAllAdditionalProperties();
 
+//**** Counts of the items below a folder, see FolderCounts
+public:
+	const FolderCounts& GetFolderCounts() const;
+	void UpdateFolderCounts();
+
+private:
+	std::atomic<unsigned char> m_countedKind;		/**< FolderCounts::Kind this item is counted as in its ancestors */
+	std::atomic<FolderCounts *> m_pFolderCounts;	/**< Allocated when the first child is counted */
+	FolderCounts &GetFolderCountsRef();
+	void AddContribution(int delta[], int sign) const;
+	void AddSubtreeCounts(int delta[], int sign) const;
+	void AddToAncestors(const int delta[]) const;
+	void DeleteChildren();
+
 //**** Child, Parent, Sibling linkage
 private:							// Don't allow direct external manipulation of link values
+	friend class DiffItemArena;		// Resets `children` to destroy a whole tree at once
 	DIFFITEM *parent;				/**< Parent of current item */
 	DIFFITEM *children;				/**< Link to first child of this item */
 	DIFFITEM *Flink;				/**< Forward "sibling" link.  The forward linkage ends with
@@ -299,11 +342,19 @@ public:
 
 //**** CTOR, DTOR
 public:
-	DIFFITEM() : parent(nullptr), children(nullptr), Flink(nullptr), Blink(nullptr), 
-					nidiffs(-1), nsdiffs(-1), customFlags(ViewCustomFlags::INVALID_CODE),
-					renameMoveGroupId(-1)
+	DIFFITEM() : nsdiffs(-1), nidiffs(-1), customFlags(ViewCustomFlags::INVALID_CODE),
+					renameMoveGroupId(-1),
+					m_countedKind(FolderCounts::NONE), m_pFolderCounts(nullptr),
+					parent(nullptr), children(nullptr), Flink(nullptr), Blink(nullptr)
 					// `DiffFileInfo` and `DIFFCODE` have their own initializers. 
 					{}
 	~DIFFITEM();
 
+//**** Allocation, see DiffItemArena
+public:
+	static void *operator new(size_t size);
+	static void *operator new(size_t size, DiffItemArena& arena);
+	static void operator delete(void *p);
+	static void operator delete(void *p, DiffItemArena& arena);
+
 };
@@ -0,0 +1,154 @@
+/**
+ *  @file DiffItemArena.cpp
+ *
+ *  @brief Implementation of DiffItemArena
+ */
+
+#include "pch.h"
+#include "DiffItemArena.h"
+#include <cassert>
+#include <cstddef>
+#include <new>
+
+DiffItemArena::DiffItemArena()
+: m_nUsedInLastSlab(SlabSize)
+, m_pFree(nullptr)
+, m_nItems(0)
+{
+}
+
+DiffItemArena::~DiffItemArena()
+{
+	Clear();
+}
+
+/**
+ * @brief Storage for a DIFFITEM, see DIFFITEM::operator new.
+ */
+void *DiffItemArena::Allocate()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Slot *slot;
+	if (m_pFree != nullptr)
+	{
+		slot = m_pFree;
+		m_pFree = slot->next;
+	}
+	else
+	{
+		if (m_nUsedInLastSlab == SlabSize)
+		{
+			m_slabs.emplace_back(new Slot[SlabSize]);
+			m_nUsedInLastSlab = 0;
+		}
+		slot = &m_slabs.back()[m_nUsedInLastSlab++];
+	}
+	slot->owner = this;
+	++m_nItems;
+	return slot->item;
+}
+
+/**
+ * @brief Destroy all the items and free the slabs.
+ * The items are destroyed in memory order. Their children links are reset
+ * first, so destroying an item doesn't delete its children one by one.
+ */
+void DiffItemArena::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (size_t i = 0; i < m_slabs.size(); ++i)
+	{
+		Slot *slab = m_slabs[i].get();
+		const size_t nUsed = (i + 1 == m_slabs.size()) ? m_nUsedInLastSlab : SlabSize;
+		for (size_t j = 0; j < nUsed; ++j)
+		{
+			if (slab[j].owner == this)
+			{
+				DIFFITEM *pdi = reinterpret_cast<DIFFITEM *>(slab[j].item);
+				pdi->children = nullptr;
+				pdi->~DIFFITEM();
+			}
+		}
+	}
+	m_slabs.clear();
+	m_nUsedInLastSlab = SlabSize;
+	m_pFree = nullptr;
+	m_nItems = 0;
+}
+
+/** @brief Number of items allocated and not freed. */
+size_t DiffItemArena::GetItemCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_nItems;
+}
+
+size_t DiffItemArena::GetSlabCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_slabs.size();
+}
+
+/**
+ * @brief Storage for a DIFFITEM allocated with plain `new`.
+ * It has the same header as the items of an arena, with no owner.
+ */
+void *DiffItemArena::AllocateOnHeap(size_t size)
+{
+	assert(size <= sizeof(DIFFITEM));
+	Slot *slot = static_cast<Slot *>(::operator new(sizeof(Slot)));
+	slot->owner = nullptr;
+	return slot->item;
+}
+
+/**
+ * @brief Free the storage of a destroyed DIFFITEM, see DIFFITEM::operator delete.
+ */
+void DiffItemArena::Release(void *p)
+{
+	if (p == nullptr)
+		return;
+	Slot *slot = GetSlot(p);
+	if (slot->owner != nullptr)
+		slot->owner->Free(slot);
+	else
+		::operator delete(slot);
+}
+
+DiffItemArena::Slot *DiffItemArena::GetSlot(void *p)
+{
+	return reinterpret_cast<Slot *>(static_cast<unsigned char *>(p) - offsetof(Slot, item));
+}
+
+void DiffItemArena::Free(Slot *slot)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	slot->owner = nullptr;
+	slot->next = m_pFree;
+	m_pFree = slot;
+	--m_nItems;
+}
+
+/** @brief Allocate an item on the heap, it is freed by `delete` as usual */
+void *DIFFITEM::operator new(size_t size)
+{
+	return DiffItemArena::AllocateOnHeap(size);
+}
+
+/** @brief Allocate an item in @p arena, it is freed by `delete` or with the arena */
+void *DIFFITEM::operator new(size_t size, DiffItemArena& arena)
+{
+	assert(size <= sizeof(DIFFITEM));
+	return arena.Allocate();
+}
+
+void DIFFITEM::operator delete(void *p)
+{
+	DiffItemArena::Release(p);
+}
+
+/** @brief Called only if the constructor throws */
+void DIFFITEM::operator delete(void *p, DiffItemArena& arena)
+{
+	DiffItemArena::Release(p);
+}
@@ -0,0 +1,63 @@
+/**
+ *  @file DiffItemArena.h
+ *
+ *  @brief Declaration of DiffItemArena
+ */
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "DiffItem.h"
+
+/**
+ * @brief Slabs of DIFFITEMs for one DiffItemList.
+ *
+ * Items are carved out of slabs of SlabSize items. An item deleted alone
+ * goes to a free list which the next items are taken from. Clear()
+ * destroys the items slab by slab and frees the slabs at once, instead of
+ * walking the tree and freeing every item.
+ *
+ * Every item has a header pointing to its arena, DIFFITEM's operator
+ * delete finds the arena from it, so the items are deleted with `delete`
+ * like items allocated on the heap.
+ */
+class DiffItemArena
+{
+public:
+	static constexpr size_t SlabSize = 256; /**< Items of a slab */
+
+	DiffItemArena();
+	~DiffItemArena();
+	DiffItemArena(const DiffItemArena&) = delete;
+	DiffItemArena& operator=(const DiffItemArena&) = delete;
+
+	void *Allocate();
+	void Clear();
+	size_t GetItemCount() const;
+	size_t GetSlabCount() const;
+
+	static void *AllocateOnHeap(size_t size);
+	static void Release(void *p);
+
+private:
+	/** @brief Storage of one item and its header. */
+	struct Slot
+	{
+		DiffItemArena *owner; /**< Arena of the item, nullptr if on the heap or free */
+		union
+		{
+			Slot *next; /**< Next free slot */
+			alignas(DIFFITEM) unsigned char item[sizeof(DIFFITEM)];
+		};
+	};
+
+	static Slot *GetSlot(void *p);
+	void Free(Slot *slot);
+
+	mutable std::mutex m_mutex;
+	std::vector<std::unique_ptr<Slot[]>> m_slabs;
+	size_t m_nUsedInLastSlab; /**< Slots of the last slab ever allocated */
+	Slot *m_pFree; /**< Freed slots */
+	size_t m_nItems;
+};
@@ -30,7 +30,7 @@ DiffItemList::~DiffItemList()
  */
 DIFFITEM *DiffItemList::AddNewDiff(DIFFITEM *par)
 {
-	DIFFITEM *p = new DIFFITEM;
+	DIFFITEM *p = new (m_arena) DIFFITEM;
 	if (par == nullptr)
 	{
 		// if there is no `parent`, this item becomes a child of `m_pRoot`
@@ -48,14 +48,14 @@ DIFFITEM *DiffItemList::AddNewDiff(DIFFITEM *par)
  */
 void DiffItemList::RemoveAll()
 {
-	delete m_pRoot;
+	m_arena.Clear();
 	m_pRoot = nullptr;
 }
 
 void DiffItemList::InitDiffItemList()
 {
 	assert(m_pRoot == nullptr);
-	m_pRoot = new DIFFITEM;
+	m_pRoot = new (m_arena) DIFFITEM;
 }
 
 void DiffItemList::ClearAllAdditionalProperties()
@@ -168,6 +168,7 @@ void DiffItemList::SetDiffStatusCode(DIFFITEM *diffpos, unsigned diffcode, unsig
 	assert( ((~mask) & diffcode) == 0 ); // make sure they only set flags in their mask
 	di.diffcode.diffcode &= (~mask); // remove current data
 	di.diffcode.diffcode |= diffcode; // add new data
+	di.UpdateFolderCounts();
 }
 
 /**
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "DiffItem.h"
+#include "DiffItemArena.h"
 
 /**
  * @brief List of DIFFITEMs in folder compare.
@@ -13,6 +14,7 @@
  * we have a linked list of DIFFITEMs. But there is a structure that follows
  * the actual folder structure. Each DIFFITEM can have a parent folder and
  * another list of child items. Parent DIFFITEM is always a folder item.
+ * The items are allocated in an arena, which RemoveAll() frees at once.
  */
 class DiffItemList
 {
@@ -44,6 +46,7 @@ public:
 
 protected:
 	DIFFITEM* m_pRoot; /**< Root of list of diffitems; initially `nullptr`. */
+	DiffItemArena m_arena; /**< Storage of the root and all the items */
 };
 
 /**
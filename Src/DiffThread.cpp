@@ -12,6 +12,7 @@
 #include <Poco/Thread.h>
 #include <Poco/Semaphore.h>
 #include "CompareStats.h"
+#include "ContentHashCache.h"
 #include "IAbortable.h"
 #include "Plugins.h"
 #include "MergeAppCOMClass.h"
@@ -114,6 +115,8 @@ static void DiffThreadCollect(void *pParam)
 	if (myStruct->m_fncCollect)
 		myStruct->m_fncCollect(myStruct);
 
+	myStruct->context->m_pCompareStats->SetCollectDone(true);
+
 	// Release Semaphore() once again to signal that collect phase is ready
 	myStruct->pSemaphore->set();
 
@@ -142,9 +145,15 @@ static void DiffThreadCompare(void *pParam)
 
 	myStruct->context->m_pCompareStats->SetCompareState(CompareStats::STATE_COMPARE);
 
+	if (myStruct->context->m_pContentHashCache)
+		myStruct->context->m_pContentHashCache->Load();
+
 	// Now do all pending file comparisons
 	myStruct->m_fncCompare(myStruct);
 
+	if (myStruct->context->m_pContentHashCache)
+		myStruct->context->m_pContentHashCache->Save();
+
 	myStruct->context->m_pCompareStats->SetCompareState(CompareStats::STATE_IDLE);
 
 	// Send message to UI to update
@@ -13,6 +13,7 @@
 #include <tuple>
 #include <exception>
 #include <array>
+#include <thread>
 #include <Poco/Exception.h>
 #include "coretools.h"
 #include "DiffList.h"
@@ -26,6 +27,7 @@
 #include "CompareOptions.h"
 #include "FileTextStats.h"
 #include "DiffFileData.h"
+#include "PreparedFiles.h"
 #include "Environment.h"
 #include "PatchHTML.h"
 #include "UnicodeString.h"
@@ -71,6 +73,7 @@ CDiffWrapper::CDiffWrapper()
 , m_status()
 , m_codepage(ucr::CP_UTF_8)
 , m_xdlFlags(0)
+, m_pPreparedFiles(new PreparedFiles)
 {
 	// character that ends a line.  Currently this is always `\n'
 	line_end_char = '\n';
@@ -148,6 +151,8 @@ void CDiffWrapper::SetOptions(const DIFFOPTIONS *options, bool setToDiffutils)
 	assert(options != nullptr);
 	m_options.SetFromDiffOptions(*options);
 	m_xdlFlags = make_xdl_flags(m_options);
+	m_normalizer = HunkNormalizer(m_options.m_ignoreWhitespace, m_options.m_bIgnoreNumbers,
+		m_options.m_bIgnoreCase, m_options.m_bIgnoreEOLDifference);
 	if (setToDiffutils)
 		m_options.SetToDiffUtils();
 }
@@ -298,48 +303,6 @@ static std::tuple<std::string, unsigned, std::vector<bool>> GetCommentsFilteredT
 	return { ucr::toUTF8(filteredT), dwCookie, allTextIsComment };
 }
 
-/**
- * @brief Replace a string inside a string with another string.
- * This function searches for a string inside another string an if found,
- * replaces it with another string. Function can replace several instances
- * of the string inside one string.
- * @param [in,out] target A string containing another string to replace.
- * @param [in] find A string to search and replace with another (@p replace).
- * @param [in] replace A string used to replace original (@p find).
- */
-void Replace(std::string &target, const std::string &find, const std::string &replace)
-{
-	const std::string::size_type find_len = find.length();
-	const std::string::size_type replace_len = replace.length();
-	std::string::size_type pos = 0;
-	while ((pos = target.find(find, pos)) != std::string::npos)
-	{
-		target.replace(pos, find_len, replace);
-		pos += replace_len;
-	}
-}
-
-/**
- * @brief Replace the characters that matche characters specified in its arguments
- * @param [in,out] str - A string containing another string to replace.
- * @param [in] chars - characters to search for
- * @param [in] rep - String to replace
- */
-static void ReplaceChars(std::string & str, const char* chars, const char *rep)
-{
-	std::string::size_type pos = 0;
-	size_t replen = strlen(rep);
-	while ((pos = str.find_first_of(chars, pos)) != std::string::npos)
-	{
-		std::string::size_type posend = str.find_first_not_of(chars, pos);
-		if (posend != String::npos)
-			str.replace(pos, posend - pos, rep);
-		else
-			str.replace(pos, str.length() - pos, rep);
-		pos += replen;
-	}
-}
-
 /**
  * @brief Get the end-of-line (EOL) characters (LF, CR, or CRLF) from the end of a string.
  * @param [in] str - A string from which the EOL characters will be identified.
@@ -376,7 +339,8 @@ int CDiffWrapper::PostFilter(PostFilterContext& ctxt, change* thisob, const file
 	const int lineNumberLeft = trans_a0 - 1;
 	const int lineNumberRight = trans_a1 - 1;
 	
-	std::string lineDataLeft, lineDataRight;
+	std::string& lineDataLeft = ctxt.lineData[0];
+	std::string& lineDataRight = ctxt.lineData[1];
 	std::vector<bool> allTextIsCommentLeft(qtyLinesLeft), allTextIsCommentRight(qtyLinesRight);
 
 	if (m_options.m_filterCommentsLines)
@@ -416,8 +380,8 @@ int CDiffWrapper::PostFilter(PostFilterContext& ctxt, change* thisob, const file
 		// Match lines against regular expression filters
 		// Our strategy is that every line in both sides must
 		// match regexp before we mark difference as ignored.
-		bool match1 = RegExpFilter(lineDataLeft);
-		bool match2 = RegExpFilter(lineDataRight);
+		bool match1 = RegExpFilter(lineDataLeft, ctxt.buffer[0]);
+		bool match2 = RegExpFilter(lineDataRight, ctxt.buffer[1]);
 		if (match1 && match2)
 		{
 			thisob->trivial = 1;
@@ -431,39 +395,14 @@ int CDiffWrapper::PostFilter(PostFilterContext& ctxt, change* thisob, const file
 		lineDataRight = m_pSubstitutionList->Subst(lineDataRight, m_codepage);
 	}
 
-	if (m_options.m_ignoreWhitespace == WHITESPACE_IGNORE_ALL)
-	{
-		//Ignore character case
-		ReplaceChars(lineDataLeft, " \t", "");
-		ReplaceChars(lineDataRight, " \t", "");
-	}
-	else if (m_options.m_ignoreWhitespace == WHITESPACE_IGNORE_CHANGE)
-	{
-		//Ignore change in whitespace char count
-		ReplaceChars(lineDataLeft, " \t", " ");
-		ReplaceChars(lineDataRight, " \t", " ");
-	}
-
-	if (m_options.m_bIgnoreNumbers)
-	{
-		//Ignore number character case
-		ReplaceChars(lineDataLeft, "0123456789", "");
-		ReplaceChars(lineDataRight, "0123456789", "");
-	}
-	if (m_options.m_bIgnoreCase)
-	{
-		//ignore case
-		for (std::string::iterator pb = lineDataLeft.begin(), pe = lineDataLeft.end(); pb != pe; ++pb) 
-			*pb = static_cast<char>(::toupper(*pb));
-		for (std::string::iterator pb = lineDataRight.begin(), pe = lineDataRight.end(); pb != pe; ++pb) 
-			*pb = static_cast<char>(::toupper(*pb));
-	}
-	if (m_options.m_bIgnoreEOLDifference)
+	// Ignore whitespace, numbers, case and EOL differences, in one pass
+	if (m_options.m_ignoreWhitespace != WHITESPACE_COMPARE_ALL || m_options.m_bIgnoreNumbers ||
+		m_options.m_bIgnoreCase || m_options.m_bIgnoreEOLDifference)
 	{
-		Replace(lineDataLeft, "\r\n", "\n");
-		Replace(lineDataLeft, "\r", "\n");
-		Replace(lineDataRight, "\r\n", "\n");
-		Replace(lineDataRight, "\r", "\n");
+		m_normalizer.Normalize(lineDataLeft, ctxt.buffer[0]);
+		lineDataLeft.swap(ctxt.buffer[0]);
+		m_normalizer.Normalize(lineDataRight, ctxt.buffer[1]);
+		lineDataRight.swap(ctxt.buffer[1]);
 	}
 	if (thisob->link == nullptr && m_options.m_bIgnoreMissingTrailingEol && (file_data_ary[0].missing_newline != file_data_ary[1].missing_newline))
 	{
@@ -474,24 +413,10 @@ int CDiffWrapper::PostFilter(PostFilterContext& ctxt, change* thisob, const file
 	}
 	if (m_options.m_bIgnoreLineBreaks)
 	{
-		std::string lineDataLeftOneLine = lineDataLeft;
-		std::string lineDataRightOneLine = lineDataRight;
-		Replace(lineDataLeftOneLine, "\r\n", " ");
-		ReplaceChars(lineDataLeftOneLine, "\r\n", " ");
-		Replace(lineDataRightOneLine, "\r\n", " ");
-		ReplaceChars(lineDataRightOneLine, "\r\n", " ");
-		if (m_options.m_ignoreWhitespace == WHITESPACE_IGNORE_ALL)
-		{
-			//Ignore character case
-			ReplaceChars(lineDataLeftOneLine, " \t", "");
-			ReplaceChars(lineDataRightOneLine, " \t", "");
-		}
-		else if (m_options.m_ignoreWhitespace == WHITESPACE_IGNORE_CHANGE)
-		{
-			//Ignore change in whitespace char count
-			ReplaceChars(lineDataLeftOneLine, " \t", " ");
-			ReplaceChars(lineDataRightOneLine, " \t", " ");
-		}
+		std::string& lineDataLeftOneLine = ctxt.buffer[0];
+		std::string& lineDataRightOneLine = ctxt.buffer[1];
+		m_normalizer.JoinLines(lineDataLeft, lineDataLeftOneLine);
+		m_normalizer.JoinLines(lineDataRight, lineDataRightOneLine);
 		// If both match after filtering, mark this diff hunk as trivial and return.
 		if (lineDataLeftOneLine == lineDataRightOneLine)
 		{
@@ -802,9 +727,22 @@ bool CDiffWrapper::RunFileDiff()
 	struct change *script02 = nullptr;
 	DiffFileData diffdata, diffdata10, diffdata12, diffdata02;
 	int bin_flag = 0, bin_flag10 = 0, bin_flag12 = 0, bin_flag02 = 0;
+	std::vector<char> content[3];
+	bool preloaded[3] = {};
+	// Large files are left to diffutils, which maps them, and streamed
+	// files aren't read whole at all
+	const bool bPreload = !(m_options.m_diffAlgorithm == DIFF_ALGORITHM_STREAMING && CanStreamFiles());
 
 	if (aFiles.GetSize() == 2)
 	{
+		// A document is rescanned after every edit, keep its files
+		// prepared so that a rescan rehashes only the edited lines
+		if (m_bUseDiffList && bPreload)
+		{
+			for (file = 0; file < 2; file++)
+				preloaded[file] = DiffFileData::ReadContent(strFileTemp[file], content[file], MIN_MAPPED_FILE_SIZE);
+		}
+
 		diffdata.SetDisplayFilepaths(aFiles[0], aFiles[1]); // store true names for diff utils patch file
 		// This opens & fstats both files (if it succeeds)
 		if (!diffdata.OpenFiles(strFileTemp[0], strFileTemp[1]))
@@ -812,6 +750,18 @@ bool CDiffWrapper::RunFileDiff()
 			return false;
 		}
 
+		if (m_bUseDiffList)
+		{
+			for (file = 0; file < 2; file++)
+			{
+				if (preloaded[file])
+					diffdata.SetPreloadedContent(file, content[file]);
+			}
+			const file_data *inf[2] = { &diffdata.m_inf[0], &diffdata.m_inf[1] };
+			m_pPreparedFiles->Prepare(2, inf);
+			m_pPreparedFiles->Attach(diffdata, 0, 1);
+		}
+
 		// Compare the files, if no error was found.
 		// Last param (bin_file) is `nullptr` since we don't
 		// (yet) need info about binary sides.
@@ -841,26 +791,95 @@ bool CDiffWrapper::RunFileDiff()
 		diffdata12.SetDisplayFilepaths(aFiles[1], aFiles[2]); // store true names for diff utils patch file
 		diffdata02.SetDisplayFilepaths(aFiles[0], aFiles[2]); // store true names for diff utils patch file
 
-		if (!diffdata10.OpenFiles(strFileTemp[1], strFileTemp[0]))
+		// Read every file once and let the three pairwise diffs share the
+		// content, instead of each of them reading its two files again
+		for (file = 0; bPreload && file < 3; file++)
+			preloaded[file] = DiffFileData::ReadContent(strFileTemp[file], content[file], MIN_MAPPED_FILE_SIZE);
+
+		if (!diffdata10.OpenFiles(strFileTemp[1], strFileTemp[0]) ||
+			!diffdata12.OpenFiles(strFileTemp[1], strFileTemp[2]) ||
+			!diffdata02.OpenFiles(strFileTemp[0], strFileTemp[2]))
 		{
 			return false;
 		}
 
-		bRet = Diff2Files(&script10, &diffdata10, &bin_flag10, nullptr);
-
-		if (!diffdata12.OpenFiles(strFileTemp[1], strFileTemp[2]))
+		auto preloadPair = [&](DiffFileData& diffdata, int file0, int file1)
 		{
-			return false;
-		}
+			if (preloaded[file0])
+				diffdata.SetPreloadedContent(0, content[file0]);
+			if (preloaded[file1])
+				diffdata.SetPreloadedContent(1, content[file1]);
+		};
+		preloadPair(diffdata10, 1, 0);
+		preloadPair(diffdata12, 1, 2);
+		preloadPair(diffdata02, 0, 2);
 
-		bRet = Diff2Files(&script12, &diffdata12, &bin_flag12, nullptr);
+		// Split every file into lines and classify them once for all pairs
+		const file_data *inf[3] = { &diffdata10.m_inf[1], &diffdata10.m_inf[0], &diffdata12.m_inf[1] };
+		m_pPreparedFiles->Prepare(3, inf);
 
-		if (!diffdata02.OpenFiles(strFileTemp[0], strFileTemp[2]))
+		auto diffPair = [&](DiffFileData& diffdata, int file0, int file1, struct change **script, int *bin_flag)
 		{
-			return false;
-		}
+			m_pPreparedFiles->Attach(diffdata, file0, file1);
+			return Diff2Files(script, &diffdata, bin_flag, nullptr);
+		};
 
-		bRet = Diff2Files(&script02, &diffdata02, &bin_flag02, nullptr);
+		// The diffutils state, options included, is thread-local, so the
+		// pairs can be compared concurrently once each thread has its options.
+		// On a single core the threads would only evict each other's data.
+		// An exception thrown by a pair is rethrown here once all the pairs
+		// are done, as it was when they were compared one after the other
+		bool bRet10 = false, bRet12 = false, bRet02 = false;
+		std::exception_ptr error10, error12, error02;
+		std::thread thread10, thread12;
+		if (std::thread::hardware_concurrency() > 1)
+		{
+			thread10 = std::thread([&]() {
+				try
+				{
+					m_options.SetToDiffUtils();
+					bRet10 = diffPair(diffdata10, 1, 0, &script10, &bin_flag10);
+				}
+				catch (...)
+				{
+					error10 = std::current_exception();
+				}
+			});
+			thread12 = std::thread([&]() {
+				try
+				{
+					m_options.SetToDiffUtils();
+					bRet12 = diffPair(diffdata12, 1, 2, &script12, &bin_flag12);
+				}
+				catch (...)
+				{
+					error12 = std::current_exception();
+				}
+			});
+		}
+		else
+		{
+			bRet10 = diffPair(diffdata10, 1, 0, &script10, &bin_flag10);
+			bRet12 = diffPair(diffdata12, 1, 2, &script12, &bin_flag12);
+		}
+		try
+		{
+			bRet02 = diffPair(diffdata02, 0, 2, &script02, &bin_flag02);
+		}
+		catch (...)
+		{
+			error02 = std::current_exception();
+		}
+		if (thread10.joinable())
+			thread10.join();
+		if (thread12.joinable())
+			thread12.join();
+		for (const auto& error : { error10, error12, error02 })
+		{
+			if (error)
+				std::rethrow_exception(error);
+		}
+		bRet = bRet10 && bRet12 && bRet02;
 	}
 
 	// First determine what happened during comparison
@@ -1171,7 +1190,13 @@ bool CDiffWrapper::Diff2Files(struct change ** diffs, DiffFileData *diffData,
 	SE_Handler seh;
 	try
 	{
-		if (m_options.m_diffAlgorithm != DIFF_ALGORITHM_DEFAULT)
+		if (m_options.m_diffAlgorithm == DIFF_ALGORITHM_STREAMING && CanStreamFiles())
+		{
+			*diffs = diff_2_files_streaming(diffData->m_inf, bin_status, bin_file, make_xdl_flags(m_options));
+			files[0] = diffData->m_inf[0];
+			files[1] = diffData->m_inf[1];
+		}
+		else if (m_options.m_diffAlgorithm != DIFF_ALGORITHM_DEFAULT)
 		{
 			const unsigned xdl_flags = make_xdl_flags(m_options);
 			*diffs = diff_2_files_xdiff(diffData->m_inf, bin_status,
@@ -1195,6 +1220,23 @@ bool CDiffWrapper::Diff2Files(struct change ** diffs, DiffFileData *diffData,
 	return bRet;
 }
 
+/**
+ * @brief Can the files be compared a window at a time?
+ * The streaming diff doesn't keep the lines of the files, so it is used
+ * only if nothing after the compare reads them: no moved block detection,
+ * patch file, ignored blank lines, line filters or substitution filters.
+ * A 3-way compare reads the lines of the pairs to merge their changes.
+ * Otherwise the files are compared in memory with the patience algorithm.
+ */
+bool CDiffWrapper::CanStreamFiles() const
+{
+	return m_files.GetSize() < 3 && m_pMovedLines[0] == nullptr && !m_bCreatePatchFile &&
+		!m_options.m_bIgnoreBlankLines && !m_options.m_filterCommentsLines &&
+		!m_options.m_bIgnoreMissingTrailingEol && !m_options.m_bIgnoreLineBreaks &&
+		!(m_pFilterList && m_pFilterList->HasRegExps()) &&
+		!(m_pSubstitutionList && m_pSubstitutionList->HasRegExps());
+}
+
 bool CDiffWrapper::IsIdenticalOrIgnorable(struct change* script)
 {
 	bool diff = false;
@@ -1235,7 +1277,7 @@ CDiffWrapper::FreeDiffUtilsScript(struct change * & script)
  * @param [in] FileNo File to match.
  * return true if any of the expressions matches.
  */
-bool CDiffWrapper::RegExpFilter(std::string& lines) const
+bool CDiffWrapper::RegExpFilter(std::string& lines, std::string& buffer) const
 {
 	if (m_pFilterList == nullptr)
 	{	
@@ -1245,8 +1287,10 @@ bool CDiffWrapper::RegExpFilter(std::string& lines) const
 
 	bool linesMatch = true; // set to false when non-matching line is found.
 
-	std::string replaced;
+	std::string& replaced = buffer;
+	replaced.clear();
 	replaced.reserve(lines.length());
+	std::string line;
 	size_t pos = 0;
 	while (pos < lines.length())
 	{
@@ -1254,7 +1298,7 @@ bool CDiffWrapper::RegExpFilter(std::string& lines) const
 		while (pos < lines.length() && (lines[pos] != '\r' && lines[pos] != '\n'))
 			pos++;
 		size_t stringlen = lines.c_str() + pos - string;
-		std::string line = std::string(string, stringlen);
+		line.assign(string, stringlen);
 		if (!m_pFilterList->Match(line, m_codepage))
 		{
 			linesMatch = false;
@@ -1264,12 +1308,12 @@ bool CDiffWrapper::RegExpFilter(std::string& lines) const
 		{
 			replaced += FILTERED_LINE;
 		}
-		std::string eol;
+		const size_t eol = pos;
 		while (pos < lines.length() && (lines[pos] == '\r' || lines[pos] == '\n'))
-			eol += lines[pos++];
-		replaced += eol;
+			pos++;
+		replaced.append(lines, eol, pos - eol);
 	}
-	lines = replaced;
+	lines.swap(replaced);
 	return linesMatch;
 }
 
@@ -16,6 +16,7 @@
 #include "DiffList.h"
 #include "UnicodeString.h"
 #include "FileTransform.h"
+#include "HunkNormalizer.h"
 
 class CDiffContext;
 class PrediffingInfo;
@@ -23,6 +24,7 @@ struct DiffFileData;
 class PathContext;
 struct file_data;
 class MovedLines;
+class PreparedFiles;
 class FilterList;
 class SubstitutionList;
 namespace CrystalLineParser { struct TextDefinition; };
@@ -152,6 +154,8 @@ struct PostFilterContext
 	int nParsedLineEndRight = -1;
 	unsigned dwCookieLeft = 0;
 	unsigned dwCookieRight = 0;
+	std::string lineData[2]; /**< Text of the hunk, reused from hunk to hunk */
+	std::string buffer[2]; /**< Work buffers of the filters */
 };
 
 /**
@@ -199,6 +203,7 @@ public:
 	void SetCodepage(int codepage) { m_codepage = codepage; }
 	void EnablePlugins(bool enable);
 	int PostFilter(PostFilterContext& ctxt, change* thisob, const file_data* file_data_ary) const;
+	bool CanStreamFiles() const;
 	bool Diff2Files(struct change ** diffs, DiffFileData *diffData,
 		int * bin_status, int * bin_file) const;
 
@@ -213,11 +218,12 @@ public:
 		const file_data * inf10, const file_data * inf12, const file_data * inf02);
 	static bool IsIdenticalOrIgnorable(struct change* script);
 	static void FreeDiffUtilsScript(struct change * & script);
-	bool RegExpFilter(std::string& lines) const;
+	bool RegExpFilter(std::string& lines, std::string& buffer) const;
 
 private:
 	DiffutilsOptions m_options;
 	int m_xdlFlags;
+	HunkNormalizer m_normalizer; /**< Ignores the whitespace, numbers, case and EOLs of the options in PostFilter() */
 	DIFFSTATUS m_status; /**< Status of last compare */
 	std::shared_ptr<FilterList> m_pFilterList; /**< List of linefilters. */
 	std::shared_ptr<SubstitutionList> m_pSubstitutionList;
@@ -239,6 +245,7 @@ private:
 	int m_nDiffs; /**< Difference count */
 	DiffList *m_pDiffList; /**< Pointer to external DiffList */
 	std::unique_ptr<MovedLines> m_pMovedLines[3];
+	std::unique_ptr<PreparedFiles> m_pPreparedFiles; /**< Lines of the compared files, kept between rescans */
 	CrystalLineParser::TextDefinition *m_pFilterCommentsDef; /**< Text definition for Comments filter  */
 	bool m_bPluginsEnabled; /**< Are plugins enabled? */
 	int m_codepage; /**< Codepage used in line filter */
@@ -831,9 +831,9 @@ bool GetOpenOneItem(const CDiffContext& ctxt, DIFFITEM *pos1, const DIFFITEM *pd
 	if (!openableForDir && pdi[0]->diffcode.isDirectory()) return false;
 
 	paths = GetItemFileNames(ctxt, *pdi[0]);
-	encoding[0] = pdi[0]->diffFileInfo[0].encoding;
-	encoding[1] = pdi[0]->diffFileInfo[1].encoding;
-	encoding[2] = pdi[0]->diffFileInfo[2].encoding;
+	encoding[0] = pdi[0]->diffFileInfo[0].GetEncoding();
+	encoding[1] = pdi[0]->diffFileInfo[1].GetEncoding();
+	encoding[2] = pdi[0]->diffFileInfo[2].GetEncoding();
 
 	for (int nIndex = 0; nIndex < paths.GetSize(); ++nIndex)
 		nPane[nIndex] = nIndex;
@@ -919,8 +919,8 @@ bool GetOpenTwoItems(const CDiffContext& ctxt, SELECTIONTYPE selectionType, DIFF
 	files2 = GetItemFileNames(ctxt, *pdi[1]);
 	paths.SetLeft(files1[nPane[0]]);
 	paths.SetRight(files2[nPane[1]]);
-	encoding[0] = pdi[0]->diffFileInfo[nPane[0]].encoding;
-	encoding[1] = pdi[1]->diffFileInfo[nPane[1]].encoding;
+	encoding[0] = pdi[0]->diffFileInfo[nPane[0]].GetEncoding();
+	encoding[1] = pdi[1]->diffFileInfo[nPane[1]].GetEncoding();
 
 	if (pdi[0]->diffcode.isDirectory())
 	{
@@ -1024,9 +1024,9 @@ bool GetOpenThreeItems(const CDiffContext& ctxt, DIFFITEM *pos1, DIFFITEM *pos2,
 	paths.SetMiddle(pathMiddle);
 	paths.SetRight(pathRight);
 
-	encoding[0] = pdi[0]->diffFileInfo[0].encoding;
-	encoding[1] = pdi[1]->diffFileInfo[1].encoding;
-	encoding[2] = pdi[2]->diffFileInfo[2].encoding;
+	encoding[0] = pdi[0]->diffFileInfo[0].GetEncoding();
+	encoding[1] = pdi[1]->diffFileInfo[1].GetEncoding();
+	encoding[2] = pdi[2]->diffFileInfo[2].GetEncoding();
 
 	if (pdi[0]->diffcode.isDirectory())
 	{
@@ -1148,12 +1148,11 @@ void CopyDiffSideAndProperties(CDiffContext& ctxt, DIFFITEM& di, int src, int ds
 	{
 		di.diffcode.diffcode |= (DIFFCODE::FIRST << dst);
 		// copy file properties other than ctime 
-		di.diffFileInfo[dst].encoding = di.diffFileInfo[src].encoding;
-		di.diffFileInfo[dst].m_textStats = di.diffFileInfo[src].m_textStats;
-		di.diffFileInfo[dst].version = di.diffFileInfo[src].version;
+		di.diffFileInfo[dst].CopyDetails(di.diffFileInfo[src]);
 		di.diffFileInfo[dst].size = di.diffFileInfo[src].size;
 		di.diffFileInfo[dst].mtime = di.diffFileInfo[src].mtime;
 		di.diffFileInfo[dst].flags = di.diffFileInfo[src].flags;
+		di.UpdateFolderCounts();
 	}
 	if (di.HasChildren())
 	{
@@ -1170,6 +1169,7 @@ void CopyDiffSideAndProperties(CDiffContext& ctxt, DIFFITEM& di, int src, int ds
 void UnsetDiffSide(const CDiffContext& ctxt, DIFFITEM& di, int index)
 {
 	di.diffcode.diffcode &= ~(DIFFCODE::FIRST << index);
+	di.UpdateFolderCounts();
 	di.diffFileInfo[index].ClearPartial();
 	// https://github.com/WinMerge/winmerge/issues/2599
 	for (int i = 0; i < ctxt.GetCompareDirs(); ++i)
@@ -1215,6 +1215,7 @@ void SetDiffStatus(DIFFITEM& di, unsigned  diffcode, unsigned mask)
 
 	di.diffcode.diffcode &= (~mask); // remove current data
 	di.diffcode.diffcode |= diffcode; // add new data
+	di.UpdateFolderCounts();
 	if (di.HasChildren())
 	{
 		for (DIFFITEM* pdic = di.GetFirstChild(); pdic; pdic = pdic->GetFwdSiblingLink())
@@ -1264,6 +1265,7 @@ int UpdateCompareFlagsAfterSync(DIFFITEM& di, bool bRecursive)
 			di.diffcode.diffcode &= (~DIFFCODE::COMPAREFLAGS);
 			unsigned flag = (res > 0) ? DIFFCODE::DIFF : DIFFCODE::SAME;
 			di.diffcode.diffcode |= flag;
+			di.UpdateFolderCounts();
 		}
 	}
 	else
@@ -1276,6 +1278,7 @@ int UpdateCompareFlagsAfterSync(DIFFITEM& di, bool bRecursive)
 			{
 				di.diffcode.diffcode &= (~DIFFCODE::COMPAREFLAGS);
 				di.diffcode.diffcode |= DIFFCODE::SAME;
+				di.UpdateFolderCounts();
 			}
 			else
 			{
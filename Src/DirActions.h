@@ -826,7 +826,7 @@ IntToIntMap CountCodepages(const InputIterator& begin, const InputIterator& end,
 		for (int i = 0; i < ctxt.GetCompareDirs(); ++i)
 		{
 			if (di.diffcode.diffcode != 0 && di.diffcode.exists(i))
-				map.Increment(di.diffFileInfo[i].encoding.m_codepage);
+				map.Increment(di.diffFileInfo[i].GetEncoding().m_codepage);
 		}
 	}
 	return map;
@@ -848,7 +848,7 @@ void ApplyCodepage(const InputIterator& begin, const InputIterator& end, CDiffCo
 			// Does it exist on left? (ie, right or both)
 			if (affect[i] && di.diffcode.exists(i) && di.diffFileInfo[i].IsEditableEncoding())
 			{
-				di.diffFileInfo[i].encoding.SetCodepage(nCodepage);
+				di.diffFileInfo[i].GetEncodingRef().SetCodepage(nCodepage);
 			}
 		}
 	}
@@ -98,7 +98,10 @@ void DirCompProgressBar::SetProgressState(int comparedItems, int totalItems)
 	if (!pProg) return;
 	String itemsPerSecond = m_prevComparedItems.empty() ? _T("") : strutils::format(_("%.1f[items/sec]"),
 		(double)(comparedItems - m_prevComparedItems.front()) * 1000.0 / (UPDATE_INTERVAL * m_prevComparedItems.size()));
-	SetDlgItemInt(IDC_ITEMSTOTAL, totalItems);
+	if (m_pCompareStats == nullptr || m_pCompareStats->IsCollectDone())
+		SetDlgItemInt(IDC_ITEMSTOTAL, totalItems);
+	else // Items are still being collected while comparing
+		SetDlgItemText(IDC_ITEMSTOTAL, strutils::format(_T("%d+"), totalItems));
 	SetDlgItemInt(IDC_ITEMSCOMPARED, comparedItems);
 	SetDlgItemText(IDC_ITEMS_PER_SEC, itemsPerSecond);
 	pProg->SetPos(comparedItems);
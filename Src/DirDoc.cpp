@@ -46,6 +46,8 @@
 #include "FolderCmp.h"
 #include "DirViewColItems.h"
 #include "RenameMoveDetection.h"
+#include "ContentHashCache.h"
+#include "Environment.h"
 #include <Poco/Semaphore.h>
 #include <set>
 
@@ -268,7 +270,18 @@ void CDirDoc::InitDiffContext(CDiffContext *pCtxt)
 	pCtxt->m_bStopAfterFirstDiff = pOptions->GetBool(OPT_CMP_STOP_AFTER_FIRST);
 	pCtxt->m_nQuickCompareLimit = pOptions->GetInt(OPT_CMP_QUICK_LIMIT);
 	pCtxt->m_nBinaryCompareLimit = pOptions->GetInt(OPT_CMP_BINARY_LIMIT);
+	pCtxt->m_bBinaryCompareMemoryMapping = pOptions->GetBool(OPT_CMP_BINARY_MEMORY_MAPPING);
+	pCtxt->m_nBinaryCompareSampleBlocks = pOptions->GetInt(OPT_CMP_BINARY_SAMPLE_BLOCKS);
+	pCtxt->m_bBinaryCompareTrustSamples = pOptions->GetBool(OPT_CMP_BINARY_TRUST_SAMPLES);
 	pCtxt->m_bTrustFileMetadata = pOptions->GetBool(OPT_CMP_TRUST_FILE_METADATA);
+	pCtxt->m_pContentHashCache.reset();
+	if (pOptions->GetBool(OPT_CMP_CONTENT_HASH_CACHE))
+	{
+		const String cacheFolder = paths::ConcatPath(env::GetAppDataPath(), _T("WinMerge"));
+		paths::CreateIfNeeded(cacheFolder);
+		pCtxt->m_pContentHashCache = std::make_unique<ContentHashCache>(
+			paths::ConcatPath(cacheFolder, _T("ContentHashCache.bin")), pOptions->GetInt(OPT_CMP_CONTENT_HASH_CACHE_LIMIT));
+	}
 	pCtxt->m_bPluginsEnabled = pOptions->GetBool(OPT_PLUGINS_ENABLED);
 	pCtxt->m_bWalkUniques = pOptions->GetBool(OPT_CMP_WALK_UNIQUE_DIRS);
 	pCtxt->m_bIgnoreReparsePoints = pOptions->GetBool(OPT_CMP_IGNORE_REPARSE_POINTS);
@@ -0,0 +1,250 @@
+/**
+ * @file  DirEnumPool.cpp
+ *
+ * @brief Implementation of DirEnumPool class.
+ */
+
+#include "pch.h"
+#include "DirEnumPool.h"
+#include <cassert>
+#include "DirItem.h"
+#include "paths.h"
+
+/**
+ * @brief Start the threads.
+ * @param [in] load Lists a folder, on the threads of the pool and on the
+ *   thread calling Get().
+ * @param [in] nThreads Number of threads listing folders.
+ * @param [in] prefetchLevels Levels of subfolders listed ahead, 0 lists
+ *   only the folders requested.
+ */
+DirEnumPool::DirEnumPool(const LoadFunc& load, int nThreads, int prefetchLevels)
+: m_load(load)
+, m_prefetchLevels(prefetchLevels)
+, m_stop(false)
+{
+	for (int i = 0; i < nThreads; ++i)
+		m_threads.emplace_back([this]() { Run(); });
+}
+
+/** @brief Stop the threads, folders being listed are finished first. */
+DirEnumPool::~DirEnumPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_queued.notify_all();
+	for (auto& thread : m_threads)
+		thread.join();
+}
+
+/**
+ * @brief Start listing a folder before it is needed.
+ * The folder is listed before the folders requested earlier, so the
+ * folders of one level can be requested together and listed in parallel.
+ */
+void DirEnumPool::Request(const String& sDir)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	RequestLocked(sDir, m_prefetchLevels, false);
+}
+
+/**
+ * @brief Get the listing of a folder, listing it now if it isn't yet.
+ * The subfolders of the folder are requested if they weren't already.
+ * @return The listing, to give back with Release().
+ */
+DirEnumPool::Listing *DirEnumPool::Get(const String& sDir)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	RequestLocked(sDir, m_prefetchLevels, false);
+	// Only prefetched folders are dropped when too many are pending, and a
+	// folder is taken once, so its entry stays until it is erased below
+	auto it = m_entries.find(sDir);
+	assert(it != m_entries.end());
+	if (it->second.state == State::Queued)
+	{
+		// Listing it here is faster than waiting for a thread, it stays
+		// in the queue and is skipped there
+		it->second.state = State::Loading;
+		lock.unlock();
+		Load(sDir);
+		lock.lock();
+	}
+	m_done.wait(lock, [&]() { return m_entries.find(sDir)->second.state == State::Done; });
+	it = m_entries.find(sDir);
+	assert(it != m_entries.end());
+	Listing *listing = it->second.listing;
+	m_entries.erase(it);
+	return listing;
+}
+
+/** @brief Give back a listing for reuse. */
+void DirEnumPool::Release(Listing *listing)
+{
+	listing->dirs.clear();
+	listing->files.clear();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_free.push_back(listing);
+}
+
+/** @brief Drop a folder which won't be walked, and its subfolders listed ahead. */
+void DirEnumPool::Discard(const String& sDir)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	DiscardLocked(sDir);
+}
+
+/** @brief Number of folders requested or listed which haven't been taken or discarded. */
+size_t DirEnumPool::GetPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_entries.size();
+}
+
+/**
+ * @brief Queue a folder, or raise the levels of subfolders listed after it.
+ * @param [in] prefetch Is the folder a subfolder listed ahead? Those are
+ *   limited to MaxPrefetched, the others are moved to the front of the queue.
+ */
+void DirEnumPool::RequestLocked(const String& sDir, int levels, bool prefetch)
+{
+	auto it = m_entries.find(sDir);
+	if (it == m_entries.end())
+	{
+		if (prefetch && m_entries.size() >= MaxPrefetched)
+			return;
+		m_entries.emplace(sDir, Entry{ State::Queued, levels, false, nullptr });
+		m_queue.push_front(sDir);
+		m_queued.notify_one();
+		return;
+	}
+	Entry& entry = it->second;
+	entry.discarded = false;
+	if (!prefetch && entry.state == State::Queued)
+	{
+		m_queue.push_front(sDir);
+		m_queued.notify_one();
+	}
+	if (levels > entry.levels)
+	{
+		entry.levels = levels;
+		if (entry.state == State::Done)
+			RequestSubdirsLocked(sDir, entry);
+	}
+}
+
+/** @brief Request the subfolders of a listed folder, in their order. */
+void DirEnumPool::RequestSubdirsLocked(const String& sDir, const Entry& entry)
+{
+	if (entry.levels <= 0)
+		return;
+	const int levels = entry.levels - 1;
+	const DirItemArray& dirs = entry.listing->dirs;
+	// Each request goes to the front, so the first subfolder is queued last
+	for (auto it = dirs.rbegin(); it != dirs.rend(); ++it)
+		RequestLocked(paths::ConcatPath(sDir, it->filename.get()), levels, true);
+}
+
+void DirEnumPool::DiscardLocked(const String& sDir)
+{
+	auto it = m_entries.find(sDir);
+	if (it == m_entries.end())
+		return;
+	switch (it->second.state)
+	{
+	case State::Queued:
+		m_entries.erase(it);
+		break;
+	case State::Loading:
+		it->second.discarded = true;
+		break;
+	case State::Done:
+	{
+		Listing *listing = it->second.listing;
+		m_entries.erase(it);
+		for (const auto& dir : listing->dirs)
+			DiscardLocked(paths::ConcatPath(sDir, dir.filename.get()));
+		ReleaseLocked(listing);
+		break;
+	}
+	}
+}
+
+/** @brief List a folder whose entry has been set to State::Loading. */
+void DirEnumPool::Load(const String& sDir)
+{
+	Listing *listing;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		listing = AcquireLocked();
+	}
+	try
+	{
+		m_load(sDir, &listing->dirs, &listing->files);
+	}
+	catch (...)
+	{
+		// Empty arrays mean orphans, like a folder which can't be read
+		listing->dirs.clear();
+		listing->files.clear();
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	// Discarding a folder being listed only marks it, see DiscardLocked()
+	auto it = m_entries.find(sDir);
+	assert(it != m_entries.end());
+	if (it->second.discarded)
+	{
+		m_entries.erase(it);
+		ReleaseLocked(listing);
+	}
+	else
+	{
+		it->second.state = State::Done;
+		it->second.listing = listing;
+		RequestSubdirsLocked(sDir, it->second);
+	}
+	m_done.notify_all();
+}
+
+DirEnumPool::Listing *DirEnumPool::AcquireLocked()
+{
+	if (m_free.empty())
+	{
+		m_listings.emplace_back(new Listing);
+		return m_listings.back().get();
+	}
+	Listing *listing = m_free.back();
+	m_free.pop_back();
+	return listing;
+}
+
+void DirEnumPool::ReleaseLocked(Listing *listing)
+{
+	listing->dirs.clear();
+	listing->files.clear();
+	m_free.push_back(listing);
+}
+
+/** @brief List the queued folders until the pool is destroyed. */
+void DirEnumPool::Run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;)
+	{
+		m_queued.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+		if (m_stop)
+			return;
+		const String sDir = std::move(m_queue.front());
+		m_queue.pop_front();
+		// Folders taken by Get() or discarded stay in the queue
+		auto it = m_entries.find(sDir);
+		if (it == m_entries.end() || it->second.state != State::Queued)
+			continue;
+		it->second.state = State::Loading;
+		lock.unlock();
+		Load(sDir);
+		lock.lock();
+	}
+}
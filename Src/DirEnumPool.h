@@ -0,0 +1,87 @@
+/**
+ * @file  DirEnumPool.h
+ *
+ * @brief Declaration of DirEnumPool class.
+ */
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "UnicodeString.h"
+#include "DirTravel.h"
+
+/**
+ * @brief Lists folders on persistent threads, ahead of the folder walk.
+ *
+ * The walk asks for the listing of each folder with Get(). Listing a
+ * folder requests its subfolders in turn, a few levels deep, so that they
+ * are being listed while the walk matches the items of the folder. The
+ * latest requests are listed first, which follows the depth-first order
+ * of the walk. A folder which is needed but not listed yet is listed on
+ * the calling thread.
+ *
+ * Listings are reused once released, so their arrays keep their capacity.
+ * Subfolders the walk skips must be discarded, they are kept otherwise.
+ */
+class DirEnumPool
+{
+public:
+	/** @brief Subfolders and files of a folder. */
+	struct Listing
+	{
+		DirItemArray dirs;
+		DirItemArray files;
+	};
+	/** @brief Lists a folder, called on any thread. */
+	using LoadFunc = std::function<void(const String& sDir, DirItemArray *dirs, DirItemArray *files)>;
+
+	static constexpr int DefaultPrefetchLevels = 2; /**< Levels of subfolders listed ahead of the walk */
+	static constexpr size_t MaxPrefetched = 4096; /**< Folders listed ahead of the walk at most */
+
+	DirEnumPool(const LoadFunc& load, int nThreads, int prefetchLevels = DefaultPrefetchLevels);
+	~DirEnumPool();
+	DirEnumPool(const DirEnumPool&) = delete;
+	DirEnumPool& operator=(const DirEnumPool&) = delete;
+
+	void Request(const String& sDir);
+	Listing *Get(const String& sDir);
+	void Release(Listing *listing);
+	void Discard(const String& sDir);
+	size_t GetPendingCount() const;
+
+private:
+	enum class State { Queued, Loading, Done };
+	struct Entry
+	{
+		State state;
+		int levels; /**< Levels of subfolders requested when listed */
+		bool discarded; /**< Dropped while being listed */
+		Listing *listing;
+	};
+
+	void RequestLocked(const String& sDir, int levels, bool prefetch);
+	void RequestSubdirsLocked(const String& sDir, const Entry& entry);
+	void DiscardLocked(const String& sDir);
+	void Load(const String& sDir);
+	Listing *AcquireLocked();
+	void ReleaseLocked(Listing *listing);
+	void Run();
+
+	LoadFunc m_load;
+	int m_prefetchLevels;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_queued; /**< Signals workers of new requests */
+	std::condition_variable m_done; /**< Signals Get() of finished listings */
+	std::unordered_map<String, Entry> m_entries;
+	std::deque<String> m_queue; /**< Folders to list, next first */
+	std::vector<std::unique_ptr<Listing>> m_listings; /**< All listings, they live as long as the pool */
+	std::vector<Listing *> m_free;
+	std::vector<std::thread> m_threads;
+	bool m_stop;
+};
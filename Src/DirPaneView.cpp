@@ -1073,7 +1073,7 @@ void CDirPaneView::OpenSelectedItem()
 		if (di.diffcode.exists(i) && paths::DoesPathExist(paths[i]) != paths::DOES_NOT_EXIST)
 		{
 			fileloc[i].setPath(paths[i]);
-			fileloc[i].encoding = di.diffFileInfo[i].encoding;
+			fileloc[i].encoding = di.diffFileInfo[i].GetEncoding();
 			filteredPaths.SetPath(filteredPaths.GetSize(), paths[i], false);
 		}
 		else
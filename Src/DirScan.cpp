@@ -7,20 +7,18 @@
 #include "pch.h"
 #include "DirScan.h"
 #include <cassert>
+#include <atomic>
 #include <memory>
-#include <thread>
+#include <vector>
 #define POCO_NO_UNWINDOWS 1
 #include <Poco/Semaphore.h>
-#include <Poco/Notification.h>
-#include <Poco/NotificationQueue.h>
 #include <Poco/Environment.h>
 #include <Poco/ThreadPool.h>
-#include <Poco/Thread.h>
 #include <Poco/Runnable.h>
 #include <Poco/Mutex.h>
-#include <Poco/AutoPtr.h>
 #include <Poco/Stopwatch.h>
 #include "DiffThread.h"
+#include "WorkStealingQueue.h"
 #include "UnicodeString.h"
 #include "DiffWrapper.h"
 #include "CompareStats.h"
@@ -28,16 +26,13 @@
 #include "FileFilterHelper.h"
 #include "DirItem.h"
 #include "DirTravel.h"
+#include "DirEnumPool.h"
 #include "paths.h"
 #include "Plugins.h"
 #include "MergeAppCOMClass.h"
 #include "PathContext.h"
 #include "DebugNew.h"
 
-using Poco::NotificationQueue;
-using Poco::Notification;
-using Poco::AutoPtr;
-using Poco::Thread;
 using Poco::ThreadPool;
 using Poco::Runnable;
 using Poco::Environment;
@@ -50,34 +45,80 @@ static DIFFITEM *AddToList(const String &sLeftDir, const String &sRightDir, cons
 static DIFFITEM *AddToList(const String &sDir1, const String &sDir2, const String &sDir3, const DirItem *ent1, const DirItem *ent2, const DirItem *ent3,
 	unsigned code, DiffFuncStruct *myStruct, DIFFITEM *parent, int nItems = 3);
 static void UpdateDiffItem(DIFFITEM &di, bool &bExists, CDiffContext *pCtxt);
-static int CompareItems(NotificationQueue &queue, DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos);
 static unsigned GetDirCompareFlags3Way(const DIFFITEM& di);
+static int GetItems(DirEnumPool& pool, const PathContext &paths, const String subdir[],
+	DiffFuncStruct *myStruct, bool casesensitive, int depth, DIFFITEM *parent, bool bUniques);
 
-class WorkNotification: public Poco::Notification
+namespace
 {
-public:
-	WorkNotification(DIFFITEM& di, NotificationQueue& queueResult): m_di(di), m_queueResult(queueResult) {}
-	DIFFITEM& data() const { return m_di; }
-	NotificationQueue& queueResult() const { return m_queueResult; }
-private:
-	DIFFITEM& m_di;
-	NotificationQueue& m_queueResult;
+
+/**
+ * @brief Compare-time bookkeeping for one folder level.
+ * A level is finished when all of its children have been compared. The
+ * thread that finishes the last child then sets the folder's own result and
+ * reports it to the parent level, so the producer never has to wait for a
+ * folder's children before moving on to the next folder.
+ */
+struct DirLevel
+{
+	void Init(DIFFITEM *pdi, DirLevel *pParent)
+	{
+		di = pdi;
+		parent = pParent;
+		nPending = 1;
+		nDiffs = 0;
+		bFailure = false;
+	}
+	DIFFITEM *di; /**< Folder item of the level, or nullptr for the root level */
+	DirLevel *parent; /**< Parent level, or nullptr for the root level */
+	std::atomic_int nPending; /**< Unfinished children, plus one held while the level is being walked */
+	std::atomic_int nDiffs; /**< Differences in this level and its subfolders */
+	std::atomic_bool bFailure; /**< Were there compare errors in this level or its subfolders? */
 };
 
-class WorkCompletedNotification: public Poco::Notification
+/** @brief An item queued for compare, with the level it reports to. */
+struct CompareTask
+{
+	DIFFITEM *di;
+	DirLevel *level;
+};
+
+/**
+ * @brief Allocates objects in chunks that live until the pool is destroyed.
+ * Only used from the producer thread; objects never move once allocated, so
+ * workers can keep pointers to them.
+ */
+template <class T>
+class ChunkedPool
 {
 public:
-	explicit WorkCompletedNotification(DIFFITEM& di): m_di(di) {}
-	DIFFITEM& data() const { return m_di; }
+	T *Alloc()
+	{
+		if (m_nUsed == ChunkSize)
+		{
+			m_chunks.emplace_back(new T[ChunkSize]);
+			m_nUsed = 0;
+		}
+		return &m_chunks.back()[m_nUsed++];
+	}
 private:
-	DIFFITEM& m_di;
+	static constexpr size_t ChunkSize = 1024;
+	std::vector<std::unique_ptr<T[]>> m_chunks;
+	size_t m_nUsed = ChunkSize;
 };
 
+typedef WorkStealingScheduler<CompareTask> CompareScheduler;
+
+}
+
+static void CompleteItem(CDiffContext *pCtxt, DirLevel *level, const DIFFITEM &di);
+static void CompleteLevel(CDiffContext *pCtxt, DirLevel *level);
+
 class DiffWorker: public Runnable
 {
 public:
-	DiffWorker(NotificationQueue& queue, CDiffContext *pCtxt, int id):
-	  m_queue(queue), m_pCtxt(pCtxt), m_id(id) {}
+	DiffWorker(CompareScheduler& scheduler, CDiffContext *pCtxt, int id):
+	  m_scheduler(scheduler), m_pCtxt(pCtxt), m_id(id) {}
 
 	void run()
 	{
@@ -85,36 +126,69 @@ public:
 		// keep the scripts alive during the Rescan
 		// when we exit the thread, we delete this and release the scripts
 		CAssureScriptsForThread scriptsForRescan(new MergeAppCOMClass());
+		CompareStats *pStats = m_pCtxt->m_pCompareStats;
 
-		AutoPtr<Notification> pNf(m_queue.waitDequeueNotification());
-		while (pNf.get() != nullptr)
-		{
-			WorkNotification* pWorkNf = dynamic_cast<WorkNotification*>(pNf.get());
-			if (pWorkNf != nullptr) {
-				m_pCtxt->m_pCompareStats->BeginCompare(&pWorkNf->data(), m_id);
+		m_scheduler.RunWorker(m_id,
+			[&](CompareTask& task)
+			{
+				pStats->BeginCompare(task.di, m_id);
 				if (!m_pCtxt->ShouldAbort())
-					CompareDiffItem(fc, pWorkNf->data());
-				pWorkNf->queueResult().enqueueNotification(new WorkCompletedNotification(pWorkNf->data()));
-			}
-			if (m_pCtxt->m_pCompareStats->IsIdleCompareThread(m_id))
+					CompareDiffItem(fc, *task.di);
+				CompleteItem(m_pCtxt, task.level, *task.di);
+			},
+			[&]()
 			{
-				m_pCtxt->m_pCompareStats->BeginCompare(nullptr, m_id);
-				while (!m_pCtxt->ShouldAbort() && m_pCtxt->m_pCompareStats->IsIdleCompareThread(m_id))
-					Poco::Thread::sleep(10);
-			}
-
-			pNf = m_queue.waitDequeueNotification();
-		}
+				if (!pStats->IsIdleCompareThread(m_id))
+					return false;
+				pStats->BeginCompare(nullptr, m_id);
+				return !m_pCtxt->ShouldAbort();
+			});
 	}
 
 private:
-	NotificationQueue& m_queue;
+	CompareScheduler& m_scheduler;
 	CDiffContext *m_pCtxt;
 	int m_id;
 };
 
 typedef std::shared_ptr<DiffWorker> DiffWorkerPtr;
 
+/**
+ * @brief Walks the compare-time item tree and feeds items to the scheduler.
+ *
+ * Runs on the compare thread, following the collect thread (one semaphore
+ * count per collected item). File items are submitted in batches of
+ * consecutive siblings; folder items are completed by whichever thread
+ * finishes their last child. Files which exist on all sides are submitted
+ * as urgent, they are compared before the unique files queued earlier.
+ */
+class CompareProducer
+{
+public:
+	CompareProducer(DiffFuncStruct *myStruct, CompareScheduler& scheduler)
+		: m_myStruct(myStruct), m_pCtxt(myStruct->context), m_scheduler(scheduler)
+	{
+		m_batch.reserve(BatchSize);
+		m_urgentBatch.reserve(BatchSize);
+	}
+	int Run(DIFFITEM *parentdiffpos);
+
+private:
+	void QueueLevel(DIFFITEM *parentdiffpos, DirLevel *level);
+	void WaitForItem();
+	void Flush();
+
+	static constexpr size_t BatchSize = 64;
+	DiffFuncStruct *m_myStruct;
+	CDiffContext *m_pCtxt;
+	CompareScheduler& m_scheduler;
+	ChunkedPool<DirLevel> m_levels;
+	ChunkedPool<CompareTask> m_tasks;
+	std::vector<CompareTask *> m_batch;
+	std::vector<CompareTask *> m_urgentBatch; /**< Files existing on all sides */
+	Stopwatch m_stopwatch;
+};
+
 /**
  * @brief Collect file- and folder-names to list.
  * This function walks given folders and adds found subfolders and files into
@@ -125,6 +199,15 @@ typedef std::shared_ptr<DiffWorker> DiffWorkerPtr;
  *   contain into list.
  *
  * Items are tested against file filters in this function.
+ *
+ * Items of one folder are added in the order: subfolders, files, then the
+ * contents of each subfolder in turn. CompareProducer::QueueLevel() follows
+ * exactly this order, taking one semaphore count per item, so that compare
+ * runs while the items are still being collected.
+ *
+ * The folders are listed by a DirEnumPool, all sides of a folder in
+ * parallel, and the subfolders of the folders being walked ahead of the
+ * walk.
  * 
  * @param [in] paths Root paths of compare
  * @param [in] leftsubdir Left side subdirectory under root path
@@ -142,6 +225,19 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 		DiffFuncStruct *myStruct,
 		bool casesensitive, int depth, DIFFITEM *parent,
 		bool bUniques)
+{
+	const int nThreads = (std::max)(paths.GetSize(), static_cast<int>(Environment::processorCount()));
+	const int prefetchLevels = (depth < 0) ? DirEnumPool::DefaultPrefetchLevels : (std::min)(depth, DirEnumPool::DefaultPrefetchLevels);
+	DirEnumPool pool([casesensitive](const String& sDir, DirItemArray *dirs, DirItemArray *files)
+		{
+			DirTravel::LoadAndSortFiles(sDir, dirs, files, casesensitive);
+		}, nThreads, prefetchLevels);
+	return GetItems(pool, paths, subdir, myStruct, casesensitive, depth, parent, bUniques);
+}
+
+/** @brief Collect the items of a folder, see DirScan_GetItems(). */
+static int GetItems(DirEnumPool& pool, const PathContext &paths, const String subdir[],
+	DiffFuncStruct *myStruct, bool casesensitive, int depth, DIFFITEM *parent, bool bUniques)
 {
 	static const tchar_t backslash[] = _T("\\");
 	int nDirs = paths.GetSize();
@@ -161,26 +257,17 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 	}
 
 	DirItemArray dirs[3], aFiles[3];
-	// Scan left/right directories in parallel for better I/O throughput
-	if (nDirs >= 2)
+	// Scan left/right directories in parallel for better I/O throughput.
+	// The arrays are swapped with those of the listings and given back
+	// before walking the subfolders, so the listings are reused.
+	DirEnumPool::Listing *listings[3] = {};
+	for (int nIndex = 0; nIndex < nDirs; nIndex++)
+		pool.Request(sDir[nIndex]);
+	for (int nIndex = 0; nIndex < nDirs; nIndex++)
 	{
-		std::thread threads[3];
-		for (int nIndex = 0; nIndex < nDirs; nIndex++)
-		{
-			threads[nIndex] = std::thread([&, nIndex]() {
-				try {
-					DirTravel::LoadAndSortFiles(sDir[nIndex], &dirs[nIndex], &aFiles[nIndex], casesensitive);
-				} catch (...) {
-					// Swallow to prevent std::terminate() — empty arrays means orphans
-				}
-			});
-		}
-		for (int nIndex = 0; nIndex < nDirs; nIndex++)
-			threads[nIndex].join();
-	}
-	else
-	{
-		DirTravel::LoadAndSortFiles(sDir[0], &dirs[0], &aFiles[0], casesensitive);
+		listings[nIndex] = pool.Get(sDir[nIndex]);
+		dirs[nIndex].swap(listings[nIndex]->dirs);
+		aFiles[nIndex].swap(listings[nIndex]->files);
 	}
 
 	// Allow user to abort scanning
@@ -196,9 +283,32 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 		for (nIndex = 0; nIndex < nDirs; nIndex++)
 			if (dirs[nIndex].size() != 0 || aFiles[nIndex].size() != 0) break;
 		if (nIndex == nDirs)
+		{
+			for (nIndex = 0; nIndex < nDirs; nIndex++)
+				pool.Release(listings[nIndex]);
 			return 0;
+		}
 	}
 
+	// Subfolders to walk after the files of this level have been added
+	struct PendingSubdir
+	{
+		DIFFITEM *di;
+		String subdir[3];
+	};
+	std::vector<PendingSubdir> subdirs;
+
+	// Subfolders which aren't walked may have been listed ahead
+	auto discardSubdir = [&](unsigned nDiffCode, DirItemArray::size_type i, DirItemArray::size_type j, DirItemArray::size_type k)
+	{
+		const DirItemArray::size_type index[3] = { i, j, k };
+		for (int nIndex = 0; nIndex < nDirs; nIndex++)
+		{
+			if (nDiffCode & (DIFFCODE::FIRST << nIndex))
+				pool.Discard(paths::ConcatPath(sDir[nIndex], dirs[nIndex][index[nIndex]].filename.get()));
+		}
+	};
+
 	DirItemArray::size_type i=0, j=0, k=0;
 	while (true)
 	{
@@ -302,14 +412,9 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 					(nDiffCode & DIFFCODE::SECOND) ? &dirs[1][j] : nullptr,
 					nDiffCode, myStruct, parent);
 				if ((me->diffcode.diffcode & DIFFCODE::SKIPPED) == 0 && ((nDiffCode & DIFFCODE::SIDEFLAGS) == DIFFCODE::BOTH || bUniques))
-				{
-					// Scan recursively all subdirectories too, we are not adding folders
-					String newsubdir[3] = {leftnewsub, rightnewsub};
-					int result = DirScan_GetItems(paths, newsubdir, myStruct, casesensitive,
-							depth - 1, me, bUniques);
-					if (result == -1)
-						return -1;
-				}
+					subdirs.push_back({ me, { leftnewsub, rightnewsub } });
+				else
+					discardSubdir(nDiffCode, i, j, k);
 			}
 			else
 			{
@@ -319,14 +424,9 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 					(nDiffCode & DIFFCODE::THIRD ) ? &dirs[2][k] : nullptr,
 					nDiffCode, myStruct, parent);
 				if ((me->diffcode.diffcode & DIFFCODE::SKIPPED) == 0 && ((nDiffCode & DIFFCODE::SIDEFLAGS) == DIFFCODE::ALL || bUniques))
-				{
-					// Scan recursively all subdirectories too, we are not adding folders
-					String newsubdir[3] = {leftnewsub, middlenewsub, rightnewsub};
-					int result = DirScan_GetItems(paths, newsubdir, myStruct, casesensitive,
-							depth - 1, me, bUniques);
-					if (result == -1)
-						return -1;
-				}
+					subdirs.push_back({ me, { leftnewsub, middlenewsub, rightnewsub } });
+				else
+					discardSubdir(nDiffCode, i, j, k);
 			}
 		}
 		if (nDiffCode & DIFFCODE::FIRST)
@@ -447,6 +547,24 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 		break;
 	}
 
+	for (int nIndex = 0; nIndex < nDirs; nIndex++)
+	{
+		dirs[nIndex].swap(listings[nIndex]->dirs);
+		aFiles[nIndex].swap(listings[nIndex]->files);
+		pool.Release(listings[nIndex]);
+	}
+
+	// Scan recursively all subdirectories too. This is done only now so that
+	// the compare thread gets the files of this folder as soon as they are
+	// listed, instead of after the whole subtree has been walked.
+	for (const auto& pending : subdirs)
+	{
+		int result = GetItems(pool, paths, pending.subdir, myStruct, casesensitive,
+				depth - 1, pending.di, bUniques);
+		if (result == -1)
+			return -1;
+	}
+
 	if (parent != nullptr)
 	{
 		for (int nIndex = 0; nIndex < nDirs; ++nIndex)
@@ -491,123 +609,196 @@ int DirScan_CompareItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
 
 	ThreadPool threadPool(nworkers, nworkers);
 	std::vector<DiffWorkerPtr> workers;
-	NotificationQueue queue;
+	CompareScheduler scheduler(nworkers);
 	myStruct->context->m_pCompareStats->SetCompareThreadCount(nworkers);
 	workers.reserve(nworkers);
 	for (int i = 0; i < nworkers; ++i)
 	{
-		workers.emplace_back(std::make_shared<DiffWorker>(queue, myStruct->context, i));
+		workers.emplace_back(std::make_shared<DiffWorker>(scheduler, myStruct->context, i));
 		threadPool.start(*workers[i]);
 	}
 
-	int res = CompareItems(queue, myStruct, parentdiffpos);
+	CompareProducer producer(myStruct, scheduler);
+	int res = producer.Run(parentdiffpos);
 
 	myStruct->context->m_pCompareStats->SetIdleCompareThreadCount(0);
-	Thread::sleep(100);
-	queue.wakeUpAll();
+	scheduler.Shutdown();
 	threadPool.joinAll();
 
 	return res;
 }
 
-static int CompareItems(NotificationQueue& queue, DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
+/**
+ * @brief Queue all items under @p parentdiffpos and wait until they are compared.
+ * @return >= 0 number of diff items, -1 if compare was aborted or failed
+ */
+int CompareProducer::Run(DIFFITEM *parentdiffpos)
 {
-	NotificationQueue queueResult;
-	Stopwatch stopwatch;
-	CDiffContext *pCtxt = myStruct->context;
-	int res = 0;
-	int count = 0;
-	bool bCompareFailure = false;
+	DirLevel *root = m_levels.Alloc();
+	root->Init(parentdiffpos, nullptr);
 	if (parentdiffpos == nullptr)
-		myStruct->pSemaphore->wait();
-	stopwatch.start();
-	int nDirs = pCtxt->GetCompareDirs();
-	DIFFITEM *pos = pCtxt->GetFirstChildDiffPosition(parentdiffpos);
+		m_myStruct->pSemaphore->wait();
+	m_stopwatch.start();
+
+	QueueLevel(parentdiffpos, root);
+	Flush();
+
+	CompleteLevel(m_pCtxt, root);
+	m_scheduler.WaitIdle();
+
+	if (root->bFailure && parentdiffpos != nullptr)
+	{
+		parentdiffpos->diffcode.diffcode |= DIFFCODE::CMPERR;
+		parentdiffpos->UpdateFolderCounts();
+	}
+	return root->bFailure || m_pCtxt->ShouldAbort() ? -1 : root->nDiffs.load();
+}
+
+/**
+ * @brief Queue the items of one folder, then walk its subfolders.
+ * This is the order in which DirScan_GetItems() adds the items.
+ */
+void CompareProducer::QueueLevel(DIFFITEM *parentdiffpos, DirLevel *level)
+{
+	std::vector<DirLevel *> sublevels;
+	DIFFITEM *pos = m_pCtxt->GetFirstChildDiffPosition(parentdiffpos);
 	while (pos != nullptr)
 	{
-		if (pCtxt->ShouldAbort())
+		if (m_pCtxt->ShouldAbort())
 			break;
 
-		if (stopwatch.elapsed() > 2000000)
+		if (m_stopwatch.elapsed() > 2000000)
 		{
 			int event = CDiffThread::EVENT_COMPARE_PROGRESSED;
-			myStruct->m_listeners.notify(myStruct, event);
-			stopwatch.restart();
+			m_myStruct->m_listeners.notify(m_myStruct, event);
+			m_stopwatch.restart();
 		}
-		myStruct->pSemaphore->wait();
+		WaitForItem();
 		DIFFITEM *curpos = pos;
-		DIFFITEM &di = pCtxt->GetNextSiblingDiffRefPosition(pos);
-		bool existsalldirs = di.diffcode.existAll();
-		if (di.diffcode.isDirectory() && pCtxt->m_bRecursive)
+		DIFFITEM &di = m_pCtxt->GetNextSiblingDiffRefPosition(pos);
+		++level->nPending;
+		if (di.diffcode.isDirectory() && m_pCtxt->m_bRecursive)
 		{
 			if ((di.diffcode.diffcode & DIFFCODE::CMPERR) != DIFFCODE::CMPERR)
 			{	// Only clear DIFF|SAME flags if not CMPERR (eg. both flags together)
 				di.diffcode.diffcode &= ~(DIFFCODE::DIFF | DIFFCODE::SAME);
+				di.UpdateFolderCounts();
 			}
-			int ndiff = CompareItems(queue, myStruct, curpos);
-			// Propagate sub-directory status to this directory
-			if (ndiff > 0)
-			{	// There were differences in the sub-directories
-				if (existsalldirs || pCtxt->m_bWalkUniques)
-					di.diffcode.diffcode |= DIFFCODE::DIFF;
-				res += ndiff;
-			}
-			else 
-			if (ndiff == 0)
-			{	// Sub-directories were identical
-				if (existsalldirs)
-					di.diffcode.diffcode |= DIFFCODE::SAME;
-				else if (pCtxt->m_bWalkUniques && !di.diffcode.isResultFiltered())
-					di.diffcode.diffcode |= DIFFCODE::DIFF;
-			}
-			else
-			if (ndiff == -1)
-			{	// There were file IO-errors during sub-directory comparison.
-				di.diffcode.diffcode |= DIFFCODE::CMPERR;
-				bCompareFailure = true;
-			}
-
-			if (nDirs == 3 && (di.diffcode.diffcode & DIFFCODE::COMPAREFLAGS) == DIFFCODE::DIFF && !di.diffcode.isResultFiltered())
-			{
-				di.diffcode.diffcode &= ~DIFFCODE::COMPAREFLAGS3WAY;
-				di.diffcode.diffcode |= GetDirCompareFlags3Way(di);
-			}
+			DirLevel *sublevel = m_levels.Alloc();
+			sublevel->Init(&di, level);
+			sublevels.push_back(sublevel);
 		}
-		if (existsalldirs)
-			queue.enqueueUrgentNotification(new WorkNotification(di, queueResult));
 		else
-			queue.enqueueNotification(new WorkNotification(di, queueResult));
-		++count;
+		{
+			CompareTask *task = m_tasks.Alloc();
+			task->di = &di;
+			task->level = level;
+			std::vector<CompareTask *>& batch = di.diffcode.existAll() ? m_urgentBatch : m_batch;
+			batch.push_back(task);
+			if (batch.size() >= BatchSize)
+				Flush();
+		}
 		pos = curpos;
-		pCtxt->GetNextSiblingDiffRefPosition(pos);
+		m_pCtxt->GetNextSiblingDiffRefPosition(pos);
 	}
 
-	while (count > 0)
+	for (DirLevel *sublevel : sublevels)
 	{
-		AutoPtr<Notification> pNf(queueResult.waitDequeueNotification());
-		if (pNf.get() == nullptr)
-			break;
-		WorkCompletedNotification* pWorkCompletedNf = dynamic_cast<WorkCompletedNotification*>(pNf.get());
-		if (pWorkCompletedNf != nullptr) {
-			DIFFITEM &di = pWorkCompletedNf->data();
-			if (di.diffcode.isResultError()) { 
-				DIFFITEM *diParent = di.GetParentLink();
-				assert(diParent != nullptr);
-				if (diParent != nullptr)
-				{
-					diParent->diffcode.diffcode |= DIFFCODE::CMPERR;
-					bCompareFailure = true;
-				}
-			}
-				
-			if (di.diffcode.isResultDiff() ||
-				(!di.diffcode.existAll() && !di.diffcode.isResultFiltered()))
-				res++;
-		}
-		--count;
+		QueueLevel(sublevel->di, sublevel);
+		CompleteLevel(m_pCtxt, sublevel);
 	}
+}
 
-	return bCompareFailure || pCtxt->ShouldAbort() ? -1 : res;
+/**
+ * @brief Wait until the collect thread has added the next item.
+ * Pending items are submitted before blocking so that workers are not
+ * starved while the collect thread is slow (e.g. on network shares).
+ */
+void CompareProducer::WaitForItem()
+{
+	if (m_myStruct->pSemaphore->tryWait(0))
+		return;
+	Flush();
+	m_myStruct->pSemaphore->wait();
+}
+
+void CompareProducer::Flush()
+{
+	m_scheduler.Submit(m_urgentBatch.data(), m_urgentBatch.size(), true);
+	m_urgentBatch.clear();
+	m_scheduler.Submit(m_batch.data(), m_batch.size());
+	m_batch.clear();
+}
+
+/**
+ * @brief Account a compared item to its level.
+ * Called on the thread that compared the item.
+ */
+static void CompleteItem(CDiffContext *pCtxt, DirLevel *level, const DIFFITEM &di)
+{
+	if (di.diffcode.isResultError())
+		level->bFailure = true;
+	if (di.diffcode.isResultDiff() ||
+		(!di.diffcode.existAll() && !di.diffcode.isResultFiltered()))
+		++level->nDiffs;
+	CompleteLevel(pCtxt, level);
+}
+
+/**
+ * @brief Release one pending count of @p level.
+ * When the count drops to zero all children of the folder have been compared,
+ * so set the folder's result from its children and report it to the parent
+ * level, which may in turn complete.
+ */
+static void CompleteLevel(CDiffContext *pCtxt, DirLevel *level)
+{
+	const int nDirs = pCtxt->GetCompareDirs();
+	while (level->parent != nullptr && --level->nPending == 0)
+	{
+		DIFFITEM &di = *level->di;
+		DirLevel *parent = level->parent;
+		bool existsalldirs = di.diffcode.existAll();
+		int ndiff = level->bFailure ? -1 : level->nDiffs.load();
+		// Propagate sub-directory status to this directory
+		if (ndiff > 0)
+		{	// There were differences in the sub-directories
+			if (existsalldirs || pCtxt->m_bWalkUniques)
+				di.diffcode.diffcode |= DIFFCODE::DIFF;
+			parent->nDiffs += ndiff;
+		}
+		else
+		if (ndiff == 0)
+		{	// Sub-directories were identical
+			if (existsalldirs)
+				di.diffcode.diffcode |= DIFFCODE::SAME;
+			else if (pCtxt->m_bWalkUniques && !di.diffcode.isResultFiltered())
+				di.diffcode.diffcode |= DIFFCODE::DIFF;
+		}
+		else
+		{	// There were file IO-errors during sub-directory comparison.
+			di.diffcode.diffcode |= DIFFCODE::CMPERR;
+		}
+
+		if (nDirs == 3 && (di.diffcode.diffcode & DIFFCODE::COMPAREFLAGS) == DIFFCODE::DIFF && !di.diffcode.isResultFiltered())
+		{
+			di.diffcode.diffcode &= ~DIFFCODE::COMPAREFLAGS3WAY;
+			di.diffcode.diffcode |= GetDirCompareFlags3Way(di);
+		}
+
+		// Folders are not compared themselves, just counted (see CompareDiffItem())
+		di.diffcode.diffcode &= ~DIFFCODE::NEEDSCAN;
+		di.UpdateFolderCounts();
+		pCtxt->m_pCompareStats->AddItem(di.diffcode.diffcode);
+
+		if (di.diffcode.isResultError())
+			parent->bFailure = true;
+		if (di.diffcode.isResultDiff() ||
+			(!existsalldirs && !di.diffcode.isResultFiltered()))
+			++parent->nDiffs;
+		level = parent;
+	}
+	if (level->parent == nullptr)
+		--level->nPending;
 }
 
 /**
@@ -682,6 +873,7 @@ static int CompareRequestedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffp
 					di.diffcode.diffcode &= ~DIFFCODE::COMPAREFLAGS3WAY;
 					di.diffcode.diffcode |= GetDirCompareFlags3Way(di);
 				}
+				di.UpdateFolderCounts();
 			}
 		}
 		else
@@ -697,6 +889,7 @@ static int CompareRequestedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffp
 					if (diParent != nullptr)
 					{
 						diParent->diffcode.diffcode |= DIFFCODE::CMPERR;
+						diParent->UpdateFolderCounts();
 						bCompareFailure = true;
 					}
 				}
@@ -764,6 +957,7 @@ int DirScan_UpdateMarkedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
 				delete &di;					// Also delete all Children items
 				continue;					// (... because `di` is now invalid)
 			}
+			di.UpdateFolderCounts();
 			if (!di.diffcode.isDirectory())
 				++ncount;
 		}
@@ -881,12 +1075,13 @@ static void CompareDiffItem(FolderCmp &fc, DIFFITEM &di)
 				// Set text statistics
 				if (di.diffcode.exists(i))
 				{
-					di.diffFileInfo[i].m_textStats = fc.m_diffFileData.m_textStats[i];
-					di.diffFileInfo[i].encoding = fc.m_diffFileData.m_FileLocation[i].encoding;
+					di.diffFileInfo[i].GetTextStatsRef() = fc.m_diffFileData.m_textStats[i];
+					di.diffFileInfo[i].GetEncodingRef() = fc.m_diffFileData.m_FileLocation[i].encoding;
 				}
 			}
 		}
 	}
+	di.UpdateFolderCounts();
 	pCtxt->m_pCompareStats->AddItem(di.diffcode.diffcode);
 }
 
@@ -1012,7 +1207,7 @@ static DIFFITEM* AddToList(const String& sDir1, const String& sDir2, const Strin
 				pCtxt->GetComparePaths(*di, tFiles);
 				for (int i = 0; i < nItems; ++i)
 				{
-					auto& properties = di->diffFileInfo[i].m_pAdditionalProperties;
+					auto& properties = di->diffFileInfo[i].GetAdditionalPropertiesRef();
 					if (properties)
 						continue; // already have properties
 					if (di->diffcode.exists(i))
@@ -1030,6 +1225,9 @@ static DIFFITEM* AddToList(const String& sDir1, const String& sDir2, const Strin
 		}
 	}
 
+	// The item was counted in its parent's folder counts when added, before its diffcode was set
+	di->UpdateFolderCounts();
+
 	if (!myStruct->bMarkedRescan && myStruct->m_fncCollect)
 	{
 		myStruct->context->m_pCompareStats->IncreaseTotalItems();
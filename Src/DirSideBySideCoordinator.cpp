@@ -257,7 +257,6 @@ void CDirSideBySideCoordinator::BuildRowMappingChildren(DIFFITEM *diffpos, int l
  */
 void CDirSideBySideCoordinator::Redisplay()
 {
-	InvalidateFolderStatusCache();
 	BuildRowMapping();
 	UpdateStatusCounts();
 
@@ -289,79 +288,29 @@ void CDirSideBySideCoordinator::SwapSides()
 
 /**
  * @brief Compute the content status of a folder item.
- * Recursively scans children to determine if they are all same,
- * all different, unique-only, or mixed.
+ * Reads the counts of the items below the folder, which the compare keeps
+ * up to date (see DIFFITEM::UpdateFolderCounts()), so this doesn't walk
+ * the subtree and is valid while the compare is still running.
  */
 FolderContentStatus CDirSideBySideCoordinator::ComputeFolderContentStatus(const DIFFITEM &di) const
 {
 	if (!di.HasChildren() || !m_pDoc || !m_pDoc->HasDiffs())
 		return FOLDER_STATUS_UNKNOWN;
 
-	// Check cache first — avoids expensive recursive tree walks on every draw
-	auto it = m_folderStatusCache.find(&di);
-	if (it != m_folderStatusCache.end())
-		return it->second;
-
-	const CDiffContext &ctxt = m_pDoc->GetDiffContext();
-
-	bool hasSame = false;
-	bool hasDiff = false;
-	bool hasUnique = false;
-
-	DIFFITEM *childpos = ctxt.GetFirstChildDiffPosition(const_cast<DIFFITEM*>(&di));
-	while (childpos != nullptr)
-	{
-		const DIFFITEM &child = ctxt.GetNextSiblingDiffPosition(childpos);
-
-		if (child.diffcode.isResultFiltered())
-			continue;
-
-		if (!IsItemExistAll(ctxt, child))
-			hasUnique = true;
-		else if (child.diffcode.isResultSame())
-			hasSame = true;
-		else if (child.diffcode.isResultDiff())
-			hasDiff = true;
-
-		// Recurse into subfolders
-		if (child.diffcode.isDirectory() && child.HasChildren())
-		{
-			FolderContentStatus childStatus = ComputeFolderContentStatus(child);
-			switch (childStatus)
-			{
-			case FOLDER_STATUS_ALL_SAME:
-				hasSame = true;
-				break;
-			case FOLDER_STATUS_ALL_DIFFERENT:
-				hasDiff = true;
-				break;
-			case FOLDER_STATUS_UNIQUE_ONLY:
-				hasUnique = true;
-				break;
-			case FOLDER_STATUS_MIXED:
-				hasSame = true;
-				hasDiff = true;
-				hasUnique = true;
-				break;
-			default:
-				break;
-			}
-		}
-	}
+	const FolderCounts &counts = di.GetFolderCounts();
+	const bool hasSame = counts.Get(FolderCounts::SAME) > 0;
+	const bool hasDiff = counts.Get(FolderCounts::DIFF) > 0;
+	const bool hasUnique = counts.Get(FolderCounts::UNIQUE) > 0;
 
 	int flags = (hasSame ? 1 : 0) | (hasDiff ? 2 : 0) | (hasUnique ? 4 : 0);
-	FolderContentStatus result;
 	switch (flags)
 	{
-	case 0: result = FOLDER_STATUS_UNKNOWN; break;
-	case 1: result = FOLDER_STATUS_ALL_SAME; break;
-	case 2: result = FOLDER_STATUS_ALL_DIFFERENT; break;
-	case 4: result = FOLDER_STATUS_UNIQUE_ONLY; break;
-	default: result = FOLDER_STATUS_MIXED; break;
+	case 0: return FOLDER_STATUS_UNKNOWN;
+	case 1: return FOLDER_STATUS_ALL_SAME;
+	case 2: return FOLDER_STATUS_ALL_DIFFERENT;
+	case 4: return FOLDER_STATUS_UNIQUE_ONLY;
+	default: return FOLDER_STATUS_MIXED;
 	}
-
-	m_folderStatusCache[&di] = result;
-	return result;
 }
 
 /**
@@ -12,7 +12,6 @@
 
 #include <vector>
 #include <map>
-#include <unordered_map>
 #include <memory>
 #include "UnicodeString.h"
 #include "DirActions.h"
@@ -95,12 +94,9 @@ public:
 	int GetActivePane() const { return m_nActivePane; }
 	void SetActivePane(int pane) { m_nActivePane = pane; }
 
-	/** Compute folder content status for icon determination (cached) */
+	/** Compute folder content status for icon determination (from the folder counts) */
 	FolderContentStatus ComputeFolderContentStatus(const DIFFITEM &di) const;
 
-	/** Invalidate the folder content status cache (call when comparison results change) */
-	void InvalidateFolderStatusCache() { m_folderStatusCache.clear(); }
-
 	/** Get pane-specific icon image index */
 	int GetPaneColImage(const DIFFITEM &di, int pane) const;
 
@@ -269,7 +265,4 @@ private:
 
 	/** Background scanning state */
 	bool m_bScanningInProgress;
-
-	/** Cache of computed folder content status to avoid recursive recomputation per draw */
-	mutable std::unordered_map<const DIFFITEM*, FolderContentStatus> m_folderStatusCache;
 };
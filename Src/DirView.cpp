@@ -4287,7 +4287,7 @@ void CDirView::OnMergeCompareWithRenamedMoved()
 				if (pdi->diffcode.isDirectory() && isEmpty)
 					continue;
 				paths.SetPath(j, isEmpty ?  _T("") : GetItemFileName(ctxt, *pdiTmp[nIndex], nIndex));
-				encoding[j] = pdiTmp[nIndex]->diffFileInfo[nIndex].encoding;
+				encoding[j] = pdiTmp[nIndex]->diffFileInfo[nIndex].GetEncoding();
 				dwFlags[j] = FFILEOPEN_NOMRU | (pDoc->GetReadOnly(nIndex) ? FFILEOPEN_READONLY : 0);
 				j++;
 			}
@@ -4351,7 +4351,7 @@ void CDirView::OnMergeCompareNonHorizontally()
 			if (dlg.m_pdi[n / 3])
 			{
 				paths.SetPath(nIndex, GetItemFileName(pDoc->GetDiffContext(), *dlg.m_pdi[n / 3], n % 3));
-				encoding[nIndex] = dlg.m_pdi[n / 3]->diffFileInfo[n % 3].encoding;
+				encoding[nIndex] = dlg.m_pdi[n / 3]->diffFileInfo[n % 3].GetEncoding();
 			}
 		}
 		if (paths.GetSize() == 1)
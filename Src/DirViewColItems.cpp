@@ -631,22 +631,22 @@ static String GetVersion(const CDiffContext * pCtxt, const DIFFITEM *pdi, int nI
 {
 	DIFFITEM &di = const_cast<DIFFITEM &>(*pdi);
 	DiffFileInfo & dfi = di.diffFileInfo[nIndex];
-	if (dfi.version.IsCleared())
+	if (dfi.GetVersion().IsCleared())
 	{
 		pCtxt->UpdateVersion(di, nIndex);
 	}
-	return dfi.version.GetFileVersionString();
+	return dfi.GetVersion().GetFileVersionString();
 }
 
 static uint64_t GetVersionQWORD(const CDiffContext * pCtxt, const DIFFITEM *pdi, int nIndex)
 {
 	DIFFITEM &di = const_cast<DIFFITEM &>(*pdi);
 	DiffFileInfo & dfi = di.diffFileInfo[nIndex];
-	if (dfi.version.IsCleared())
+	if (dfi.GetVersion().IsCleared())
 	{
 		pCtxt->UpdateVersion(di, nIndex);
 	}
-	return dfi.version.GetFileVersionQWORD();
+	return dfi.GetVersion().GetFileVersionQWORD();
 }
 
 /**
@@ -763,7 +763,7 @@ static String ColAttrGet(const CDiffContext *, const void *p, int)
 static String ColEncodingGet(const CDiffContext *, const void *p, int)
 {
 	const DiffFileInfo &r = *static_cast<const DiffFileInfo *>(p);
-	return r.encoding.GetName();
+	return r.GetEncoding().GetName();
 }
 
 /**
@@ -776,7 +776,7 @@ static String GetEOLType(const CDiffContext *, const void *p, int index)
 {
 	const DIFFITEM &di = *static_cast<const DIFFITEM *>(p);
 	const DiffFileInfo & dfi = di.diffFileInfo[index];
-	const FileTextStats &stats = dfi.m_textStats;
+	const FileTextStats &stats = dfi.GetTextStats();
 
 	if (stats.ncrlfs == 0 && stats.ncrs == 0 && stats.nlfs == 0)
 	{
@@ -974,19 +974,22 @@ static String ColDebugNodeGet(const CDiffContext *, const void* p, int opt)
 static String ColPropertyGet(const CDiffContext *pCtxt, const void *p, int opt)
 {
 	const DiffFileInfo &dfi = *static_cast<const DiffFileInfo *>(p);
-	PropertyValues* pprops = dfi.m_pAdditionalProperties.get();
+	PropertyValues* pprops = dfi.GetAdditionalProperties();
 	return (pprops != nullptr && opt < pprops->GetSize()) ? pCtxt->m_pPropertySystem->FormatPropertyValue(*pprops, opt) : _T("");
 }
 
 static const DuplicateInfo *GetDuplicateInfo(const CDiffContext* pCtxt, const DiffFileInfo& dfi, int index)
 {
-	PropertyValues* pprops = dfi.m_pAdditionalProperties.get();
+	PropertyValues* pprops = dfi.GetAdditionalProperties();
 	if (!pprops || index >= pprops->GetSize() || !pprops->IsHashValue(index) || pCtxt->m_duplicateValues.empty())
 		return nullptr;
-	auto it = pCtxt->m_duplicateValues[index].find(pprops->GetHashValue(index));
-	if (it == pCtxt->m_duplicateValues[index].end())
+	const std::vector<uint8_t> value = pprops->GetHashValue(index);
+	if (value.empty())
 		return nullptr;
-	return &(it->second);
+	// Values of a single file aren't in the map
+	static const DuplicateInfo unique{};
+	const DuplicateInfo *info = pCtxt->m_duplicateValues[index].Find(DigestKey(value));
+	return info ? info : &unique;
 }
 
 static String ColPropertyDuplicateCountGet(const CDiffContext *pCtxt, const void *p, int opt)
@@ -1003,10 +1006,10 @@ static String ColAllPropertyGet(const CDiffContext *pCtxt, const void *p, int op
 {
 	const DIFFITEM& di = *static_cast<const DIFFITEM*>(p);
 	bool equal = true;
-	PropertyValues* pFirstProps = di.diffFileInfo[0].m_pAdditionalProperties.get();
+	PropertyValues* pFirstProps = di.diffFileInfo[0].GetAdditionalProperties();
 	for (int i = 1; i < pCtxt->GetCompareDirs(); ++i)
 	{
-		PropertyValues* pprops = di.diffFileInfo[i].m_pAdditionalProperties.get();
+		PropertyValues* pprops = di.diffFileInfo[i].GetAdditionalProperties();
 		if (pFirstProps && pprops)
 		{
 			if (PropertyValues::CompareValues(*pFirstProps, *pprops, opt) != 0)
@@ -1019,7 +1022,7 @@ static String ColAllPropertyGet(const CDiffContext *pCtxt, const void *p, int op
 	std::vector<String> values;
 	for (int i = 0; i < pCtxt->GetCompareDirs(); ++i)
 	{
-		PropertyValues* pprops = di.diffFileInfo[i].m_pAdditionalProperties.get();
+		PropertyValues* pprops = di.diffFileInfo[i].GetAdditionalProperties();
 		if (pCtxt->GetCompareDirs() == 3 || di.diffcode.exists(i))
 			values.push_back(pprops ? pCtxt->m_pPropertySystem->FormatPropertyValue(*pprops, opt) : _T(""));
 	}
@@ -1037,7 +1040,7 @@ static String ColPropertyDiffGetEx(const CDiffContext *pCtxt, const void *p, int
 		return _("Item aborted");
 	if (di.diffcode.isResultFiltered())
 		return _("File skipped");
-	PropertyValues* pFirstProps = di.diffFileInfo[0].m_pAdditionalProperties.get();
+	PropertyValues* pFirstProps = di.diffFileInfo[0].GetAdditionalProperties();
 	if (!pFirstProps)
 		return _T("");
 	int64_t diff = 0;
@@ -1046,7 +1049,7 @@ static String ColPropertyDiffGetEx(const CDiffContext *pCtxt, const void *p, int
 	const int nDirs = pCtxt->GetCompareDirs();
 	for (int i = 1; i < nDirs; ++i)
 	{
-		PropertyValues* pprops = di.diffFileInfo[i].m_pAdditionalProperties.get();
+		PropertyValues* pprops = di.diffFileInfo[i].GetAdditionalProperties();
 		if (pFirstProps && pprops)
 		{
 			diff = PropertyValues::DiffValues(*pFirstProps, *pprops, opt, numeric);
@@ -1064,7 +1067,7 @@ static String ColPropertyDiffGetEx(const CDiffContext *pCtxt, const void *p, int
 		{
 			if (di.diffcode.exists(i))
 			{
-				PropertyValues* pprops = di.diffFileInfo[i].m_pAdditionalProperties.get();
+				PropertyValues* pprops = di.diffFileInfo[i].GetAdditionalProperties();
 				if (pprops && !pprops->IsEmptyValue(opt))
 					allempty = false;
 			}
@@ -1117,22 +1120,22 @@ static String ColPropertyMoveGet(const CDiffContext *pCtxt, const void *p, int o
 	{
 		if (di.diffcode.exists(i))
 		{
-			PropertyValues* pprops = di.diffFileInfo[i].m_pAdditionalProperties.get();
+			PropertyValues* pprops = di.diffFileInfo[i].GetAdditionalProperties();
 			if (pprops && !pCtxt->m_duplicateValues.empty())
 			{
-				auto it = pCtxt->m_duplicateValues[opt].find(pprops->GetHashValue(opt));
-				if (it != pCtxt->m_duplicateValues[opt].end())
+				const DuplicateInfo *info = pCtxt->m_duplicateValues[opt].Find(DigestKey(pprops->GetHashValue(opt)));
+				if (info)
 				{
-					if (it->second.groupid != 0 && it->second.nonpaired)
+					if (info->groupid != 0 && info->nonpaired)
 					{
 						int count = 0;
 						for (int j = 0; j < nDirs; ++j)
 						{
-							if (it->second.count[j] > 0)
+							if (info->count[j] > 0)
 								++count;
 						}
 						if (count > 1)
-							list.push_back(strutils::format(_("Group%d"), it->second.groupid));
+							list.push_back(strutils::format(_("Group%d"), info->groupid));
 					}
 				}
 			}
@@ -1333,7 +1336,7 @@ static int ColEncodingSort(const CDiffContext *, const void *p, const void *q, i
 {
 	const DiffFileInfo &r = *static_cast<const DiffFileInfo *>(p);
 	const DiffFileInfo &s = *static_cast<const DiffFileInfo *>(q);
-	return FileTextEncoding::Collate(r.encoding, s.encoding);
+	return FileTextEncoding::Collate(r.GetEncoding(), s.GetEncoding());
 }
 
 /**
@@ -1346,13 +1349,13 @@ static int ColPropertySort(const CDiffContext *, const void *p, const void *q, i
 {
 	const DiffFileInfo &r = *static_cast<const DiffFileInfo *>(p);
 	const DiffFileInfo &s = *static_cast<const DiffFileInfo *>(q);
-	if (!r.m_pAdditionalProperties && s.m_pAdditionalProperties)
+	if (!r.GetAdditionalProperties() && s.GetAdditionalProperties())
 		return -1;
-	if (r.m_pAdditionalProperties && !s.m_pAdditionalProperties)
+	if (r.GetAdditionalProperties() && !s.GetAdditionalProperties())
 		return 1;
-	if (!r.m_pAdditionalProperties && !s.m_pAdditionalProperties)
+	if (!r.GetAdditionalProperties() && !s.GetAdditionalProperties())
 		return 0;
-	return PropertyValues::CompareValues(*r.m_pAdditionalProperties, *s.m_pAdditionalProperties, opt);
+	return PropertyValues::CompareValues(*r.GetAdditionalProperties(), *s.GetAdditionalProperties(), opt);
 }
 
 /**
@@ -1402,13 +1405,13 @@ static int ColAllPropertySort(const CDiffContext *pCtxt, const void *p, const vo
 	const DIFFITEM &s = *static_cast<const DIFFITEM *>(q);
 	for (int i = 0; i < pCtxt->GetCompareDirs(); ++i)
 	{
-		if (!r.diffFileInfo[i].m_pAdditionalProperties && s.diffFileInfo[i].m_pAdditionalProperties)
+		if (!r.diffFileInfo[i].GetAdditionalProperties() && s.diffFileInfo[i].GetAdditionalProperties())
 			return -1;
-		if (r.diffFileInfo[i].m_pAdditionalProperties && !s.diffFileInfo[i].m_pAdditionalProperties)
+		if (r.diffFileInfo[i].GetAdditionalProperties() && !s.diffFileInfo[i].GetAdditionalProperties())
 			return 1;
-		if (!r.diffFileInfo[i].m_pAdditionalProperties && !s.diffFileInfo[i].m_pAdditionalProperties)
+		if (!r.diffFileInfo[i].GetAdditionalProperties() && !s.diffFileInfo[i].GetAdditionalProperties())
 			return 0;
-		int result = PropertyValues::CompareValues(*r.diffFileInfo[i].m_pAdditionalProperties, *s.diffFileInfo[i].m_pAdditionalProperties, opt);
+		int result = PropertyValues::CompareValues(*r.diffFileInfo[i].GetAdditionalProperties(), *s.diffFileInfo[i].GetAdditionalProperties(), opt);
 		if (result != 0)
 			return result;
 	}
@@ -0,0 +1,283 @@
+/**
+ * @file  DuplicateFinder.cpp
+ *
+ * @brief Implementation of DuplicateFinder class.
+ */
+
+#include "pch.h"
+#include "DuplicateFinder.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <thread>
+#include "HashCalc.h"
+#include "IAbortable.h"
+#include "cio.h"
+
+/** @brief Read buffer size used to hash whole files. */
+static const int FullHashBufferSize = 1024 * 1024;
+
+/**
+ * @brief Constructor.
+ * @param [in] nThreads Number of threads reading files, 0 for one per processor.
+ */
+DuplicateFinder::DuplicateFinder(int nThreads)
+: m_nThreads(nThreads > 0 ? nThreads : (std::max)(1, static_cast<int>(std::thread::hardware_concurrency())))
+, m_nPartialHashes(0)
+, m_nFullHashes(0)
+{
+}
+
+/**
+ * @brief Add a file which is read if needed.
+ * @return Index of the file for GetGroup().
+ */
+size_t DuplicateFinder::AddFile(const String& path, int64_t size)
+{
+	m_files.push_back(File{ path, size, DigestKey(nullptr, 0, size), false, false, 0 });
+	return m_files.size() - 1;
+}
+
+/**
+ * @brief Add a file by a digest of its whole content.
+ * @return Index of the file for GetGroup().
+ */
+size_t DuplicateFinder::AddDigest(int64_t size, const uint8_t *digest, size_t len)
+{
+	m_files.push_back(File{ String(), size, DigestKey(nullptr, 0, size, Given), true, false, 0 });
+	m_files.back().key = DigestKey(digest, len, size, Given);
+	return m_files.size() - 1;
+}
+
+/**
+ * @brief Group the files added with the same content.
+ * @return Number of groups, they are numbered from 1.
+ */
+int DuplicateFinder::Find(IAbortable *piAbortable)
+{
+	// Files which share their size with another file
+	DigestMap<int> sizes;
+	sizes.reserve(m_files.size());
+	for (const auto& file : m_files)
+		++sizes[DigestKey(nullptr, 0, file.size, file.key.type == Given ? Given : 0)];
+	std::vector<size_t> candidates;
+	std::vector<size_t> toRead;
+	for (size_t i = 0; i < m_files.size(); ++i)
+	{
+		File& file = m_files[i];
+		file.group = 0;
+		if (*sizes.Find(DigestKey(nullptr, 0, file.size, file.key.type == Given ? Given : 0)) < 2)
+			continue;
+		candidates.push_back(i);
+		if (file.key.type == Given)
+			continue;
+		file.complete = false;
+		file.failed = false;
+		if (file.size == 0)
+		{
+			// Empty files are all the same
+			file.key = DigestKey(nullptr, 0, 0, Full);
+			file.complete = true;
+		}
+		else
+			toRead.push_back(i);
+	}
+
+	// Partial digests, files up to two partial sizes are hashed whole
+	ForEachParallel(toRead, &DuplicateFinder::HashPartial, piAbortable);
+	DigestMap<int> partials;
+	partials.reserve(candidates.size());
+	for (size_t i : candidates)
+	{
+		if (!m_files[i].failed)
+			++partials[m_files[i].key];
+	}
+	toRead.clear();
+	for (size_t i : candidates)
+	{
+		const File& file = m_files[i];
+		if (!file.failed && !file.complete && *partials.Find(file.key) >= 2)
+			toRead.push_back(i);
+	}
+
+	// Full digests of the files still sharing their key
+	ForEachParallel(toRead, &DuplicateFinder::HashFull, piAbortable);
+	if (piAbortable != nullptr && piAbortable->ShouldAbort())
+		return 0;
+
+	// Files sharing a complete key are duplicates, a group is numbered
+	// when its second file is found
+	struct Group
+	{
+		int count;
+		int id;
+	};
+	DigestMap<Group> groups;
+	groups.reserve(candidates.size());
+	int nGroups = 0;
+	for (size_t i : candidates)
+	{
+		const File& file = m_files[i];
+		if (file.failed || !file.complete)
+			continue;
+		Group& group = groups[file.key];
+		if (++group.count == 2)
+			group.id = ++nGroups;
+	}
+	for (size_t i : candidates)
+	{
+		File& file = m_files[i];
+		if (file.failed || !file.complete)
+			continue;
+		const Group *group = groups.Find(file.key);
+		file.group = group->count >= 2 ? group->id : 0;
+	}
+	return nGroups;
+}
+
+/**
+ * @brief XXH3 digest of the whole content of a file added with AddFile(),
+ * big-endian like HashCalc gives it.
+ * @return false if Find() didn't read the file whole.
+ */
+bool DuplicateFinder::GetFullDigest(size_t index, std::vector<uint8_t>& digest) const
+{
+	const File& file = m_files[index];
+	if (file.key.type != Full || !file.complete || file.failed)
+		return false;
+	// The key of a file read whole ends with the digest of its content
+	uint64_t value;
+	if (file.size == 0)
+		value = Xxh3Hash::Hash("", 0);
+	else
+		memcpy(&value, file.key.bytes + sizeof(uint64_t), sizeof(value));
+	digest.resize(sizeof(value));
+	for (size_t b = 0; b < sizeof(value); ++b)
+		digest[b] = static_cast<uint8_t>(value >> (56 - 8 * b));
+	return true;
+}
+
+/**
+ * @brief Digest of the first and last PartialSize bytes of a file.
+ * Smaller files are read whole and their digest is complete.
+ */
+void DuplicateFinder::HashPartial(File& file)
+{
+	const bool whole = file.size <= 2 * PartialSize;
+	const size_t len = static_cast<size_t>(whole ? file.size : 2 * PartialSize);
+	std::unique_ptr<char[]> buf(new char[len]);
+	int fd = -1;
+	cio::tsopen_s(&fd, file.path, O_BINARY | O_RDONLY, _SH_DENYNO, _S_IREAD);
+	if (fd == -1)
+	{
+		file.failed = true;
+		return;
+	}
+	bool bSuccess;
+	if (whole)
+	{
+		bSuccess = cio::read_i(fd, buf.get(), static_cast<unsigned>(len)) == static_cast<int>(len);
+	}
+	else
+	{
+		bSuccess = cio::read_i(fd, buf.get(), PartialSize) == PartialSize &&
+			cio::lseek(fd, file.size - PartialSize, SEEK_SET) == file.size - PartialSize &&
+			cio::read_i(fd, buf.get() + PartialSize, PartialSize) == PartialSize;
+	}
+	cio::close(fd);
+	if (!bSuccess)
+	{
+		// Changed since it was listed
+		file.failed = true;
+		return;
+	}
+	const uint64_t digest = Xxh3Hash::Hash(buf.get(), len);
+	if (whole)
+	{
+		const uint64_t digests[2] = { digest, digest };
+		file.key = DigestKey(reinterpret_cast<const uint8_t *>(digests), sizeof(digests), file.size, Full);
+		file.complete = true;
+	}
+	else
+	{
+		file.key = DigestKey(reinterpret_cast<const uint8_t *>(&digest), sizeof(digest), file.size, Partial);
+	}
+}
+
+/**
+ * @brief Digest of the whole file, after its partial digest.
+ */
+void DuplicateFinder::HashFull(File& file)
+{
+	std::unique_ptr<char[]> buf(new char[FullHashBufferSize]);
+	int fd = -1;
+	cio::tsopen_s(&fd, file.path, O_BINARY | O_RDONLY, _SH_DENYNO, _S_IREAD);
+	if (fd == -1)
+	{
+		file.failed = true;
+		return;
+	}
+	Xxh3Hash hash;
+	int64_t total = 0;
+	for (;;)
+	{
+		const int size = cio::read_i(fd, buf.get(), FullHashBufferSize);
+		if (size <= 0)
+		{
+			file.failed = (size < 0);
+			break;
+		}
+		hash.Update(buf.get(), size);
+		total += size;
+	}
+	cio::close(fd);
+	if (total != file.size)
+		file.failed = true;
+	if (file.failed)
+		return;
+	uint64_t digests[2];
+	memcpy(&digests[0], file.key.bytes, sizeof(digests[0]));
+	digests[1] = hash.Finish();
+	file.key = DigestKey(reinterpret_cast<const uint8_t *>(digests), sizeof(digests), file.size, Full);
+	file.complete = true;
+}
+
+/**
+ * @brief Call @p fn for the files of @p indexes on up to m_nThreads threads.
+ * The calling thread is one of them. A file for which @p fn throws is
+ * marked failed.
+ */
+void DuplicateFinder::ForEachParallel(const std::vector<size_t>& indexes, void (DuplicateFinder::*fn)(File&), IAbortable *piAbortable)
+{
+	if (fn == &DuplicateFinder::HashPartial)
+		m_nPartialHashes += static_cast<int>(indexes.size());
+	else
+		m_nFullHashes += static_cast<int>(indexes.size());
+	std::atomic<size_t> next(0);
+	auto run = [&]()
+	{
+		for (size_t n = next++; n < indexes.size(); n = next++)
+		{
+			if (piAbortable != nullptr && piAbortable->ShouldAbort())
+				return;
+			File& file = m_files[indexes[n]];
+			try
+			{
+				(this->*fn)(file);
+			}
+			catch (std::exception&)
+			{
+				// Out of memory for the buffer, the file is left out
+				file.failed = true;
+			}
+		}
+	};
+	const size_t nThreads = (std::min)(static_cast<size_t>(m_nThreads), indexes.size());
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < nThreads; ++i)
+		threads.emplace_back(run);
+	run();
+	for (auto& thread : threads)
+		thread.join();
+}
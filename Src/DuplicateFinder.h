@@ -0,0 +1,199 @@
+/**
+ * @file  DuplicateFinder.h
+ *
+ * @brief Declaration of DuplicateFinder class.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+#include "UnicodeString.h"
+
+class IAbortable;
+
+/**
+ * @brief Digest of up to 32 bytes and the size of the data, as a fixed-size key.
+ * Digests longer than 32 bytes are truncated.
+ */
+struct DigestKey
+{
+	static constexpr size_t MaxLen = 32;
+
+	int64_t size;
+	uint8_t type; /**< Keeps apart keys of different kinds of digests */
+	uint8_t len;
+	uint8_t bytes[MaxLen];
+
+	DigestKey() : size(0), type(0), len(0), bytes{} {}
+	DigestKey(const uint8_t *digest, size_t digestLen, int64_t size = 0, uint8_t type = 0)
+		: size(size), type(type), len(static_cast<uint8_t>(digestLen < MaxLen ? digestLen : MaxLen)), bytes{}
+	{
+		if (len > 0)
+			memcpy(bytes, digest, len);
+	}
+	explicit DigestKey(const std::vector<uint8_t>& digest) : DigestKey(digest.data(), digest.size()) {}
+
+	bool operator==(const DigestKey& other) const
+	{
+		return size == other.size && type == other.type && len == other.len && memcmp(bytes, other.bytes, len) == 0;
+	}
+	/** @brief Hash of the key, the digest bytes are already well mixed. */
+	size_t Hash() const
+	{
+		uint64_t h;
+		memcpy(&h, bytes, sizeof(h));
+		h ^= static_cast<uint64_t>(size) * 0x9E3779B185EBCA87ULL + type;
+		return static_cast<size_t>(h ^ (h >> 29));
+	}
+};
+
+/**
+ * @brief Hash table from DigestKey to T, in one array with linear probing.
+ * Unlike std::map with std::vector keys, a lookup costs no allocation and
+ * touches one or two cache lines.
+ */
+template <class T>
+class DigestMap
+{
+public:
+	DigestMap() : m_count(0) {}
+
+	/** @brief Value of @p key, a default value is inserted if there is none. */
+	T& operator[](const DigestKey& key)
+	{
+		if ((m_count + 1) * 4 > m_slots.size() * 3)
+			Grow();
+		Slot& slot = Probe(key);
+		if (!slot.used)
+		{
+			slot.used = true;
+			slot.key = key;
+			slot.value = T();
+			++m_count;
+		}
+		return slot.value;
+	}
+
+	/** @brief Value of @p key, or nullptr if there is none. */
+	const T *Find(const DigestKey& key) const
+	{
+		if (m_slots.empty())
+			return nullptr;
+		const Slot& slot = const_cast<DigestMap *>(this)->Probe(key);
+		return slot.used ? &slot.value : nullptr;
+	}
+
+	size_t size() const { return m_count; }
+	bool empty() const { return m_count == 0; }
+	void clear() { m_slots.clear(); m_count = 0; }
+	void reserve(size_t count)
+	{
+		while (count * 4 > m_slots.size() * 3)
+			Grow();
+	}
+
+	/** @brief Call @p fn with the key and value of every entry. */
+	void ForEach(const std::function<void(const DigestKey& key, const T& value)>& fn) const
+	{
+		for (const auto& slot : m_slots)
+		{
+			if (slot.used)
+				fn(slot.key, slot.value);
+		}
+	}
+
+private:
+	struct Slot
+	{
+		DigestKey key;
+		T value;
+		bool used = false;
+	};
+
+	/** @brief Slot of @p key, or the empty slot where it belongs. */
+	Slot& Probe(const DigestKey& key)
+	{
+		const size_t mask = m_slots.size() - 1;
+		for (size_t i = key.Hash() & mask; ; i = (i + 1) & mask)
+		{
+			Slot& slot = m_slots[i];
+			if (!slot.used || slot.key == key)
+				return slot;
+		}
+	}
+
+	void Grow()
+	{
+		std::vector<Slot> slots(m_slots.empty() ? 16 : m_slots.size() * 2);
+		slots.swap(m_slots);
+		for (auto& slot : slots)
+		{
+			if (slot.used)
+			{
+				Slot& dst = Probe(slot.key);
+				dst = std::move(slot);
+			}
+		}
+	}
+
+	std::vector<Slot> m_slots; /**< Power of two slots, at most 3/4 used */
+	size_t m_count;
+};
+
+/**
+ * @brief Finds files with the same content.
+ *
+ * Files are bucketed by size first, a file whose size no other file has is
+ * never read. The files which share their size are bucketed by a digest of
+ * their first and last PartialSize bytes, and only those which share that
+ * too are hashed whole. Both steps read the files on a pool of threads.
+ *
+ * The XXH3 digest of a file read whole is kept, see GetFullDigest().
+ *
+ * Files can also be added with a digest of their whole content computed
+ * beforehand, e.g. a hash property, those are bucketed by size and then
+ * grouped by that digest without being read.
+ *
+ * Groups are numbered from 1 in the order their second file was added.
+ */
+class DuplicateFinder
+{
+public:
+	static constexpr int64_t PartialSize = 64 * 1024; /**< Bytes read at each end of a file by the partial digest */
+
+	explicit DuplicateFinder(int nThreads = 0);
+
+	size_t AddFile(const String& path, int64_t size);
+	size_t AddDigest(int64_t size, const uint8_t *digest, size_t len);
+	int Find(IAbortable *piAbortable = nullptr);
+
+	/** @brief Group of the file added as @p index, 0 if no other file has the same content. */
+	int GetGroup(size_t index) const { return m_files[index].group; }
+	bool GetFullDigest(size_t index, std::vector<uint8_t>& digest) const;
+	size_t GetFileCount() const { return m_files.size(); }
+	int GetPartialHashCount() const { return m_nPartialHashes; }
+	int GetFullHashCount() const { return m_nFullHashes; }
+
+private:
+	enum DigestType : uint8_t { Partial = 1, Full = 2, Given = 3 };
+	struct File
+	{
+		String path;
+		int64_t size;
+		DigestKey key; /**< Size bucket, then partial or full digest */
+		bool complete; /**< Does key hold the digest of the whole content? */
+		bool failed; /**< Couldn't be read, never a duplicate */
+		int group;
+	};
+
+	void HashPartial(File& file);
+	void HashFull(File& file);
+	void ForEachParallel(const std::vector<size_t>& indexes, void (DuplicateFinder::*fn)(File&), IAbortable *piAbortable);
+
+	int m_nThreads;
+	std::vector<File> m_files;
+	int m_nPartialHashes;
+	int m_nFullHashes;
+};
@@ -174,6 +174,37 @@ void FileFilter::CloneFrom(const FileFilter* filter)
 	}
 
 	errors = filter->errors;
+
+	if (filter->fileMatcher.IsCompiled())
+		Compile();
+	else
+	{
+		for (auto* matcher : { &fileMatcher, &fileMatcherExclude, &dirMatcher, &dirMatcherExclude })
+			matcher->Clear();
+	}
+}
+
+/**
+ * @brief Compile each regexp list into a MultiPatternMatcher.
+ * The Test functions use the matchers instead of matching the rules one by
+ * one. Must be called again after the lists are changed, until then the
+ * rules are matched one by one.
+ */
+void FileFilter::Compile()
+{
+	const std::pair<const vector<FileFilterElementPtr>*, MultiPatternMatcher*> lists[] = {
+		{ &filefilters, &fileMatcher },
+		{ &filefiltersExclude, &fileMatcherExclude },
+		{ &dirfilters, &dirMatcher },
+		{ &dirfiltersExclude, &dirMatcherExclude },
+	};
+	for (const auto& [filterList, matcher] : lists)
+	{
+		matcher->Clear();
+		for (const auto& element : *filterList)
+			matcher->AddPattern(element->_regex, element->_reOpts, element->_fileNameOnly);
+		matcher->Compile();
+	}
 }
 
 /**
@@ -212,6 +243,29 @@ bool TestAgainstRegList(const vector<FileFilterElementPtr>* filterList, const St
 	return false;
 }
 
+/**
+ * @brief Get the path of a DIFFITEM to test against regexp lists.
+ * @param [in] di DIFFITEM to test.
+ * @param [out] szTest Path of the first existing side, directories begin
+ *   with a backslash.
+ * @return false if the DIFFITEM doesn't exist on any side.
+ */
+static bool GetTestPath(const DIFFITEM& di, String& szTest)
+{
+	const int nDirs = di.diffcode.isThreeway() ? 3 : 2;
+	int i = 0;
+	for (; i < nDirs; ++i)
+	{
+		if (di.diffcode.exists(i))
+			break;
+	}
+	if (i >= nDirs)
+		return false;
+
+	szTest = (di.diffFileInfo[i].IsDirectory() ? _T("\\") : _T("")) + paths::ConcatPath(di.diffFileInfo[i].path, di.diffFileInfo[i].filename);
+	return true;
+}
+
 /**
  * @brief Test given DIFFITEM against given regexp list.
  * @param [in] filterList List of regexps to test against.
@@ -224,38 +278,48 @@ bool FileFilter::TestAgainstRegList(const vector<FileFilterElementPtr>* filterLi
 	if (filterList->size() == 0)
 		return false;
 
-	const int nDirs = di.diffcode.isThreeway() ? 3 : 2;
-	int i = 0;
-	for (; i < nDirs; ++i)
-	{
-		if (di.diffcode.exists(i))
-			break;
-	}
-	if (i >= nDirs)
+	String szTest;
+	if (!GetTestPath(di, szTest))
 		return false;
+	return ::TestAgainstRegList(filterList, szTest);
+}
 
-	const String& szTest = (di.diffFileInfo[i].IsDirectory() ? _T("\\") : _T("")) + paths::ConcatPath(di.diffFileInfo[i].path, di.diffFileInfo[i].filename);
-	std::string compString, compStringFileName;
+/**
+ * @brief Test given string against given regexp list compiled into a matcher.
+ * @param [in] filterList List of regexps to test against.
+ * @param [in] matcher The list compiled by Compile(), the rules are matched
+ *   one by one if the list was changed after it was compiled.
+ * @param [in] szTest String to test against regexps.
+ * @return true if string passes
+ */
+bool FileFilter::TestAgainstRegList(const vector<FileFilterElementPtr>* filterList, const MultiPatternMatcher& matcher, const String& szTest)
+{
+	if (filterList->size() == 0)
+		return false;
+	if (!matcher.IsCompiled() || matcher.GetPatternCount() != filterList->size())
+		return ::TestAgainstRegList(filterList, szTest);
+
+	thread_local std::string compString;
 	ucr::toUTF8(szTest, compString);
-	vector<FileFilterElementPtr>::const_iterator iter = filterList->begin();
-	while (iter != filterList->end())
-	{
-		Poco::RegularExpression::Match match;
-		try
-		{
-			if ((*iter)->_fileNameOnly && compStringFileName.empty())
-				ucr::toUTF8(paths::FindFileName(szTest), compStringFileName);
-			if ((*iter)->regexp.match((*iter)->_fileNameOnly ? compStringFileName : compString, 0, match) > 0)
-				return true;
-		}
-		catch (...)
-		{
-			// TODO:
-		}
+	return matcher.Match(compString);
+}
 
-		++iter;
-	}
-	return false;
+/**
+ * @brief Test given DIFFITEM against given regexp list compiled into a matcher.
+ * @param [in] filterList List of regexps to test against.
+ * @param [in] matcher The list compiled by Compile().
+ * @param [in] di DIFFITEM to test against regexps.
+ * @return true if DIFFITEM passes
+ */
+bool FileFilter::TestAgainstRegList(const vector<FileFilterElementPtr>* filterList, const MultiPatternMatcher& matcher, const DIFFITEM& di)
+{
+	if (filterList->size() == 0)
+		return false;
+
+	String szTest;
+	if (!GetTestPath(di, szTest))
+		return false;
+	return TestAgainstRegList(filterList, matcher, szTest);
 }
 
 /**
@@ -291,9 +355,9 @@ bool FileFilter::TestAgainstExpressionList(const vector<FilterExpressionPtr>* fi
  */
 bool FileFilter::TestFileNameAgainstFilter(const String& szFileName) const
 {
-	if (::TestAgainstRegList(&filefilters, szFileName))
+	if (TestAgainstRegList(&filefilters, fileMatcher, szFileName))
 	{
-		if (filefiltersExclude.empty() || !::TestAgainstRegList(&filefiltersExclude, szFileName))
+		if (filefiltersExclude.empty() || !TestAgainstRegList(&filefiltersExclude, fileMatcherExclude, szFileName))
 			return !default_include;
 	}
 	return default_include;
@@ -320,12 +384,12 @@ void FileFilter::SetDiffContext(const CDiffContext* pDiffContext)
  */
 bool FileFilter::TestFileDiffItemAgainstFilter(const DIFFITEM& di) const
 {
-	bool matched = TestAgainstRegList(&filefilters, di);
+	bool matched = TestAgainstRegList(&filefilters, fileMatcher, di);
 	if (!matched && TestAgainstExpressionList(&fileExpressionFilters, di))
 		matched = true;
 	if (matched)
 	{
-		matched = !TestAgainstRegList(&filefiltersExclude, di);
+		matched = !TestAgainstRegList(&filefiltersExclude, fileMatcherExclude, di);
 		if (matched)
 			matched = !TestAgainstExpressionList(&fileExpressionFiltersExclude, di);
 	}
@@ -346,9 +410,9 @@ bool FileFilter::TestFileDiffItemAgainstFilter(const DIFFITEM& di) const
  */
 bool FileFilter::TestDirNameAgainstFilter(const String& szDirName) const
 {
-	if (::TestAgainstRegList(&dirfilters, szDirName))
+	if (TestAgainstRegList(&dirfilters, dirMatcher, szDirName))
 	{
-		if (dirfiltersExclude.empty() || !::TestAgainstRegList(&dirfiltersExclude, szDirName))
+		if (dirfiltersExclude.empty() || !TestAgainstRegList(&dirfiltersExclude, dirMatcherExclude, szDirName))
 			return !default_include;
 	}
 	return default_include;
@@ -361,12 +425,12 @@ bool FileFilter::TestDirNameAgainstFilter(const String& szDirName) const
  */
 bool FileFilter::TestDirDiffItemAgainstFilter(const DIFFITEM& di) const
 {
-	bool matched = TestAgainstRegList(&dirfilters, di);
+	bool matched = TestAgainstRegList(&dirfilters, dirMatcher, di);
 	if (!matched && TestAgainstExpressionList(&dirExpressionFilters, di))
 		matched = true;
 	if (matched)
 	{
-		matched = !TestAgainstRegList(&dirfiltersExclude, di);
+		matched = !TestAgainstRegList(&dirfiltersExclude, dirMatcherExclude, di);
 		if (matched)
 			matched = !TestAgainstExpressionList(&dirExpressionFiltersExclude, di);
 	}
@@ -12,6 +12,7 @@
 #define POCO_NO_UNWINDOWS 1
 #include <Poco/RegularExpression.h>
 #include "UnicodeString.h"
+#include "MultiPatternMatcher.h"
 
 struct FilterExpression;
 class CDiffContext;
@@ -86,6 +87,10 @@ struct FileFilter
 	std::vector<FilterExpressionPtr> dirExpressionFilters; /**< List of dir filter expressions */
 	std::vector<FilterExpressionPtr> dirExpressionFiltersExclude; /**< List of dir filter expressions (exclude) */
 	std::vector<FileFilterErrorInfo> errors; /**< List of errors in filter file */
+	MultiPatternMatcher fileMatcher; /**< filefilters compiled by Compile() */
+	MultiPatternMatcher fileMatcherExclude; /**< filefiltersExclude compiled by Compile() */
+	MultiPatternMatcher dirMatcher; /**< dirfilters compiled by Compile() */
+	MultiPatternMatcher dirMatcherExclude; /**< dirfiltersExclude compiled by Compile() */
 	FileFilter() : default_include(true) { }
 	~FileFilter();
 	
@@ -94,6 +99,7 @@ struct FileFilter
 	static void EmptyFilterList(std::vector<FileFilterElementPtr> *filterList);
 	static void EmptyExpressionList(std::vector<FilterExpressionPtr> *filterList);
 	void CloneFrom(const FileFilter* filter);
+	void Compile();
 	// methods to actually use filter
 	bool TestFileNameAgainstFilter(const String& szFileName) const;
 	void SetDiffContext(const CDiffContext* pDiffContext);
@@ -101,6 +107,8 @@ struct FileFilter
 	bool TestDirNameAgainstFilter(const String& szDirName) const;
 	bool TestDirDiffItemAgainstFilter(const DIFFITEM& di) const;
 	static bool TestAgainstRegList(const std::vector<FileFilterElementPtr>* filterList, const DIFFITEM& di);
+	static bool TestAgainstRegList(const std::vector<FileFilterElementPtr>* filterList, const MultiPatternMatcher& matcher, const String& szTest);
+	static bool TestAgainstRegList(const std::vector<FileFilterElementPtr>* filterList, const MultiPatternMatcher& matcher, const DIFFITEM& di);
 	static bool TestAgainstExpressionList(const std::vector<FilterExpressionPtr>* filterList, const DIFFITEM& di);
 };
 
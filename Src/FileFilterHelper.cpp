@@ -9,7 +9,7 @@
 #include "FileFilterHelper.h"
 #include "FilterExpression.h"
 #include "UnicodeString.h"
-#include "FilterList.h"
+#include "MultiPatternMatcher.h"
 #include "DiffItem.h"
 #include "FileFilterMgr.h"
 #include "paths.h"
@@ -108,37 +108,80 @@ void FileFilterHelper::SetMaskOrExpression(const String& strMask)
 	m_filterGroups = ParseExtensions(m_sMask);
 }
 
-static String addPeriodIfNoExtension(const String& path)
+static void addPeriodIfNoExtension(const String& path, String& ret)
 {
-	String ret, elm;
+	ret.clear();
+	size_t elmBegin = 0;
 	bool period = false;
 	for (auto ch : path)
 	{
 		if (ch == '.')
 		{
-			elm += ch;
+			ret += ch;
 			period = true;
 		}
 		else if (ch == '\\')
 		{
-			if (!period && !elm.empty() && elm.back() != '*')
-				elm += '.';
-			elm += ch;
-			ret += elm;
-			elm.clear();
+			if (!period && ret.size() > elmBegin && ret.back() != '*')
+				ret += '.';
+			ret += ch;
+			elmBegin = ret.size();
 			period = false;
 		}
 		else
 		{
-			elm += ch;
+			ret += ch;
 		}
 	}
-	if (!period && !elm.empty())
-		elm += '.';
-	ret += elm;
+	if (!period && ret.size() > elmBegin)
+		ret += '.';
+}
+
+static String addPeriodIfNoExtension(const String& path)
+{
+	String ret;
+	addPeriodIfNoExtension(path, ret);
 	return ret;
 }
 
+/**
+ * @brief Convert a path to the form the file masks are matched against.
+ * @param [in] path Path to convert.
+ * @param [out] lowerPath Path in lower case, beginning with a backslash.
+ * @return @p lowerPath with a period appended to names without an extension,
+ *   in UTF-8. The buffers are per-thread, valid until the next call.
+ */
+static const std::string& makeMaskPath(const String& path, String& lowerPath)
+{
+	thread_local String maskPath;
+	thread_local std::string maskPathUtf8;
+	// preprend a backslash if there is none
+	lowerPath.clear();
+	if (path.empty() || path[0] != '\\')
+		lowerPath += '\\';
+	for (auto ch : path)
+		lowerPath += static_cast<tchar_t>(tc::totlower(ch));
+	// append a point if there is no extension
+	addPeriodIfNoExtension(lowerPath, maskPath);
+	ucr::toUTF8(maskPath, maskPathUtf8);
+	return maskPathUtf8;
+}
+
+/**
+ * @brief Compile file mask regular expressions into a matcher.
+ * @return nullptr if there are no masks.
+ */
+static std::unique_ptr<MultiPatternMatcher> compileMasks(const std::vector<String>& patterns)
+{
+	if (patterns.empty())
+		return nullptr;
+	auto pMatcher = std::make_unique<MultiPatternMatcher>();
+	for (const auto& pattern : patterns)
+		pMatcher->AddPattern(ucr::toUTF8(pattern), Poco::RegularExpression::RE_UTF8);
+	pMatcher->Compile();
+	return pMatcher;
+}
+
 void FileFilterHelper::SetDiffContext(const CDiffContext* pCtxt)
 {
 	for (const auto& filterGroup : m_filterGroups)
@@ -175,22 +218,18 @@ std::vector<const FileFilterErrorInfo*> FileFilterHelper::GetErrorList() const
  */
 bool FileFilterHelper::includeFile(const String& szFileName) const
 {
-	// preprend a backslash if there is none
-	String strFileName = strutils::makelower(szFileName);
-	if (strFileName.empty() || strFileName[0] != '\\')
-		strFileName = _T("\\") + strFileName;
-	// append a point if there is no extension
-	std::string strFileNameUtf8Period = ucr::toUTF8(addPeriodIfNoExtension(strFileName));
+	thread_local String strFileName;
+	const std::string& strFileNameUtf8Period = makeMaskPath(szFileName, strFileName);
 	for (const auto& filterGroup : m_filterGroups)
 	{
 		bool result = filterGroup.m_pMaskFileFilter && filterGroup.m_pMaskFileFilter->Match(strFileNameUtf8Period);
 		if (!result)
-			result = filterGroup.m_pRegexOrExpressionFilter && TestAgainstRegList(&filterGroup.m_pRegexOrExpressionFilter->filefilters, szFileName);
+			result = filterGroup.m_pRegexOrExpressionFilter && FileFilter::TestAgainstRegList(&filterGroup.m_pRegexOrExpressionFilter->filefilters, filterGroup.m_pRegexOrExpressionFilter->fileMatcher, szFileName);
 		if (!result)
 			return false;
 		if (filterGroup.m_pMaskFileFilterExclude && filterGroup.m_pMaskFileFilterExclude->Match(strFileNameUtf8Period))
 			return false;
-		if (filterGroup.m_pRegexOrExpressionFilter && TestAgainstRegList(&filterGroup.m_pRegexOrExpressionFilter->filefiltersExclude, szFileName))
+		if (filterGroup.m_pRegexOrExpressionFilter && FileFilter::TestAgainstRegList(&filterGroup.m_pRegexOrExpressionFilter->filefiltersExclude, filterGroup.m_pRegexOrExpressionFilter->fileMatcherExclude, szFileName))
 			return false;
 		if (filterGroup.m_pRegexOrExpressionFilterExclude && !filterGroup.m_pRegexOrExpressionFilterExclude->TestFileNameAgainstFilter(szFileName))
 			return false;
@@ -207,27 +246,22 @@ bool FileFilterHelper::includeFile(const DIFFITEM& di) const
 		if (di.diffcode.exists(i))
 			break;
 	}
-	std::string strFileNameUtf8Period;
+	const std::string* pFileNameUtf8Period = nullptr;
 	bool result = true;
 	if (i < nDirs)
 	{
-		String szFileName = paths::ConcatPath(di.diffFileInfo[i].path, di.diffFileInfo[i].filename);
-		// preprend a backslash if there is none
-		String strFileName = strutils::makelower(szFileName);
-		if (strFileName.empty() || strFileName[0] != '\\')
-			strFileName = _T("\\") + strFileName;
-		// append a point if there is no extension
-		strFileNameUtf8Period = ucr::toUTF8(addPeriodIfNoExtension(strFileName));
+		thread_local String strFileName;
+		pFileNameUtf8Period = &makeMaskPath(paths::ConcatPath(di.diffFileInfo[i].path, di.diffFileInfo[i].filename), strFileName);
 	}
 	for (const auto& filterGroup : m_filterGroups)
 	{
 		if (i < nDirs)
-			result = filterGroup.m_pMaskFileFilter && filterGroup.m_pMaskFileFilter->Match(strFileNameUtf8Period);
+			result = filterGroup.m_pMaskFileFilter && filterGroup.m_pMaskFileFilter->Match(*pFileNameUtf8Period);
 		if (!result)
 		{
 			if (filterGroup.m_pRegexOrExpressionFilter)
 			{
-				result = FileFilter::TestAgainstRegList(&filterGroup.m_pRegexOrExpressionFilter->filefilters, di);
+				result = FileFilter::TestAgainstRegList(&filterGroup.m_pRegexOrExpressionFilter->filefilters, filterGroup.m_pRegexOrExpressionFilter->fileMatcher, di);
 				if (!result)
 					result = FileFilter::TestAgainstExpressionList(&filterGroup.m_pRegexOrExpressionFilter->fileExpressionFilters, di);
 			}
@@ -236,12 +270,12 @@ bool FileFilterHelper::includeFile(const DIFFITEM& di) const
 			return false;
 		if (i < nDirs)
 		{
-			if (filterGroup.m_pMaskFileFilterExclude && filterGroup.m_pMaskFileFilterExclude->Match(strFileNameUtf8Period))
+			if (filterGroup.m_pMaskFileFilterExclude && filterGroup.m_pMaskFileFilterExclude->Match(*pFileNameUtf8Period))
 				return false;
 		}
 		if (filterGroup.m_pRegexOrExpressionFilter)
 		{
-			if (FileFilter::TestAgainstRegList(&filterGroup.m_pRegexOrExpressionFilter->filefiltersExclude, di))
+			if (FileFilter::TestAgainstRegList(&filterGroup.m_pRegexOrExpressionFilter->filefiltersExclude, filterGroup.m_pRegexOrExpressionFilter->fileMatcherExclude, di))
 				return false;
 			if (FileFilter::TestAgainstExpressionList(&filterGroup.m_pRegexOrExpressionFilter->fileExpressionFiltersExclude, di))
 				return false;
@@ -260,25 +294,21 @@ bool FileFilterHelper::includeFile(const DIFFITEM& di) const
  */
 bool FileFilterHelper::includeDir(const String& szDirName) const
 {
-	// preprend a backslash if there is none
-	String strDirName = strutils::makelower(szDirName);
-	if (strDirName.empty() || strDirName[0] != '\\')
-		strDirName = _T("\\") + strDirName;
-	// append a point if there is no extension
-	std::string strDirNameUtf8Period = ucr::toUTF8(addPeriodIfNoExtension(strDirName));
+	thread_local String strDirName;
+	const std::string& strDirNameUtf8Period = makeMaskPath(szDirName, strDirName);
 	for (const auto& filterGroup : m_filterGroups)
 	{
 		bool result = filterGroup.m_pMaskDirFilter && filterGroup.m_pMaskDirFilter->Match(strDirNameUtf8Period);
 		if (!result)
 		{
 			if (filterGroup.m_pRegexOrExpressionFilter)
-				result = TestAgainstRegList(&filterGroup.m_pRegexOrExpressionFilter->dirfilters, strDirName);
+				result = FileFilter::TestAgainstRegList(&filterGroup.m_pRegexOrExpressionFilter->dirfilters, filterGroup.m_pRegexOrExpressionFilter->dirMatcher, strDirName);
 		}
 		if (!result)
 			return false;
 		if (filterGroup.m_pMaskDirFilterExclude && filterGroup.m_pMaskDirFilterExclude->Match(strDirNameUtf8Period))
 			return false;
-		if (filterGroup.m_pRegexOrExpressionFilter && TestAgainstRegList(&filterGroup.m_pRegexOrExpressionFilter->dirfiltersExclude, strDirName))
+		if (filterGroup.m_pRegexOrExpressionFilter && FileFilter::TestAgainstRegList(&filterGroup.m_pRegexOrExpressionFilter->dirfiltersExclude, filterGroup.m_pRegexOrExpressionFilter->dirMatcherExclude, strDirName))
 			return false;
 		if (filterGroup.m_pRegexOrExpressionFilterExclude && !filterGroup.m_pRegexOrExpressionFilterExclude->TestDirNameAgainstFilter(strDirName))
 			return false;
@@ -295,27 +325,22 @@ bool FileFilterHelper::includeDir(const DIFFITEM& di) const
 		if (di.diffcode.exists(i))
 			break;
 	}
-	std::string strDirNameUtf8Period;
+	const std::string* pDirNameUtf8Period = nullptr;
 	bool result = true;
 	if (i < nDirs)
 	{
-		String szDirName = paths::ConcatPath(di.diffFileInfo[i].path, di.diffFileInfo[i].filename);
-		// preprend a backslash if there is none
-		String strDirName = strutils::makelower(szDirName);
-		if (strDirName.empty() || strDirName[0] != '\\')
-			strDirName = _T("\\") + strDirName;
-		// append a point if there is no extension
-		strDirNameUtf8Period = ucr::toUTF8(addPeriodIfNoExtension(strDirName));
+		thread_local String strDirName;
+		pDirNameUtf8Period = &makeMaskPath(paths::ConcatPath(di.diffFileInfo[i].path, di.diffFileInfo[i].filename), strDirName);
 	}
 	for (const auto& filterGroup : m_filterGroups)
 	{
 		if (i < nDirs)
-			result = filterGroup.m_pMaskDirFilter && filterGroup.m_pMaskDirFilter->Match(strDirNameUtf8Period);
+			result = filterGroup.m_pMaskDirFilter && filterGroup.m_pMaskDirFilter->Match(*pDirNameUtf8Period);
 		if (!result)
 		{
 			if (filterGroup.m_pRegexOrExpressionFilter)
 			{
-				result = FileFilter::TestAgainstRegList(&filterGroup.m_pRegexOrExpressionFilter->dirfilters, di);
+				result = FileFilter::TestAgainstRegList(&filterGroup.m_pRegexOrExpressionFilter->dirfilters, filterGroup.m_pRegexOrExpressionFilter->dirMatcher, di);
 				if (!result)
 					result = FileFilter::TestAgainstExpressionList(&filterGroup.m_pRegexOrExpressionFilter->dirExpressionFilters, di);
 			}
@@ -324,13 +349,13 @@ bool FileFilterHelper::includeDir(const DIFFITEM& di) const
 			return false;
 		if (i < nDirs)
 		{
-			if (filterGroup.m_pMaskDirFilterExclude && filterGroup.m_pMaskDirFilterExclude->Match(strDirNameUtf8Period))
+			if (filterGroup.m_pMaskDirFilterExclude && filterGroup.m_pMaskDirFilterExclude->Match(*pDirNameUtf8Period))
 				return false;
 		}
 		if (filterGroup.m_pRegexOrExpressionFilter)
 		{
 
-			if (FileFilter::TestAgainstRegList(&filterGroup.m_pRegexOrExpressionFilter->dirfiltersExclude, di))
+			if (FileFilter::TestAgainstRegList(&filterGroup.m_pRegexOrExpressionFilter->dirfiltersExclude, filterGroup.m_pRegexOrExpressionFilter->dirMatcherExclude, di))
 				return false;
 			if (FileFilter::TestAgainstExpressionList(&filterGroup.m_pRegexOrExpressionFilter->dirExpressionFiltersExclude, di))
 				return false;
@@ -493,8 +518,6 @@ FileFilterHelper::ParseExtensions(const String &extensions) const
 	std::vector<String> groups = SplitFilterGroups(extensions);
 	for (const auto& group : groups)
 	{
-		String strFileParsed;
-		String strDirParsed;
 		std::vector<String> filePatterns;
 		std::vector<String> filePatternsExclude;
 		std::vector<String> dirPatterns;
@@ -601,42 +624,19 @@ FileFilterHelper::ParseExtensions(const String &extensions) const
 		}
 
 		if (filePatterns.empty() && (!pRegexOrExpressionFilter || (pRegexOrExpressionFilter->filefilters.empty() && pRegexOrExpressionFilter->fileExpressionFilters.empty())))
-			strFileParsed = _T(".*"); // Match everything
-		else
-			strFileParsed = strutils::join(filePatterns.begin(), filePatterns.end(), _T("|"));
+			filePatterns.push_back(_T(".*")); // Match everything
 		if (dirPatterns.empty() && (!pRegexOrExpressionFilter || (pRegexOrExpressionFilter->dirfilters.empty() && pRegexOrExpressionFilter->dirExpressionFilters.empty())))
-			strDirParsed = _T(".*"); // Match everything
-		else
-			strDirParsed = strutils::join(dirPatterns.begin(), dirPatterns.end(), _T("|"));
-		String strFileParsedExclude = strutils::join(filePatternsExclude.begin(), filePatternsExclude.end(), _T("|"));
-		String strDirParsedExclude = strutils::join(dirPatternsExclude.begin(), dirPatternsExclude.end(), _T("|"));
-
-		std::string regexp_str_file = ucr::toUTF8(strFileParsed);
-		std::string regexp_str_file_excluded = ucr::toUTF8(strFileParsedExclude);
-		std::string regexp_str_dir = ucr::toUTF8(strDirParsed);
-		std::string regexp_str_dir_excluded = ucr::toUTF8(strDirParsedExclude);
+			dirPatterns.push_back(_T(".*")); // Match everything
+		if (pRegexOrExpressionFilter)
+			pRegexOrExpressionFilter->Compile();
+		if (pRegexOrExpressionFilterExclude)
+			pRegexOrExpressionFilterExclude->Compile();
 
 		FilterGroup filterGroup;
-		if (!regexp_str_file.empty())
-		{
-			filterGroup.m_pMaskFileFilter = std::make_unique<FilterList>();
-			filterGroup.m_pMaskFileFilter->AddRegExp(regexp_str_file);
-		}
-		if (!regexp_str_dir.empty())
-		{
-			filterGroup.m_pMaskDirFilter = std::make_unique<FilterList>();
-			filterGroup.m_pMaskDirFilter->AddRegExp(regexp_str_dir);
-		}
-		if (!regexp_str_file_excluded.empty())
-		{
-			filterGroup.m_pMaskFileFilterExclude = std::make_unique<FilterList>();
-			filterGroup.m_pMaskFileFilterExclude->AddRegExp(regexp_str_file_excluded);
-		}
-		if (!regexp_str_dir_excluded.empty())
-		{
-			filterGroup.m_pMaskDirFilterExclude = std::make_unique<FilterList>();
-			filterGroup.m_pMaskDirFilterExclude->AddRegExp(regexp_str_dir_excluded);
-		}
+		filterGroup.m_pMaskFileFilter = compileMasks(filePatterns);
+		filterGroup.m_pMaskDirFilter = compileMasks(dirPatterns);
+		filterGroup.m_pMaskFileFilterExclude = compileMasks(filePatternsExclude);
+		filterGroup.m_pMaskDirFilterExclude = compileMasks(dirPatternsExclude);
 		filterGroup.m_pRegexOrExpressionFilter = pRegexOrExpressionFilter;
 		filterGroup.m_pRegexOrExpressionFilterExclude = pRegexOrExpressionFilterExclude;
 		filterGroups.push_back(std::move(filterGroup));
@@ -734,29 +734,29 @@ void FileFilterHelper::CloneFrom(const FileFilterHelper* pHelper)
 
 		if (filterGroupSrc.m_pMaskFileFilter)
 		{
-			auto filterList = std::make_unique<FilterList>();
-			filterGroup.m_pMaskFileFilter = std::move(filterList);
+			auto matcher = std::make_unique<MultiPatternMatcher>();
+			filterGroup.m_pMaskFileFilter = std::move(matcher);
 			filterGroup.m_pMaskFileFilter->CloneFrom(filterGroupSrc.m_pMaskFileFilter.get());
 		}
 
 		if (filterGroupSrc.m_pMaskFileFilterExclude)
 		{
-			auto filterList = std::make_unique<FilterList>();
-			filterGroup.m_pMaskFileFilterExclude = std::move(filterList);
+			auto matcher = std::make_unique<MultiPatternMatcher>();
+			filterGroup.m_pMaskFileFilterExclude = std::move(matcher);
 			filterGroup.m_pMaskFileFilterExclude->CloneFrom(filterGroupSrc.m_pMaskFileFilterExclude.get());
 		}
 
 		if (filterGroupSrc.m_pMaskDirFilter)
 		{
-			auto filterList = std::make_unique<FilterList>();
-			filterGroup.m_pMaskDirFilter = std::move(filterList);
+			auto matcher = std::make_unique<MultiPatternMatcher>();
+			filterGroup.m_pMaskDirFilter = std::move(matcher);
 			filterGroup.m_pMaskDirFilter->CloneFrom(filterGroupSrc.m_pMaskDirFilter.get());
 		}
 
 		if (filterGroupSrc.m_pMaskDirFilterExclude)
 		{
-			auto filterList = std::make_unique<FilterList>();
-			filterGroup.m_pMaskDirFilterExclude = std::move(filterList);
+			auto matcher = std::make_unique<MultiPatternMatcher>();
+			filterGroup.m_pMaskDirFilterExclude = std::move(matcher);
 			filterGroup.m_pMaskDirFilterExclude->CloneFrom(filterGroupSrc.m_pMaskDirFilterExclude.get());
 		}
 
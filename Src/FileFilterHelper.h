@@ -12,7 +12,7 @@
 #include "DirItem.h"
 
 class FileFilterMgr;
-class FilterList;
+class MultiPatternMatcher;
 struct FileFilter;
 class DIFFITEM;
 class CDiffContext;
@@ -147,10 +147,10 @@ public:
 protected:
 	struct FilterGroup
 	{
-		std::unique_ptr<FilterList> m_pMaskFileFilter; /*< Filter for filemasks (*.cpp) */
-		std::unique_ptr<FilterList> m_pMaskFileFilterExclude; /*< Filter for filemasks (*.cpp) */
-		std::unique_ptr<FilterList> m_pMaskDirFilter;  /*< Filter for dirmasks */
-		std::unique_ptr<FilterList> m_pMaskDirFilterExclude;  /*< Filter for dirmasks */
+		std::unique_ptr<MultiPatternMatcher> m_pMaskFileFilter; /*< Filter for filemasks (*.cpp) */
+		std::unique_ptr<MultiPatternMatcher> m_pMaskFileFilterExclude; /*< Filter for filemasks (*.cpp) */
+		std::unique_ptr<MultiPatternMatcher> m_pMaskDirFilter;  /*< Filter for dirmasks */
+		std::unique_ptr<MultiPatternMatcher> m_pMaskDirFilterExclude;  /*< Filter for dirmasks */
 		std::shared_ptr<FileFilter> m_pRegexOrExpressionFilter;
 		std::shared_ptr<FileFilter> m_pRegexOrExpressionFilterExclude;
 	};
@@ -381,7 +381,7 @@ void FileFilterMgr::CloneFrom(const FileFilterMgr* fileFilterMgr)
 	m_filters.reserve(count);
 	for (size_t i = 0; i < count; i++)
 	{
-		auto ptr = std::make_shared<FileFilter>(FileFilter());
+		auto ptr = std::make_shared<FileFilter>();
 		ptr->CloneFrom(fileFilterMgr->m_filters[i].get());
 		m_filters.push_back(ptr);
 	}
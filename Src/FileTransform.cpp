@@ -13,6 +13,7 @@
 #include "pch.h"
 #include "FileTransform.h"
 #include <vector>
+#include <mutex>
 #include <Poco/Exception.h>
 #include <Poco/Mutex.h>
 #include "Plugins.h"
@@ -27,6 +28,17 @@ using Poco::Exception;
 
 static Poco::FastMutex g_mutex;
 
+/**
+ * @brief Serialize the calls of a plugin, unless it may be called from
+ * several threads at once, like the ones running on worker processes.
+ */
+static std::unique_lock<Poco::FastMutex> LockPlugin(const PluginInfo& plugin)
+{
+	if (plugin.m_bConcurrent)
+		return std::unique_lock<Poco::FastMutex>(g_mutex, std::defer_lock);
+	return std::unique_lock<Poco::FastMutex>(g_mutex);
+}
+
 static std::pair<String, uint8_t> parseNameAndTargetFlags(const String& token)
 {
 	String name;
@@ -468,7 +480,7 @@ bool PackingInfo::pack(int target, String& filepath, const String& dstFilepath,
 		bufferData.SetDataFileAnsi(filepath);
 
 		LPDISPATCH piScript = plugin->m_lpDispatch;
-		Poco::FastMutex::ScopedLock lock(g_mutex);
+		auto lock = LockPlugin(*plugin);
 
 		if (plugin->m_hasVariablesProperty)
 		{
@@ -579,7 +591,7 @@ bool PackingInfo::Unpacking(int target, std::vector<int>* handlerSubcodes, Strin
 		int subcode = 0;
 
 		LPDISPATCH piScript = plugin->m_lpDispatch;
-		Poco::FastMutex::ScopedLock lock(g_mutex);
+		auto lock = LockPlugin(*plugin);
 
 		if (plugin->m_hasVariablesProperty)
 		{
@@ -790,7 +802,7 @@ bool PrediffingInfo::Prediffing(int target, String & filepath, const String& fil
 		// bufferData.SetCodepage();
 
 		LPDISPATCH piScript = plugin->m_lpDispatch;
-		Poco::FastMutex::ScopedLock lock(g_mutex);
+		auto lock = LockPlugin(*plugin);
 
 		if (plugin->m_hasVariablesProperty)
 		{
@@ -902,7 +914,7 @@ bool EditorScriptInfo::TransformText(int target, String& text, const std::vector
 			continue;
 
 		LPDISPATCH piScript = plugin->m_lpDispatch;
-		Poco::FastMutex::ScopedLock lock(g_mutex);
+		auto lock = LockPlugin(*plugin);
 
 		if (plugin->m_hasVariablesProperty)
 		{
@@ -787,9 +787,9 @@ static auto FileVersionField(int index, const FilterExpression* ctxt, const DIFF
 {
 	if (!di.diffcode.exists(index))
 		return std::monostate{};
-	if (di.diffFileInfo[index].version.IsCleared())
+	if (di.diffFileInfo[index].GetVersion().IsCleared())
 		ctxt->ctxt->UpdateVersion(const_cast<DIFFITEM&>(di), index);
-	return static_cast<int64_t>(di.diffFileInfo[index].version.GetFileVersionQWORD());
+	return static_cast<int64_t>(di.diffFileInfo[index].GetVersion().GetFileVersionQWORD());
 }
 
 static auto AttributesField(int index, const FilterExpression* ctxt, const DIFFITEM& di) -> ValueType
@@ -810,7 +810,7 @@ static auto CodepageField(int index, const FilterExpression* ctxt, const DIFFITE
 {
 	if (!di.diffcode.exists(index))
 		return std::monostate{};
-	return static_cast<int64_t>(di.diffFileInfo[index].encoding.m_codepage);
+	return static_cast<int64_t>(di.diffFileInfo[index].GetEncoding().m_codepage);
 }
 
 static auto DiffCodeField(int index, const FilterExpression* ctxt, const DIFFITEM& di) -> ValueType
@@ -832,7 +832,7 @@ static auto EncodingField(int index, const FilterExpression* ctxt, const DIFFITE
 {
 	if (!di.diffcode.exists(index))
 		return std::monostate{};
-	return ucr::toUTF8(di.diffFileInfo[index].encoding.GetName());
+	return ucr::toUTF8(di.diffFileInfo[index].GetEncoding().GetName());
 }
 
 static auto FullPathField(int index, const FilterExpression* ctxt, const DIFFITEM& di) -> ValueType
@@ -854,8 +854,7 @@ static auto ContentField(int index, const FilterExpression* ctxt, const DIFFITEM
 	content->item.flags = di.diffFileInfo[index].flags;
 	content->item.mtime = di.diffFileInfo[index].mtime;
 	content->item.ctime = di.diffFileInfo[index].ctime;
-	content->item.version = di.diffFileInfo[index].version;
-	content->item.encoding = di.diffFileInfo[index].encoding;
+	content->item.CopyDetails(di.diffFileInfo[index]);
 	return content;
 }
 
@@ -62,8 +62,8 @@ static auto prop(int index, const String& name, const FilterExpression* ctxt, co
 {
 	if (!di.diffcode.exists(index))
 		return std::monostate{};
-	auto& properties = const_cast<DIFFITEM&>(di).diffFileInfo[index].m_pAdditionalProperties;
-	if (!di.diffFileInfo[index].m_pAdditionalProperties)
+	auto& properties = const_cast<DIFFITEM&>(di).diffFileInfo[index].GetAdditionalPropertiesRef();
+	if (!properties)
 	{
 		properties.reset(new PropertyValues());
 		if (di.diffcode.exists(index))
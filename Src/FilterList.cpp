@@ -6,17 +6,45 @@
 
 #include "pch.h"
 #include "FilterList.h"
-#include <vector>
+#include <functional>
+#include <string_view>
+#include <unordered_map>
 #include <Poco/RegularExpression.h>
 #include <Poco/Exception.h>
 #include "unicoder.h"
 
 using Poco::RegularExpression;
 
+namespace
+{
+
+const size_t VerdictShards = 16; /**< Shards of the verdicts, threads matching different strings rarely wait */
+const size_t MaxVerdictLength = 256; /**< Longer strings are matched every time */
+const size_t MaxVerdictsPerShard = 4096; /**< A full shard is emptied */
+
+}
+
+/** @brief Verdict remembered for a string. */
+struct FilterList::VerdictShard
+{
+	struct Verdict
+	{
+		std::string string; /**< String matched, compared to rule out hash collisions */
+		int codepage; /**< Codepage of the string */
+		bool match; /**< Any of the expressions matched */
+	};
+	std::mutex mutex;
+	std::unordered_map<size_t, Verdict> verdicts;
+};
+
 /** 
  * @brief Constructor.
  */
-FilterList::FilterList() = default;
+FilterList::FilterList()
+: m_compiled(false)
+, m_verdicts(new VerdictShard[VerdictShards])
+{
+}
 
 /** 
  * @brief Destructor.
@@ -28,87 +56,111 @@ FilterList::~FilterList()
 
 /** 
  * @brief Add new regular expression to the list.
- * This function adds new regular expression to the list of expressions.
- * The regular expression is compiled and studied for better performance.
+ * The expression is checked here and compiled with the others by Compile()
+ * or the first Match().
  * @param [in] regularExpression Regular expression string.
- * @param [in] encoding Expression encoding.
+ * @param [in] throwIfInvalid Throw std::runtime_error for an invalid
+ *   expression, otherwise it is skipped.
  */
 void FilterList::AddRegExp(const std::string& regularExpression, bool throwIfInvalid)
 {
 	try
 	{
-		m_list.push_back(filter_item_ptr(new filter_item(regularExpression, RegularExpression::RE_UTF8)));
+		RegularExpression regexp(regularExpression, RegularExpression::RE_UTF8);
 	}
 	catch (Poco::RegularExpressionException& e)
 	{
 		if (throwIfInvalid)
 			throw std::runtime_error(e.message().c_str());
+		return;
 	}
+	m_matcher.AddPattern(regularExpression, RegularExpression::RE_UTF8);
+	m_compiled = false;
+	ClearVerdicts();
+}
+
+/** 
+ * @brief Removes all expressions from the list.
+ */
+void FilterList::RemoveAllFilters()
+{
+	m_matcher.Clear();
+	m_compiled = false;
+	ClearVerdicts();
+}
+
+/**
+ * @brief Compile the expressions added.
+ * Call before sharing the list between threads, Match() compiles the list
+ * if it isn't compiled yet.
+ */
+void FilterList::Compile()
+{
+	CompileOnce();
 }
 
-static bool match(const std::vector <filter_item_ptr>& list, const std::string& string)
+void FilterList::CompileOnce() const
 {
-	if (list.empty())
-		return false;
-	bool retval = false;
-	for (const auto& item : list)
+	std::lock_guard<std::mutex> lock(m_compileMutex);
+	if (!m_matcher.IsCompiled())
+		m_matcher.Compile();
+	m_compiled = true;
+}
+
+void FilterList::ClearVerdicts()
+{
+	for (size_t i = 0; i < VerdictShards; ++i)
 	{
-		int result = 0;
-		RegularExpression::Match match;
-		try
-		{
-			result = item->regexp.match(string, 0, match);
-		}
-		catch (...)
-		{
-		}
-		if (result > 0)
-		{
-			retval = true;
-			break;
-		}
+		std::lock_guard<std::mutex> lock(m_verdicts[i].mutex);
+		m_verdicts[i].verdicts.clear();
 	}
-	return retval;
+}
+
+/**
+ * @brief Convert the string into UTF-8 and match it against the expressions.
+ */
+bool FilterList::MatchUTF8(const std::string& string, int codepage) const
+{
+	if (codepage == ucr::CP_UTF_8)
+		return m_matcher.Match(string);
+
+	ucr::buffer buf(string.length() * 2);
+	ucr::convert(ucr::NONE, codepage, reinterpret_cast<const unsigned char *>(string.c_str()), 
+			string.length(), ucr::UTF8, ucr::CP_UTF_8, &buf);
+	return m_matcher.Match((buf.size > 0) ? std::string(reinterpret_cast<const char*>(buf.ptr), buf.size) : string);
 }
 
 /** 
  * @brief Match string against list of expressions.
  * This function matches given @p string against the list of regular
- * expressions. The matching ends when first match is found, so all
- * expressions may not be matched against.
+ * expressions. Strings of up to MaxVerdictLength bytes are matched once,
+ * their verdicts are remembered until the expressions change.
  * @param [in] string string to match.
  * @param [in] codepage codepage of string.
  * @return true if any of the expressions did match the string.
  */
-bool FilterList::Match(const std::string& string, int codepage/*=CP_UTF8*/)
+bool FilterList::Match(const std::string& string, int codepage/*=CP_UTF8*/) const
 {
-	// convert string into UTF-8
-	ucr::buffer buf(string.length() * 2);
+	if (!m_compiled.load(std::memory_order_acquire))
+		CompileOnce();
 
-	if (codepage != ucr::CP_UTF_8)
-			ucr::convert(ucr::NONE, codepage, reinterpret_cast<const unsigned char *>(string.c_str()), 
-					string.length(), ucr::UTF8, ucr::CP_UTF_8, &buf);
+	if (string.length() > MaxVerdictLength)
+		return MatchUTF8(string, codepage);
 
-	return match(m_list, (buf.size > 0) ? std::string(reinterpret_cast<const char*>(buf.ptr), buf.size) : string);
-}
-
-/**
- * @brief Clone filter list from another list.
- * This function clones filter list from another list. Current items in the
- * list are removed and new items added from the given list.
- * @param [in] filterList File list to clone.
- */
-void FilterList::CloneFrom(const FilterList* filterList)
-{
-	if (!filterList)
-		return;
-
-	m_list.clear();
-
-	size_t count = filterList->m_list.size();
-	m_list.reserve(count);
-	for (size_t i = 0; i < count; i++)
+	const size_t hash = std::hash<std::string_view>()(string) ^ static_cast<size_t>(codepage);
+	VerdictShard& shard = m_verdicts[(hash >> 4) % VerdictShards];
 	{
-		m_list.emplace_back(std::make_shared<filter_item>(filterList->m_list[i].get()));
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		auto it = shard.verdicts.find(hash);
+		if (it != shard.verdicts.end() && it->second.codepage == codepage && it->second.string == string)
+			return it->second.match;
 	}
+
+	const bool match = MatchUTF8(string, codepage);
+
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	if (shard.verdicts.size() >= MaxVerdictsPerShard)
+		shard.verdicts.clear();
+	shard.verdicts[hash] = { string, codepage, match };
+	return match;
 }
@@ -5,33 +5,23 @@
  */
 #pragma once
 
-#include <vector>
+#include <atomic>
 #include <memory>
-#include <Poco/RegularExpression.h>
+#include <mutex>
+#include "MultiPatternMatcher.h"
 #include "unicoder.h"
 
-/**
- * @brief Container for one filtering rule / compiled expression.
- * This structure holds compiled regular expression and a original expression
- * as a string. We need the original expression string in case we want to
- * know which regular expression did match.
- */
-struct filter_item
-{
-	std::string filterAsString; /** Original regular expression string */
-	Poco::RegularExpression regexp; /**< Compiled regular expression */
-	int _reOpts; /**< Options to set to Poco::RegularExpression */
-	filter_item(const std::string &filter, int reOpts) : filterAsString(filter), regexp(filter, reOpts), _reOpts(reOpts) {}
-	filter_item(const filter_item* item) : filterAsString(item->filterAsString), regexp(item->filterAsString, item->_reOpts), _reOpts(item->_reOpts) {}
-};
-
-typedef std::shared_ptr<filter_item> filter_item_ptr;
-
 /**
  * @brief Regular expression list.
  * This class holds a list of regular expressions for matching strings.
- * The class also provides simple function for matching and remembers the
- * last matched expression.
+ *
+ * The expressions are compiled into one MultiPatternMatcher, which joins
+ * them into as few alternations as it can, so a string is matched with one
+ * PCRE run in most cases. Once compiled the list is read only and Match()
+ * may be called from several threads at once, so a folder compare shares
+ * one list between its compare threads. The verdicts of short strings are
+ * remembered, lines repeated in the files of a compare (license headers,
+ * generated timestamps) are matched once.
  */
 class FilterList
 {
@@ -42,20 +32,21 @@ public:
 	void AddRegExp(const std::string& regularExpression, bool throwIfInvalid = false);
 	void RemoveAllFilters();
 	bool HasRegExps() const;
-	bool Match(const std::string& string, int codepage = ucr::CP_UTF_8);
-	void CloneFrom(const FilterList* filterList);
+	void Compile();
+	bool Match(const std::string& string, int codepage = ucr::CP_UTF_8) const;
 
 private:
-	std::vector <filter_item_ptr> m_list;
-};
+	struct VerdictShard;
 
-/** 
- * @brief Removes all expressions from the list.
- */
-inline void FilterList::RemoveAllFilters()
-{
-	m_list.clear();
-}
+	void CompileOnce() const;
+	bool MatchUTF8(const std::string& string, int codepage) const;
+	void ClearVerdicts();
+
+	mutable MultiPatternMatcher m_matcher; /**< Expressions of the list, compiled on first use */
+	mutable std::mutex m_compileMutex; /**< Serializes the compile on first use */
+	mutable std::atomic<bool> m_compiled; /**< m_matcher is compiled */
+	std::unique_ptr<VerdictShard[]> m_verdicts; /**< Remembered verdicts, by hash of the string */
+};
 
 /** 
  * @brief Returns if list has any expressions.
@@ -63,5 +54,5 @@ inline void FilterList::RemoveAllFilters()
  */
 inline bool FilterList::HasRegExps() const
 {
-	return !m_list.empty();
+	return m_matcher.GetPatternCount() > 0;
 }
@@ -17,6 +17,7 @@
 #include "codepage_detect.h"
 #include "BinaryCompare.h"
 #include "TimeSizeCompare.h"
+#include "ContentHashCache.h"
 #include "ExistenceCompare.h"
 #include "TFile.h"
 #include "FileFilterHelper.h"
@@ -70,6 +71,87 @@ void FolderCmp::LogError(const DIFFITEM& di)
 	RootLogger::Error(s);
 }
 
+/**
+ * @brief Are the options such that files differ whenever their bytes differ?
+ */
+static bool IsByteExactCompare(const CompareOptions& options)
+{
+	return options.m_ignoreWhitespace == WHITESPACE_COMPARE_ALL &&
+		!options.m_bIgnoreBlankLines && !options.m_bIgnoreCase && !options.m_bIgnoreNumbers &&
+		!options.m_bIgnoreEOLDifference && !options.m_bIgnoreMissingTrailingEol && !options.m_bIgnoreLineBreaks;
+}
+
+/**
+ * @brief Compare files by their cached content digests, without opening them.
+ * @param [in] pCache Content hash cache.
+ * @param [in] di Compared files.
+ * @param [in] files Paths of the compared files.
+ * @param [in] bExact Can differing digests be reported as a difference?
+ * @param [out] textStats Cached text statistics of the files.
+ * @return Quick compare result code, or 0 if the cache can't tell.
+ */
+static unsigned CompareCachedContentHashes(ContentHashCache *pCache, const DIFFITEM& di,
+	const PathContext& files, bool bExact, FileTextStats textStats[])
+{
+	const int nDirs = files.GetSize();
+	ContentHashCache::Entry entries[3];
+	for (int nIndex = 0; nIndex < nDirs; nIndex++)
+	{
+		if (!pCache->Lookup(files[nIndex], di.diffFileInfo[nIndex], entries[nIndex]))
+			return 0;
+	}
+	auto same = [&](int i, int j) { return memcmp(entries[i].digest, entries[j].digest, sizeof(entries[i].digest)) == 0; };
+	unsigned code = DIFFCODE::FILE;
+	if (nDirs < 3)
+	{
+		if (same(0, 1))
+			code |= DIFFCODE::SAME;
+		else if (bExact)
+			code |= DIFFCODE::DIFF;
+		else
+			return 0;
+	}
+	else
+	{
+		const bool same01 = same(0, 1), same12 = same(1, 2), same02 = same(0, 2);
+		if (same01 && same12)
+			code |= DIFFCODE::SAME;
+		else if (!bExact)
+			return 0;
+		else if (same12)
+			code |= DIFFCODE::DIFF | DIFFCODE::DIFF1STONLY;
+		else if (same02)
+			code |= DIFFCODE::DIFF | DIFFCODE::DIFF2NDONLY;
+		else if (same01)
+			code |= DIFFCODE::DIFF | DIFFCODE::DIFF3RDONLY;
+		else
+			code |= DIFFCODE::DIFF;
+	}
+	static const unsigned binSide[3] = { DIFFCODE::BINSIDE1, DIFFCODE::BINSIDE2, DIFFCODE::BINSIDE3 };
+	unsigned bin = 0;
+	for (int nIndex = 0; nIndex < nDirs; nIndex++)
+	{
+		textStats[nIndex] = entries[nIndex].stats;
+		if (entries[nIndex].stats.nzeros > 0)
+			bin |= DIFFCODE::BIN | binSide[nIndex];
+	}
+	return code | (bin != 0 ? bin : static_cast<unsigned>(DIFFCODE::TEXT));
+}
+
+/**
+ * @brief Record the digests of files read to the end by a quick compare.
+ */
+static void StoreContentHashes(ContentHashCache *pCache, const DIFFITEM& di, const PathContext& files,
+	ContentHashCache::Hasher *hashers[])
+{
+	for (int nIndex = 0; nIndex < files.GetSize(); nIndex++)
+	{
+		ContentHashCache::Entry entry;
+		hashers[nIndex]->Finish(entry);
+		pCache->Store(files[nIndex], di.diffFileInfo[nIndex], entry);
+	}
+}
+
 /**
  * @brief Prepare files (run plugins) & compare them, and return diffcode.
  * This is function to compare two files in folder compare. It is not used in
@@ -127,6 +209,7 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 		String filepathUnpacked[3];
 		String filepathTransformed[3];
 		int codepage = 0;
+		bool bUseContentHashCache = false;
 
 		// For user chosen plugins, define bAutomaticUnpacker as false and use the chosen infoHandler
 		// but how can we receive the infoHandler ? DirScan actually only 
@@ -226,6 +309,24 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 			nCompMethod = CMP_QUICK_CONTENT;
 		}
 
+		// Content hash cache: files unchanged since an earlier quick compare
+		// read them are decided from their recorded digests. Digests of
+		// plugin-transformed files would not match the files on disk.
+		bUseContentHashCache = (nCompMethod == CMP_QUICK_CONTENT && m_pCtxt->m_pContentHashCache != nullptr &&
+			std::equal(filepathTransformed, filepathTransformed + nDirs, tFiles.begin()));
+		if (bUseContentHashCache)
+		{
+			code = CompareCachedContentHashes(m_pCtxt->m_pContentHashCache.get(), di, tFiles,
+				IsByteExactCompare(*m_pCtxt->GetCompareOptions(CMP_QUICK_CONTENT)), m_diffFileData.m_textStats);
+			if (code != 0)
+			{
+				m_ndiffs = CDiffContext::DIFFS_UNKNOWN_QUICKCOMPARE;
+				m_ntrivialdiffs = CDiffContext::DIFFS_UNKNOWN_QUICKCOMPARE;
+				goto exitPrepAndCompare;
+			}
+			code = DIFFCODE::FILE | DIFFCODE::CMPERR;
+		}
+
 		// Actually compare the files
 		// `diffutils_compare_files()` is a fairly thin front-end to GNU diffutils
 
@@ -286,6 +387,7 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 				bool bRet;
 				int bin_flag10 = 0, bin_flag12 = 0, bin_flag02 = 0;
 
+				m_pDiffUtilsEngine->SetPaths(tFiles);
 				bRet = m_pDiffUtilsEngine->Diff2Files(&script10, &diffdata10, &bin_flag10, nullptr);
 				bRet = m_pDiffUtilsEngine->Diff2Files(&script12, &diffdata12, &bin_flag12, nullptr);
 				bRet = m_pDiffUtilsEngine->Diff2Files(&script02, &diffdata02, &bin_flag02, nullptr);
@@ -376,7 +478,13 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 			if (tFiles.GetSize() == 2)
 			{
 				// use our own byte-by-byte compare
-				code = m_pByteCompare->CompareFiles(&m_diffFileData);
+				ContentHashCache::Hasher hashers[2];
+				code = m_pByteCompare->CompareFiles(&m_diffFileData, bUseContentHashCache ? hashers : nullptr);
+				if (bUseContentHashCache && (code & DIFFCODE::TEXTFLAGS) != 0 && !DIFFCODE::isResultError(code))
+				{
+					ContentHashCache::Hasher *sides[2] = { &hashers[0], &hashers[1] };
+					StoreContentHashes(m_pCtxt->m_pContentHashCache.get(), di, tFiles, sides);
+				}
 
 				// Quick contents doesn't know about diff counts
 				// Set to special value to indicate invalid
@@ -386,12 +494,20 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 			else
 			{
 				// use our own byte-by-byte compare
+				ContentHashCache::Hasher hashers10[2], hashers12[2];
 				// 10
-				int code10 = m_pByteCompare->CompareFiles(&diffdata10);
+				int code10 = m_pByteCompare->CompareFiles(&diffdata10, bUseContentHashCache ? hashers10 : nullptr);
 				// 12
-				int code12 = m_pByteCompare->CompareFiles(&diffdata12);
+				int code12 = m_pByteCompare->CompareFiles(&diffdata12, bUseContentHashCache ? hashers12 : nullptr);
 				// 02
 				int code02 = m_pByteCompare->CompareFiles(&diffdata02);
+				if (bUseContentHashCache &&
+					(code10 & DIFFCODE::TEXTFLAGS) != 0 && !DIFFCODE::isResultError(code10) &&
+					(code12 & DIFFCODE::TEXTFLAGS) != 0 && !DIFFCODE::isResultError(code12))
+				{
+					ContentHashCache::Hasher *sides[3] = { &hashers10[1], &hashers10[0], &hashers12[1] };
+					StoreContentHashes(m_pCtxt->m_pContentHashCache.get(), di, tFiles, sides);
+				}
 
 				m_diffFileData.m_textStats[0] = diffdata10.m_textStats[1];
 				m_diffFileData.m_textStats[1] = diffdata12.m_textStats[0];
@@ -469,6 +585,9 @@ exitPrepAndCompare:
 		if (m_pBinaryCompare == nullptr)
 			m_pBinaryCompare.reset(new BinaryCompare());
 		m_pBinaryCompare->SetAbortable(m_pCtxt->GetAbortable());
+		m_pBinaryCompare->SetContentHashCache(m_pCtxt->m_pContentHashCache.get());
+		m_pBinaryCompare->SetMemoryMapping(m_pCtxt->m_bBinaryCompareMemoryMapping);
+		m_pBinaryCompare->SetSampling(m_pCtxt->m_nBinaryCompareSampleBlocks, m_pCtxt->m_bBinaryCompareTrustSamples);
 		PathContext tFiles;
 		m_pCtxt->GetComparePaths(di, tFiles);
 		code = m_pBinaryCompare->CompareFiles(tFiles, di);
@@ -1,69 +1,586 @@
-/** 
+/**
  * @file  HashCalc.cpp
  *
  * @brief Implementation file for HashCalc
  */
 #include "pch.h"
 #include "HashCalc.h"
+#include <algorithm>
+#include <cstring>
+#include <Poco/MD5Engine.h>
+#include <Poco/SHA1Engine.h>
+#include <Poco/SHA2Engine.h>
+#include "cio.h"
 
-#ifdef _WIN64
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define HASHCALC_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
 
+#ifdef _WIN64
+#include <windows.h>
+#include <bcrypt.h>
 #pragma comment(lib, "bcrypt.lib")
- 
-static NTSTATUS CalculateHashValue(HANDLE hFile, BCRYPT_HASH_HANDLE hHash, ULONG hashSize, std::vector<uint8_t>& hash)
+#endif
+
+/** @brief Read buffer size used by HashFile(). */
+static const int HashBufferSize = 1024 * 1024;
+
+/** @brief Data fed to one digest before the next, small enough to stay in the cache. */
+static const size_t SliceSize = 64 * 1024;
+
+/** @brief Digest sizes by HashCalc::Algorithm. */
+static const size_t HashSizes[HashCalc::AlgorithmCount] = { 16, 20, 32, 8 };
+
+// XXH3 constants, see the xxHash specification
+static const size_t StripeLen = 64;
+static const size_t SecretSize = 192;
+static const size_t StripesPerBlock = (SecretSize - StripeLen) / 8;
+static const size_t MidSizeMax = 240;
+static const uint32_t Prime32_1 = 0x9E3779B1U;
+static const uint32_t Prime32_2 = 0x85EBCA77U;
+static const uint32_t Prime32_3 = 0xC2B2AE3DU;
+static const uint64_t Prime64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t Prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t Prime64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t Prime64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t Prime64_5 = 0x27D4EB2F165667C5ULL;
+static const uint64_t PrimeMx1 = 0x165667919E3779F9ULL;
+static const uint64_t PrimeMx2 = 0x9FB21C651E98DF25ULL;
+
+/** @brief Default secret of XXH3. */
+static const uint8_t Xxh3Secret[SecretSize] =
+{
+	0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+	0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+	0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+	0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+	0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+	0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+	0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+	0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+	0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+	0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+	0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+	0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+// XXH3 reads its input as little-endian words, like the CPUs WinMerge runs on
+static inline uint64_t Read64(const uint8_t *p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint32_t Read32(const uint8_t *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint32_t Swap32(uint32_t x)
+{
+	return (x << 24) | ((x << 8) & 0xFF0000U) | ((x >> 8) & 0xFF00U) | (x >> 24);
+}
+
+static inline uint64_t Swap64(uint64_t x)
+{
+	return (static_cast<uint64_t>(Swap32(static_cast<uint32_t>(x))) << 32) | Swap32(static_cast<uint32_t>(x >> 32));
+}
+
+static inline uint64_t Rotl64(uint64_t x, int r)
 {
-	hash.resize(hashSize);
-	std::vector<uint8_t> buffer(64 * 1024);
-	NTSTATUS status = 0;
-	while (status == 0)
+	return (x << r) | (x >> (64 - r));
+}
+
+/** @brief XOR of the low and high halves of the 128-bit product. */
+static inline uint64_t Mul128Fold64(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+	const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+	return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	uint64_t hi;
+	const uint64_t lo = _umul128(a, b, &hi);
+	return lo ^ hi;
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+	return (a * b) ^ __umulh(a, b);
+#else
+	const uint64_t loLo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+	const uint64_t hiLo = (a >> 32) * (b & 0xFFFFFFFF);
+	const uint64_t loHi = (a & 0xFFFFFFFF) * (b >> 32);
+	const uint64_t hiHi = (a >> 32) * (b >> 32);
+	const uint64_t cross = (loLo >> 32) + (hiLo & 0xFFFFFFFF) + loHi;
+	const uint64_t hi = (hiLo >> 32) + (cross >> 32) + hiHi;
+	const uint64_t lo = (cross << 32) | (loLo & 0xFFFFFFFF);
+	return lo ^ hi;
+#endif
+}
+
+static inline uint64_t Xxh64Avalanche(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= Prime64_2;
+	h ^= h >> 29;
+	h *= Prime64_3;
+	h ^= h >> 32;
+	return h;
+}
+
+static inline uint64_t Xxh3Avalanche(uint64_t h)
+{
+	h ^= h >> 37;
+	h *= PrimeMx1;
+	h ^= h >> 32;
+	return h;
+}
+
+static inline uint64_t Rrmxmx(uint64_t h, uint64_t len)
+{
+	h ^= Rotl64(h, 49) ^ Rotl64(h, 24);
+	h *= PrimeMx2;
+	h ^= (h >> 35) + len;
+	h *= PrimeMx2;
+	h ^= h >> 28;
+	return h;
+}
+
+static inline uint64_t Mix16B(const uint8_t *input, const uint8_t *secret)
+{
+	return Mul128Fold64(Read64(input) ^ Read64(secret), Read64(input + 8) ^ Read64(secret + 8));
+}
+
+/** @brief Digest of inputs up to MidSizeMax bytes, which are hashed at once. */
+static uint64_t Xxh3HashShort(const uint8_t *input, size_t len)
+{
+	const uint8_t *secret = Xxh3Secret;
+	if (len == 0)
+		return Xxh64Avalanche(Read64(secret + 56) ^ Read64(secret + 64));
+	if (len <= 3)
 	{
-		DWORD dwRead = 0;
-		if (!ReadFile(hFile, buffer.data(), static_cast<DWORD>(buffer.size()), &dwRead, nullptr))
+		const uint32_t combined = (static_cast<uint32_t>(input[0]) << 16) | (static_cast<uint32_t>(input[len >> 1]) << 24)
+			| input[len - 1] | (static_cast<uint32_t>(len) << 8);
+		const uint64_t bitflip = Read32(secret) ^ Read32(secret + 4);
+		return Xxh64Avalanche(combined ^ bitflip);
+	}
+	if (len <= 8)
+	{
+		const uint64_t bitflip = Read64(secret + 8) ^ Read64(secret + 16);
+		const uint64_t input64 = Read32(input + len - 4) + (static_cast<uint64_t>(Read32(input)) << 32);
+		return Rrmxmx(input64 ^ bitflip, len);
+	}
+	if (len <= 16)
+	{
+		const uint64_t lo = Read64(input) ^ (Read64(secret + 24) ^ Read64(secret + 32));
+		const uint64_t hi = Read64(input + len - 8) ^ (Read64(secret + 40) ^ Read64(secret + 48));
+		return Xxh3Avalanche(len + Swap64(lo) + hi + Mul128Fold64(lo, hi));
+	}
+	uint64_t acc = len * Prime64_1;
+	if (len <= 128)
+	{
+		if (len > 32)
 		{
-			status = 1; // STATUS_UNSUCCESSFUL
-			hash.clear();
-			break;
+			if (len > 64)
+			{
+				if (len > 96)
+				{
+					acc += Mix16B(input + 48, secret + 96);
+					acc += Mix16B(input + len - 64, secret + 112);
+				}
+				acc += Mix16B(input + 32, secret + 64);
+				acc += Mix16B(input + len - 48, secret + 80);
+			}
+			acc += Mix16B(input + 16, secret + 32);
+			acc += Mix16B(input + len - 32, secret + 48);
 		}
-		status = BCryptHashData(hHash, buffer.data(), dwRead, 0);
-		if (buffer.size() != dwRead)
-			break;
+		acc += Mix16B(input, secret);
+		acc += Mix16B(input + len - 16, secret + 16);
+		return Xxh3Avalanche(acc);
 	}
-	if (status == 0)
+	const size_t nRounds = len / 16;
+	for (size_t i = 0; i < 8; ++i)
+		acc += Mix16B(input + 16 * i, secret + 16 * i);
+	acc = Xxh3Avalanche(acc);
+	for (size_t i = 8; i < nRounds; ++i)
+		acc += Mix16B(input + 16 * i, secret + 16 * (i - 8) + 3);
+	acc += Mix16B(input + len - 16, secret + 136 - 17);
+	return Xxh3Avalanche(acc);
+}
+
+static void Xxh3AccumulateScalar(uint64_t *acc, const uint8_t *input, const uint8_t *secret, size_t nStripes)
+{
+	for (size_t n = 0; n < nStripes; ++n, input += StripeLen, secret += 8)
+	{
+		for (size_t i = 0; i < 8; ++i)
+		{
+			const uint64_t data = Read64(input + 8 * i);
+			const uint64_t key = data ^ Read64(secret + 8 * i);
+			acc[i ^ 1] += data;
+			acc[i] += (key & 0xFFFFFFFF) * (key >> 32);
+		}
+	}
+}
+
+static void Xxh3ScrambleScalar(uint64_t *acc, const uint8_t *secret)
+{
+	for (size_t i = 0; i < 8; ++i)
 	{
-		status = BCryptFinishHash(hHash, hash.data(), static_cast<ULONG>(hash.size()), 0);
+		uint64_t a = acc[i];
+		a ^= a >> 47;
+		a ^= Read64(secret + 8 * i);
+		acc[i] = a * Prime32_1;
 	}
-	return status;
 }
 
-NTSTATUS CalculateHashValue(HANDLE hFile, const wchar_t *pAlgoId, std::vector<uint8_t>& hash)
+#ifdef HASHCALC_X86
+
+TARGET_AVX2 static void Xxh3AccumulateAvx2(uint64_t *acc, const uint8_t *input, const uint8_t *secret, size_t nStripes)
 {
-	hash.clear();
-	BCRYPT_ALG_HANDLE hAlg = nullptr;
-	NTSTATUS status = BCryptOpenAlgorithmProvider(&hAlg, pAlgoId, nullptr, 0);
-	if (status == 0)
+	__m256i acc0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc));
+	__m256i acc1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc + 4));
+	for (size_t n = 0; n < nStripes; ++n, input += StripeLen, secret += 8)
 	{
-		ULONG bytesWritten = 0;
-		ULONG objectSize = 0;
-		status = BCryptGetProperty(hAlg, BCRYPT_OBJECT_LENGTH, reinterpret_cast<PUCHAR>(&objectSize), sizeof(DWORD), &bytesWritten, 0);
-		if (status == 0)
+		const __m256i data0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input));
+		const __m256i data1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + 32));
+		const __m256i key0 = _mm256_xor_si256(data0, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(secret)));
+		const __m256i key1 = _mm256_xor_si256(data1, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(secret + 32)));
+		// Low half times high half of each key word, plus the data word of the other lane
+		const __m256i product0 = _mm256_mul_epu32(key0, _mm256_shuffle_epi32(key0, _MM_SHUFFLE(0, 3, 0, 1)));
+		const __m256i product1 = _mm256_mul_epu32(key1, _mm256_shuffle_epi32(key1, _MM_SHUFFLE(0, 3, 0, 1)));
+		acc0 = _mm256_add_epi64(acc0, _mm256_add_epi64(product0, _mm256_shuffle_epi32(data0, _MM_SHUFFLE(1, 0, 3, 2))));
+		acc1 = _mm256_add_epi64(acc1, _mm256_add_epi64(product1, _mm256_shuffle_epi32(data1, _MM_SHUFFLE(1, 0, 3, 2))));
+	}
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(acc), acc0);
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(acc + 4), acc1);
+}
+
+TARGET_AVX2 static void Xxh3ScrambleAvx2(uint64_t *acc, const uint8_t *secret)
+{
+	const __m256i prime = _mm256_set1_epi32(static_cast<int>(Prime32_1));
+	for (size_t i = 0; i < 8; i += 4)
+	{
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc + i));
+		a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+		const __m256i key = _mm256_xor_si256(a, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(secret + 8 * i)));
+		const __m256i lo = _mm256_mul_epu32(key, prime);
+		const __m256i hi = _mm256_mul_epu32(_mm256_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(acc + i), _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32)));
+	}
+}
+
+#endif // HASHCALC_X86
+
+/**
+ * @brief Returns if the CPU and OS support AVX2.
+ */
+static bool HasAvx2()
+{
+#if defined(HASHCALC_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	const int maxLeaf = info[0];
+	__cpuid(info, 1);
+	// AVX2 also needs the OS to save the YMM registers (OSXSAVE, XCR0)
+	if (maxLeaf < 7 || (info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6)
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#elif defined(HASHCALC_X86)
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+using Xxh3AccumulateFunc = void (*)(uint64_t *acc, const uint8_t *input, const uint8_t *secret, size_t nStripes);
+using Xxh3ScrambleFunc = void (*)(uint64_t *acc, const uint8_t *secret);
+
+static const bool s_hasAvx2 = HasAvx2();
+#ifdef HASHCALC_X86
+static const Xxh3AccumulateFunc Xxh3Accumulate = s_hasAvx2 ? Xxh3AccumulateAvx2 : Xxh3AccumulateScalar;
+static const Xxh3ScrambleFunc Xxh3Scramble = s_hasAvx2 ? Xxh3ScrambleAvx2 : Xxh3ScrambleScalar;
+#else
+static const Xxh3AccumulateFunc Xxh3Accumulate = Xxh3AccumulateScalar;
+static const Xxh3ScrambleFunc Xxh3Scramble = Xxh3ScrambleScalar;
+#endif
+
+static const uint64_t Xxh3InitAcc[8] =
+{
+	Prime32_3, Prime64_1, Prime64_2, Prime64_3, Prime64_4, Prime32_2, Prime64_5, Prime32_1
+};
+
+/** @brief Final digest of the accumulators. */
+static uint64_t Xxh3MergeAccs(const uint64_t *acc, uint64_t totalLen)
+{
+	const uint8_t *secret = Xxh3Secret + 11;
+	uint64_t result = totalLen * Prime64_1;
+	for (size_t i = 0; i < 4; ++i)
+		result += Mul128Fold64(acc[2 * i] ^ Read64(secret + 16 * i), acc[2 * i + 1] ^ Read64(secret + 16 * i + 8));
+	return Xxh3Avalanche(result);
+}
+
+Xxh3Hash::Xxh3Hash()
+: m_bufferedSize(0)
+, m_nStripesInBlock(0)
+, m_totalLen(0)
+{
+	std::copy(std::begin(Xxh3InitAcc), std::end(Xxh3InitAcc), m_acc);
+}
+
+/** @brief Accumulate stripes, scrambling the accumulators after each block. */
+void Xxh3Hash::ConsumeStripes(const uint8_t *input, size_t nStripes)
+{
+	while (nStripes > 0)
+	{
+		const size_t n = (std::min)(nStripes, StripesPerBlock - m_nStripesInBlock);
+		Xxh3Accumulate(m_acc, input, Xxh3Secret + m_nStripesInBlock * 8, n);
+		input += n * StripeLen;
+		nStripes -= n;
+		m_nStripesInBlock += n;
+		if (m_nStripesInBlock == StripesPerBlock)
 		{
-			std::vector<uint8_t> hashObject(objectSize);
-			BCRYPT_HASH_HANDLE hHash = nullptr;
-			status = BCryptCreateHash(hAlg, &hHash, hashObject.data(), static_cast<ULONG>(hashObject.size()), nullptr, 0, 0);
-			if (status == 0)
-			{
-				ULONG hashSize = 0;
-				status = BCryptGetProperty(hAlg, BCRYPT_HASH_LENGTH, reinterpret_cast<PUCHAR>(&hashSize), sizeof(DWORD), &bytesWritten, 0);
-				if (status == 0)
-				{
-					status = CalculateHashValue(hFile, hHash, hashSize, hash);
-				}
-				BCryptDestroyHash(hHash);
-			}
+			Xxh3Scramble(m_acc, Xxh3Secret + SecretSize - StripeLen);
+			m_nStripesInBlock = 0;
+		}
+	}
+}
+
+/**
+ * @brief Add next block of data.
+ * The last byte is always kept in the buffer, the last stripe is hashed
+ * differently by Finish().
+ */
+void Xxh3Hash::Update(const void *data, size_t len)
+{
+	const uint8_t *input = static_cast<const uint8_t *>(data);
+	const uint8_t *end = input + len;
+	m_totalLen += len;
+	if (m_bufferedSize + len <= BufferSize)
+	{
+		if (len > 0)
+			memcpy(m_buffer + m_bufferedSize, input, len);
+		m_bufferedSize += len;
+		return;
+	}
+	if (m_bufferedSize > 0)
+	{
+		const size_t fill = BufferSize - m_bufferedSize;
+		memcpy(m_buffer + m_bufferedSize, input, fill);
+		input += fill;
+		ConsumeStripes(m_buffer, BufferSize / StripeLen);
+		m_bufferedSize = 0;
+	}
+	if (static_cast<size_t>(end - input) > BufferSize)
+	{
+		const size_t nStripes = (end - input - 1) / StripeLen;
+		ConsumeStripes(input, nStripes);
+		input += nStripes * StripeLen;
+		// Finish() completes a short last stripe with the stripe before it
+		memcpy(m_buffer + BufferSize - StripeLen, input - StripeLen, StripeLen);
+	}
+	m_bufferedSize = end - input;
+	memcpy(m_buffer, input, m_bufferedSize);
+}
+
+/** @brief Digest of the data added so far. */
+uint64_t Xxh3Hash::Finish() const
+{
+	if (m_totalLen <= MidSizeMax)
+		return Xxh3HashShort(m_buffer, static_cast<size_t>(m_totalLen));
+	Xxh3Hash state(*this);
+	uint8_t lastStripe[StripeLen];
+	const uint8_t *last;
+	if (m_bufferedSize >= StripeLen)
+	{
+		state.ConsumeStripes(m_buffer, (m_bufferedSize - 1) / StripeLen);
+		last = m_buffer + m_bufferedSize - StripeLen;
+	}
+	else
+	{
+		const size_t catchup = StripeLen - m_bufferedSize;
+		memcpy(lastStripe, m_buffer + BufferSize - catchup, catchup);
+		memcpy(lastStripe + catchup, m_buffer, m_bufferedSize);
+		last = lastStripe;
+	}
+	Xxh3Accumulate(state.m_acc, last, Xxh3Secret + SecretSize - StripeLen - 7, 1);
+	return Xxh3MergeAccs(state.m_acc, m_totalLen);
+}
+
+/** @brief Digest of data in memory. */
+uint64_t Xxh3Hash::Hash(const void *data, size_t len)
+{
+	const uint8_t *input = static_cast<const uint8_t *>(data);
+	if (len <= MidSizeMax)
+		return Xxh3HashShort(input, len);
+	uint64_t acc[8];
+	std::copy(std::begin(Xxh3InitAcc), std::end(Xxh3InitAcc), acc);
+	const size_t blockLen = StripesPerBlock * StripeLen;
+	const size_t nBlocks = (len - 1) / blockLen;
+	for (size_t n = 0; n < nBlocks; ++n)
+	{
+		Xxh3Accumulate(acc, input + n * blockLen, Xxh3Secret, StripesPerBlock);
+		Xxh3Scramble(acc, Xxh3Secret + SecretSize - StripeLen);
+	}
+	const size_t nStripes = ((len - 1) - blockLen * nBlocks) / StripeLen;
+	Xxh3Accumulate(acc, input + nBlocks * blockLen, Xxh3Secret, nStripes);
+	Xxh3Accumulate(acc, input + len - StripeLen, Xxh3Secret + SecretSize - StripeLen - 7, 1);
+	return Xxh3MergeAccs(acc, len);
+}
+
+#ifdef _WIN64
+/** @brief CNG providers shared by all calculators, nullptr if not available. */
+static BCRYPT_ALG_HANDLE GetAlgorithm(HashCalc::Algorithm algorithm)
+{
+	static const std::array<BCRYPT_ALG_HANDLE, HashCalc::XXH3> hAlgs = []
+	{
+		const wchar_t *pAlgoIds[HashCalc::XXH3] = { BCRYPT_MD5_ALGORITHM, BCRYPT_SHA1_ALGORITHM, BCRYPT_SHA256_ALGORITHM };
+		std::array<BCRYPT_ALG_HANDLE, HashCalc::XXH3> handles{};
+		for (int i = 0; i < HashCalc::XXH3; ++i)
+		{
+			if (BCryptOpenAlgorithmProvider(&handles[i], pAlgoIds[i], nullptr, 0) != 0)
+				handles[i] = nullptr;
+		}
+		return handles;
+	}();
+	return hAlgs[algorithm];
+}
+#endif
+
+/**
+ * @brief Constructor.
+ * @param [in] algorithms Flag() of the algorithms to compute.
+ */
+HashCalc::HashCalc(unsigned algorithms)
+: m_algorithms(algorithms)
+, m_hHashes{}
+{
+	for (int i = 0; i < XXH3; ++i)
+	{
+		if ((m_algorithms & Flag(static_cast<Algorithm>(i))) == 0)
+			continue;
+#ifdef _WIN64
+		BCRYPT_ALG_HANDLE hAlg = GetAlgorithm(static_cast<Algorithm>(i));
+		BCRYPT_HASH_HANDLE hHash = nullptr;
+		if (hAlg != nullptr && BCryptCreateHash(hAlg, &hHash, nullptr, 0, nullptr, 0, 0) == 0)
+		{
+			m_hHashes[i] = hHash;
+			continue;
+		}
+#endif
+		switch (i)
+		{
+		case MD5: m_engines[i].reset(new Poco::MD5Engine); break;
+		case SHA1: m_engines[i].reset(new Poco::SHA1Engine); break;
+		case SHA256: m_engines[i].reset(new Poco::SHA2Engine(Poco::SHA2Engine::SHA_256)); break;
 		}
-		BCryptCloseAlgorithmProvider(hAlg, 0);
 	}
-	return status;
 }
 
-#endif
\ No newline at end of file
+HashCalc::~HashCalc()
+{
+#ifdef _WIN64
+	for (void *hHash : m_hHashes)
+	{
+		if (hHash != nullptr)
+			BCryptDestroyHash(hHash);
+	}
+#endif
+}
+
+/**
+ * @brief Add next block of data to every selected digest.
+ */
+void HashCalc::Update(const void *data, size_t len)
+{
+	const uint8_t *ptr = static_cast<const uint8_t *>(data);
+	for (size_t pos = 0; pos < len; pos += SliceSize)
+	{
+		const size_t size = (std::min)(SliceSize, len - pos);
+		for (int i = 0; i < XXH3; ++i)
+		{
+#ifdef _WIN64
+			if (m_hHashes[i] != nullptr)
+				BCryptHashData(m_hHashes[i], const_cast<PUCHAR>(ptr + pos), static_cast<ULONG>(size), 0);
+			else
+#endif
+			if (m_engines[i])
+				m_engines[i]->update(ptr + pos, size);
+		}
+		if (m_algorithms & Flag(XXH3))
+			m_xxh3.Update(ptr + pos, size);
+	}
+}
+
+/**
+ * @brief Get the digests of the data added.
+ * The digests not selected are left empty, XXH3 is stored big-endian
+ * like xxhsum prints it.
+ */
+void HashCalc::Finish(Hashes& hashes)
+{
+	for (int i = 0; i < AlgorithmCount; ++i)
+	{
+		hashes[i].clear();
+		if ((m_algorithms & Flag(static_cast<Algorithm>(i))) == 0)
+			continue;
+		hashes[i].resize(HashSizes[i]);
+		if (i == XXH3)
+		{
+			const uint64_t value = m_xxh3.Finish();
+			for (size_t b = 0; b < 8; ++b)
+				hashes[i][b] = static_cast<uint8_t>(value >> (56 - 8 * b));
+			continue;
+		}
+#ifdef _WIN64
+		if (m_hHashes[i] != nullptr)
+		{
+			if (BCryptFinishHash(m_hHashes[i], hashes[i].data(), static_cast<ULONG>(hashes[i].size()), 0) != 0)
+				hashes[i].clear();
+			BCryptDestroyHash(m_hHashes[i]);
+			m_hHashes[i] = nullptr;
+			continue;
+		}
+#endif
+		const Poco::DigestEngine::Digest& digest = m_engines[i]->digest();
+		hashes[i].assign(digest.begin(), digest.end());
+	}
+}
+
+/**
+ * @brief Compute the selected digests of a file, reading it once.
+ * @return false if the file couldn't be read, the digests are empty then.
+ */
+bool HashCalc::HashFile(const String& filepath, unsigned algorithms, Hashes& hashes)
+{
+	for (auto& hash : hashes)
+		hash.clear();
+	std::unique_ptr<char[]> buf(new char[HashBufferSize]);
+	HashCalc calc(algorithms);
+	int fd = -1;
+	cio::tsopen_s(&fd, filepath, O_BINARY | O_RDONLY, _SH_DENYNO, _S_IREAD);
+	if (fd == -1)
+		return false;
+	bool bSuccess = true;
+	for (;;)
+	{
+		const int size = cio::read_i(fd, buf.get(), HashBufferSize);
+		if (size <= 0)
+		{
+			bSuccess = (size == 0);
+			break;
+		}
+		calc.Update(buf.get(), size);
+	}
+	cio::close(fd);
+	if (bSuccess)
+		calc.Finish(hashes);
+	return bSuccess;
+}
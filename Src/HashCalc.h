@@ -1,11 +1,73 @@
-/** 
+/**
  * @file  HashCalc.h
  *
  * @brief Declaration file for HashCalc
  */
 #pragma once
 
-#include <windows.h>
+#include <array>
+#include <cstdint>
+#include <memory>
 #include <vector>
+#include "UnicodeString.h"
 
-NTSTATUS CalculateHashValue(HANDLE hFile, const wchar_t* pAlgoId, std::vector<uint8_t>& hash);
+namespace Poco { class DigestEngine; }
+
+/**
+ * @brief XXH3 64-bit digest of data fed in blocks of any size.
+ *
+ * Gives the values of XXH3_64bits() of xxHash (default secret, seed 0).
+ * It is not a cryptographic digest but runs at memory speed, which makes
+ * it the digest of choice to find duplicate files.
+ */
+class Xxh3Hash
+{
+public:
+	Xxh3Hash();
+	void Update(const void *data, size_t len);
+	uint64_t Finish() const;
+	static uint64_t Hash(const void *data, size_t len);
+
+private:
+	static constexpr size_t BufferSize = 256; /**< Four stripes of 64 bytes */
+
+	void ConsumeStripes(const uint8_t *input, size_t nStripes);
+
+	uint64_t m_acc[8];
+	uint8_t m_buffer[BufferSize]; /**< Input not consumed yet, the last stripe consumed at its end */
+	size_t m_bufferedSize;
+	size_t m_nStripesInBlock; /**< Stripes consumed since the last scramble */
+	uint64_t m_totalLen;
+};
+
+/**
+ * @brief Computes several digests of the same data in one pass.
+ *
+ * Each block of data given to Update() is fed to every selected digest in
+ * turn, in slices which stay in the CPU cache. MD5, SHA-1 and SHA-256 use
+ * the CNG providers where available, which pick the SHA extensions of the
+ * CPU, and Poco's engines elsewhere.
+ */
+class HashCalc
+{
+public:
+	enum Algorithm { MD5, SHA1, SHA256, XXH3, AlgorithmCount };
+	/** @brief Digests by Algorithm, empty for the algorithms not selected. */
+	using Hashes = std::array<std::vector<uint8_t>, AlgorithmCount>;
+
+	static constexpr unsigned Flag(Algorithm algorithm) { return 1u << algorithm; }
+
+	explicit HashCalc(unsigned algorithms);
+	HashCalc(const HashCalc&) = delete;
+	~HashCalc();
+	void Update(const void *data, size_t len);
+	void Finish(Hashes& hashes);
+
+	static bool HashFile(const String& filepath, unsigned algorithms, Hashes& hashes);
+
+private:
+	unsigned m_algorithms; /**< Flag() of the selected algorithms */
+	void *m_hHashes[XXH3]; /**< CNG hash handles, or nullptr to use m_engines */
+	std::unique_ptr<Poco::DigestEngine> m_engines[XXH3];
+	Xxh3Hash m_xxh3;
+};
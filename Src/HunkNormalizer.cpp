@@ -0,0 +1,204 @@
+/**
+ * @file  HunkNormalizer.cpp
+ *
+ * @brief Implementation of HunkNormalizer class.
+ */
+
+#include "pch.h"
+#include "HunkNormalizer.h"
+#include <cctype>
+#include "CompareOptions.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define HUNKNORMALIZER_SSE2
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief Constructor.
+ * @param [in] ignoreWhitespace WHITESPACE_COMPARE_ALL, WHITESPACE_IGNORE_CHANGE or WHITESPACE_IGNORE_ALL.
+ * @param [in] ignoreNumbers Remove the digits.
+ * @param [in] ignoreCase Convert to upper case.
+ * @param [in] ignoreEOLDifference Convert CR+LF and CR to LF.
+ */
+HunkNormalizer::HunkNormalizer(int ignoreWhitespace, bool ignoreNumbers, bool ignoreCase, bool ignoreEOLDifference)
+: m_ignoreWhitespace(ignoreWhitespace)
+, m_ignoreNumbers(ignoreNumbers)
+, m_ignoreCase(ignoreCase)
+, m_ignoreEOLDifference(ignoreEOLDifference)
+{
+	for (int i = 0; i < 256; ++i)
+	{
+		m_class[i] = Plain;
+		m_upper[i] = static_cast<char>(::toupper(i));
+	}
+	if (m_ignoreWhitespace != WHITESPACE_COMPARE_ALL)
+		m_class[static_cast<unsigned char>(' ')] = m_class[static_cast<unsigned char>('\t')] = Space;
+	if (m_ignoreNumbers)
+	{
+		for (int ch = '0'; ch <= '9'; ++ch)
+			m_class[ch] = Digit;
+	}
+	if (m_ignoreEOLDifference)
+	{
+		m_class[static_cast<unsigned char>('\r')] = CR;
+		m_class[static_cast<unsigned char>('\n')] = LF;
+	}
+}
+
+/**
+ * @brief Find the first byte which isn't copied as is, or @p end.
+ */
+const char *HunkNormalizer::FindSpecial(const char *ptr, const char *end) const
+{
+#ifdef HUNKNORMALIZER_SSE2
+	const __m128i enableSpace = _mm_set1_epi8(m_ignoreWhitespace != WHITESPACE_COMPARE_ALL ? -1 : 0);
+	const __m128i enableDigit = _mm_set1_epi8(m_ignoreNumbers ? -1 : 0);
+	const __m128i enableEol = _mm_set1_epi8(m_ignoreEOLDifference ? -1 : 0);
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i zero = _mm_set1_epi8('0');
+	const __m128i nine = _mm_set1_epi8(9);
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i lf = _mm_set1_epi8('\n');
+	for (; end - ptr >= 16; ptr += 16)
+	{
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+		const __m128i isSpace = _mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab));
+		// v - '0' <= 9 unsigned
+		const __m128i isDigit = _mm_cmpeq_epi8(_mm_subs_epu8(_mm_sub_epi8(v, zero), nine), _mm_setzero_si128());
+		const __m128i isEol = _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf));
+		const __m128i special = _mm_or_si128(_mm_and_si128(isSpace, enableSpace),
+			_mm_or_si128(_mm_and_si128(isDigit, enableDigit), _mm_and_si128(isEol, enableEol)));
+		const int mask = _mm_movemask_epi8(special);
+		if (mask != 0)
+		{
+			for (; m_class[static_cast<unsigned char>(*ptr)] == Plain; ++ptr)
+				;
+			return ptr;
+		}
+	}
+#endif
+	for (; ptr < end && m_class[static_cast<unsigned char>(*ptr)] == Plain; ++ptr)
+		;
+	return ptr;
+}
+
+/** @brief Append bytes copied as is, in upper case if case is ignored. */
+void HunkNormalizer::AppendPlain(const char *begin, const char *end, std::string& out) const
+{
+	if (!m_ignoreCase)
+	{
+		out.append(begin, end);
+		return;
+	}
+	const size_t pos = out.length();
+	out.resize(pos + (end - begin));
+	char *dst = &out[pos];
+	for (const char *src = begin; src < end; ++src)
+		*dst++ = m_upper[static_cast<unsigned char>(*src)];
+}
+
+/**
+ * @brief Normalize the text of a hunk.
+ * A run of spaces and tabs becomes one space (WHITESPACE_IGNORE_CHANGE) or
+ * is removed (WHITESPACE_IGNORE_ALL), digits are removed, letters are
+ * converted to upper case and CR+LF and CR are converted to LF. Runs of
+ * spaces are those of the text before the digits are removed, and CR+LF
+ * pairs those of the text after.
+ * @param [in] begin, end Text of the hunk.
+ * @param [out] out Normalized text, the buffer is reused.
+ */
+void HunkNormalizer::Normalize(const char *begin, const char *end, std::string& out) const
+{
+	out.clear();
+	out.reserve(end - begin);
+	bool inSpaces = false; // Last byte read was a space or tab
+	bool afterCR = false; // Last byte written was a CR converted to LF
+	for (const char *ptr = begin; ptr < end;)
+	{
+		const char *special = FindSpecial(ptr, end);
+		if (special > ptr)
+		{
+			AppendPlain(ptr, special, out);
+			inSpaces = afterCR = false;
+			ptr = special;
+			if (ptr == end)
+				break;
+		}
+		switch (m_class[static_cast<unsigned char>(*ptr++)])
+		{
+		case Space:
+			if (m_ignoreWhitespace == WHITESPACE_IGNORE_CHANGE && !inSpaces)
+			{
+				out += ' ';
+				afterCR = false;
+			}
+			inSpaces = true;
+			break;
+		case Digit:
+			inSpaces = false;
+			break;
+		case CR:
+			out += '\n';
+			inSpaces = false;
+			afterCR = true;
+			break;
+		case LF:
+			if (!afterCR)
+				out += '\n';
+			inSpaces = afterCR = false;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Join the lines of a normalized hunk into one line.
+ * CR+LF pairs and runs of other CRs and LFs become spaces, then the spaces
+ * and tabs are ignored like Normalize() ignores them.
+ * @param [in] text Text of the hunk.
+ * @param [out] out Text as one line, the buffer is reused.
+ */
+void HunkNormalizer::JoinLines(const std::string& text, std::string& out) const
+{
+	out.clear();
+	out.reserve(text.length());
+	bool inSpaces = false;
+	auto put = [&](char ch)
+	{
+		if ((ch == ' ' || ch == '\t') && m_ignoreWhitespace != WHITESPACE_COMPARE_ALL)
+		{
+			if (m_ignoreWhitespace == WHITESPACE_IGNORE_CHANGE && !inSpaces)
+				out += ' ';
+			inSpaces = true;
+			return;
+		}
+		out += ch;
+		inSpaces = false;
+	};
+	const size_t len = text.length();
+	for (size_t i = 0; i < len;)
+	{
+		const char ch = text[i];
+		if (ch == '\r' && i + 1 < len && text[i + 1] == '\n')
+		{
+			put(' ');
+			i += 2;
+		}
+		else if (ch == '\r' || ch == '\n')
+		{
+			put(' ');
+			// A CR+LF pair after the run is a space of its own
+			for (++i; i < len && (text[i] == '\n' || (text[i] == '\r' && !(i + 1 < len && text[i + 1] == '\n'))); ++i)
+				;
+		}
+		else
+		{
+			put(ch);
+			++i;
+		}
+	}
+}
@@ -0,0 +1,41 @@
+/**
+ * @file  HunkNormalizer.h
+ *
+ * @brief Declaration of HunkNormalizer class.
+ */
+#pragma once
+
+#include <string>
+
+/**
+ * @brief Normalizes the text of a diff hunk for the compare options.
+ *
+ * The text is copied once, with the ignored whitespace, numbers, case and
+ * EOL differences removed on the way, into a buffer the caller reuses from
+ * hunk to hunk. The result is the same as applying the options one after
+ * another in the order CDiffWrapper::PostFilter() used to: whitespace,
+ * numbers, case, then EOL.
+ */
+class HunkNormalizer
+{
+public:
+	HunkNormalizer(int ignoreWhitespace = 0, bool ignoreNumbers = false, bool ignoreCase = false, bool ignoreEOLDifference = false);
+
+	void Normalize(const char *begin, const char *end, std::string& out) const;
+	void Normalize(const std::string& text, std::string& out) const { Normalize(text.data(), text.data() + text.length(), out); }
+	void JoinLines(const std::string& text, std::string& out) const;
+
+private:
+	/** @brief How a byte is handled, see Normalize(). */
+	enum CharClass : unsigned char { Plain, Space, Digit, CR, LF };
+
+	const char *FindSpecial(const char *ptr, const char *end) const;
+	void AppendPlain(const char *begin, const char *end, std::string& out) const;
+
+	int m_ignoreWhitespace;
+	bool m_ignoreNumbers;
+	bool m_ignoreCase;
+	bool m_ignoreEOLDifference;
+	CharClass m_class[256]; /**< Class of each byte for the options */
+	char m_upper[256]; /**< Upper case of each byte */
+};
@@ -34,6 +34,7 @@
 #include "DropHandler.h"
 #include "Environment.h"
 #include "MyColorDialog.h"
+#include "CompareOptions.h"
 #include <cmath>
 
 #ifdef _DEBUG
@@ -1320,7 +1321,11 @@ void CImgMergeFrame::RefreshOptions()
 	m_pImgMergeWindow->SetDiffDeletedColor(colors.clrDiffDeleted);
 	m_pImgMergeWindow->SetSelDiffColor(colors.clrSelDiff);
 	m_pImgMergeWindow->SetSelDiffDeletedColor(colors.clrSelDiffDeleted);
-	m_pImgMergeWindow->SetDiffAlgorithm(static_cast<IImgMergeWindow::DIFF_ALGORITHM>(GetOptionsMgr()->GetInt(OPT_CMP_DIFF_ALGORITHM)));
+	// Images are compared in memory, the streaming diff is for large files
+	int nDiffAlgorithm = GetOptionsMgr()->GetInt(OPT_CMP_DIFF_ALGORITHM);
+	if (nDiffAlgorithm == DIFF_ALGORITHM_STREAMING)
+		nDiffAlgorithm = DIFF_ALGORITHM_PATIENCE;
+	m_pImgMergeWindow->SetDiffAlgorithm(static_cast<IImgMergeWindow::DIFF_ALGORITHM>(nDiffAlgorithm));
 }
 
 /**
@@ -0,0 +1,266 @@
+/**
+ * @file  IncrementalRescan.cpp
+ *
+ * @brief Implementation of IncrementalRescan class.
+ */
+
+#include "pch.h"
+#include "IncrementalRescan.h"
+#include <algorithm>
+#include <cstring>
+#include "DebugNew.h"
+
+IncrementalRescan::IncrementalRescan()
+: m_nFiles(0)
+, m_window{}
+, m_nContextLines(8)
+, m_nMaxWindowPercent(50)
+{
+}
+
+/** @brief Forget the stored rescan, next Update() asks for a full rescan. */
+void IncrementalRescan::Reset()
+{
+	m_nFiles = 0;
+	for (auto& hashes : m_lineHashes)
+		std::vector<uint64_t>().swap(hashes);
+	m_diffList.Clear();
+	m_window = {};
+}
+
+/**
+ * @brief Store the result of a full rescan.
+ * @param [in] nFiles Number of files, 2 or 3.
+ * @param [in,out] lineHashes Hash of each real line of the files, the
+ *   vectors are moved to this object.
+ * @param [in] diffList Diff list in real line numbers.
+ */
+void IncrementalRescan::Store(int nFiles, std::vector<uint64_t> lineHashes[], const DiffList& diffList)
+{
+	m_nFiles = nFiles;
+	for (int file = 0; file < nFiles; ++file)
+		m_lineHashes[file].swap(lineHashes[file]);
+	m_diffList = diffList;
+}
+
+/**
+ * @brief Compare the files again after they were edited.
+ * @param [in,out] lineHashes Hash of each real line of the edited files, the
+ *   vectors are moved to this object unless a full rescan is needed.
+ * @param [in] diffWindow Function comparing the lines of the window.
+ * @param [out] diffList Diff list of the edited files.
+ * @return Result::FullRescan if the files must be compared as a whole, the
+ *   stored rescan is forgotten then.
+ */
+IncrementalRescan::Result IncrementalRescan::Update(std::vector<uint64_t> lineHashes[],
+	const DiffWindowFunc& diffWindow, DiffList& diffList)
+{
+	if (!IsValid())
+		return Result::FullRescan;
+
+	int editBegin[3], editEnd[3];
+	if (!FindEditedLines(lineHashes, editBegin, editEnd))
+	{
+		diffList = m_diffList;
+		return Result::Unchanged;
+	}
+
+	int lastDiffBefore, firstDiffAfter;
+	if (!FindWindow(editBegin, editEnd, lastDiffBefore, firstDiffAfter))
+	{
+		Reset();
+		return Result::FullRescan;
+	}
+
+	int delta[3] = {};
+	int nWindowLines = 0, nLines = 0;
+	for (int file = 0; file < m_nFiles; ++file)
+	{
+		delta[file] = static_cast<int>(lineHashes[file].size() - m_lineHashes[file].size());
+		m_window.end[file] += delta[file];
+		nWindowLines += m_window.end[file] - m_window.begin[file];
+		nLines += static_cast<int>(lineHashes[file].size());
+	}
+	// The anchors are too far apart for a partial compare to pay off
+	if (static_cast<int64_t>(nWindowLines) * 100 > static_cast<int64_t>(nLines) * m_nMaxWindowPercent)
+	{
+		Reset();
+		return Result::FullRescan;
+	}
+
+	DiffList windowDiffList;
+	if (!diffWindow(m_window, windowDiffList))
+	{
+		Reset();
+		return Result::FullRescan;
+	}
+
+	Splice(windowDiffList, lastDiffBefore, firstDiffAfter, delta, diffList);
+	m_diffList = diffList;
+	for (int file = 0; file < m_nFiles; ++file)
+		m_lineHashes[file].swap(lineHashes[file]);
+	return Result::Updated;
+}
+
+/**
+ * @brief Find the lines changed since the stored rescan.
+ * The edited lines of a file are the lines between the longest common
+ * prefix and the longest common suffix of the old and the new lines.
+ * @param [in] lineHashes Hash of each line of the edited files.
+ * @param [out] editBegin First edited line of each file.
+ * @param [out] editEnd Line after the edited lines in each old file.
+ * @return false if no file changed.
+ */
+bool IncrementalRescan::FindEditedLines(const std::vector<uint64_t> lineHashes[], int editBegin[], int editEnd[]) const
+{
+	bool bEdited = false;
+	for (int file = 0; file < m_nFiles; ++file)
+	{
+		const std::vector<uint64_t>& oldLines = m_lineHashes[file];
+		const std::vector<uint64_t>& newLines = lineHashes[file];
+		const size_t common = (std::min)(oldLines.size(), newLines.size());
+		const size_t prefix = std::mismatch(oldLines.begin(), oldLines.begin() + common, newLines.begin()).first - oldLines.begin();
+		const size_t suffix = std::mismatch(oldLines.rbegin(), oldLines.rbegin() + (common - prefix), newLines.rbegin()).first - oldLines.rbegin();
+		editBegin[file] = static_cast<int>(prefix);
+		editEnd[file] = static_cast<int>(oldLines.size() - suffix);
+		if (prefix != oldLines.size() || prefix != newLines.size())
+			bEdited = true;
+		else
+			editBegin[file] = editEnd[file] = -1;
+	}
+	return bEdited;
+}
+
+/**
+ * @brief Find the window of lines to compare again around the edits.
+ * The window bounds are anchors where the files are in sync: lines between
+ * two diffs of the stored diff list, which have the same offset from the
+ * previous diff in all files. The window begins at the last anchor at least
+ * m_nContextLines before the edits and ends at the first anchor at least
+ * m_nContextLines after them, or at the begin and end of the files.
+ * @param [in] editBegin, editEnd Edited lines of each old file, -1 if the
+ *   file was not edited.
+ * @param [out] lastDiffBefore Index of last stored diff before the window.
+ * @param [out] firstDiffAfter Index of first stored diff after the window.
+ * @return false if the stored diff list doesn't keep the files in sync.
+ */
+bool IncrementalRescan::FindWindow(const int editBegin[], const int editEnd[], int& lastDiffBefore, int& firstDiffAfter)
+{
+	const int nDiffs = m_diffList.GetSize();
+	// Lines in sync between diffs nRegion-1 and nRegion
+	auto getRegion = [&](int nRegion, int begin[], int& length)
+	{
+		const DIFFRANGE *pPrev = (nRegion > 0) ? m_diffList.DiffRangeAt(nRegion - 1) : nullptr;
+		const DIFFRANGE *pNext = (nRegion < nDiffs) ? m_diffList.DiffRangeAt(nRegion) : nullptr;
+		for (int file = 0; file < m_nFiles; ++file)
+		{
+			begin[file] = pPrev ? pPrev->end[file] + 1 : 0;
+			const int end = pNext ? pNext->begin[file] : static_cast<int>(m_lineHashes[file].size());
+			if (file == 0)
+				length = end - begin[file];
+			else if (end - begin[file] != length)
+				return false;
+		}
+		return length >= 0;
+	};
+
+	int begin[3], length;
+	bool bFound = false;
+	for (int nRegion = nDiffs; nRegion >= 0 && !bFound; --nRegion)
+	{
+		if (!getRegion(nRegion, begin, length))
+			return false;
+		int offset = length;
+		for (int file = 0; file < m_nFiles; ++file)
+		{
+			if (editBegin[file] >= 0)
+				offset = (std::min)(offset, editBegin[file] - m_nContextLines - begin[file]);
+		}
+		if (offset >= 0 || nRegion == 0)
+		{
+			for (int file = 0; file < m_nFiles; ++file)
+				m_window.begin[file] = begin[file] + (std::max)(offset, 0);
+			lastDiffBefore = nRegion - 1;
+			bFound = true;
+		}
+	}
+
+	bFound = false;
+	for (int nRegion = lastDiffBefore + 1; nRegion <= nDiffs && !bFound; ++nRegion)
+	{
+		if (!getRegion(nRegion, begin, length))
+			return false;
+		int offset = 0;
+		for (int file = 0; file < m_nFiles; ++file)
+		{
+			if (editBegin[file] >= 0)
+				offset = (std::max)(offset, editEnd[file] + m_nContextLines - begin[file]);
+		}
+		if (offset <= length || nRegion == nDiffs)
+		{
+			m_window.bEndOfFile = true;
+			for (int file = 0; file < m_nFiles; ++file)
+			{
+				m_window.end[file] = begin[file] + (std::min)(offset, length);
+				if (m_window.end[file] != static_cast<int>(m_lineHashes[file].size()))
+					m_window.bEndOfFile = false;
+			}
+			firstDiffAfter = nRegion;
+			bFound = true;
+		}
+	}
+	return bFound;
+}
+
+/**
+ * @brief Replace the stored diffs inside the window with the diffs of the window.
+ * @param [in] windowDiffList Diffs of the window, relative to the window begin.
+ * @param [in] lastDiffBefore, firstDiffAfter Stored diffs kept.
+ * @param [in] delta Number of lines added to each file.
+ * @param [out] diffList Diff list of the edited files.
+ */
+void IncrementalRescan::Splice(const DiffList& windowDiffList, int lastDiffBefore, int firstDiffAfter,
+	const int delta[], DiffList& diffList) const
+{
+	diffList.Clear();
+	for (int nDiff = 0; nDiff <= lastDiffBefore; ++nDiff)
+		diffList.AddDiff(*m_diffList.DiffRangeAt(nDiff));
+
+	int offset[3] = {};
+	std::copy_n(m_window.begin, m_nFiles, offset);
+	diffList.AppendDiffList(windowDiffList, offset);
+
+	for (int nDiff = firstDiffAfter; nDiff < m_diffList.GetSize(); ++nDiff)
+	{
+		DIFFRANGE dr = *m_diffList.DiffRangeAt(nDiff);
+		for (int file = 0; file < m_nFiles; ++file)
+		{
+			dr.begin[file] += delta[file];
+			dr.end[file] += delta[file];
+		}
+		diffList.AddDiff(dr);
+	}
+}
+
+/**
+ * @brief Hash of a line, used to find the edited lines.
+ * @param [in] data Line contents including the EOL.
+ * @param [in] size Size of the line in bytes.
+ */
+uint64_t IncrementalRescan::HashLine(const void *data, size_t size)
+{
+	const unsigned char *p = static_cast<const unsigned char *>(data);
+	uint64_t h = 0x9E3779B97F4A7C15ULL ^ size;
+	for (; size >= 8; p += 8, size -= 8)
+	{
+		uint64_t w;
+		memcpy(&w, p, 8);
+		h = (h ^ w) * 0xFF51AFD7ED558CCDULL;
+		h ^= h >> 32;
+	}
+	uint64_t w = 0;
+	if (size > 0)
+		memcpy(&w, p, size);
+	h = (h ^ w) * 0xC4CEB9FE1A85EC53ULL;
+	return h ^ (h >> 29);
+}
@@ -0,0 +1,74 @@
+/**
+ * @file  IncrementalRescan.h
+ *
+ * @brief Declaration of IncrementalRescan class.
+ */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "DiffList.h"
+
+/**
+ * @brief Re-diffs only the part of the files around localized edits.
+ *
+ * Keeps the hash of every real line of the compared files and the diff
+ * list of the last rescan. Update() finds the lines that changed since,
+ * widens them to the nearest anchors where all files are in sync (lines
+ * between two diffs of the old diff list, at least m_nContextLines
+ * unchanged lines away from the edits), lets the caller compare only that
+ * window and splices the result into the old diff list.
+ * Update() asks for a full rescan when no anchors are left around the
+ * edits, i.e. when the window would cover most of the files.
+ */
+class IncrementalRescan
+{
+public:
+	/** @brief Real lines of the files to compare again. */
+	struct Window
+	{
+		int begin[3]; /**< First line of the window */
+		int end[3]; /**< Line after the window, in the edited files */
+		bool bEndOfFile; /**< Window reaches the end of all files */
+	};
+
+	/** @brief Result of Update(). */
+	enum class Result
+	{
+		Unchanged, /**< No lines changed, diff list is the stored one */
+		Updated, /**< Window was compared and spliced to the diff list */
+		FullRescan, /**< Files must be compared again as a whole */
+	};
+
+	/**
+	 * @brief Compares the lines of the window.
+	 * The diff list must be in line numbers relative to the window begin.
+	 */
+	using DiffWindowFunc = std::function<bool(const Window& window, DiffList& windowDiffList)>;
+
+	IncrementalRescan();
+
+	void Reset();
+	bool IsValid() const { return m_nFiles > 0; }
+	void Store(int nFiles, std::vector<uint64_t> lineHashes[], const DiffList& diffList);
+	Result Update(std::vector<uint64_t> lineHashes[], const DiffWindowFunc& diffWindow, DiffList& diffList);
+	const Window& GetLastWindow() const { return m_window; }
+
+	void SetContextLines(int nLines) { m_nContextLines = nLines; }
+	void SetMaxWindowPercent(int nPercent) { m_nMaxWindowPercent = nPercent; }
+
+	static uint64_t HashLine(const void *data, size_t size);
+
+private:
+	bool FindEditedLines(const std::vector<uint64_t> lineHashes[], int editBegin[], int editEnd[]) const;
+	bool FindWindow(const int editBegin[], const int editEnd[], int& lastDiffBefore, int& firstDiffAfter);
+	void Splice(const DiffList& windowDiffList, int lastDiffBefore, int firstDiffAfter, const int delta[], DiffList& diffList) const;
+
+	int m_nFiles; /**< Number of files, 0 if nothing is stored */
+	std::vector<uint64_t> m_lineHashes[3]; /**< Hash of each real line at last rescan */
+	DiffList m_diffList; /**< Diff list of last rescan, before ghost lines were added */
+	Window m_window; /**< Window compared by last Update() */
+	int m_nContextLines; /**< Unchanged lines kept between the edits and the window bounds */
+	int m_nMaxWindowPercent; /**< Largest window, in percent of the lines, compared alone */
+};
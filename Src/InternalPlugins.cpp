@@ -11,6 +11,9 @@
 #include <Poco/Exception.h>
 #include <vector>
 #include <list>
+#include <mutex>
+#include <optional>
+#include <thread>
 #include <windows.h>
 #include <Shlwapi.h>
 #include "InternalPlugins.h"
@@ -23,6 +26,7 @@
 #include "UniFile.h"
 #include "WinMergePluginBase.h"
 #include "TempFile.h"
+#include "PluginWorkerPool.h"
 
 using Poco::FileStream;
 using Poco::Exception;
@@ -97,6 +101,7 @@ inline static const std::string ScriptElement = "script";
 inline static const std::string NameAttribute = "name";
 inline static const std::string ValueAttribute = "value";
 inline static const std::string FileExtensionAttribute = "fileExtension";
+inline static const std::string WorkersAttribute = "workers";
 
 class XMLHandler : public Poco::XML::ContentHandler
 {
@@ -151,35 +156,17 @@ public:
 						plugin.m_pipeline = std::move(value);
 				}
 				else if (localName == PrediffFileElement)
-				{
-					plugin.m_prediffFile.reset(new Method());
-					m_pMethod = plugin.m_prediffFile.get();
-				}
+					m_pMethod = newMethod(plugin.m_prediffFile, attributes);
 				else if (localName == UnpackFileElement)
-				{
-					plugin.m_unpackFile.reset(new Method());
-					m_pMethod = plugin.m_unpackFile.get();
-				}
+					m_pMethod = newMethod(plugin.m_unpackFile, attributes);
 				else if (localName == PackFileElement)
-				{
-					plugin.m_packFile.reset(new Method());
-					m_pMethod = plugin.m_packFile.get();
-				}
+					m_pMethod = newMethod(plugin.m_packFile, attributes);
 				else if (localName == IsFolderElement)
-				{
-					plugin.m_isFolder.reset(new Method());
-					m_pMethod = plugin.m_isFolder.get();
-				}
+					m_pMethod = newMethod(plugin.m_isFolder, attributes);
 				else if (localName == UnpackFolderElement)
-				{
-					plugin.m_unpackFolder.reset(new Method());
-					m_pMethod = plugin.m_unpackFolder.get();
-				}
+					m_pMethod = newMethod(plugin.m_unpackFolder, attributes);
 				else if (localName == PackFolderElement)
-				{
-					plugin.m_packFolder.reset(new Method());
-					m_pMethod = plugin.m_packFolder.get();
-				}
+					m_pMethod = newMethod(plugin.m_packFolder, attributes);
 			}
 			else if (m_pMethod)
 			{
@@ -223,6 +210,15 @@ private:
 		return ucr::toTString(std::string(ch, length));
 	}
 
+	static Method* newMethod(std::unique_ptr<Method>& method, const Attributes& attributes)
+	{
+		method.reset(new Method());
+		int index = attributes.getIndex(Empty, WorkersAttribute);
+		if (index >= 0)
+			method->m_workers = atoi(attributes.getValue(index).c_str());
+		return method.get();
+	}
+
 	std::list<Info>* m_pPlugins = nullptr;
 	std::stack<std::string> m_stack;
 	Method* m_pMethod = nullptr;
@@ -306,6 +302,7 @@ public:
 	InternalPlugin(Info&& info)
 		: WinMergePluginBase(info.m_event, info.m_description, info.m_fileFilters, info.m_unpackedFileExtension, info.m_extendedProperties, info.m_arguments, info.m_pipeline, info.m_isAutomatic)
 		, m_info(std::move(info))
+		, m_bConcurrent(HasWorkers(m_info))
 	{
 	}
 
@@ -313,6 +310,51 @@ public:
 	{
 	}
 
+	/**
+	 * @brief Whether a file method runs on worker processes.
+	 * Such a plugin is called from several threads at once, so it keeps the
+	 * arguments and variables of each thread apart.
+	 */
+	static bool HasWorkers(const Info& info)
+	{
+		for (const auto* method : { info.m_prediffFile.get(), info.m_unpackFile.get(), info.m_packFile.get() })
+		{
+			if (method && method->m_workers > 0)
+				return true;
+		}
+		return false;
+	}
+
+	HRESULT STDMETHODCALLTYPE get_PluginArguments(BSTR* pVal) override
+	{
+		*pVal = SysAllocString(getArguments().c_str());
+		return S_OK;
+	}
+
+	HRESULT STDMETHODCALLTYPE put_PluginArguments(BSTR val) override
+	{
+		if (!m_bConcurrent)
+			return WinMergePluginBase::put_PluginArguments(val);
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_threadValues[std::this_thread::get_id()].arguments = std::wstring{ val, SysStringLen(val) };
+		return S_OK;
+	}
+
+	HRESULT STDMETHODCALLTYPE get_PluginVariables(BSTR* pVal) override
+	{
+		*pVal = SysAllocString(getVariables().c_str());
+		return S_OK;
+	}
+
+	HRESULT STDMETHODCALLTYPE put_PluginVariables(BSTR val) override
+	{
+		if (!m_bConcurrent)
+			return WinMergePluginBase::put_PluginVariables(val);
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_threadValues[std::this_thread::get_id()].variables = std::wstring{ val, SysStringLen(val) };
+		return S_OK;
+	}
+
 	HRESULT STDMETHODCALLTYPE PrediffFile(BSTR fileSrc, BSTR fileDst, VARIANT_BOOL* pbChanged, VARIANT_BOOL* pbSuccess) override
 	{
 		if (!m_info.m_prediffFile)
@@ -321,15 +363,23 @@ public:
 			*pbSuccess = VARIANT_FALSE;
 			return S_OK;
 		}
-		TempFile scriptFile;
-		String command = replaceMacros(m_info.m_prediffFile->m_command, fileSrc, fileDst);
-		if (m_info.m_prediffFile->m_script)
+		HRESULT hr;
+		if (m_info.m_prediffFile->m_workers > 0)
 		{
-			createScript(*m_info.m_prediffFile->m_script, scriptFile);
-			strutils::replace(command, _T("${SCRIPT_FILE}"), scriptFile.GetPath());
+			hr = callWorker(*m_info.m_prediffFile, fileSrc, fileDst);
+		}
+		else
+		{
+			TempFile scriptFile;
+			String command = replaceMacros(m_info.m_prediffFile->m_command, fileSrc, fileDst);
+			if (m_info.m_prediffFile->m_script)
+			{
+				createScript(*m_info.m_prediffFile->m_script, scriptFile);
+				strutils::replace(command, _T("${SCRIPT_FILE}"), scriptFile.GetPath());
+			}
+			DWORD dwExitCode;
+			hr = launchProgram(command, SW_HIDE, dwExitCode);
 		}
-		DWORD dwExitCode;
-		HRESULT hr = launchProgram(command, SW_HIDE, dwExitCode);
 
 		*pbChanged = SUCCEEDED(hr);
 		*pbSuccess = SUCCEEDED(hr);
@@ -345,15 +395,23 @@ public:
 			*pbSuccess = VARIANT_FALSE;
 			return S_OK;
 		}
-		TempFile scriptFile;
-		String command = replaceMacros(m_info.m_unpackFile->m_command, fileSrc, fileDst);
-		if (m_info.m_unpackFile->m_script)
+		HRESULT hr;
+		if (m_info.m_unpackFile->m_workers > 0)
 		{
-			createScript(*m_info.m_unpackFile->m_script, scriptFile);
-			strutils::replace(command, _T("${SCRIPT_FILE}"), scriptFile.GetPath());
+			hr = callWorker(*m_info.m_unpackFile, fileSrc, fileDst);
+		}
+		else
+		{
+			TempFile scriptFile;
+			String command = replaceMacros(m_info.m_unpackFile->m_command, fileSrc, fileDst);
+			if (m_info.m_unpackFile->m_script)
+			{
+				createScript(*m_info.m_unpackFile->m_script, scriptFile);
+				strutils::replace(command, _T("${SCRIPT_FILE}"), scriptFile.GetPath());
+			}
+			DWORD dwExitCode;
+			hr = launchProgram(command, SW_HIDE, dwExitCode);
 		}
-		DWORD dwExitCode;
-		HRESULT hr = launchProgram(command, SW_HIDE, dwExitCode);
 
 		*pSubcode = 0;
 		*pbChanged = SUCCEEDED(hr);
@@ -369,15 +427,23 @@ public:
 			*pbSuccess = VARIANT_FALSE;
 			return S_OK;
 		}
-		TempFile scriptFile;
-		String command = replaceMacros(m_info.m_packFile->m_command, fileSrc, fileDst);
-		if (m_info.m_packFile->m_script)
+		HRESULT hr;
+		if (m_info.m_packFile->m_workers > 0)
 		{
-			createScript(*m_info.m_packFile->m_script, scriptFile);
-			strutils::replace(command, _T("${SCRIPT_FILE}"), scriptFile.GetPath());
+			hr = callWorker(*m_info.m_packFile, fileSrc, fileDst);
+		}
+		else
+		{
+			TempFile scriptFile;
+			String command = replaceMacros(m_info.m_packFile->m_command, fileSrc, fileDst);
+			if (m_info.m_packFile->m_script)
+			{
+				createScript(*m_info.m_packFile->m_script, scriptFile);
+				strutils::replace(command, _T("${SCRIPT_FILE}"), scriptFile.GetPath());
+			}
+			DWORD dwExitCode;
+			hr = launchProgram(command, SW_HIDE, dwExitCode);
 		}
-		DWORD dwExitCode;
-		HRESULT hr = launchProgram(command, SW_HIDE, dwExitCode);
 
 		*pbChanged = SUCCEEDED(hr);
 		*pbSuccess = SUCCEEDED(hr);
@@ -451,7 +517,7 @@ protected:
 		return result;
 	}
 
-	String replaceMacros(const String& cmd, const String & fileSrc, const String& fileDst)
+	String replaceMacros(const String& cmd, const String & fileSrc, const String& fileDst, bool bVariables = true)
 	{
 		String command = cmd;
 		if (paths::IsURL(fileSrc))
@@ -486,14 +552,14 @@ protected:
 				strutils::replace(command, _T("${DST_FOLDER}"), fileDst);
 			else if (name == _T("WINMERGE_HOME"))
 				strutils::replace(command, _T("${WINMERGE_HOME}"), env::GetProgPath());
-			else if (name.length() == 1 && tc::istdigit(name.front()))
+			else if (name.length() == 1 && tc::istdigit(name.front()) && bVariables)
 			{
-				std::vector<StringView> vars = strutils::split(m_sVariables, '\0');
+				std::vector<StringView> vars = strutils::split(getVariables(), '\0');
 				for (size_t i = 0; i < vars.size(); ++i)
 					strutils::replace(command, strutils::format(_T("${%d}"), i), strutils::to_str(vars[i]));
 			}
 			else if (name == _T("*"))
-				strutils::replace(command, _T("${*}"), m_sArguments);
+				strutils::replace(command, _T("${*}"), getArguments());
 			else if (name.find(_T("CFG:")) == 0)
 			{
 				std::vector<StringView> ary = strutils::split(name, ':');
@@ -532,10 +598,7 @@ protected:
 	{
 		TempFile stderrFile;
 		String sOutputFile = stderrFile.Create();
-		size_t size = 0;
-		_wgetenv_s(&size, nullptr, 0, L"WINMERGE_HOME");
-		if (size == 0)
-			_wputenv_s(L"WINMERGE_HOME", env::GetProgPath().c_str());
+		setWinMergeHomeEnv();
 		String command = sCmd;
 		STARTUPINFO stInfo = { sizeof(STARTUPINFO) };
 		stInfo.dwFlags = STARTF_USESHOWWINDOW;
@@ -567,23 +630,129 @@ protected:
 		{
 			String error;
 			ReadFile(sOutputFile, error);
-			ICreateErrorInfo* pCreateErrorInfo = nullptr;
-			if (SUCCEEDED(CreateErrorInfo(&pCreateErrorInfo)))
+			return setErrorInfo(command, error);
+		}
+		return S_OK;
+	}
+
+	static void setWinMergeHomeEnv()
+	{
+		size_t size = 0;
+		_wgetenv_s(&size, nullptr, 0, L"WINMERGE_HOME");
+		if (size == 0)
+			_wputenv_s(L"WINMERGE_HOME", env::GetProgPath().c_str());
+	}
+
+	static HRESULT setErrorInfo(const String& source, const String& description)
+	{
+		ICreateErrorInfo* pCreateErrorInfo = nullptr;
+		if (FAILED(CreateErrorInfo(&pCreateErrorInfo)))
+			return E_FAIL;
+		pCreateErrorInfo->SetSource(const_cast<OLECHAR*>(source.c_str()));
+		pCreateErrorInfo->SetDescription(const_cast<OLECHAR*>(ucr::toUTF16(description).c_str()));
+		IErrorInfo* pErrorInfo = nullptr;
+		pCreateErrorInfo->QueryInterface(&pErrorInfo);
+		SetErrorInfo(0, pErrorInfo);
+		pErrorInfo->Release();
+		pCreateErrorInfo->Release();
+		return DISP_E_EXCEPTION;
+	}
+
+	/**
+	 * @brief Run @p method on a worker: send the content of @p fileSrc,
+	 * write the result to @p fileDst.
+	 * The workers of a method are kept per command line, as the arguments
+	 * and options in it may differ between calls. ${SRC_FILE}, ${DST_FILE}
+	 * and the variables are empty in the command line of a worker, the
+	 * content of the file is sent over its stdin.
+	 */
+	HRESULT callWorker(const Method& method, const String& fileSrc, const String& fileDst)
+	{
+		const String command = replaceMacros(method.m_command, _T(""), _T(""), false);
+		PluginWorkerPool* pool = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto& workers = m_workerPools[{ &method, command }];
+			if (!workers.pool)
 			{
-				pCreateErrorInfo->SetSource(const_cast<OLECHAR*>(command.c_str()));
-				pCreateErrorInfo->SetDescription(const_cast<OLECHAR*>(ucr::toUTF16(error).c_str()));
-				IErrorInfo* pErrorInfo = nullptr;
-				pCreateErrorInfo->QueryInterface(&pErrorInfo);
-				SetErrorInfo(0, pErrorInfo);
-				pErrorInfo->Release();
-				pCreateErrorInfo->Release();
-				return DISP_E_EXCEPTION;
+				String commandLine = command;
+				if (method.m_script)
+				{
+					createScript(*method.m_script, workers.scriptFile);
+					strutils::replace(commandLine, _T("${SCRIPT_FILE}"), workers.scriptFile.GetPath());
+				}
+				setWinMergeHomeEnv();
+				workers.pool.reset(new PluginWorkerPool(commandLine, method.m_workers));
 			}
+			pool = workers.pool.get();
+		}
+
+		std::string request, response;
+		try
+		{
+			Poco::FileInputStream in(ucr::toUTF8(fileSrc), std::ios::in | std::ios::binary);
+			request.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		}
+		catch (Exception& e)
+		{
+			return setErrorInfo(command, ucr::toTString(e.displayText()));
+		}
+		String errmsg;
+		if (!pool->Call(request, response, errmsg))
+			return setErrorInfo(command, errmsg);
+		try
+		{
+			Poco::FileOutputStream out(ucr::toUTF8(fileDst), std::ios::out | std::ios::binary | std::ios::trunc);
+			out.write(response.data(), response.size());
+		}
+		catch (Exception& e)
+		{
+			return setErrorInfo(command, ucr::toTString(e.displayText()));
 		}
 		return S_OK;
 	}
 
+	std::wstring getArguments()
+	{
+		if (m_bConcurrent)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto it = m_threadValues.find(std::this_thread::get_id());
+			if (it != m_threadValues.end() && it->second.arguments.has_value())
+				return *it->second.arguments;
+		}
+		return m_sArguments;
+	}
+
+	std::wstring getVariables()
+	{
+		if (m_bConcurrent)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto it = m_threadValues.find(std::this_thread::get_id());
+			if (it != m_threadValues.end() && it->second.variables.has_value())
+				return *it->second.variables;
+		}
+		return m_sVariables;
+	}
+
+	struct ThreadValues
+	{
+		std::optional<std::wstring> arguments;
+		std::optional<std::wstring> variables;
+	};
+
+	struct WorkerPoolEntry
+	{
+		TempFile scriptFile;
+		std::unique_ptr<PluginWorkerPool> pool; /**< Stopped before the script is deleted */
+	};
+
 	Info m_info;
+	bool m_bConcurrent;
+	std::mutex m_mutex;
+	std::map<std::thread::id, ThreadValues> m_threadValues;
+	std::map<std::pair<const Method*, String>, WorkerPoolEntry> m_workerPools;
 };
 
 class EditorScriptGeneratedFromUnpacker: public WinMergePluginBase
@@ -858,7 +1027,10 @@ static void writeEmptyElement(XMLWriter& writer, const std::string& tagname, con
 
 static void writeMethodElement(XMLWriter& writer, const std::string& tagname, const Method& method)
 {
-	writer.startElement("", "", tagname);
+	AttributesImpl methodAttrs;
+	if (method.m_workers > 0)
+		methodAttrs.addAttribute("", "", WorkersAttribute, "", std::to_string(method.m_workers));
+	writer.startElement("", "", tagname, methodAttrs);
 	if (!method.m_command.empty())
 	{
 		writer.startElement("", "", CommandElement);
@@ -984,6 +1156,7 @@ struct Loader
 			if (plugins.find(event) == plugins.end())
 				plugins[event].reset(new PluginArray);
 			PluginInfoPtr pluginNew(new PluginInfo());
+			pluginNew->m_bConcurrent = InternalPlugin::HasWorkers(info);
 			IDispatch* pDispatch = new InternalPlugin(std::move(info));
 			pDispatch->AddRef();
 			if (pluginNew->MakeInfo(GetPluginXMLPath(info.m_locationType), name, pDispatch) > 0)
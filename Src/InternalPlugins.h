@@ -28,10 +28,13 @@ struct Method
 	Method(const Method& method)
 		: m_command(method.m_command)
 		, m_script(method.m_script ? new Script(*method.m_script) : nullptr)
+		, m_workers(method.m_workers)
 	{
 	}
 	String m_command;
 	std::unique_ptr<Script> m_script;
+	/** If > 0, the command runs on this many PluginWorkerPool workers */
+	int m_workers = 0;
 };
 
 struct Info
@@ -198,5 +198,7 @@ std::shared_ptr<FilterList> LineFiltersList::MakeFilterList(bool throwIfInvalid)
 		}
 		i++;
 	}
+	// Compiled here, the compare threads share the list
+	plist->Compile();
 	return plist;
 }
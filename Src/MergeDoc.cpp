@@ -304,6 +304,32 @@ static int SaveBuffForDiff(CDiffTextBuffer & buf, const String& filepath, int nS
 		CRLFSTYLE::AUTOMATIC, false, nStartLine, nLines);
 }
 
+/**
+ * @brief Identical result of a compare from its diff list.
+ */
+static IDENTLEVEL GetIdenticalLevel(const DiffList& diffList, int nFiles)
+{
+	if (nFiles < 3)
+		return diffList.GetSize() == 0 ? IDENTLEVEL::ALL : IDENTLEVEL::NONE;
+	IDENTLEVEL identical = IDENTLEVEL::ALL;
+	for (int nDiff = 0; nDiff < diffList.GetSize(); ++nDiff)
+	{
+		IDENTLEVEL diffIdentical;
+		switch (diffList.DiffRangeAt(nDiff)->op)
+		{
+		case OP_TRIVIAL: continue;
+		case OP_1STONLY: diffIdentical = IDENTLEVEL::EXCEPTLEFT; break;
+		case OP_2NDONLY: diffIdentical = IDENTLEVEL::EXCEPTMIDDLE; break;
+		case OP_3RDONLY: diffIdentical = IDENTLEVEL::EXCEPTRIGHT; break;
+		default: return IDENTLEVEL::NONE;
+		}
+		if (identical != IDENTLEVEL::ALL && identical != diffIdentical)
+			return IDENTLEVEL::NONE;
+		identical = diffIdentical;
+	}
+	return identical;
+}
+
 /**
  * @brief Save files to temp files & compare again.
  *
@@ -412,7 +438,35 @@ int CMergeDoc::Rescan(bool &bBinary, IDENTLEVEL &identical,
 
 	DIFFSTATUS status;
 
-	if (!HasSyncPoints())
+	// After edits compare only the lines around them if the lines and diffs
+	// of the previous rescan are known
+	const bool bIncremental = IsIncrementalRescanEnabled();
+	std::vector<uint64_t> lineHashes[3];
+	IncrementalRescan::Result incrementalResult = IncrementalRescan::Result::FullRescan;
+	if (bIncremental)
+	{
+		for (nBuffer = 0; nBuffer < m_nBuffers; nBuffer++)
+			GetLineHashes(nBuffer, lineHashes[nBuffer]);
+		if (!bForced && !bBinary &&
+			std::count(m_rescanStatus.bMissingNL, m_rescanStatus.bMissingNL + m_nBuffers, m_rescanStatus.bMissingNL[0]) == m_nBuffers)
+		{
+			status = m_rescanStatus;
+			incrementalResult = m_incrementalRescan.Update(lineHashes,
+				[&](const IncrementalRescan::Window& window, DiffList& windowDiffList)
+				{
+					return RescanWindow(window, windowDiffList, status);
+				}, m_diffList);
+			if (incrementalResult != IncrementalRescan::Result::FullRescan)
+			{
+				status.Identical = GetIdenticalLevel(m_diffList, m_nBuffers);
+				diffSuccess = true;
+			}
+			else
+				status = DIFFSTATUS();
+		}
+	}
+
+	if (!HasSyncPoints() && incrementalResult == IncrementalRescan::Result::FullRescan)
 	{
 		// Save text buffer to file
 		for (nBuffer = 0; nBuffer < m_nBuffers; nBuffer++)
@@ -429,7 +483,7 @@ int CMergeDoc::Rescan(bool &bBinary, IDENTLEVEL &identical,
 		if (bBinary) // believe caller if we were told these are binaries
 			status.bBinaries = true;
 	}
-	else
+	else if (HasSyncPoints())
 	{
 		const std::vector<std::vector<int> > syncpoints = GetSyncPointList();	
 		int nStartLine[3]{};
@@ -496,7 +550,8 @@ int CMergeDoc::Rescan(bool &bBinary, IDENTLEVEL &identical,
 	}
 
 	// If one file has EOL before EOF and other not...
-	if (std::count(status.bMissingNL, status.bMissingNL + m_nBuffers, status.bMissingNL[0]) < m_nBuffers)
+	if (incrementalResult == IncrementalRescan::Result::FullRescan &&
+		std::count(status.bMissingNL, status.bMissingNL + m_nBuffers, status.bMissingNL[0]) < m_nBuffers)
 	{
 		// ..last DIFFRANGE of file which has EOL must be
 		// fixed to contain last line too
@@ -506,6 +561,17 @@ int CMergeDoc::Rescan(bool &bBinary, IDENTLEVEL &identical,
 		m_diffWrapper.FixLastDiffRange(m_nBuffers, lineCount, status.bMissingNL, diffOptions.bIgnoreBlankLines);
 	}
 
+	// Keep the lines and the diffs, before ghost lines are added, for
+	// rescanning the next edits
+	if (bIncremental && diffSuccess && !status.bBinaries)
+	{
+		if (incrementalResult == IncrementalRescan::Result::FullRescan)
+			m_incrementalRescan.Store(m_nBuffers, lineHashes, m_diffList);
+		m_rescanStatus = status;
+	}
+	else
+		m_incrementalRescan.Reset();
+
 	// set identical/diff result as recorded by diffutils
 	identical = status.Identical;
 
@@ -587,6 +653,100 @@ int CMergeDoc::Rescan(bool &bBinary, IDENTLEVEL &identical,
 	return nResult;
 }
 
+/**
+ * @brief Check if edits can be rescanned by comparing only the lines around them.
+ * Sync points, moved block detection, prediffers and the filters working
+ * on more than one line need the files as a whole.
+ */
+bool CMergeDoc::IsIncrementalRescanEnabled()
+{
+	if (HasSyncPoints() || m_diffWrapper.GetDetectMovedBlocks() || m_diffWrapper.GetSubstitutionList() != nullptr)
+		return false;
+
+	DIFFOPTIONS diffOptions = {0};
+	m_diffWrapper.GetOptions(&diffOptions);
+	if (diffOptions.bFilterCommentsLines || diffOptions.bIgnoreLineBreaks)
+		return false;
+
+	PrediffingInfo infoPrediffer;
+	GetPrediffer(&infoPrediffer);
+	return infoPrediffer.GetPluginPipeline().empty();
+}
+
+/**
+ * @brief Hash each real line of a buffer, to find the lines edited since last rescan.
+ */
+void CMergeDoc::GetLineHashes(int nBuffer, std::vector<uint64_t>& lineHashes) const
+{
+	const CDiffTextBuffer& buf = *m_ptBuf[nBuffer];
+	const int nLineCount = buf.GetLineCount();
+	lineHashes.clear();
+	lineHashes.reserve(nLineCount);
+	for (int nLine = 0; nLine < nLineCount; ++nLine)
+	{
+		if ((buf.GetLineFlags(nLine) & LF_GHOST) == 0)
+			lineHashes.push_back(IncrementalRescan::HashLine(buf.GetLineChars(nLine), buf.GetFullLineLength(nLine) * sizeof(tchar_t)));
+	}
+}
+
+/**
+ * @brief Save a window of lines of the buffers to the temp files & compare them.
+ * @param [in] window Real lines to compare.
+ * @param [out] windowDiffList Diffs in line numbers relative to the window begin.
+ * @param [in,out] status Diff status, updated when the window reaches the end of the files.
+ * @return false if the compare failed or found binary files.
+ */
+bool CMergeDoc::RescanWindow(const IncrementalRescan::Window& window, DiffList& windowDiffList, DIFFSTATUS& status)
+{
+	const String tempPath = env::GetTemporaryPath();
+	int nLines[3]{};
+	for (int nBuffer = 0; nBuffer < m_nBuffers; nBuffer++)
+	{
+		CDiffTextBuffer& buf = *m_ptBuf[nBuffer];
+		const int nStartLine = buf.ComputeApparentLine(window.begin[nBuffer]);
+		nLines[nBuffer] = window.end[nBuffer] - window.begin[nBuffer];
+		buf.SetTempPath(tempPath);
+		if (SaveBuffForDiff(buf, m_tempFiles[nBuffer].GetPath(), nStartLine,
+			window.bEndOfFile ? -1 : buf.ComputeApparentLine(window.end[nBuffer]) - nStartLine) != SAVE_DONE)
+			return false;
+	}
+
+	DIFFSTATUS windowStatus;
+	m_diffWrapper.SetCreateDiffList(&windowDiffList);
+	bool bSuccess = m_diffWrapper.RunFileDiff();
+	m_diffWrapper.GetDiffStatus(&windowStatus);
+	if (bSuccess && !windowStatus.bBinaries)
+	{
+		// Correct the comparison results made by diffutils if the window is empty at the begin of a file.
+		DIFFRANGE di;
+		for (int nBuffer = 0; nBuffer < m_nBuffers; nBuffer++)
+		{
+			if (window.begin[nBuffer] == 0 && nLines[nBuffer] == 0 && windowDiffList.GetDiff(0, di) &&
+				di.begin[nBuffer] == 0 && di.end[nBuffer] == 0)
+			{
+				di.end[nBuffer] = -1;
+				windowDiffList.SetDiff(0, di);
+			}
+		}
+
+		// Only the window at the end of the files knows about the EOL before EOF
+		if (window.bEndOfFile)
+		{
+			std::copy_n(windowStatus.bMissingNL, 3, status.bMissingNL);
+			if (std::count(status.bMissingNL, status.bMissingNL + m_nBuffers, status.bMissingNL[0]) < m_nBuffers)
+			{
+				DIFFOPTIONS diffOptions = {0};
+				m_diffWrapper.GetOptions(&diffOptions);
+				m_diffWrapper.FixLastDiffRange(m_nBuffers, nLines, status.bMissingNL, diffOptions.bIgnoreBlankLines);
+			}
+		}
+	}
+	else
+		bSuccess = false;
+	m_diffWrapper.SetCreateDiffList(&m_diffList);
+	return bSuccess;
+}
+
 void CMergeDoc::CheckFileChanged(void)
 {
 	for (int nBuffer = 0; nBuffer < m_nBuffers; nBuffer++)
@@ -2430,6 +2590,8 @@ bool CMergeDoc::OpenDocs(int nFiles, const FileLocation ifileloc[],
 		m_diffWrapper.SetTextForAutomaticPrediff(m_strBothFilenames);
 	}
 
+	// The buffers were loaded again, compare them as a whole
+	m_incrementalRescan.Reset();
 	bool bBinary = false;
 	nRescanResult = Rescan(bBinary, identical);
 
@@ -2782,6 +2944,7 @@ void CMergeDoc::SwapFiles(int nFromIndex, int nToIndex)
 			swap(m_pView[nGroup][nFromIndex]->m_piMergeEditStatus, m_pView[nGroup][nToIndex]->m_piMergeEditStatus);
 
 		ClearWordDiffCache();
+		m_incrementalRescan.Reset();
 
 		for (int nBuffer = 0; nBuffer < m_nBuffers; nBuffer++)
 		{
@@ -15,6 +15,8 @@
 #include "DiffTextBuffer.h"
 #include "DiffWrapper.h"
 #include "DiffList.h"
+#include "IncrementalRescan.h"
+#include "WordDiffCache.h"
 #include "TempFile.h"
 #include "PathContext.h"
 #include "FileLoadResult.h"
@@ -77,28 +79,6 @@ enum class BUFFERTYPE
 	UNNAMED_SAVED, /**< Empty buffer saved with filename */
 };
 
-struct WordDiff {
-	std::array<int, 3> begin; // 0-based, eg, begin[0] is from str1
-	std::array<int, 3> end; // 0-based, eg, end[1] is from str2
-	std::array<int, 3> beginline;
-	std::array<int, 3> endline;
-	int op;
-
-	WordDiff(int s1=0, int e1=0, int bl1=0, int el1=0, int s2=0, int e2=0, int bl2=0, int el2=0, int s3=0, int e3=0, int bl3=0, int el3=0, int op=0)
-		: begin{s1, s2, s3}
-		, beginline{bl1, bl2, bl3}
-		, endline{el1, el2, el3}
-		, op(op)
-	{
-		if (s1>e1) e1=s1;
-		if (s2>e2) e2=s2;
-		if (s3>e3) e3=s3;
-		end[0] = e1;
-		end[1] = e2;
-		end[2] = e3;
-	}
-};
-
 struct CurrentWordDiff
 {
 	int nDiff;
@@ -293,9 +273,12 @@ public:
 	std::vector<WordDiff> GetWordDiffArray(int nLineIndex, bool ignoreDiffOptions = false);
 	std::vector<WordDiff> GetWordDiffArrayInRange(const int begin[3], const int end[3], bool ignoreDiffOptions = false, int pane1 = -1, int pane2 = -1);
 	void ClearWordDiffCache(int nDiff = -1);
+	void PrefetchWordDiffs(int nTopLine, int nScreenLines);
 private:
 	void Computelinediff(CMergeEditView *pView, std::pair<CEPoint, CEPoint> rc[], bool bReversed);
-	std::map<int, std::vector<WordDiff> > m_cacheWordDiffs;
+	bool GetWordDiffSource(const int begin[3], const int end[3], const std::vector<int>& panes, WordDiffSource& source) const;
+	WordDiffOptions GetWordDiffOptions(bool ignoreDiffOptions) const;
+	WordDiffCache m_wordDiffCache;
 // End MergeDocLineDiffs.cpp
 
 // Implementation in MergeDocEncoding.cpp
@@ -374,6 +357,8 @@ protected:
 	bool m_bEnableRescan; /**< Automatic rescan enabled/disabled */
 	COleDateTime m_LastRescan; /**< Time of last rescan (for delaying) */ 
 	CDiffWrapper m_diffWrapper;
+	IncrementalRescan m_incrementalRescan; /**< Lines and diffs of last rescan, for rescanning edits only */
+	DIFFSTATUS m_rescanStatus; /**< Diff status of last rescan */
 	/// information about the file packer/unpacker
 	PackingInfo m_infoUnpacker;
 	String m_strDesc[3]; /**< Left/Middle/Right side description text */
@@ -471,6 +456,9 @@ private:
 		const DIFFRANGE& diffrange, const DIFFOPTIONS& diffOptions);
 	void FlagTrivialLines();
 	void FlagMovedLines();
+	bool IsIncrementalRescanEnabled();
+	void GetLineHashes(int nBuffer, std::vector<uint64_t>& lineHashes) const;
+	bool RescanWindow(const IncrementalRescan::Window& window, DiffList& windowDiffList, DIFFSTATUS& status);
 	String GetFileExt(const tchar_t* sFileName, const tchar_t* sDescription) const;
 	void DoFileSave(int pane);
 	void SetPredifferByMenu(UINT nID);
@@ -300,16 +300,55 @@ void CMergeDoc::Computelinediff(CMergeEditView *pView, std::pair<CEPoint, CEPoin
 
 void CMergeDoc::ClearWordDiffCache(int nDiff/* = -1 */)
 {
-	if (nDiff == -1)
-	{
-		m_cacheWordDiffs.clear();
-	}
-	else
+	m_wordDiffCache.Clear(nDiff);
+}
+
+/**
+ * @brief Queue the word diffs of the diff blocks around the view for the worker threads.
+ * The blocks on screen are queued first, then the blocks of the next two
+ * screens and of the previous screen. Blocks queued for an earlier view
+ * position and now out of that range are dropped from the queue.
+ * @param [in] nTopLine First line in the view.
+ * @param [in] nScreenLines Number of lines the view shows.
+ */
+void CMergeDoc::PrefetchWordDiffs(int nTopLine, int nScreenLines)
+{
+	const int nDiffCount = m_diffList.GetSize();
+	const int nFirstLine = std::max(0, nTopLine - nScreenLines);
+	const int nLastLine = nTopLine + 3 * nScreenLines;
+	int nFirstDiff = -1;
+	m_diffList.GetNextDiff(nFirstLine, nFirstDiff);
+	if (nFirstDiff == -1)
+		return;
+	int nLastDiff = nFirstDiff;
+	while (nLastDiff + 1 < nDiffCount && m_diffList.DiffRangeAt(nLastDiff + 1)->dbegin <= nLastLine)
+		++nLastDiff;
+	int nFirstVisibleDiff = nFirstDiff;
+	while (nFirstVisibleDiff < nLastDiff && m_diffList.DiffRangeAt(nFirstVisibleDiff)->dend < nTopLine)
+		++nFirstVisibleDiff;
+
+	m_wordDiffCache.CancelQueued(nFirstDiff, nLastDiff);
+
+	const WordDiffOptions options = GetWordDiffOptions(false);
+	const std::vector<int> panes = (m_nBuffers == 2) ? std::vector<int>{0, 1} : std::vector<int>{ 0, 1, 2 };
+	auto prefetch = [&](int nDiff)
 	{
-		std::map<int, std::vector<WordDiff> >::iterator it = m_cacheWordDiffs.find(nDiff);
-		if (it != m_cacheWordDiffs.end())
-			m_cacheWordDiffs.erase(it);
-	}
+		if (m_wordDiffCache.Contains(nDiff))
+			return;
+		const DIFFRANGE *dr = m_diffList.DiffRangeAt(nDiff);
+		// Only blocks compared as a whole are cached, see GetWordDiffArray()
+		if (IsDiffPerLine(m_ptBuf[0]->GetTableEditing(), *dr))
+			return;
+		const int begin[3] = { dr->dbegin, dr->dbegin, dr->dbegin };
+		const int end[3] = { dr->dend, dr->dend, dr->dend };
+		WordDiffSource source;
+		if (GetWordDiffSource(begin, end, panes, source))
+			m_wordDiffCache.Prefetch(nDiff, std::move(source), options);
+	};
+	for (int nDiff = nFirstVisibleDiff; nDiff <= nLastDiff; ++nDiff)
+		prefetch(nDiff);
+	for (int nDiff = nFirstVisibleDiff - 1; nDiff >= nFirstDiff; --nDiff)
+		prefetch(nDiff);
 }
 
 std::vector<WordDiff> CMergeDoc::GetWordDiffArrayInDiffBlock(int nDiff, bool ignoreDiffOptions/*=false*/)
@@ -330,111 +369,76 @@ std::vector<WordDiff> CMergeDoc::GetWordDiffArrayInDiffBlock(int nDiff, bool ign
 	return worddiffs;
 }
 
-std::vector<WordDiff>
-CMergeDoc::GetWordDiffArrayInRange(const int begin[3], const int end[3], bool ignoreDiffOptions/*=false*/, int pane1/*=-1*/, int pane2/*=-1*/)
+/**
+ * @brief Copy the lines of a range to compute their word diffs from.
+ * @param [in] begin First line of the range, by pane.
+ * @param [in] end Last line of the range, by pane.
+ * @param [in] panes Panes to compare.
+ * @param [out] source Text and line offsets of the range.
+ * @return false if the range is beyond the end of a buffer.
+ */
+bool CMergeDoc::GetWordDiffSource(const int begin[3], const int end[3], const std::vector<int>& panes, WordDiffSource& source) const
 {
-	DIFFOPTIONS diffOptions = {0};
-	m_diffWrapper.GetOptions(&diffOptions);
-	String str[3];
-	std::unique_ptr<int[]> nOffsets[3];
-	std::vector<WordDiff> worddiffs;
-	std::vector<int> panes;
-	if (pane1 == -1 && pane2 == -1)
-		panes = (m_nBuffers == 2) ? std::vector<int>{0, 1} : std::vector<int>{ 0, 1, 2 };
-	else
-		panes = std::vector<int>{ pane1, pane2 };
+	source.nStrings = static_cast<int>(panes.size());
 	for (size_t i = 0; i < panes.size(); ++i)
 	{
 		int file = panes[i];
 		int nLineBegin = begin[file];
 		int nLineEnd = end[file];
-		if (nLineEnd >= m_ptBuf[file]->GetLineCount())
-			return worddiffs;
-		nOffsets[file].reset(new int[nLineEnd - nLineBegin + 1]);
+		const int nLineCount = m_ptBuf[file]->GetLineCount();
+		if (nLineEnd >= nLineCount)
+			return false;
+		source.begin[i] = nLineBegin;
+		source.end[i] = nLineEnd;
+		source.lineCount[i] = nLineCount;
+		std::vector<int>& offsets = source.offsets[i];
+		std::vector<int>& lineLengths = source.lineLengths[i];
+		offsets.assign(1, 0);
+		lineLengths.clear();
 		String strText;
 		if (nLineBegin <= nLineEnd)
 		{
 			if (nLineBegin != nLineEnd || m_ptBuf[file]->GetLineLength(nLineEnd) > 0)
 				m_ptBuf[file]->GetTextWithoutEmptys(nLineBegin, 0, nLineEnd, m_ptBuf[file]->GetLineLength(nLineEnd), strText);
 			strText += m_ptBuf[file]->GetLineEol(nLineEnd);
-			nOffsets[file][0] = 0;
 		}
-		str[i] = std::move(strText);
+		source.str[i] = std::move(strText);
 		for (int nLine = nLineBegin; nLine < nLineEnd; nLine++)
-			nOffsets[file][nLine-nLineBegin+1] = nOffsets[file][nLine-nLineBegin] + m_ptBuf[file]->GetFullLineLength(nLine);
+			offsets.push_back(offsets.back() + m_ptBuf[file]->GetFullLineLength(nLine));
+		for (int nLine = nLineBegin; nLine <= std::max(nLineBegin, nLineEnd) && nLine < nLineCount; nLine++)
+			lineLengths.push_back(m_ptBuf[file]->GetLineLength(nLine));
 	}
+	return true;
+}
 
-	// Options that affect comparison
-	bool casitive = ignoreDiffOptions ? false : !diffOptions.bIgnoreCase;
-	strdiff::EolCompareMode eolMode = diffOptions.bIgnoreLineBreaks ? strdiff::EOL_AS_SPACE :
+/** @brief Options that affect comparison */
+WordDiffOptions CMergeDoc::GetWordDiffOptions(bool ignoreDiffOptions) const
+{
+	DIFFOPTIONS diffOptions = {0};
+	m_diffWrapper.GetOptions(&diffOptions);
+	WordDiffOptions options;
+	options.casitive = ignoreDiffOptions ? false : !diffOptions.bIgnoreCase;
+	options.eolMode = diffOptions.bIgnoreLineBreaks ? strdiff::EOL_AS_SPACE :
 		diffOptions.bIgnoreEol ? strdiff::EOL_IGNORE : strdiff::EOL_STRICT;
-	bool eolSensitive = ignoreDiffOptions ? true : !diffOptions.bIgnoreEol;
-	int xwhite = ignoreDiffOptions ? 0 : diffOptions.nIgnoreWhitespace;
-	int breakType = GetBreakType(); // whitespace only or include punctuation
-	bool byteColoring = GetByteColoringOption();
-
-	// Make the call to stringdiffs, which does all the hard & tedious computations
-	std::vector<strdiff::wdiff> wdiffs =
-		strdiff::ComputeWordDiffs(static_cast<int>(panes.size()), str, casitive, eolMode, xwhite, diffOptions.bIgnoreNumbers, breakType, byteColoring);
-
-	std::vector<strdiff::wdiff>::iterator it;
-	for (it = wdiffs.begin(); it != wdiffs.end(); ++it)
-	{
-		WordDiff wd;
-		for (size_t i = 0; i < panes.size(); ++i)
-		{
-			int file = panes[i];
-			int nLineBegin = begin[file];
-			int nLineEnd = end[file];
-			int nLine;
-			for (nLine = nLineBegin; nLine < nLineEnd; nLine++)
-			{
-				if (it->begin[i] == nOffsets[file][nLine-nLineBegin] || it->begin[i] < nOffsets[file][nLine-nLineBegin+1])
-					break;
-			}
-			wd.beginline[i] = nLine;
-			wd.begin[i] = it->begin[i] - nOffsets[file][nLine-nLineBegin];
-			const int nLineCount = m_ptBuf[file]->GetLineCount();
-			const int nLineLength1 = nLine < nLineCount ? m_ptBuf[file]->GetLineLength(nLine) : 0;
-			if (nLineLength1 < wd.begin[i])
-			{
-				if (wd.beginline[i] < nLineCount - 1)
-				{
-					wd.begin[i] = 0;
-					wd.beginline[i]++;
-				}
-				else
-				{
-					wd.begin[i] = nLineLength1;
-				}
-			}
-
-			for (; nLine < nLineEnd; nLine++)
-			{
-				if (it->end[i] + 1 == nOffsets[file][nLine-nLineBegin] || it->end[i] + 1 < nOffsets[file][nLine-nLineBegin+1])
-					break;
-			}
-			wd.endline[i] = nLine;
-			wd.end[i] = it->end[i]  + 1 - nOffsets[file][nLine-nLineBegin];
-			const int nLineLength2 = nLine < nLineCount ? m_ptBuf[file]->GetLineLength(nLine) : 0;
-			if (nLineLength2 < wd.end[i])
-			{
-				if (wd.endline[i] < nLineCount - 1)
-				{
-					wd.end[i] = 0;
-					wd.endline[i]++;
-				}
-				else
-				{
-					wd.end[i] = nLineLength2;
-				}
-			}
-		}
-		wd.op = it->op;
+	options.xwhite = ignoreDiffOptions ? 0 : diffOptions.nIgnoreWhitespace;
+	options.ignoreNumbers = diffOptions.bIgnoreNumbers;
+	options.breakType = GetBreakType(); // whitespace only or include punctuation
+	options.byteColoring = GetByteColoringOption();
+	return options;
+}
 
-		worddiffs.push_back(wd);
-	}
-	return worddiffs;
+std::vector<WordDiff>
+CMergeDoc::GetWordDiffArrayInRange(const int begin[3], const int end[3], bool ignoreDiffOptions/*=false*/, int pane1/*=-1*/, int pane2/*=-1*/)
+{
+	std::vector<int> panes;
+	if (pane1 == -1 && pane2 == -1)
+		panes = (m_nBuffers == 2) ? std::vector<int>{0, 1} : std::vector<int>{ 0, 1, 2 };
+	else
+		panes = std::vector<int>{ pane1, pane2 };
+	WordDiffSource source;
+	if (!GetWordDiffSource(begin, end, panes, source))
+		return std::vector<WordDiff>();
+	return WordDiffCache::Compute(source, GetWordDiffOptions(ignoreDiffOptions));
 }
 
 /**
@@ -457,16 +461,8 @@ std::vector<WordDiff> CMergeDoc::GetWordDiffArray(int nLineIndex, bool ignoreDif
 	int nDiff = m_diffList.LineToDiff(nLineIndex);
 	if (nDiff == -1)
 		return worddiffs;
-	if (!ignoreDiffOptions)
-	{
-		std::map<int, std::vector<WordDiff> >::iterator itmap = m_cacheWordDiffs.find(nDiff);
-		if (itmap != m_cacheWordDiffs.end())
-		{
-			worddiffs.resize((*itmap).second.size());
-			std::copy((*itmap).second.begin(), (*itmap).second.end(), worddiffs.begin());
-			return worddiffs;
-		}
-	}
+	if (!ignoreDiffOptions && m_wordDiffCache.Lookup(nDiff, worddiffs))
+		return worddiffs;
 
 	m_diffList.GetDiff(nDiff, cd);
 
@@ -492,10 +488,7 @@ std::vector<WordDiff> CMergeDoc::GetWordDiffArray(int nLineIndex, bool ignoreDif
 	worddiffs = GetWordDiffArrayInRange(nLineBegin, nLineEnd, ignoreDiffOptions);
 
 	if (!diffPerLine && !ignoreDiffOptions)
-	{
-		m_cacheWordDiffs[nDiff].resize(worddiffs.size());
-		std::copy(worddiffs.begin(), worddiffs.end(), m_cacheWordDiffs[nDiff].begin());
-	}
+		m_wordDiffCache.Store(nDiff, worddiffs);
 
 	return worddiffs;
 }
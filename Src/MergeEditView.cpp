@@ -627,6 +627,19 @@ void CMergeEditView::OnActivateView(BOOL bActivate, CView* pActivateView, CView*
 	pDoc->UpdateHeaderActivity(m_nThisPane, !!bActivate);
 }
 
+/**
+ * @brief Draw the view, after queuing the word diffs of the lines around it.
+ * The word diffs of the blocks on screen are computed on the worker threads
+ * while the lines are drawn, GetAdditionalTextBlocks() takes them from the
+ * cache.
+ */
+void CMergeEditView::OnDraw(CDC* pDC)
+{
+	if (!m_bDetailView && !pDC->IsPrinting() && GetOptionsMgr()->GetBool(OPT_WORDDIFF_HIGHLIGHT))
+		GetDocument()->PrefetchWordDiffs(m_nTopLine, GetScreenLines());
+	CCrystalEditViewEx::OnDraw(pDC);
+}
+
 std::vector<CrystalLineParser::TEXTBLOCK> CMergeEditView::GetMarkerTextBlocks(int nLineIndex) const
 {
 	if (m_bDetailView)
@@ -169,6 +169,7 @@ public:
 	protected:
 	virtual void OnActivateView(BOOL bActivate, CView* pActivateView, CView* pDeactiveView);
 	virtual void OnUpdate(CView* pSender, LPARAM lHint, CObject* pHint);
+	virtual void OnDraw(CDC* pDC) override;
 	virtual BOOL PreTranslateMessage(MSG* pMsg) override;
 	virtual void OnBeginPrinting (CDC * pDC, CPrintInfo * pInfo) override;
 	virtual void OnEndPrinting (CDC * pDC, CPrintInfo * pInfo) override;
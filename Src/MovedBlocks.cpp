@@ -6,89 +6,124 @@
  */
 
 #include "pch.h"
-#include <map>
+#include <vector>
 #include <cassert>
 #include "diff.h"
 
-class IntSet
-{
-public:
-	void Add(int val) { m_map[val] = 1; }
-	void Remove(int val) { m_map.erase(val); }
-	size_t count() const { return m_map.size(); }
-	bool isPresent(int val) const { return m_map.find(val) != m_map.end(); }
-	int getSingle() const { return m_map.begin()->first; }
-private:
-	std::map<int, int> m_map;
-};
-
 /** 
  * @brief  Set of equivalent lines
- * This uses diffutils line numbers, which are counted from the prefix
+ * This uses diffutils line numbers, which are counted from the prefix.
+ * Only the number of lines on each side is kept, and the line itself
+ * which is all a perfect match needs.
  */
 struct EqGroup
 {
-	IntSet m_lines0; // equivalent lines on side#0
-	IntSet m_lines1; // equivalent lines on side#1
+	int m_count0 = 0; // number of equivalent lines on side#0
+	int m_count1 = 0; // number of equivalent lines on side#1
+	int m_line0 = -1; // last equivalent line added on side#0
+	int m_line1 = -1; // last equivalent line added on side#1
 
-	bool isPerfectMatch() const { return m_lines0.count()==1 && m_lines1.count()==1; }
+	bool isPerfectMatch() const { return m_count0==1 && m_count1==1; }
 };
 
 
-/** @brief  Maps equivalency code to equivalency group */
+/**
+ * @brief  Maps equivalency code to equivalency group
+ * Open addressing hash table into a flat array of groups, sized for the
+ * number of altered lines so it never grows.
+ */
 class CodeToGroupMap
 {
 public:
-	std::map<int, EqGroup *> m_map;
+	explicit CodeToGroupMap(int nLines)
+	{
+		size_t capacity = 16;
+		while (capacity < static_cast<size_t>(nLines) * 2)
+			capacity *= 2;
+		m_slots.resize(capacity);
+		m_mask = capacity - 1;
+		m_groups.reserve(nLines);
+	}
+
 	/** @brief Add a line to the appropriate equivalency group */
 	void Add(int lineno, int eqcode, int nside)
 	{
-		EqGroup *pgroup = find(eqcode);
-		if (pgroup == nullptr)
+		Slot& slot = findSlot(eqcode);
+		if (slot.group < 0)
 		{
-			pgroup = new EqGroup;
-			m_map[eqcode] = pgroup;
+			slot.code = eqcode;
+			slot.group = static_cast<int>(m_groups.size());
+			m_groups.emplace_back();
 		}
+		EqGroup& group = m_groups[slot.group];
 		if (nside)
-			pgroup->m_lines1.Add(lineno);
+		{
+			++group.m_count1;
+			group.m_line1 = lineno;
+		}
 		else
-			pgroup->m_lines0.Add(lineno);
+		{
+			++group.m_count0;
+			group.m_line0 = lineno;
+		}
 	}
 
 	/** @brief Return the appropriate equivalency group */
 	EqGroup * find(int eqcode)
 	{
-		std::map<int, EqGroup *>::const_iterator it = m_map.find(eqcode);
-		return it != m_map.end() ? it->second : nullptr;
+		const Slot& slot = findSlot(eqcode);
+		return slot.group >= 0 ? &m_groups[slot.group] : nullptr;
 	}
 
-	~CodeToGroupMap()
+private:
+	struct Slot
+	{
+		int code = 0;
+		int group = -1; // index in m_groups, -1 if the slot is free
+	};
+
+	Slot& findSlot(int eqcode)
 	{
-		std::map<int, EqGroup *>::const_iterator pos = m_map.begin();
-		while (pos != m_map.end())
-			delete pos++->second;
+		size_t i = (static_cast<unsigned>(eqcode) * 0x9E3779B9u) & m_mask;
+		while (m_slots[i].group >= 0 && m_slots[i].code != eqcode)
+			i = (i + 1) & m_mask;
+		return m_slots[i];
 	}
+
+	std::vector<Slot> m_slots;
+	size_t m_mask;
+	std::vector<EqGroup> m_groups;
 };
 
-static bool isLineInDiffBlock(int nside, int lineno, change *script)
+/**
+ * @brief  Lines of one side inside the diff blocks
+ * Splitting the blocks while moved blocks are found doesn't change which
+ * lines are inside a block, so the index is built once from the script.
+ */
+class DiffLineIndex
 {
-	change *p = nullptr;
-	for (change *e = script; e; e = p)
+public:
+	DiffLineIndex(change *script, int nside)
 	{
-		p = e->link;
-		if (nside == 0)
+		for (change *e = script; e; e = e->link)
 		{
-			if (e->line0 <= lineno && lineno < e->line0 + e->deleted)
-				return true;
-		}
-		else
-		{
-			if (e->line1 <= lineno && lineno < e->line1 + e->inserted)
-				return true;
+			const int begin = nside ? e->line1 : e->line0;
+			const int end = begin + (nside ? e->inserted : e->deleted);
+			if (end > static_cast<int>(m_lines.size()))
+				m_lines.resize(end);
+			for (int i = begin; i < end; ++i)
+				m_lines[i] = true;
 		}
 	}
-	return false;
-}
+
+	bool isLineInDiffBlock(int lineno) const
+	{
+		return lineno >= 0 && lineno < static_cast<int>(m_lines.size()) && m_lines[lineno];
+	}
+
+private:
+	std::vector<bool> m_lines;
+};
 
 /*
  WinMerge moved block code
@@ -102,11 +137,17 @@ static bool isLineInDiffBlock(int nside, int lineno, change *script)
 */
 extern "C" void moved_block_analysis(struct change ** pscript, struct file_data fd[])
 {
-	// Hash all altered lines
-	CodeToGroupMap map;
-
 	struct change * script = *pscript;
 	struct change *p,*e;
+	int nAltered = 0;
+	for (e = script; e; e = e->link)
+		nAltered += e->deleted + e->inserted;
+
+	// Hash all altered lines
+	CodeToGroupMap map(nAltered);
+	const DiffLineIndex diffLines0(script, 0);
+	const DiffLineIndex diffLines1(script, 1);
+
 	for (e = script; e; e = p)
 	{
 		p = e->link;
@@ -142,7 +183,7 @@ extern "C" void moved_block_analysis(struct change ** pscript, struct file_data
 			continue;
 
 		// found a match
-		int j = pgroup->m_lines1.getSingle();
+		int j = pgroup->m_line1;
 		// Ok, now our moved block is the single line i,j
 
 		// extend moved block upward as far as possible
@@ -150,9 +191,11 @@ extern "C" void moved_block_analysis(struct change ** pscript, struct file_data
 		int j1 = j-1;
 		for ( ; i1>=e->line0; --i1, --j1)
 		{
+			if (!diffLines1.isLineInDiffBlock(j1))
+				break;
 			EqGroup * pgroup0 = map.find(fd[0].equivs[i1]);
 			EqGroup * pgroup1 = map.find(fd[1].equivs[j1]);
-			if (pgroup0 != pgroup1 || !isLineInDiffBlock(1, j1, script))
+			if (pgroup0 != pgroup1)
 				break;
 //			pgroup0->m_lines0.Remove(i1); // commented out this line although I'm not sure what this line means because this line causes the bug sf.net#2174
 //			pgroup1->m_lines1.Remove(j1);
@@ -166,9 +209,11 @@ extern "C" void moved_block_analysis(struct change ** pscript, struct file_data
 		int j2 = j+1;
 		for ( ; i2-(e->line0) < (e->deleted); ++i2,++j2)
 		{
+			if (!diffLines1.isLineInDiffBlock(j2))
+				break;
 			EqGroup * pgroup0 = map.find(fd[0].equivs[i2]);
 			EqGroup * pgroup1 = map.find(fd[1].equivs[j2]);
-			if (pgroup0 != pgroup1 || !isLineInDiffBlock(1, j2, script))
+			if (pgroup0 != pgroup1)
 				break;
 //			pgroup0->m_lines0.Remove(i2); // commented out this line although I'm not sure what this line means because this line causes the bug sf.net#2174
 //			pgroup1->m_lines1.Remove(j2);
@@ -260,7 +305,7 @@ extern "C" void moved_block_analysis(struct change ** pscript, struct file_data
 			continue;
 
 		// found a match
-		int i = pgroup->m_lines0.getSingle();
+		int i = pgroup->m_line0;
 		// Ok, now our moved block is the single line i,j
 
 		// extend moved block upward as far as possible
@@ -268,9 +313,11 @@ extern "C" void moved_block_analysis(struct change ** pscript, struct file_data
 		int j1 = j-1;
 		for ( ; j1>=e->line1; --i1, --j1)
 		{
+			if (!diffLines0.isLineInDiffBlock(i1))
+				break;
 			EqGroup * pgroup0 = map.find(fd[0].equivs[i1]);
 			EqGroup * pgroup1 = map.find(fd[1].equivs[j1]);
-			if (pgroup0 != pgroup1 || !isLineInDiffBlock(0, i1, script))
+			if (pgroup0 != pgroup1)
 				break;
 //			pgroup0->m_lines0.Remove(i1); // commented out this line although I'm not sure what this line means because this line causes the bug sf.net#2174
 //			pgroup1->m_lines1.Remove(j1);
@@ -284,9 +331,11 @@ extern "C" void moved_block_analysis(struct change ** pscript, struct file_data
 		int j2 = j+1;
 		for ( ; j2-(e->line1) < (e->inserted); ++i2,++j2)
 		{
+			if (!diffLines0.isLineInDiffBlock(i2))
+				break;
 			EqGroup * pgroup0 = map.find(fd[0].equivs[i2]);
 			EqGroup * pgroup1 = map.find(fd[1].equivs[j2]);
-			if (pgroup0 != pgroup1 || !isLineInDiffBlock(0, i2, script))
+			if (pgroup0 != pgroup1)
 				break;
 //			pgroup0->m_lines0.Remove(i2); // commented out this line although I'm not sure what this line means because this line causes the bug sf.net#2174
 //			pgroup1->m_lines1.Remove(j2);
@@ -0,0 +1,491 @@
+/**
+ * @file  MultiPatternMatcher.cpp
+ *
+ * @brief Implementation of MultiPatternMatcher class.
+ */
+
+#include "pch.h"
+#include "MultiPatternMatcher.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string_view>
+#include <unordered_set>
+#include <Poco/RegularExpression.h>
+#include <Poco/Exception.h>
+
+using Poco::RegularExpression;
+
+namespace
+{
+
+typedef std::vector<std::unique_ptr<RegularExpression>> RegExpList;
+
+/** @brief How a literal pattern is anchored. */
+enum class LiteralKind
+{
+	Exact, /**< ^LIT$ */
+	Prefix, /**< ^LIT */
+	Suffix, /**< LIT$ and (^|\\)[^\\]*LIT$ */
+	Substring, /**< LIT */
+	Component, /**< (^|\\)LIT$ */
+};
+
+/**
+ * @brief Check if a regular expression only matches a literal string.
+ * @param [in] regex Regular expression.
+ * @param [in] reOpts Regular expression options.
+ * @param [out] kind How the literal is anchored.
+ * @param [out] literal Literal string, in lower case for caseless patterns.
+ * @return true if the pattern is a literal.
+ */
+bool ParseLiteral(const std::string& regex, int reOpts, LiteralKind& kind, std::string& literal)
+{
+	if ((reOpts & ~(RegularExpression::RE_CASELESS | RegularExpression::RE_UTF8)) != 0)
+		return false;
+	if (regex == ".*")
+	{
+		// Matches everything, e.g. the file mask of "*.*"
+		kind = LiteralKind::Substring;
+		literal.clear();
+		return true;
+	}
+	const bool caseless = (reOpts & RegularExpression::RE_CASELESS) != 0;
+	bool begin = false, afterSeparator = false, anyPrefix = false, end = false;
+	size_t i = 0;
+	if (regex.compare(0, 6, "(^|\\\\)") == 0)
+	{
+		afterSeparator = true;
+		i = 6;
+		if (regex.compare(6, 6, "[^\\\\]*") == 0)
+		{
+			anyPrefix = true;
+			i = 12;
+		}
+	}
+	else if (regex.compare(0, 1, "^") == 0)
+	{
+		begin = true;
+		i = 1;
+	}
+	else if (regex.compare(0, 2, "\\A") == 0)
+	{
+		begin = true;
+		i = 2;
+	}
+
+	literal.clear();
+	for (; i < regex.size(); ++i)
+	{
+		const unsigned char c = regex[i];
+		if (c == '\\')
+		{
+			if (i + 1 >= regex.size())
+				return false;
+			const unsigned char next = regex[++i];
+			if ((next == 'z' || next == 'Z') && i + 1 == regex.size())
+				end = true;
+			else if (next >= 0x80 || isalnum(next))
+				return false;
+			else
+				literal += static_cast<char>(next);
+		}
+		else if (c == '$' && i + 1 == regex.size())
+			end = true;
+		else if (c == '\0' || strchr(".[]()*+?{}|^$", c) != nullptr)
+			return false;
+		else if (c >= 0x80 && caseless)
+			return false;
+		else
+			literal += static_cast<char>(c);
+	}
+	if (caseless)
+	{
+		for (auto& c : literal)
+			c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+	}
+
+	if (afterSeparator)
+	{
+		if (!end)
+			return false;
+		if (anyPrefix)
+		{
+			// "[^\\]*" can't cross a separator inside the literal
+			if (literal.find('\\') != std::string::npos)
+				return false;
+			kind = LiteralKind::Suffix;
+		}
+		else
+			kind = LiteralKind::Component;
+	}
+	else if (begin)
+		kind = end ? LiteralKind::Exact : LiteralKind::Prefix;
+	else
+		kind = end ? LiteralKind::Suffix : LiteralKind::Substring;
+	return true;
+}
+
+/**
+ * @brief Check if a regular expression keeps its meaning inside an alternation.
+ * Group numbers shift and verbs and option settings may affect the other
+ * alternatives, so patterns using them are compiled alone.
+ */
+bool CanJoin(const std::string& regex, int reOpts)
+{
+	if ((reOpts & RegularExpression::RE_EXTENDED) != 0)
+		return false;
+	for (size_t i = 0; i < regex.size(); ++i)
+	{
+		const char c = regex[i];
+		if (c == '\\')
+		{
+			if (i + 1 >= regex.size())
+				return false;
+			const unsigned char next = regex[++i];
+			if (isdigit(next) || next == 'g' || next == 'k' || next == 'Q')
+				return false;
+		}
+		else if (c == '(' && i + 1 < regex.size())
+		{
+			const char next = regex[i + 1];
+			if (next == '*')
+				return false;
+			if (next == '?')
+			{
+				const char kind = (i + 2 < regex.size()) ? regex[i + 2] : '\0';
+				const char kind2 = (i + 3 < regex.size()) ? regex[i + 3] : '\0';
+				if (kind != ':' && kind != '=' && kind != '!' && kind != '>' &&
+					!(kind == '<' && (kind2 == '=' || kind2 == '!')))
+					return false;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Compile regular expressions into as few alternations as possible.
+ * Invalid patterns are skipped, like FilterList::AddRegExp() does.
+ */
+void CompileAlternation(const std::vector<std::string>& regexes, int reOpts, RegExpList& regexps)
+{
+	std::string joined;
+	std::vector<const std::string*> separate;
+	int nJoined = 0;
+	for (const auto& regex : regexes)
+	{
+		if (!CanJoin(regex, reOpts))
+		{
+			separate.push_back(&regex);
+			continue;
+		}
+		if (nJoined++ > 0)
+			joined += '|';
+		joined += "(?:";
+		joined += regex;
+		joined += ')';
+	}
+	if (nJoined > 1)
+	{
+		try
+		{
+			regexps.push_back(std::make_unique<RegularExpression>(joined, reOpts));
+		}
+		catch (const Poco::RegularExpressionException&)
+		{
+			nJoined = 0;
+		}
+	}
+	if (nJoined <= 1)
+	{
+		separate.clear();
+		for (const auto& regex : regexes)
+			separate.push_back(&regex);
+	}
+	for (const auto* regex : separate)
+	{
+		try
+		{
+			regexps.push_back(std::make_unique<RegularExpression>(*regex, reOpts));
+		}
+		catch (const Poco::RegularExpressionException&)
+		{
+		}
+	}
+}
+
+bool MatchAny(const RegExpList& regexps, const std::string& subject)
+{
+	for (const auto& regexp : regexps)
+	{
+		RegularExpression::Match match;
+		try
+		{
+			if (regexp->match(subject, 0, match) > 0)
+				return true;
+		}
+		catch (...)
+		{
+		}
+	}
+	return false;
+}
+
+/** @brief Literal patterns of one case sensitivity. */
+struct Literals
+{
+	std::unordered_set<std::string_view> exact;
+	std::unordered_set<std::string_view> prefixes;
+	std::vector<size_t> prefixLengths; /**< Distinct prefix lengths, ascending */
+	std::unordered_set<std::string_view> suffixes;
+	std::vector<size_t> suffixLengths; /**< Distinct suffix lengths, ascending */
+	std::vector<std::string_view> substrings;
+	RegExpList regexps; /**< Same patterns as regular expressions, for strings the tables can't answer */
+
+	bool IsEmpty() const
+	{
+		return exact.empty() && prefixes.empty() && suffixes.empty() && substrings.empty();
+	}
+
+	static void AddLength(std::vector<size_t>& lengths, size_t length)
+	{
+		auto it = std::lower_bound(lengths.begin(), lengths.end(), length);
+		if (it == lengths.end() || *it != length)
+			lengths.insert(it, length);
+	}
+
+	void Add(LiteralKind kind, std::string_view literal, std::string_view componentSuffix)
+	{
+		switch (kind)
+		{
+		case LiteralKind::Exact:
+			exact.insert(literal);
+			break;
+		case LiteralKind::Prefix:
+			prefixes.insert(literal);
+			AddLength(prefixLengths, literal.size());
+			break;
+		case LiteralKind::Suffix:
+			suffixes.insert(literal);
+			AddLength(suffixLengths, literal.size());
+			break;
+		case LiteralKind::Substring:
+			substrings.push_back(literal);
+			break;
+		case LiteralKind::Component:
+			exact.insert(literal);
+			suffixes.insert(componentSuffix);
+			AddLength(suffixLengths, componentSuffix.size());
+			break;
+		}
+	}
+
+	bool Lookup(std::string_view s) const
+	{
+		if (!exact.empty() && exact.count(s) != 0)
+			return true;
+		for (size_t length : prefixLengths)
+		{
+			if (length > s.size())
+				break;
+			if (prefixes.count(s.substr(0, length)) != 0)
+				return true;
+		}
+		for (size_t length : suffixLengths)
+		{
+			if (length > s.size())
+				break;
+			if (suffixes.count(s.substr(s.size() - length)) != 0)
+				return true;
+		}
+		for (const auto& substring : substrings)
+		{
+			if (s.find(substring) != std::string_view::npos)
+				return true;
+		}
+		return false;
+	}
+};
+
+}
+
+/** @brief Patterns matched against the same subject, the path or the file name. */
+struct MultiPatternMatcher::PatternSet
+{
+	Literals literals[2]; /**< Case sensitive and caseless literals */
+	RegExpList regexps; /**< Alternations of the other patterns */
+
+	bool IsEmpty() const
+	{
+		return literals[0].IsEmpty() && literals[1].IsEmpty() && regexps.empty();
+	}
+
+	bool Match(const std::string& subject) const
+	{
+		// "$" may match before a final newline, depending on the PCRE build
+		const bool finalNewline = !subject.empty() && subject.back() == '\n';
+		if (!literals[0].IsEmpty())
+		{
+			if (finalNewline ? MatchAny(literals[0].regexps, subject) : literals[0].Lookup(subject))
+				return true;
+		}
+		if (!literals[1].IsEmpty())
+		{
+			// Caseless PCRE folds non-ASCII characters too (e.g. KELVIN SIGN matches 'k')
+			bool ascii = !finalNewline;
+			for (size_t i = 0; i < subject.size() && ascii; ++i)
+				ascii = static_cast<unsigned char>(subject[i]) < 0x80;
+			if (ascii)
+			{
+				thread_local std::string lower;
+				lower.assign(subject);
+				for (auto& c : lower)
+				{
+					if (c >= 'A' && c <= 'Z')
+						c = static_cast<char>(c - 'A' + 'a');
+				}
+				if (literals[1].Lookup(lower))
+					return true;
+			}
+			else if (MatchAny(literals[1].regexps, subject))
+				return true;
+		}
+		return MatchAny(regexps, subject);
+	}
+};
+
+struct MultiPatternMatcher::Compiled
+{
+	std::deque<std::string> strings; /**< Storage of the literals in the tables */
+	PatternSet path; /**< Patterns matched against the whole string */
+	PatternSet fileName; /**< Patterns matched against the file name */
+	size_t nLiterals = 0;
+};
+
+MultiPatternMatcher::MultiPatternMatcher() = default;
+MultiPatternMatcher::MultiPatternMatcher(MultiPatternMatcher&&) noexcept = default;
+MultiPatternMatcher& MultiPatternMatcher::operator=(MultiPatternMatcher&&) noexcept = default;
+MultiPatternMatcher::~MultiPatternMatcher() = default;
+
+/** @brief Remove all patterns. */
+void MultiPatternMatcher::Clear()
+{
+	m_patterns.clear();
+	m_pCompiled.reset();
+}
+
+/**
+ * @brief Add a pattern, the matcher must be compiled again before use.
+ * @param [in] regex Regular expression, UTF-8.
+ * @param [in] reOpts Poco::RegularExpression options.
+ * @param [in] fileNameOnly If true, the pattern is matched against the part
+ *   of the string after the last path separator.
+ */
+void MultiPatternMatcher::AddPattern(const std::string& regex, int reOpts, bool fileNameOnly)
+{
+	m_patterns.push_back({ regex, reOpts, fileNameOnly });
+	m_pCompiled.reset();
+}
+
+/**
+ * @brief Compile the patterns added.
+ * Sorts the literal patterns into the lookup tables and joins the other
+ * patterns into alternations.
+ */
+void MultiPatternMatcher::Compile()
+{
+	auto pCompiled = std::make_unique<Compiled>();
+	// [file name only][caseless], by regular expression options
+	std::map<int, std::vector<std::string>> literalRegexes[2][2];
+	std::map<int, std::vector<std::string>> otherRegexes[2];
+	LiteralKind kind;
+	std::string literal;
+	for (const auto& pattern : m_patterns)
+	{
+		const int set = pattern.fileNameOnly ? 1 : 0;
+		PatternSet& patternSet = pattern.fileNameOnly ? pCompiled->fileName : pCompiled->path;
+		if (ParseLiteral(pattern.regex, pattern.reOpts, kind, literal))
+		{
+			const int caseless = (pattern.reOpts & RegularExpression::RE_CASELESS) != 0 ? 1 : 0;
+			const std::string& stored = pCompiled->strings.emplace_back(literal);
+			std::string_view componentSuffix;
+			if (kind == LiteralKind::Component)
+				componentSuffix = pCompiled->strings.emplace_back("\\" + literal);
+			patternSet.literals[caseless].Add(kind, stored, componentSuffix);
+			literalRegexes[set][caseless][pattern.reOpts].push_back(pattern.regex);
+			++pCompiled->nLiterals;
+		}
+		else
+			otherRegexes[set][pattern.reOpts].push_back(pattern.regex);
+	}
+	for (int set = 0; set < 2; ++set)
+	{
+		PatternSet& patternSet = set ? pCompiled->fileName : pCompiled->path;
+		for (int caseless = 0; caseless < 2; ++caseless)
+		{
+			for (const auto& [reOpts, regexes] : literalRegexes[set][caseless])
+				CompileAlternation(regexes, reOpts, patternSet.literals[caseless].regexps);
+		}
+		for (const auto& [reOpts, regexes] : otherRegexes[set])
+			CompileAlternation(regexes, reOpts, patternSet.regexps);
+	}
+	m_pCompiled = std::move(pCompiled);
+}
+
+/**
+ * @brief Clone matcher from another matcher.
+ * Current patterns are removed, the patterns of the given matcher are added
+ * and compiled if the given matcher is compiled.
+ * @param [in] matcher Matcher to clone.
+ */
+void MultiPatternMatcher::CloneFrom(const MultiPatternMatcher* matcher)
+{
+	if (!matcher)
+		return;
+
+	m_patterns = matcher->m_patterns;
+	m_pCompiled.reset();
+	if (matcher->IsCompiled())
+		Compile();
+}
+
+/** @brief Number of patterns looked up in the literal tables. */
+size_t MultiPatternMatcher::GetLiteralCount() const
+{
+	return m_pCompiled ? m_pCompiled->nLiterals : 0;
+}
+
+/** @brief Number of regular expressions Match() runs for strings the literal tables answer. */
+size_t MultiPatternMatcher::GetRegExpCount() const
+{
+	return m_pCompiled ? m_pCompiled->path.regexps.size() + m_pCompiled->fileName.regexps.size() : 0;
+}
+
+/**
+ * @brief Match a string against the patterns.
+ * @param [in] string String to match, UTF-8.
+ * @return true if any of the patterns matches, false if none does or the
+ *   matcher isn't compiled.
+ */
+bool MultiPatternMatcher::Match(const std::string& string) const
+{
+	if (!m_pCompiled)
+		return false;
+	if (m_pCompiled->path.Match(string))
+		return true;
+	if (m_pCompiled->fileName.IsEmpty())
+		return false;
+	// Same file name as paths::FindFileName(): a trailing separator is kept
+	size_t start = 0;
+	if (string.size() >= 2)
+	{
+		const size_t pos = string.find_last_of("\\/", string.size() - 2);
+		if (pos != std::string::npos)
+			start = pos + 1;
+	}
+	thread_local std::string fileName;
+	fileName.assign(string, start, std::string::npos);
+	return m_pCompiled->fileName.Match(fileName);
+}
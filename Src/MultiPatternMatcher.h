@@ -0,0 +1,58 @@
+/**
+ * @file  MultiPatternMatcher.h
+ *
+ * @brief Declaration of MultiPatternMatcher class.
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Matches a string against a set of regular expressions at once.
+ *
+ * Patterns are added with AddPattern() and compiled once with Compile().
+ * Patterns which are plain strings anchored to the end, to the begin or to
+ * a path separator (e.g. "\.obj$", "^Makefile$" and the file mask form
+ * "(^|\\)[^\\]*\.cpp$") are looked up in hash tables of literals. The
+ * other patterns are joined into one alternation per regular expression
+ * option set, so Match() runs PCRE once instead of once per pattern.
+ * Patterns using backreferences, verbs or conditions are kept as separate
+ * regular expressions, joining them could change their meaning.
+ *
+ * Match() doesn't allocate memory once its per-thread buffers have grown
+ * to the length of the strings tested (Poco still allocates the PCRE match
+ * data of each regular expression run).
+ */
+class MultiPatternMatcher
+{
+public:
+	MultiPatternMatcher();
+	MultiPatternMatcher(MultiPatternMatcher&&) noexcept;
+	MultiPatternMatcher& operator=(MultiPatternMatcher&&) noexcept;
+	~MultiPatternMatcher();
+
+	void Clear();
+	void AddPattern(const std::string& regex, int reOpts, bool fileNameOnly = false);
+	void Compile();
+	void CloneFrom(const MultiPatternMatcher* matcher);
+	bool IsCompiled() const { return m_pCompiled != nullptr; }
+	size_t GetPatternCount() const { return m_patterns.size(); }
+	size_t GetLiteralCount() const;
+	size_t GetRegExpCount() const;
+	bool Match(const std::string& string) const;
+
+private:
+	struct Pattern
+	{
+		std::string regex; /**< Regular expression, UTF-8 */
+		int reOpts; /**< Poco::RegularExpression options */
+		bool fileNameOnly; /**< Pattern matches the file name only, not the path */
+	};
+	struct PatternSet;
+	struct Compiled;
+
+	std::vector<Pattern> m_patterns; /**< Patterns added since last Clear() */
+	std::unique_ptr<Compiled> m_pCompiled; /**< Compiled patterns, nullptr until Compile() */
+};
@@ -295,11 +295,16 @@ inline const String OPT_CMP_ALIGN_SIMILAR_LINES {_T("Settings/MatchSimilarLines"
 inline const String OPT_CMP_STOP_AFTER_FIRST {_T("Settings/StopAfterFirst"s)};
 inline const String OPT_CMP_QUICK_LIMIT {_T("Settings/QuickMethodLimit"s)};
 inline const String OPT_CMP_BINARY_LIMIT {_T("Settings/BinaryMethodLimit"s)};
+inline const String OPT_CMP_BINARY_MEMORY_MAPPING {_T("Settings/BinaryMethodMemoryMapping"s)};
+inline const String OPT_CMP_BINARY_SAMPLE_BLOCKS {_T("Settings/BinaryMethodSampleBlocks"s)};
+inline const String OPT_CMP_BINARY_TRUST_SAMPLES {_T("Settings/BinaryMethodTrustSamples"s)};
 inline const String OPT_CMP_COMPARE_THREADS {_T("Settings/CompareThreads"s)};
 inline const String OPT_CMP_WALK_UNIQUE_DIRS {_T("Settings/ScanUnpairedDir"s)};
 inline const String OPT_CMP_IGNORE_REPARSE_POINTS {_T("Settings/IgnoreReparsePoints"s)};
 inline const String OPT_CMP_INCLUDE_SUBDIRS {_T("Settings/Recurse"s)};
 inline const String OPT_CMP_TRUST_FILE_METADATA {_T("Settings/TrustFileMetadata"s)};
+inline const String OPT_CMP_CONTENT_HASH_CACHE {_T("Settings/ContentHashCache"s)};
+inline const String OPT_CMP_CONTENT_HASH_CACHE_LIMIT {_T("Settings/ContentHashCacheLimit"s)};
 inline const String OPT_CMP_DIFF_ALGORITHM {_T("Settings/DiffAlgorithm"s)};
 inline const String OPT_CMP_INDENT_HEURISTIC {_T("Settings/IndentHeuristic"s)};
 inline const String OPT_CMP_COMPLETELY_BLANK_OUT_IGNORED_CHANGES {_T("Settings/CompletelyBlankOutIgnoredChanges"s)};
@@ -194,6 +194,9 @@ void Init(COptionsMgr *pOptions)
 	pOptions->InitOption(OPT_CMP_STOP_AFTER_FIRST, false);
 	pOptions->InitOption(OPT_CMP_QUICK_LIMIT, 4 * 1024 * 1024); // 4 Megs
 	pOptions->InitOption(OPT_CMP_BINARY_LIMIT, 64 * 1024 * 1024); // 64 Megs
+	pOptions->InitOption(OPT_CMP_BINARY_MEMORY_MAPPING, true);
+	pOptions->InitOption(OPT_CMP_BINARY_SAMPLE_BLOCKS, 16, 0, 1024);
+	pOptions->InitOption(OPT_CMP_BINARY_TRUST_SAMPLES, false);
 	const int defaultCompareThreads = Poco::Environment::processorCount() < 5 ? -1 : 4;
 	pOptions->InitOption(OPT_CMP_COMPARE_THREADS, defaultCompareThreads, -128, 128);
 	pOptions->InitOption(OPT_CMP_WALK_UNIQUE_DIRS, true);
@@ -201,6 +204,8 @@ void Init(COptionsMgr *pOptions)
 	pOptions->InitOption(OPT_CMP_IGNORE_CODEPAGE, false);
 	pOptions->InitOption(OPT_CMP_INCLUDE_SUBDIRS, true);
 	pOptions->InitOption(OPT_CMP_TRUST_FILE_METADATA, true);
+	pOptions->InitOption(OPT_CMP_CONTENT_HASH_CACHE, false);
+	pOptions->InitOption(OPT_CMP_CONTENT_HASH_CACHE_LIMIT, 64 * 1024 * 1024); // 64 Megs
 	pOptions->InitOption(OPT_CMP_ENABLE_IMGCMP_IN_DIRCMP, false);
 	pOptions->InitOption(OPT_CMP_ADDITIONAL_CONDITION, _T(""));
 	pOptions->InitOption(OPT_CMP_RENAME_MOVE_DETECTION, 0);
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "UnicodeString.h"
+#include <iterator>
 #include <vector>
 
 class PathContext;
@@ -102,9 +103,15 @@ inline int PathContext::GetSize() const
 	return m_nFiles;
 }
 
-class PathContextIterator : public std::iterator<std::forward_iterator_tag, String>
+class PathContextIterator
 {
 public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = String;
+	using difference_type = std::ptrdiff_t;
+	using pointer = String*;
+	using reference = String&;
+
 	explicit PathContextIterator(const PathContext *pPathContext) : m_pPathContext(pPathContext)
 	{
 		m_sel =  (pPathContext->GetSize() == 0) ? -1 : 0;
@@ -0,0 +1,347 @@
+/**
+ *  @file PluginWorkerPool.cpp
+ *
+ *  @brief Implementation of PluginWorkerPool
+ */
+
+#include "pch.h"
+#include "PluginWorkerPool.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <thread>
+#ifndef _WIN32
+#include <csignal>
+#endif
+#include <Poco/Pipe.h>
+#include <Poco/Process.h>
+#include <Poco/Exception.h>
+#include "unicoder.h"
+
+/**
+ * @brief A worker process and the pipes to its stdin and stdout.
+ */
+struct PluginWorkerPool::Worker
+{
+	Poco::Pipe in; /**< Stdin of the worker */
+	Poco::Pipe out; /**< Stdout of the worker */
+	std::unique_ptr<Poco::ProcessHandle> process;
+	std::string buffer; /**< Bytes read from `out`, from `pos` on not consumed yet */
+	size_t pos = 0;
+
+	bool Write(const char *data, size_t size)
+	{
+		while (size > 0)
+		{
+			const int chunk = static_cast<int>((std::min)(size, static_cast<size_t>(1024 * 1024)));
+			const int n = in.writeBytes(data, chunk);
+			if (n <= 0)
+				return false;
+			data += n;
+			size -= n;
+		}
+		return true;
+	}
+
+	bool Fill()
+	{
+		if (pos == buffer.size())
+		{
+			buffer.clear();
+			pos = 0;
+		}
+		char chunk[65536];
+		const int n = out.readBytes(chunk, sizeof(chunk));
+		if (n <= 0)
+			return false;
+		buffer.append(chunk, n);
+		return true;
+	}
+
+	bool ReadLine(std::string& line)
+	{
+		for (;;)
+		{
+			const size_t eol = buffer.find('\n', pos);
+			if (eol != std::string::npos)
+			{
+				line.assign(buffer, pos, eol - pos);
+				pos = eol + 1;
+				return true;
+			}
+			if (buffer.size() - pos > 64)
+				return false; // not a header line
+			if (!Fill())
+				return false;
+		}
+	}
+
+	bool Read(size_t size, std::string& data)
+	{
+		data.clear();
+		data.reserve(size);
+		while (data.size() < size)
+		{
+			if (pos == buffer.size() && !Fill())
+				return false;
+			const size_t n = (std::min)(size - data.size(), buffer.size() - pos);
+			data.append(buffer, pos, n);
+			pos += n;
+		}
+		return true;
+	}
+
+	/** @brief Close the stdin of the worker, it exits when it has read it all */
+	void CloseInput()
+	{
+		in.close(Poco::Pipe::CLOSE_WRITE);
+	}
+
+	/** @brief Wait at most @p milliseconds for the worker to exit, then kill it */
+	void Stop(int milliseconds)
+	{
+		CloseInput();
+		try
+		{
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+			while (process->tryWait() == -1)
+			{
+				if (std::chrono::steady_clock::now() >= deadline)
+				{
+					Poco::Process::kill(*process);
+					process->wait();
+					break;
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+		}
+		catch (Poco::Exception&)
+		{
+		}
+	}
+};
+
+/**
+ * @brief Constructor.
+ * @param [in] commandLine Command line of the workers, quoted like on Windows.
+ * @param [in] nWorkers Maximum number of workers running at once.
+ */
+PluginWorkerPool::PluginWorkerPool(const String& commandLine, int nWorkers)
+: m_commandLine(commandLine)
+, m_nMaxWorkers((std::max)(nWorkers, 1))
+, m_nWorkers(0)
+, m_nLaunched(0)
+{
+#ifndef _WIN32
+	// A worker which exits while it is sent a request must not kill us
+	static std::once_flag ignoreSigpipe;
+	std::call_once(ignoreSigpipe, []() { signal(SIGPIPE, SIG_IGN); });
+#endif
+}
+
+/**
+ * @brief Stop the workers.
+ * All of them are told to exit first, then each is given some time to.
+ */
+PluginWorkerPool::~PluginWorkerPool()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	assert(static_cast<int>(m_idle.size()) == m_nWorkers);
+	for (auto& worker : m_idle)
+		worker->CloseInput();
+	for (auto& worker : m_idle)
+		worker->Stop(1000);
+}
+
+/**
+ * @brief Send @p request to a worker and return its response.
+ * @param [out] errmsg The error message of the worker, or why the call failed.
+ * @return true if the worker answered with success.
+ */
+bool PluginWorkerPool::Call(const std::string& request, std::string& response, String& errmsg)
+{
+	std::unique_ptr<Worker> worker = Acquire(errmsg);
+	if (!worker)
+		return false;
+
+	bool bReplied = false;
+	int status = -1;
+	try
+	{
+		const std::string header = std::to_string(request.size()) + "\n";
+		std::string line;
+		if (worker->Write(header.data(), header.size()) &&
+			worker->Write(request.data(), request.size()) &&
+			worker->ReadLine(line))
+		{
+			size_t pos = 0;
+			long long length = -1;
+			status = std::stoi(line, &pos);
+			length = std::stoll(line.substr(pos));
+			bReplied = length >= 0 && worker->Read(static_cast<size_t>(length), response);
+		}
+	}
+	catch (Poco::Exception&)
+	{
+	}
+	catch (std::logic_error&)
+	{
+		// Not a number in the header
+	}
+
+	if (!bReplied)
+	{
+		Discard(std::move(worker));
+		response.clear();
+		errmsg = _T("The plugin worker exited or didn't reply: ") + m_commandLine;
+		return false;
+	}
+	Release(std::move(worker));
+	if (status != 0)
+	{
+		errmsg = ucr::toTString(response);
+		response.clear();
+		return false;
+	}
+	return true;
+}
+
+/** @brief Number of workers started, including the ones replaced */
+int PluginWorkerPool::GetLaunchCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_nLaunched;
+}
+
+/**
+ * @brief Take an idle worker, start one if all are busy and there may be
+ * more, or wait for one to be idle.
+ */
+std::unique_ptr<PluginWorkerPool::Worker> PluginWorkerPool::Acquire(String& errmsg)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_cond.wait(lock, [this]() { return !m_idle.empty() || m_nWorkers < m_nMaxWorkers; });
+	if (!m_idle.empty())
+	{
+		std::unique_ptr<Worker> worker = std::move(m_idle.back());
+		m_idle.pop_back();
+		return worker;
+	}
+	++m_nWorkers;
+	++m_nLaunched;
+	lock.unlock();
+
+	std::unique_ptr<Worker> worker = Launch(errmsg);
+	if (!worker)
+	{
+		lock.lock();
+		--m_nWorkers;
+		m_cond.notify_one();
+	}
+	return worker;
+}
+
+void PluginWorkerPool::Release(std::unique_ptr<Worker> worker)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_idle.push_back(std::move(worker));
+	m_cond.notify_one();
+}
+
+/** @brief Kill a worker which failed, a later call starts another one */
+void PluginWorkerPool::Discard(std::unique_ptr<Worker> worker)
+{
+	worker->Stop(0);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	--m_nWorkers;
+	m_cond.notify_one();
+}
+
+std::unique_ptr<PluginWorkerPool::Worker> PluginWorkerPool::Launch(String& errmsg) const
+{
+	const std::vector<String> argv = SplitCommandLine(m_commandLine);
+	if (argv.empty())
+	{
+		errmsg = _T("The plugin worker command is empty");
+		return nullptr;
+	}
+	Poco::Process::Args args;
+	for (size_t i = 1; i < argv.size(); ++i)
+		args.push_back(ucr::toUTF8(argv[i]));
+
+	// The pipes of a worker are inheritable while it is started,
+	// so don't let another worker started at the same time inherit them
+	static std::mutex launchMutex;
+	std::lock_guard<std::mutex> lock(launchMutex);
+	auto worker = std::make_unique<Worker>();
+	try
+	{
+		worker->process.reset(new Poco::ProcessHandle(
+			Poco::Process::launch(ucr::toUTF8(argv[0]), args, &worker->in, &worker->out, nullptr)));
+	}
+	catch (Poco::Exception& e)
+	{
+		errmsg = ucr::toTString(e.displayText());
+		return nullptr;
+	}
+	return worker;
+}
+
+/**
+ * @brief Split a command line into the program and its arguments.
+ * Arguments are separated by blanks outside of double quotes. Backslashes
+ * are literal, except before a double quote: 2n backslashes and a quote
+ * are n backslashes and start or end a quoted part, 2n+1 backslashes and
+ * a quote are n backslashes and a literal quote. This is how the C runtime
+ * splits the command line on Windows.
+ */
+std::vector<String> PluginWorkerPool::SplitCommandLine(const String& commandLine)
+{
+	std::vector<String> argv;
+	String arg;
+	bool bInArg = false;
+	bool bQuoted = false;
+	for (size_t i = 0; i < commandLine.size(); ++i)
+	{
+		const tchar_t c = commandLine[i];
+		if (c == '\\')
+		{
+			size_t nBackslashes = 1;
+			while (i + nBackslashes < commandLine.size() && commandLine[i + nBackslashes] == '\\')
+				++nBackslashes;
+			i += nBackslashes - 1;
+			bInArg = true;
+			if (i + 1 < commandLine.size() && commandLine[i + 1] == '"')
+			{
+				arg.append(nBackslashes / 2, '\\');
+				if (nBackslashes % 2 != 0)
+				{
+					arg += '"';
+					++i;
+				}
+			}
+			else
+				arg.append(nBackslashes, '\\');
+		}
+		else if (c == '"')
+		{
+			bQuoted = !bQuoted;
+			bInArg = true;
+		}
+		else if ((c == ' ' || c == '\t') && !bQuoted)
+		{
+			if (bInArg)
+				argv.push_back(std::move(arg));
+			arg.clear();
+			bInArg = false;
+		}
+		else
+		{
+			arg += c;
+			bInArg = true;
+		}
+	}
+	if (bInArg)
+		argv.push_back(std::move(arg));
+	return argv;
+}
@@ -0,0 +1,63 @@
+/**
+ *  @file PluginWorkerPool.h
+ *
+ *  @brief Declaration of PluginWorkerPool
+ */
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "UnicodeString.h"
+
+/**
+ * @brief Long-lived worker processes of a command line plugin.
+ *
+ * Instead of running the plugin's command once per file, up to N processes
+ * of the command are kept running. A call sends the content of a file to
+ * an idle worker over its stdin and reads the result from its stdout.
+ * Calls from several threads run at once, as many as there are workers,
+ * the other calls wait for a worker to be idle. Workers are started by the
+ * first calls that find none idle.
+ *
+ * Both pipes carry frames which start with a header line of decimal numbers:
+ *  - request:  "<length>\n" and length bytes of content
+ *  - response: "<status> <length>\n" and length bytes; status 0 is success,
+ *    otherwise the bytes are an error message.
+ *
+ * A worker reads a whole request before it writes the response, and exits
+ * at the end of its stdin. A worker which doesn't answer with a valid
+ * frame is killed, the next call starts another one.
+ */
+class PluginWorkerPool
+{
+public:
+	PluginWorkerPool(const String& commandLine, int nWorkers);
+	~PluginWorkerPool();
+	PluginWorkerPool(const PluginWorkerPool&) = delete;
+	PluginWorkerPool& operator=(const PluginWorkerPool&) = delete;
+
+	bool Call(const std::string& request, std::string& response, String& errmsg);
+	int GetWorkerCount() const { return m_nMaxWorkers; }
+	int GetLaunchCount() const;
+
+	static std::vector<String> SplitCommandLine(const String& commandLine);
+
+private:
+	struct Worker;
+
+	std::unique_ptr<Worker> Acquire(String& errmsg);
+	void Release(std::unique_ptr<Worker> worker);
+	void Discard(std::unique_ptr<Worker> worker);
+	std::unique_ptr<Worker> Launch(String& errmsg) const;
+
+	String m_commandLine;
+	int m_nMaxWorkers;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::vector<std::unique_ptr<Worker>> m_idle;
+	int m_nWorkers; /**< Workers running, idle or busy */
+	int m_nLaunched; /**< Workers started since the pool was created */
+};
@@ -228,6 +228,7 @@ PluginInfo::PluginInfo()
 	, m_hasArgumentsProperty(false)
 	, m_hasVariablesProperty(false)
 	, m_hasPluginOnEventMethod(false)
+	, m_bConcurrent(false)
 	, m_bAutomaticDefault(false)
 {	
 }
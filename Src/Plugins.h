@@ -78,6 +78,7 @@ public:
 	bool        m_hasArgumentsProperty;
 	bool        m_hasVariablesProperty;
 	bool        m_hasPluginOnEventMethod;
+	bool        m_bConcurrent; ///< may be called from several threads at once
 	std::vector<FileFilterElementPtr> m_filters;
 	/// only for plugins with free function names (EDITOR_SCRIPT)
 	int         m_nFreeFunctions;
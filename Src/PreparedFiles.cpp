@@ -0,0 +1,105 @@
+/**
+ * @file  PreparedFiles.cpp
+ *
+ * @brief Implementation of PreparedFiles class.
+ */
+
+#include "pch.h"
+#include "PreparedFiles.h"
+#include "DiffFileData.h"
+#include "Exceptions.h"
+#include "DebugNew.h"
+
+PreparedFiles::PreparedFiles()
+: m_pTable(nullptr)
+, m_files{}
+, m_nFiles(0)
+{
+}
+
+PreparedFiles::~PreparedFiles()
+{
+	Clear();
+}
+
+/**
+ * @brief Split the files into lines and classify the lines.
+ * The diffutils options must already be set to this thread.
+ * @param [in] nFiles Number of files, 2 or 3.
+ * @param [in] inf Opened file of each file index. Only files whose content
+ *   is preloaded are prepared, reading the others would move the file
+ *   position the compare reads from.
+ */
+void PreparedFiles::Prepare(int nFiles, const file_data *inf[])
+{
+	int nLines = 0;
+	for (int i = 0; i < m_nFiles; ++i)
+		nLines += m_files[i].lines;
+	if (m_pTable == nullptr || nFiles != m_nFiles || !equiv_table_usable(m_pTable, nLines))
+	{
+		// Options changed, or the table has piled up the classes of too
+		// many edited lines
+		Clear();
+		m_pTable = new_equiv_table();
+	}
+	m_nFiles = nFiles;
+
+	SE_Handler seh;
+	try
+	{
+		for (int i = 0; i < nFiles; ++i)
+		{
+			if (inf[i] != nullptr && inf[i]->preloaded != nullptr)
+				prepare_file(&m_files[i], m_pTable, inf[i]);
+			else
+				free_prepared_file(&m_files[i]);
+		}
+		// Hash the lines the compared pairs don't have in common
+		if (nFiles == 2)
+			prepare_file_pair(&m_files[0], &m_files[1]);
+		else
+		{
+			prepare_file_pair(&m_files[1], &m_files[0]);
+			prepare_file_pair(&m_files[1], &m_files[2]);
+			prepare_file_pair(&m_files[0], &m_files[2]);
+		}
+	}
+	catch (SE_Exception&)
+	{
+		Clear();
+	}
+}
+
+/**
+ * @brief Let the compare of @p diffdata use the prepared files.
+ * @param [in] file0, file1 File indexes of the two sides of @p diffdata.
+ */
+void PreparedFiles::Attach(DiffFileData& diffdata, int file0, int file1) const
+{
+	const int file[2] = { file0, file1 };
+	for (int i = 0; i < 2; ++i)
+	{
+		const prepared_file *pf = (file[i] < m_nFiles) ? &m_files[file[i]] : nullptr;
+		diffdata.m_inf[i].prepared = (pf != nullptr && pf->text != nullptr) ? pf : nullptr;
+	}
+}
+
+/** @brief Forget all lines and classes. */
+void PreparedFiles::Clear()
+{
+	for (auto& pf : m_files)
+		free_prepared_file(&pf);
+	if (m_pTable != nullptr)
+		free_equiv_table(m_pTable);
+	m_pTable = nullptr;
+	m_nFiles = 0;
+}
+
+/** @brief Number of lines hashed by the last Prepare(). */
+int PreparedFiles::GetHashedLineCount() const
+{
+	int nLines = 0;
+	for (int i = 0; i < m_nFiles; ++i)
+		nLines += m_files[i].hashed_lines;
+	return nLines;
+}
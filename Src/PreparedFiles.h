@@ -0,0 +1,41 @@
+/**
+ * @file  PreparedFiles.h
+ *
+ * @brief Declaration of PreparedFiles class.
+ */
+#pragma once
+
+#include <vector>
+#include "diff.h"
+
+struct DiffFileData;
+
+/**
+ * @brief Lines and line equivalence classes of the files of a file compare.
+ *
+ * Prepare() splits every file into lines once and puts the lines in
+ * equivalence classes shared by all the files, so that the pairwise
+ * compares of a 3-way compare don't hash the same file two or three times.
+ * The object is kept between rescans: preparing a file again after it was
+ * edited reuses the classes of the unchanged lines and hashes only the
+ * changed region. The classes are only valid for the diffutils options
+ * they were computed with, Prepare() starts over when the options changed.
+ */
+class PreparedFiles
+{
+public:
+	PreparedFiles();
+	PreparedFiles(const PreparedFiles&) = delete;
+	PreparedFiles& operator=(const PreparedFiles&) = delete;
+	~PreparedFiles();
+
+	void Prepare(int nFiles, const file_data *inf[]);
+	void Attach(DiffFileData& diffdata, int file0, int file1) const;
+	void Clear();
+	int GetHashedLineCount() const;
+
+private:
+	equiv_table *m_pTable; /**< Classes of the lines of all files */
+	prepared_file m_files[3]; /**< Lines of each file */
+	int m_nFiles; /**< Number of prepared files */
+};
@@ -74,7 +74,7 @@ END_MESSAGE_MAP()
 BOOL PropCompare::OnInitDialog()
 {
 	SetDlgItemComboBoxList(IDC_DIFF_ALGORITHM,
-		{ _("default"), _("minimal"), _("patience"), _("histogram"), _("none") });
+		{ _("default"), _("minimal"), _("patience"), _("histogram"), _("none"), _("streaming") });
 
 	OptionsPanel::OnInitDialog();
 	return TRUE;  // return TRUE unless you set the focus to a control
@@ -17,23 +17,26 @@
 
 #pragma comment(lib, "propsys.lib")
  
- // {ECA2D096-7C87-4DFF-94E7-E7FE9BA34BE8} 100-102
+ // {ECA2D096-7C87-4DFF-94E7-E7FE9BA34BE8} 100-103
 static const PROPERTYKEY PKEY_HASH_MD5 = { {0xeca2d096, 0x7c87, 0x4dff, 0x94, 0xe7, 0xe7, 0xfe, 0x9b, 0xa3, 0x4b, 0xe8}, 100 };
 static const PROPERTYKEY PKEY_HASH_SHA1 ={ {0xeca2d096, 0x7c87, 0x4dff, 0x94, 0xe7, 0xe7, 0xfe, 0x9b, 0xa3, 0x4b, 0xe8}, 101 }; 
 static const PROPERTYKEY PKEY_HASH_SHA256 = { {0xeca2d096, 0x7c87, 0x4dff, 0x94, 0xe7, 0xe7, 0xfe, 0x9b, 0xa3, 0x4b, 0xe8}, 102 };
+static const PROPERTYKEY PKEY_HASH_XXH3 = { {0xeca2d096, 0x7c87, 0x4dff, 0x94, 0xe7, 0xe7, 0xfe, 0x9b, 0xa3, 0x4b, 0xe8}, 103 };
 
 struct PROPERTYINFO
 {
 	const PROPERTYKEY* pKey;
 	const wchar_t *pszCanonicalName;
 	const wchar_t *pszDisplayName;
+	HashCalc::Algorithm algorithm;
 };
 
 static const PROPERTYINFO g_HashProperties[] =
 {
-	{ &PKEY_HASH_MD5,    L"Hash.MD5",    L"MD5" },
-	{ &PKEY_HASH_SHA1,   L"Hash.SHA1",   L"SHA1" },
-	{ &PKEY_HASH_SHA256, L"Hash.SHA256", L"SHA256" },
+	{ &PKEY_HASH_MD5,    L"Hash.MD5",    L"MD5",    HashCalc::MD5 },
+	{ &PKEY_HASH_SHA1,   L"Hash.SHA1",   L"SHA1",   HashCalc::SHA1 },
+	{ &PKEY_HASH_SHA256, L"Hash.SHA256", L"SHA256", HashCalc::SHA256 },
+	{ &PKEY_HASH_XXH3,   L"Hash.XXH3",   L"XXH3",   HashCalc::XXH3 },
 };
 
 static int GetPropertyIndexFromKey(const PROPERTYKEY& key)
@@ -56,19 +59,32 @@ static const PROPERTYKEY *GetPropertyKeyFromName(const String& canonicalName)
 	return nullptr;
 }
 
-static bool CalculateHashValue(const String& path, const PROPERTYKEY& key, PROPVARIANT& value)
+/**
+ * @brief Compute the hash properties among @p keys, reading the file once.
+ * Hash.XXH3 is left empty, CDiffContext::CreateDuplicateValueMap() sets it
+ * for the files which may have a duplicate.
+ */
+static void CalculateHashValues(const String& path, const std::vector<PROPERTYKEY>& keys, HashCalc::Hashes& hashes)
+{
+	unsigned algorithms = 0;
+	for (const auto& key : keys)
+	{
+		int i = GetPropertyIndexFromKey(key);
+		if (i >= 0 && g_HashProperties[i].algorithm != HashCalc::XXH3)
+			algorithms |= HashCalc::Flag(g_HashProperties[i].algorithm);
+	}
+	if (algorithms != 0)
+		HashCalc::HashFile(path, algorithms, hashes);
+}
+
+static bool GetHashValue(const HashCalc::Hashes& hashes, const PROPERTYKEY& key, PROPVARIANT& value)
 {
 	int i = GetPropertyIndexFromKey(key);
 	if (i >= 0)
 	{
-		std::vector<uint8_t> hash;
-		HANDLE hFile = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
-		if (hFile != INVALID_HANDLE_VALUE)
-		{
-			CalculateHashValue(hFile, g_HashProperties[i].pszDisplayName, hash);
-			CloseHandle(hFile);
-		}
-		InitPropVariantFromBuffer(hash.data(), static_cast<unsigned>(hash.size()), &value);
+		const std::vector<uint8_t>& hash = hashes[g_HashProperties[i].algorithm];
+		if (!hash.empty())
+			InitPropVariantFromBuffer(hash.data(), static_cast<unsigned>(hash.size()), &value);
 		return true;
 	}
 	return false;
@@ -145,6 +161,15 @@ std::vector<uint8_t> PropertyValues::GetHashValue(size_t index) const
 	return { m_values[index].caub.pElems, m_values[index].caub.pElems + m_values[index].caub.cElems };
 }
 
+void PropertyValues::SetHashValue(size_t index, const std::vector<uint8_t>& value)
+{
+	if (index >= m_values.size())
+		return;
+	PropVariantClear(&m_values[index]);
+	if (!value.empty())
+		InitPropVariantFromBuffer(value.data(), static_cast<unsigned>(value.size()), &m_values[index]);
+}
+
 PropertySystem::PropertySystem(ENUMFILTER filter)
 {
 	IPropertyDescriptionList* ppdl = nullptr;
@@ -218,15 +243,15 @@ bool PropertySystem::GetPropertyValues(const String& path, PropertyValues& value
 {
 	IPropertyStore* pps = nullptr;
 	values.m_values.clear();
+	HashCalc::Hashes hashes;
+	CalculateHashValues(path, m_keys, hashes);
 	if (!m_onlyHashProperties && SUCCEEDED(SHGetPropertyStoreFromParsingName(path.c_str(), nullptr, GPS_DEFAULT, IID_PPV_ARGS(&pps))))
 	{
 		values.m_values.reserve(m_keys.size());
 		for (const auto& key : m_keys)
 		{
 			PROPVARIANT value{};
-			if (GetPropertyIndexFromKey(key) >= 0)
-				CalculateHashValue(path, key, value);
-			else
+			if (!GetHashValue(hashes, key, value))
 				pps->GetValue(key, &value);
 			values.m_values.push_back(value);
 		}
@@ -238,8 +263,7 @@ bool PropertySystem::GetPropertyValues(const String& path, PropertyValues& value
 		for (const auto& key : m_keys)
 		{
 			PROPVARIANT value2{};
-			if (GetPropertyIndexFromKey(key) >= 0)
-				CalculateHashValue(path, key, value2);
+			GetHashValue(hashes, key, value2);
 			values.m_values.push_back(value2);
 		}
 	}
@@ -336,6 +360,15 @@ bool PropertySystem::HasHashProperties() const
 	return false;
 }
 
+/** @brief Is the property at @p index Hash.XXH3, which only files that may have a duplicate get? */
+bool PropertySystem::IsDuplicateDigest(unsigned index) const
+{
+	if (index >= m_keys.size())
+		return false;
+	const int i = GetPropertyIndexFromKey(m_keys[index]);
+	return i >= 0 && g_HashProperties[i].algorithm == HashCalc::XXH3;
+}
+
 #else
 
 PropertyValues::PropertyValues()
@@ -376,6 +409,10 @@ std::vector<uint8_t> PropertyValues::GetHashValue(size_t index) const
 	return {};
 }
 
+void PropertyValues::SetHashValue(size_t index, const std::vector<uint8_t>& value)
+{
+}
+
 PropertySystem::PropertySystem(ENUMFILTER filter)
 {
 }
@@ -414,4 +451,9 @@ bool PropertySystem::HasHashProperties() const
 	return false;
 }
 
+bool PropertySystem::IsDuplicateDigest(unsigned index) const
+{
+	return false;
+}
+
 #endif
\ No newline at end of file
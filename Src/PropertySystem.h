@@ -13,6 +13,7 @@
 #else
 typedef int PROPVARIANT;
 typedef int PROPERTYKEY;
+typedef unsigned short VARTYPE;
 #endif
 
 class PropertyValues
@@ -27,6 +28,7 @@ public:
 	bool IsEmptyValue(size_t index) const;
 	bool IsHashValue(size_t index) const;
 	std::vector<uint8_t> GetHashValue(size_t index) const;
+	void SetHashValue(size_t index, const std::vector<uint8_t>& value);
 	size_t GetSize() const { return m_values.size(); }
 	void Resize(size_t size) { m_values.resize(size); }
 	PROPVARIANT& operator[](size_t index) { return m_values[index]; }
@@ -54,6 +56,7 @@ public:
 	String FormatPropertyValue(const PropertyValues& values, unsigned index);
 	bool GetDisplayNames(std::vector<String>& names);
 	bool HasHashProperties() const;
+	bool IsDuplicateDigest(unsigned index) const;
 	const std::vector<String>& GetCanonicalNames() const { return m_canonicalNames; }
 private:
 	bool AddProperty(const String& canonicalName);
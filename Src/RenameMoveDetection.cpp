@@ -28,12 +28,13 @@ static void TransferDiffItemData(DIFFITEM& dst, int dstindex, DIFFITEM& src, int
 	dst.diffFileInfo[dstindex].flags = src.diffFileInfo[srcindex].flags;
 	dst.diffFileInfo[dstindex].ctime = src.diffFileInfo[srcindex].ctime;
 	dst.diffFileInfo[dstindex].mtime = src.diffFileInfo[srcindex].mtime;
-	dst.diffFileInfo[dstindex].version = src.diffFileInfo[srcindex].version;
-	dst.diffFileInfo[dstindex].encoding = src.diffFileInfo[srcindex].encoding;
-	dst.diffFileInfo[dstindex].m_textStats = src.diffFileInfo[srcindex].m_textStats;
+	dst.diffFileInfo[dstindex].CopyDetails(src.diffFileInfo[srcindex]);
 
 	// Move additional properties (using move semantics for efficiency)
-	dst.diffFileInfo[dstindex].m_pAdditionalProperties = std::move(src.diffFileInfo[srcindex].m_pAdditionalProperties);
+	if (src.diffFileInfo[srcindex].HasDetails())
+		dst.diffFileInfo[dstindex].GetAdditionalPropertiesRef() = std::move(src.diffFileInfo[srcindex].GetAdditionalPropertiesRef());
+	else
+		dst.diffFileInfo[dstindex].ClearAdditionalProperties();
 }
 
 /**
@@ -400,6 +401,7 @@ void RenameMoveDetection::Merge(CDiffContext& ctxt)
 				// Transfer data from item being merged
 				TransferDiffItemData(di, i, *pdi2, i);
 				di.diffcode.setSideFlag(i);
+				di.UpdateFolderCounts();
 				itemsToDelete.insert(pdi2);
 			}
 		}
@@ -0,0 +1,683 @@
+/**
+ * @file  StreamingDiff.cpp
+ *
+ * @brief Implementation of StreamingDiff class.
+ */
+
+#include "pch.h"
+#include "StreamingDiff.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include "diff.h"
+#include "xdiff_gnudiff_compat.h"
+extern "C" {
+#include "../Externals/xdiff/xinclude.h"
+}
+
+namespace
+{
+constexpr size_t ChunkSize = 64 * 1024; /**< Bytes read at once */
+constexpr size_t MinLineBytes = 64; /**< A window holds at most window size / this lines */
+constexpr size_t ProbeLines = 32; /**< Lines of a window searched for in the other file */
+constexpr size_t SearchWindows = 8; /**< Window sizes searched ahead for them */
+
+/** @brief Is the line only spaces, tabs and its EOL? */
+bool IsBlank(const char *text, size_t length)
+{
+	for (size_t i = 0; i < length; ++i)
+	{
+		if (text[i] != ' ' && text[i] != '\t' && text[i] != '\r' && text[i] != '\n')
+			return false;
+	}
+	return true;
+}
+}
+
+struct StreamingDiff::Line
+{
+	uint64_t offset; /**< Offset of the line in the file */
+	size_t length; /**< Length with the EOL */
+	size_t keyLength; /**< Length compared, without the EOL if EOL differences are ignored */
+	unsigned long hash; /**< xdiff hash of the compared bytes */
+};
+
+/**
+ * @brief Splits a file into lines, reading it a chunk at a time.
+ * The bytes from the offset given to Keep() on stay in the buffer, the
+ * ones before it are dropped when the buffer is full.
+ */
+class StreamingDiff::Reader
+{
+public:
+	Reader(Source& source, unsigned long xdlFlags, TextStats *stats, uint64_t offset)
+	: m_source(source)
+	, m_xdlFlags(xdlFlags)
+	, m_stats(stats)
+	, m_bufferOffset(offset)
+	, m_keep(0)
+	, m_parse(0)
+	, m_end(0)
+	, m_eof(false)
+	, m_checkBom(offset == 0)
+	{
+	}
+
+	bool Next(Line& line);
+	const char *GetText(const Line& line) const { return m_buffer.data() + (line.offset - m_bufferOffset); }
+	void Keep(uint64_t offset) { m_keep = static_cast<size_t>(offset - m_bufferOffset); }
+	uint64_t GetParseOffset() const { return m_bufferOffset + m_parse; }
+	uint64_t GetReadOffset() const { return m_bufferOffset + m_end; }
+	size_t GetBufferSize() const { return m_buffer.size(); }
+
+private:
+	bool ReadMore();
+
+	Source& m_source;
+	unsigned long m_xdlFlags;
+	TextStats *m_stats; /**< Counts of the lines read, or nullptr */
+	std::vector<char> m_buffer;
+	uint64_t m_bufferOffset; /**< Offset of the buffer in the file */
+	size_t m_keep; /**< First byte kept in the buffer */
+	size_t m_parse; /**< First byte not split into lines yet */
+	size_t m_end; /**< End of the bytes read */
+	bool m_eof;
+	bool m_checkBom; /**< A UTF-8 BOM at the start isn't part of the first line */
+};
+
+/** @brief Read the next chunk of the file, return false at its end. */
+bool StreamingDiff::Reader::ReadMore()
+{
+	if (m_eof)
+		return false;
+	if (m_buffer.size() - m_end < ChunkSize)
+	{
+		// Drop the bytes before the kept ones once they are half of the
+		// buffer, otherwise grow it, so the buffer is at most about twice
+		// the kept bytes and bytes are moved at most once per buffer size
+		if (m_keep > 0 && m_keep >= m_buffer.size() / 2)
+		{
+			std::memmove(m_buffer.data(), m_buffer.data() + m_keep, m_end - m_keep);
+			m_bufferOffset += m_keep;
+			m_parse -= m_keep;
+			m_end -= m_keep;
+			m_keep = 0;
+		}
+		if (m_buffer.size() - m_end < ChunkSize)
+			m_buffer.resize((std::max)(m_buffer.size() * 2, m_end + ChunkSize));
+	}
+	const size_t nRead = m_source.Read(m_buffer.data() + m_end, m_buffer.size() - m_end);
+	if (nRead == 0)
+	{
+		m_eof = true;
+		return false;
+	}
+	m_end += nRead;
+	return true;
+}
+
+/**
+ * @brief Split the next line of the file.
+ * Lines end at LF, CR+LF or CR, like xdiff records.
+ * @return false at the end of the file.
+ */
+bool StreamingDiff::Reader::Next(Line& line)
+{
+	if (m_checkBom)
+	{
+		while (m_end - m_parse < 3 && ReadMore())
+			;
+		if (m_end - m_parse >= 3 && memcmp(m_buffer.data() + m_parse, "\xEF\xBB\xBF", 3) == 0)
+			m_parse += 3;
+		m_checkBom = false;
+	}
+	if (m_parse == m_end && !ReadMore())
+		return false;
+	size_t searched = 0; // Bytes of the line without an EOL, the buffer may move
+	size_t length = 0, eolLength = 0;
+	for (;;)
+	{
+		const char *begin = m_buffer.data() + m_parse;
+		const char *end = m_buffer.data() + m_end;
+		const char *lf = static_cast<const char *>(memchr(begin + searched, '\n', end - begin - searched));
+		const char *cr = static_cast<const char *>(memchr(begin + searched, '\r', (lf ? lf : end) - begin - searched));
+		if (cr != nullptr && cr + 1 < end)
+		{
+			eolLength = (cr[1] == '\n') ? 2 : 1;
+			length = cr - begin + eolLength;
+			break;
+		}
+		if (cr != nullptr)
+		{
+			// A CR at the end of the bytes read may be followed by a LF
+			searched = cr - begin;
+			if (ReadMore())
+				continue;
+			eolLength = 1;
+			length = searched + 1;
+			break;
+		}
+		if (lf != nullptr)
+		{
+			eolLength = 1;
+			length = lf - begin + 1;
+			break;
+		}
+		searched = end - begin;
+		if (ReadMore())
+			continue;
+		length = searched;
+		break;
+	}
+
+	const char *text = m_buffer.data() + m_parse;
+	line.offset = m_bufferOffset + m_parse;
+	line.length = length;
+	line.keyLength = (m_xdlFlags & XDF_IGNORE_CR_AT_EOL) ? length - eolLength : length;
+	const char *ptr = text;
+	line.hash = xdl_hash_record(&ptr, text + line.keyLength, static_cast<long>(m_xdlFlags));
+	if (m_stats != nullptr)
+	{
+		if (eolLength == 2)
+			++m_stats->crlfs;
+		else if (eolLength == 1 && text[length - 1] == '\r')
+			++m_stats->crs;
+		else if (eolLength == 1)
+			++m_stats->lfs;
+		for (const char *zero = text; (zero = static_cast<const char *>(memchr(zero, 0, text + length - zero))) != nullptr; ++zero)
+			++m_stats->zeros;
+		m_stats->missingNewline = (eolLength == 0);
+	}
+	m_parse += length;
+	return true;
+}
+
+/**
+ * @brief Lines of a file held in memory.
+ * The lines are appended by Fill() and dropped from the front by Consume().
+ */
+class StreamingDiff::Window
+{
+public:
+	Window(Source& source, unsigned long xdlFlags, TextStats& stats)
+	: m_source(source)
+	, m_xdlFlags(xdlFlags)
+	, m_reader(source, xdlFlags, &stats, 0)
+	, m_first(0)
+	, m_firstLine(0)
+	, m_bytes(0)
+	, m_atEnd(false)
+	{
+	}
+
+	void Fill(size_t maxBytes, size_t maxLines);
+	int64_t Consume(int64_t count);
+	int64_t Search(size_t maxBytes, const std::function<bool(const Line&, const char *)>& match);
+	size_t GetLineCount() const { return m_lines.size() - m_first; }
+	const Line& GetLine(size_t index) const { return m_lines[m_first + index]; }
+	const char *GetText(size_t index) const { return m_reader.GetText(GetLine(index)); }
+	int64_t GetFirstLineNumber() const { return m_firstLine; }
+	/** @brief Are all remaining lines of the file in the window? */
+	bool AtEnd() const { return m_atEnd; }
+	size_t GetBufferSize() const { return m_reader.GetBufferSize(); }
+
+private:
+	Source& m_source;
+	unsigned long m_xdlFlags;
+	Reader m_reader;
+	std::vector<Line> m_lines;
+	size_t m_first; /**< First line of the window in m_lines */
+	int64_t m_firstLine; /**< Line number of the first line */
+	size_t m_bytes; /**< Bytes of the lines */
+	bool m_atEnd;
+};
+
+/** @brief Read lines until the window has @p maxBytes or @p maxLines, and at least one line. */
+void StreamingDiff::Window::Fill(size_t maxBytes, size_t maxLines)
+{
+	Line line;
+	while (!m_atEnd && (GetLineCount() == 0 || (m_bytes < maxBytes && GetLineCount() < maxLines)))
+	{
+		if (!m_reader.Next(line))
+		{
+			m_atEnd = true;
+			break;
+		}
+		m_lines.push_back(line);
+		m_bytes += line.length;
+	}
+}
+
+/**
+ * @brief Drop @p count lines from the front, reading the ones after the window.
+ * @return Lines dropped, less than @p count at the end of the file.
+ */
+int64_t StreamingDiff::Window::Consume(int64_t count)
+{
+	const size_t inWindow = static_cast<size_t>((std::min)(count, static_cast<int64_t>(GetLineCount())));
+	for (size_t i = 0; i < inWindow; ++i)
+		m_bytes -= GetLine(i).length;
+	m_first += inWindow;
+	int64_t consumed = inWindow;
+	if (m_first == m_lines.size())
+	{
+		m_lines.clear();
+		m_first = 0;
+		Line line;
+		for (; consumed < count; ++consumed)
+		{
+			if (!m_reader.Next(line))
+			{
+				m_atEnd = true;
+				break;
+			}
+			m_reader.Keep(line.offset + line.length);
+		}
+	}
+	else if (m_first >= m_lines.size() / 2)
+	{
+		m_lines.erase(m_lines.begin(), m_lines.begin() + m_first);
+		m_first = 0;
+	}
+	m_firstLine += consumed;
+	m_reader.Keep(GetLineCount() > 0 ? GetLine(0).offset : m_reader.GetParseOffset());
+	return consumed;
+}
+
+/**
+ * @brief Search the lines after the window without keeping them.
+ * @param [in] maxBytes Bytes searched at most.
+ * @param [in] match Returns true for the line searched for.
+ * @return Line number of the line found, or -1.
+ */
+int64_t StreamingDiff::Window::Search(size_t maxBytes, const std::function<bool(const Line&, const char *)>& match)
+{
+	const uint64_t offset = m_reader.GetParseOffset();
+	m_source.Seek(offset);
+	Reader reader(m_source, m_xdlFlags, nullptr, offset);
+	const int64_t first = m_firstLine + static_cast<int64_t>(GetLineCount());
+	int64_t found = -1;
+	size_t bytes = 0;
+	Line line;
+	for (int64_t searched = 0; bytes < maxBytes && reader.Next(line); ++searched)
+	{
+		if (match(line, reader.GetText(line)))
+		{
+			found = first + searched;
+			break;
+		}
+		reader.Keep(line.offset + line.length);
+		bytes += line.length;
+	}
+	m_source.Seek(m_reader.GetReadOffset());
+	return found;
+}
+
+/**
+ * @brief Constructor.
+ * @param [in] xdlFlags xdiff flags which the lines are compared and the
+ *   lines between anchors are diffed with.
+ * @param [in] windowSize Bytes of each file held in memory.
+ */
+StreamingDiff::StreamingDiff(unsigned long xdlFlags, size_t windowSize)
+: m_xdlFlags(xdlFlags & ~static_cast<unsigned long>(XDF_IGNORE_BLANK_LINES))
+, m_windowSize(windowSize)
+, m_windowLines((std::max)(windowSize / MinLineBytes, static_cast<size_t>(1)))
+, m_emit(nullptr)
+, m_pending{}
+, m_hasPending(false)
+, m_nextProbe{}
+, m_stats{}
+, m_peakBufferSize(0)
+{
+}
+
+StreamingDiff::~StreamingDiff() = default;
+
+/**
+ * @brief Diff two files.
+ * @param [in] source0, source1 The files, read from their start.
+ * @param [in] emit Receives the changes in the order of the files.
+ */
+void StreamingDiff::Diff(Source& source0, Source& source1, const EmitFunc& emit)
+{
+	m_emit = &emit;
+	m_hasPending = false;
+	m_nextProbe[0] = m_nextProbe[1] = 0;
+	m_stats[0] = m_stats[1] = TextStats{};
+	m_peakBufferSize = 0;
+	Window windows[2] = { Window(source0, m_xdlFlags, m_stats[0]), Window(source1, m_xdlFlags, m_stats[1]) };
+	for (;;)
+	{
+		for (auto& window : windows)
+		{
+			window.Fill(m_windowSize, m_windowLines);
+			m_peakBufferSize = (std::max)(m_peakBufferSize, window.GetBufferSize());
+		}
+		const size_t count0 = windows[0].GetLineCount();
+		const size_t count1 = windows[1].GetLineCount();
+		if (count0 == 0 || count1 == 0)
+		{
+			// One file ended, the rest of the other is deleted or inserted
+			const int64_t line0 = windows[0].GetFirstLineNumber();
+			const int64_t line1 = windows[1].GetFirstLineNumber();
+			const int64_t deleted = windows[0].Consume(INT64_MAX);
+			const int64_t inserted = windows[1].Consume(INT64_MAX);
+			if (deleted > 0 || inserted > 0)
+				Emit(line0, line1, deleted, inserted);
+			break;
+		}
+		size_t equal = 0;
+		while (equal < count0 && equal < count1 && Equal(windows[0], equal, windows[1], equal))
+			++equal;
+		if (equal > 0)
+		{
+			windows[0].Consume(equal);
+			windows[1].Consume(equal);
+			continue;
+		}
+		CountOccurrences(windows);
+		if (CommitAnchored(windows))
+			continue;
+		if (windows[0].AtEnd() && windows[1].AtEnd())
+		{
+			DiffRange(windows, 0, count0, 0, count1);
+			windows[0].Consume(count0);
+			windows[1].Consume(count1);
+			continue;
+		}
+		CommitProbed(windows);
+	}
+	Flush();
+	m_occurrences.clear();
+	m_emit = nullptr;
+}
+
+/** @brief Do the lines match for the xdiff flags? */
+bool StreamingDiff::Equal(const Window& window0, size_t index0, const Window& window1, size_t index1) const
+{
+	const Line& line0 = window0.GetLine(index0);
+	const Line& line1 = window1.GetLine(index1);
+	return line0.hash == line1.hash &&
+		xdl_recmatch(window0.GetText(index0), static_cast<long>(line0.keyLength),
+			window1.GetText(index1), static_cast<long>(line1.keyLength), static_cast<long>(m_xdlFlags));
+}
+
+/** @brief Count the lines of each hash in both windows. */
+void StreamingDiff::CountOccurrences(Window windows[2])
+{
+	m_occurrences.clear();
+	m_occurrences.reserve(windows[0].GetLineCount() + windows[1].GetLineCount());
+	for (int side = 0; side < 2; ++side)
+	{
+		for (size_t i = 0; i < windows[side].GetLineCount(); ++i)
+		{
+			Occurrence& occurrence = m_occurrences[windows[side].GetLine(i).hash];
+			++occurrence.count[side];
+			occurrence.index[side] = i;
+		}
+	}
+}
+
+/**
+ * @brief Diff and drop the lines up to the last anchor.
+ * The anchors are the longest sequence, in the order of both windows, of
+ * the lines which are unique in each window and match. If all lines of
+ * the files are in the windows, the lines after the last anchor are
+ * diffed too, otherwise they stay for the next windows.
+ * @return false if there is no anchor.
+ */
+bool StreamingDiff::CommitAnchored(Window windows[2])
+{
+	const size_t count0 = windows[0].GetLineCount();
+	const size_t count1 = windows[1].GetLineCount();
+	std::vector<std::pair<size_t, size_t>> unique;
+	for (size_t i = 0; i < count0; ++i)
+	{
+		const Occurrence& occurrence = m_occurrences.find(windows[0].GetLine(i).hash)->second;
+		if (occurrence.count[0] == 1 && occurrence.count[1] == 1 && Equal(windows[0], i, windows[1], occurrence.index[1]))
+			unique.emplace_back(i, occurrence.index[1]);
+	}
+	if (unique.empty())
+		return false;
+
+	// Longest increasing subsequence of the lines of the second window, by patience sorting
+	std::vector<size_t> tails; // Last element of the best subsequence of each length
+	std::vector<size_t> previous(unique.size());
+	for (size_t k = 0; k < unique.size(); ++k)
+	{
+		auto pos = std::lower_bound(tails.begin(), tails.end(), unique[k].second,
+			[&unique](size_t tail, size_t line1) { return unique[tail].second < line1; });
+		previous[k] = (pos == tails.begin()) ? SIZE_MAX : *(pos - 1);
+		if (pos == tails.end())
+			tails.push_back(k);
+		else
+			*pos = k;
+	}
+	std::vector<std::pair<size_t, size_t>> anchors(tails.size());
+	size_t k = tails.back();
+	for (size_t n = anchors.size(); n-- > 0; k = previous[k])
+		anchors[n] = unique[k];
+
+	size_t begin0 = 0, begin1 = 0;
+	for (const auto& anchor : anchors)
+	{
+		DiffRange(windows, begin0, anchor.first, begin1, anchor.second);
+		begin0 = anchor.first + 1;
+		begin1 = anchor.second + 1;
+	}
+	if (windows[0].AtEnd() && windows[1].AtEnd())
+	{
+		DiffRange(windows, begin0, count0, begin1, count1);
+		begin0 = count0;
+		begin1 = count1;
+	}
+	windows[0].Consume(begin0);
+	windows[1].Consume(begin1);
+	return true;
+}
+
+/**
+ * @brief Drop lines of windows which have no anchor.
+ * Lines at the front of each window, unique there and not blank, are
+ * searched for in the lines after the other window. If one is found, the
+ * lines before it which have no counterpart in the other file are deleted
+ * or inserted, so that the next windows start at about the same place in
+ * both files. Otherwise the windows are diffed as they are, or replace
+ * each other if they have no line in common.
+ */
+void StreamingDiff::CommitProbed(Window windows[2])
+{
+	int64_t found[2] = { -1, -1 }; // Line of each file which matches a line of the other window
+	size_t foundIndex[2] = {}; // That line of the other window
+	for (int side = 0; side < 2; ++side)
+	{
+		Window& window = windows[side];
+		const Window& other = windows[1 - side];
+		if (window.AtEnd() || window.GetFirstLineNumber() < m_nextProbe[side])
+			continue;
+		// Lines spread over the other window, the files may realign in its middle
+		std::unordered_map<unsigned long, size_t> probes;
+		const size_t stride = (std::max)(other.GetLineCount() / ProbeLines, static_cast<size_t>(1));
+		for (size_t i = 0, next = 0; i < other.GetLineCount() && probes.size() < ProbeLines; ++i)
+		{
+			const Line& line = other.GetLine(i);
+			if (i >= next && m_occurrences.find(line.hash)->second.count[1 - side] == 1 && !IsBlank(other.GetText(i), line.length))
+			{
+				probes.emplace(line.hash, i);
+				next = i + stride;
+			}
+		}
+		if (probes.empty())
+			continue;
+		found[side] = window.Search(SearchWindows * m_windowSize, [&](const Line& line, const char *text)
+			{
+				const auto it = probes.find(line.hash);
+				if (it == probes.end())
+					return false;
+				const Line& probe = other.GetLine(it->second);
+				if (!xdl_recmatch(text, static_cast<long>(line.keyLength),
+						other.GetText(it->second), static_cast<long>(probe.keyLength), static_cast<long>(m_xdlFlags)))
+					return false;
+				foundIndex[side] = it->second;
+				return true;
+			});
+		// Search again once the lines of the window have been dropped
+		if (found[side] < 0)
+			m_nextProbe[side] = window.GetFirstLineNumber() + static_cast<int64_t>(window.GetLineCount());
+	}
+
+	// The match nearest to the end of its window aligns the files
+	int side = -1;
+	int64_t distance[2] = {};
+	for (int s = 0; s < 2; ++s)
+	{
+		distance[s] = found[s] - windows[s].GetFirstLineNumber() - static_cast<int64_t>(windows[s].GetLineCount());
+		if (found[s] >= 0 && (side < 0 || distance[s] < distance[side]))
+			side = s;
+	}
+	const int64_t line0 = windows[0].GetFirstLineNumber();
+	const int64_t line1 = windows[1].GetFirstLineNumber();
+	if (side >= 0)
+	{
+		// Lines before the match in its file less lines before the matched line in the other
+		const int64_t extra = found[side] - windows[side].GetFirstLineNumber() - static_cast<int64_t>(foundIndex[side]);
+		if (extra != 0)
+		{
+			const int extraSide = (extra > 0) ? side : 1 - side;
+			const int64_t count = windows[extraSide].Consume(extra > 0 ? extra : -extra);
+			Emit(line0, line1, (extraSide == 0) ? count : 0, (extraSide == 1) ? count : 0);
+			return;
+		}
+	}
+	if (CommitCommon(windows))
+		return;
+	int64_t deleted = static_cast<int64_t>(windows[0].GetLineCount());
+	int64_t inserted = static_cast<int64_t>(windows[1].GetLineCount());
+	// The matched line is after the shorter window, as far from the front in both files
+	if (side >= 0)
+		deleted = inserted = (std::min)(deleted, inserted);
+	deleted = windows[0].Consume(deleted);
+	inserted = windows[1].Consume(inserted);
+	Emit(line0, line1, deleted, inserted);
+}
+
+/**
+ * @brief Diff whole windows which have lines in common but no anchor.
+ * The last change stays for the next windows if it reaches the end of a
+ * window, the lines after the window may match.
+ * @return false if there is no line in common or nothing would be dropped.
+ */
+bool StreamingDiff::CommitCommon(Window windows[2])
+{
+	if (std::none_of(m_occurrences.begin(), m_occurrences.end(),
+			[](const auto& occurrence) { return occurrence.second.count[0] > 0 && occurrence.second.count[1] > 0; }))
+		return false;
+	const size_t count0 = windows[0].GetLineCount();
+	const size_t count1 = windows[1].GetLineCount();
+	change *script = DiffLines(windows, 0, count0, 0, count1);
+	change *last = script;
+	for (change *e = script; e != nullptr; e = e->link)
+		last = e;
+	change *held = nullptr;
+	if (last != nullptr && (static_cast<size_t>(last->line0 + last->deleted) == count0 || static_cast<size_t>(last->line1 + last->inserted) == count1))
+		held = last;
+	const size_t end0 = held ? held->line0 : count0;
+	const size_t end1 = held ? held->line1 : count1;
+	const bool progress = end0 > 0 || end1 > 0;
+	const int64_t line0 = windows[0].GetFirstLineNumber();
+	const int64_t line1 = windows[1].GetFirstLineNumber();
+	for (change *e = script, *next = nullptr; e != nullptr; e = next)
+	{
+		if (progress && e != held)
+			Emit(line0 + e->line0, line1 + e->line1, e->deleted, e->inserted);
+		next = e->link;
+		free(e);
+	}
+	if (!progress)
+		return false;
+	windows[0].Consume(end0);
+	windows[1].Consume(end1);
+	return true;
+}
+
+/**
+ * @brief Diff lines of the windows with xdiff.
+ * @return Script with line numbers from the first lines diffed.
+ */
+struct change *StreamingDiff::DiffLines(Window windows[2], size_t begin0, size_t end0, size_t begin1, size_t end1)
+{
+	const size_t begin[2] = { begin0, begin1 };
+	const size_t end[2] = { end0, end1 };
+	const char *text[2];
+	size_t size[2];
+	for (int side = 0; side < 2; ++side)
+	{
+		const Window& window = windows[side];
+		if (!(m_xdlFlags & XDF_IGNORE_CR_AT_EOL))
+		{
+			// The lines follow each other in the buffer
+			text[side] = window.GetText(begin[side]);
+			size[side] = static_cast<size_t>(window.GetLine(end[side] - 1).offset + window.GetLine(end[side] - 1).length - window.GetLine(begin[side]).offset);
+		}
+		else
+		{
+			// Make the EOLs the same, like diffutils does for xdiff
+			m_text[side].clear();
+			for (size_t i = begin[side]; i < end[side]; ++i)
+			{
+				m_text[side].append(window.GetText(i), window.GetLine(i).keyLength);
+				m_text[side] += '\n';
+			}
+			text[side] = m_text[side].data();
+			size[side] = m_text[side].size();
+		}
+	}
+	return diff_2_buffers_xdiff(text[0], size[0], text[1], size[1], static_cast<unsigned>(m_xdlFlags));
+}
+
+/** @brief Diff lines of the windows and emit the changes. */
+void StreamingDiff::DiffRange(Window windows[2], size_t begin0, size_t end0, size_t begin1, size_t end1)
+{
+	const int64_t line0 = windows[0].GetFirstLineNumber() + static_cast<int64_t>(begin0);
+	const int64_t line1 = windows[1].GetFirstLineNumber() + static_cast<int64_t>(begin1);
+	if (begin0 == end0 || begin1 == end1)
+	{
+		if (begin0 != end0 || begin1 != end1)
+			Emit(line0, line1, end0 - begin0, end1 - begin1);
+		return;
+	}
+	change *script = DiffLines(windows, begin0, end0, begin1, end1);
+	for (change *e = script, *next = nullptr; e != nullptr; e = next)
+	{
+		Emit(line0 + e->line0, line1 + e->line1, e->deleted, e->inserted);
+		next = e->link;
+		free(e);
+	}
+}
+
+/** @brief Emit a change, joined with the previous one if they touch. */
+void StreamingDiff::Emit(int64_t line0, int64_t line1, int64_t deleted, int64_t inserted)
+{
+	if (m_hasPending && m_pending[0] + m_pending[2] == line0 && m_pending[1] + m_pending[3] == line1)
+	{
+		m_pending[2] += deleted;
+		m_pending[3] += inserted;
+		return;
+	}
+	Flush();
+	m_pending[0] = line0;
+	m_pending[1] = line1;
+	m_pending[2] = deleted;
+	m_pending[3] = inserted;
+	m_hasPending = true;
+}
+
+void StreamingDiff::Flush()
+{
+	if (!m_hasPending)
+		return;
+	(*m_emit)(static_cast<int>(m_pending[0]), static_cast<int>(m_pending[1]),
+		static_cast<int>(m_pending[2]), static_cast<int>(m_pending[3]));
+	m_hasPending = false;
+}
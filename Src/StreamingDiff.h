@@ -0,0 +1,100 @@
+/**
+ * @file  StreamingDiff.h
+ *
+ * @brief Declaration of StreamingDiff class.
+ */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Line diff of two files held in memory a window at a time.
+ *
+ * Both files are read from their start into windows of about the same
+ * number of bytes. Equal lines at the front of the windows are dropped,
+ * then the lines unique in both windows are matched patience-style
+ * (longest increasing subsequence) and the lines up to the last of these
+ * anchors are diffed with xdiff and dropped. Windows without anchors are
+ * aligned by searching the lines after one window for lines at the front
+ * of the other. The changes are emitted in order as soon as they are
+ * found, so memory is bounded by the window size, not the file size
+ * (a single line longer than the window is held as a whole).
+ *
+ * Lines are split and matched like xdiff does, at LF, CR+LF and CR. Lines
+ * further apart than a window and the search distance aren't matched, and
+ * XDF_IGNORE_BLANK_LINES isn't supported, every change is emitted.
+ */
+class StreamingDiff
+{
+public:
+	/** @brief Bytes of a file, read from its start. */
+	class Source
+	{
+	public:
+		virtual ~Source() = default;
+		/** @brief Read up to @p size bytes into @p buf, return the count read, 0 at the end. */
+		virtual size_t Read(char *buf, size_t size) = 0;
+		/** @brief Read the next bytes from @p offset. */
+		virtual void Seek(uint64_t offset) = 0;
+	};
+
+	/** @brief Line endings and NUL bytes of a file, counted like diffutils counts them. */
+	struct TextStats
+	{
+		int crlfs;
+		int crs;
+		int lfs;
+		int zeros;
+		bool missingNewline; /**< Last line has no EOL */
+	};
+
+	/** @brief Receives a change, lines numbered from 0 like in a gnudiff change. */
+	using EmitFunc = std::function<void(int line0, int line1, int deleted, int inserted)>;
+
+	static constexpr size_t DefaultWindowSize = 16 * 1024 * 1024; /**< Bytes of each file in memory */
+
+	explicit StreamingDiff(unsigned long xdlFlags, size_t windowSize = DefaultWindowSize);
+	~StreamingDiff();
+
+	void Diff(Source& source0, Source& source1, const EmitFunc& emit);
+	const TextStats& GetTextStats(int side) const { return m_stats[side]; }
+	size_t GetPeakBufferSize() const { return m_peakBufferSize; }
+
+private:
+	struct Line;
+	class Reader;
+	class Window;
+	/** @brief Occurrences of a line in the windows, see CommitAnchored(). */
+	struct Occurrence
+	{
+		size_t count[2];
+		size_t index[2]; /**< Last line of the window with the hash */
+	};
+
+	bool Equal(const Window& window0, size_t index0, const Window& window1, size_t index1) const;
+	void CountOccurrences(Window windows[2]);
+	bool CommitAnchored(Window windows[2]);
+	void CommitProbed(Window windows[2]);
+	bool CommitCommon(Window windows[2]);
+	struct change *DiffLines(Window windows[2], size_t begin0, size_t end0, size_t begin1, size_t end1);
+	void DiffRange(Window windows[2], size_t begin0, size_t end0, size_t begin1, size_t end1);
+	void Emit(int64_t line0, int64_t line1, int64_t deleted, int64_t inserted);
+	void Flush();
+
+	unsigned long m_xdlFlags;
+	size_t m_windowSize;
+	size_t m_windowLines; /**< Lines of each file in memory */
+	const EmitFunc *m_emit;
+	int64_t m_pending[4]; /**< Change not emitted yet, it may continue: line0, line1, deleted, inserted */
+	bool m_hasPending;
+	int64_t m_nextProbe[2]; /**< First line from which the lines after the window are searched again */
+	TextStats m_stats[2];
+	size_t m_peakBufferSize; /**< Largest buffer of the files, for the tests */
+	std::unordered_map<unsigned long, Occurrence> m_occurrences;
+	std::string m_text[2]; /**< Lines given to xdiff with the EOLs made the same */
+};
@@ -99,6 +99,8 @@ SubstitutionItem::SubstitutionItem(const SubstitutionItem& other)
 void SubstitutionList::Add(const std::string& pattern, const std::string& replacement, int regexpCompileOptions)
 {
 	m_list.emplace_back(pattern, replacement, regexpCompileOptions);
+	m_matcher.AddPattern(pattern, regexpCompileOptions);
+	m_compiled = false;
 }
 
 void SubstitutionList::Add(
@@ -124,7 +126,7 @@ void SubstitutionList::Add(
 	}
 	if (matchWholeWordOnly)
 		rePattern = "\\b" + rePattern + "\\b";
-	m_list.emplace_back(rePattern, replacement, regexpCompileOptions);
+	Add(rePattern, replacement, regexpCompileOptions);
 }
 
 std::string SubstitutionList::Subst(const std::string& subject, int codepage/*=CP_UTF8*/) const
@@ -146,6 +148,16 @@ std::string SubstitutionList::Subst(const std::string& subject, int codepage/*=C
 		replaced = subject;
 	}
 
+	// A text none of the patterns matches is left as is, one run of the
+	// joined patterns instead of one substitution per pattern
+	if (m_list.size() > 1)
+	{
+		if (!m_compiled.load(std::memory_order_acquire))
+			CompileOnce();
+		if (!m_matcher.Match(replaced))
+			return replaced;
+	}
+
 	for (const auto& item : m_list)
 	{
 		try
@@ -164,5 +176,19 @@ std::string SubstitutionList::Subst(const std::string& subject, int codepage/*=C
 void SubstitutionList::RemoveAllFilters()
 {
 	m_list.clear();
+	m_matcher.Clear();
+	m_compiled = false;
+}
+
+/**
+ * @brief Compile the joined patterns once all of them are added, instead
+ * of after each Add().
+ */
+void SubstitutionList::CompileOnce() const
+{
+	std::lock_guard<std::mutex> lock(m_compileMutex);
+	if (!m_matcher.IsCompiled())
+		m_matcher.Compile();
+	m_compiled.store(true, std::memory_order_release);
 }
 
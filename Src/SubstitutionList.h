@@ -7,7 +7,10 @@
 
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <mutex>
 #include <Poco/RegularExpression.h>
+#include "MultiPatternMatcher.h"
 #include "unicoder.h"
 
 
@@ -37,6 +40,11 @@ public:
 	const SubstitutionItem& operator[](int index) const { return m_list[index]; }
 
 private:
+	void CompileOnce() const;
+
 	std::vector<SubstitutionItem> m_list;
+	mutable MultiPatternMatcher m_matcher; /**< Patterns of m_list joined, to skip the text none of them matches, compiled on first use */
+	mutable std::mutex m_compileMutex; /**< Serializes the compile on first use */
+	mutable std::atomic<bool> m_compiled{ false }; /**< m_matcher is compiled */
 };
 
@@ -708,21 +708,21 @@ TEST(FolderCompare, IgnoreEOL)
 			{
 				if (dirs[i].find(L"/w/") != String::npos)
 				{
-					EXPECT_LT(0, di.diffFileInfo[i].m_textStats.ncrlfs);
-					EXPECT_EQ(0, di.diffFileInfo[i].m_textStats.nlfs);
-					EXPECT_EQ(0, di.diffFileInfo[i].m_textStats.ncrs);
+					EXPECT_LT(0, di.diffFileInfo[i].GetTextStats().ncrlfs);
+					EXPECT_EQ(0, di.diffFileInfo[i].GetTextStats().nlfs);
+					EXPECT_EQ(0, di.diffFileInfo[i].GetTextStats().ncrs);
 				}
 				else if (dirs[i].find(L"/u/") != String::npos)
 				{
-					EXPECT_LT(0, di.diffFileInfo[i].m_textStats.nlfs);
-					EXPECT_EQ(0, di.diffFileInfo[i].m_textStats.ncrlfs);
-					EXPECT_EQ(0, di.diffFileInfo[i].m_textStats.ncrs);
+					EXPECT_LT(0, di.diffFileInfo[i].GetTextStats().nlfs);
+					EXPECT_EQ(0, di.diffFileInfo[i].GetTextStats().ncrlfs);
+					EXPECT_EQ(0, di.diffFileInfo[i].GetTextStats().ncrs);
 				}
 				else if (dirs[i].find(L"/m/") != String::npos)
 				{
-					EXPECT_LT(0, di.diffFileInfo[i].m_textStats.ncrs);
-					EXPECT_EQ(0, di.diffFileInfo[i].m_textStats.nlfs);
-					EXPECT_EQ(0, di.diffFileInfo[i].m_textStats.ncrlfs);
+					EXPECT_LT(0, di.diffFileInfo[i].GetTextStats().ncrs);
+					EXPECT_EQ(0, di.diffFileInfo[i].GetTextStats().nlfs);
+					EXPECT_EQ(0, di.diffFileInfo[i].GetTextStats().ncrlfs);
 				}
 			}
 		}
@@ -827,4 +827,4 @@ TEST(FileMenu, OpenProject3)
 		pFrame->PostMessage(WM_CLOSE);
 }
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -656,7 +656,8 @@ void CWebPageDiffFrame::LoadOptions()
 	Options::DiffOptions::Load(GetOptionsMgr(), options);
 	diffOptions.bFilterCommentsLines = options.bFilterCommentsLines;
 	diffOptions.completelyBlankOutIgnoredChanges = options.bCompletelyBlankOutIgnoredChanges;
-	diffOptions.diffAlgorithm = options.nDiffAlgorithm;
+	// Pages are compared in memory, the streaming diff is for large files
+	diffOptions.diffAlgorithm = (options.nDiffAlgorithm == DIFF_ALGORITHM_STREAMING) ? DIFF_ALGORITHM_PATIENCE : options.nDiffAlgorithm;
 	diffOptions.ignoreBlankLines = options.bIgnoreBlankLines;
 	diffOptions.ignoreCase = options.bIgnoreCase;
 	diffOptions.ignoreEol = options.bIgnoreEol;
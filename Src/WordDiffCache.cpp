@@ -0,0 +1,321 @@
+/**
+ * @file  WordDiffCache.cpp
+ *
+ * @brief Implementation of WordDiffCache class.
+ */
+
+#include "pch.h"
+#include "WordDiffCache.h"
+#include <algorithm>
+#include <Poco/Environment.h>
+#include <Poco/Runnable.h>
+#include <Poco/ThreadPool.h>
+
+using Poco::Environment;
+using Poco::ThreadPool;
+
+/** @brief Runs the jobs of the cache on a pool thread. */
+class WordDiffCache::Worker : public Poco::Runnable
+{
+public:
+	explicit Worker(WordDiffCache& cache) : m_cache(cache) {}
+	virtual void run() override { m_cache.Run(); }
+private:
+	WordDiffCache& m_cache;
+};
+
+WordDiffCache::WordDiffCache()
+: m_nGeneration(0)
+, m_bStop(false)
+{
+}
+
+WordDiffCache::~WordDiffCache()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStop = true;
+		m_queue.clear();
+	}
+	m_cond.notify_all();
+	if (m_pThreadPool)
+		m_pThreadPool->joinAll();
+}
+
+/**
+ * @brief Get the word diffs of a diff block.
+ * A block still queued is computed on the calling thread, a block being
+ * computed by a worker is waited for.
+ * @param [in] nDiff Index of the diff block.
+ * @param [out] worddiffs Word diffs of the block.
+ * @return false if the block isn't cached nor queued.
+ */
+bool WordDiffCache::Lookup(int nDiff, std::vector<WordDiff>& worddiffs)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;)
+	{
+		auto it = m_entries.find(nDiff);
+		if (it == m_entries.end())
+			return false;
+		Entry& entry = it->second;
+		if (entry.state == State::Done)
+		{
+			worddiffs = entry.worddiffs;
+			return true;
+		}
+		if (entry.state == State::Running)
+		{
+			m_condDone.wait(lock);
+			continue;
+		}
+
+		// Queued: the workers haven't got to it yet
+		auto itJob = std::find_if(m_queue.begin(), m_queue.end(),
+			[nDiff](const Job& job) { return job.nDiff == nDiff; });
+		Job job = std::move(*itJob);
+		m_queue.erase(itJob);
+		entry.state = State::Running;
+		lock.unlock();
+		try
+		{
+			worddiffs = Compute(job.source, job.options);
+		}
+		catch (...)
+		{
+			lock.lock();
+			Abandon(job);
+			throw;
+		}
+		lock.lock();
+		Finish(job, std::vector<WordDiff>(worddiffs));
+		return true;
+	}
+}
+
+/** @brief Check if a diff block is cached, queued or being computed. */
+bool WordDiffCache::Contains(int nDiff) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_entries.find(nDiff) != m_entries.end();
+}
+
+/** @brief Store word diffs computed by the caller. */
+void WordDiffCache::Store(int nDiff, const std::vector<WordDiff>& worddiffs)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Entry& entry = m_entries[nDiff];
+	if (entry.state == State::Queued)
+	{
+		m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(),
+			[nDiff](const Job& job) { return job.nDiff == nDiff; }), m_queue.end());
+	}
+	entry.state = State::Done;
+	entry.generation = ++m_nGeneration;
+	entry.worddiffs = worddiffs;
+	m_condDone.notify_all();
+}
+
+/**
+ * @brief Queue a diff block for the workers.
+ * Does nothing if the block is already cached or queued.
+ * @param [in] nDiff Index of the diff block.
+ * @param [in] source Lines of the block.
+ * @param [in] options Compare options.
+ */
+void WordDiffCache::Prefetch(int nDiff, WordDiffSource&& source, const WordDiffOptions& options)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_bStop || m_entries.find(nDiff) != m_entries.end())
+			return;
+		const unsigned generation = ++m_nGeneration;
+		m_entries[nDiff] = Entry{ State::Queued, generation, {} };
+		m_queue.push_back(Job{ nDiff, generation, std::move(source), options });
+		if (!m_pThreadPool)
+			StartWorkers();
+	}
+	m_cond.notify_one();
+}
+
+/**
+ * @brief Drop the queued blocks outside a range of diffs.
+ * Called when the view scrolls, so the workers don't compute blocks which
+ * went out of sight before the ones now in sight.
+ */
+void WordDiffCache::CancelQueued(int nFirstDiff, int nLastDiff)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto itEnd = std::remove_if(m_queue.begin(), m_queue.end(),
+		[&](const Job& job)
+		{
+			if (job.nDiff >= nFirstDiff && job.nDiff <= nLastDiff)
+				return false;
+			m_entries.erase(job.nDiff);
+			return true;
+		});
+	m_queue.erase(itEnd, m_queue.end());
+}
+
+/**
+ * @brief Drop the word diffs of a diff block.
+ * A result a worker is still computing for the block is discarded.
+ * @param [in] nDiff Index of the diff block, -1 for all blocks.
+ */
+void WordDiffCache::Clear(int nDiff/* = -1 */)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (nDiff == -1)
+	{
+		m_entries.clear();
+		m_queue.clear();
+	}
+	else
+	{
+		m_entries.erase(nDiff);
+		m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(),
+			[nDiff](const Job& job) { return job.nDiff == nDiff; }), m_queue.end());
+	}
+	m_condDone.notify_all();
+}
+
+void WordDiffCache::StartWorkers()
+{
+	// A screenful of diff blocks doesn't keep more threads busy
+	const int nWorkers = std::clamp(static_cast<int>(Environment::processorCount()) - 1, 1, 4);
+	m_pThreadPool.reset(new ThreadPool(nWorkers, nWorkers));
+	for (int i = 0; i < nWorkers; ++i)
+	{
+		m_workers.emplace_back(new Worker(*this));
+		m_pThreadPool->start(*m_workers.back());
+	}
+}
+
+void WordDiffCache::Run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;)
+	{
+		m_cond.wait(lock, [this] { return m_bStop || !m_queue.empty(); });
+		if (m_bStop)
+			return;
+		Job job = std::move(m_queue.front());
+		m_queue.pop_front();
+		m_entries[job.nDiff].state = State::Running;
+		lock.unlock();
+		std::vector<WordDiff> worddiffs;
+		bool bComputed = true;
+		try
+		{
+			worddiffs = Compute(job.source, job.options);
+		}
+		catch (...)
+		{
+			bComputed = false;
+		}
+		lock.lock();
+		if (bComputed)
+			Finish(job, std::move(worddiffs));
+		else
+			Abandon(job);
+	}
+}
+
+/** @brief Drop the entry of a job which failed, Lookup() lets the caller compute the block. Called locked. */
+void WordDiffCache::Abandon(const Job& job)
+{
+	auto it = m_entries.find(job.nDiff);
+	if (it != m_entries.end() && it->second.generation == job.generation)
+		m_entries.erase(it);
+	m_condDone.notify_all();
+}
+
+/** @brief Store the result of a job, unless the block was cleared meanwhile. Called locked. */
+void WordDiffCache::Finish(const Job& job, std::vector<WordDiff>&& worddiffs)
+{
+	auto it = m_entries.find(job.nDiff);
+	if (it != m_entries.end() && it->second.generation == job.generation)
+	{
+		it->second.state = State::Done;
+		it->second.worddiffs = std::move(worddiffs);
+	}
+	m_condDone.notify_all();
+}
+
+/**
+ * @brief Compute the word diffs of a diff block.
+ * The offsets returned by strdiff::ComputeWordDiffs() are converted to
+ * line and column positions in the block.
+ */
+std::vector<WordDiff> WordDiffCache::Compute(const WordDiffSource& source, const WordDiffOptions& options)
+{
+	// Make the call to stringdiffs, which does all the hard & tedious computations
+	std::vector<strdiff::wdiff> wdiffs =
+		strdiff::ComputeWordDiffs(source.nStrings, source.str, options.casitive, options.eolMode, options.xwhite,
+			options.ignoreNumbers, options.breakType, options.byteColoring);
+
+	std::vector<WordDiff> worddiffs;
+	worddiffs.reserve(wdiffs.size());
+	for (const auto& wdiff : wdiffs)
+	{
+		WordDiff wd;
+		for (int i = 0; i < source.nStrings; ++i)
+		{
+			const int nLineBegin = source.begin[i];
+			const int nLineEnd = source.end[i];
+			const int nLineCount = source.lineCount[i];
+			const std::vector<int>& offsets = source.offsets[i];
+			auto lineLength = [&](int nLine)
+			{
+				const size_t index = static_cast<size_t>(nLine - nLineBegin);
+				return (nLine < nLineCount && index < source.lineLengths[i].size()) ? source.lineLengths[i][index] : 0;
+			};
+			int nLine;
+			for (nLine = nLineBegin; nLine < nLineEnd; nLine++)
+			{
+				if (wdiff.begin[i] == offsets[nLine-nLineBegin] || wdiff.begin[i] < offsets[nLine-nLineBegin+1])
+					break;
+			}
+			wd.beginline[i] = nLine;
+			wd.begin[i] = wdiff.begin[i] - offsets[nLine-nLineBegin];
+			const int nLineLength1 = lineLength(nLine);
+			if (nLineLength1 < wd.begin[i])
+			{
+				if (wd.beginline[i] < nLineCount - 1)
+				{
+					wd.begin[i] = 0;
+					wd.beginline[i]++;
+				}
+				else
+				{
+					wd.begin[i] = nLineLength1;
+				}
+			}
+
+			for (; nLine < nLineEnd; nLine++)
+			{
+				if (wdiff.end[i] + 1 == offsets[nLine-nLineBegin] || wdiff.end[i] + 1 < offsets[nLine-nLineBegin+1])
+					break;
+			}
+			wd.endline[i] = nLine;
+			wd.end[i] = wdiff.end[i] + 1 - offsets[nLine-nLineBegin];
+			const int nLineLength2 = lineLength(nLine);
+			if (nLineLength2 < wd.end[i])
+			{
+				if (wd.endline[i] < nLineCount - 1)
+				{
+					wd.end[i] = 0;
+					wd.endline[i]++;
+				}
+				else
+				{
+					wd.end[i] = nLineLength2;
+				}
+			}
+		}
+		wd.op = wdiff.op;
+
+		worddiffs.push_back(wd);
+	}
+	return worddiffs;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file  WordDiffCache.h
+ *
+ * @brief Declaration of WordDiffCache class.
+ */
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "UnicodeString.h"
+#include "stringdiffs.h"
+
+namespace Poco { class ThreadPool; }
+
+struct WordDiff {
+	std::array<int, 3> begin; // 0-based, eg, begin[0] is from str1
+	std::array<int, 3> end; // 0-based, eg, end[1] is from str2
+	std::array<int, 3> beginline;
+	std::array<int, 3> endline;
+	int op;
+
+	WordDiff(int s1=0, int e1=0, int bl1=0, int el1=0, int s2=0, int e2=0, int bl2=0, int el2=0, int s3=0, int e3=0, int bl3=0, int el3=0, int op=0)
+		: begin{s1, s2, s3}
+		, beginline{bl1, bl2, bl3}
+		, endline{el1, el2, el3}
+		, op(op)
+	{
+		if (s1>e1) e1=s1;
+		if (s2>e2) e2=s2;
+		if (s3>e3) e3=s3;
+		end[0] = e1;
+		end[1] = e2;
+		end[2] = e3;
+	}
+};
+
+/**
+ * @brief Lines of a diff block, copied from the text buffers.
+ * Word diffs are computed from this copy, so they can be computed on
+ * another thread while the buffers are edited or drawn.
+ */
+struct WordDiffSource
+{
+	int nStrings = 0; /**< Number of files compared, 2 or 3 */
+	String str[3]; /**< Text of the lines, with EOLs */
+	std::vector<int> offsets[3]; /**< Offset of each line in str, and the length of str */
+	std::vector<int> lineLengths[3]; /**< Length of each line without EOL */
+	int begin[3] = {}; /**< First line of the block */
+	int end[3] = {}; /**< Last line of the block */
+	int lineCount[3] = {}; /**< Number of lines in the buffer */
+};
+
+/** @brief Options that affect the word diffs, see strdiff::ComputeWordDiffs(). */
+struct WordDiffOptions
+{
+	bool casitive = true;
+	strdiff::EolCompareMode eolMode = strdiff::EOL_STRICT;
+	int xwhite = 0;
+	bool ignoreNumbers = false;
+	int breakType = 0;
+	bool byteColoring = false;
+};
+
+/**
+ * @brief Word diffs of diff blocks, computed ahead on worker threads.
+ *
+ * Prefetch() queues a diff block for the workers, Lookup() returns the
+ * word diffs of a block once computed. Lookup() doesn't wait for the queue:
+ * a block still queued is computed on the calling thread, and only a block
+ * a worker is busy with is waited for. Blocks not prefetched are computed
+ * by the caller and stored with Store().
+ *
+ * Clear() drops the cached word diffs of a block, or of all blocks, and
+ * the results of the workers still computing them. The workers are
+ * started on first Prefetch().
+ */
+class WordDiffCache
+{
+public:
+	WordDiffCache();
+	~WordDiffCache();
+
+	bool Lookup(int nDiff, std::vector<WordDiff>& worddiffs);
+	bool Contains(int nDiff) const;
+	void Store(int nDiff, const std::vector<WordDiff>& worddiffs);
+	void Prefetch(int nDiff, WordDiffSource&& source, const WordDiffOptions& options);
+	void CancelQueued(int nFirstDiff, int nLastDiff);
+	void Clear(int nDiff = -1);
+
+	static std::vector<WordDiff> Compute(const WordDiffSource& source, const WordDiffOptions& options);
+
+private:
+	enum class State { Queued, Running, Done };
+	struct Entry
+	{
+		State state = State::Done;
+		unsigned generation = 0; /**< Tells a result from a cleared entry apart from a result of the current one */
+		std::vector<WordDiff> worddiffs;
+	};
+	struct Job
+	{
+		int nDiff;
+		unsigned generation;
+		WordDiffSource source;
+		WordDiffOptions options;
+	};
+	class Worker;
+
+	void StartWorkers();
+	void Run();
+	void Finish(const Job& job, std::vector<WordDiff>&& worddiffs);
+	void Abandon(const Job& job);
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cond; /**< Signals queued jobs to the workers */
+	std::condition_variable m_condDone; /**< Signals finished jobs to Lookup() */
+	std::map<int, Entry> m_entries;
+	std::deque<Job> m_queue;
+	unsigned m_nGeneration;
+	bool m_bStop;
+	std::unique_ptr<Poco::ThreadPool> m_pThreadPool;
+	std::vector<std::unique_ptr<Worker>> m_workers;
+};
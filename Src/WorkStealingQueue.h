@@ -0,0 +1,374 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file  WorkStealingQueue.h
+ *
+ * @brief Lock-free work-stealing deque (Chase-Lev) and a scheduler built on it.
+ */
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+#include <cassert>
+
+/**
+ * @brief Lock-free single-owner, multi-thief deque of pointers.
+ *
+ * This is the Chase-Lev deque as formulated for C11 atomics by Le, Pop,
+ * Cohen and Zappa Nardelli. Only the owning thread may call Push(),
+ * PushBatch() and Pop(); any thread may call Steal(). The owner works LIFO
+ * from the bottom end, thieves take FIFO from the top end.
+ *
+ * Grown ring buffers are retired but not freed until the deque is
+ * destroyed, since a thief may still be reading from an old buffer.
+ */
+template <class T>
+class WorkStealingQueue
+{
+public:
+	explicit WorkStealingQueue(size_t nInitialCapacity = 1024)
+		: m_top(0), m_bottom(0)
+	{
+		size_t capacity = 1;
+		while (capacity < nInitialCapacity)
+			capacity <<= 1;
+		m_buffers.emplace_back(new Buffer(capacity));
+		m_buffer.store(m_buffers.back().get(), std::memory_order_relaxed);
+	}
+
+	WorkStealingQueue(const WorkStealingQueue&) = delete;
+	WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+	/** @brief Push one item to the bottom (owner only). */
+	void Push(T *item)
+	{
+		PushBatch(&item, 1);
+	}
+
+	/**
+	 * @brief Push several items with a single publication (owner only).
+	 * Thieves see either none or all of the items in the batch.
+	 */
+	void PushBatch(T * const *items, size_t count)
+	{
+		if (count == 0)
+			return;
+		int64_t b = m_bottom.load(std::memory_order_relaxed);
+		int64_t t = m_top.load(std::memory_order_acquire);
+		Buffer *buf = m_buffer.load(std::memory_order_relaxed);
+		if (b - t + static_cast<int64_t>(count) > static_cast<int64_t>(buf->capacity))
+			buf = Grow(buf, t, b, b - t + count);
+		for (size_t i = 0; i < count; ++i)
+			buf->put(b + i, items[i]);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_bottom.store(b + static_cast<int64_t>(count), std::memory_order_relaxed);
+	}
+
+	/** @brief Pop the most recently pushed item (owner only). */
+	T *Pop()
+	{
+		int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+		Buffer *buf = m_buffer.load(std::memory_order_relaxed);
+		m_bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = m_top.load(std::memory_order_relaxed);
+		T *item = nullptr;
+		if (t <= b)
+		{
+			item = buf->get(b);
+			if (t == b)
+			{
+				// Last item: race against thieves for it
+				if (!m_top.compare_exchange_strong(t, t + 1,
+						std::memory_order_seq_cst, std::memory_order_relaxed))
+					item = nullptr;
+				m_bottom.store(b + 1, std::memory_order_relaxed);
+			}
+		}
+		else
+		{
+			m_bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return item;
+	}
+
+	/** @brief Steal the oldest item (any thread). Returns nullptr if empty or lost a race. */
+	T *Steal()
+	{
+		int64_t t = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = m_bottom.load(std::memory_order_acquire);
+		if (t >= b)
+			return nullptr;
+		Buffer *buf = m_buffer.load(std::memory_order_consume);
+		T *item = buf->get(t);
+		if (!m_top.compare_exchange_strong(t, t + 1,
+				std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr;
+		return item;
+	}
+
+	/** @brief Approximate number of queued items. */
+	size_t Size() const
+	{
+		int64_t b = m_bottom.load(std::memory_order_relaxed);
+		int64_t t = m_top.load(std::memory_order_relaxed);
+		return b > t ? static_cast<size_t>(b - t) : 0;
+	}
+
+	bool Empty() const { return Size() == 0; }
+
+private:
+	struct Buffer
+	{
+		explicit Buffer(size_t capacity)
+			: capacity(capacity), mask(capacity - 1), items(new std::atomic<T *>[capacity]) {}
+		T *get(int64_t i) const { return items[i & mask].load(std::memory_order_relaxed); }
+		void put(int64_t i, T *item) { items[i & mask].store(item, std::memory_order_relaxed); }
+		const size_t capacity;
+		const size_t mask;
+		std::unique_ptr<std::atomic<T *>[]> items;
+	};
+
+	Buffer *Grow(Buffer *old, int64_t t, int64_t b, size_t nRequired)
+	{
+		size_t capacity = old->capacity * 2;
+		while (capacity < nRequired)
+			capacity <<= 1;
+		m_buffers.emplace_back(new Buffer(capacity));
+		Buffer *buf = m_buffers.back().get();
+		for (int64_t i = t; i < b; ++i)
+			buf->put(i, old->get(i));
+		m_buffer.store(buf, std::memory_order_release);
+		return buf;
+	}
+
+	alignas(64) std::atomic<int64_t> m_top;
+	alignas(64) std::atomic<int64_t> m_bottom;
+	std::atomic<Buffer *> m_buffer;
+	std::vector<std::unique_ptr<Buffer>> m_buffers; /**< Owned by the owner thread; includes retired buffers */
+};
+
+/**
+ * @brief Work-stealing scheduler with one deque per worker.
+ *
+ * The scheduler does not own threads. Each worker thread calls RunWorker()
+ * with its id and a handler; one producer thread (which must not be a worker)
+ * submits batches of items with Submit(). Workers pop from their own deque,
+ * and when it is empty steal from the producer's deques or from a random
+ * sibling. A worker that steals from the producer takes a handful of extra
+ * items into its own deque, so that later steals hit the workers' deques
+ * instead of all contending on the producer's ones.
+ *
+ * The producer has two deques: items submitted as urgent are stolen before
+ * all the other items the producer submitted, even earlier ones.
+ *
+ * Idle workers park on a condition variable instead of polling. The optional
+ * @p isIdle predicate lets the caller temporarily take workers out of
+ * service (e.g. when the user lowers the CPU core count during a compare).
+ */
+template <class T>
+class WorkStealingScheduler
+{
+public:
+	explicit WorkStealingScheduler(int nWorkers, size_t nStealBatch = 8)
+		: m_nWorkers(nWorkers)
+		, m_nStealBatch(nStealBatch)
+		, m_queues(nWorkers + 2)
+		, m_nPending(0)
+		, m_nParked(0)
+		, m_epoch(0)
+		, m_bShutdown(false)
+	{
+		for (auto& queue : m_queues)
+			queue.reset(new WorkStealingQueue<T>());
+	}
+
+	/**
+	 * @brief Submit a batch of items (producer thread only).
+	 * @param [in] bUrgent Hand the items out before the non-urgent ones.
+	 */
+	void Submit(T * const *items, size_t count, bool bUrgent = false)
+	{
+		if (count == 0)
+			return;
+		m_nPending.fetch_add(static_cast<int64_t>(count), std::memory_order_relaxed);
+		m_queues[bUrgent ? UrgentQueue() : m_nWorkers + 1]->PushBatch(items, count);
+		WakeWorkers();
+	}
+
+	/**
+	 * @brief Run a worker loop until Shutdown() is called.
+	 * @param [in] id Worker id, 0 <= id < nWorkers.
+	 * @param [in] handler Called as handler(T&) for every item.
+	 * @param [in] isIdle Called as isIdle() between items; while it returns
+	 * true the worker does not take new items.
+	 */
+	template <class Handler, class IdlePredicate>
+	void RunWorker(int id, Handler handler, IdlePredicate isIdle)
+	{
+		assert(id >= 0 && id < m_nWorkers);
+		WorkStealingQueue<T>& own = *m_queues[id];
+		unsigned seed = static_cast<unsigned>(id) * 2654435761U + 1;
+		int nFailedRounds = 0;
+		while (!m_bShutdown.load(std::memory_order_acquire))
+		{
+			if (isIdle())
+			{
+				Park(std::chrono::milliseconds(100));
+				continue;
+			}
+			T *item = own.Pop();
+			if (item == nullptr)
+				item = StealWork(id, own, seed);
+			if (item != nullptr)
+			{
+				nFailedRounds = 0;
+				handler(*item);
+				if (m_nPending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_cvDone.notify_all();
+				}
+				continue;
+			}
+			if (++nFailedRounds < 64)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			nFailedRounds = 0;
+			Park(std::chrono::milliseconds(0));
+		}
+	}
+
+	template <class Handler>
+	void RunWorker(int id, Handler handler)
+	{
+		RunWorker(id, handler, [] { return false; });
+	}
+
+	/** @brief Block the producer until every submitted item has been handled. */
+	void WaitIdle()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cvDone.wait(lock, [this] { return m_nPending.load(std::memory_order_acquire) == 0; });
+	}
+
+	/** @brief Make every RunWorker() call return as soon as its current item is done. */
+	void Shutdown()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bShutdown.store(true, std::memory_order_release);
+			++m_epoch;
+		}
+		m_cvWork.notify_all();
+	}
+
+	/** @brief Wake parked workers, e.g. after the idle predicate has changed. */
+	void WakeWorkers()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (m_nParked.load(std::memory_order_relaxed) > 0)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				++m_epoch;
+			}
+			m_cvWork.notify_all();
+		}
+	}
+
+	int GetWorkerCount() const { return m_nWorkers; }
+
+private:
+	int UrgentQueue() const { return m_nWorkers; }
+
+	T *StealWork(int id, WorkStealingQueue<T>& own, unsigned& seed)
+	{
+		// Producer's deques first: that's where new work appears
+		for (int i = UrgentQueue(); i < m_nWorkers + 2; ++i)
+		{
+			WorkStealingQueue<T>& producer = *m_queues[i];
+			if (T *item = producer.Steal())
+			{
+				// Take a few more into our own deque for locality and so that
+				// other thieves find work without touching the producer's deque
+				T *extra[64];
+				size_t n = 0;
+				while (n < m_nStealBatch && n < 64)
+				{
+					T *next = producer.Steal();
+					if (next == nullptr)
+						break;
+					extra[n++] = next;
+				}
+				own.PushBatch(extra, n);
+				return item;
+			}
+		}
+		if (m_nWorkers > 1)
+		{
+			seed = seed * 1103515245U + 12345U;
+			int start = static_cast<int>((seed >> 16) % static_cast<unsigned>(m_nWorkers));
+			for (int i = 0; i < m_nWorkers; ++i)
+			{
+				int victim = (start + i) % m_nWorkers;
+				if (victim == id)
+					continue;
+				if (T *item = m_queues[victim]->Steal())
+					return item;
+			}
+		}
+		return nullptr;
+	}
+
+	bool HasWork() const
+	{
+		for (const auto& queue : m_queues)
+			if (!queue->Empty())
+				return true;
+		return false;
+	}
+
+	/**
+	 * @brief Sleep until new work is submitted or the scheduler shuts down.
+	 * A non-zero @p timeout bounds the wait (used while the worker is idle).
+	 */
+	void Park(std::chrono::milliseconds timeout)
+	{
+		uint64_t epoch = m_epoch.load(std::memory_order_acquire);
+		m_nParked.fetch_add(1, std::memory_order_seq_cst);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (timeout.count() == 0 && (HasWork() || m_bShutdown.load(std::memory_order_acquire)))
+		{
+			m_nParked.fetch_sub(1, std::memory_order_relaxed);
+			return;
+		}
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			auto ready = [&] { return m_epoch.load(std::memory_order_relaxed) != epoch || m_bShutdown.load(std::memory_order_relaxed); };
+			if (timeout.count() == 0)
+				m_cvWork.wait(lock, ready);
+			else
+				m_cvWork.wait_for(lock, timeout, ready);
+		}
+		m_nParked.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	const int m_nWorkers;
+	const size_t m_nStealBatch;
+	std::vector<std::unique_ptr<WorkStealingQueue<T>>> m_queues; /**< One per worker, then the producer's urgent and other items */
+	std::atomic<int64_t> m_nPending; /**< Submitted but not yet handled items */
+	std::atomic<int> m_nParked; /**< Workers sleeping in Park() */
+	std::atomic<uint64_t> m_epoch; /**< Bumped whenever parked workers should re-check */
+	std::atomic<bool> m_bShutdown;
+	std::mutex m_mutex;
+	std::condition_variable m_cvWork;
+	std::condition_variable m_cvDone;
+};
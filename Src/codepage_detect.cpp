@@ -17,6 +17,10 @@
 #include "paths.h"
 #include "markdown.h"
 
+#ifndef _WIN32
+#define sscanf_s sscanf
+#endif
+
 /**
  * @brief Prefixes to handle when searching for codepage names
  * NB: prefixes ending in '-' must go first!
@@ -16,3 +16,7 @@
 #define HAVE_STDLIB_H 1
 #define HAVE_STRING_H 1
 #define HAVE_TIME_H 1
+#ifndef _WIN32
+#define HAVE_UNISTD_H 1
+#define HAVE_SYS_WAIT_H 1
+#endif
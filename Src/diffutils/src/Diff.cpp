@@ -28,8 +28,10 @@ the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
 #include "pch.h"
 #define GDIFF_MAIN
 #include "diff.h" 
+#ifdef _WIN32
 #include "io.h"
-#include "diffwrapper.h"
+#endif
+#include "DiffWrapper.h"
 
 
 /* Nonzero for -r: if comparing two directories,
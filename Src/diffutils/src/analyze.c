@@ -877,7 +877,7 @@ struct change * diff_2_files (struct file_data filevec[], int depth, int * bin_s
 				for (i = 0; i < 2; i++)
 					while (filevec[i].buffered_chars < buffer_size)
 					  {
-						int r = _read (filevec[i].desc,
+						int r = read_file_data (&filevec[i],
 									   filevec[i].buffer	+ filevec[i].buffered_chars,
 									   (int)(buffer_size - filevec[i].buffered_chars));
 						if (r == 0)
@@ -1133,6 +1133,6 @@ void cleanup_file_buffers(struct file_data fd[])
 		free ((void *)(fd[i].linbuf + fd[i].linbuf_base));
 
 	if (fd[0].buffer != fd[1].buffer)
-		free (fd[0].buffer);
-	free (fd[1].buffer);
+		free_file_buffer (&fd[0]);
+	free_file_buffer (&fd[1]);
 }
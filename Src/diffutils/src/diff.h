@@ -236,6 +236,8 @@ struct change
 
 /* Structures that describe the input files.  */
 
+struct prepared_file;
+
 /* Data on one input file being compared.  */
 
 struct file_data {
@@ -304,6 +306,48 @@ struct file_data {
 
     /* text stats for WinMerge */
     int count_crlfs, count_crs, count_lfs, count_zeros;
+
+    /* WinMerge: file content read beforehand, possibly shared with other
+       compares of the same file.  When not NULL, read_file_data() copies
+       from it instead of reading desc.  */
+    char const HUGE *preloaded;
+    FSIZE preloaded_size;
+    /* Offset of the next byte read_file_data() returns from preloaded. */
+    FSIZE preloaded_pos;
+
+    /* WinMerge: nonzero if buffer is a private mapping of the file made
+       by map_file() rather than allocated, the size of the mapping.  */
+    FSIZE mapped_size;
+
+    /* WinMerge: lines and equivalence classes of this file computed
+       beforehand by prepare_file(), or NULL.  read_files() uses them
+       instead of hashing the lines if both files have them.  */
+    struct prepared_file const *prepared;
+};
+
+/* WinMerge: Equivalence classes of lines shared by the prepared files of
+   several compares.  A class is valid for the options the table was
+   created with.  */
+
+struct equiv_table;
+
+/* WinMerge: The lines of one file with their equivalence classes in an
+   equiv_table, computed once and used by every compare of the file, also
+   by compares running concurrently.  Preparing the file again after it
+   was changed rehashes only the lines that changed.  */
+
+struct prepared_file {
+    struct equiv_table *table;	/* Table of the classes in equivs  */
+    char *buffer;		/* Buffer holding the text  */
+    char const *text;		/* Text as read_files() sees it, after
+				   transcoding and with a final newline  */
+    FSIZE size;			/* Length of text  */
+    int missing_newline;	/* 1 if a newline was appended to text  */
+    int lines;			/* Number of lines in text  */
+    FSIZE *line_offsets;	/* lines + 1 line start offsets in text  */
+    int *equivs;		/* Class of each line, 0 if not hashed  */
+    int hashed_lines;		/* Lines hashed by the last prepare_file()
+				   and prepare_file_pair() calls  */
 };
 
 /* Describe the two files currently being compared.  */
@@ -343,6 +387,14 @@ void print_ifdef_script (struct change *);
 int read_files (struct file_data[], int, int *);
 int sip (struct file_data *, int);
 void slurp (struct file_data *);
+void free_file_buffer (struct file_data *);
+int read_file_data (struct file_data *, char HUGE *, unsigned int);
+struct equiv_table *new_equiv_table (void);
+int equiv_table_usable (struct equiv_table const *, int);
+void free_equiv_table (struct equiv_table *);
+int prepare_file (struct prepared_file *, struct equiv_table *, struct file_data const *);
+void prepare_file_pair (struct prepared_file *, struct prepared_file *);
+void free_prepared_file (struct prepared_file *);
 
 /* normal.c */
 void print_normal_script (struct change *);
@@ -385,12 +437,31 @@ void cleanup_file_buffers(struct file_data fd[]);
 /* version.c */
 extern char const version_string[];
 
+/* mapfile.cpp */
+/* Files at least this large are mapped by read_files(), smaller files are
+   read, mapping them costs more than it saves.  */
+#define MIN_MAPPED_FILE_SIZE (1024 * 1024)
+char *map_file (int desc, size_t size, size_t extra, size_t *mapped_size);
+void unmap_file (char *buffer, size_t mapped_size);
+#ifndef _WIN32
+/* Pages of a guarded mapping that a truncation of its file cut off read
+   as newlines instead of raising SIGBUS.  */
+int guard_mapping (char *start, size_t len);
+void unguard_mapping (char *start);
+#endif
+
 #ifdef _WIN32
 /* mystat.cpp */
 int myfstat(int fd, struct _stat64 *buf);
 int mywstat(const wchar_t *filename, struct _stat64 *buf);
 #else
+/* <strings.h>, which system.h can't include after defining bzero() */
+int strcasecmp(const char *s1, const char *s2);
 #define myfstat fstat
+#define _read read
+#define _stricmp strcasecmp
+#define sprintf_s snprintf
+#define ctime_s(buf, size, time) ctime_r(time, buf)
 #endif
 
 #ifdef __cplusplus
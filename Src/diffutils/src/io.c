@@ -18,7 +18,9 @@ along with GNU DIFF; see the file COPYING.  If not, write to
 the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
 
 #include "diff.h"
-#include <io.h>
+#ifdef _WIN32
+#  include <io.h>
+#endif
 #include <assert.h>
 
 /* Rotate a value n bits to the left. */
@@ -77,6 +79,7 @@ static DECL_TLS int equivs_alloc;
 
 static void find_and_hash_each_line (struct file_data *);
 static void find_identical_ends (struct file_data[]);
+static int use_prepared_lines (struct file_data[]);
 static char *prepare_text_end (struct file_data *, short);
 static enum UNICODESET get_unicode_signature(struct file_data *, int *pBomsize);
 
@@ -132,6 +135,23 @@ static enum UNICODESET get_unicode_signature(struct file_data *current, int *pBo
   return NONE;
 }
 
+/* WinMerge: Read up to NBYTES of the current file into BUF, from the
+   preloaded content if there is some, otherwise from the file descriptor.
+   Return the number of bytes read, 0 at end of file or -1 on error.  */
+
+int
+read_file_data (struct file_data *current, char HUGE *buf, unsigned int nbytes)
+{
+  if (current->preloaded == NULL)
+    return _read (current->desc, buf, nbytes);
+  FSIZE left = current->preloaded_size - current->preloaded_pos;
+  if (nbytes > left)
+    nbytes = (unsigned int) left;
+  memcpy (buf, current->preloaded + current->preloaded_pos, nbytes);
+  current->preloaded_pos += nbytes;
+  return (int) nbytes;
+}
+
 /* Get ready to read the current file.
    Return nonzero if SKIP_TEST is zero,
    and if it appears to be a binary file.  */
@@ -164,7 +184,7 @@ sip (struct file_data *current, int skip_test)
       else
         {
           /* Check first part of file to see if it's a binary file.  */
-          current->buffered_chars = _read (current->desc,
+          current->buffered_chars = read_file_data (current,
             current->buffer,
             (unsigned int)current->buffered_chars);
           if (current->buffered_chars == -1)
@@ -227,7 +247,7 @@ slurp (struct file_data *current)
           unsigned int bytes_to_read = min((unsigned int)(current->bufsize - current->buffered_chars), INT_MAX);
           if (bytes_to_read == 0)
             break;
-          cc = _read (current->desc,
+          cc = read_file_data (current,
                       current->buffer + current->buffered_chars,
                       bytes_to_read);
           if (cc == 0)
@@ -250,12 +270,177 @@ slurp (struct file_data *current)
     }
 }
 
+/* WinMerge: Map the current file instead of slurping it, if it is a large
+   regular file whose text is compared as is, that is without transcoding
+   to UTF-8.  The mapping is private, the newline and the sentinels
+   prepare_text_end() and find_identical_ends() put after the text, and the
+   EOLs mapped for ignore_eol_diff, only copy the pages they change.
+   Return nonzero if the file was mapped.  */
+
+static int
+map_file_data (struct file_data *current)
+{
+  FSIZE size = (FSIZE) current->stat.st_size;
+  FSIZE mapped_size;
+  char HUGE *mapped;
+  char HUGE *buffer = current->buffer;
+  FSIZE buffered_chars = current->buffered_chars;
+  enum UNICODESET sig;
+
+  if (current->desc < 0 || current->preloaded != NULL || !S_ISREG (current->stat.st_mode)
+      || (!always_text_flag && current->buffered_chars == 0)
+      || size < MIN_MAPPED_FILE_SIZE)
+    return 0;
+  mapped = map_file (current->desc, size, sizeof (word) + 1, &mapped_size);
+  if (mapped == NULL)
+    return 0;
+
+  current->buffer = mapped;
+  current->buffered_chars = size;
+  sig = get_unicode_signature (current, NULL);
+  if (sig != NONE && sig != UTF8)
+    {
+      unmap_file (mapped, mapped_size);
+      current->buffer = buffer;
+      current->buffered_chars = buffered_chars;
+      return 0;
+    }
+  free (buffer);
+  current->bufsize = mapped_size;
+  current->mapped_size = mapped_size;
+  return 1;
+}
+
+/* Release the buffer of the current file, allocated or mapped.  */
+
+void
+free_file_buffer (struct file_data *current)
+{
+  if (current->mapped_size != 0)
+    unmap_file (current->buffer, current->mapped_size);
+  else
+    free (current->buffer);
+  current->buffer = NULL;
+  current->mapped_size = 0;
+}
+
 static int
 ISWSPACE (char ch)
 {
   return ch==' ' || ch=='\t';
 }
 
+/* Compute the hash of the line starting at P according to the options,
+   and return the start of the next line.  */
+static unsigned char const HUGE *
+hash_line (unsigned char const HUGE *p, unsigned *hash)
+{
+  unsigned h = 0;
+  unsigned char c;
+
+  /* Hash this line until we find a newline. */
+  if (ignore_case_flag)
+    {
+      if (ignore_all_space_flag)
+        while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
+          {
+            if (ignore_numbers_flag && isdigit(c))
+                continue;
+            if (! ISWSPACE (c))
+              h = HASH (h, isupper (c) ? tolower (c) : c);
+          }
+      else if (ignore_space_change_flag)
+        /* Note that \r must be hashed (if !ignore_eol_diff) */
+        while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
+          {
+            if (ISWSPACE (c))
+              {
+                /* skip whitespace after whitespace */
+                while (ISWSPACE (c = *p++))
+                  ;
+                if (c == '\n')
+                  {
+                    goto hashing_done; /* never hash trailing \n */
+                  }
+                else if (c != '\r')
+                  {
+              /* runs of whitespace not ending line hashed as one space */
+                    h = HASH (h, ' ');
+                  }
+              }
+
+            /* c is now the first non-space.  */
+
+            if (ignore_numbers_flag && isdigit(c))
+                continue;
+
+            /* c can be a \r (CR) if !ignore_eol_diff */
+            h = HASH (h, isupper (c) ? tolower (c) : c);
+            if (c == '\r' && *p != '\n')
+              goto hashing_done;
+          }
+      else
+        while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
+          {
+            if (ignore_numbers_flag && isdigit(c))
+                continue;
+
+            h = HASH (h, isupper (c) ? tolower (c) : c);
+          }
+    }
+  else
+    {
+      if (ignore_all_space_flag)
+        while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
+          {
+            if (ignore_numbers_flag && isdigit(c))
+                continue;
+
+            if (! ISWSPACE (c))
+              h = HASH (h, c);
+          }
+      else if (ignore_space_change_flag)
+        /* Note that \r must be hashed (if !ignore_eol_diff) */
+        while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
+          {
+            if (ISWSPACE (c))
+              {
+                /* skip whitespace after whitespace */
+                while (ISWSPACE (c = *p++))
+                  ;
+                if (c == '\n')
+                  {
+                    goto hashing_done; /* never hash trailing \n */
+                  }
+                else if (c != '\r')
+                  {
+              /* runs of whitespace not ending line hashed as one space */
+                    h = HASH (h, ' ');
+                  }
+              }
+            /* c is now the first non-space.  */
+            if (ignore_numbers_flag && isdigit(c))
+                continue;
+
+            /* c can be a \r (CR) if !ignore_eol_diff */
+            h = HASH (h, c);
+            if (c == '\r' && *p != '\n')
+              goto hashing_done;
+          }
+      else
+        while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
+          {
+            if (ignore_numbers_flag && isdigit(c))
+                continue;
+
+            h = HASH (h, c);
+          }
+    }
+hashing_done:
+  *hash = h;
+  return p;
+}
+
 /* Split the file into lines, simultaneously computing the equivalence class for
    each line. */
 static void
@@ -263,7 +448,6 @@ find_and_hash_each_line (struct file_data *current)
 {
   unsigned h;
   unsigned char const HUGE *p = (unsigned char const HUGE *) current->prefix_end;
-  unsigned char c;
   int i, *bucket;
   size_t length;
 
@@ -292,111 +476,9 @@ find_and_hash_each_line (struct file_data *current)
 
       /* Compute the equivalence class (hash) for this line.  */
 
-      h = 0;
-
-
-      /* loops advance pointer to eol (end of line)
+      /* advance pointer to eol (end of line)
          respecting UNIX (\r), MS-DOS/Windows (\r\n), and MAC (\r) eols */
-
-      /* Hash this line until we find a newline. */
-      if (ignore_case_flag)
-        {
-          if (ignore_all_space_flag)
-            while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
-              {
-                if (ignore_numbers_flag && isdigit(c))
-                    continue;
-                if (! ISWSPACE (c))
-                  h = HASH (h, isupper (c) ? tolower (c) : c);
-              }
-          else if (ignore_space_change_flag)
-            /* Note that \r must be hashed (if !ignore_eol_diff) */
-            while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
-              {
-                if (ISWSPACE (c))
-                  {
-                    /* skip whitespace after whitespace */
-                    while (ISWSPACE (c = *p++))
-                      ;
-                    if (c == '\n')
-                      {
-                        goto hashing_done; /* never hash trailing \n */
-                      }
-                    else if (c != '\r')
-                      {
-                  /* runs of whitespace not ending line hashed as one space */
-                        h = HASH (h, ' ');
-                      }
-                  }
-
-                /* c is now the first non-space.  */
-
-                if (ignore_numbers_flag && isdigit(c))
-                    continue;
-
-                /* c can be a \r (CR) if !ignore_eol_diff */
-                h = HASH (h, isupper (c) ? tolower (c) : c);
-                if (c == '\r' && *p != '\n')
-                  goto hashing_done;
-              }
-          else
-            while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
-              {
-                if (ignore_numbers_flag && isdigit(c))
-                    continue;
-
-                h = HASH (h, isupper (c) ? tolower (c) : c);
-              }
-        }
-      else
-        {
-          if (ignore_all_space_flag)
-            while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
-              {
-                if (ignore_numbers_flag && isdigit(c))
-                    continue;
-
-                if (! ISWSPACE (c))
-                  h = HASH (h, c);
-              }
-          else if (ignore_space_change_flag)
-            /* Note that \r must be hashed (if !ignore_eol_diff) */
-            while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
-              {
-                if (ISWSPACE (c))
-                  {
-                    /* skip whitespace after whitespace */
-                    while (ISWSPACE (c = *p++))
-                      ;
-                    if (c == '\n')
-                      {
-                        goto hashing_done; /* never hash trailing \n */
-                      }
-                    else if (c != '\r')
-                      {
-                  /* runs of whitespace not ending line hashed as one space */
-                        h = HASH (h, ' ');
-                      }
-                  }
-                /* c is now the first non-space.  */
-                if (ignore_numbers_flag && isdigit(c))
-                    continue;
-
-                /* c can be a \r (CR) if !ignore_eol_diff */
-                h = HASH (h, c);
-                if (c == '\r' && *p != '\n')
-                  goto hashing_done;
-              }
-          else
-            while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
-              {
-                if (ignore_numbers_flag && isdigit(c))
-                    continue;
-
-                h = HASH (h, c);
-              }
-        }
-hashing_done:;
+      p = hash_line (p, &h);
 
       bucket = &buckets[h % nbuckets];
       length = (char const HUGE *) p - ip - ((char const HUGE *) p == incomplete_tail);
@@ -686,11 +768,16 @@ prepare_text_end (struct file_data *current, short side)
 
 	current->buffered_chars = buffered_chars;
 
-	/* Count line endings and map them to '\n' if ignore_eol_diff is set. */
+	/* Count line endings and map them to '\n' if ignore_eol_diff is set.
+	   Bytes which don't move aren't written, a mapped buffer stays shared
+	   with the file.  */
 	t = q0 = p + buffered_chars;
 	while (q0 > r)
 	{
-		switch (*--t = *--q0)
+		char ch = *--q0;
+		if (--t != q0)
+			*t = ch;
+		switch (ch)
 		{
 		case '\r':
 			++current->count_crs;
@@ -741,18 +828,22 @@ find_identical_ends (struct file_data filevec[])
 
   if (filevec[0].desc != filevec[1].desc)
     {
-      slurp (&filevec[0]);
+      if (!map_file_data (&filevec[0]))
+        slurp (&filevec[0]);
       buffer0 = prepare_text_end (&filevec[0], 0);
-      slurp (&filevec[1]);
+      if (!map_file_data (&filevec[1]))
+        slurp (&filevec[1]);
       buffer1 = prepare_text_end (&filevec[1], 1);
     }
   else
     {
-      slurp (&filevec[0]);
+      if (!map_file_data (&filevec[0]))
+        slurp (&filevec[0]);
       buffer0 = prepare_text_end (&filevec[0], -1);
       filevec[1].buffer = filevec[0].buffer;
       filevec[1].bufsize = filevec[0].bufsize;
       filevec[1].buffered_chars = filevec[0].buffered_chars;
+      filevec[1].mapped_size = filevec[0].mapped_size;
       buffer1 = buffer0;
     }
 
@@ -1106,6 +1197,9 @@ read_files (struct file_data filevec[], int pretend_binary, int *bin_file)
       return 0;
     }
 
+  if (use_prepared_lines (filevec))
+    return 0;
+
   equivs_alloc = filevec[0].alloc_lines + filevec[1].alloc_lines + 1;
 #ifdef __MSDOS__
   if ((equivs = (struct equivclass HUGE *) farmalloc ((long) equivs_alloc * sizeof(struct equivclass))) == NULL)
@@ -1135,3 +1229,413 @@ read_files (struct file_data filevec[], int pretend_binary, int *bin_file)
 
   return 0;
 }
+
+/* WinMerge: Equivalence classes shared by prepared files.  Unlike the
+   classes of a single compare above, the table keeps a copy of a line of
+   every class, so that the classes stay valid when the files are
+   prepared again.  */
+struct shared_equivclass
+{
+  int next;		/* Next item in this bucket. */
+  unsigned hash;	/* Hash of lines in this class.  */
+  FSIZE line;		/* Offset of a line that fits this class in lines. */
+  size_t length;	/* The length of that line.  */
+};
+
+struct equiv_table
+{
+  unsigned options;	/* Options the classes were computed with.  */
+  int *buckets;		/* Hash-table of the classes.  */
+  int nbuckets;
+  struct shared_equivclass *equivs;
+  int equivs_index;	/* Index of first free element in equivs.  */
+  int equivs_alloc;
+  char *lines;		/* Copies of the lines of the classes.  */
+  FSIZE lines_used;
+  FSIZE lines_alloc;
+};
+
+/* Return the options that affect the equivalence classes of lines.  */
+static unsigned
+equiv_options (void)
+{
+  return (ignore_case_flag != 0)
+    | (ignore_all_space_flag != 0) << 1
+    | (ignore_space_change_flag != 0) << 2
+    | (ignore_numbers_flag != 0) << 3
+    | (ignore_eol_diff != 0) << 4
+    | (length_varies != 0) << 5
+    | (ROBUST_OUTPUT_STYLE (output_style) != 0) << 6;
+}
+
+/* Create an empty table of classes for the current options.  */
+struct equiv_table *
+new_equiv_table (void)
+{
+  struct equiv_table *t = (struct equiv_table *) xmalloc (sizeof (*t));
+
+  t->options = equiv_options ();
+  t->nbuckets = primes[0];
+  t->buckets = (int *) xmalloc (t->nbuckets * sizeof (*t->buckets));
+  bzero (t->buckets, t->nbuckets * sizeof (*t->buckets));
+  t->equivs_alloc = 1024;
+  t->equivs = (struct shared_equivclass *) xmalloc (t->equivs_alloc * sizeof (*t->equivs));
+  /* Class 0 stands for lines that were not hashed.  */
+  t->equivs_index = 1;
+  t->lines_alloc = 65536;
+  t->lines = (char *) xmalloc (t->lines_alloc);
+  t->lines_used = 0;
+  return t;
+}
+
+/* Return nonzero if the classes of T are valid for the current options,
+   and the table isn't mostly made of classes of lines that were changed
+   since, given that the prepared files using T have LINES lines.  */
+int
+equiv_table_usable (struct equiv_table const *t, int lines)
+{
+  return t->options == equiv_options ()
+    && t->equivs_index <= 2 * lines + 65536;
+}
+
+void
+free_equiv_table (struct equiv_table *t)
+{
+  if (t == NULL)
+    return;
+  free (t->buckets);
+  free (t->equivs);
+  free (t->lines);
+  free (t);
+}
+
+/* Return the class of the LENGTH bytes long line at LINE with hash H,
+   adding a new class to T if no line of T matches.  */
+static int
+shared_equiv_class (struct equiv_table *t, char const HUGE *line, size_t length, unsigned h)
+{
+  struct shared_equivclass *eq;
+  int *bucket = &t->buckets[h % t->nbuckets];
+  int i;
+
+  for (i = *bucket;  i;  i = t->equivs[i].next)
+    if (t->equivs[i].hash == h
+        && (t->equivs[i].length == length || length_varies)
+        && ! line_cmp (t->lines + t->equivs[i].line, t->equivs[i].length, line, length))
+      return i;
+
+  if (t->equivs_index == t->equivs_alloc)
+    t->equivs = (struct shared_equivclass *)
+      xrealloc (t->equivs, (t->equivs_alloc *= 2) * sizeof (*t->equivs));
+  if (t->lines_used + length > t->lines_alloc)
+    {
+      while (t->lines_used + length > t->lines_alloc)
+        t->lines_alloc *= 2;
+      t->lines = (char *) xrealloc (t->lines, t->lines_alloc);
+    }
+  memcpy (t->lines + t->lines_used, line, length);
+
+  i = t->equivs_index++;
+  eq = &t->equivs[i];
+  eq->next = *bucket;
+  eq->hash = h;
+  eq->line = t->lines_used;
+  eq->length = length;
+  *bucket = i;
+  t->lines_used += length;
+
+  /* Keep the chains short: rehash into the next larger prime.  */
+  if (t->equivs_index > 2 * t->nbuckets)
+    {
+      int j;
+      for (j = 0;  primes[j] && primes[j] <= t->nbuckets;  j++)
+        ;
+      if (primes[j])
+        {
+          t->nbuckets = primes[j];
+          t->buckets = (int *) xrealloc (t->buckets, t->nbuckets * sizeof (*t->buckets));
+          bzero (t->buckets, t->nbuckets * sizeof (*t->buckets));
+          for (j = 1;  j < t->equivs_index;  j++)
+            {
+              bucket = &t->buckets[t->equivs[j].hash % t->nbuckets];
+              t->equivs[j].next = *bucket;
+              *bucket = j;
+            }
+        }
+    }
+  return i;
+}
+
+/* Return the number of bytes at the start of A and B that are identical.  */
+static FSIZE
+common_prefix (char const HUGE *a, char const HUGE *b, FSIZE n)
+{
+  FSIZE i = 0;
+  while (i + 4096 <= n && memcmp (a + i, b + i, 4096) == 0)
+    i += 4096;
+  while (i < n && a[i] == b[i])
+    ++i;
+  return i;
+}
+
+/* Return the number of bytes at the end of A and B, which end at offset
+   N and M, that are identical, but at most LIMIT.  */
+static FSIZE
+common_suffix (char const HUGE *a, FSIZE n, char const HUGE *b, FSIZE m, FSIZE limit)
+{
+  FSIZE i = 0;
+  while (i + 4096 <= limit && memcmp (a + n - i - 4096, b + m - i - 4096, 4096) == 0)
+    i += 4096;
+  while (i < limit && a[n - i - 1] == b[m - i - 1])
+    ++i;
+  return i;
+}
+
+/* Return the index of the line of PF containing the byte at OFFSET.  */
+static int
+prepared_line_at (struct prepared_file const *pf, FSIZE offset)
+{
+  int lo = 0, hi = pf->lines;
+  while (hi - lo > 1)
+    {
+      int mid = lo + (hi - lo) / 2;
+      if (pf->line_offsets[mid] <= offset)
+        lo = mid;
+      else
+        hi = mid;
+    }
+  return lo;
+}
+
+/* Read the file of FD, from its current position or its preloaded
+   content, into PF, and split it into lines.  If PF holds the file as it
+   was prepared before with the same table T, the lines at the start and
+   the end that didn't change keep their classes; the others get classes
+   when prepare_file_pair() needs them.  Return 0 if the file is binary
+   or not a regular file; PF is then empty.  */
+int
+prepare_file (struct prepared_file *pf, struct equiv_table *t, struct file_data const *fd)
+{
+  struct file_data cur;
+  char const HUGE *text;
+  char const HUGE *p;
+  FSIZE size, prefix = 0, suffix = 0, offset;
+  int lines = 0, alloc_lines, old_line;
+  FSIZE *offsets;
+  int *eqs;
+
+  bzero (&cur, sizeof (cur));
+  cur.desc = fd->desc;
+  cur.name = fd->name;
+  cur.stat = fd->stat;
+  cur.preloaded = fd->preloaded;
+  cur.preloaded_size = fd->preloaded_size;
+
+  if (cur.desc < 0 || !S_ISREG (cur.stat.st_mode) || sip (&cur, 0))
+    {
+      free (cur.buffer);
+      free_prepared_file (pf);
+      return 0;
+    }
+  slurp (&cur);
+  text = prepare_text_end (&cur, 0);
+  size = cur.buffer + cur.buffered_chars - text;
+
+  if (pf->text != NULL && pf->table == t)
+    {
+      prefix = common_prefix (text, pf->text, min (size, pf->size));
+      if (pf->missing_newline == cur.missing_newline)
+        suffix = common_suffix (text, size, pf->text, pf->size, min (size, pf->size) - prefix);
+    }
+  else
+    free_prepared_file (pf);
+
+  alloc_lines = pf->lines + 2;
+  offsets = (FSIZE *) xmalloc (alloc_lines * sizeof (*offsets));
+  eqs = (int *) xmalloc (alloc_lines * sizeof (*eqs));
+
+  /* Lines ending before the last byte of the unchanged prefix.  */
+  for (old_line = 0;  old_line < pf->lines && pf->line_offsets[old_line + 1] < prefix;  ++old_line)
+    {
+      offsets[lines] = pf->line_offsets[old_line];
+      eqs[lines++] = pf->equivs[old_line];
+    }
+
+  /* Changed lines, up to a line starting within the unchanged suffix.  */
+  p = text + (lines ? pf->line_offsets[lines] : 0);
+  old_line = -1;
+  while (p < text + size)
+    {
+      if (lines + 1 >= alloc_lines)
+        {
+          alloc_lines *= 2;
+          offsets = (FSIZE *) xrealloc (offsets, alloc_lines * sizeof (*offsets));
+          eqs = (int *) xrealloc (eqs, alloc_lines * sizeof (*eqs));
+        }
+      offsets[lines] = p - text;
+      eqs[lines++] = 0;
+      while (p[0] != '\n' && (p[0] != '\r' || p[1] == '\n'))
+        ++p;
+      ++p;
+      offset = p - text;
+      if (offset - 1 >= size - suffix && offset < size)
+        {
+          old_line = prepared_line_at (pf, offset - size + pf->size);
+          if (pf->line_offsets[old_line] == offset - size + pf->size)
+            break;
+          old_line = -1;
+        }
+    }
+
+  /* Lines within the unchanged suffix.  */
+  if (old_line >= 0)
+    {
+      int n = pf->lines - old_line;
+      if (lines + n >= alloc_lines)
+        {
+          alloc_lines = lines + n + 1;
+          offsets = (FSIZE *) xrealloc (offsets, alloc_lines * sizeof (*offsets));
+          eqs = (int *) xrealloc (eqs, alloc_lines * sizeof (*eqs));
+        }
+      for (;  old_line < pf->lines;  ++old_line)
+        {
+          offsets[lines] = pf->line_offsets[old_line] - pf->size + size;
+          eqs[lines++] = pf->equivs[old_line];
+        }
+    }
+  offsets[lines] = size;
+
+  free_prepared_file (pf);
+  pf->table = t;
+  pf->buffer = cur.buffer;
+  pf->text = text;
+  pf->size = size;
+  pf->missing_newline = cur.missing_newline;
+  pf->lines = lines;
+  pf->line_offsets = offsets;
+  pf->equivs = eqs;
+  return 1;
+}
+
+/* Give the lines BEGIN to END of PF a class.  */
+static void
+hash_prepared_lines (struct prepared_file *pf, int begin, int end)
+{
+  char const HUGE *incomplete_tail
+    = pf->missing_newline && ROBUST_OUTPUT_STYLE (output_style)
+      ? pf->text + pf->size : (char const HUGE *) NULL;
+  int i;
+
+  for (i = begin;  i < end;  ++i)
+    if (!pf->equivs[i])
+      {
+        char const HUGE *ip = pf->text + pf->line_offsets[i];
+        unsigned h;
+        char const HUGE *p = (char const HUGE *) hash_line ((unsigned char const HUGE *) ip, &h);
+        size_t length = p - ip - (p == incomplete_tail);
+        pf->equivs[i] = shared_equiv_class (pf->table, ip, length, h);
+        ++pf->hashed_lines;
+      }
+}
+
+/* Give a class to the lines of PF0 and PF1 that read_files() hashes when
+   comparing them, that is all but the identical lines at the start and
+   the end, with a margin of a line.  */
+void
+prepare_file_pair (struct prepared_file *pf0, struct prepared_file *pf1)
+{
+  FSIZE n = min (pf0->size, pf1->size);
+  FSIZE prefix, suffix = 0;
+
+  if (pf0->text == NULL || pf1->text == NULL || pf0->table != pf1->table)
+    return;
+  prefix = common_prefix (pf0->text, pf1->text, n);
+  if (pf0->missing_newline == pf1->missing_newline)
+    suffix = common_suffix (pf0->text, pf0->size, pf1->text, pf1->size, n - prefix);
+  hash_prepared_lines (pf0, max (prepared_line_at (pf0, prefix) - 1, 0),
+                       min (prepared_line_at (pf0, pf0->size - suffix) + 2, pf0->lines));
+  hash_prepared_lines (pf1, max (prepared_line_at (pf1, prefix) - 1, 0),
+                       min (prepared_line_at (pf1, pf1->size - suffix) + 2, pf1->lines));
+}
+
+void
+free_prepared_file (struct prepared_file *pf)
+{
+  free (pf->buffer);
+  free (pf->line_offsets);
+  free (pf->equivs);
+  bzero (pf, sizeof (*pf));
+}
+
+/* Take the lines and classes of the lines to compare from the prepared
+   files, if both files have one with the same text, and the lines have
+   a class.  Return nonzero if done.  */
+static int
+use_prepared_lines (struct file_data filevec[])
+{
+  char const HUGE *text[2];
+  int first[2], end[2];
+  int f, i;
+
+  if (no_diff_means_no_output
+      || filevec[0].prepared == NULL || filevec[1].prepared == NULL
+      || filevec[0].prepared->table != filevec[1].prepared->table)
+    return 0;
+
+  for (f = 0; f < 2; ++f)
+    {
+      struct prepared_file const *pf = filevec[f].prepared;
+      FSIZE suffix_offset;
+
+      if (pf->text == NULL
+          || pf->missing_newline != filevec[f].missing_newline
+          || pf->size > filevec[f].buffered_chars)
+        return 0;
+      text[f] = filevec[f].buffer + filevec[f].buffered_chars - pf->size;
+      if (memcmp (text[f], pf->text, pf->size) != 0)
+        return 0;
+      first[f] = filevec[f].prefix_lines;
+      if (first[f] > pf->lines
+          || pf->line_offsets[first[f]] != (FSIZE) (filevec[f].prefix_end - text[f]))
+        return 0;
+      suffix_offset = filevec[f].suffix_begin - text[f];
+      for (i = first[f];  pf->line_offsets[i] < suffix_offset;  ++i)
+        if (!pf->equivs[i])
+          return 0;
+      if (pf->line_offsets[i] != suffix_offset)
+        return 0;
+      end[f] = i;
+    }
+
+  for (f = 0; f < 2; ++f)
+    {
+      struct file_data *current = &filevec[f];
+      struct prepared_file const *pf = current->prepared;
+      int lines = pf->lines - first[f];
+      char const HUGE **linbuf = current->linbuf;
+      int linbuf_base = current->linbuf_base;
+      int alloc_lines = current->alloc_lines;
+
+      /* Record one more line start than lines, like find_and_hash_each_line.  */
+      if (alloc_lines <= lines)
+        {
+          alloc_lines = lines + 1;
+          linbuf = (char const HUGE **) xrealloc ((void *)(linbuf + linbuf_base),
+                     (alloc_lines - linbuf_base) * sizeof (*linbuf))
+             - linbuf_base;
+        }
+      for (i = 0;  i <= lines;  ++i)
+        linbuf[i] = text[f] + pf->line_offsets[first[f] + i];
+      if (current->missing_newline && ROBUST_OUTPUT_STYLE (output_style))
+        --linbuf[lines];
+
+      current->equivs = (int *) xmalloc (alloc_lines * sizeof (int));
+      memcpy (current->equivs, pf->equivs + first[f], (end[f] - first[f]) * sizeof (int));
+      current->linbuf = linbuf;
+      current->alloc_lines = alloc_lines;
+      current->buffered_lines = end[f] - first[f];
+      current->valid_lines = lines;
+      current->equiv_max = pf->table->equivs_index;
+    }
+  return 1;
+}
@@ -0,0 +1,166 @@
+// Private file mappings for read_files(), so large text files are compared
+// in place instead of being copied into an allocated buffer.
+#include "pch.h"
+#include <cstddef>
+#include <cstdint>
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static size_t page_size()
+{
+#ifdef _WIN32
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	return si.dwPageSize;
+#else
+	return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+#ifndef _WIN32
+// Windows refuses to truncate a file while a view of it is mapped, other
+// systems raise SIGBUS when a page past the new end of the file is read.
+// The mappings are registered here, so that the SIGBUS handler, which
+// can't lock, tells them from other faults.
+static const int MaxGuardedMappings = 64;
+static std::atomic<char *> guarded_start[MaxGuardedMappings];
+static std::atomic<size_t> guarded_len[MaxGuardedMappings];
+static std::mutex guarded_mutex;
+static size_t guarded_page_size;
+static struct sigaction previous_sigbus;
+
+/**
+ * A page of a mapping that its truncated file no longer backs is replaced
+ * by a page of newlines: the truncation drops the newline and sentinels
+ * diffutils put after the text too, and the scans for the end of a line
+ * have to stop. The compare goes on with the stale text, the next rescan
+ * reads the file as it is now. Other faults go to the handler installed
+ * before.
+ */
+static void sigbus_handler(int sig, siginfo_t *info, void *context)
+{
+	char *addr = static_cast<char *>(info->si_addr);
+	for (int i = 0; i < MaxGuardedMappings; ++i)
+	{
+		char *start = guarded_start[i].load();
+		if (start != nullptr && addr >= start && addr < start + guarded_len[i].load())
+		{
+			char *page = start + (addr - start) / guarded_page_size * guarded_page_size;
+			if (mmap(page, guarded_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+				break;
+			memset(page, '\n', guarded_page_size);
+			return;
+		}
+	}
+	if (previous_sigbus.sa_flags & SA_SIGINFO)
+		previous_sigbus.sa_sigaction(sig, info, context);
+	else if (previous_sigbus.sa_handler != SIG_DFL && previous_sigbus.sa_handler != SIG_IGN)
+		previous_sigbus.sa_handler(sig);
+	else
+		sigaction(SIGBUS, &previous_sigbus, nullptr); // The fault happens again, unhandled
+}
+
+/** Register a mapping with the SIGBUS handler, 0 if there are too many. */
+extern "C" int guard_mapping(char *start, size_t len)
+{
+	static std::once_flag installed;
+	std::call_once(installed, []()
+		{
+			guarded_page_size = page_size();
+			struct sigaction sa = {};
+			sa.sa_sigaction = sigbus_handler;
+			sa.sa_flags = SA_SIGINFO;
+			sigemptyset(&sa.sa_mask);
+			sigaction(SIGBUS, &sa, &previous_sigbus);
+		});
+	std::lock_guard<std::mutex> lock(guarded_mutex);
+	for (int i = 0; i < MaxGuardedMappings; ++i)
+	{
+		if (guarded_start[i].load() == nullptr)
+		{
+			guarded_len[i].store(len);
+			guarded_start[i].store(start);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+extern "C" void unguard_mapping(char *start)
+{
+	std::lock_guard<std::mutex> lock(guarded_mutex);
+	for (int i = 0; i < MaxGuardedMappings; ++i)
+	{
+		if (guarded_start[i].load() == start)
+			guarded_start[i].store(nullptr);
+	}
+}
+#endif
+
+/**
+ * Map the first SIZE bytes of the file DESC copy-on-write, the file itself
+ * is never written. The EXTRA bytes after the text must fit in the zero
+ * filled rest of the last page, diffutils puts a newline and sentinels
+ * there. Return NULL if the file can't be mapped that way, otherwise the
+ * mapping, and its size in MAPPED_SIZE.
+ */
+extern "C" char *map_file(int desc, size_t size, size_t extra, size_t *mapped_size)
+{
+	const size_t page = page_size();
+	const size_t len = (size + page - 1) / page * page;
+	if (size == 0 || len - size < extra)
+		return nullptr;
+#ifdef _WIN32
+	HANDLE hFile = reinterpret_cast<HANDLE>(_get_osfhandle(desc));
+	if (hFile == INVALID_HANDLE_VALUE)
+		return nullptr;
+	LARGE_INTEGER fileSize;
+	// The file changed since it was opened, read it instead
+	if (!GetFileSizeEx(hFile, &fileSize) || static_cast<uint64_t>(fileSize.QuadPart) != size)
+		return nullptr;
+	HANDLE hMapping = CreateFileMapping(hFile, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if (hMapping == nullptr)
+		return nullptr;
+	// The view keeps the mapping object alive
+	void *p = MapViewOfFile(hMapping, FILE_MAP_COPY, 0, 0, size);
+	CloseHandle(hMapping);
+	if (p == nullptr)
+		return nullptr;
+#else
+	// The file changed since it was opened, read it instead
+	struct stat st;
+	if (fstat(desc, &st) != 0 || static_cast<size_t>(st.st_size) != size)
+		return nullptr;
+	void *p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, desc, 0);
+	if (p == MAP_FAILED)
+		return nullptr;
+	// Unless a truncation of the file can't crash, read it instead
+	if (!guard_mapping(static_cast<char *>(p), len))
+	{
+		munmap(p, len);
+		return nullptr;
+	}
+#endif
+	*mapped_size = len;
+	return static_cast<char *>(p);
+}
+
+extern "C" void unmap_file(char *buffer, size_t mapped_size)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(buffer);
+#else
+	unguard_mapping(buffer);
+	munmap(buffer, mapped_size);
+#endif
+}
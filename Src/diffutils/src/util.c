@@ -17,7 +17,9 @@ You should have received a copy of the GNU General Public License
 along with GNU DIFF; see the file COPYING.  If not, write to
 the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
 
-#include <windows.h>
+#ifdef _WIN32
+#  include <windows.h>
+#endif
 #include "diff.h"
 
 /* Queue up one-line messages to be printed at the end,
@@ -64,7 +66,11 @@ pfatal_with_name (char const *text)
   errno = e;
   perror (text);
   //exit (2);
+#ifdef _WIN32
   RaiseException(STATUS_ACCESS_VIOLATION, 0, 0, NULL);
+#else
+  abort ();
+#endif
 }
 
 /* Print an error message from the format-string FORMAT
@@ -86,7 +92,11 @@ fatal (char const *m)
   print_message_queue ();
   error ("%s", m, 0);
   //exit (2);
+#ifdef _WIN32
   RaiseException(STATUS_ACCESS_VIOLATION, 0, 0, NULL);
+#else
+  abort ();
+#endif
 }
 
 /* Like printf, except if -l in effect then save the message and print later.
@@ -875,15 +885,15 @@ analyze_hunk (struct change *hunk,
 
 /* malloc a block of memory, with fatal error message if we can't do it. */
 
-VOID *
+void *
 xmalloc (size_t size)
 {
-  register VOID *value;
+  register void *value;
 
   if (size == 0)
     size = 1;
 
-  value = (VOID *) malloc (size);
+  value = (void *) malloc (size);
 
   if (!value)
 #ifdef __MSDOS__
@@ -896,15 +906,15 @@ xmalloc (size_t size)
 
 /* realloc a block of memory, with fatal error message if we can't do it. */
 
-VOID *
-xrealloc (VOID *old, size_t size)
+void *
+xrealloc (void *old, size_t size)
 {
-  register VOID *value;
+  register void *value;
 
   if (size == 0)
     size = 1;
 
-  value = (VOID *) realloc (old, size);
+  value = (void *) realloc (old, size);
 
   if (!value)
 #ifdef __MSDOS__
@@ -101,6 +101,20 @@ DATE:		BY:					DESCRIPTION:
 #define HIBYTE(w)           ((unsigned char)((unsigned)(w) >> 8))
 #endif
 
+#ifndef _WIN32
+static int _memicmp(const void *buf1, const void *buf2, size_t count)
+{
+	const unsigned char *p = static_cast<const unsigned char *>(buf1);
+	const unsigned char *q = static_cast<const unsigned char *>(buf2);
+	for (; count; --count, ++p, ++q)
+	{
+		if (int d = tolower(*p) - tolower(*q))
+			return d;
+	}
+	return 0;
+}
+#endif
+
 using Poco::ByteOrder;
 using Poco::NumberParser;
 using Poco::SharedMemory;
@@ -191,7 +205,7 @@ std::string CMarkdown::Entities(const std::string& v)
 	char *p, *q = &ret[0];
 	while (*(p = q))
 	{
-		char *value = nullptr;
+		const char *value = nullptr;
 		switch (*p)
 		{
 		case '&': value = "&amp;"; break;
@@ -885,7 +899,7 @@ CMarkdown::FileImage::FileImage(const tchar_t *path, size_t trunc, unsigned flag
 				delete m_pSharedMemory;
 				m_pSharedMemory = nullptr;
 				pImage = pCopy2;
-				delete [] pCopy;
+				delete [] static_cast<unsigned char *>(pCopy);
 				pCopy = pCopy2;
 			}
 			break;
@@ -896,5 +910,5 @@ CMarkdown::FileImage::FileImage(const tchar_t *path, size_t trunc, unsigned flag
 CMarkdown::FileImage::~FileImage()
 {
 	delete m_pSharedMemory;
-	delete [] pCopy;
+	delete [] static_cast<unsigned char *>(pCopy);
 }
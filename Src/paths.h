@@ -25,8 +25,8 @@ typedef enum
 	IS_EXISTING_DIR, /**< It is existing folder */
 } PATH_EXISTENCE;
 
-constexpr tchar_t* NATIVE_NULL_DEVICE_NAME = _T("NUL");
-constexpr tchar_t* NATIVE_NULL_DEVICE_NAME_LONG = _T("\\\\.\\NUL");
+constexpr const tchar_t* NATIVE_NULL_DEVICE_NAME = _T("NUL");
+constexpr const tchar_t* NATIVE_NULL_DEVICE_NAME_LONG = _T("\\\\.\\NUL");
 
 bool EndsWithSlash(const String& s);
 
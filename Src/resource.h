@@ -2057,6 +2057,7 @@
 #define IDS_DIFF_ALGORITHM_PATIENCE     43702
 #define IDS_DIFF_ALGORITHM_HISTOGRAM    43703
 #define IDS_DIFF_ALGORITHM_NONE         43704
+#define IDS_DIFF_ALGORITHM_STREAMING    43705
 #define IDS_RENDERING_MODE_GDI          43710
 #define IDS_RENDERING_MODE_DIRECTWRITE_DEFAULT 43711
 #define IDS_RENDERING_MODE_DIRECTWRITE_ALIASED 43712
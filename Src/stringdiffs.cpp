@@ -8,9 +8,13 @@
 #include "pch.h"
 #include "stringdiffs.h"
 #define NOMINMAX
+#ifdef _WIN32
 #include <windows.h>
+#endif
 #include <cassert>
 #include <chrono>
+#include <cmath>
+#include <type_traits>
 #include "CompareOptions.h"
 #include "stringdiffsi.h"
 #include "Diff3.h"
@@ -23,10 +27,20 @@ namespace strdiff
 static tchar_t *BreakChars = nullptr;
 static tchar_t BreakCharDefaults[] = _T(",.;:");
 static const int TimeoutMilliSeconds = 500;
+// onp() keeps an edit script per diagonal, longer lines use myers()
+#ifdef _WIN64
+static const size_t MaxWordsONP = 20480;
+#else
+static const size_t MaxWordsONP = 2048;
+#endif
 
 static bool isSafeWhitespace(tchar_t ch);
 static bool isWordBreak(int breakType, const tchar_t *str, int index);
 
+/** @brief Text for the break iterators, UTF-16 or UTF-8 depending on tchar_t. */
+static inline const UChar *BreakText(const wchar_t *str) { return reinterpret_cast<const UChar *>(str); }
+static inline const char *BreakText(const char *str) { return str; }
+
 void Init()
 {
 	BreakChars = BreakCharDefaults;
@@ -51,12 +65,95 @@ void SetBreakChars(const tchar_t *breakChars)
 	BreakChars = tc::tcsdup(breakChars);
 }
 
+/**
+ * @brief Buffers of ComputeWordDiffs() calls without an arena, one per thread
+ */
+static WordDiffArena& ThreadArena()
+{
+	static thread_local WordDiffArena arena;
+	return arena;
+}
+
+WordDiffArena::WordDiffArena()
+: m_buffers{ std::make_unique<word_buffers>(), std::make_unique<word_buffers>() }
+{
+}
+
+WordDiffArena::~WordDiffArena() = default;
+
+/**
+ * @brief Release the buffers grown by long lines.
+ * Keeps the memory of a few thousand words, enough for the lines of
+ * common text files.
+ */
+void WordDiffArena::Shrink()
+{
+	const size_t MaxKeptElements = 65536;
+	auto shrink = [MaxKeptElements](auto& v)
+	{
+		if (v.capacity() > MaxKeptElements)
+			std::remove_reference_t<decltype(v)>().swap(v);
+	};
+	for (auto& buffers : m_buffers)
+	{
+		shrink(buffers->words1);
+		shrink(buffers->words2);
+		shrink(buffers->wdiffs);
+		shrink(buffers->edscript);
+		shrink(buffers->ses);
+		shrink(buffers->fp);
+		shrink(buffers->es);
+		shrink(buffers->kv);
+		shrink(buffers->parts);
+		shrink(buffers->substr1);
+		shrink(buffers->substr2);
+	}
+	for (auto& diffs : m_diffs)
+		shrink(diffs);
+}
+
 std::vector<wdiff>
 ComputeWordDiffs(const String& str1, const String& str2,
 	bool case_sensitive, EolCompareMode eol_mode, int whitespace, bool ignore_numbers, int breakType, bool byte_level)
 {
-	String strs[3] = {str1, str2, _T("")};
-	return ComputeWordDiffs(2, strs, case_sensitive, eol_mode, whitespace, ignore_numbers, breakType, byte_level);
+	std::vector<wdiff> diffs;
+	WordDiffArena& arena = ThreadArena();
+	ComputeWordDiffs(str1, str2, case_sensitive, eol_mode, whitespace, ignore_numbers, breakType, byte_level, arena, diffs);
+	arena.Shrink();
+	return diffs;
+}
+
+/**
+ * @brief Diff a pair of strings, appending the diffs to @p diffs.
+ */
+static void
+ComputeWordDiffs2(const String& str1, const String& str2,
+	bool case_sensitive, EolCompareMode eol_mode, int whitespace, bool ignore_numbers, int breakType, bool byte_level,
+	word_buffers& buffers, std::vector<wdiff>& diffs)
+{
+	stringdiffs sdiffs(str1, str2, case_sensitive, static_cast<stringdiffs::EolCompareMode>(eol_mode), whitespace, ignore_numbers, breakType, &diffs, buffers);
+	// Hash all words in both lines and then compare them word by word
+	// storing differences into m_wdiffs
+	sdiffs.BuildWordDiffList();
+
+	if (byte_level)
+		sdiffs.wordLevelToByteLevel();
+
+	// Now copy m_wdiffs into caller-supplied m_pDiffs (coalescing adjacents if possible)
+	sdiffs.PopulateDiffs();
+}
+
+/**
+ * @brief Compute the word diffs of two strings in the buffers of @p arena
+ * @param [out] diffs Diffs of the strings, the vector is reused.
+ */
+void
+ComputeWordDiffs(const String& str1, const String& str2,
+	bool case_sensitive, EolCompareMode eol_mode, int whitespace, bool ignore_numbers, int breakType, bool byte_level,
+	WordDiffArena& arena, std::vector<wdiff>& diffs)
+{
+	diffs.clear();
+	ComputeWordDiffs2(str1, str2, case_sensitive, eol_mode, whitespace, ignore_numbers, breakType, byte_level, arena.buffers(0), diffs);
 }
 
 struct Comp02Functor
@@ -95,29 +192,31 @@ ComputeWordDiffs(int nFiles, const String *str,
 	bool case_sensitive, EolCompareMode eol_mode, int whitespace, bool ignore_numbers, int breakType, bool byte_level)
 {
 	std::vector<wdiff> diffs;
+	WordDiffArena& arena = ThreadArena();
+	ComputeWordDiffs(nFiles, str, case_sensitive, eol_mode, whitespace, ignore_numbers, breakType, byte_level, arena, diffs);
+	arena.Shrink();
+	return diffs;
+}
+
+/**
+ * @brief Compute the word diffs of two or three strings in the buffers of @p arena
+ * @param [out] diffs Diffs of the strings, the vector is reused.
+ */
+void
+ComputeWordDiffs(int nFiles, const String *str,
+	bool case_sensitive, EolCompareMode eol_mode, int whitespace, bool ignore_numbers, int breakType, bool byte_level,
+	WordDiffArena& arena, std::vector<wdiff>& diffs)
+{
+	diffs.clear();
 	if (nFiles == 2)
 	{
-		stringdiffs sdiffs(str[0], str[1], case_sensitive, static_cast<stringdiffs::EolCompareMode>(eol_mode), whitespace, ignore_numbers, breakType, &diffs);
-		// Hash all words in both lines and then compare them word by word
-		// storing differences into m_wdiffs
-		sdiffs.BuildWordDiffList();
-
-		if (byte_level)
-			sdiffs.wordLevelToByteLevel();
-
-		// Now copy m_wdiffs into caller-supplied m_pDiffs (coalescing adjacents if possible)
-		sdiffs.PopulateDiffs();
-
+		ComputeWordDiffs2(str[0], str[1], case_sensitive, eol_mode, whitespace, ignore_numbers, breakType, byte_level, arena.buffers(0), diffs);
 	}
 	else
 	{
 		if (str[0].empty())
 		{
-			stringdiffs sdiffs(str[1], str[2], case_sensitive, static_cast<stringdiffs::EolCompareMode>(eol_mode), whitespace, ignore_numbers, breakType, &diffs);
-			sdiffs.BuildWordDiffList();
-			if (byte_level)
-				sdiffs.wordLevelToByteLevel();
-			sdiffs.PopulateDiffs();
+			ComputeWordDiffs2(str[1], str[2], case_sensitive, eol_mode, whitespace, ignore_numbers, breakType, byte_level, arena.buffers(0), diffs);
 			for (size_t i = 0; i < diffs.size(); i++)
 			{
 				wdiff& diff = diffs[i];
@@ -131,11 +230,7 @@ ComputeWordDiffs(int nFiles, const String *str,
 		}
 		else if (str[1].empty())
 		{
-			stringdiffs sdiffs(str[0], str[2], case_sensitive, static_cast<stringdiffs::EolCompareMode>(eol_mode), whitespace, ignore_numbers, breakType, &diffs);
-			sdiffs.BuildWordDiffList();
-			if (byte_level)
-				sdiffs.wordLevelToByteLevel();
-			sdiffs.PopulateDiffs();
+			ComputeWordDiffs2(str[0], str[2], case_sensitive, eol_mode, whitespace, ignore_numbers, breakType, byte_level, arena.buffers(0), diffs);
 			for (size_t i = 0; i < diffs.size(); i++)
 			{
 				wdiff& diff = diffs[i];
@@ -149,11 +244,7 @@ ComputeWordDiffs(int nFiles, const String *str,
 		}
 		else if (str[2].empty())
 		{
-			stringdiffs sdiffs(str[0], str[1], case_sensitive, static_cast<stringdiffs::EolCompareMode>(eol_mode), whitespace, ignore_numbers, breakType, &diffs);
-			sdiffs.BuildWordDiffList();
-			if (byte_level)
-				sdiffs.wordLevelToByteLevel();
-			sdiffs.PopulateDiffs();
+			ComputeWordDiffs2(str[0], str[1], case_sensitive, eol_mode, whitespace, ignore_numbers, breakType, byte_level, arena.buffers(0), diffs);
 			for (size_t i = 0; i < diffs.size(); i++)
 			{
 				wdiff& diff = diffs[i];
@@ -167,27 +258,17 @@ ComputeWordDiffs(int nFiles, const String *str,
 		}
 		else
 		{
-			std::vector<wdiff> diffs10, diffs12;
-			stringdiffs sdiffs10(str[1], str[0], case_sensitive, static_cast<stringdiffs::EolCompareMode>(eol_mode), 0, ignore_numbers, breakType, &diffs10);
-			stringdiffs sdiffs12(str[1], str[2], case_sensitive, static_cast<stringdiffs::EolCompareMode>(eol_mode), 0, ignore_numbers, breakType, &diffs12);
-			// Hash all words in both lines and then compare them word by word
-			// storing differences into m_wdiffs
-			sdiffs10.BuildWordDiffList();
-			sdiffs12.BuildWordDiffList();
-			if (byte_level)
-			{
-				sdiffs10.wordLevelToByteLevel();
-				sdiffs12.wordLevelToByteLevel();
-			}
-			// Now copy m_wdiffs into caller-supplied m_pDiffs (coalescing adjacents if possible)
-			sdiffs10.PopulateDiffs();
-			sdiffs12.PopulateDiffs();
+			std::vector<wdiff>& diffs10 = arena.diffs(0);
+			std::vector<wdiff>& diffs12 = arena.diffs(1);
+			diffs10.clear();
+			diffs12.clear();
+			ComputeWordDiffs2(str[1], str[0], case_sensitive, eol_mode, 0, ignore_numbers, breakType, byte_level, arena.buffers(0), diffs10);
+			ComputeWordDiffs2(str[1], str[2], case_sensitive, eol_mode, 0, ignore_numbers, breakType, byte_level, arena.buffers(1), diffs12);
 
 			Make3wayDiff(diffs, diffs10, diffs12, 
 				Comp02Functor(str, case_sensitive), false);
 		}
 	}
-	return diffs;
 }
 
 int Compare(const String& str1, const String& str2,
@@ -236,7 +317,7 @@ int Compare(const String& str1, const String& str2,
  */
 stringdiffs::stringdiffs(const String & str1, const String & str2,
 	bool case_sensitive, EolCompareMode eol_mode, int whitespace, bool ignore_numbers, int breakType,
-	std::vector<wdiff> * pDiffs)
+	std::vector<wdiff> * pDiffs, word_buffers & buffers)
 : m_str1(str1)
 , m_str2(str2)
 , m_whitespace(whitespace)
@@ -246,7 +327,12 @@ stringdiffs::stringdiffs(const String & str1, const String & str2,
 , m_ignore_numbers(ignore_numbers)
 , m_pDiffs(pDiffs)
 , m_matchblock(true) // Change to false to get word to word compare
+, m_buffers(buffers)
+, m_words1(buffers.words1)
+, m_words2(buffers.words2)
+, m_wdiffs(buffers.wdiffs)
 {
+	m_wdiffs.clear();
 }
 
 /**
@@ -292,12 +378,21 @@ stringdiffs::debugoutput()
 bool
 stringdiffs::BuildWordDiffList_DP()
 {
-	std::vector<char> edscript;
+	std::vector<char>& edscript = m_buffers.edscript;
+	edscript.clear();
 
 	//if (dp(edscript) <= 0)
 	//	return false;
-	if (onp(edscript) < 0)
-		return false;
+	if (m_words1.size() < MaxWordsONP && m_words2.size() < MaxWordsONP)
+	{
+		if (onp(edscript) < 0)
+			return false;
+	}
+	else
+	{
+		if (myers(edscript) < 0)
+			return false;
+	}
 
 	int i = 1, j = 1;
 	for (size_t k = 0; k < edscript.size(); k++)
@@ -390,25 +485,18 @@ stringdiffs::BuildWordDiffList_DP()
 void
 stringdiffs::BuildWordDiffList()
 {
-	m_words1 = BuildWordsArray(m_str1);
-	m_words2 = BuildWordsArray(m_str2);
+	BuildWordsArray(m_str1, m_words1);
+	BuildWordsArray(m_str2, m_words2);
 
-	bool succeeded = false;
-#ifdef _WIN64
-	if (m_words1.size() < 20480 && m_words2.size() < 20480)
-#else
-	if (m_words1.size() < 2048 && m_words2.size() < 2048)
-#endif
-	{
-		succeeded = BuildWordDiffList_DP();
-	}
-	if (!succeeded)
+	if (!BuildWordDiffList_DP())
 	{
+		// Timed out, mark the text between the common prefix and suffix as one change
 		int s1 = m_words1[0].start;
 		int e1 = m_words1[m_words1.size() - 1].end;
 		int s2 = m_words2[0].start;
 		int e2 = m_words2[m_words2.size() - 1].end;
 		m_wdiffs.emplace_back(s1, e1, s2, e2);
+		wordLevelToByteLevel();
 		return;
 	}
 
@@ -416,22 +504,25 @@ stringdiffs::BuildWordDiffList()
 
 /**
  * @brief Break line into constituent words
+ * The words are hashed while the line is scanned, each character once.
  */
-std::vector<stringdiffs::word>
-stringdiffs::BuildWordsArray(const String & str) const
+void
+stringdiffs::BuildWordsArray(const String & str, std::vector<word> & words) const
 {
-	std::vector<word> words = { word(0, -1, 0, 0) }; // dummy;
+	words.clear();
+	words.emplace_back(0, -1, 0, 0); // dummy
 	int i = 0, begin = 0;
-	ICUBreakIterator *pIterChar = ICUBreakIterator::getCharacterBreakIterator(reinterpret_cast<const UChar *>(str.c_str()), static_cast<int32_t>(str.length()));
+	ICUBreakIterator *pIterChar = ICUBreakIterator::getCharacterBreakIterator(BreakText(str.c_str()), static_cast<int32_t>(str.length()));
 
 	size_t sLen = str.length();
 	assert(sLen < INT_MAX);
 
 	if (str.empty())
-		return words;
+		return;
 
 	int break_type = 0;
 	int prev_break_type = 0;
+	unsigned hash = 0;
 	int iLen = static_cast<int>(sLen);
 	for (; i < iLen;)
 	{
@@ -458,9 +549,11 @@ stringdiffs::BuildWordsArray(const String & str) const
 		}
 		if (i > 0 && (break_type != prev_break_type || break_type == dlbreak || (prev_break_type == dleol && !(str[i - 1] == '\r' && ch == '\n'))))
 		{
-			words.push_back(word(begin, i - 1, prev_break_type, Hash(str, begin, i - 1, 0)));
+			words.emplace_back(begin, i - 1, prev_break_type, static_cast<int>(hash));
 			begin = i;
+			hash = 0;
 		}
+		const int charBegin = i;
 		if (m_eol_mode == EOL_AS_SPACE && break_type == dlspace)
 		{
 			for (; i < iLen; i++)
@@ -475,10 +568,10 @@ stringdiffs::BuildWordsArray(const String & str) const
 		{
 			i = pIterChar->next();
 		}
+		hash = Hash(str, charBegin, i - 1, hash);
 		prev_break_type = break_type;
 	}
-	words.push_back(word(begin, i - 1, break_type, Hash(str, begin, i - 1, 0)));
-	return words;
+	words.emplace_back(begin, i - 1, break_type, static_cast<int>(hash));
 }
 
 /**
@@ -573,13 +666,31 @@ stringdiffs::AreWordsSame(const word& word1, const word& word2) const
 	{
 		if (IsSpace(word1) && IsSpace(word2))
 		{
-			String wordstr1 = m_str1.substr(word1.start, word1.length());
-			String wordstr2 = m_str2.substr(word2.start, word2.length());
-			strutils::replace(wordstr1, _T("\r\n"), _T(" "));
-			strutils::replace_chars(wordstr1, _T("\r\n"), _T(" "));
-			strutils::replace(wordstr2, _T("\r\n"), _T(" "));
-			strutils::replace_chars(wordstr2, _T("\r\n"), _T(" "));
-			return (wordstr1 == wordstr2);
+			// Compare as if CR+LF, CR and LF were replaced with a space
+			int i1 = word1.start, i2 = word2.start;
+			while (i1 <= word1.end && i2 <= word2.end)
+			{
+				tchar_t ch1 = m_str1[i1];
+				tchar_t ch2 = m_str2[i2];
+				int len1 = 1, len2 = 1;
+				if (ch1 == '\r' || ch1 == '\n')
+				{
+					if (ch1 == '\r' && i1 < word1.end && m_str1[i1 + 1] == '\n')
+						len1 = 2;
+					ch1 = ' ';
+				}
+				if (ch2 == '\r' || ch2 == '\n')
+				{
+					if (ch2 == '\r' && i2 < word2.end && m_str2[i2 + 1] == '\n')
+						len2 = 2;
+					ch2 = ' ';
+				}
+				if (ch1 != ch2)
+					return false;
+				i1 += len1;
+				i2 += len2;
+			}
+			return (i1 > word1.end && i2 > word2.end);
 		}
 	}
 
@@ -626,12 +737,19 @@ stringdiffs::onp(std::vector<char> &edscript)
 	if (exchanged)
 		std::swap(M, N);
 
-	int *fp = (new int[(M+1) + 1 + (N+1)]) + (M+1);
-	struct EditScriptElem { int op; int neq; int pk; int pi; };
-	std::vector<EditScriptElem> *es = (new std::vector<EditScriptElem>[(M+1) + 1 + (N+1)]) + (M+1);
+	// Furthest points and last edit script element of each diagonal,
+	// the edit script elements of all diagonals share one buffer
+	const int ndiags = (M+1) + 1 + (N+1);
+	std::vector<int>& fpbuf = m_buffers.fp;
+	fpbuf.resize(2 * static_cast<size_t>(ndiags));
+	int *fp = fpbuf.data() + (M+1);
+	int *last = fp + ndiags;
+	using EditScriptElem = word_buffers::edit_script_elem;
+	std::vector<EditScriptElem>& es = m_buffers.es;
+	es.clear();
 	int DELTA = N - M;
 	
-	auto addEditScriptElem = [&es, &fp](int k) {
+	auto addEditScriptElem = [&es, fp, last](int k) {
 		EditScriptElem ese;
 		if (fp[k - 1] + 1 > fp[k + 1])
 		{
@@ -645,15 +763,19 @@ stringdiffs::onp(std::vector<char> &edscript)
 			ese.neq = fp[k] - fp[k + 1];
 			ese.pk = k + 1;
 		}
-		ese.pi = static_cast<int>(es[ese.pk].size() - 1);
-		es[k].push_back(ese);
+		ese.prev = last[ese.pk];
+		last[k] = static_cast<int>(es.size());
+		es.push_back(ese);
 	};
 
 	const int COUNTMAX = 100000;
 	int count = 0;
 	int k;
 	for (k = -(M+1); k <= (N+1); k++)
-		fp[k] = -1; 
+	{
+		fp[k] = -1;
+		last[k] = -1;
+	}
 	int p = -1;
 	do
 	{
@@ -681,26 +803,21 @@ stringdiffs::onp(std::vector<char> &edscript)
 			auto end = std::chrono::system_clock::now();
 			auto msec = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
 			if (msec > TimeoutMilliSeconds)
-			{
-				delete [] (es - (M+1));
-				delete [] (fp - (M+1));
 				return -1;
-			}
 		}
 	} while (fp[k] != N);
 
 	edscript.clear();
 
-	std::vector<char> ses;
-	int i;
-	for (k = DELTA, i = static_cast<int>(es[DELTA].size() - 1); i >= 0;)
+	std::vector<char>& ses = m_buffers.ses;
+	ses.clear();
+	for (int i = last[DELTA]; i >= 0;)
 	{
-		EditScriptElem& esi = es[k][i];
+		const EditScriptElem& esi = es[i];
 		for (int j = 0; j < esi.neq; ++j)
 			ses.push_back('=');
 		ses.push_back(static_cast<char>(esi.op));
-		i = esi.pi;
-		k = esi.pk;
+		i = esi.prev;
 	}
 	std::reverse(ses.begin(), ses.end());
 
@@ -722,9 +839,6 @@ stringdiffs::onp(std::vector<char> &edscript)
 			c = '=';
 		edscript.push_back(c);
 	}
-		
-	delete [] (es - (M+1));
-	delete [] (fp - (M+1));
 
 	return D;
 }
@@ -748,6 +862,240 @@ stringdiffs::snake(int k, int y, int M, int N, bool exchanged) const
 	return y;
 }
 
+/** @brief Work area of myers() */
+struct stringdiffs::myers_context
+{
+	int *kvdf; /**< Furthest reaching x of the forward paths, by diagonal x - y */
+	int *kvdb; /**< Furthest reaching x of the backward paths, by diagonal x - y */
+	int mxcost; /**< Edit cost after which myers_split() settles for the best split so far */
+	std::chrono::steady_clock::time_point deadline;
+	bool timedout;
+};
+
+/**
+ * @brief Linear space variant of the O(ND) difference algorithm. Eugene W. Myers
+ *
+ * Finds the middle snake of the word arrays and divides them there, until
+ * one side of a part is empty. Uses memory linear in the number of words,
+ * unlike onp(). Like xdiff, a split search that costs more than about the
+ * square root of the number of words takes the furthest reaching path
+ * found instead of the middle snake, and the parts left when the time is
+ * out are marked as changed as a whole.
+ * @return Number of edits, in the same edit script as onp() returns.
+ */
+int
+stringdiffs::myers(std::vector<char> &edscript)
+{
+	const int M = static_cast<int>(m_words1.size() - 1);
+	const int N = static_cast<int>(m_words2.size() - 1);
+	const int ndiags = M + N + 3;
+
+	myers_context ctx;
+	m_buffers.kv.resize(2 * static_cast<size_t>(ndiags));
+	ctx.kvdf = m_buffers.kv.data() + (N + 1);
+	ctx.kvdb = ctx.kvdf + ndiags;
+	ctx.mxcost = std::max(256, static_cast<int>(std::sqrt(static_cast<double>(ndiags))));
+	ctx.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(TimeoutMilliSeconds);
+	ctx.timedout = false;
+
+	// Words 1..M and 1..N of the arrays are compared, part [off1, lim1) x [off2, lim2)
+	// is words off1+1..lim1 and off2+1..lim2. A part with off1 == -1 only adds the
+	// common suffix of the part it was split from.
+	using Part = word_buffers::myers_part;
+	std::vector<Part>& parts = m_buffers.parts;
+	parts.assign(1, { 0, M, 0, N });
+	std::vector<char>& ses = m_buffers.ses;
+	ses.clear();
+	ses.reserve(static_cast<size_t>(M) + N);
+	while (!parts.empty())
+	{
+		Part part = parts.back();
+		parts.pop_back();
+		if (part.off1 < 0)
+		{
+			ses.insert(ses.end(), part.lim1, '=');
+			continue;
+		}
+		int off1 = part.off1, lim1 = part.lim1, off2 = part.off2, lim2 = part.lim2;
+		for (; off1 < lim1 && off2 < lim2 && AreWordsSame(m_words1[off1 + 1], m_words2[off2 + 1]); off1++, off2++)
+			ses.push_back('=');
+		int nsuffix = 0;
+		for (; off1 < lim1 && off2 < lim2 && AreWordsSame(m_words1[lim1], m_words2[lim2]); lim1--, lim2--)
+			nsuffix++;
+
+		if (off1 == lim1 || off2 == lim2 || ctx.timedout)
+		{
+			// Alternate the deleted and inserted words, so they pair up into changes
+			const int n1 = lim1 - off1, n2 = lim2 - off2;
+			for (int i = 0; i < n1 || i < n2; i++)
+			{
+				if (i < n1)
+					ses.push_back('-');
+				if (i < n2)
+					ses.push_back('+');
+			}
+			ses.insert(ses.end(), nsuffix, '=');
+			continue;
+		}
+
+		int split1, split2;
+		myers_split(off1, lim1, off2, lim2, ctx, split1, split2);
+		parts.push_back({ -1, nsuffix, 0, 0 });
+		parts.push_back({ split1, lim1, split2, lim2 });
+		parts.push_back({ off1, split1, off2, split2 });
+	}
+
+	int D = 0;
+	for (size_t n = 0, cnt = ses.size(); n < cnt; n++)
+	{
+		char c = '!';
+		int ch = ses[n];
+		bool is_plus = (ch == '+');
+		if (is_plus || ch == '-')
+		{
+			if (n != (cnt - 1) && ses[n + 1] == "+-"[is_plus])
+				n++;
+			else
+				c = static_cast<char>(ch);
+			D++;
+		}
+		else
+			c = '=';
+		edscript.push_back(c);
+	}
+	return D;
+}
+
+/**
+ * @brief Find where to divide a part of the word arrays, see myers().
+ * Runs the forward and backward searches until their paths overlap,
+ * the split is then on the middle snake. The prefix and suffix of the
+ * part must not match.
+ */
+void
+stringdiffs::myers_split(int off1, int lim1, int off2, int lim2, myers_context &ctx, int &split1, int &split2) const
+{
+	int *kvdf = ctx.kvdf;
+	int *kvdb = ctx.kvdb;
+	const int dmin = off1 - lim2, dmax = lim1 - off2;
+	const int fmid = off1 - off2, bmid = lim1 - lim2;
+	const bool odd = ((fmid - bmid) & 1) != 0;
+	int fmin = fmid, fmax = fmid;
+	int bmin = bmid, bmax = bmid;
+
+	kvdf[fmid] = off1;
+	kvdb[bmid] = lim1;
+
+	for (int ec = 1;; ec++)
+	{
+		int d, i1, i2;
+
+		if (fmin > dmin)
+			kvdf[--fmin - 1] = -1;
+		else
+			++fmin;
+		if (fmax < dmax)
+			kvdf[++fmax + 1] = -1;
+		else
+			--fmax;
+
+		for (d = fmax; d >= fmin; d -= 2)
+		{
+			if (kvdf[d - 1] >= kvdf[d + 1])
+				i1 = kvdf[d - 1] + 1;
+			else
+				i1 = kvdf[d + 1];
+			i2 = i1 - d;
+			for (; i1 < lim1 && i2 < lim2 && AreWordsSame(m_words1[i1 + 1], m_words2[i2 + 1]); i1++, i2++)
+				;
+			kvdf[d] = i1;
+			if (odd && bmin <= d && d <= bmax && kvdb[d] <= i1)
+			{
+				split1 = i1;
+				split2 = i2;
+				return;
+			}
+		}
+
+		if (bmin > dmin)
+			kvdb[--bmin - 1] = INT_MAX;
+		else
+			++bmin;
+		if (bmax < dmax)
+			kvdb[++bmax + 1] = INT_MAX;
+		else
+			--bmax;
+
+		for (d = bmax; d >= bmin; d -= 2)
+		{
+			if (kvdb[d - 1] < kvdb[d + 1])
+				i1 = kvdb[d - 1];
+			else
+				i1 = kvdb[d + 1] - 1;
+			i2 = i1 - d;
+			for (; i1 > off1 && i2 > off2 && AreWordsSame(m_words1[i1], m_words2[i2]); i1--, i2--)
+				;
+			kvdb[d] = i1;
+			if (!odd && fmin <= d && d <= fmax && i1 <= kvdf[d])
+			{
+				split1 = i1;
+				split2 = i2;
+				return;
+			}
+		}
+
+		if ((ec & 255) == 0 && std::chrono::steady_clock::now() > ctx.deadline)
+			ctx.timedout = true;
+		if (ec >= ctx.mxcost || ctx.timedout)
+		{
+			// Too costly, split where the forward or the backward paths got furthest
+			int fbest = -1, fbest1 = -1;
+			for (d = fmax; d >= fmin; d -= 2)
+			{
+				i1 = std::min(kvdf[d], lim1);
+				i2 = i1 - d;
+				if (lim2 < i2)
+				{
+					i1 = lim2 + d;
+					i2 = lim2;
+				}
+				if (fbest < i1 + i2)
+				{
+					fbest = i1 + i2;
+					fbest1 = i1;
+				}
+			}
+			int bbest = INT_MAX, bbest1 = INT_MAX;
+			for (d = bmax; d >= bmin; d -= 2)
+			{
+				i1 = std::max(off1, kvdb[d]);
+				i2 = i1 - d;
+				if (i2 < off2)
+				{
+					i1 = off2 + d;
+					i2 = off2;
+				}
+				if (i1 + i2 < bbest)
+				{
+					bbest = i1 + i2;
+					bbest1 = i1;
+				}
+			}
+			if ((lim1 + lim2) - bbest < fbest - (off1 + off2))
+			{
+				split1 = fbest1;
+				split2 = fbest - fbest1;
+			}
+			else
+			{
+				split1 = bbest1;
+				split2 = bbest - bbest1;
+			}
+			return;
+		}
+	}
+}
+
 /**
  * @brief Return true if chars match
  *
@@ -770,7 +1118,7 @@ matchchar(const tchar_t *ch1, const tchar_t *ch2, size_t len, bool casitive)
 /** Does character introduce a multicharacter character? */
 static inline bool IsLeadByte(tchar_t ch)
 {
-#ifdef UNICODE
+#if defined(UNICODE) || !defined(_WIN32)
 	return false;
 #else
 	return _getmbcp() && IsDBCSLeadByte(ch);
@@ -819,9 +1167,14 @@ isWordBreak(int breakType, const tchar_t *str, int index)
 //		GetStringTypeW(CT_CTYPE3, &nextCh, 1, &wCharTypeNext);
 //		return (wCharType != wCharTypeNext);
 //		
+#ifdef _WIN32
 		WORD wCharType = 0;
 		GetStringTypeW(CT_CTYPE1, &ch, 1, &wCharType);
 		return !(wCharType & (C1_UPPER | C1_LOWER | C1_DIGIT));
+#else
+		// Bytes of UTF-8 sequences are parts of words
+		return false;
+#endif
 	}
 }
 
@@ -865,10 +1218,10 @@ stringdiffs::ComputeByteDiff(const String & str1, const String & str2,
 	const tchar_t *pbeg1 = str1.c_str();
 	const tchar_t *pbeg2 = str2.c_str();
 
-	ICUBreakIterator *pIterCharBegin1 = ICUBreakIterator::getCharacterBreakIterator(reinterpret_cast<const UChar *>(pbeg1), static_cast<int32_t>(len1));
-	ICUBreakIterator *pIterCharBegin2 = ICUBreakIterator::getCharacterBreakIterator<2>(reinterpret_cast<const UChar *>(pbeg2), static_cast<int32_t>(len2));
-	ICUBreakIterator *pIterCharEnd1 = ICUBreakIterator::getCharacterBreakIterator<3>(reinterpret_cast<const UChar *>(pbeg1), static_cast<int32_t>(len1));
-	ICUBreakIterator *pIterCharEnd2 = ICUBreakIterator::getCharacterBreakIterator<4>(reinterpret_cast<const UChar *>(pbeg2), static_cast<int32_t>(len2));
+	ICUBreakIterator *pIterCharBegin1 = ICUBreakIterator::getCharacterBreakIterator(BreakText(pbeg1), static_cast<int32_t>(len1));
+	ICUBreakIterator *pIterCharBegin2 = ICUBreakIterator::getCharacterBreakIterator<2>(BreakText(pbeg2), static_cast<int32_t>(len2));
+	ICUBreakIterator *pIterCharEnd1 = ICUBreakIterator::getCharacterBreakIterator<3>(BreakText(pbeg1), static_cast<int32_t>(len1));
+	ICUBreakIterator *pIterCharEnd2 = ICUBreakIterator::getCharacterBreakIterator<4>(BreakText(pbeg2), static_cast<int32_t>(len2));
 	
 	if (len1 == 0 || len2 == 0)
 	{
@@ -1086,8 +1439,10 @@ void stringdiffs::wordLevelToByteLevel()
 	{
 		int begin[3], end[3];
 		wdiff& diff = m_wdiffs[i];
-		String str1_2 = m_str1.substr(diff.begin[0], diff.end[0] - diff.begin[0] + 1);
-		String str2_2 = m_str2.substr(diff.begin[1], diff.end[1] - diff.begin[1] + 1);
+		String& str1_2 = m_buffers.substr1;
+		String& str2_2 = m_buffers.substr2;
+		str1_2.assign(m_str1, diff.begin[0], diff.end[0] - diff.begin[0] + 1);
+		str2_2.assign(m_str2, diff.begin[1], diff.end[1] - diff.begin[1] + 1);
 		ComputeByteDiff(str1_2, str2_2, m_case_sensitive, m_whitespace, begin, end, false);
 		if (begin[0] == -1)
 		{
@@ -7,6 +7,7 @@
 #pragma once
 
 #include "UnicodeString.h"
+#include <memory>
 #include <vector>
 
 namespace strdiff
@@ -32,6 +33,33 @@ struct wdiff {
 	}
 };
 
+struct word_buffers;
+
+/**
+ * @brief Buffers of ComputeWordDiffs(), kept from one call to the next.
+ * The words, edit scripts and diffs of the lines compared are built in
+ * these buffers, so once they have grown to the lines compared, computing
+ * word diffs doesn't allocate memory. An arena is used by one thread at a
+ * time.
+ */
+class WordDiffArena
+{
+public:
+	WordDiffArena();
+	~WordDiffArena();
+	WordDiffArena(const WordDiffArena&) = delete;
+	WordDiffArena& operator=(const WordDiffArena&) = delete;
+
+	void Shrink();
+
+	word_buffers& buffers(int index) { return *m_buffers[index]; }
+	std::vector<wdiff>& diffs(int index) { return m_diffs[index]; }
+
+private:
+	std::unique_ptr<word_buffers> m_buffers[2]; /**< A 3-way compare diffs two pairs of strings */
+	std::vector<wdiff> m_diffs[2]; /**< Diffs of the two pairs of a 3-way compare */
+};
+
 void Init();
 void Close();
 
@@ -41,6 +69,12 @@ std::vector<wdiff> ComputeWordDiffs(const String& str1, const String& str2,
 	bool case_sensitive, EolCompareMode eol_mode, int whitespace, bool ignore_numbers, int breakType, bool byte_level);
 std::vector<wdiff> ComputeWordDiffs(int nStrings, const String *str, 
                    bool case_sensitive, EolCompareMode eol_mode, int whitespace, bool ignore_numbers, int breakType, bool byte_level);
+void ComputeWordDiffs(const String& str1, const String& str2,
+	bool case_sensitive, EolCompareMode eol_mode, int whitespace, bool ignore_numbers, int breakType, bool byte_level,
+	WordDiffArena& arena, std::vector<wdiff>& diffs);
+void ComputeWordDiffs(int nStrings, const String *str,
+	bool case_sensitive, EolCompareMode eol_mode, int whitespace, bool ignore_numbers, int breakType, bool byte_level,
+	WordDiffArena& arena, std::vector<wdiff>& diffs);
 int Compare(const String& str1, const String& str2,
 	bool case_sensitive, EolCompareMode eol_mode, int whitespace, bool ignore_numbers);
 
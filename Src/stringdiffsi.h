@@ -39,6 +39,7 @@ enum
 };
 
 struct wdiff;
+struct word_buffers;
 
 /**
  * @brief Class to hold together data needed to implement strdiff::ComputeWordDiffs
@@ -50,7 +51,7 @@ public:
 
 	stringdiffs(const String & str1, const String & str2,
 		bool case_sensitive, EolCompareMode eol_mode, int whitespace, bool ignore_numbers, int breakType,
-		std::vector<wdiff> * pDiffs);
+		std::vector<wdiff> * pDiffs, word_buffers & buffers);
 
 	~stringdiffs();
 
@@ -60,6 +61,7 @@ public:
 
 // Implementation types
 private:
+	friend struct word_buffers;
 	struct word {
 		int start; // index of first character of word in original string
 		int end;   // index of last character of word in original string
@@ -75,7 +77,7 @@ private:
 	void ComputeByteDiff(const String& str1, const String& str2,
 			bool casitive, int xwhite, 
 			int begin[2], int end[2], bool equal);
-	std::vector<word> BuildWordsArray(const String & str) const;
+	void BuildWordsArray(const String & str, std::vector<word> & words) const;
 	unsigned Hash(const String & str, int begin, int end, unsigned h ) const;
 	bool AreWordsSame(const word & word1, const word & word2) const;
 	bool IsWord(const word & word1) const;
@@ -104,6 +106,9 @@ private:
 	int dp(std::vector<char> & edscript);
 	int onp(std::vector<char> & edscript);
 	int snake(int k, int y, int M, int N, bool exchanged) const;
+	struct myers_context;
+	int myers(std::vector<char> & edscript);
+	void myers_split(int off1, int lim1, int off2, int lim2, myers_context & ctx, int & split1, int & split2) const;
 #ifdef STRINGDIFF_LOGGING
 	void debugoutput();
 #endif
@@ -119,9 +124,32 @@ private:
 	bool m_ignore_numbers = false;
 	bool m_matchblock;
 	std::vector<wdiff> * m_pDiffs;
-	std::vector<word> m_words1;
-	std::vector<word> m_words2;
-	std::vector<wdiff> m_wdiffs;
+	word_buffers & m_buffers;
+	std::vector<word> & m_words1;
+	std::vector<word> & m_words2;
+	std::vector<wdiff> & m_wdiffs;
+};
+
+/**
+ * @brief Work area of class stringdiffs, see WordDiffArena.
+ * Every buffer is cleared before use, only its capacity is kept.
+ */
+struct word_buffers
+{
+	struct edit_script_elem { int op; int neq; int pk; int prev; };
+	struct myers_part { int off1, lim1, off2, lim2; };
+
+	std::vector<stringdiffs::word> words1;
+	std::vector<stringdiffs::word> words2;
+	std::vector<wdiff> wdiffs;
+	std::vector<char> edscript;
+	std::vector<char> ses; /**< Edit script before the -/+ pairs are joined */
+	std::vector<int> fp; /**< onp() furthest points by diagonal, then the last element of each diagonal */
+	std::vector<edit_script_elem> es; /**< onp() edit script elements of all diagonals */
+	std::vector<int> kv; /**< myers() furthest reaching paths */
+	std::vector<myers_part> parts; /**< myers() parts left to divide */
+	String substr1; /**< Changed words of the lines, refined by ComputeByteDiff() */
+	String substr2;
 };
 
 }
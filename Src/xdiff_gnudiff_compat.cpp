@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "cio.h"
 #include "CompareOptions.h"
+#include "StreamingDiff.h"
 extern "C" {
 #include "../Externals/xdiff/xinclude.h"
 }
@@ -14,6 +15,7 @@ unsigned long make_xdl_flags(const DiffutilsOptions& options)
 		xdl_flags |= XDF_NEED_MINIMAL;
 		break;
 	case DIFF_ALGORITHM_PATIENCE:
+	case DIFF_ALGORITHM_STREAMING: // The lines between the anchors of the windows
 		xdl_flags |= XDF_PATIENCE_DIFF;
 		break;
 	case DIFF_ALGORITHM_HISTOGRAM:
@@ -54,7 +56,15 @@ static int hunk_func(long start_a, long count_a, long start_b, long count_b, voi
 	return 0;
 }
 
-struct change* diff_2_buffers_xdiff(const char* ptr1, size_t size1, const char* ptr2, size_t size2, unsigned xdl_flags)
+/**
+ * @brief Compare two buffers with xdiff.
+ * @param [in] classes1, classes2 Equivalence classes of the lines of the
+ *   buffers, or nullptr. The lines must be split at '\n' only and be in the
+ *   same class if and only if they match under @p xdl_flags; xdiff then
+ *   uses the classes instead of hashing and matching the lines itself.
+ */
+struct change* diff_2_buffers_xdiff(const char* ptr1, size_t size1, const char* ptr2, size_t size2, unsigned xdl_flags,
+	const int* classes1, size_t nclasses1, const int* classes2, size_t nclasses2)
 {
 	change *script = nullptr;
 	xdfenv_t xe;
@@ -66,9 +76,20 @@ struct change* diff_2_buffers_xdiff(const char* ptr1, size_t size1, const char*
 	mmfile_t mmfile2 = { const_cast<char*>(ptr2), static_cast<long>(size2) };
 
 	xpp.flags = xdl_flags;
+	xpp.classes1 = classes1;
+	xpp.nclasses1 = static_cast<long>(nclasses1);
+	xpp.classes2 = classes2;
+	xpp.nclasses2 = static_cast<long>(nclasses2);
 	xecfg.hunk_func = hunk_func;
 
-	if (xdl_diff_modified(&mmfile1, &mmfile2, &xpp, &xecfg, &ecb, &xe, &xscr) == 0)
+	int result = xdl_diff_modified(&mmfile1, &mmfile2, &xpp, &xecfg, &ecb, &xe, &xscr);
+	if (result != 0 && classes1 && classes2)
+	{
+		// The lines didn't match the classes, let xdiff hash them
+		xpp.classes1 = xpp.classes2 = nullptr;
+		result = xdl_diff_modified(&mmfile1, &mmfile2, &xpp, &xecfg, &ecb, &xe, &xscr);
+	}
+	if (result == 0)
 	{
 		change *prev = nullptr;
 		for (xdchange_t* xcur = xscr; xcur; xcur = xcur->next)
@@ -137,9 +158,9 @@ struct change * diff_2_files_xdiff (struct file_data filevec[], int* bin_status,
 				for (i = 0; i < 2; i++)
 					while (filevec[i].buffered_chars < buffer_size)
 					  {
-						cio::ssize_t r = cio::read (filevec[i].desc,
+						int r = read_file_data (&filevec[i],
 									   filevec[i].buffer	+ filevec[i].buffered_chars,
-									   buffer_size - filevec[i].buffered_chars);
+									   (unsigned int)(buffer_size - filevec[i].buffered_chars));
 						if (r == 0)
 							break;
 						if (r < 0)
@@ -180,19 +201,132 @@ struct change * diff_2_files_xdiff (struct file_data filevec[], int* bin_status,
 	}
 	else
 	{
+		size_t size[2];
+		bool bTrimmed = false;
+		for (int i = 0; i < 2; i++)
+		{
+			const bool bMissingNewline = (filevec[i].suffix_begin == filevec[i].buffer + filevec[i].buffered_chars)
+				&& filevec[i].missing_newline;
+			size[i] = filevec[i].suffix_begin - filevec[i].prefix_end - (bMissingNewline ? 1 : 0);
+			bTrimmed |= bMissingNewline;
+		}
+		// read_files() already put the lines in equivalence classes. xdiff
+		// can use them if it would split and match the lines the same way:
+		// lines end at '\n' only and match only if they are identical.
+		const bool bUseClasses = !bTrimmed &&
+			!ignore_case_flag && !ignore_all_space_flag && !ignore_space_change_flag && !ignore_numbers_flag &&
+			(ignore_eol_diff || (filevec[0].count_crs == 0 && filevec[1].count_crs == 0));
 		script = diff_2_buffers_xdiff(
-			filevec[0].prefix_end,
-			filevec[0].suffix_begin - filevec[0].prefix_end - 
-				((filevec[0].suffix_begin == filevec[0].buffer + filevec[0].buffered_chars)
-					? filevec[0].missing_newline : 0),
-			filevec[1].prefix_end,
-			filevec[1].suffix_begin - filevec[1].prefix_end - 
-				((filevec[1].suffix_begin == filevec[1].buffer + filevec[1].buffered_chars)
-					? filevec[1].missing_newline : 0),
-			xdl_flags);
+			filevec[0].prefix_end, size[0],
+			filevec[1].prefix_end, size[1],
+			xdl_flags,
+			bUseClasses ? filevec[0].equivs : nullptr, filevec[0].buffered_lines,
+			bUseClasses ? filevec[1].equivs : nullptr, filevec[1].buffered_lines);
 		if (bMoved_blocks_flag)
 			moved_block_analysis(&script, filevec);
 	}
 
 	return script;
 }
+
+namespace
+{
+
+/** @brief Reads a file of diffutils through its descriptor. */
+class FileSource : public StreamingDiff::Source
+{
+public:
+	explicit FileSource(file_data& file) : m_file(file) {}
+
+	size_t Read(char *buf, size_t size) override
+	{
+		const int nRead = read_file_data(&m_file, buf, static_cast<unsigned>((std::min)(size, static_cast<size_t>(INT_MAX))));
+		if (nRead < 0)
+			pfatal_with_name(m_file.name);
+		return nRead;
+	}
+
+	void Seek(uint64_t offset) override
+	{
+		if (cio::lseek(m_file.desc, offset, SEEK_SET) < 0)
+			pfatal_with_name(m_file.name);
+	}
+
+private:
+	file_data& m_file;
+};
+
+/**
+ * @brief Can the file be read in windows?
+ * It must be a regular file read from its descriptor, and neither binary
+ * nor UCS-2/UCS-4 text, which diffutils transcodes as a whole. The first
+ * block is checked like sip() checks it, then the file is read again from
+ * its start.
+ */
+bool can_stream_file(file_data& file)
+{
+	if (file.desc < 0 || !S_ISREG(file.stat.st_mode) || file.preloaded != nullptr || file.prepared != nullptr)
+		return false;
+	std::vector<char> block(STAT_BLOCKSIZE(file.stat));
+	const int nRead = read_file_data(&file, block.data(), static_cast<unsigned>(block.size()));
+	if (nRead < 0)
+		pfatal_with_name(file.name);
+	if (cio::lseek(file.desc, 0, SEEK_SET) != 0)
+		pfatal_with_name(file.name);
+	const unsigned char *p = reinterpret_cast<const unsigned char *>(block.data());
+	if (nRead >= 2 && ((p[0] == 0xFF && p[1] == 0xFE) || (p[0] == 0xFE && p[1] == 0xFF)))
+		return false;
+	if (nRead >= 4 && p[0] == 0 && p[1] == 0 && p[2] == 0xFE && p[3] == 0xFF)
+		return false;
+	const bool utf8 = nRead >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF;
+	return always_text_flag || utf8 || memchr(p, 0, nRead) == nullptr;
+}
+
+}
+
+/**
+ * @brief Compare two files a window at a time with StreamingDiff.
+ * Files which can't be read in windows, and the same file compared with
+ * itself, are compared in memory with diff_2_files_xdiff(). The streamed
+ * files aren't kept in memory: the file_data get the text statistics but
+ * no buffers or lines.
+ * @param [in] window_size Bytes of each file held in memory, 0 for the default.
+ */
+struct change * diff_2_files_streaming (struct file_data filevec[], int* bin_status, int* bin_file, unsigned xdl_flags, size_t window_size)
+{
+	if (filevec[0].desc == filevec[1].desc || (no_details_flag & ~ignore_some_changes) ||
+		!can_stream_file(filevec[0]) || !can_stream_file(filevec[1]))
+		return diff_2_files_xdiff(filevec, bin_status, 0, bin_file, xdl_flags);
+
+	if (bin_file != nullptr)
+		*bin_file = 0;
+	change *script = nullptr;
+	change **tail = &script;
+	StreamingDiff diff(xdl_flags, window_size ? window_size : StreamingDiff::DefaultWindowSize);
+	FileSource source0(filevec[0]), source1(filevec[1]);
+	diff.Diff(source0, source1, [&tail](int line0, int line1, int deleted, int inserted)
+		{
+			change *e = static_cast<change *>(xmalloc(sizeof(change)));
+			e->line0 = line0;
+			e->line1 = line1;
+			e->deleted = deleted;
+			e->inserted = inserted;
+			e->match0 = -1;
+			e->match1 = -1;
+			e->trivial = 0;
+			e->ignore = 0;
+			e->link = nullptr;
+			*tail = e;
+			tail = &e->link;
+		});
+	for (int i = 0; i < 2; ++i)
+	{
+		const StreamingDiff::TextStats& stats = diff.GetTextStats(i);
+		filevec[i].count_crlfs = stats.crlfs;
+		filevec[i].count_crs = stats.crs;
+		filevec[i].count_lfs = stats.lfs;
+		filevec[i].count_zeros = stats.zeros;
+		filevec[i].missing_newline = stats.missingNewline;
+	}
+	return script;
+}
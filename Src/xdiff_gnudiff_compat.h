@@ -3,5 +3,7 @@
 class DiffutilsOptions;
 
 unsigned long make_xdl_flags(const DiffutilsOptions& options);
-struct change* diff_2_buffers_xdiff(const char* ptr1, size_t size1, const char* ptr2, size_t size2, unsigned xdl_flags);
+struct change* diff_2_buffers_xdiff(const char* ptr1, size_t size1, const char* ptr2, size_t size2, unsigned xdl_flags,
+	const int* classes1 = nullptr, size_t nclasses1 = 0, const int* classes2 = nullptr, size_t nclasses2 = 0);
 struct change * diff_2_files_xdiff(struct file_data filevec[], int* bin_status, int bMoved_blocks_flag, int* bin_file, unsigned xdl_flags);
+struct change * diff_2_files_streaming(struct file_data filevec[], int* bin_status, int* bin_file, unsigned xdl_flags, size_t window_size = 0);
@@ -0,0 +1,201 @@
+/**
+ * @file  CompareScheduler_bench.cpp
+ *
+ * @brief Throughput of the folder compare scheduler vs. thread count.
+ *
+ * Builds a synthetic tree of many small file pairs and compares every pair
+ * (read both files, memcmp) through
+ * - WorkStealingScheduler, as used by DirScan_CompareItems(), and
+ * - a mutex/condition variable queue that allocates a work and a result
+ *   notification per item, like the Poco::NotificationQueue it replaced.
+ *
+ * Usage: CompareScheduler_bench [files [max-threads]]
+ *
+ * Build (Linux): the CompareScheduler_bench target of ../CMakeLists.txt, or
+ *   g++ -std=c++17 -O2 -pthread -I../../../Src CompareScheduler_bench.cpp
+ */
+#include "WorkStealingQueue.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+struct FilePairItem
+{
+	std::string left;
+	std::string right;
+	bool same;
+};
+
+/** @brief Create @p nFiles file pairs, 100 per folder, every 7th pair differing. */
+std::vector<FilePairItem> CreateTree(const fs::path& root, int nFiles)
+{
+	std::vector<FilePairItem> items;
+	items.reserve(nFiles);
+	std::string content(512, 'x');
+	for (int i = 0; i < nFiles; ++i)
+	{
+		fs::path sub = fs::path("d" + std::to_string(i / 100 / 10)) / ("d" + std::to_string(i / 100));
+		fs::path left = root / "left" / sub;
+		fs::path right = root / "right" / sub;
+		if (i % 100 == 0)
+		{
+			fs::create_directories(left);
+			fs::create_directories(right);
+		}
+		std::string name = "file" + std::to_string(i) + ".txt";
+		snprintf(&content[0], content.size(), "%d\n", i);
+		std::ofstream(left / name, std::ios::binary).write(content.data(), content.size());
+		if (i % 7 == 0)
+			content[content.size() - 1] = 'y';
+		std::ofstream(right / name, std::ios::binary).write(content.data(), content.size());
+		content[content.size() - 1] = 'x';
+		items.push_back({ (left / name).string(), (right / name).string(), false });
+	}
+	return items;
+}
+
+void ComparePair(FilePairItem& item)
+{
+	char buf1[4096], buf2[4096];
+	FILE *f1 = fopen(item.left.c_str(), "rb");
+	FILE *f2 = fopen(item.right.c_str(), "rb");
+	bool same = f1 && f2;
+	while (same)
+	{
+		size_t n1 = fread(buf1, 1, sizeof(buf1), f1);
+		size_t n2 = fread(buf2, 1, sizeof(buf2), f2);
+		if (n1 != n2 || memcmp(buf1, buf2, n1) != 0)
+			same = false;
+		if (n1 == 0)
+			break;
+	}
+	if (f1) fclose(f1);
+	if (f2) fclose(f2);
+	item.same = same;
+}
+
+double RunWorkStealing(std::vector<FilePairItem>& items, int nThreads)
+{
+	WorkStealingScheduler<FilePairItem> scheduler(nThreads);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < nThreads; ++i)
+		threads.emplace_back([&, i] { scheduler.RunWorker(i, ComparePair); });
+	auto start = std::chrono::steady_clock::now();
+	std::vector<FilePairItem *> batch;
+	for (auto& item : items)
+	{
+		batch.push_back(&item);
+		if (batch.size() == 64)
+		{
+			scheduler.Submit(batch.data(), batch.size());
+			batch.clear();
+		}
+	}
+	scheduler.Submit(batch.data(), batch.size());
+	scheduler.WaitIdle();
+	auto end = std::chrono::steady_clock::now();
+	scheduler.Shutdown();
+	for (auto& t : threads)
+		t.join();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+/** @brief The previous design: one locked queue, a heap notification per item and per result. */
+double RunLockedQueue(std::vector<FilePairItem>& items, int nThreads)
+{
+	struct Notification { FilePairItem *item; };
+	std::mutex mutex, resultMutex;
+	std::condition_variable cv, resultCv;
+	std::deque<std::unique_ptr<Notification>> queue, results;
+	bool done = false;
+	std::vector<std::thread> threads;
+	for (int i = 0; i < nThreads; ++i)
+	{
+		threads.emplace_back([&] {
+			for (;;)
+			{
+				std::unique_ptr<Notification> nf;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					cv.wait(lock, [&] { return done || !queue.empty(); });
+					if (queue.empty())
+						return;
+					nf = std::move(queue.front());
+					queue.pop_front();
+				}
+				ComparePair(*nf->item);
+				std::lock_guard<std::mutex> lock(resultMutex);
+				results.emplace_back(new Notification{ nf->item });
+				resultCv.notify_one();
+			}
+		});
+	}
+	auto start = std::chrono::steady_clock::now();
+	for (auto& item : items)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queue.emplace_back(new Notification{ &item });
+		cv.notify_one();
+	}
+	for (size_t count = items.size(); count > 0; --count)
+	{
+		std::unique_lock<std::mutex> lock(resultMutex);
+		resultCv.wait(lock, [&] { return !results.empty(); });
+		results.pop_front();
+	}
+	auto end = std::chrono::steady_clock::now();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		done = true;
+	}
+	cv.notify_all();
+	for (auto& t : threads)
+		t.join();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+	int nFiles = argc > 1 ? atoi(argv[1]) : 20000;
+	int nMaxThreads = argc > 2 ? atoi(argv[2]) : static_cast<int>(std::thread::hardware_concurrency());
+	if (nMaxThreads <= 0)
+		nMaxThreads = 1;
+
+	fs::path root = fs::temp_directory_path() / ("CompareScheduler_bench_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+	std::vector<FilePairItem> items = CreateTree(root, nFiles);
+
+	printf("%d file pairs\n", nFiles);
+	printf("%8s %16s %16s\n", "threads", "workstealing/s", "lockedqueue/s");
+	std::vector<int> threadCounts;
+	for (int nThreads = 1; nThreads < nMaxThreads; nThreads *= 2)
+		threadCounts.push_back(nThreads);
+	threadCounts.push_back(nMaxThreads);
+	for (int nThreads : threadCounts)
+	{
+		double ws = RunWorkStealing(items, nThreads);
+		size_t nSame = 0;
+		for (const auto& item : items)
+			nSame += item.same;
+		double lq = RunLockedQueue(items, nThreads);
+		printf("%8d %16.0f %16.0f   (%zu same)\n", nThreads, nFiles / ws, nFiles / lq, nSame);
+	}
+
+	fs::remove_all(root);
+	return 0;
+}
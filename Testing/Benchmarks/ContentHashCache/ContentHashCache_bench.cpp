@@ -0,0 +1,173 @@
+/**
+ * @file  ContentHashCache_bench.cpp
+ *
+ * @brief Cold vs. warm folder compare with the content hash cache.
+ *
+ * Builds a synthetic tree of file pairs and compares every pair the way
+ * BinaryCompare does with a ContentHashCache:
+ * - uncached: read both files and memcmp, no cache,
+ * - cold: empty cache, read both files, record both digests, save,
+ * - warm: load the saved cache and decide every pair from the digests,
+ * - warm, one side touched: the left tree got new timestamps, so only the
+ *   left files are read and hashed.
+ *
+ * Usage: ContentHashCache_bench [files [file-size]]
+ *
+ * Build (Linux):
+ *   g++ -std=c++17 -O2 -include vector -include string -I. -I../../../Src -I../../../Src/Common
+ *       -I../../../Externals/crystaledit/editlib/utils -I../../../Externals/poco/Foundation/include
+ *       ContentHashCache_bench.cpp ../../../Src/ContentHashCache.cpp ../../../Src/Common/cio.cpp
+ *       -lPocoFoundation -pthread
+ * with an empty pch.h in the current folder.
+ */
+#include "ContentHashCache.h"
+#include "DirItem.h"
+#include "cio.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+#ifndef _WIN32
+// unicoder.cpp is Windows-only, String is UTF-8 elsewhere
+namespace ucr { std::string toUTF8(const String& tstr) { return tstr; } }
+#endif
+
+namespace
+{
+
+struct FilePairItem
+{
+	String path[2];
+	DirItem item[2];
+};
+
+/** @brief Create @p nFiles file pairs of @p nSize bytes, every 7th pair differing in the last byte. */
+std::vector<FilePairItem> CreateTree(const fs::path& root, int nFiles, int nSize)
+{
+	std::vector<FilePairItem> items(nFiles);
+	std::string content(nSize, 'x');
+	const Poco::Timestamp mtime = Poco::Timestamp() - 3600 * Poco::Timestamp::resolution();
+	for (int i = 0; i < nFiles; ++i)
+	{
+		fs::path sub = fs::path("d" + std::to_string(i / 100));
+		std::string name = "file" + std::to_string(i) + ".bin";
+		snprintf(&content[0], content.size(), "%d\n", i);
+		for (int side = 0; side < 2; ++side)
+		{
+			fs::path dir = root / (side == 0 ? "left" : "right") / sub;
+			if (i % 100 == 0)
+				fs::create_directories(dir);
+			if (side == 1 && i % 7 == 0)
+				content[content.size() - 1] = 'y';
+			std::ofstream((dir / name).string(), std::ios::binary).write(content.data(), content.size());
+			content[content.size() - 1] = 'x';
+			items[i].path[side] = (dir / name).string();
+			items[i].item[side].size = nSize;
+			items[i].item[side].mtime = mtime;
+			items[i].item[side].ctime = mtime;
+		}
+	}
+	return items;
+}
+
+/** @brief Compare a pair like BinaryCompare does, hashing both files when @p pCache is given. */
+bool ComparePair(const FilePairItem& pair, ContentHashCache *pCache)
+{
+	ContentHashCache::Entry entries[2];
+	if (pCache != nullptr)
+	{
+		bool bCached[2];
+		for (int i = 0; i < 2; ++i)
+			bCached[i] = pCache->Lookup(pair.path[i], pair.item[i], entries[i]);
+		if (bCached[0] || bCached[1])
+		{
+			for (int i = 0; i < 2; ++i)
+			{
+				if (!bCached[i] && ContentHashCache::HashFile(pair.path[i], entries[i], nullptr))
+					pCache->Store(pair.path[i], pair.item[i], entries[i]);
+			}
+			return memcmp(entries[0].digest, entries[1].digest, sizeof(entries[0].digest)) == 0;
+		}
+	}
+	static char buf[2][256 * 1024];
+	int fd[2];
+	for (int i = 0; i < 2; ++i)
+		cio::tsopen_s(&fd[i], pair.path[i], O_BINARY | O_RDONLY, _SH_DENYNO, _S_IREAD);
+	ContentHashCache::Hasher hashers[2];
+	bool same = true;
+	for (;;)
+	{
+		int size[2];
+		for (int i = 0; i < 2; ++i)
+		{
+			size[i] = cio::read_i(fd[i], buf[i], sizeof(buf[i]));
+			if (pCache != nullptr && size[i] > 0)
+				hashers[i].Update(buf[i], size[i]);
+		}
+		if (size[0] != size[1] || memcmp(buf[0], buf[1], size[0]) != 0)
+			same = false;
+		if (size[0] <= 0 || size[1] <= 0)
+			break;
+	}
+	for (int i = 0; i < 2; ++i)
+	{
+		cio::close(fd[i]);
+		if (pCache != nullptr)
+		{
+			hashers[i].Finish(entries[i]);
+			pCache->Store(pair.path[i], pair.item[i], entries[i]);
+		}
+	}
+	return same;
+}
+
+double Run(const std::vector<FilePairItem>& items, ContentHashCache *pCache, size_t& nSame)
+{
+	auto start = std::chrono::steady_clock::now();
+	if (pCache != nullptr)
+		pCache->Load();
+	nSame = 0;
+	for (const auto& pair : items)
+		nSame += ComparePair(pair, pCache);
+	if (pCache != nullptr)
+		pCache->Save();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+	int nFiles = argc > 1 ? atoi(argv[1]) : 20000;
+	int nSize = argc > 2 ? atoi(argv[2]) : 16384;
+
+	fs::path root = fs::temp_directory_path() / ("ContentHashCache_bench_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+	std::vector<FilePairItem> items = CreateTree(root, nFiles, nSize);
+	ContentHashCache cache((root / "cache.bin").string(), 256 * 1024 * 1024);
+
+	printf("%d file pairs of %d bytes\n", nFiles, nSize);
+	printf("%-24s %12s %10s\n", "run", "pairs/s", "same");
+	size_t nSame;
+	double t = Run(items, nullptr, nSame);
+	printf("%-24s %12.0f %10zu\n", "uncached", nFiles / t, nSame);
+	t = Run(items, &cache, nSame);
+	printf("%-24s %12.0f %10zu\n", "cold", nFiles / t, nSame);
+	t = Run(items, &cache, nSame);
+	printf("%-24s %12.0f %10zu   (%d hits)\n", "warm", nFiles / t, nSame, cache.GetHitCount());
+	for (auto& pair : items)
+		pair.item[0].mtime += Poco::Timestamp::resolution();
+	t = Run(items, &cache, nSame);
+	printf("%-24s %12.0f %10zu   (%d hits)\n", "warm, left touched", nFiles / t, nSame, cache.GetHitCount());
+	printf("cache file: %ju bytes\n", static_cast<uintmax_t>(fs::file_size(root / "cache.bin")));
+
+	fs::remove_all(root);
+	return 0;
+}
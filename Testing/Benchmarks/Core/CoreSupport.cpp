@@ -0,0 +1,69 @@
+/**
+ * @file  CoreSupport.cpp
+ *
+ * @brief Functions the core sources use from modules not built into the core library.
+ *
+ * paths.cpp and Environment.cpp are built on the Windows shell API, the
+ * core only needs the helpers below. DirItem.cpp reads file attributes
+ * through the Windows API, the DIFFITEM tree only needs to clear them.
+ */
+#include "pch.h"
+#include <cstdlib>
+#include "paths.h"
+#include "Environment.h"
+#include "DirItem.h"
+
+namespace paths
+{
+
+/** @brief Extension of the file name of @p path including the dot, or an empty string. */
+String FindExtension(const String& path)
+{
+	const size_t slash = path.find_last_of(_T("\\/"));
+	const size_t dot = path.rfind('.');
+	if (dot == String::npos || (slash != String::npos && dot < slash))
+		return String();
+	return path.substr(dot);
+}
+
+/** @brief @p subpath appended to @p path, with a slash between them. */
+String ConcatPath(const String& path, const String& subpath)
+{
+	if (path.empty())
+		return subpath;
+	if (subpath.empty())
+		return path;
+	const bool slash = path.back() == '/' || path.back() == '\\';
+	return slash ? path + subpath : path + _T("/") + subpath;
+}
+
+/** @brief Is @p name the null device? */
+bool IsNullDeviceName(const String& name)
+{
+	return name == _T("/dev/null") || name == _T("NUL");
+}
+
+}
+
+namespace env
+{
+
+/** @brief Folder for temporary files, from TMPDIR like the shell's. */
+String GetTemporaryPath()
+{
+	const char *tmpdir = getenv("TMPDIR");
+	return (tmpdir != nullptr && *tmpdir != '\0') ? String(tmpdir) : String(_T("/tmp"));
+}
+
+}
+
+/**
+ * @brief Clears FileInfo data except path/filename.
+ */
+void DirItem::ClearPartial()
+{
+	ctime = 0;
+	mtime = 0;
+	size = DirItem::FILE_SIZE_NONE;
+	flags.reset();
+}
@@ -0,0 +1,8 @@
+/**
+ * @file  StdAfx.h
+ *
+ * @brief Precompiled header of the crystaledit sources built into the core library.
+ */
+#pragma once
+
+#include "pch.h"
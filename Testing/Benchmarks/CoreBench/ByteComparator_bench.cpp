@@ -0,0 +1,73 @@
+/**
+ * @file  ByteComparator_bench.cpp
+ *
+ * @brief Quick compare of identical text and binary buffers.
+ *
+ * The buffers are identical, so every iteration scans them to the end like
+ * a quick compare of two equal files does. The ignore cases take the
+ * byte per byte path of CompareBuffers(), the exact cases the SIMD kernels.
+ */
+#include "pch.h"
+#include <benchmark/benchmark.h>
+#include "ByteComparator.h"
+#include "CompareOptions.h"
+#include "FileTextStats.h"
+#include "Corpus.h"
+
+using CompareEngines::ByteComparator;
+
+namespace
+{
+
+std::vector<char> TextBuffer(int nLines)
+{
+	const std::string text = Corpus::MakeText(nLines);
+	return std::vector<char>(text.begin(), text.end());
+}
+
+void BM_CompareBuffers(benchmark::State& state, int nLines, bool binary, WhitespaceIgnoreChoices whitespace, bool ignoreCase)
+{
+	const std::vector<char> left = binary ? Corpus::MakeBinary(static_cast<size_t>(nLines) * 40) : TextBuffer(nLines);
+	const std::vector<char> right = left;
+	QuickCompareOptions options;
+	options.m_ignoreWhitespace = whitespace;
+	options.m_bIgnoreCase = ignoreCase;
+	for (auto _ : state)
+	{
+		ByteComparator comparator(&options);
+		FileTextStats stats[2];
+		const char *ptr0 = left.data(), *ptr1 = right.data();
+		const auto result = comparator.CompareBuffers(stats[0], stats[1], ptr0, ptr1,
+			left.data() + left.size(), right.data() + right.size(), true, true, 0, 0);
+		benchmark::DoNotOptimize(result);
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * (left.size() + right.size())));
+}
+
+void BM_FindMismatch(benchmark::State& state, int nLines, ByteComparator::SIMD_LEVEL level)
+{
+	const std::vector<char> left = Corpus::MakeBinary(static_cast<size_t>(nLines) * 40);
+	const std::vector<char> right = left;
+	const auto previous = ByteComparator::SetSimdLevel(level);
+	if (ByteComparator::GetSimdLevel() != level)
+		state.SkipWithError("instruction set not supported");
+	for (auto _ : state)
+		benchmark::DoNotOptimize(ByteComparator::FindMismatch(left.data(), right.data(), left.size()));
+	ByteComparator::SetSimdLevel(previous);
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * (left.size() + right.size())));
+}
+
+}
+
+BENCHMARK_CAPTURE(BM_CompareBuffers, Small/text, Corpus::SmallLines, false, WHITESPACE_COMPARE_ALL, false);
+BENCHMARK_CAPTURE(BM_CompareBuffers, Small/text_ignore_space, Corpus::SmallLines, false, WHITESPACE_IGNORE_CHANGE, true);
+BENCHMARK_CAPTURE(BM_CompareBuffers, Small/binary, Corpus::SmallLines, true, WHITESPACE_COMPARE_ALL, false);
+BENCHMARK_CAPTURE(BM_CompareBuffers, Large/text, Corpus::LargeLines, false, WHITESPACE_COMPARE_ALL, false);
+BENCHMARK_CAPTURE(BM_CompareBuffers, Large/text_ignore_space, Corpus::LargeLines, false, WHITESPACE_IGNORE_CHANGE, true);
+BENCHMARK_CAPTURE(BM_CompareBuffers, Large/binary, Corpus::LargeLines, true, WHITESPACE_COMPARE_ALL, false);
+BENCHMARK_CAPTURE(BM_FindMismatch, Small/scalar, Corpus::SmallLines, ByteComparator::SIMD_NONE);
+BENCHMARK_CAPTURE(BM_FindMismatch, Small/sse2, Corpus::SmallLines, ByteComparator::SIMD_SSE2);
+BENCHMARK_CAPTURE(BM_FindMismatch, Small/avx2, Corpus::SmallLines, ByteComparator::SIMD_AVX2);
+BENCHMARK_CAPTURE(BM_FindMismatch, Large/scalar, Corpus::LargeLines, ByteComparator::SIMD_NONE);
+BENCHMARK_CAPTURE(BM_FindMismatch, Large/sse2, Corpus::LargeLines, ByteComparator::SIMD_SSE2);
+BENCHMARK_CAPTURE(BM_FindMismatch, Large/avx2, Corpus::LargeLines, ByteComparator::SIMD_AVX2);
@@ -0,0 +1,262 @@
+/**
+ * @file  Corpus.cpp
+ *
+ * @brief Generated inputs of the core benchmarks.
+ */
+#include "Corpus.h"
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace Corpus
+{
+
+namespace
+{
+
+unsigned Random(unsigned& seed, unsigned n)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 8) % n;
+}
+
+const char *Words[] = {
+	"value", "count", "result", "buffer", "index", "name", "offset", "length",
+	"compute", "update", "left", "right", "item", "options", "status", "file",
+};
+
+std::string MakeLine(int n, unsigned& seed)
+{
+	std::string line(Random(seed, 3) * 4, ' ');
+	switch (Random(seed, 4))
+	{
+	case 0:
+		line += "int ";
+		line += Words[Random(seed, 16)];
+		line += std::to_string(n) + " = " + Words[Random(seed, 16)] + "(" + std::to_string(Random(seed, 1000)) + ");";
+		break;
+	case 1:
+		line += "if (";
+		line += Words[Random(seed, 16)];
+		line += " < ";
+		line += Words[Random(seed, 16)];
+		line += ")";
+		break;
+	case 2:
+		line += "// ";
+		for (unsigned i = 0, nWords = 3 + Random(seed, 6); i < nWords; ++i)
+			line += std::string(Words[Random(seed, 16)]) + " ";
+		break;
+	default:
+		line += Words[Random(seed, 16)];
+		line += "->";
+		line += Words[Random(seed, 16)];
+		line += "(" + std::to_string(n) + ", " + Words[Random(seed, 16)] + ");";
+		break;
+	}
+	return line + "\n";
+}
+
+void WriteFile(const std::string& path, const void *data, size_t size)
+{
+	std::ofstream out(path, std::ios::binary);
+	out.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+}
+
+std::string MakeTempFolder()
+{
+	std::string path = (fs::temp_directory_path() / "CoreBench.XXXXXX").string();
+	if (!mkdtemp(path.data()))
+		throw fs::filesystem_error("mkdtemp", path, std::error_code(errno, std::generic_category()));
+	return path;
+}
+
+}
+
+/** @brief Source code like text of @p nLines lines. */
+std::string MakeText(int nLines, unsigned seed)
+{
+	std::string text;
+	text.reserve(static_cast<size_t>(nLines) * 40);
+	for (int i = 0; i < nLines; ++i)
+		text += MakeLine(i, seed);
+	return text;
+}
+
+/**
+ * @brief Copy of @p text with about every @p everyNth line changed.
+ * A third of the edits replace the line, a third insert a line before it
+ * and a third delete it.
+ */
+std::string EditText(const std::string& text, int everyNth, unsigned seed)
+{
+	std::string edited;
+	edited.reserve(text.size() + text.size() / 8);
+	int n = 0;
+	for (size_t pos = 0; pos < text.size(); ++n)
+	{
+		size_t eol = text.find('\n', pos);
+		eol = (eol == std::string::npos) ? text.size() : eol + 1;
+		const std::string line = text.substr(pos, eol - pos);
+		pos = eol;
+		if (Random(seed, everyNth) != 0)
+		{
+			edited += line;
+			continue;
+		}
+		switch (Random(seed, 3))
+		{
+		case 0: edited += MakeLine(n, seed); break;
+		case 1: edited += MakeLine(n, seed) + line; break;
+		default: break;
+		}
+	}
+	return edited;
+}
+
+/**
+ * @brief Copy of @p text with its lines cut into blocks and the blocks
+ * shuffled, like a refactoring moving functions around.
+ * The blocks are 1 to 2 * @p blockLines lines long.
+ */
+std::string ShuffleBlocks(const std::string& text, int blockLines, unsigned seed)
+{
+	const std::vector<std::string> lines = SplitLines(text);
+	std::vector<std::pair<size_t, size_t>> blocks;
+	for (size_t begin = 0; begin < lines.size(); )
+	{
+		const size_t end = (std::min)(lines.size(), begin + 1 + Random(seed, 2 * blockLines));
+		blocks.emplace_back(begin, end);
+		begin = end;
+	}
+	for (size_t i = blocks.size(); i > 1; --i)
+		std::swap(blocks[i - 1], blocks[Random(seed, static_cast<unsigned>(i))]);
+	std::string shuffled;
+	shuffled.reserve(text.size());
+	for (const auto& [begin, end] : blocks)
+	{
+		for (size_t i = begin; i < end; ++i)
+			shuffled += lines[i];
+	}
+	return shuffled;
+}
+
+/** @brief Binary data: random bytes with runs of zeros, like object files. */
+std::vector<char> MakeBinary(size_t size, unsigned seed)
+{
+	std::vector<char> data(size);
+	for (size_t i = 0; i < size; )
+	{
+		const size_t run = (std::min)(size - i, static_cast<size_t>(1 + Random(seed, 64)));
+		const bool zeros = Random(seed, 4) == 0;
+		for (size_t j = 0; j < run; ++j)
+			data[i + j] = zeros ? 0 : static_cast<char>(Random(seed, 256));
+		i += run;
+	}
+	return data;
+}
+
+/** @brief Lines of @p text including the EOLs. */
+std::vector<std::string> SplitLines(const std::string& text)
+{
+	std::vector<std::string> lines;
+	for (size_t pos = 0; pos < text.size(); )
+	{
+		size_t eol = text.find('\n', pos);
+		eol = (eol == std::string::npos) ? text.size() : eol + 1;
+		lines.push_back(text.substr(pos, eol - pos));
+		pos = eol;
+	}
+	return lines;
+}
+
+TempTree::TempTree(int nFiles, int nLines, int everyNth)
+: m_root(MakeTempFolder())
+{
+	fs::create_directories(fs::path(m_root) / "left");
+	fs::create_directories(fs::path(m_root) / "right");
+	for (int i = 0; i < nFiles; ++i)
+	{
+		const unsigned seed = 100 + i;
+		if (i % 8 == 7)
+		{
+			const std::string name = "file" + std::to_string(i) + ".bin";
+			std::vector<char> data = MakeBinary(static_cast<size_t>(nLines) * 40, seed);
+			WriteFile(Path(0, name), data.data(), data.size());
+			if (i % everyNth == 0)
+				data[data.size() / 2] ^= 1;
+			WriteFile(Path(1, name), data.data(), data.size());
+			m_names.push_back(name);
+		}
+		else
+		{
+			const std::string name = "file" + std::to_string(i) + ((i % 3 == 0) ? ".txt" : ".cpp");
+			const std::string text = MakeText(nLines, seed);
+			const std::string right = (i % everyNth == 0) ? EditText(text, 50, seed) : text;
+			WriteFile(Path(0, name), text.data(), text.size());
+			WriteFile(Path(1, name), right.data(), right.size());
+			m_names.push_back(name);
+		}
+	}
+}
+
+TempTree::~TempTree()
+{
+	std::error_code ec;
+	fs::remove_all(m_root, ec);
+}
+
+std::string TempTree::Path(int side, const std::string& name) const
+{
+	return (fs::path(m_root) / (side == 0 ? "left" : "right") / name).string();
+}
+
+TempFolderTree::TempFolderTree(int fanout, int depth)
+: m_root(MakeTempFolder())
+, m_nFolders(0)
+{
+	Add(Side(0), fanout, depth);
+	m_nFolders = 0;
+	Add(Side(1), fanout, depth);
+}
+
+TempFolderTree::~TempFolderTree()
+{
+	std::error_code ec;
+	fs::remove_all(m_root, ec);
+}
+
+std::string TempFolderTree::Side(int side) const
+{
+	return (fs::path(m_root) / (side == 0 ? "left" : "right")).string();
+}
+
+void TempFolderTree::Add(const std::string& dir, int fanout, int depth)
+{
+	fs::create_directories(dir);
+	++m_nFolders;
+	for (int i = 0; i < fanout; ++i)
+	{
+		WriteFile((fs::path(dir) / ("file" + std::to_string(i) + ".txt")).string(), "", 0);
+		if (depth > 0)
+			Add((fs::path(dir) / ("dir" + std::to_string(i))).string(), fanout, depth - 1);
+	}
+}
+
+TempFile::TempFile(const std::string& name, const void *data, size_t size)
+: m_path((fs::temp_directory_path() / ("CoreBench." + std::to_string(getpid()) + "." + name)).string())
+{
+	WriteFile(m_path, data, size);
+}
+
+TempFile::~TempFile()
+{
+	std::error_code ec;
+	fs::remove(m_path, ec);
+}
+
+}
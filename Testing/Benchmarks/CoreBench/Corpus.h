@@ -0,0 +1,87 @@
+/**
+ * @file  Corpus.h
+ *
+ * @brief Generated inputs of the core benchmarks.
+ *
+ * The corpora are deterministic, so runs on different machines or
+ * revisions time the same work.
+ */
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Corpus
+{
+
+constexpr int SmallLines = 200; /**< Lines of a small text file, about 8 KB */
+constexpr int LargeLines = 100000; /**< Lines of a large text file, about 4 MB */
+
+std::string MakeText(int nLines, unsigned seed = 1);
+std::string EditText(const std::string& text, int everyNth, unsigned seed = 2);
+std::string ShuffleBlocks(const std::string& text, int blockLines, unsigned seed = 4);
+std::vector<char> MakeBinary(size_t size, unsigned seed = 3);
+std::vector<std::string> SplitLines(const std::string& text);
+
+/**
+ * @brief Folder of generated files, removed when the object is destroyed.
+ * The left and right subfolders contain the same file names; every
+ * @p everyNth right file is edited and every 8th file pair is binary.
+ */
+class TempTree
+{
+public:
+	TempTree(int nFiles, int nLines, int everyNth = 4);
+	~TempTree();
+	TempTree(const TempTree&) = delete;
+	TempTree& operator=(const TempTree&) = delete;
+
+	const std::string& Root() const { return m_root; }
+	const std::vector<std::string>& Names() const { return m_names; }
+	std::string Path(int side, const std::string& name) const;
+
+private:
+	std::string m_root;
+	std::vector<std::string> m_names;
+};
+
+/**
+ * @brief Deep tree of small folders, removed when the object is destroyed.
+ * The left and right subfolders have the same tree: every folder has
+ * @p fanout empty files and, down to @p depth levels, @p fanout subfolders.
+ */
+class TempFolderTree
+{
+public:
+	TempFolderTree(int fanout, int depth);
+	~TempFolderTree();
+	TempFolderTree(const TempFolderTree&) = delete;
+	TempFolderTree& operator=(const TempFolderTree&) = delete;
+
+	std::string Side(int side) const;
+	int FolderCount() const { return m_nFolders; }
+
+private:
+	void Add(const std::string& dir, int fanout, int depth);
+
+	std::string m_root;
+	int m_nFolders; /**< Folders of each side */
+};
+
+/** @brief Generated file written to the temporary folder, removed by the destructor. */
+class TempFile
+{
+public:
+	TempFile(const std::string& name, const void *data, size_t size);
+	~TempFile();
+	TempFile(const TempFile&) = delete;
+	TempFile& operator=(const TempFile&) = delete;
+
+	const std::string& Path() const { return m_path; }
+
+private:
+	std::string m_path;
+};
+
+}
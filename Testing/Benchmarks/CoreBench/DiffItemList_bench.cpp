@@ -0,0 +1,227 @@
+/**
+ * @file  DiffItemList_bench.cpp
+ *
+ * @brief Memory and teardown time of the folder compare tree.
+ *
+ * Builds a tree of 1000 folders of 200 files, 2-way, with the names set
+ * like DirScan does. The heap cases allocate every DIFFITEM with `new` and
+ * delete the tree from its root, like DiffItemList did; the arena cases
+ * use DiffItemList. The details cases also set the encoding and the text
+ * stats of both sides, like a full contents compare does.
+ *
+ * The time is the teardown alone. bytes_per_item is the heap growth while
+ * building the tree, divided by the number of items.
+ *
+ * The folder status cases read the status of every folder of a tree three
+ * levels deep, like the folder icons of an expanded tree. The walk cases
+ * classify the items below each folder recursively, like
+ * CDirSideBySideCoordinator::ComputeFolderContentStatus() did on a cache
+ * miss; the counts cases read the folder counts the compare keeps. The
+ * update case times changing the results of 2% of the files and setting
+ * the others again, with the counts of their ancestors updated.
+ */
+#include "pch.h"
+#include <benchmark/benchmark.h>
+#include <malloc.h>
+#include <string>
+#include <vector>
+#include "DiffItemList.h"
+
+namespace
+{
+
+const int FolderCount = 1000;
+const int FileCount = 200;
+
+size_t HeapInUse()
+{
+	return mallinfo2().uordblks;
+}
+
+void SetItem(DIFFITEM& di, const String& path, const String& name, bool details)
+{
+	for (int i = 0; i < 2; ++i)
+	{
+		di.diffcode.setSideFlag(i);
+		di.diffFileInfo[i].path = path;
+		di.diffFileInfo[i].filename = name;
+		di.diffFileInfo[i].size = 1000;
+		if (details)
+		{
+			di.diffFileInfo[i].GetEncodingRef().SetCodepage(65001);
+			di.diffFileInfo[i].GetTextStatsRef().nlfs = 10;
+		}
+	}
+}
+
+template <class AddItem>
+void BuildTree(AddItem addItem, bool details)
+{
+	for (int d = 0; d < FolderCount; ++d)
+	{
+		const String folder = _T("folder") + std::to_string(d);
+		DIFFITEM *dir = addItem(nullptr);
+		SetItem(*dir, String(), folder, false);
+		for (int f = 0; f < FileCount; ++f)
+			SetItem(*addItem(dir), folder, _T("file") + std::to_string(f) + _T(".txt"), details);
+	}
+}
+
+void BM_DiffItemTree(benchmark::State& state, bool arena, bool details)
+{
+	const double nItems = FolderCount * (FileCount + 1);
+	double bytesPerItem = 0;
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		const size_t heapBefore = HeapInUse();
+		DiffItemList list;
+		DIFFITEM *root = nullptr;
+		if (arena)
+		{
+			list.InitDiffItemList();
+			BuildTree([&](DIFFITEM *parent) { return list.AddNewDiff(parent); }, details);
+		}
+		else
+		{
+			root = new DIFFITEM;
+			BuildTree([&](DIFFITEM *parent)
+				{
+					DIFFITEM *p = new DIFFITEM;
+					(parent ? parent : root)->AddChildToParent(p);
+					return p;
+				}, details);
+		}
+		bytesPerItem = (HeapInUse() - heapBefore) / nItems;
+		state.ResumeTiming();
+
+		if (arena)
+			list.RemoveAll();
+		else
+			delete root;
+	}
+	state.counters["bytes_per_item"] = bytesPerItem;
+	state.counters["sizeof_DIFFITEM"] = sizeof(DIFFITEM);
+	state.counters["items_per_second"] = benchmark::Counter(nItems * state.iterations(), benchmark::Counter::kIsRate);
+}
+
+
+const int TreeFanout = 10;
+const int TreeDepth = 3;
+const int TreeFileCount = 20;
+
+void BuildFolder(DiffItemList& list, DIFFITEM *parent, int depth, std::vector<DIFFITEM *>& folders, std::vector<DIFFITEM *>& files)
+{
+	for (int f = 0; f < TreeFileCount; ++f)
+	{
+		DIFFITEM *file = list.AddNewDiff(parent);
+		file->diffcode.diffcode = DIFFCODE::FILE | DIFFCODE::BOTH;
+		file->UpdateFolderCounts();
+		files.push_back(file);
+	}
+	if (depth == TreeDepth)
+		return;
+	for (int d = 0; d < TreeFanout; ++d)
+	{
+		DIFFITEM *dir = list.AddNewDiff(parent);
+		dir->diffcode.diffcode = DIFFCODE::DIR | DIFFCODE::BOTH;
+		dir->UpdateFolderCounts();
+		folders.push_back(dir);
+		BuildFolder(list, dir, depth + 1, folders, files);
+	}
+}
+
+/** @brief One file in 100 differs, starting from file @p first */
+void SetResults(std::vector<DIFFITEM *>& files, size_t first)
+{
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		DIFFITEM *file = files[i];
+		file->diffcode.diffcode &= ~DIFFCODE::COMPAREFLAGS;
+		file->diffcode.diffcode |= (i % 100 == first) ? DIFFCODE::DIFF : DIFFCODE::SAME;
+		file->UpdateFolderCounts();
+	}
+}
+
+struct Tree
+{
+	DiffItemList list;
+	std::vector<DIFFITEM *> folders;
+	std::vector<DIFFITEM *> files;
+
+	Tree()
+	{
+		list.InitDiffItemList();
+		BuildFolder(list, nullptr, 0, folders, files);
+		SetResults(files, 0);
+	}
+};
+
+Tree& GetTree()
+{
+	static Tree tree;
+	return tree;
+}
+
+/** @brief Same/diff/unique flags of the items below @p di, 1/2/4 */
+int WalkFolder(const DIFFITEM& di)
+{
+	int flags = 0;
+	for (const DIFFITEM *child = di.GetFirstChild(); child != nullptr; child = child->GetFwdSiblingLink())
+	{
+		if (child->diffcode.isResultFiltered())
+			continue;
+		if (!child->diffcode.existAll())
+			flags |= 4;
+		else if (child->diffcode.isResultSame())
+			flags |= 1;
+		else if (child->diffcode.isResultDiff())
+			flags |= 2;
+		if (child->diffcode.isDirectory() && child->HasChildren())
+			flags |= WalkFolder(*child);
+	}
+	return flags;
+}
+
+int ReadFolderCounts(const DIFFITEM& di)
+{
+	const FolderCounts& counts = di.GetFolderCounts();
+	return (counts.Get(FolderCounts::SAME) > 0 ? 1 : 0) |
+		(counts.Get(FolderCounts::DIFF) > 0 ? 2 : 0) |
+		(counts.Get(FolderCounts::UNIQUE) > 0 ? 4 : 0);
+}
+
+void BM_FolderStatus(benchmark::State& state, bool counts)
+{
+	Tree& tree = GetTree();
+	int nMixed = 0;
+	for (auto _ : state)
+	{
+		nMixed = 0;
+		for (const DIFFITEM *folder : tree.folders)
+			nMixed += (counts ? ReadFolderCounts(*folder) : WalkFolder(*folder)) == 3;
+		benchmark::DoNotOptimize(nMixed);
+	}
+	state.counters["folders"] = static_cast<double>(tree.folders.size());
+	state.counters["mixed"] = nMixed;
+}
+
+void BM_FolderCountsUpdate(benchmark::State& state)
+{
+	Tree& tree = GetTree();
+	size_t first = 0;
+	for (auto _ : state)
+		SetResults(tree.files, first = 1 - first);
+	SetResults(tree.files, 0);
+	state.counters["items_per_second"] = benchmark::Counter(static_cast<double>(tree.files.size()) * state.iterations(), benchmark::Counter::kIsRate);
+}
+
+}
+
+BENCHMARK_CAPTURE(BM_DiffItemTree, heap, false, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_DiffItemTree, arena, true, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_DiffItemTree, heap/details, false, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_DiffItemTree, arena/details, true, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_FolderStatus, walk, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_FolderStatus, counts, true)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FolderCountsUpdate)->Unit(benchmark::kMillisecond);
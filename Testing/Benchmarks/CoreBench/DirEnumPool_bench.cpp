@@ -0,0 +1,162 @@
+/**
+ * @file  DirEnumPool_bench.cpp
+ *
+ * @brief Recursive listing of a deep tree of small folders.
+ *
+ * Every iteration walks the left and right trees the way
+ * DirScan_GetItems() does: list both sides of a folder, match the names
+ * and walk into the subfolders found on both sides. The per-level cases
+ * start and join a thread per side at every folder, like DirScan did, the
+ * pool cases list the folders with DirEnumPool, which lists the
+ * subfolders ahead of the walk on its threads.
+ */
+#include "pch.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <thread>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "DirEnumPool.h"
+#include "DirItem.h"
+#include "paths.h"
+#include "Corpus.h"
+
+namespace
+{
+
+const Corpus::TempFolderTree& Tree(int fanout, int depth)
+{
+	static std::map<std::pair<int, int>, std::unique_ptr<Corpus::TempFolderTree>> trees;
+	auto& tree = trees[{ fanout, depth }];
+	if (!tree)
+		tree.reset(new Corpus::TempFolderTree(fanout, depth));
+	return *tree;
+}
+
+/** @brief List a folder sorted by name, like DirTravel::LoadAndSortFiles(). */
+void LoadAndSortFiles(const String& sDir, DirItemArray *dirs, DirItemArray *files)
+{
+	DIR *dir = opendir(sDir.c_str());
+	if (dir == nullptr)
+		return;
+	boost::flyweight<String> path(sDir);
+	while (const dirent *ent = readdir(dir))
+	{
+		if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+			continue;
+		struct stat st;
+		if (fstatat(dirfd(dir), ent->d_name, &st, 0) != 0)
+			continue;
+		DirItem item;
+		item.mtime = Poco::Timestamp::fromEpochTime(st.st_mtime);
+		item.size = S_ISDIR(st.st_mode) ? static_cast<int64_t>(DirItem::FILE_SIZE_NONE) : st.st_size;
+		item.path = path;
+		item.filename = String(ent->d_name);
+		(S_ISDIR(st.st_mode) ? dirs : files)->push_back(item);
+	}
+	closedir(dir);
+	auto byName = [](const DirItem& a, const DirItem& b) { return a.filename.get() < b.filename.get(); };
+	std::sort(dirs->begin(), dirs->end(), byName);
+	std::sort(files->begin(), files->end(), byName);
+}
+
+/** @brief Names of the subfolders found on both sides. */
+std::vector<String> MatchSubdirs(const DirItemArray dirs[2])
+{
+	std::vector<String> both;
+	for (size_t i = 0, j = 0; i < dirs[0].size() && j < dirs[1].size(); )
+	{
+		const String& left = dirs[0][i].filename.get();
+		const String& right = dirs[1][j].filename.get();
+		if (left < right)
+			++i;
+		else if (right < left)
+			++j;
+		else
+		{
+			both.push_back(left);
+			++i;
+			++j;
+		}
+	}
+	return both;
+}
+
+/** @brief Walk with a pair of threads started at every folder, return the items found. */
+size_t WalkPerLevel(const String sDir[2])
+{
+	DirItemArray dirs[2], files[2];
+	std::thread threads[2];
+	for (int nIndex = 0; nIndex < 2; ++nIndex)
+		threads[nIndex] = std::thread([&, nIndex]() { LoadAndSortFiles(sDir[nIndex], &dirs[nIndex], &files[nIndex]); });
+	for (auto& thread : threads)
+		thread.join();
+	size_t nItems = dirs[0].size() + files[0].size() + dirs[1].size() + files[1].size();
+	for (const auto& name : MatchSubdirs(dirs))
+	{
+		const String subdir[2] = { paths::ConcatPath(sDir[0], name), paths::ConcatPath(sDir[1], name) };
+		nItems += WalkPerLevel(subdir);
+	}
+	return nItems;
+}
+
+/** @brief Walk with the folders listed by @p pool, return the items found. */
+size_t WalkPool(DirEnumPool& pool, const String sDir[2])
+{
+	DirEnumPool::Listing *listings[2];
+	for (int nIndex = 0; nIndex < 2; ++nIndex)
+		pool.Request(sDir[nIndex]);
+	for (int nIndex = 0; nIndex < 2; ++nIndex)
+		listings[nIndex] = pool.Get(sDir[nIndex]);
+	const DirItemArray dirs[2] = { listings[0]->dirs, listings[1]->dirs };
+	size_t nItems = 0;
+	for (int nIndex = 0; nIndex < 2; ++nIndex)
+	{
+		nItems += listings[nIndex]->dirs.size() + listings[nIndex]->files.size();
+		pool.Release(listings[nIndex]);
+	}
+	for (const auto& name : MatchSubdirs(dirs))
+	{
+		const String subdir[2] = { paths::ConcatPath(sDir[0], name), paths::ConcatPath(sDir[1], name) };
+		nItems += WalkPool(pool, subdir);
+	}
+	return nItems;
+}
+
+void BM_WalkTree(benchmark::State& state, int fanout, int depth, bool usePool)
+{
+	const Corpus::TempFolderTree& tree = Tree(fanout, depth);
+	const String roots[2] = { tree.Side(0), tree.Side(1) };
+	const int nThreads = (std::max)(2, static_cast<int>(std::thread::hardware_concurrency()));
+	size_t nItems = 0;
+	for (auto _ : state)
+	{
+		if (usePool)
+		{
+			DirEnumPool pool([](const String& sDir, DirItemArray *dirs, DirItemArray *files)
+				{
+					LoadAndSortFiles(sDir, dirs, files);
+				}, nThreads);
+			nItems = WalkPool(pool, roots);
+		}
+		else
+		{
+			nItems = WalkPerLevel(roots);
+		}
+		benchmark::DoNotOptimize(nItems);
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * nItems));
+	state.counters["folders"] = static_cast<double>(tree.FolderCount() * 2);
+	state.counters["items"] = static_cast<double>(nItems);
+}
+
+}
+
+BENCHMARK_CAPTURE(BM_WalkTree, Small/perlevel, 3, 3, false);
+BENCHMARK_CAPTURE(BM_WalkTree, Small/pool, 3, 3, true);
+BENCHMARK_CAPTURE(BM_WalkTree, Large/perlevel, 4, 6, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_WalkTree, Large/pool, 4, 6, true)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,108 @@
+/**
+ * @file  DuplicateFinder_bench.cpp
+ *
+ * @brief Duplicate files among a folder of generated files.
+ *
+ * The folder has 256 files of about 1 MB. A quarter of them are copies of
+ * another file, a quarter have the size of another file but differ in the
+ * middle, and the rest have sizes of their own. The naive cases hash every
+ * file whole and group them in a std::map, like
+ * CDiffContext::CreateDuplicateValueMap() did with the hash property values,
+ * the finder cases let DuplicateFinder skip the unique sizes and the files
+ * whose ends differ. The files stay in the page cache, so the cases time the
+ * digests and the lookups rather than the disk.
+ */
+#include "pch.h"
+#include <benchmark/benchmark.h>
+#include <map>
+#include <memory>
+#include "DuplicateFinder.h"
+#include "HashCalc.h"
+#include "Corpus.h"
+
+namespace
+{
+
+const int FileCount = 256;
+
+struct Folder
+{
+	std::vector<std::unique_ptr<Corpus::TempFile>> files;
+	std::vector<int64_t> sizes;
+};
+
+const Folder& GetFolder()
+{
+	static const Folder folder = []()
+	{
+		Folder folder;
+		const std::vector<char> data = Corpus::MakeBinary(4 * 1024 * 1024);
+		for (int i = 0; i < FileCount; ++i)
+		{
+			size_t size = 1024 * 1024 + i * 4096;
+			std::vector<char> content(data.begin() + i * 4096, data.begin() + i * 4096 + size);
+			if (i % 4 == 1)
+			{
+				// Copy of the previous file
+				size = folder.sizes.back();
+				content.assign(data.begin() + (i - 1) * 4096, data.begin() + (i - 1) * 4096 + size);
+			}
+			else if (i % 4 == 2)
+			{
+				// Same size and ends as the copies, different middle
+				size = folder.sizes.back();
+				content.assign(data.begin() + (i - 2) * 4096, data.begin() + (i - 2) * 4096 + size);
+				content[size / 2] ^= 1;
+			}
+			folder.files.push_back(std::make_unique<Corpus::TempFile>("dup." + std::to_string(i), content.data(), size));
+			folder.sizes.push_back(static_cast<int64_t>(size));
+		}
+		return folder;
+	}();
+	return folder;
+}
+
+void BM_FindDuplicates_naive(benchmark::State& state)
+{
+	const Folder& folder = GetFolder();
+	int nGroups = 0;
+	for (auto _ : state)
+	{
+		std::map<std::vector<uint8_t>, int> counts;
+		HashCalc::Hashes hashes;
+		for (const auto& file : folder.files)
+		{
+			HashCalc::HashFile(file->Path(), HashCalc::Flag(HashCalc::XXH3), hashes);
+			++counts[hashes[HashCalc::XXH3]];
+		}
+		nGroups = 0;
+		for (const auto& count : counts)
+			nGroups += count.second > 1;
+		benchmark::DoNotOptimize(nGroups);
+	}
+	state.counters["groups"] = nGroups;
+	state.counters["files_read"] = FileCount;
+}
+
+void BM_FindDuplicates_finder(benchmark::State& state)
+{
+	const Folder& folder = GetFolder();
+	int nGroups = 0;
+	int nFullHashes = 0;
+	for (auto _ : state)
+	{
+		DuplicateFinder finder(static_cast<int>(state.range(0)));
+		for (int i = 0; i < FileCount; ++i)
+			finder.AddFile(folder.files[i]->Path(), folder.sizes[i]);
+		nGroups = finder.Find();
+		nFullHashes = finder.GetFullHashCount();
+		benchmark::DoNotOptimize(nGroups);
+	}
+	state.counters["groups"] = nGroups;
+	state.counters["files_read"] = nFullHashes;
+}
+
+}
+
+BENCHMARK(BM_FindDuplicates_naive)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FindDuplicates_finder)->Arg(1)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,167 @@
+/**
+ * @file  FilterList_bench.cpp
+ *
+ * @brief Regular expression filters matched against file names and lines.
+ *
+ * FilterList is the matcher behind the line filters, MultiPatternMatcher
+ * the one behind the file filter rules. The file name cases match a typical
+ * set of file filter rules, and the same set grown to 300 rules like the
+ * stock filters plus a project filter, against the paths of a source tree
+ * with FilterList and with MultiPatternMatcher alone. The line cases match
+ * comment and blank line filters against every line of a file, and against
+ * the lines of generated files repeating a license header and a timestamp,
+ * whose verdicts FilterList remembers.
+ */
+#include "pch.h"
+#include <benchmark/benchmark.h>
+#include <Poco/RegularExpression.h>
+#include "FilterList.h"
+#include "MultiPatternMatcher.h"
+#include "Corpus.h"
+
+namespace
+{
+
+const char *FileRules[] = {
+	"\\.obj$", "\\.o$", "\\.pch$", "\\.pdb$", "\\.ilk$", "\\.exe$", "\\.dll$", "\\.lib$",
+	"\\.bak$", "~$", "\\.tmp$", "\\\\\\.git\\\\", "\\\\\\.svn\\\\", "\\\\build\\\\", "\\\\Debug\\\\", "\\\\Release\\\\",
+};
+
+const char *MoreFileRules[] = {
+	"^vc\\d+\\.idb$", "^BuildLog\\.htm$", "\\.(exe|dll)\\.manifest$", "^~\\$", "\\\\node_modules\\\\",
+};
+
+std::vector<std::string> MakeFileRules(int nRules)
+{
+	std::vector<std::string> rules(std::begin(FileRules), std::end(FileRules));
+	if (nRules > static_cast<int>(rules.size()))
+		rules.insert(rules.end(), std::begin(MoreFileRules), std::end(MoreFileRules));
+	for (int i = 0; static_cast<int>(rules.size()) < nRules; ++i)
+		rules.push_back("\\.x" + std::to_string(i) + "$");
+	return rules;
+}
+
+const char *LineRules[] = {
+	"^\\s*//", "^\\s*$", "^\\s*#\\s*include", "^\\s*/?\\*",
+};
+
+std::vector<std::string> FileNames(int nFiles)
+{
+	static const char *folders[] = { "Src", "Src\\Common", "Build\\Release", "Externals\\poco", "Testing" };
+	static const char *exts[] = { ".cpp", ".h", ".obj", ".txt", ".rc", ".pdb" };
+	std::vector<std::string> names;
+	for (int i = 0; i < nFiles; ++i)
+		names.push_back(std::string("\\") + folders[i % 5] + "\\file" + std::to_string(i) + exts[i % 6]);
+	return names;
+}
+
+void BM_MatchFileNames(benchmark::State& state, int nFiles, int nRules)
+{
+	FilterList filterList;
+	for (const auto& rule : MakeFileRules(nRules))
+		filterList.AddRegExp(rule);
+	const auto names = FileNames(nFiles);
+	int nMatches = 0;
+	for (auto _ : state)
+	{
+		nMatches = 0;
+		for (const auto& name : names)
+			nMatches += filterList.Match(name);
+		benchmark::DoNotOptimize(nMatches);
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * names.size()));
+	state.counters["matches"] = nMatches;
+}
+
+void BM_MatchFileNamesCompiled(benchmark::State& state, int nFiles, int nRules)
+{
+	MultiPatternMatcher matcher;
+	for (const auto& rule : MakeFileRules(nRules))
+		matcher.AddPattern(rule, Poco::RegularExpression::RE_UTF8);
+	matcher.Compile();
+	const auto names = FileNames(nFiles);
+	int nMatches = 0;
+	for (auto _ : state)
+	{
+		nMatches = 0;
+		for (const auto& name : names)
+			nMatches += matcher.Match(name);
+		benchmark::DoNotOptimize(nMatches);
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * names.size()));
+	state.counters["matches"] = nMatches;
+}
+
+void BM_MatchLines(benchmark::State& state, int nLines)
+{
+	FilterList filterList;
+	for (const char *rule : LineRules)
+		filterList.AddRegExp(rule);
+	const auto lines = Corpus::SplitLines(Corpus::MakeText(nLines));
+	int nMatches = 0;
+	for (auto _ : state)
+	{
+		nMatches = 0;
+		for (const auto& line : lines)
+			nMatches += filterList.Match(line);
+		benchmark::DoNotOptimize(nMatches);
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * lines.size()));
+	state.counters["matches"] = nMatches;
+}
+
+/** @brief Lines of generated files, a license header and a timestamp before each block of code. */
+std::vector<std::string> GeneratedLines(int nLines)
+{
+	static const char *header[] = {
+		"// Copyright (c) Example Corporation. All rights reserved.",
+		"// Licensed under the MIT License.",
+		"//",
+		"// This file was generated by a tool, do not edit.",
+		"// Generated on 2024-01-01 12:00:00",
+		"",
+	};
+	const auto code = Corpus::SplitLines(Corpus::MakeText(nLines));
+	std::vector<std::string> lines;
+	for (size_t i = 0; lines.size() < static_cast<size_t>(nLines) && i < code.size(); ++i)
+	{
+		if (i % 20 == 0)
+			lines.insert(lines.end(), std::begin(header), std::end(header));
+		lines.push_back(code[i]);
+	}
+	return lines;
+}
+
+void BM_MatchGeneratedLines(benchmark::State& state, int nLines)
+{
+	FilterList filterList;
+	for (const char *rule : LineRules)
+		filterList.AddRegExp(rule);
+	filterList.AddRegExp("Generated on \\d{4}-\\d{2}-\\d{2}");
+	const auto lines = GeneratedLines(nLines);
+	int nMatches = 0;
+	for (auto _ : state)
+	{
+		nMatches = 0;
+		for (const auto& line : lines)
+			nMatches += filterList.Match(line);
+		benchmark::DoNotOptimize(nMatches);
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * lines.size()));
+	state.counters["matches"] = nMatches;
+}
+
+}
+
+BENCHMARK_CAPTURE(BM_MatchFileNames, Small, 1000, 16);
+BENCHMARK_CAPTURE(BM_MatchFileNames, Large, 100000, 16)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_MatchFileNames, Small_300Rules, 1000, 300);
+BENCHMARK_CAPTURE(BM_MatchFileNames, Large_300Rules, 100000, 300)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_MatchFileNamesCompiled, Small, 1000, 16);
+BENCHMARK_CAPTURE(BM_MatchFileNamesCompiled, Large, 100000, 16)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_MatchFileNamesCompiled, Small_300Rules, 1000, 300);
+BENCHMARK_CAPTURE(BM_MatchFileNamesCompiled, Large_300Rules, 100000, 300)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_MatchLines, Small, Corpus::SmallLines);
+BENCHMARK_CAPTURE(BM_MatchLines, Large, Corpus::LargeLines)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_MatchGeneratedLines, Small, Corpus::SmallLines);
+BENCHMARK_CAPTURE(BM_MatchGeneratedLines, Large, Corpus::LargeLines)->Unit(benchmark::kMillisecond);
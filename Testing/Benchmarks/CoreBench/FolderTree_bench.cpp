@@ -0,0 +1,103 @@
+/**
+ * @file  FolderTree_bench.cpp
+ *
+ * @brief Full contents compare of a generated folder tree.
+ *
+ * Walks the file pairs of a tree the way the folder compare does for
+ * each item: match the file filters, read both files, detect the
+ * encodings, quick compare the contents and line diff the text pairs
+ * that differ. The tree has text and binary files, a quarter of the
+ * pairs differ. Measures the per-item overhead of the core rather than
+ * of a single algorithm.
+ */
+#include "pch.h"
+#include <benchmark/benchmark.h>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#define NOMINMAX
+#include "ByteComparator.h"
+#include "CompareOptions.h"
+#include "FileTextStats.h"
+#include "FilterList.h"
+#include "codepage_detect.h"
+#include "diff.h"
+#include "xdiff_gnudiff_compat.h"
+#include "Corpus.h"
+
+namespace
+{
+
+const Corpus::TempTree& Tree(int nFiles, int nLines)
+{
+	static std::map<std::pair<int, int>, std::unique_ptr<Corpus::TempTree>> trees;
+	auto& tree = trees[{ nFiles, nLines }];
+	if (!tree)
+		tree.reset(new Corpus::TempTree(nFiles, nLines));
+	return *tree;
+}
+
+std::vector<char> ReadFile(const std::string& path)
+{
+	std::ifstream in(path, std::ios::binary);
+	return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void BM_CompareTree(benchmark::State& state, int nFiles, int nLines)
+{
+	const Corpus::TempTree& tree = Tree(nFiles, nLines);
+	FilterList filterList;
+	filterList.AddRegExp("\\.obj$");
+	filterList.AddRegExp("\\.pdb$");
+	filterList.AddRegExp("~$");
+	QuickCompareOptions quickOptions;
+	DiffutilsOptions diffOptions;
+	diffOptions.m_diffAlgorithm = DIFF_ALGORITHM_HISTOGRAM;
+	const unsigned xdl_flags = make_xdl_flags(diffOptions);
+	int nDiffer = 0, nBinary = 0;
+	size_t nBytes = 0;
+	for (auto _ : state)
+	{
+		nDiffer = nBinary = 0;
+		nBytes = 0;
+		for (const auto& name : tree.Names())
+		{
+			if (filterList.Match(name))
+				continue;
+			const std::vector<char> data[2] = { ReadFile(tree.Path(0, name)), ReadFile(tree.Path(1, name)) };
+			nBytes += data[0].size() + data[1].size();
+			FileTextEncoding encoding[2];
+			for (int i = 0; i < 2; ++i)
+				encoding[i] = codepage_detect::Guess(name.substr(name.rfind('.')), data[i].data(), data[i].size(), 1);
+
+			CompareEngines::ByteComparator comparator(&quickOptions);
+			FileTextStats stats[2];
+			const char *ptr0 = data[0].data(), *ptr1 = data[1].data();
+			const auto result = comparator.CompareBuffers(stats[0], stats[1], ptr0, ptr1,
+				data[0].data() + data[0].size(), data[1].data() + data[1].size(), true, true, 0, 0);
+			if (stats[0].nzeros > 0 || stats[1].nzeros > 0)
+				++nBinary;
+			if (result != CompareEngines::ByteComparator::RESULT_DIFF)
+				continue;
+			++nDiffer;
+			if (stats[0].nzeros > 0 || stats[1].nzeros > 0)
+				continue;
+			change *script = diff_2_buffers_xdiff(data[0].data(), data[0].size(), data[1].data(), data[1].size(), xdl_flags);
+			for (change *e = script, *p = nullptr; e != nullptr; e = p)
+			{
+				p = e->link;
+				free(e);
+			}
+		}
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * tree.Names().size()));
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * nBytes));
+	state.counters["differ"] = nDiffer;
+	state.counters["binary"] = nBinary;
+}
+
+}
+
+BENCHMARK_CAPTURE(BM_CompareTree, Small, 100, 50)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_CompareTree, Large, 2000, 200)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,73 @@
+/**
+ * @file  HashCalc_bench.cpp
+ *
+ * @brief Digests of a file for the hash property columns.
+ *
+ * Every iteration computes the MD5, SHA-1 and SHA-256 digests of a binary
+ * file. The separate cases read the file once per digest, like
+ * PropertySystem::GetPropertyValues() did, the one-pass cases read it once
+ * and feed all three digests. The XXH3 cases compute the XXH3 digest alone.
+ * The files stay in the page cache, so the cases time the digests rather
+ * than the disk.
+ */
+#include "pch.h"
+#include <benchmark/benchmark.h>
+#include "HashCalc.h"
+#include "Corpus.h"
+
+namespace
+{
+
+const unsigned CryptoAlgorithms = HashCalc::Flag(HashCalc::MD5) | HashCalc::Flag(HashCalc::SHA1)
+	| HashCalc::Flag(HashCalc::SHA256);
+
+const Corpus::TempFile& File(size_t size)
+{
+	static const std::vector<char> smallData = Corpus::MakeBinary(1024 * 1024);
+	static const std::vector<char> largeData = Corpus::MakeBinary(64 * 1024 * 1024);
+	static const Corpus::TempFile small("hash.small", smallData.data(), smallData.size());
+	static const Corpus::TempFile large("hash.large", largeData.data(), largeData.size());
+	return size == smallData.size() ? small : large;
+}
+
+enum class Mode { Separate, OnePass, Xxh3 };
+
+void BM_HashFile(benchmark::State& state, size_t size, Mode mode)
+{
+	const String path = File(size).Path();
+	HashCalc::Hashes hashes;
+	size_t nBytesRead = 0;
+	for (auto _ : state)
+	{
+		switch (mode)
+		{
+		case Mode::Separate:
+			for (int i = HashCalc::MD5; i <= HashCalc::SHA256; ++i)
+			{
+				HashCalc::HashFile(path, HashCalc::Flag(static_cast<HashCalc::Algorithm>(i)), hashes);
+				nBytesRead += size;
+			}
+			break;
+		case Mode::OnePass:
+			HashCalc::HashFile(path, CryptoAlgorithms, hashes);
+			nBytesRead += size;
+			break;
+		case Mode::Xxh3:
+			HashCalc::HashFile(path, HashCalc::Flag(HashCalc::XXH3), hashes);
+			nBytesRead += size;
+			break;
+		}
+		benchmark::DoNotOptimize(hashes);
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size));
+	state.counters["bytes_read"] = static_cast<double>(nBytesRead) / state.iterations();
+}
+
+}
+
+BENCHMARK_CAPTURE(BM_HashFile, Small/separate, 1024 * 1024, Mode::Separate);
+BENCHMARK_CAPTURE(BM_HashFile, Small/onepass, 1024 * 1024, Mode::OnePass);
+BENCHMARK_CAPTURE(BM_HashFile, Small/xxh3, 1024 * 1024, Mode::Xxh3);
+BENCHMARK_CAPTURE(BM_HashFile, Large/separate, 64 * 1024 * 1024, Mode::Separate)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_HashFile, Large/onepass, 64 * 1024 * 1024, Mode::OnePass)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_HashFile, Large/xxh3, 64 * 1024 * 1024, Mode::Xxh3)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,116 @@
+/**
+ * @file  HunkNormalizer_bench.cpp
+ *
+ * @brief Normalization of diff hunks for the ignore options.
+ *
+ * Every iteration normalizes the hunks of a file pair with the whitespace,
+ * numbers, case and EOL differences ignored, and joins their lines like
+ * the ignore line breaks option does. The stepwise cases do it one option
+ * at a time on a copy of each hunk, like CDiffWrapper::PostFilter() did,
+ * the fused cases with HunkNormalizer into reused buffers.
+ */
+#include "pch.h"
+#include <benchmark/benchmark.h>
+#include <cctype>
+#include <cstring>
+#include "HunkNormalizer.h"
+#include "CompareOptions.h"
+#include "Corpus.h"
+
+namespace
+{
+
+void Replace(std::string &target, const std::string &find, const std::string &replace)
+{
+	std::string::size_type pos = 0;
+	while ((pos = target.find(find, pos)) != std::string::npos)
+	{
+		target.replace(pos, find.length(), replace);
+		pos += replace.length();
+	}
+}
+
+void ReplaceChars(std::string & str, const char* chars, const char *rep)
+{
+	std::string::size_type pos = 0;
+	size_t replen = strlen(rep);
+	while ((pos = str.find_first_of(chars, pos)) != std::string::npos)
+	{
+		std::string::size_type posend = str.find_first_not_of(chars, pos);
+		if (posend != std::string::npos)
+			str.replace(pos, posend - pos, rep);
+		else
+			str.replace(pos, str.length() - pos, rep);
+		pos += replen;
+	}
+}
+
+/** @brief Hunks of 1 to 8 lines of a generated file. */
+std::vector<std::string> MakeHunks(int nLines)
+{
+	const std::vector<std::string> lines = Corpus::SplitLines(Corpus::MakeText(nLines));
+	std::vector<std::string> hunks;
+	unsigned seed = 5;
+	for (size_t i = 0; i < lines.size();)
+	{
+		seed = seed * 1103515245 + 12345;
+		std::string hunk;
+		for (size_t n = 1 + (seed >> 8) % 8; n > 0 && i < lines.size(); --n, ++i)
+			hunk += lines[i] + ((i % 3) ? "\r\n" : "\n");
+		hunks.push_back(std::move(hunk));
+	}
+	return hunks;
+}
+
+void BM_NormalizeHunks(benchmark::State& state, int nLines, bool fused)
+{
+	const std::vector<std::string> hunks = MakeHunks(nLines);
+	size_t nBytes = 0;
+	for (const auto& hunk : hunks)
+		nBytes += hunk.size();
+	const int ignoreWhitespace = WHITESPACE_IGNORE_CHANGE;
+	const HunkNormalizer normalizer(ignoreWhitespace, true, true, true);
+	std::string lineData, buffer;
+	size_t nResult = 0;
+	for (auto _ : state)
+	{
+		nResult = 0;
+		for (const auto& hunk : hunks)
+		{
+			if (fused)
+			{
+				lineData.assign(hunk);
+				normalizer.Normalize(lineData, buffer);
+				lineData.swap(buffer);
+				normalizer.JoinLines(lineData, buffer);
+				nResult += buffer.size();
+			}
+			else
+			{
+				std::string text = hunk;
+				ReplaceChars(text, " \t", " ");
+				ReplaceChars(text, "0123456789", "");
+				for (auto& ch : text)
+					ch = static_cast<char>(::toupper(static_cast<unsigned char>(ch)));
+				Replace(text, "\r\n", "\n");
+				Replace(text, "\r", "\n");
+				std::string oneLine = text;
+				Replace(oneLine, "\r\n", " ");
+				ReplaceChars(oneLine, "\r\n", " ");
+				ReplaceChars(oneLine, " \t", " ");
+				nResult += oneLine.size();
+			}
+		}
+		benchmark::DoNotOptimize(nResult);
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * nBytes));
+	state.counters["hunks"] = static_cast<double>(hunks.size());
+	state.counters["result"] = static_cast<double>(nResult);
+}
+
+}
+
+BENCHMARK_CAPTURE(BM_NormalizeHunks, Small/stepwise, Corpus::SmallLines, false);
+BENCHMARK_CAPTURE(BM_NormalizeHunks, Small/fused, Corpus::SmallLines, true);
+BENCHMARK_CAPTURE(BM_NormalizeHunks, Large/stepwise, Corpus::LargeLines / 10, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_NormalizeHunks, Large/fused, Corpus::LargeLines / 10, true)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,73 @@
+/**
+ * @file  PluginWorkerPool_bench.cpp
+ *
+ * @brief Calls of a command line plugin, one process per file or workers.
+ *
+ * Every iteration filters one file through PluginWorkerStub. The spawn
+ * cases start the stub for each file, send the content on its stdin and
+ * read its stdout to the end, like InternalPlugin runs a command; they
+ * don't write temporary files, so they only time the start of the
+ * process. The pool cases send the content to a PluginWorkerPool worker.
+ */
+#include "pch.h"
+#include <benchmark/benchmark.h>
+#include <string>
+#include <Poco/Pipe.h>
+#include <Poco/PipeStream.h>
+#include <Poco/Process.h>
+#include "PluginWorkerPool.h"
+
+namespace
+{
+
+std::string MakeContent(size_t size)
+{
+	std::string content;
+	content.reserve(size);
+	while (content.size() < size)
+		content += "line " + std::to_string(content.size()) + " of the file\n";
+	content.resize(size);
+	return content;
+}
+
+std::string Spawn(const std::string& request)
+{
+	Poco::Pipe in, out;
+	Poco::ProcessHandle process = Poco::Process::launch(PLUGIN_WORKER_STUB, { "--once" }, &in, &out, nullptr);
+	in.writeBytes(request.data(), static_cast<int>(request.size()));
+	in.close(Poco::Pipe::CLOSE_WRITE);
+	std::string response;
+	char buf[65536];
+	int n;
+	while ((n = out.readBytes(buf, sizeof(buf))) > 0)
+		response.append(buf, n);
+	process.wait();
+	return response;
+}
+
+void BM_PluginCall(benchmark::State& state, size_t size, bool pool)
+{
+	const std::string request = MakeContent(size);
+	PluginWorkerPool workers(_T("\"") PLUGIN_WORKER_STUB _T("\""), 1);
+	std::string response;
+	String errmsg;
+	for (auto _ : state)
+	{
+		if (pool)
+			workers.Call(request, response, errmsg);
+		else
+			response = Spawn(request);
+		benchmark::DoNotOptimize(response);
+	}
+	if (response.size() != request.size())
+		state.SkipWithError("the stub didn't answer");
+	state.SetBytesProcessed(static_cast<int64_t>(size) * state.iterations());
+	state.counters["files_per_second"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+}
+
+}
+
+BENCHMARK_CAPTURE(BM_PluginCall, Small/spawn, 4096, false)->UseRealTime();
+BENCHMARK_CAPTURE(BM_PluginCall, Small/pool, 4096, true)->UseRealTime();
+BENCHMARK_CAPTURE(BM_PluginCall, Large/spawn, 1024 * 1024, false)->UseRealTime();
+BENCHMARK_CAPTURE(BM_PluginCall, Large/pool, 1024 * 1024, true)->UseRealTime();
@@ -0,0 +1,45 @@
+/**
+ * @file  PluginWorkerStub.cpp
+ *
+ * @brief Filter for PluginWorkerPool_bench.cpp, upper-cases its input.
+ *
+ * With --once it reads its stdin to the end and writes the result, like a
+ * command line plugin run once per file. Otherwise it answers requests
+ * framed like PluginWorkerPool sends them until its stdin is closed.
+ */
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+static void Transform(std::string& data)
+{
+	std::transform(data.begin(), data.end(), data.begin(),
+		[](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+}
+
+int main(int argc, char *argv[])
+{
+	std::ios::sync_with_stdio(false);
+	if (argc > 1 && strcmp(argv[1], "--once") == 0)
+	{
+		std::string data(std::istreambuf_iterator<char>(std::cin), {});
+		Transform(data);
+		std::cout.write(data.data(), data.size());
+		return 0;
+	}
+	std::string line, data;
+	while (std::getline(std::cin, line))
+	{
+		data.resize(std::stoul(line));
+		if (!std::cin.read(&data[0], data.size()))
+			return 1;
+		Transform(data);
+		std::cout << "0 " << data.size() << "\n";
+		std::cout.write(data.data(), data.size());
+		std::cout.flush();
+	}
+	return 0;
+}
@@ -0,0 +1,163 @@
+/**
+ * @file  diffutils_bench.cpp
+ *
+ * @brief Line diff of a file pair with diffutils and with the xdiff algorithms.
+ *
+ * Every iteration opens both files and compares them the way
+ * CDiffWrapper::Diff2Files does: diff_2_files() for the default algorithm,
+ * diff_2_files_xdiff() for the others and diff_2_files_streaming() for the
+ * streaming algorithm. All also time reading and splitting the files into
+ * lines, the streaming one a window at a time. The binary cases stop at the
+ * binary file check. The moved block cases compare a file with a copy
+ * whose blocks of lines were shuffled, with and without detecting moved
+ * blocks.
+ */
+#include "pch.h"
+#include <benchmark/benchmark.h>
+#define NOMINMAX
+#include "diff.h"
+#include "CompareOptions.h"
+#include "xdiff_gnudiff_compat.h"
+#include "Corpus.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+
+/** @brief Left and right file of a benchmark, written once per process. */
+struct FilePair
+{
+	Corpus::TempFile left, right;
+	size_t size;
+
+	FilePair(const std::string& name, const std::string& text, const std::string& edited)
+	: left(name + ".left", text.data(), text.size())
+	, right(name + ".right", edited.data(), edited.size())
+	, size(text.size() + edited.size())
+	{
+	}
+
+	FilePair(const std::string& name, const std::vector<char>& data, const std::vector<char>& edited)
+	: left(name + ".left", data.data(), data.size())
+	, right(name + ".right", edited.data(), edited.size())
+	, size(data.size() + edited.size())
+	{
+	}
+};
+
+const FilePair& TextPair(int nLines)
+{
+	static const FilePair small("small", Corpus::MakeText(Corpus::SmallLines), Corpus::EditText(Corpus::MakeText(Corpus::SmallLines), 20));
+	static const FilePair large("large", Corpus::MakeText(Corpus::LargeLines), Corpus::EditText(Corpus::MakeText(Corpus::LargeLines), 50));
+	return nLines == Corpus::SmallLines ? small : large;
+}
+
+const FilePair& ShuffledPair(int nLines)
+{
+	static const FilePair small("small.moved", Corpus::MakeText(Corpus::SmallLines), Corpus::ShuffleBlocks(Corpus::MakeText(Corpus::SmallLines), 10));
+	static const FilePair large("large.moved", Corpus::MakeText(Corpus::LargeLines), Corpus::ShuffleBlocks(Corpus::MakeText(Corpus::LargeLines), 10));
+	return nLines == Corpus::SmallLines ? small : large;
+}
+
+const FilePair& BinaryPair(int nLines)
+{
+	auto edited = [](std::vector<char> data) { data[data.size() / 2] ^= 1; return data; };
+	static const FilePair small("small.bin", Corpus::MakeBinary(Corpus::SmallLines * 40), edited(Corpus::MakeBinary(Corpus::SmallLines * 40)));
+	static const FilePair large("large.bin", Corpus::MakeBinary(Corpus::LargeLines * 40), edited(Corpus::MakeBinary(Corpus::LargeLines * 40)));
+	return nLines == Corpus::SmallLines ? small : large;
+}
+
+/** @brief Open the files like DiffFileData::OpenFiles(), compare them and clean up. */
+int DiffFiles(const FilePair& files, const DiffutilsOptions& options, bool movedBlocks = false)
+{
+	file_data inf[2] = {};
+	const std::string *paths[2] = { &files.left.Path(), &files.right.Path() };
+	for (int i = 0; i < 2; ++i)
+	{
+		inf[i].name = paths[i]->c_str();
+		inf[i].desc = open(paths[i]->c_str(), O_RDONLY);
+		fstat(inf[i].desc, &inf[i].stat);
+	}
+	int bin_status = 0, bin_file = 0;
+	change *script = nullptr;
+	if (options.m_diffAlgorithm == DIFF_ALGORITHM_DEFAULT)
+		script = diff_2_files(inf, 0, &bin_status, movedBlocks, &bin_file);
+	else if (options.m_diffAlgorithm == DIFF_ALGORITHM_STREAMING)
+		script = diff_2_files_streaming(inf, &bin_status, &bin_file, make_xdl_flags(options));
+	else
+		script = diff_2_files_xdiff(inf, &bin_status, movedBlocks, &bin_file, make_xdl_flags(options));
+	int nChanges = 0;
+	for (change *e = script, *p = nullptr; e != nullptr; e = p, ++nChanges)
+	{
+		p = e->link;
+		free(e);
+	}
+	cleanup_file_buffers(inf);
+	for (int i = 0; i < 2; ++i)
+		close(inf[i].desc);
+	return nChanges;
+}
+
+void BM_DiffText(benchmark::State& state, int nLines, DiffAlgorithm algorithm)
+{
+	const FilePair& files = TextPair(nLines);
+	DiffutilsOptions options;
+	options.m_diffAlgorithm = algorithm;
+	options.SetToDiffUtils();
+	int nChanges = 0;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(nChanges = DiffFiles(files, options));
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * files.size));
+	state.counters["changes"] = nChanges;
+}
+
+void BM_DiffMovedBlocks(benchmark::State& state, int nLines, bool movedBlocks)
+{
+	const FilePair& files = ShuffledPair(nLines);
+	DiffutilsOptions options;
+	options.SetToDiffUtils();
+	int nChanges = 0;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(nChanges = DiffFiles(files, options, movedBlocks));
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * files.size));
+	state.counters["changes"] = nChanges;
+}
+
+void BM_DiffBinary(benchmark::State& state, int nLines)
+{
+	const FilePair& files = BinaryPair(nLines);
+	DiffutilsOptions options;
+	options.SetToDiffUtils();
+	// diffutils prints "Binary files differ" to stdout, where the GUI has no console
+	fflush(stdout);
+	const int console = dup(STDOUT_FILENO);
+	const int null = open("/dev/null", O_WRONLY);
+	dup2(null, STDOUT_FILENO);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(DiffFiles(files, options));
+	fflush(stdout);
+	dup2(console, STDOUT_FILENO);
+	close(null);
+	close(console);
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * files.size));
+}
+
+}
+
+BENCHMARK_CAPTURE(BM_DiffText, Small/gnu, Corpus::SmallLines, DIFF_ALGORITHM_DEFAULT);
+BENCHMARK_CAPTURE(BM_DiffText, Small/minimal, Corpus::SmallLines, DIFF_ALGORITHM_MINIMAL);
+BENCHMARK_CAPTURE(BM_DiffText, Small/patience, Corpus::SmallLines, DIFF_ALGORITHM_PATIENCE);
+BENCHMARK_CAPTURE(BM_DiffText, Small/histogram, Corpus::SmallLines, DIFF_ALGORITHM_HISTOGRAM);
+BENCHMARK_CAPTURE(BM_DiffText, Small/streaming, Corpus::SmallLines, DIFF_ALGORITHM_STREAMING);
+BENCHMARK_CAPTURE(BM_DiffText, Large/gnu, Corpus::LargeLines, DIFF_ALGORITHM_DEFAULT)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_DiffText, Large/minimal, Corpus::LargeLines, DIFF_ALGORITHM_MINIMAL)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_DiffText, Large/patience, Corpus::LargeLines, DIFF_ALGORITHM_PATIENCE)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_DiffText, Large/histogram, Corpus::LargeLines, DIFF_ALGORITHM_HISTOGRAM)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_DiffText, Large/streaming, Corpus::LargeLines, DIFF_ALGORITHM_STREAMING)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_DiffMovedBlocks, Small/nodetect, Corpus::SmallLines, false);
+BENCHMARK_CAPTURE(BM_DiffMovedBlocks, Small/detect, Corpus::SmallLines, true);
+BENCHMARK_CAPTURE(BM_DiffMovedBlocks, Large/nodetect, Corpus::LargeLines, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_DiffMovedBlocks, Large/detect, Corpus::LargeLines, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_DiffBinary, Small, Corpus::SmallLines);
+BENCHMARK_CAPTURE(BM_DiffBinary, Large, Corpus::LargeLines)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,291 @@
+/**
+ * @file  stringdiffs_bench.cpp
+ *
+ * @brief Word and character level diffs of changed line pairs.
+ *
+ * Every iteration computes the in-line diffs of all changed lines of a
+ * file pair, like the editor does when it highlights the differences of
+ * a whole file.
+ *
+ * The long line cases diff one minified JSON line with some words changed,
+ * inserted and deleted, longer than the O(NP) word diff handles.
+ *
+ * The test line cases diff the line pairs of the stringdiffs unit tests
+ * with their options, with and without a WordDiffArena, and count the
+ * memory allocations per line pair.
+ */
+#include "pch.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <benchmark/benchmark.h>
+#include "stringdiffs.h"
+#include "CompareOptions.h"
+#include "Corpus.h"
+
+/** @brief Number of operator new calls, for the allocations per line pair counters. */
+static std::atomic<size_t> nAllocations{0};
+
+void *operator new(size_t size)
+{
+	nAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (void *p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	std::free(p);
+}
+
+namespace
+{
+
+/** @brief Line pairs which differ, the unchanged lines are skipped. */
+std::vector<std::pair<String, String>> ChangedLines(int nLines)
+{
+	const std::vector<std::string> left = Corpus::SplitLines(Corpus::MakeText(nLines));
+	std::vector<std::pair<String, String>> pairs;
+	unsigned seed = 7;
+	for (const auto& line : left)
+	{
+		seed = seed * 1103515245 + 12345;
+		std::string right = line;
+		if ((seed >> 8) % 2)
+			right.insert(right.size() / 2, " changed ");
+		else if (right.size() > 8)
+			right.erase(right.size() / 3, 4);
+		pairs.emplace_back(line, right);
+	}
+	return pairs;
+}
+
+void BM_WordDiffs(benchmark::State& state, int nLines, bool byteLevel, WhitespaceIgnoreChoices whitespace)
+{
+	const auto pairs = ChangedLines(nLines);
+	strdiff::Init();
+	size_t nDiffs = 0, nBytes = 0;
+	for (const auto& pair : pairs)
+		nBytes += pair.first.size() + pair.second.size();
+	for (auto _ : state)
+	{
+		nDiffs = 0;
+		for (const auto& pair : pairs)
+			nDiffs += strdiff::ComputeWordDiffs(pair.first, pair.second, true, strdiff::EOL_STRICT, whitespace, false, 0, byteLevel).size();
+		benchmark::DoNotOptimize(nDiffs);
+	}
+	strdiff::Close();
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * nBytes));
+	state.counters["diffs"] = static_cast<double>(nDiffs);
+}
+
+/** @brief Minified JSON line of @p nItems items, and a copy with every 1000th item edited. */
+std::pair<String, String> LongLinePair(int nItems)
+{
+	std::pair<String, String> pair;
+	for (int i = 0; i < nItems; ++i)
+	{
+		const std::string item = "{\"id\":" + std::to_string(i) + ",\"name\":\"item" + std::to_string(i) + "\"},";
+		pair.first += item;
+		switch (i % 1000)
+		{
+		case 100: pair.second += "{\"id\":" + std::to_string(i) + ",\"name\":\"changed\"},"; break;
+		case 500: pair.second += item + "{\"id\":-1},"; break;
+		case 900: break;
+		default: pair.second += item; break;
+		}
+	}
+	return pair;
+}
+
+void BM_LongLineWordDiffs(benchmark::State& state, int nItems, bool byteLevel)
+{
+	const auto pair = LongLinePair(nItems);
+	strdiff::Init();
+	strdiff::SetBreakChars(",:{}[]\"");
+	size_t nDiffs = 0;
+	for (auto _ : state)
+	{
+		nDiffs = strdiff::ComputeWordDiffs(pair.first, pair.second, true, strdiff::EOL_STRICT, WHITESPACE_COMPARE_ALL, false, 1, byteLevel).size();
+		benchmark::DoNotOptimize(nDiffs);
+	}
+	strdiff::Close();
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * (pair.first.size() + pair.second.size())));
+	state.counters["diffs"] = static_cast<double>(nDiffs);
+}
+
+struct TestLinePair
+{
+	const tchar_t *str1;
+	const tchar_t *str2;
+	bool case_sensitive;
+	strdiff::EolCompareMode eol_mode;
+	int whitespace;
+	bool ignore_numbers;
+	int breakType;
+	bool byte_level;
+};
+
+/** @brief Line pairs and options of Testing/GoogleTest/StringDiffs. */
+const TestLinePair TestLinePairs[] = {
+	{ "", "", false, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "", "abcde", false, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "abcde", "", false, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "abcde", "abcde", false, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "abcdef", "abcde", false, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "abcde ", "abcde", false, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "abcde", "abcde", true, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "aBcde", "abcde", true, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "aBcde ", "abcde", true, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "aBcde", " abcde", true, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "abcde abcde", "abcde abcde", false, strdiff::EOL_STRICT, 1, false, 0, false },
+	{ " abcde abcde", "  abcde abcde", false, strdiff::EOL_STRICT, 1, false, 0, false },
+	{ " abcde abcde", "	abcde abcde", false, strdiff::EOL_STRICT, 1, false, 0, false },
+	{ " abcde abcde", "abcde	abcde", false, strdiff::EOL_STRICT, 1, false, 0, false },
+	{ "abcde abcde", "abcde	abcde", false, strdiff::EOL_STRICT, 1, false, 0, false },
+	{ "abcde", "abcde", true, strdiff::EOL_STRICT, 2, false, 0, false },
+	{ " abcde", "abcde", true, strdiff::EOL_STRICT, 2, false, 0, false },
+	{ "	abcde", "abcde", true, strdiff::EOL_STRICT, 2, false, 0, false },
+	{ " abcde", "  abcde", true, strdiff::EOL_STRICT, 2, false, 0, false },
+	{ "abcde abcde", "abcdeabcde", true, strdiff::EOL_STRICT, 2, false, 0, false },
+	{ "abcde abcde", "abcde	abcde", true, strdiff::EOL_STRICT, 2, false, 0, false },
+	{ "abcde\tabcde", "abcde	abcde", true, strdiff::EOL_STRICT, 2, false, 0, false },
+	{ "aBcde fghij", "abcde fghij", true, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "abcde fghij", "abcde fGhij", true, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "abcde fghij", "ABcde fGhij", true, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "abcde fgHIj klmno", "abcde fghij klmno", true, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "abcde fghij klmno", "abcde fGHij klmno", true, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "abcDE fGHij klmno", "abcde fghij klmno", true, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "abcde fghij klmno", "abcDE fGHij klmno", true, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "abcde fghij KLmno", "abcDE fghij klmno", true, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "abcde,fghij", "ABcde,fghij", true, strdiff::EOL_STRICT, 0, false, 1, false },
+	{ "Abcde,fghij", "abcde,fghij", true, strdiff::EOL_STRICT, 0, false, 1, false },
+	{ "Abcde,fghij", "abcde,fGHij", true, strdiff::EOL_STRICT, 0, false, 1, false },
+	{ "Abcde,fghij,klmno", "abcde,fghij,klmno", true, strdiff::EOL_STRICT, 0, false, 1, false },
+	{ "Abcde,fghij,klmno", "abcde,fGHij,klmno", true, strdiff::EOL_STRICT, 0, false, 1, false },
+	{ "Abcde,fghij,klmno", "abcde,fGHij,klmNO", true, strdiff::EOL_STRICT, 0, false, 1, false },
+	{ "Abcde,fghij,klmno", "abcde,fghij,klmNO", true, strdiff::EOL_STRICT, 0, false, 1, false },
+	{ "Abcde:fghij", "abcde:fghij", true, strdiff::EOL_STRICT, 0, false, 1, false },
+	{ "abcde", "abcde", true, strdiff::EOL_STRICT, 0, false, 0, true },
+	{ "aBcde", "abcde", true, strdiff::EOL_STRICT, 0, false, 0, true },
+	{ "aBCde", "abcde", true, strdiff::EOL_STRICT, 0, false, 0, true },
+	{ "aBcde", "abCde", true, strdiff::EOL_STRICT, 0, false, 0, true },
+	{ "aBcDe", "abcde", true, strdiff::EOL_STRICT, 0, false, 0, true },
+	{ "aBcde", "abcDe", true, strdiff::EOL_STRICT, 0, false, 0, true },
+	{ "aBcdE", "abcde", true, strdiff::EOL_STRICT, 0, false, 0, true },
+	{ "aBcde", "abcdE", true, strdiff::EOL_STRICT, 0, false, 0, true },
+	{ "abc\r\n", "abc\n", true, strdiff::EOL_IGNORE, 0, false, 0, true },
+	{ "abc\r\n", "abc\r", true, strdiff::EOL_IGNORE, 0, false, 0, true },
+	{ "abc\r\n\r\n", "abc\n\n", true, strdiff::EOL_IGNORE, 0, false, 0, true },
+	{ "abc\r\r", "abc\n\n", true, strdiff::EOL_IGNORE, 0, false, 0, true },
+	{ "abc\r\ndef\r\n", "abc\ndef\n", true, strdiff::EOL_IGNORE, 0, false, 0, true },
+	{ "  abc  \r\ndef\r\n  ", "  abc  \ndef\n  ", true, strdiff::EOL_IGNORE, 0, false, 0, true },
+	{ "abc\r\ndef\r\n", "abc\ndef\n", true, strdiff::EOL_AS_SPACE, 0, false, 0, true },
+	{ "  abc  \r\ndef\r\n  ", "  abc  \ndef\n  ", true, strdiff::EOL_AS_SPACE, 0, false, 0, true },
+	{ "  abc  \r\ndef\r\n  ", "  abc   def   ", true, strdiff::EOL_AS_SPACE, 0, false, 0, true },
+	{ "  abc   def   ", "  abc  \ndef\n  ", true, strdiff::EOL_AS_SPACE, 0, false, 0, true },
+	{ "  abc   def   ", "  abc\ndef\n  ", true, strdiff::EOL_AS_SPACE, 1, false, 0, true },
+	{ "ab 1", "ab 2", true, strdiff::EOL_STRICT, 0, false, 0, true },
+	{ "ab 1", "ab 2", true, strdiff::EOL_STRICT, 0, true, 0, true },
+	{ "ab 1234", "ab 2", true, strdiff::EOL_STRICT, 0, true, 0, true },
+	{ "ab 12 34", "ab 2", true, strdiff::EOL_STRICT, 0, true, 0, true },
+	{ "ab 12 34", "ab 2 c", true, strdiff::EOL_STRICT, 0, true, 0, true },
+	{ "ab  12 34", "aB 2 c", false, strdiff::EOL_STRICT, 1, true, 0, true },
+	{ "abcdefgh", "1abcdefgh", false, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "1abcdefgh", "abcdefgh", false, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "abcdefgh", "1abcdefgh", false, strdiff::EOL_STRICT, 0, false, 0, true },
+	{ "1abcdefgh", "abcdefgh", false, strdiff::EOL_STRICT, 0, false, 0, true },
+	{ "abcdefgh", "abcdefgh1", false, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "abcdefgh1", "abcdefgh", false, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "abcdefgh", "abcdefgh1", false, strdiff::EOL_STRICT, 0, false, 0, true },
+	{ "abcdefgh1", "abcdefgh", false, strdiff::EOL_STRICT, 0, false, 0, true },
+	{ "N2130   _RobOk=_INT B_AND 512                   ;Roboter bereit", "N2040   _RobOk=_INT B_AND 'B1000000000'          ;Roboter bereit", false, strdiff::EOL_STRICT, 1, false, 0, true },
+	{ "N2040   _RobOk=_INT B_AND 'B1000000000'          ;Roboter bereit", "N2130   _RobOk=_INT B_AND 512                   ;Roboter bereit", false, strdiff::EOL_STRICT, 1, false, 0, true },
+	{ "N1960 IF(R2941==2) OR (R2941==203))", "N1830 IF((R2941==2)   OR (R2941==3)    ", false, strdiff::EOL_STRICT, 1, false, 1, true },
+	{ "N1830 IF((R2941==2)   OR (R2941==3)    ", "N1960 IF(R2941==2) OR (R2941==203))", false, strdiff::EOL_STRICT, 1, false, 1, true },
+	{ "(sizeof *new);", "sizeof(*newob));", false, strdiff::EOL_STRICT, 1, false, 0, true },
+	{ "if (EnumResourceLanguages(hinstLang, RT_VERSION, MAKEINTRESOURCE(VS_VERSION_INFO), (ENUMRESLANGPROC)FindNextResLang, (LPARAM)&wLangID) == 0)", "if (EnumResourceLanguages(hinstLang, RT_VERSION, MAKEINTRESOURCE(VS_VERSION_INFO), FindNextResLang, (LPARAM)&wLangID) == 0)", false, strdiff::EOL_STRICT, 0, false, 1, true },
+	{ "if (EnumResourceLanguages(hinstLang, RT_VERSION, MAKEINTRESOURCE(VS_VERSION_INFO), (ENUMRESLANGPROC)FindNextResLang, (LPARAM)&wLangID) == 0)", "if (EnumResourceLanguages(hinstLang, RT_VERSION, MAKEINTRESOURCE(VS_VERSION_INFO), FindNextResLang, (LPARAM)&wLangID) == 0)", false, strdiff::EOL_STRICT, 0, false, 1, false },
+	{ "[overlay_oid_origin, overlay_oid_target], [nil, nil]", "[overlay_oid_origin, overlay_oid_target, origin_file_name, target_file_name], [nil, nil, \"origin.txt\"), \"target.txt\"]", false, strdiff::EOL_STRICT, 0, false, 1, true },
+	{ "[overlay_oid_origin, overlay_oid_target], [nil, nil]", "[overlay_oid_origin, overlay_oid_target, origin_file_name, target_file_name], [nil, nil, \"origin.txt\"), \"target.txt\"]", false, strdiff::EOL_STRICT, 0, false, 1, false },
+	{ "N42=Import", "N42=Importuj", false, strdiff::EOL_STRICT, 0, false, 1, true },
+	{ "LIB_PHP4_DIR=$(RPM_NAME)-$(RPM_VER)/usr/lib/php", "LIB_PHP4_DIR=$(RPM_NAME)-$(RPM_VER)/usr/lib/php4", false, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "LIB_PHP4_DIR=$(RPM_NAME)-$(RPM_VER)/usr/lib/php", "LIB_PHP4_DIR=$(RPM_NAME)-$(RPM_VER)/usr/lib/php4", false, strdiff::EOL_STRICT, 0, false, 1, false },
+	{ "LIB_PHP4_DIR=$(RPM_NAME)-$(RPM_VER)/usr/lib/php", "LIB_PHP4_DIR=$(RPM_NAME)-$(RPM_VER)/usr/lib/php4", false, strdiff::EOL_STRICT, 0, false, 0, true },
+	{ "if (nDiff < m_diffs.size())", "if(nDiff < (int) m_diffs.size())", false, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "if (nDiff < m_diffs.size())", "if(nDiff < (int) m_diffs.size())", false, strdiff::EOL_STRICT, 0, false, 0, true },
+	{ "const string ManualFolder = \"Manual\";", "private const string ManualFolder = \"Manual\";", false, strdiff::EOL_STRICT, 0, false, 0, true },
+	{ "const string ManualFolder = \"Manual\";", "private const string ManualFolder = \"Manual\";", false, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "abc def ghi jkl mno", "abc defx ghi jklx mno", false, strdiff::EOL_STRICT, 0, false, 0, true },
+	{ "abc def ghi jkl mno", "abc defx ghi jklx mno", false, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "static int iTranslateBytesToBC (TCHAR* pd, BYTE* src, int srclen);", "static int iTranslateBytesToBC(TCHAR* pd, const BYTE* src, int srclen);", false, strdiff::EOL_STRICT, 0, false, 1, true },
+	{ "static int iTranslateBytesToBC (TCHAR* pd, BYTE* src, int srclen);", "static int iTranslateBytesToBC(TCHAR* pd, const BYTE* src, int srclen);", false, strdiff::EOL_STRICT, 0, false, 1, false },
+	{ "abc def ghi jkl mno pqr stu vwx yz", "abc def 123 ghi jkl mno pqr stu 456 vw x yz", false, strdiff::EOL_STRICT, 0, false, 0, true },
+	{ "abc def ghi jkl mno pqr stu vwx yz", "abc def 123 ghi jkl mno pqr stu 456 vw x yz", false, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "abc def ghi jkl mno pqr stu vwx yzr", "abc def 123ghi jkl mno pqr stu 456vwx yzrr", false, strdiff::EOL_STRICT, 0, false, 0, true },
+	{ "abc def ghi jkl mno pqr stu vwx yzr", "abc def 123ghi jkl mno pqr stu 456vwx yzrr", false, strdiff::EOL_STRICT, 0, false, 0, false },
+	{ "				wsprintf(buf, _T(left=  %s,   %d,%d, right=  %s,   %d,%d ),", "					if (len2 < 50)", true, strdiff::EOL_STRICT, 0, false, 1, true },
+	{ "	while (1)", "	for (;;)", true, strdiff::EOL_STRICT, 0, false, 1, true },
+	{ "abcdef,abccef,abcdef,", "abcdef,abcdef,abcdef,", true, strdiff::EOL_STRICT, 0, false, 1, true },
+	{ "", "		// remove empty records on both side", true, strdiff::EOL_STRICT, 0, false, 1, true },
+	{ ",;+ der abcdef,der,Thomas,abcdef,abcdef,;", ",;+ der abcdef,Thomas,accdgf,abcdef,-+", true, strdiff::EOL_STRICT, 0, false, 1, true },
+	{ "abcdef,abcdef,abcdef,", "abcdef,abccef,abcdef,", true, strdiff::EOL_STRICT, 0, false, 1, false },
+};
+
+void BM_TestLineWordDiffs(benchmark::State& state, bool useArena)
+{
+	strdiff::Init();
+	strdiff::SetBreakChars(_T(".,;:()[]{}!@#\"$%^&*~+-=<>\'/\\|"));
+	std::vector<std::pair<String, String>> pairs;
+	size_t nBytes = 0;
+	for (const auto& pair : TestLinePairs)
+	{
+		pairs.emplace_back(pair.str1, pair.str2);
+		nBytes += pairs.back().first.size() + pairs.back().second.size();
+	}
+	strdiff::WordDiffArena arena;
+	std::vector<strdiff::wdiff> diffs;
+	size_t nDiffs = 0;
+	const size_t nAllocationsBefore = nAllocations.load(std::memory_order_relaxed);
+	for (auto _ : state)
+	{
+		nDiffs = 0;
+		for (size_t i = 0; i < pairs.size(); ++i)
+		{
+			const TestLinePair& pair = TestLinePairs[i];
+			if (useArena)
+				strdiff::ComputeWordDiffs(pairs[i].first, pairs[i].second, pair.case_sensitive, pair.eol_mode,
+					pair.whitespace, pair.ignore_numbers, pair.breakType, pair.byte_level, arena, diffs);
+			else
+				diffs = strdiff::ComputeWordDiffs(pairs[i].first, pairs[i].second, pair.case_sensitive, pair.eol_mode,
+					pair.whitespace, pair.ignore_numbers, pair.breakType, pair.byte_level);
+			nDiffs += diffs.size();
+		}
+		benchmark::DoNotOptimize(nDiffs);
+	}
+	const size_t nAllocationsRun = nAllocations.load(std::memory_order_relaxed) - nAllocationsBefore;
+	strdiff::Close();
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * nBytes));
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * pairs.size()));
+	state.counters["diffs"] = static_cast<double>(nDiffs);
+	state.counters["allocs_per_pair"] = static_cast<double>(nAllocationsRun) / static_cast<double>(state.iterations() * pairs.size());
+}
+
+}
+
+BENCHMARK_CAPTURE(BM_WordDiffs, Small/word, Corpus::SmallLines, false, WHITESPACE_COMPARE_ALL);
+BENCHMARK_CAPTURE(BM_WordDiffs, Small/word_ignore_space, Corpus::SmallLines, false, WHITESPACE_IGNORE_CHANGE);
+BENCHMARK_CAPTURE(BM_WordDiffs, Small/char, Corpus::SmallLines, true, WHITESPACE_COMPARE_ALL);
+BENCHMARK_CAPTURE(BM_WordDiffs, Large/word, Corpus::LargeLines / 10, false, WHITESPACE_COMPARE_ALL)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_WordDiffs, Large/char, Corpus::LargeLines / 10, true, WHITESPACE_COMPARE_ALL)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_LongLineWordDiffs, Small/long_line, 2000, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_LongLineWordDiffs, Large/long_line, 40000, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_LongLineWordDiffs, Large/long_line_char, 40000, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_TestLineWordDiffs, Small/test_lines, false);
+BENCHMARK_CAPTURE(BM_TestLineWordDiffs, Small/test_lines_arena, true);
@@ -0,0 +1,73 @@
+/**
+ * @file  unicoder_bench.cpp
+ *
+ * @brief Encoding detection and conversion of file contents.
+ *
+ * Every compared text file is passed through codepage_detect::Guess() and,
+ * unless it is UTF-8 already, converted for the editor. The text has a
+ * few non-ASCII characters per line, so the UTF-8 check can't stop early.
+ */
+#include "pch.h"
+#include <benchmark/benchmark.h>
+#include "unicoder.h"
+#include "codepage_detect.h"
+#include "Corpus.h"
+
+namespace
+{
+
+std::string Utf8Text(int nLines)
+{
+	std::string text;
+	for (const auto& line : Corpus::SplitLines(Corpus::MakeText(nLines)))
+		text += line.substr(0, line.size() - 1) + " \xC3\xA4\xC3\xB6 \xE2\x82\xAC\n";
+	return text;
+}
+
+void BM_CheckUtf8(benchmark::State& state, int nLines)
+{
+	const std::string text = Utf8Text(nLines);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(ucr::CheckForInvalidUtf8(text.data(), text.size()));
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+
+void BM_Guess(benchmark::State& state, int nLines, const String& ext)
+{
+	const std::string text = (ext == _T(".html") ? "<html><head><meta charset=\"utf-8\"></head>\n" : "") + Utf8Text(nLines);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(codepage_detect::Guess(ext, text.data(), text.size(), 1));
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+
+void BM_Convert(benchmark::State& state, int nLines, ucr::UNICODESET from, ucr::UNICODESET to)
+{
+	const std::string text = Utf8Text(nLines);
+	ucr::buffer source(text.size() * 2 + 2);
+	if (from == ucr::UTF8)
+	{
+		memcpy(source.ptr, text.data(), text.size());
+		source.size = text.size();
+	}
+	else
+		ucr::convert(ucr::UTF8, ucr::CP_UTF_8, reinterpret_cast<const unsigned char *>(text.data()), text.size(), from, 0, &source);
+	ucr::buffer dest(source.size * 2);
+	for (auto _ : state)
+	{
+		ucr::convert(from, 0, source.ptr, source.size, to, ucr::CP_UTF_8, &dest);
+		benchmark::DoNotOptimize(dest.ptr);
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.size));
+}
+
+}
+
+BENCHMARK_CAPTURE(BM_CheckUtf8, Small, Corpus::SmallLines);
+BENCHMARK_CAPTURE(BM_CheckUtf8, Large, Corpus::LargeLines);
+BENCHMARK_CAPTURE(BM_Guess, Small/cpp, Corpus::SmallLines, _T(".cpp"));
+BENCHMARK_CAPTURE(BM_Guess, Small/html, Corpus::SmallLines, _T(".html"));
+BENCHMARK_CAPTURE(BM_Guess, Large/cpp, Corpus::LargeLines, _T(".cpp"));
+BENCHMARK_CAPTURE(BM_Convert, Small/utf8_to_ucs2, Corpus::SmallLines, ucr::UTF8, ucr::UCS2LE);
+BENCHMARK_CAPTURE(BM_Convert, Small/ucs2_to_utf8, Corpus::SmallLines, ucr::UCS2LE, ucr::UTF8);
+BENCHMARK_CAPTURE(BM_Convert, Large/utf8_to_ucs2, Corpus::LargeLines, ucr::UTF8, ucr::UCS2LE);
+BENCHMARK_CAPTURE(BM_Convert, Large/ucs2_to_utf8, Corpus::LargeLines, ucr::UCS2LE, ucr::UTF8);
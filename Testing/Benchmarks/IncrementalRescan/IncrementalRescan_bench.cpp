@@ -0,0 +1,235 @@
+/**
+ * @file  IncrementalRescan_bench.cpp
+ *
+ * @brief Full vs. incremental rescan while replaying edit sequences.
+ *
+ * Builds a pair of large files differing in every 50th line and replays
+ * edit sequences on the right file, rescanning after every edit like the
+ * merge editor does:
+ * - full: write out both files and diff them as a whole with xdiff,
+ * - incremental: hash the lines, let IncrementalRescan find the window
+ *   around the edit and diff only the window.
+ * The edit sequences are typing into one line, pasting blocks, deleting
+ * lines, single-line edits scattered over the file, and edit-undo pairs.
+ * The diff list of every incremental rescan is checked against the full
+ * rescan; "differ" counts the rescans where xdiff aligned a diff
+ * differently inside the window.
+ *
+ * Usage: IncrementalRescan_bench [lines [edits]]
+ *
+ * Build (Linux): the IncrementalRescan_bench target of ../CMakeLists.txt, or
+ *   gcc -O2 -c -I../../../Externals/xdiff xdiffi.c xemit.c xhistogram.c
+ *       xmerge.c xnone.c xpatience.c xprepare.c xutils.c
+ *       (each in ../../../Externals/xdiff)
+ *   g++ -std=c++17 -O2 -include cstddef -I. -I../../../Src -I../../../Externals/xdiff
+ *       IncrementalRescan_bench.cpp ../../../Src/IncrementalRescan.cpp
+ *       ../../../Src/DiffList.cpp x*.o
+ * with empty pch.h and DebugNew.h in the current folder.
+ */
+#include "pch.h"
+#include "IncrementalRescan.h"
+extern "C"
+{
+#include "xinclude.h"
+}
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using Lines = std::vector<std::string>;
+
+int HunkFunc(long, long, long, long, void *)
+{
+	return 0;
+}
+
+/** @brief Diff lines [begin, end) of both files with xdiff, like a rescan of the saved buffers. */
+bool DiffLines(const Lines lines[2], const int begin[], const int end[], DiffList& diffList)
+{
+	std::string text[2];
+	for (int file = 0; file < 2; ++file)
+	{
+		for (int i = begin[file]; i < end[file]; ++i)
+			text[file] += lines[file][i];
+	}
+	mmfile_t mmfile1 = { text[0].data(), static_cast<long>(text[0].size()) };
+	mmfile_t mmfile2 = { text[1].data(), static_cast<long>(text[1].size()) };
+	xpparam_t xpp = {};
+	xdemitconf_t xecfg = {};
+	xdemitcb_t ecb = {};
+	xdfenv_t xe;
+	xdchange_t *xscr;
+	xecfg.hunk_func = HunkFunc;
+	if (xdl_diff_modified(&mmfile1, &mmfile2, &xpp, &xecfg, &ecb, &xe, &xscr) != 0)
+		return false;
+	diffList.Clear();
+	for (xdchange_t *xcur = xscr; xcur; xcur = xcur->next)
+	{
+		DIFFRANGE dr;
+		dr.begin[0] = xcur->i1;
+		dr.end[0] = xcur->i1 + xcur->chg1 - 1;
+		dr.begin[1] = xcur->i2;
+		dr.end[1] = xcur->i2 + xcur->chg2 - 1;
+		dr.begin[2] = dr.end[2] = -1;
+		dr.op = OP_DIFF;
+		diffList.AddDiff(dr);
+	}
+	xdl_free_script(xscr);
+	xdl_free_env(&xe);
+	return true;
+}
+
+bool FullDiff(const Lines lines[2], DiffList& diffList)
+{
+	const int begin[2] = { 0, 0 };
+	const int end[2] = { static_cast<int>(lines[0].size()), static_cast<int>(lines[1].size()) };
+	return DiffLines(lines, begin, end, diffList);
+}
+
+void HashLines(const Lines lines[2], std::vector<uint64_t> hashes[])
+{
+	for (int file = 0; file < 2; ++file)
+	{
+		hashes[file].clear();
+		hashes[file].reserve(lines[file].size());
+		for (const auto& line : lines[file])
+			hashes[file].push_back(IncrementalRescan::HashLine(line.data(), line.size()));
+	}
+}
+
+bool SameDiffs(const DiffList& list1, const DiffList& list2)
+{
+	if (list1.GetSize() != list2.GetSize())
+		return false;
+	for (int i = 0; i < list1.GetSize(); ++i)
+	{
+		const DIFFRANGE *dr1 = list1.DiffRangeAt(i), *dr2 = list2.DiffRangeAt(i);
+		for (int file = 0; file < 2; ++file)
+		{
+			if (dr1->begin[file] != dr2->begin[file] || dr1->end[file] != dr2->end[file])
+				return false;
+		}
+	}
+	return true;
+}
+
+unsigned g_seed = 12345;
+
+int Random(int n)
+{
+	g_seed = g_seed * 1103515245 + 12345;
+	return static_cast<int>((g_seed >> 8) % n);
+}
+
+std::string MakeLine(int n)
+{
+	return "\tint value" + std::to_string(n) + " = compute(" + std::to_string(n * 7 % 1000) + ");\n";
+}
+
+enum Sequence { TYPING, PASTE, DELETE, SCATTERED, UNDO };
+const char *SequenceNames[] = { "typing", "paste", "delete", "scattered", "edit+undo" };
+
+/** @brief Apply edit number @p edit of a sequence to the right file. */
+void Edit(Sequence sequence, int edit, Lines& lines, int& line, std::string& undo)
+{
+	switch (sequence)
+	{
+	case TYPING:
+		lines[line].insert(lines[line].size() - 1, 1, static_cast<char>('a' + edit % 26));
+		break;
+	case PASTE:
+		line = Random(static_cast<int>(lines.size()));
+		for (int i = 0; i < 20; ++i)
+			lines.insert(lines.begin() + line + i, "pasted " + std::to_string(edit) + "/" + std::to_string(i) + "\n");
+		break;
+	case DELETE:
+		line = Random(static_cast<int>(lines.size()) - 5);
+		lines.erase(lines.begin() + line, lines.begin() + line + 5);
+		break;
+	case SCATTERED:
+		line = Random(static_cast<int>(lines.size()));
+		lines[line] = "edited " + std::to_string(edit) + "\n";
+		break;
+	case UNDO:
+		if (edit % 2 == 0)
+		{
+			line = Random(static_cast<int>(lines.size()));
+			undo = lines[line];
+			lines[line] = "edited " + std::to_string(edit) + "\n";
+		}
+		else
+			lines[line] = undo;
+		break;
+	}
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+	const int nLines = argc > 1 ? atoi(argv[1]) : 200000;
+	const int nEdits = argc > 2 ? atoi(argv[2]) : 50;
+
+	Lines original[2];
+	for (int i = 0; i < nLines; ++i)
+	{
+		original[0].push_back(MakeLine(i));
+		original[1].push_back(i % 50 == 25 ? "\t// changed " + std::to_string(i) + "\n" : MakeLine(i));
+	}
+
+	printf("%d lines, %d edits per sequence\n", nLines, nEdits);
+	printf("%-10s %14s %14s %8s %10s %8s\n", "sequence", "full ms/edit", "incr ms/edit", "speedup", "fallbacks", "differ");
+	for (Sequence sequence : { TYPING, PASTE, DELETE, SCATTERED, UNDO })
+	{
+		Lines lines[2] = { original[0], original[1] };
+		IncrementalRescan rescan;
+		std::vector<uint64_t> hashes[3];
+		DiffList diffList;
+		FullDiff(lines, diffList);
+		HashLines(lines, hashes);
+		rescan.Store(2, hashes, diffList);
+
+		int line = nLines / 2 + 3;
+		std::string undo;
+		double tFull = 0, tIncremental = 0;
+		int nFallbacks = 0, nDiffer = 0;
+		for (int edit = 0; edit < nEdits; ++edit)
+		{
+			Edit(sequence, edit, lines[1], line, undo);
+
+			auto start = std::chrono::steady_clock::now();
+			DiffList fullDiffList;
+			FullDiff(lines, fullDiffList);
+			auto end = std::chrono::steady_clock::now();
+			tFull += std::chrono::duration<double>(end - start).count();
+
+			start = std::chrono::steady_clock::now();
+			HashLines(lines, hashes);
+			const auto result = rescan.Update(hashes,
+				[&lines](const IncrementalRescan::Window& window, DiffList& windowDiffList)
+				{
+					return DiffLines(lines, window.begin, window.end, windowDiffList);
+				}, diffList);
+			if (result == IncrementalRescan::Result::FullRescan)
+			{
+				++nFallbacks;
+				FullDiff(lines, diffList);
+				HashLines(lines, hashes);
+				rescan.Store(2, hashes, diffList);
+			}
+			end = std::chrono::steady_clock::now();
+			tIncremental += std::chrono::duration<double>(end - start).count();
+
+			if (!SameDiffs(diffList, fullDiffList))
+				++nDiffer;
+		}
+		printf("%-10s %14.2f %14.2f %7.1fx %10d %8d\n", SequenceNames[sequence],
+			tFull * 1000 / nEdits, tIncremental * 1000 / nEdits, tFull / tIncremental, nFallbacks, nDiffer);
+	}
+	return 0;
+}
@@ -3,7 +3,9 @@
 #include "DiffContext.h"
 #include "PathContext.h"
 #include "CompareEngines/BinaryCompare.h"
+#include "ContentHashCache.h"
 #include <fstream>
+#include <vector>
 
 namespace
 {
@@ -294,4 +296,211 @@ namespace
 		EXPECT_EQ(int(DIFFCODE::CMPERR), bc.CompareFiles(files, di));
 	}
 
+	TEST_F(BinaryCompareTest, ContentHashCache)
+	{
+		ContentHashCache cache(_T("BinaryCompare_test.cache"), 1024 * 1024);
+		CompareEngines::BinaryCompare bc;
+		bc.SetContentHashCache(&cache);
+		PathContext files;
+		DIFFITEM di;
+
+		files.SetLeft(_T("A"));
+		files.SetRight(_T("B"));
+		di.diffFileInfo[0].size = 1;
+		di.diffFileInfo[1].size = 1;
+		di.diffFileInfo[0].mtime = Poco::Timestamp() - 60 * Poco::Timestamp::resolution();
+		di.diffFileInfo[1].mtime = di.diffFileInfo[0].mtime;
+
+		cache.Load();
+		{
+			TempFile l1("A", "1", 1);
+			TempFile r1("B", "2", 1);
+			EXPECT_EQ(int(DIFFCODE::DIFF), bc.CompareFiles(files, di));
+		}
+		EXPECT_TRUE(cache.Save());
+
+		// The files are gone, the recorded digests decide
+		EXPECT_TRUE(cache.Load());
+		EXPECT_EQ(int(DIFFCODE::DIFF), bc.CompareFiles(files, di));
+		EXPECT_EQ(2, cache.GetHitCount());
+
+		// A new stamp invalidates the record of A, only A is read
+		{
+			TempFile l1("A", "2", 1);
+			di.diffFileInfo[0].mtime += Poco::Timestamp::resolution();
+			EXPECT_EQ(int(DIFFCODE::SAME), bc.CompareFiles(files, di));
+		}
+		EXPECT_TRUE(cache.Save());
+		remove("BinaryCompare_test.cache");
+	}
+
+	// B is listed with the size of A but is shorter when read, a prefix of A
+	// a multiple of the read buffer long: it ends on a read of its own, the
+	// digest of A must still cover all of A
+	TEST_F(BinaryCompareTest, ContentHashCacheDifferentSize)
+	{
+		ContentHashCache cache(_T("BinaryCompare_test.cache"), 1024 * 1024);
+		CompareEngines::BinaryCompare bc;
+		bc.SetContentHashCache(&cache);
+		PathContext files;
+		DIFFITEM di;
+		const size_t size = 256 * 1024;
+		std::vector<char> data(2 * size + 1000);
+		for (size_t i = 0; i < data.size(); ++i)
+			data[i] = static_cast<char>(i * 7);
+
+		files.SetLeft(_T("A"));
+		files.SetRight(_T("B"));
+		di.diffFileInfo[0].size = data.size();
+		di.diffFileInfo[1].size = data.size();
+		di.diffFileInfo[0].mtime = Poco::Timestamp() - 60 * Poco::Timestamp::resolution();
+		di.diffFileInfo[1].mtime = di.diffFileInfo[0].mtime;
+
+		cache.Load();
+		TempFile l1("A", data.data(), data.size());
+		{
+			TempFile r1("B", data.data(), size);
+			EXPECT_EQ(int(DIFFCODE::DIFF), bc.CompareFiles(files, di));
+		}
+
+		// A is taken from the cache, its copy C is read
+		files.SetRight(_T("C"));
+		TempFile r2("C", data.data(), data.size());
+		EXPECT_EQ(int(DIFFCODE::SAME), bc.CompareFiles(files, di));
+		EXPECT_EQ(1, cache.GetHitCount());
+		remove("BinaryCompare_test.cache");
+	}
+
+	TEST_F(BinaryCompareTest, MemoryMapping)
+	{
+		const size_t size = 3 * 1024 * 1024 + 17;
+		std::vector<char> data(size + 5);
+		for (size_t i = 0; i < data.size(); ++i)
+			data[i] = static_cast<char>(i * 7 + i / 251);
+		std::vector<char> changed(data.begin(), data.begin() + size);
+		changed[2500001] ^= 0x40;
+
+		PathContext files;
+		DIFFITEM di;
+		files.SetLeft(_T("A"));
+		files.SetRight(_T("B"));
+		di.diffFileInfo[0].size = size;
+		di.diffFileInfo[1].size = size;
+
+		for (bool bMemoryMapping : { false, true })
+		{
+			CompareEngines::BinaryCompare bc;
+			bc.SetMemoryMapping(bMemoryMapping);
+			TempFile l1("A", data.data(), size);
+			CompareEngines::BinaryCompare::CompareInfo info;
+			{
+				TempFile r1("B", data.data(), size);
+				EXPECT_EQ(int(DIFFCODE::SAME), bc.CompareFiles(files, di, &info));
+				EXPECT_EQ(-1, info.firstDiffOffset);
+			}
+			{
+				TempFile r1("B", changed.data(), size);
+				EXPECT_EQ(int(DIFFCODE::DIFF), bc.CompareFiles(files, di, &info));
+				EXPECT_EQ(2500001, info.firstDiffOffset);
+			}
+			{
+				// Size 0 (e.g. symlinks) makes the files to be read
+				TempFile r1("B", data.data(), size + 5);
+				di.diffFileInfo[0].size = 0;
+				di.diffFileInfo[1].size = 0;
+				EXPECT_EQ(int(DIFFCODE::DIFF), bc.CompareFiles(files, di, &info));
+				EXPECT_EQ(static_cast<int64_t>(size), info.firstDiffOffset);
+				di.diffFileInfo[0].size = size;
+				di.diffFileInfo[1].size = size;
+			}
+		}
+
+		// The digests recorded by a mapped compare are the digests of the whole files
+		ContentHashCache cache(_T("BinaryCompare_test.cache"), 16 * 1024 * 1024);
+		CompareEngines::BinaryCompare bc;
+		bc.SetMemoryMapping(true);
+		bc.SetContentHashCache(&cache);
+		di.diffFileInfo[0].mtime = Poco::Timestamp() - 60 * Poco::Timestamp::resolution();
+		di.diffFileInfo[1].mtime = di.diffFileInfo[0].mtime;
+		cache.Load();
+		{
+			TempFile l1("A", data.data(), size);
+			TempFile r1("B", changed.data(), size);
+			EXPECT_EQ(int(DIFFCODE::DIFF), bc.CompareFiles(files, di));
+			for (int i = 0; i < 2; ++i)
+			{
+				ContentHashCache::Entry cached, expected;
+				EXPECT_TRUE(cache.Lookup(files[i], di.diffFileInfo[i], cached));
+				EXPECT_TRUE(ContentHashCache::HashFile(files[i], expected, nullptr));
+				EXPECT_EQ(0, memcmp(expected.digest, cached.digest, sizeof(expected.digest)));
+			}
+		}
+		remove("BinaryCompare_test.cache");
+	}
+
+	TEST_F(BinaryCompareTest, Sampling)
+	{
+		const size_t size = 17 * 1024 * 1024;
+		std::vector<char> data(size);
+		for (size_t i = 0; i < data.size(); ++i)
+			data[i] = static_cast<char>(i * 13 + i / 4099);
+
+		PathContext files;
+		DIFFITEM di;
+		files.SetLeft(_T("A"));
+		files.SetRight(_T("B"));
+		di.diffFileInfo[0].size = size;
+		di.diffFileInfo[1].size = size;
+		TempFile l1("A", data.data(), size);
+
+		for (bool bMemoryMapping : { false, true })
+		{
+			CompareEngines::BinaryCompare bc;
+			bc.SetMemoryMapping(bMemoryMapping);
+			bc.SetSampling(4, false);
+			{
+				// All samples match, the files are read whole to confirm
+				TempFile r1("B", data.data(), size);
+				CompareEngines::BinaryCompare::CompareInfo info;
+				EXPECT_EQ(int(DIFFCODE::SAME), bc.CompareFiles(files, di, &info));
+				EXPECT_FALSE(info.bSampledOnly);
+			}
+			{
+				// A difference in the head sample gives the exact offset
+				std::vector<char> changed(data);
+				changed[100] ^= 1;
+				TempFile r1("B", changed.data(), size);
+				CompareEngines::BinaryCompare::CompareInfo info;
+				EXPECT_EQ(int(DIFFCODE::DIFF), bc.CompareFiles(files, di, &info));
+				EXPECT_TRUE(info.bSampledOnly);
+				EXPECT_EQ(100, info.firstDiffOffset);
+			}
+			{
+				// A difference in the tail sample, the first difference is unknown
+				std::vector<char> changed(data);
+				changed[size - 3] ^= 1;
+				TempFile r1("B", changed.data(), size);
+				CompareEngines::BinaryCompare::CompareInfo info;
+				EXPECT_EQ(int(DIFFCODE::DIFF), bc.CompareFiles(files, di, &info));
+				EXPECT_TRUE(info.bSampledOnly);
+				EXPECT_EQ(-1, info.firstDiffOffset);
+			}
+			{
+				// A difference between the samples is found by the full compare,
+				// or missed when samples are trusted
+				std::vector<char> changed(data);
+				changed[70000] ^= 1;
+				TempFile r1("B", changed.data(), size);
+				CompareEngines::BinaryCompare::CompareInfo info;
+				EXPECT_EQ(int(DIFFCODE::DIFF), bc.CompareFiles(files, di, &info));
+				EXPECT_FALSE(info.bSampledOnly);
+				EXPECT_EQ(70000, info.firstDiffOffset);
+
+				bc.SetSampling(4, true);
+				info = CompareEngines::BinaryCompare::CompareInfo();
+				EXPECT_EQ(int(DIFFCODE::SAME), bc.CompareFiles(files, di, &info));
+				EXPECT_TRUE(info.bSampledOnly);
+			}
+		}
+	}
 }  // namespace
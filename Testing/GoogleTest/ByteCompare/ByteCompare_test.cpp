@@ -2,6 +2,7 @@
 #include <gtest/gtest.h>
 #include "diff.h"
 #include "CompareEngines/ByteCompare.h"
+#include "CompareEngines/ByteComparator.h"
 #include "CompareOptions.h"
 #include "FileLocation.h"
 #include "DiffItem.h"
@@ -9,6 +10,8 @@
 #include "cio.h"
 #include "unicoder.h"
 #include <fstream>
+#include <random>
+#include <vector>
 
 namespace
 {
@@ -42,6 +45,81 @@ namespace
 		DiffFileData diffData;
 	};
 
+	/** @brief Random text with many EOL bytes, NULs and spaces. */
+	std::vector<char> RandomText(std::mt19937& rng, size_t len)
+	{
+		static const char alphabet[] = { 'a', 'b', ' ', '\t', '\r', '\n', '\r', '\n', '\0' };
+		std::uniform_int_distribution<int> dist(0, sizeof(alphabet) - 1);
+		std::vector<char> buf(len);
+		for (auto& ch : buf)
+			ch = alphabet[dist(rng)];
+		return buf;
+	}
+
+	/** @brief Copy of @p buf with a few random edits. */
+	std::vector<char> Mutate(std::mt19937& rng, std::vector<char> buf)
+	{
+		std::uniform_int_distribution<int> edits(0, 3);
+		for (int n = edits(rng); n > 0; --n)
+		{
+			size_t pos = std::uniform_int_distribution<size_t>(0, buf.size())(rng);
+			switch (edits(rng))
+			{
+			case 0: buf.insert(buf.begin() + pos, '\r'); break;
+			case 1: if (pos < buf.size()) buf.erase(buf.begin() + pos); break;
+			case 2: if (pos < buf.size()) buf[pos] = 'x'; break;
+			default: buf.push_back('\n'); break;
+			}
+		}
+		return buf;
+	}
+
+	struct BufferCompareResult
+	{
+		CompareEngines::ByteComparator::COMP_RESULT result;
+		FileTextStats stats[2];
+		bool operator==(const BufferCompareResult& other) const
+		{
+			if (result != other.result)
+				return false;
+			for (int i = 0; i < 2; ++i)
+			{
+				if (stats[i].ncrs != other.stats[i].ncrs || stats[i].nlfs != other.stats[i].nlfs ||
+					stats[i].ncrlfs != other.stats[i].ncrlfs || stats[i].nzeros != other.stats[i].nzeros)
+					return false;
+			}
+			return true;
+		}
+	};
+
+	/**
+	 * @brief Feed two buffers to ByteComparator in chunks of @p chunk bytes,
+	 * continuing from where the previous call stopped on each side.
+	 */
+	BufferCompareResult CompareInChunks(const QuickCompareOptions& options,
+		const std::vector<char>& data0, const std::vector<char>& data1, size_t chunk)
+	{
+		CompareEngines::ByteComparator comparator(&options);
+		BufferCompareResult res;
+		const std::vector<char> *data[2] = { &data0, &data1 };
+		size_t begin[2] = {}, end[2] = {};
+		for (;;)
+		{
+			for (int i = 0; i < 2; ++i)
+				end[i] = (std::min)(data[i]->size(), (std::max)(end[i], begin[i] + chunk));
+			const char *ptr0 = data0.data() + begin[0];
+			const char *ptr1 = data1.data() + begin[1];
+			res.result = comparator.CompareBuffers(res.stats[0], res.stats[1], ptr0, ptr1,
+				data0.data() + end[0], data1.data() + end[1],
+				end[0] == data0.size(), end[1] == data1.size(), begin[0], begin[1]);
+			if (res.result == CompareEngines::ByteComparator::RESULT_DIFF ||
+				res.result == CompareEngines::ByteComparator::RESULT_SAME)
+				return res;
+			begin[0] = ptr0 - data0.data();
+			begin[1] = ptr1 - data1.data();
+		}
+	}
+
 	// The fixture for testing paths functions.
 	class ByteCompareTest : public testing::Test
 	{
@@ -1618,4 +1696,86 @@ namespace
 		}
 	}
 
+	TEST_F(ByteCompareTest, SimdCompareBuffersMatchesScalar)
+	{
+		using CompareEngines::ByteComparator;
+		const ByteComparator::SIMD_LEVEL prevLevel = ByteComparator::SetSimdLevel(ByteComparator::SIMD_AVX2);
+		const ByteComparator::SIMD_LEVEL maxLevel = ByteComparator::GetSimdLevel();
+		std::mt19937 rng(12345);
+		for (int iter = 0; iter < 2000; ++iter)
+		{
+			QuickCompareOptions option;
+			if (iter % 4 == 3)
+			{
+				option.m_bIgnoreEOLDifference = (iter & 4) != 0;
+				option.m_bIgnoreCase = (iter & 8) != 0;
+				option.m_ignoreWhitespace = (iter & 16) ? WHITESPACE_IGNORE_CHANGE : WHITESPACE_COMPARE_ALL;
+			}
+			std::vector<char> data0 = RandomText(rng, std::uniform_int_distribution<size_t>(0, 3000)(rng));
+			std::vector<char> data1 = (iter % 8 == 0) ? RandomText(rng, data0.size()) : Mutate(rng, data0);
+			const size_t chunk = std::uniform_int_distribution<size_t>(1, 1100)(rng);
+
+			ByteComparator::SetSimdLevel(ByteComparator::SIMD_NONE);
+			const BufferCompareResult expected = CompareInChunks(option, data0, data1, chunk);
+			for (int level = ByteComparator::SIMD_SSE2; level <= maxLevel; ++level)
+			{
+				ByteComparator::SetSimdLevel(static_cast<ByteComparator::SIMD_LEVEL>(level));
+				EXPECT_TRUE(expected == CompareInChunks(option, data0, data1, chunk))
+					<< "iteration " << iter << ", level " << level;
+			}
+		}
+		ByteComparator::SetSimdLevel(prevLevel);
+	}
+
+	TEST_F(ByteCompareTest, SimdCompareFilesMatchesScalar)
+	{
+		using CompareEngines::ByteComparator;
+		const ByteComparator::SIMD_LEVEL prevLevel = ByteComparator::SetSimdLevel(ByteComparator::SIMD_AVX2);
+		const ByteComparator::SIMD_LEVEL maxLevel = ByteComparator::GetSimdLevel();
+		std::string filename_left  = "_tmp_.txt";
+		std::string filename_right = "_tmp_2.txt";
+		std::mt19937 rng(54321);
+		for (int iter = 0; iter < 40; ++iter)
+		{
+			// Sizes around the read buffer size too, so that CR+LF pairs and
+			// mismatches fall on buffer boundaries
+			const size_t size = (iter % 2 == 0) ?
+				std::uniform_int_distribution<size_t>(0, 5000)(rng) :
+				std::uniform_int_distribution<size_t>(256 * 1024 - 64, 256 * 1024 + 64)(rng) * (iter % 4 == 1 ? 1 : 2);
+			std::vector<char> data0 = RandomText(rng, size);
+			std::vector<char> data1 = Mutate(rng, data0);
+			TempFile file_left (filename_left,  data0.data(), data0.size());
+			TempFile file_right(filename_right, data1.data(), data1.size());
+
+			CompareEngines::ByteCompare bc;
+			QuickCompareOptions option;
+			option.m_bStopAfterFirstDiff = false;
+			bc.SetCompareOptions(option);
+
+			ByteComparator::SetSimdLevel(ByteComparator::SIMD_NONE);
+			int expectedCode;
+			FileTextStats expectedStats[2];
+			{
+				FilePair pair(filename_left, filename_right);
+				expectedCode = bc.CompareFiles(&pair.diffData);
+				expectedStats[0] = pair.diffData.m_textStats[0];
+				expectedStats[1] = pair.diffData.m_textStats[1];
+			}
+			for (int level = ByteComparator::SIMD_SSE2; level <= maxLevel; ++level)
+			{
+				ByteComparator::SetSimdLevel(static_cast<ByteComparator::SIMD_LEVEL>(level));
+				FilePair pair(filename_left, filename_right);
+				EXPECT_EQ(expectedCode, bc.CompareFiles(&pair.diffData)) << "iteration " << iter << ", level " << level;
+				for (int i = 0; i < 2; ++i)
+				{
+					EXPECT_EQ(expectedStats[i].ncrs, pair.diffData.m_textStats[i].ncrs);
+					EXPECT_EQ(expectedStats[i].nlfs, pair.diffData.m_textStats[i].nlfs);
+					EXPECT_EQ(expectedStats[i].ncrlfs, pair.diffData.m_textStats[i].ncrlfs);
+					EXPECT_EQ(expectedStats[i].nzeros, pair.diffData.m_textStats[i].nzeros);
+				}
+			}
+		}
+		ByteComparator::SetSimdLevel(prevLevel);
+	}
+
 }  // namespace
@@ -1,5 +1,7 @@
 #include "pch.h"
 #include <gtest/gtest.h>
+#include <thread>
+#include <vector>
 #include "DiffItemList.h"
 #include "paths.h"
 
@@ -82,5 +84,173 @@ namespace
 		EXPECT_EQ(String(_T("Dir1\\File2")), pdi->diffFileInfo[0].GetFile());
 	}
 
+	TEST_F(DiffItemListTest, ArenaReusesDeletedItems)
+	{
+		DiffItemArena arena;
+		DIFFITEM *pdi1 = new (arena) DIFFITEM;
+		DIFFITEM *pdi2 = new (arena) DIFFITEM;
+		pdi2->diffFileInfo[0].GetEncodingRef().SetCodepage(65001);
+		EXPECT_EQ(2u, arena.GetItemCount());
+		delete pdi2;
+		EXPECT_EQ(1u, arena.GetItemCount());
+		DIFFITEM *pdi3 = new (arena) DIFFITEM;
+		EXPECT_EQ(pdi2, pdi3);
+		EXPECT_FALSE(pdi3->diffFileInfo[0].HasDetails());
+		EXPECT_EQ(1u, arena.GetSlabCount());
+		pdi1->AddChildToParent(pdi3);
+		delete pdi1;
+		EXPECT_EQ(0u, arena.GetItemCount());
+	}
+
+	// RemoveAll() destroys the items of all the slabs, including items
+	// deleted and allocated again
+	TEST_F(DiffItemListTest, RemoveAllWithArena)
+	{
+		DiffItemList list;
+		list.InitDiffItemList();
+		DIFFITEM *pDir = list.AddNewDiff(nullptr);
+		for (size_t i = 0; i < 2 * DiffItemArena::SlabSize; ++i)
+		{
+			DIFFITEM *pFile = list.AddNewDiff(pDir);
+			SetFile(*pFile, _T("Dir\\File") + strutils::to_str(static_cast<int>(i)));
+			pFile->diffFileInfo[1].GetTextStatsRef().nlfs = 1;
+			if (i % 3 == 0)
+			{
+				pFile->DelinkFromSiblings();
+				delete pFile;
+			}
+		}
+		list.AddNewDiff(pDir);
+		int count = 0;
+		for (DIFFITEM *pos = list.GetFirstChildDiffPosition(pDir); pos != nullptr; list.GetNextSiblingDiffPosition(pos))
+			++count;
+		EXPECT_EQ(static_cast<int>(2 * DiffItemArena::SlabSize - (2 * DiffItemArena::SlabSize + 2) / 3 + 1), count);
+		list.RemoveAll();
+		list.InitDiffItemList();
+		EXPECT_EQ(nullptr, list.GetFirstDiffPosition());
+	}
+
+	TEST_F(DiffItemListTest, DiffFileInfoDetails)
+	{
+		DiffFileInfo dfi;
+		EXPECT_FALSE(dfi.HasDetails());
+		EXPECT_TRUE(dfi.GetVersion().IsCleared());
+		EXPECT_EQ(0, dfi.GetTextStats().nlfs);
+		EXPECT_EQ(nullptr, dfi.GetAdditionalProperties());
+		EXPECT_FALSE(dfi.HasDetails());
+
+		dfi.GetVersionRef().SetFileVersion(0x00010002, 0x00030004);
+		dfi.GetEncodingRef().SetCodepage(1252);
+		EXPECT_TRUE(dfi.HasDetails());
+
+		DiffFileInfo copy;
+		copy.CopyDetails(dfi);
+		EXPECT_EQ(1252, copy.GetEncoding().m_codepage);
+		EXPECT_EQ(dfi.GetVersion().GetFileVersionQWORD(), copy.GetVersion().GetFileVersionQWORD());
+
+		DiffFileInfo moved(std::move(dfi));
+		EXPECT_FALSE(dfi.HasDetails());
+		EXPECT_EQ(1252, moved.GetEncoding().m_codepage);
+
+		// Copying no details clears them
+		copy.CopyDetails(dfi);
+		EXPECT_EQ(-1, copy.GetEncoding().m_codepage);
+		EXPECT_TRUE(copy.GetVersion().IsCleared());
+	}
+
+	DIFFITEM *AddItem(DiffItemList& list, DIFFITEM *parent, unsigned diffcode)
+	{
+		DIFFITEM *pdi = list.AddNewDiff(parent);
+		pdi->diffcode.diffcode = diffcode;
+		pdi->UpdateFolderCounts();
+		return pdi;
+	}
+
+	void ExpectCounts(const DIFFITEM& di, int same, int diff, int unique, int filtered)
+	{
+		const FolderCounts& counts = di.GetFolderCounts();
+		EXPECT_EQ(same, counts.Get(FolderCounts::SAME));
+		EXPECT_EQ(diff, counts.Get(FolderCounts::DIFF));
+		EXPECT_EQ(unique, counts.Get(FolderCounts::UNIQUE));
+		EXPECT_EQ(filtered, counts.Get(FolderCounts::FILTERED));
+	}
+
+	// Folders count the results of their whole subtree, but not the items
+	// below a filtered folder
+	TEST_F(DiffItemListTest, FolderCounts)
+	{
+		const unsigned file = DIFFCODE::FILE | DIFFCODE::BOTH;
+		const unsigned dir = DIFFCODE::DIR | DIFFCODE::BOTH;
+		DiffItemList list;
+		list.InitDiffItemList();
+		DIFFITEM *pTop = AddItem(list, nullptr, dir);
+		AddItem(list, pTop, file | DIFFCODE::SAME);
+		DIFFITEM *pDiff = AddItem(list, pTop, file | DIFFCODE::DIFF);
+		AddItem(list, pTop, DIFFCODE::FILE | DIFFCODE::FIRST);
+		DIFFITEM *pSub = AddItem(list, pTop, dir | DIFFCODE::SAME);
+		AddItem(list, pSub, file | DIFFCODE::SAME);
+		DIFFITEM *pFiltered = AddItem(list, pTop, dir | DIFFCODE::SKIPPED);
+		AddItem(list, pFiltered, file | DIFFCODE::DIFF);
+		ExpectCounts(*pTop, 3, 1, 1, 1);
+		ExpectCounts(*pSub, 1, 0, 0, 0);
+		ExpectCounts(*pFiltered, 0, 1, 0, 0);
+		ExpectCounts(*pDiff, 0, 0, 0, 0);
+
+		// A result changes
+		list.SetDiffStatusCode(pDiff, DIFFCODE::SAME, DIFFCODE::COMPAREFLAGS);
+		ExpectCounts(*pTop, 4, 0, 1, 1);
+
+		// A folder is no longer filtered, its items are counted
+		list.SetDiffStatusCode(pFiltered, DIFFCODE::INCLUDED | DIFFCODE::DIFF, DIFFCODE::FILTERFLAGS | DIFFCODE::COMPAREFLAGS);
+		ExpectCounts(*pTop, 4, 2, 1, 0);
+
+		// Items are deleted, or moved to another folder
+		pSub->RemoveChildren();
+		ExpectCounts(*pTop, 3, 2, 1, 0);
+		ExpectCounts(*pSub, 0, 0, 0, 0);
+		pFiltered->DelinkFromSiblings();
+		delete pFiltered;
+		ExpectCounts(*pTop, 3, 0, 1, 0);
+		pDiff->DelinkFromSiblings();
+		pSub->AddChildToParent(pDiff);
+		ExpectCounts(*pTop, 3, 0, 1, 0);
+		ExpectCounts(*pSub, 1, 0, 0, 0);
+	}
+
+	// Compare threads update the counts of the same folders at once
+	TEST_F(DiffItemListTest, FolderCountsFromThreads)
+	{
+		const int ThreadCount = 4;
+		const int FileCount = 1000;
+		DiffItemList list;
+		list.InitDiffItemList();
+		DIFFITEM *pTop = AddItem(list, nullptr, DIFFCODE::DIR | DIFFCODE::BOTH);
+		std::vector<DIFFITEM *> folders;
+		std::vector<std::vector<DIFFITEM *>> files(ThreadCount);
+		for (int t = 0; t < ThreadCount; ++t)
+		{
+			folders.push_back(AddItem(list, pTop, DIFFCODE::DIR | DIFFCODE::BOTH));
+			for (int i = 0; i < FileCount; ++i)
+				files[t].push_back(AddItem(list, folders.back(), DIFFCODE::FILE | DIFFCODE::BOTH));
+		}
+		ExpectCounts(*pTop, 0, 0, 0, 0);
+
+		std::vector<std::thread> threads;
+		for (int t = 0; t < ThreadCount; ++t)
+		{
+			threads.emplace_back([&files, t]()
+				{
+					for (size_t i = 0; i < files[t].size(); ++i)
+					{
+						files[t][i]->diffcode.diffcode |= (i % 4 == 0) ? DIFFCODE::DIFF : DIFFCODE::SAME;
+						files[t][i]->UpdateFolderCounts();
+					}
+				});
+		}
+		for (auto& thread : threads)
+			thread.join();
+		ExpectCounts(*pTop, ThreadCount * FileCount * 3 / 4, ThreadCount * FileCount / 4, 0, 0);
+		ExpectCounts(*folders[0], FileCount * 3 / 4, FileCount / 4, 0, 0);
+	}
 
 }  // namespace
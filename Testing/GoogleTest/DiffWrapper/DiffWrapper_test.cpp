@@ -1,6 +1,10 @@
 #include "pch.h"
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
 #include "DiffWrapper.h"
+#include "DiffFileData.h"
+#include "PreparedFiles.h"
 #include "PathContext.h"
 #include "paths.h"
 #include "TempFile.h"
@@ -506,3 +510,152 @@ TEST(DiffWrapper, RunFileDiff_SubstitutionFilters)
 		}
 	}
 }
+
+TEST(DiffWrapper, RunFileDiff_ThreeWay)
+{
+	CDiffWrapper dw;
+	DIFFOPTIONS options{};
+	DIFFRANGE dr;
+	DIFFSTATUS status;
+
+	for (auto algo : { DIFF_ALGORITHM_DEFAULT, DIFF_ALGORITHM_MINIMAL, DIFF_ALGORITHM_PATIENCE, DIFF_ALGORITHM_HISTOGRAM })
+	{
+		options.nDiffAlgorithm = algo;
+
+		{
+			DiffList diffList;
+			TempFile left   = WriteToTempFile(_T("a\nb\nc\n"));
+			TempFile middle = WriteToTempFile(_T("a\nb\nc\n"));
+			TempFile right  = WriteToTempFile(_T("a\nb2\nc\n"));
+			dw.SetCreateDiffList(&diffList);
+			dw.SetPaths({ left.GetPath(), middle.GetPath(), right.GetPath() }, false);
+			dw.SetOptions(&options);
+			EXPECT_TRUE(dw.RunFileDiff());
+			dw.GetDiffStatus(&status);
+			EXPECT_EQ(IDENTLEVEL::EXCEPTRIGHT, status.Identical);
+			EXPECT_EQ(1, diffList.GetSize());
+			diffList.GetDiff(0, dr);
+			EXPECT_EQ(1, dr.begin[0]);
+			EXPECT_EQ(1, dr.begin[1]);
+			EXPECT_EQ(1, dr.begin[2]);
+			EXPECT_EQ(1, dr.end[2]);
+		}
+
+		{
+			// The same file on two sides shares its content with both pairs
+			DiffList diffList;
+			TempFile left   = WriteToTempFile(_T("a\nb1\nc\nd\ne\n"));
+			TempFile middle = WriteToTempFile(_T("a\nb\nc\nd\ne\n"));
+			dw.SetCreateDiffList(&diffList);
+			dw.SetPaths({ left.GetPath(), middle.GetPath(), left.GetPath() }, false);
+			dw.SetOptions(&options);
+			EXPECT_TRUE(dw.RunFileDiff());
+			dw.GetDiffStatus(&status);
+			EXPECT_EQ(IDENTLEVEL::EXCEPTMIDDLE, status.Identical);
+			EXPECT_EQ(1, diffList.GetSize());
+			diffList.GetDiff(0, dr);
+			EXPECT_EQ(1, dr.begin[0]);
+			EXPECT_EQ(1, dr.end[0]);
+			EXPECT_EQ(1, dr.begin[1]);
+			EXPECT_EQ(1, dr.end[1]);
+		}
+	}
+}
+
+// The streaming algorithm isn't used by 3-way compares, which read the lines
+// of both pairs when their changes overlap
+TEST(DiffWrapper, RunFileDiff_ThreeWayStreaming)
+{
+	CDiffWrapper dw;
+	DIFFOPTIONS options{};
+	DIFFRANGE dr;
+	DIFFSTATUS status;
+	options.nDiffAlgorithm = DIFF_ALGORITHM_STREAMING;
+
+	DiffList diffList;
+	TempFile left   = WriteToTempFile(_T("a\nb1\nc\nd\n"));
+	TempFile middle = WriteToTempFile(_T("a\nb\nc\nd\n"));
+	TempFile right  = WriteToTempFile(_T("a\nb2\nc\nd\n"));
+	dw.SetCreateDiffList(&diffList);
+	dw.SetPaths({ left.GetPath(), middle.GetPath(), right.GetPath() }, false);
+	dw.SetOptions(&options);
+	EXPECT_TRUE(dw.RunFileDiff());
+	dw.GetDiffStatus(&status);
+	EXPECT_EQ(IDENTLEVEL::NONE, status.Identical);
+	EXPECT_EQ(1, diffList.GetSize());
+	diffList.GetDiff(0, dr);
+	for (int file = 0; file < 3; file++)
+	{
+		EXPECT_EQ(1, dr.begin[file]);
+		EXPECT_EQ(1, dr.end[file]);
+	}
+}
+
+namespace
+{
+
+String MakeLines(int nLines, std::initializer_list<int> changedLines)
+{
+	String text;
+	for (int i = 0; i < nLines; ++i)
+	{
+		const bool changed = std::find(changedLines.begin(), changedLines.end(), i) != changedLines.end();
+		text += (changed ? _T("changed ") : _T("line ")) + strutils::to_str(i % 100) + _T("\n");
+	}
+	return text;
+}
+
+/** @brief Compare two files, with their lines taken from @p pPrepared if given. */
+std::vector<std::array<int, 4>> DiffPreparedFiles(const CDiffWrapper& dw, const String& path0, const String& path1, PreparedFiles *pPrepared)
+{
+	std::vector<char> content[2];
+	DiffFileData diffdata;
+	EXPECT_TRUE(DiffFileData::ReadContent(path0, content[0]));
+	EXPECT_TRUE(DiffFileData::ReadContent(path1, content[1]));
+	EXPECT_TRUE(diffdata.OpenFiles(path0, path1));
+	diffdata.SetPreloadedContent(0, content[0]);
+	diffdata.SetPreloadedContent(1, content[1]);
+	if (pPrepared != nullptr)
+	{
+		const file_data *inf[2] = { &diffdata.m_inf[0], &diffdata.m_inf[1] };
+		pPrepared->Prepare(2, inf);
+		pPrepared->Attach(diffdata, 0, 1);
+	}
+	change *script = nullptr;
+	int bin_flag = 0;
+	EXPECT_TRUE(dw.Diff2Files(&script, &diffdata, &bin_flag, nullptr));
+	std::vector<std::array<int, 4>> changes;
+	for (change *e = script; e != nullptr; e = e->link)
+		changes.push_back({ e->line0, e->line1, e->deleted, e->inserted });
+	CDiffWrapper::FreeDiffUtilsScript(script);
+	diffdata.Close();
+	return changes;
+}
+
+}
+
+TEST(DiffWrapper, Diff2Files_PreparedFiles)
+{
+	CDiffWrapper dw;
+	DIFFOPTIONS options{};
+
+	for (auto algo : { DIFF_ALGORITHM_DEFAULT, DIFF_ALGORITHM_HISTOGRAM })
+	{
+		options.nDiffAlgorithm = algo;
+		dw.SetOptions(&options, true);
+
+		PreparedFiles prepared;
+		TempFile left = WriteToTempFile(MakeLines(5000, { 10, 4990 }));
+		TempFile right = WriteToTempFile(MakeLines(5000, {}));
+		EXPECT_EQ(DiffPreparedFiles(dw, left.GetPath(), right.GetPath(), nullptr),
+			DiffPreparedFiles(dw, left.GetPath(), right.GetPath(), &prepared));
+		EXPECT_LT(9000, prepared.GetHashedLineCount());
+
+		// A rescan after a single-line edit hashes only the edited line
+		TempFile right2 = WriteToTempFile(MakeLines(5000, { 2500 }));
+		const auto expected = DiffPreparedFiles(dw, left.GetPath(), right2.GetPath(), nullptr);
+		EXPECT_EQ(3u, expected.size());
+		EXPECT_EQ(expected, DiffPreparedFiles(dw, left.GetPath(), right2.GetPath(), &prepared));
+		EXPECT_GE(4, prepared.GetHashedLineCount());
+	}
+}
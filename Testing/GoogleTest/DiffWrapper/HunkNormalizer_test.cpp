@@ -0,0 +1,138 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <cctype>
+#include <cstring>
+#include <string>
+#include "HunkNormalizer.h"
+#include "CompareOptions.h"
+
+namespace
+{
+	// The filters CDiffWrapper::PostFilter() applied one after another
+	// before HunkNormalizer, the normalized text must stay the same.
+
+	void Replace(std::string &target, const std::string &find, const std::string &replace)
+	{
+		std::string::size_type pos = 0;
+		while ((pos = target.find(find, pos)) != std::string::npos)
+		{
+			target.replace(pos, find.length(), replace);
+			pos += replace.length();
+		}
+	}
+
+	void ReplaceChars(std::string & str, const char* chars, const char *rep)
+	{
+		std::string::size_type pos = 0;
+		size_t replen = strlen(rep);
+		while ((pos = str.find_first_of(chars, pos)) != std::string::npos)
+		{
+			std::string::size_type posend = str.find_first_not_of(chars, pos);
+			if (posend != std::string::npos)
+				str.replace(pos, posend - pos, rep);
+			else
+				str.replace(pos, str.length() - pos, rep);
+			pos += replen;
+		}
+	}
+
+	std::string NormalizeStepwise(std::string text, int ignoreWhitespace, bool ignoreNumbers, bool ignoreCase, bool ignoreEOLDifference)
+	{
+		if (ignoreWhitespace == WHITESPACE_IGNORE_ALL)
+			ReplaceChars(text, " \t", "");
+		else if (ignoreWhitespace == WHITESPACE_IGNORE_CHANGE)
+			ReplaceChars(text, " \t", " ");
+		if (ignoreNumbers)
+			ReplaceChars(text, "0123456789", "");
+		if (ignoreCase)
+		{
+			for (auto& ch : text)
+				ch = static_cast<char>(::toupper(static_cast<unsigned char>(ch)));
+		}
+		if (ignoreEOLDifference)
+		{
+			Replace(text, "\r\n", "\n");
+			Replace(text, "\r", "\n");
+		}
+		return text;
+	}
+
+	std::string JoinLinesStepwise(std::string text, int ignoreWhitespace)
+	{
+		Replace(text, "\r\n", " ");
+		ReplaceChars(text, "\r\n", " ");
+		if (ignoreWhitespace == WHITESPACE_IGNORE_ALL)
+			ReplaceChars(text, " \t", "");
+		else if (ignoreWhitespace == WHITESPACE_IGNORE_CHANGE)
+			ReplaceChars(text, " \t", " ");
+		return text;
+	}
+
+	TEST(HunkNormalizer, Options)
+	{
+		std::string out;
+		HunkNormalizer().Normalize("a  b\t1\r\n", out);
+		EXPECT_EQ("a  b\t1\r\n", out);
+		HunkNormalizer(WHITESPACE_IGNORE_CHANGE).Normalize("a  b\t \tc ", out);
+		EXPECT_EQ("a b c ", out);
+		HunkNormalizer(WHITESPACE_IGNORE_ALL).Normalize(" a  b\t \tc ", out);
+		EXPECT_EQ("abc", out);
+		HunkNormalizer(WHITESPACE_COMPARE_ALL, true).Normalize("a1b22c333", out);
+		EXPECT_EQ("abc", out);
+		HunkNormalizer(WHITESPACE_COMPARE_ALL, false, true).Normalize("aBc\xe4", out);
+		EXPECT_EQ("ABC\xe4", out);
+		HunkNormalizer(WHITESPACE_COMPARE_ALL, false, false, true).Normalize("a\r\nb\rc\nd\r\r\n", out);
+		EXPECT_EQ("a\nb\nc\nd\n\n", out);
+	}
+
+	TEST(HunkNormalizer, OptionsInteract)
+	{
+		std::string out;
+		// The spaces around a removed number are two runs
+		HunkNormalizer(WHITESPACE_IGNORE_CHANGE, true).Normalize("a \t1 \tb", out);
+		EXPECT_EQ("a  b", out);
+		// CR and LF brought together by removed characters are a CR+LF pair
+		HunkNormalizer(WHITESPACE_IGNORE_ALL, true, false, true).Normalize("a\r 1\nb", out);
+		EXPECT_EQ("a\nb", out);
+	}
+
+	TEST(HunkNormalizer, JoinLines)
+	{
+		std::string out;
+		HunkNormalizer().JoinLines("a\r\nb\n\nc\r\r\nd", out);
+		EXPECT_EQ("a b c  d", out);
+		HunkNormalizer(WHITESPACE_IGNORE_CHANGE).JoinLines("a \r\n b\n", out);
+		EXPECT_EQ("a b ", out);
+		HunkNormalizer(WHITESPACE_IGNORE_ALL).JoinLines("a \r\n b\n", out);
+		EXPECT_EQ("ab", out);
+	}
+
+	// Random text of the characters the options handle, longer than a SIMD block
+	TEST(HunkNormalizer, SameAsStepwise)
+	{
+		const char chars[] = "ab \t \t01\r\n\r\nxZ";
+		unsigned seed = 1;
+		std::string out, joined;
+		for (int n = 0; n < 2000; ++n)
+		{
+			std::string text;
+			seed = seed * 1103515245 + 12345;
+			const int len = static_cast<int>((seed >> 8) % 80);
+			for (int i = 0; i < len; ++i)
+			{
+				seed = seed * 1103515245 + 12345;
+				text += chars[(seed >> 8) % (sizeof(chars) - 1)];
+			}
+			const int ignoreWhitespace = n % 3;
+			const bool ignoreNumbers = (n / 3) % 2 != 0;
+			const bool ignoreCase = (n / 6) % 2 != 0;
+			const bool ignoreEOLDifference = (n / 12) % 2 != 0;
+			HunkNormalizer normalizer(ignoreWhitespace, ignoreNumbers, ignoreCase, ignoreEOLDifference);
+			normalizer.Normalize(text, out);
+			const std::string expected = NormalizeStepwise(text, ignoreWhitespace, ignoreNumbers, ignoreCase, ignoreEOLDifference);
+			ASSERT_EQ(expected, out) << "options " << n % 24;
+			normalizer.JoinLines(out, joined);
+			ASSERT_EQ(JoinLinesStepwise(expected, ignoreWhitespace), joined) << "options " << n % 24;
+		}
+	}
+}
@@ -0,0 +1,316 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "cio.h"
+#include "TFile.h"
+#include "TestFiles.h"
+#include "StreamingDiff.h"
+#include "CompareOptions.h"
+#include "diff.h"
+#include "xdiff_gnudiff_compat.h"
+
+namespace
+{
+	/** @brief File in memory, counting the bytes read. */
+	class StringSource : public StreamingDiff::Source
+	{
+	public:
+		explicit StringSource(const std::string& text) : m_text(text), m_pos(0) {}
+
+		size_t Read(char *buf, size_t size) override
+		{
+			const size_t n = (std::min)(size, m_text.size() - m_pos);
+			memcpy(buf, m_text.data() + m_pos, n);
+			m_pos += n;
+			return n;
+		}
+
+		void Seek(uint64_t offset) override { m_pos = static_cast<size_t>(offset); }
+
+	private:
+		const std::string& m_text;
+		size_t m_pos;
+	};
+
+	struct Change
+	{
+		int line0, line1, deleted, inserted;
+		bool operator==(const Change& other) const
+		{
+			return line0 == other.line0 && line1 == other.line1 && deleted == other.deleted && inserted == other.inserted;
+		}
+	};
+
+	std::vector<Change> Diff(StreamingDiff& diff, const std::string& text0, const std::string& text1)
+	{
+		std::vector<Change> changes;
+		StringSource source0(text0), source1(text1);
+		diff.Diff(source0, source1, [&changes](int line0, int line1, int deleted, int inserted)
+			{
+				changes.push_back({ line0, line1, deleted, inserted });
+			});
+		return changes;
+	}
+
+	/** @brief Lines split at LF, CR+LF and CR, without the EOLs if @p stripEol. */
+	std::vector<std::string> SplitLines(const std::string& text, bool stripEol)
+	{
+		std::vector<std::string> lines;
+		size_t begin = text.compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0;
+		while (begin < text.size())
+		{
+			size_t end = text.find_first_of("\r\n", begin);
+			size_t eol = 0;
+			if (end == std::string::npos)
+				end = text.size();
+			else
+				eol = (text.compare(end, 2, "\r\n") == 0) ? 2 : 1;
+			lines.push_back(text.substr(begin, end - begin + (stripEol ? 0 : eol)));
+			begin = end + eol;
+		}
+		return lines;
+	}
+
+	/** @brief Check that the changes are ordered and turn @p text0 into @p text1. */
+	void ExpectValidScript(const std::string& text0, const std::string& text1, const std::vector<Change>& changes, bool ignoreEol = false)
+	{
+		const std::vector<std::string> lines0 = SplitLines(text0, ignoreEol);
+		const std::vector<std::string> lines1 = SplitLines(text1, ignoreEol);
+		int line0 = 0, line1 = 0;
+		auto expectEqualUntil = [&](int end0, int end1)
+		{
+			ASSERT_EQ(end0 - line0, end1 - line1);
+			for (; line0 < end0; ++line0, ++line1)
+				ASSERT_EQ(lines0[line0], lines1[line1]) << "line " << line0;
+		};
+		for (const auto& change : changes)
+		{
+			ASSERT_TRUE(change.deleted > 0 || change.inserted > 0);
+			ASSERT_LE(line0, change.line0);
+			ASSERT_LE(line1, change.line1);
+			expectEqualUntil(change.line0, change.line1);
+			line0 += change.deleted;
+			line1 += change.inserted;
+		}
+		ASSERT_LE(line0, static_cast<int>(lines0.size()));
+		ASSERT_LE(line1, static_cast<int>(lines1.size()));
+		expectEqualUntil(static_cast<int>(lines0.size()), static_cast<int>(lines1.size()));
+	}
+
+	std::string MakeLines(int first, int count, const char *eol = "\n")
+	{
+		std::string text;
+		for (int i = first; i < first + count; ++i)
+			text += "line " + std::to_string(i) + " of the text" + eol;
+		return text;
+	}
+
+	/** @brief Every @p every th line of @p text changed. */
+	std::string Edit(const std::string& text, int every)
+	{
+		std::vector<std::string> lines = SplitLines(text, false);
+		std::string edited;
+		for (size_t i = 0; i < lines.size(); ++i)
+			edited += (i % every == every / 2) ? "changed " + lines[i] : lines[i];
+		return edited;
+	}
+
+	unsigned long PatienceFlags(bool ignoreEOLDifference = false)
+	{
+		DiffutilsOptions options;
+		options.m_diffAlgorithm = DIFF_ALGORITHM_STREAMING;
+		options.m_bIgnoreEOLDifference = ignoreEOLDifference;
+		return make_xdl_flags(options);
+	}
+
+	// With the files in one window the result is the one of xdiff
+	TEST(StreamingDiff, SameAsPatienceInOneWindow)
+	{
+		const std::string text0 = MakeLines(0, 2000);
+		const std::string texts1[] = {
+			Edit(text0, 100),
+			MakeLines(0, 500) + MakeLines(1500, 500),
+			MakeLines(0, 1000) + MakeLines(5000, 30) + MakeLines(1000, 1000),
+			MakeLines(1000, 1000) + MakeLines(0, 1000),
+			"",
+			text0,
+		};
+		for (const auto& text1 : texts1)
+		{
+			StreamingDiff diff(PatienceFlags());
+			const std::vector<Change> changes = Diff(diff, text0, text1);
+			ExpectValidScript(text0, text1, changes);
+			std::vector<Change> expected;
+			change *script = diff_2_buffers_xdiff(text0.data(), text0.size(), text1.data(), text1.size(), static_cast<unsigned>(PatienceFlags()));
+			for (change *e = script, *next = nullptr; e != nullptr; e = next)
+			{
+				expected.push_back({ e->line0, e->line1, e->deleted, e->inserted });
+				next = e->link;
+				free(e);
+			}
+			EXPECT_EQ(expected, changes);
+		}
+	}
+
+	// Changed lines spread over many windows are found one by one
+	TEST(StreamingDiff, EditsAcrossWindows)
+	{
+		const std::string text0 = MakeLines(0, 100000);
+		const std::string text1 = Edit(text0, 100);
+		StreamingDiff diff(PatienceFlags(), 64 * 1024);
+		const std::vector<Change> changes = Diff(diff, text0, text1);
+		ExpectValidScript(text0, text1, changes);
+		ASSERT_EQ(1000u, changes.size());
+		for (size_t i = 0; i < changes.size(); ++i)
+			EXPECT_EQ((Change{ static_cast<int>(i * 100 + 50), static_cast<int>(i * 100 + 50), 1, 1 }), changes[i]);
+		// Memory depends on the window size, not the file size
+		EXPECT_LT(diff.GetPeakBufferSize(), 4u * 64 * 1024);
+	}
+
+	// Insertions and deletions longer than a window realign the windows
+	TEST(StreamingDiff, LongInsertionAndDeletion)
+	{
+		const std::string text0 = MakeLines(0, 20000) + MakeLines(20000, 20000);
+		const std::string text1 = MakeLines(0, 20000) + MakeLines(100000, 15000) + MakeLines(20000, 20000);
+		StreamingDiff diff(PatienceFlags(), 64 * 1024);
+		std::vector<Change> changes = Diff(diff, text0, text1);
+		ExpectValidScript(text0, text1, changes);
+		EXPECT_EQ((std::vector<Change>{ { 20000, 20000, 0, 15000 } }), changes);
+		EXPECT_LT(diff.GetPeakBufferSize(), 4u * 64 * 1024);
+
+		changes = Diff(diff, text1, text0);
+		ExpectValidScript(text1, text0, changes);
+		EXPECT_EQ((std::vector<Change>{ { 20000, 20000, 15000, 0 } }), changes);
+	}
+
+	// Blocks of different lines longer than a window replace each other
+	TEST(StreamingDiff, LongReplacement)
+	{
+		const std::string text0 = MakeLines(0, 10000) + MakeLines(100000, 20000) + MakeLines(10000, 10000);
+		const std::string text1 = MakeLines(0, 10000) + MakeLines(200000, 25000) + MakeLines(10000, 10000);
+		StreamingDiff diff(PatienceFlags(), 64 * 1024);
+		const std::vector<Change> changes = Diff(diff, text0, text1);
+		ExpectValidScript(text0, text1, changes);
+		int deleted = 0, inserted = 0;
+		for (const auto& change : changes)
+		{
+			deleted += change.deleted;
+			inserted += change.inserted;
+		}
+		EXPECT_EQ(20000, deleted);
+		EXPECT_EQ(25000, inserted);
+	}
+
+	// Any script is valid, whatever the window size
+	TEST(StreamingDiff, SmallWindows)
+	{
+		std::string text0, text1;
+		unsigned seed = 7;
+		for (int i = 0; i < 20000; ++i)
+		{
+			seed = seed * 1103515245 + 12345;
+			const std::string line = "line " + std::to_string((seed >> 8) % 500) + "\n";
+			if ((seed >> 4) % 8 != 0)
+				text0 += line;
+			if ((seed >> 12) % 8 != 0)
+				text1 += (seed >> 20) % 16 == 0 ? "changed " + line : line;
+		}
+		for (size_t windowSize : { 1u, 100u, 4096u, 65536u })
+		{
+			StreamingDiff diff(PatienceFlags(), windowSize);
+			ExpectValidScript(text0, text1, Diff(diff, text0, text1));
+		}
+	}
+
+	TEST(StreamingDiff, TextStats)
+	{
+		const std::string text0 = "\xEF\xBB\xBF" "a\r\nb\rc\nd\r\n\r" + std::string("e\0f", 3);
+		const std::string text1 = "a\nb\nc\nd\n\ne\n";
+		StreamingDiff diff(PatienceFlags(), 4);
+		const std::vector<Change> changes = Diff(diff, text0, text1);
+		ExpectValidScript(text0, text1, changes);
+		const StreamingDiff::TextStats& stats0 = diff.GetTextStats(0);
+		EXPECT_EQ(2, stats0.crlfs);
+		EXPECT_EQ(2, stats0.crs);
+		EXPECT_EQ(1, stats0.lfs);
+		EXPECT_EQ(1, stats0.zeros);
+		EXPECT_TRUE(stats0.missingNewline);
+		const StreamingDiff::TextStats& stats1 = diff.GetTextStats(1);
+		EXPECT_EQ(0, stats1.crlfs);
+		EXPECT_EQ(0, stats1.crs);
+		EXPECT_EQ(6, stats1.lfs);
+		EXPECT_EQ(0, stats1.zeros);
+		EXPECT_FALSE(stats1.missingNewline);
+	}
+
+	TEST(StreamingDiff, IgnoreEOLDifference)
+	{
+		const std::string text0 = MakeLines(0, 50000, "\r\n");
+		const std::string text1 = Edit(MakeLines(0, 50000, "\n"), 1000);
+		for (size_t windowSize : { static_cast<size_t>(4096), StreamingDiff::DefaultWindowSize })
+		{
+			StreamingDiff diff(PatienceFlags(true), windowSize);
+			const std::vector<Change> changes = Diff(diff, text0, text1);
+			ExpectValidScript(text0, text1, changes, true);
+			EXPECT_EQ(50u, changes.size());
+		}
+		StreamingDiff diff(PatienceFlags(false), 4096);
+		const std::vector<Change> changes = Diff(diff, text0, text1);
+		ExpectValidScript(text0, text1, changes);
+		EXPECT_EQ((std::vector<Change>{ { 0, 0, 50000, 50000 } }), changes);
+	}
+
+	/** @brief Changes and text statistics of diff_2_files_streaming(), or of diff_2_files_xdiff() if !streaming. */
+	std::vector<int> DiffFiles(const String& path0, const String& path1, bool streaming, int *bin_file)
+	{
+		std::vector<int> result;
+		file_data inf[2] = {};
+		const String paths[2] = { path0, path1 };
+		for (int i = 0; i < 2; ++i)
+		{
+			inf[i].name = "";
+			cio::tsopen_s(&inf[i].desc, paths[i], O_RDONLY | O_BINARY, _SH_DENYNO, _S_IREAD);
+			cio::fstat(inf[i].desc, &inf[i].stat);
+		}
+		int bin_status = 0;
+		change *script = streaming ?
+			diff_2_files_streaming(inf, &bin_status, bin_file, static_cast<unsigned>(PatienceFlags()), 4096) :
+			diff_2_files_xdiff(inf, &bin_status, false, bin_file, static_cast<unsigned>(PatienceFlags()));
+		for (change *e = script, *p = nullptr; e != nullptr; e = p)
+		{
+			result.insert(result.end(), { e->line0, e->line1, e->deleted, e->inserted });
+			p = e->link;
+			free(e);
+		}
+		for (int i = 0; i < 2; ++i)
+			result.insert(result.end(), { inf[i].count_crlfs, inf[i].count_crs, inf[i].count_lfs, inf[i].count_zeros, inf[i].missing_newline });
+		cleanup_file_buffers(inf);
+		for (int i = 0; i < 2; ++i)
+			cio::close(inf[i].desc);
+		return result;
+	}
+
+	// Files give the changes and statistics of the in-memory compare
+	TEST(StreamingDiff, diff_2_files_streaming)
+	{
+		const String filename0 = TempFileName(_T("_tmp_streaming0.txt"));
+		const String filename1 = TempFileName(_T("_tmp_streaming1.txt"));
+		const std::string text0 = MakeLines(0, 200, "\r\n") + "last";
+		WriteFile(filename0, text0);
+		WriteFile(filename1, Edit(MakeLines(0, 200, "\n"), 50));
+		int bin_file = -1;
+		EXPECT_EQ(DiffFiles(filename0, filename1, false, &bin_file), DiffFiles(filename0, filename1, true, &bin_file));
+		EXPECT_EQ(0, bin_file);
+
+		// Binary files are checked like diffutils does
+		WriteFile(filename1, std::string("a\0b\n", 4));
+		bin_file = 0;
+		DiffFiles(filename0, filename1, true, &bin_file);
+		EXPECT_EQ(2, bin_file);
+		TFile(filename0).remove();
+		TFile(filename1).remove();
+	}
+}
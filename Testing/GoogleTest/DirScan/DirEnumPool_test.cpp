@@ -0,0 +1,203 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include "DirEnumPool.h"
+#include "DirItem.h"
+#include "paths.h"
+
+namespace
+{
+	/** @brief Folder tree in memory, with @p fanout subfolders and files per folder. */
+	class FakeTree
+	{
+	public:
+		FakeTree(int fanout, int depth) : m_root(_T("root"))
+		{
+			Add(m_root, fanout, depth);
+		}
+
+		const String& Root() const { return m_root; }
+		size_t GetFolderCount() const { return m_folders.size(); }
+
+		DirEnumPool::LoadFunc Loader()
+		{
+			return [this](const String& sDir, DirItemArray *dirs, DirItemArray *files)
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					++m_loads[sDir];
+				}
+				auto it = m_folders.find(sDir);
+				if (it == m_folders.end())
+					return;
+				for (const auto& name : it->second.first)
+				{
+					DirItem item;
+					item.filename = name;
+					dirs->push_back(item);
+				}
+				for (const auto& name : it->second.second)
+				{
+					DirItem item;
+					item.filename = name;
+					item.size = 1;
+					files->push_back(item);
+				}
+			};
+		}
+
+		int GetLoadCount(const String& sDir) const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto it = m_loads.find(sDir);
+			return it == m_loads.end() ? 0 : it->second;
+		}
+
+		std::map<String, int> GetLoads() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_loads;
+		}
+
+	private:
+		void Add(const String& sDir, int fanout, int depth)
+		{
+			auto& folder = m_folders[sDir];
+			for (int i = 0; i < fanout; ++i)
+			{
+				folder.second.push_back(_T("file") + strutils::to_str(i));
+				if (depth > 0)
+				{
+					const String name = _T("dir") + strutils::to_str(i);
+					folder.first.push_back(name);
+					Add(paths::ConcatPath(sDir, name), fanout, depth - 1);
+				}
+			}
+		}
+
+		String m_root;
+		std::map<String, std::pair<std::vector<String>, std::vector<String>>> m_folders;
+		mutable std::mutex m_mutex;
+		std::map<String, int> m_loads;
+	};
+
+	/** @brief Walk the tree depth-first like DirScan_GetItems(), return the folders walked. */
+	size_t Walk(DirEnumPool& pool, const String& sDir)
+	{
+		DirEnumPool::Listing *listing = pool.Get(sDir);
+		std::vector<String> subdirs;
+		for (const auto& dir : listing->dirs)
+			subdirs.push_back(paths::ConcatPath(sDir, dir.filename.get()));
+		pool.Release(listing);
+		size_t nFolders = 1;
+		for (const auto& subdir : subdirs)
+			nFolders += Walk(pool, subdir);
+		return nFolders;
+	}
+
+	/** @brief Wait until @p done is true or some seconds have passed. */
+	template <class Pred>
+	bool WaitFor(Pred done)
+	{
+		for (int i = 0; i < 500 && !done(); ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		return done();
+	}
+
+	TEST(DirEnumPool, WalkListsEachFolderOnce)
+	{
+		for (int nThreads : { 0, 1, 4 })
+		{
+			FakeTree tree(4, 4);
+			{
+				DirEnumPool pool(tree.Loader(), nThreads);
+				EXPECT_EQ(tree.GetFolderCount(), Walk(pool, tree.Root()));
+				EXPECT_EQ(0u, pool.GetPendingCount());
+			}
+			const auto loads = tree.GetLoads();
+			EXPECT_EQ(tree.GetFolderCount(), loads.size());
+			for (const auto& load : loads)
+				EXPECT_EQ(1, load.second) << load.first;
+		}
+	}
+
+	TEST(DirEnumPool, GetReturnsListing)
+	{
+		FakeTree tree(3, 1);
+		DirEnumPool pool(tree.Loader(), 2);
+		DirEnumPool::Listing *listing = pool.Get(tree.Root());
+		ASSERT_EQ(3u, listing->dirs.size());
+		ASSERT_EQ(3u, listing->files.size());
+		EXPECT_EQ(_T("dir1"), listing->dirs[1].filename.get());
+		EXPECT_EQ(_T("file2"), listing->files[2].filename.get());
+		pool.Release(listing);
+	}
+
+	// The subfolders are listed ahead, as deep as the prefetch levels
+	TEST(DirEnumPool, Prefetch)
+	{
+		FakeTree tree(2, 4);
+		DirEnumPool pool(tree.Loader(), 2, 2);
+		pool.Release(pool.Get(tree.Root()));
+		const String dir1 = paths::ConcatPath(tree.Root(), _T("dir1"));
+		const String dir11 = paths::ConcatPath(dir1, _T("dir1"));
+		EXPECT_TRUE(WaitFor([&]() { return tree.GetLoadCount(dir11) == 1; }));
+		EXPECT_TRUE(WaitFor([&]() { return pool.GetPendingCount() == 6; }));
+		EXPECT_EQ(0, tree.GetLoadCount(paths::ConcatPath(dir11, _T("dir1"))));
+
+		// Taking a subfolder lists the next level
+		pool.Release(pool.Get(dir1));
+		EXPECT_TRUE(WaitFor([&]() { return tree.GetLoadCount(paths::ConcatPath(dir11, _T("dir1"))) == 1; }));
+	}
+
+	// Discarded folders and the folders listed ahead under them are dropped
+	TEST(DirEnumPool, Discard)
+	{
+		FakeTree tree(2, 4);
+		DirEnumPool pool(tree.Loader(), 2, 2);
+		pool.Release(pool.Get(tree.Root()));
+		EXPECT_TRUE(WaitFor([&]() { return pool.GetPendingCount() == 6; }));
+		pool.Discard(paths::ConcatPath(tree.Root(), _T("dir0")));
+		EXPECT_TRUE(WaitFor([&]() { return pool.GetPendingCount() == 3; }));
+		pool.Discard(paths::ConcatPath(tree.Root(), _T("dir1")));
+		EXPECT_TRUE(WaitFor([&]() { return pool.GetPendingCount() == 0; }));
+		// Not requested
+		pool.Discard(_T("other"));
+		EXPECT_EQ(0u, pool.GetPendingCount());
+	}
+
+	TEST(DirEnumPool, ListingsAreReused)
+	{
+		FakeTree tree(3, 2);
+		DirEnumPool pool(tree.Loader(), 0, 0);
+		DirEnumPool::Listing *listing = pool.Get(tree.Root());
+		const size_t capacity = listing->files.capacity();
+		pool.Release(listing);
+		EXPECT_TRUE(listing->files.empty());
+		DirEnumPool::Listing *next = pool.Get(paths::ConcatPath(tree.Root(), _T("dir0")));
+		EXPECT_EQ(listing, next);
+		EXPECT_GE(next->files.capacity(), capacity);
+		EXPECT_EQ(3u, next->files.size());
+		pool.Release(next);
+		EXPECT_EQ(1, tree.GetLoadCount(tree.Root()));
+		EXPECT_EQ(0, tree.GetLoadCount(paths::ConcatPath(tree.Root(), _T("dir1"))));
+	}
+
+	// A folder which can't be listed has no items
+	TEST(DirEnumPool, LoadThrows)
+	{
+		DirEnumPool pool([](const String& sDir, DirItemArray *dirs, DirItemArray *files)
+			{
+				files->push_back(DirItem());
+				throw std::runtime_error("access denied");
+			}, 1);
+		DirEnumPool::Listing *listing = pool.Get(_T("denied"));
+		EXPECT_TRUE(listing->dirs.empty());
+		EXPECT_TRUE(listing->files.empty());
+		pool.Release(listing);
+	}
+}
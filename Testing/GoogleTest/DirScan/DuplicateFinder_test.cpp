@@ -0,0 +1,226 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "cio.h"
+#include "TFile.h"
+#include "Environment.h"
+#include "paths.h"
+#include "IAbortable.h"
+#include "DuplicateFinder.h"
+#include "HashCalc.h"
+
+namespace
+{
+	class DuplicateFinderTest : public testing::Test
+	{
+	protected:
+		void TearDown() override
+		{
+			for (const auto& path : m_paths)
+				TFile(path).remove();
+		}
+
+		String MakeFile(const std::string& data)
+		{
+			const String path = paths::ConcatPath(env::GetTemporaryPath(),
+				strutils::format(_T("_tmp_duplicatefinder%d.bin"), static_cast<int>(m_paths.size())));
+			int fd = -1;
+			cio::tsopen_s(&fd, path, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE);
+			EXPECT_GE(fd, 0);
+			cio::write(fd, data.data(), static_cast<unsigned>(data.size()));
+			cio::close(fd);
+			m_paths.push_back(path);
+			return path;
+		}
+
+		size_t AddFile(DuplicateFinder& finder, const std::string& data)
+		{
+			return finder.AddFile(MakeFile(data), static_cast<int64_t>(data.size()));
+		}
+
+		std::vector<String> m_paths;
+	};
+
+	std::string MakeData(size_t size, int seed)
+	{
+		std::string data(size, '\0');
+		for (size_t i = 0; i < size; ++i)
+			data[i] = static_cast<char>(i * 7 + seed);
+		return data;
+	}
+
+	class Aborter : public IAbortable
+	{
+	public:
+		bool ShouldAbort() const override { return true; }
+	};
+
+	TEST(DigestMap, InsertAndFind)
+	{
+		DigestMap<int> map;
+		EXPECT_EQ(nullptr, map.Find(DigestKey()));
+		for (int i = 0; i < 1000; ++i)
+		{
+			const uint64_t digest = i * 0x9E3779B97F4A7C15ULL;
+			map[DigestKey(reinterpret_cast<const uint8_t *>(&digest), sizeof(digest))] = i;
+		}
+		EXPECT_EQ(1000u, map.size());
+		for (int i = 0; i < 1000; ++i)
+		{
+			const uint64_t digest = i * 0x9E3779B97F4A7C15ULL;
+			const int *value = map.Find(DigestKey(reinterpret_cast<const uint8_t *>(&digest), sizeof(digest)));
+			ASSERT_NE(nullptr, value);
+			EXPECT_EQ(i, *value);
+		}
+		const uint64_t digest = 0;
+		EXPECT_EQ(nullptr, map.Find(DigestKey(reinterpret_cast<const uint8_t *>(&digest), sizeof(digest), 1)));
+	}
+
+	// The size and the type are part of the key
+	TEST(DigestMap, KeysDifferBySizeAndType)
+	{
+		const std::vector<uint8_t> digest{ 1, 2, 3, 4 };
+		DigestMap<int> map;
+		map[DigestKey(digest.data(), digest.size(), 10, 1)] = 1;
+		map[DigestKey(digest.data(), digest.size(), 11, 1)] = 2;
+		map[DigestKey(digest.data(), digest.size(), 10, 2)] = 3;
+		map[DigestKey(digest)] = 4;
+		EXPECT_EQ(4u, map.size());
+		EXPECT_EQ(3, *map.Find(DigestKey(digest.data(), digest.size(), 10, 2)));
+		EXPECT_EQ(4, *map.Find(DigestKey(digest)));
+	}
+
+	// Files of a size no other file has are never opened
+	TEST_F(DuplicateFinderTest, UniqueSizesAreNotRead)
+	{
+		DuplicateFinder finder(2);
+		finder.AddFile(_T("/nonexistent/a"), 10);
+		finder.AddFile(_T("/nonexistent/b"), 20);
+		const size_t c = AddFile(finder, "abc");
+		EXPECT_EQ(0, finder.Find());
+		EXPECT_EQ(0, finder.GetPartialHashCount());
+		EXPECT_EQ(0, finder.GetFullHashCount());
+		EXPECT_EQ(0, finder.GetGroup(c));
+	}
+
+	TEST_F(DuplicateFinderTest, SmallFiles)
+	{
+		DuplicateFinder finder(2);
+		const size_t a = AddFile(finder, "hello");
+		const size_t b = AddFile(finder, "world");
+		const size_t c = AddFile(finder, "hello");
+		const size_t d = AddFile(finder, "");
+		const size_t e = AddFile(finder, "");
+		EXPECT_EQ(2, finder.Find());
+		EXPECT_EQ(1, finder.GetGroup(a));
+		EXPECT_EQ(0, finder.GetGroup(b));
+		EXPECT_EQ(1, finder.GetGroup(c));
+		EXPECT_EQ(2, finder.GetGroup(d));
+		EXPECT_EQ(2, finder.GetGroup(e));
+		// Empty files are not read, small files are read once
+		EXPECT_EQ(3, finder.GetPartialHashCount());
+		EXPECT_EQ(0, finder.GetFullHashCount());
+	}
+
+	// Only the files whose ends match are read whole
+	TEST_F(DuplicateFinderTest, LargeFiles)
+	{
+		const size_t size = 5 * DuplicateFinder::PartialSize;
+		const std::string data = MakeData(size, 1);
+		std::string middle = data;
+		middle[size / 2] ^= 1;
+		std::string head = data;
+		head[0] ^= 1;
+
+		DuplicateFinder finder(2);
+		const size_t a = AddFile(finder, data);
+		const size_t b = AddFile(finder, middle);
+		const size_t c = AddFile(finder, head);
+		const size_t d = AddFile(finder, data);
+		EXPECT_EQ(1, finder.Find());
+		EXPECT_EQ(1, finder.GetGroup(a));
+		EXPECT_EQ(0, finder.GetGroup(b));
+		EXPECT_EQ(0, finder.GetGroup(c));
+		EXPECT_EQ(1, finder.GetGroup(d));
+		EXPECT_EQ(4, finder.GetPartialHashCount());
+		EXPECT_EQ(3, finder.GetFullHashCount());
+	}
+
+	// A file which can't be read is nobody's duplicate
+	TEST_F(DuplicateFinderTest, MissingFile)
+	{
+		DuplicateFinder finder(2);
+		const size_t a = AddFile(finder, "same");
+		const size_t b = finder.AddFile(_T("/nonexistent/same"), 4);
+		const size_t c = AddFile(finder, "same");
+		EXPECT_EQ(1, finder.Find());
+		EXPECT_EQ(1, finder.GetGroup(a));
+		EXPECT_EQ(0, finder.GetGroup(b));
+		EXPECT_EQ(1, finder.GetGroup(c));
+	}
+
+	// The files read whole have the XXH3 digest HashCalc gives
+	TEST_F(DuplicateFinderTest, FullDigests)
+	{
+		const std::string large = MakeData(5 * DuplicateFinder::PartialSize, 1);
+		std::string largeHead = large;
+		largeHead[0] ^= 1;
+		DuplicateFinder finder(2);
+		const size_t a = AddFile(finder, "hello");
+		const size_t b = AddFile(finder, "world");
+		const size_t c = AddFile(finder, large);
+		const size_t d = AddFile(finder, large);
+		const size_t e = AddFile(finder, largeHead);
+		const size_t f = AddFile(finder, "unique size");
+		const size_t g = AddFile(finder, "");
+		const size_t h = AddFile(finder, "");
+		EXPECT_EQ(2, finder.Find());
+		const size_t read[] = { a, b, c, d, g, h };
+		for (size_t i : read)
+		{
+			HashCalc::Hashes hashes;
+			ASSERT_TRUE(HashCalc::HashFile(m_paths[i], HashCalc::Flag(HashCalc::XXH3), hashes));
+			std::vector<uint8_t> digest;
+			EXPECT_TRUE(finder.GetFullDigest(i, digest));
+			EXPECT_EQ(hashes[HashCalc::XXH3], digest);
+		}
+		// Only partly read, or not at all
+		std::vector<uint8_t> digest;
+		EXPECT_FALSE(finder.GetFullDigest(e, digest));
+		EXPECT_FALSE(finder.GetFullDigest(f, digest));
+	}
+
+	// Digests given with the files are grouped without reading anything,
+	// groups are numbered in the order their second file was added
+	TEST(DuplicateFinder, GivenDigests)
+	{
+		const std::vector<uint8_t> x{ 1, 2, 3 }, y{ 4, 5, 6 };
+		DuplicateFinder finder(1);
+		const size_t a = finder.AddDigest(100, x.data(), x.size());
+		const size_t b = finder.AddDigest(100, y.data(), y.size());
+		const size_t c = finder.AddDigest(100, y.data(), y.size());
+		const size_t d = finder.AddDigest(100, x.data(), x.size());
+		const size_t e = finder.AddDigest(200, x.data(), x.size());
+		EXPECT_EQ(2, finder.Find());
+		EXPECT_EQ(2, finder.GetGroup(a));
+		EXPECT_EQ(1, finder.GetGroup(b));
+		EXPECT_EQ(1, finder.GetGroup(c));
+		EXPECT_EQ(2, finder.GetGroup(d));
+		EXPECT_EQ(0, finder.GetGroup(e));
+		EXPECT_EQ(0, finder.GetPartialHashCount());
+	}
+
+	TEST_F(DuplicateFinderTest, Abort)
+	{
+		DuplicateFinder finder(2);
+		const size_t a = AddFile(finder, "same");
+		const size_t b = AddFile(finder, "same");
+		Aborter aborter;
+		EXPECT_EQ(0, finder.Find(&aborter));
+		EXPECT_EQ(0, finder.GetGroup(a));
+		EXPECT_EQ(0, finder.GetGroup(b));
+		EXPECT_EQ(1, finder.Find());
+		EXPECT_EQ(1, finder.GetGroup(a));
+	}
+}
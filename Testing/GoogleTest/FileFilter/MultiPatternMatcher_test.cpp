@@ -0,0 +1,155 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include "MultiPatternMatcher.h"
+#include <string>
+#include <vector>
+#include <Poco/RegularExpression.h>
+
+namespace
+{
+	const int Caseless = Poco::RegularExpression::RE_CASELESS | Poco::RegularExpression::RE_UTF8;
+	const int CaseSensitive = Poco::RegularExpression::RE_UTF8;
+
+	struct TestPattern
+	{
+		const char *regex;
+		int reOpts;
+		bool fileNameOnly;
+	};
+
+	/** @brief Match a string against the patterns one by one, like TestAgainstRegList() does. */
+	bool MatchOneByOne(const std::vector<TestPattern>& patterns, const std::string& string)
+	{
+		std::string fileName = string;
+		const size_t pos = string.size() >= 2 ? string.find_last_of("\\/", string.size() - 2) : std::string::npos;
+		if (pos != std::string::npos)
+			fileName = string.substr(pos + 1);
+		for (const auto& pattern : patterns)
+		{
+			Poco::RegularExpression regexp(pattern.regex, pattern.reOpts);
+			Poco::RegularExpression::Match match;
+			if (regexp.match(pattern.fileNameOnly ? fileName : string, 0, match) > 0)
+				return true;
+		}
+		return false;
+	}
+
+	MultiPatternMatcher Compile(const std::vector<TestPattern>& patterns)
+	{
+		MultiPatternMatcher matcher;
+		for (const auto& pattern : patterns)
+			matcher.AddPattern(pattern.regex, pattern.reOpts, pattern.fileNameOnly);
+		matcher.Compile();
+		return matcher;
+	}
+}
+
+TEST(MultiPatternMatcher, Empty)
+{
+	MultiPatternMatcher matcher;
+	EXPECT_FALSE(matcher.IsCompiled());
+	EXPECT_FALSE(matcher.Match("\\a.cpp"));
+	matcher.Compile();
+	EXPECT_TRUE(matcher.IsCompiled());
+	EXPECT_FALSE(matcher.Match("\\a.cpp"));
+	EXPECT_FALSE(matcher.Match(""));
+}
+
+TEST(MultiPatternMatcher, FileMasks)
+{
+	const std::vector<TestPattern> patterns = {
+		{ "(^|\\\\)[^\\\\]*\\.cpp$", CaseSensitive, false },
+		{ "(^|\\\\)[^\\\\]*\\.h$", CaseSensitive, false },
+		{ "(^|\\\\)makefile\\.$", CaseSensitive, false },
+	};
+	MultiPatternMatcher matcher = Compile(patterns);
+	EXPECT_EQ(3u, matcher.GetLiteralCount());
+	EXPECT_EQ(0u, matcher.GetRegExpCount());
+
+	EXPECT_TRUE(matcher.Match("\\src\\a.cpp"));
+	EXPECT_TRUE(matcher.Match("\\a.h"));
+	EXPECT_TRUE(matcher.Match(".h"));
+	EXPECT_TRUE(matcher.Match("\\src\\makefile."));
+	EXPECT_TRUE(matcher.Match("makefile."));
+	EXPECT_FALSE(matcher.Match("\\src\\a.cpp.bak"));
+	EXPECT_FALSE(matcher.Match("\\src\\a.CPP"));
+	EXPECT_FALSE(matcher.Match("\\src\\gnumakefile."));
+}
+
+TEST(MultiPatternMatcher, MatchEverything)
+{
+	MultiPatternMatcher matcher = Compile({ { ".*", CaseSensitive, false } });
+	EXPECT_EQ(1u, matcher.GetLiteralCount());
+	EXPECT_TRUE(matcher.Match(""));
+	EXPECT_TRUE(matcher.Match("\\a.cpp"));
+}
+
+TEST(MultiPatternMatcher, SameAsOneByOne)
+{
+	const std::vector<TestPattern> patterns = {
+		// literals
+		{ "\\.obj$", Caseless, true },
+		{ "\\.PDB$", Caseless, true },
+		{ "\\.bak$", Caseless, true },
+		{ "^vc\\d+\\.idb$", Caseless, true },
+		{ "^BuildLog\\.htm$", Caseless, true },
+		{ "\\ABLD\\.bat$", Caseless, true },
+		{ "\\\\\\.git$", Caseless, false },
+		{ "\\\\Debug\\\\", Caseless, false },
+		{ "^\\\\tmp", Caseless, false },
+		{ "~\\z", Caseless, true },
+		{ "(^|\\\\)CVS$", CaseSensitive, false },
+		{ "_test\\.cpp$", Caseless, false },
+		// joined into one alternation per subject and options
+		{ "\\.(exe|dll)$", Caseless, true },
+		{ "^[0-9]+\\.log$", Caseless, true },
+		{ "(?<!\\.min)\\.js$", Caseless, false },
+		// compiled alone
+		{ "^(a)\\1\\.txt$", Caseless, true },
+		{ "(?i)^readme$", CaseSensitive, true },
+	};
+	MultiPatternMatcher matcher = Compile(patterns);
+	EXPECT_EQ(11u, matcher.GetLiteralCount());
+	EXPECT_EQ(4u, matcher.GetRegExpCount());
+
+	const char *strings[] = {
+		"", "\\", "a.obj", "\\src\\A.OBJ", "\\src\\a.obj.txt", "\\src\\x.pdb", "\\src\\vc90.idb", "\\vc90.idb.x",
+		"\\src\\BUILDLOG.HTM", "\\src\\my buildlog.htm", "\\bld.bat", "\\src\\abld.bat", "\\src\\.git", "\\src\\.git\\config",
+		"\\.GIT", "\\src\\debug\\a.c", "\\src\\debug", "\\tmp\\a", "\\src\\tmp", "\\a.c~", "\\a.c~\\", "\\cvs", "\\CVS",
+		"\\src\\CVS", "\\src\\xCVS", "\\a.EXE", "\\a.dll\\", "\\123.log", "\\a\\1.log", "\\a_test.cpp", "\\a.js",
+		"\\a.min.js", "\\aa.txt", "\\ab.txt", "\\src\\README", "\\src\\readme.md", "\\dir\\",
+		"\\src\\\xC3\xA9t\xC3\xA9.obj", "\\src\\a.ba\xE2\x84\xAA", "\\src\\a.obj\n", "\\src\\\xE2\x84\xAA.pdb",
+	};
+	for (const char *string : strings)
+		EXPECT_EQ(MatchOneByOne(patterns, string), matcher.Match(string)) << string;
+	// KELVIN SIGN folds to 'k', the literal tables can't see that
+	EXPECT_TRUE(matcher.Match("\\src\\a.ba\xE2\x84\xAA"));
+}
+
+TEST(MultiPatternMatcher, InvalidAndClear)
+{
+	MultiPatternMatcher matcher;
+	matcher.AddPattern("([a-z", Caseless);
+	matcher.AddPattern("\\.c$", Caseless);
+	matcher.AddPattern("^[0-9]+$", Caseless);
+	matcher.Compile();
+	EXPECT_EQ(3u, matcher.GetPatternCount());
+	EXPECT_TRUE(matcher.Match("\\a.c"));
+	EXPECT_TRUE(matcher.Match("123"));
+	EXPECT_FALSE(matcher.Match("\\a.h"));
+
+	matcher.AddPattern("\\.h$", Caseless);
+	EXPECT_FALSE(matcher.IsCompiled());
+	matcher.Compile();
+	EXPECT_TRUE(matcher.Match("\\a.h"));
+
+	MultiPatternMatcher clone;
+	clone.CloneFrom(&matcher);
+	EXPECT_TRUE(clone.IsCompiled());
+	EXPECT_TRUE(clone.Match("\\a.h"));
+
+	matcher.Clear();
+	EXPECT_EQ(0u, matcher.GetPatternCount());
+	EXPECT_FALSE(matcher.Match("\\a.c"));
+	EXPECT_TRUE(clone.Match("\\a.c"));
+}
@@ -716,8 +716,8 @@ TEST_P(FilterExpressionTest, FileAttributes)
 	dt0.makeUTC(Poco::Timezone::tzd());
 	di.diffFileInfo[0].mtime = dt0.timestamp();
 	di.diffFileInfo[0].ctime = dt0.timestamp();
-	di.diffFileInfo[0].encoding.SetCodepage(65001);
-	di.diffFileInfo[0].version.SetFileVersion(0x00020010, 0x00300002);
+	di.diffFileInfo[0].GetEncodingRef().SetCodepage(65001);
+	di.diffFileInfo[0].GetVersionRef().SetFileVersion(0x00020010, 0x00300002);
 	di.diffFileInfo[1].path = L"abc";
 	di.diffFileInfo[2].path = L"abc";
 	di.diffFileInfo[2].filename = L"Alice.txt";
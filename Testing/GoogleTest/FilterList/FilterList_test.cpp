@@ -0,0 +1,105 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include "FilterList.h"
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	TEST(FilterList, Match)
+	{
+		FilterList list;
+		EXPECT_FALSE(list.HasRegExps());
+		EXPECT_FALSE(list.Match("abc"));
+		list.AddRegExp("^\\s*//");
+		list.AddRegExp("^\\s*$");
+		list.AddRegExp("Generated on \\d+");
+		EXPECT_TRUE(list.HasRegExps());
+		EXPECT_TRUE(list.Match("  // comment"));
+		EXPECT_TRUE(list.Match(""));
+		EXPECT_TRUE(list.Match("/* Generated on 20240101 */"));
+		EXPECT_FALSE(list.Match("int i; // comment"));
+		EXPECT_FALSE(list.Match("Generated on today"));
+		list.RemoveAllFilters();
+		EXPECT_FALSE(list.HasRegExps());
+		EXPECT_FALSE(list.Match("  // comment"));
+	}
+
+	TEST(FilterList, Invalid)
+	{
+		FilterList list;
+		list.AddRegExp("(abc");
+		EXPECT_FALSE(list.HasRegExps());
+		EXPECT_THROW(list.AddRegExp("(abc", true), std::runtime_error);
+		list.AddRegExp("abc");
+		EXPECT_TRUE(list.Match("xabcx"));
+	}
+
+	// A remembered verdict is forgotten when the expressions change
+	TEST(FilterList, VerdictsAfterChange)
+	{
+		FilterList list;
+		list.AddRegExp("^a");
+		EXPECT_FALSE(list.Match("ba"));
+		EXPECT_FALSE(list.Match("ba"));
+		list.AddRegExp("a$");
+		EXPECT_TRUE(list.Match("ba"));
+		list.RemoveAllFilters();
+		list.AddRegExp("^b$");
+		EXPECT_FALSE(list.Match("ba"));
+		EXPECT_TRUE(list.Match("b"));
+	}
+
+	// Strings too long to be remembered and more strings than fit
+	TEST(FilterList, ManyStrings)
+	{
+		FilterList list;
+		list.AddRegExp("7$");
+		list.Compile();
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			for (int i = 0; i < 100000; ++i)
+			{
+				const std::string line = std::to_string(i);
+				ASSERT_EQ(line.back() == '7', list.Match(line)) << line;
+			}
+			const std::string longLine = std::string(1000, 'x') + "7";
+			EXPECT_TRUE(list.Match(longLine));
+			EXPECT_FALSE(list.Match(longLine + "x"));
+		}
+	}
+
+	// Threads share one list, e.g. the compare threads of a folder compare
+	TEST(FilterList, Threads)
+	{
+		FilterList list;
+		list.AddRegExp("^\\s*//");
+		list.AddRegExp("[0-9]{4}-[0-9]{2}-[0-9]{2}");
+		std::vector<std::string> lines;
+		for (int i = 0; i < 200; ++i)
+		{
+			lines.push_back("// Copyright " + std::to_string(i));
+			lines.push_back("int x" + std::to_string(i) + ";");
+			lines.push_back("date 2024-01-" + std::to_string(10 + i % 20));
+		}
+		std::vector<int> nMatches(8);
+		std::vector<std::thread> threads;
+		for (size_t t = 0; t < nMatches.size(); ++t)
+		{
+			threads.emplace_back([&list, &lines, &nMatches, t]()
+				{
+					for (int pass = 0; pass < 20; ++pass)
+					{
+						for (const auto& line : lines)
+							nMatches[t] += list.Match(line);
+					}
+				});
+		}
+		for (auto& thread : threads)
+			thread.join();
+		for (int n : nMatches)
+			EXPECT_EQ(20 * 400, n);
+	}
+}
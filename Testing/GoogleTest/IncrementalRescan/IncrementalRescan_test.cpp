@@ -0,0 +1,242 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include "IncrementalRescan.h"
+#include <array>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using Lines = std::vector<std::string>;
+	using Ranges = std::vector<std::array<int, 5>>;
+
+	Lines MakeLines(int count)
+	{
+		Lines lines;
+		for (int i = 0; i < count; ++i)
+			lines.push_back("line " + std::to_string(i) + "\n");
+		return lines;
+	}
+
+	std::vector<uint64_t> HashLines(const Lines& lines)
+	{
+		std::vector<uint64_t> hashes;
+		for (const auto& line : lines)
+			hashes.push_back(IncrementalRescan::HashLine(line.data(), line.size()));
+		return hashes;
+	}
+
+	/**
+	 * @brief Diff two line ranges with a longest common subsequence.
+	 * The test lines are unique, so the result doesn't depend on the diff
+	 * algorithm.
+	 */
+	void DiffLines(const Lines& a, int beginA, int endA, const Lines& b, int beginB, int endB, DiffList& diffList)
+	{
+		const int n = endA - beginA, m = endB - beginB;
+		std::vector<std::vector<int>> lcs(n + 1, std::vector<int>(m + 1));
+		for (int i = n - 1; i >= 0; --i)
+			for (int j = m - 1; j >= 0; --j)
+				lcs[i][j] = (a[beginA + i] == b[beginB + j]) ? lcs[i + 1][j + 1] + 1 : (std::max)(lcs[i + 1][j], lcs[i][j + 1]);
+		diffList.Clear();
+		int i = 0, j = 0;
+		while (i < n || j < m)
+		{
+			if (i < n && j < m && a[beginA + i] == b[beginB + j])
+			{
+				++i, ++j;
+				continue;
+			}
+			DIFFRANGE dr;
+			dr.begin[0] = i;
+			dr.begin[1] = j;
+			dr.begin[2] = dr.end[2] = -1;
+			while (i < n || j < m)
+			{
+				if (i < n && j < m && a[beginA + i] == b[beginB + j])
+					break;
+				if (j == m || (i < n && lcs[i + 1][j] >= lcs[i][j + 1]))
+					++i;
+				else
+					++j;
+			}
+			dr.end[0] = i - 1;
+			dr.end[1] = j - 1;
+			dr.op = OP_DIFF;
+			diffList.AddDiff(dr);
+		}
+	}
+
+	Ranges ToRanges(const DiffList& diffList)
+	{
+		Ranges ranges;
+		for (int i = 0; i < diffList.GetSize(); ++i)
+		{
+			const DIFFRANGE *dr = diffList.DiffRangeAt(i);
+			ranges.push_back({ dr->begin[0], dr->end[0], dr->begin[1], dr->end[1], dr->op });
+		}
+		return ranges;
+	}
+
+	Ranges FullDiff(const Lines& a, const Lines& b)
+	{
+		DiffList diffList;
+		DiffLines(a, 0, static_cast<int>(a.size()), b, 0, static_cast<int>(b.size()), diffList);
+		return ToRanges(diffList);
+	}
+
+	class IncrementalRescanTest : public testing::Test
+	{
+	protected:
+		void Store()
+		{
+			DiffList diffList;
+			DiffLines(m_lines[0], 0, static_cast<int>(m_lines[0].size()), m_lines[1], 0, static_cast<int>(m_lines[1].size()), diffList);
+			std::vector<uint64_t> hashes[3] = { HashLines(m_lines[0]), HashLines(m_lines[1]) };
+			m_rescan.Store(2, hashes, diffList);
+		}
+
+		IncrementalRescan::Result Update(Ranges& ranges)
+		{
+			std::vector<uint64_t> hashes[3] = { HashLines(m_lines[0]), HashLines(m_lines[1]) };
+			DiffList diffList;
+			const auto result = m_rescan.Update(hashes,
+				[this](const IncrementalRescan::Window& window, DiffList& windowDiffList)
+				{
+					++m_nWindowDiffs;
+					DiffLines(m_lines[0], window.begin[0], window.end[0], m_lines[1], window.begin[1], window.end[1], windowDiffList);
+					return true;
+				}, diffList);
+			ranges = ToRanges(diffList);
+			return result;
+		}
+
+		IncrementalRescan m_rescan;
+		Lines m_lines[2];
+		int m_nWindowDiffs = 0;
+	};
+}
+
+TEST_F(IncrementalRescanTest, Unchanged)
+{
+	m_lines[0] = MakeLines(300);
+	m_lines[1] = m_lines[0];
+	m_lines[1][100] = "changed\n";
+	Store();
+
+	Ranges ranges;
+	EXPECT_EQ(IncrementalRescan::Result::Unchanged, Update(ranges));
+	EXPECT_EQ(FullDiff(m_lines[0], m_lines[1]), ranges);
+	EXPECT_EQ(0, m_nWindowDiffs);
+}
+
+TEST_F(IncrementalRescanTest, EditBetweenDiffs)
+{
+	m_lines[0] = MakeLines(300);
+	m_lines[1] = m_lines[0];
+	m_lines[1][20] = "changed 20\n";
+	m_lines[1][150] = "changed 150\n";
+	m_lines[1][280] = "changed 280\n";
+	Store();
+
+	m_lines[1][151] = "changed 151\n";
+	m_lines[1].insert(m_lines[1].begin() + 160, "inserted\n");
+	Ranges ranges;
+	EXPECT_EQ(IncrementalRescan::Result::Updated, Update(ranges));
+	EXPECT_EQ(FullDiff(m_lines[0], m_lines[1]), ranges);
+	EXPECT_EQ(4u, ranges.size());
+
+	const auto& window = m_rescan.GetLastWindow();
+	EXPECT_LE(150 - 8, window.begin[1]);
+	EXPECT_GE(160 + 8 + 1, window.end[1]);
+	EXPECT_EQ(window.end[0] - window.begin[0] + 1, window.end[1] - window.begin[1]);
+	EXPECT_FALSE(window.bEndOfFile);
+
+	// Undoing the edits restores the first diff list
+	m_lines[1][151] = m_lines[0][151];
+	m_lines[1].erase(m_lines[1].begin() + 160);
+	EXPECT_EQ(IncrementalRescan::Result::Updated, Update(ranges));
+	EXPECT_EQ(FullDiff(m_lines[0], m_lines[1]), ranges);
+	EXPECT_EQ(3u, ranges.size());
+}
+
+TEST_F(IncrementalRescanTest, EditNearFileBounds)
+{
+	m_lines[0] = MakeLines(300);
+	m_lines[1] = m_lines[0];
+	m_lines[1][100] = "changed\n";
+	Store();
+
+	Ranges ranges;
+	m_lines[0].erase(m_lines[0].begin() + 2);
+	EXPECT_EQ(IncrementalRescan::Result::Updated, Update(ranges));
+	EXPECT_EQ(FullDiff(m_lines[0], m_lines[1]), ranges);
+	EXPECT_EQ(0, m_rescan.GetLastWindow().begin[0]);
+
+	m_lines[1].push_back("appended\n");
+	EXPECT_EQ(IncrementalRescan::Result::Updated, Update(ranges));
+	EXPECT_EQ(FullDiff(m_lines[0], m_lines[1]), ranges);
+	EXPECT_TRUE(m_rescan.GetLastWindow().bEndOfFile);
+	EXPECT_EQ(301, m_rescan.GetLastWindow().end[1]);
+}
+
+TEST_F(IncrementalRescanTest, FullRescan)
+{
+	m_lines[0] = MakeLines(300);
+	m_lines[1] = m_lines[0];
+	Store();
+
+	// Edits far apart leave no anchors for a small window
+	Ranges ranges;
+	m_lines[1][10] = "changed 10\n";
+	m_lines[1][290] = "changed 290\n";
+	EXPECT_EQ(IncrementalRescan::Result::FullRescan, Update(ranges));
+	EXPECT_FALSE(m_rescan.IsValid());
+	EXPECT_EQ(0, m_nWindowDiffs);
+
+	// Nothing stored
+	EXPECT_EQ(IncrementalRescan::Result::FullRescan, Update(ranges));
+
+	// Window compare failed
+	Store();
+	m_lines[1][150] = "changed 150\n";
+	std::vector<uint64_t> hashes[3] = { HashLines(m_lines[0]), HashLines(m_lines[1]) };
+	DiffList diffList;
+	EXPECT_EQ(IncrementalRescan::Result::FullRescan, m_rescan.Update(hashes,
+		[](const IncrementalRescan::Window&, DiffList&) { return false; }, diffList));
+	EXPECT_FALSE(m_rescan.IsValid());
+}
+
+TEST_F(IncrementalRescanTest, EditSequence)
+{
+	m_lines[0] = MakeLines(600);
+	m_lines[1] = m_lines[0];
+	for (int i = 0; i < 600; i += 37)
+		m_lines[1][i] = "changed " + std::to_string(i) + "\n";
+	Store();
+
+	unsigned seed = 12345;
+	auto random = [&seed](int n) { seed = seed * 1103515245 + 12345; return static_cast<int>((seed >> 8) % n); };
+	int nUpdated = 0;
+	for (int edit = 0; edit < 100; ++edit)
+	{
+		Lines& lines = m_lines[random(2)];
+		const int line = random(static_cast<int>(lines.size()));
+		switch (random(3))
+		{
+		case 0: lines[line] = "edit " + std::to_string(edit) + "\n"; break;
+		case 1: lines.insert(lines.begin() + line, "edit " + std::to_string(edit) + "\n"); break;
+		case 2: lines.erase(lines.begin() + line); break;
+		}
+		Ranges ranges;
+		const auto result = Update(ranges);
+		if (result == IncrementalRescan::Result::FullRescan)
+			Store();
+		else
+		{
+			EXPECT_EQ(FullDiff(m_lines[0], m_lines[1]), ranges) << "edit " << edit;
+			++nUpdated;
+		}
+	}
+	EXPECT_LT(90, nUpdated);
+}
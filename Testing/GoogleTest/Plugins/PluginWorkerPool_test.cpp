@@ -0,0 +1,130 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include "PluginWorkerPool.h"
+#include "TFile.h"
+#include "Environment.h"
+#include "paths.h"
+
+namespace
+{
+	TEST(PluginWorkerPool, SplitCommandLine)
+	{
+		using Args = std::vector<String>;
+		EXPECT_EQ(Args(), PluginWorkerPool::SplitCommandLine(_T("  ")));
+		EXPECT_EQ(Args({ _T("a"), _T("b c"), _T("d") }), PluginWorkerPool::SplitCommandLine(_T("a \"b c\"  d")));
+		EXPECT_EQ(Args({ _T("C:\\Program Files\\x.exe"), _T("-q") }), PluginWorkerPool::SplitCommandLine(_T("\"C:\\Program Files\\x.exe\" -q")));
+		EXPECT_EQ(Args({ _T("a\\\\b"), _T("\"c\""), _T("d\\"), _T("") }), PluginWorkerPool::SplitCommandLine(_T("a\\\\b \\\"c\\\" \"d\\\\\" \"\"")));
+	}
+
+#ifndef _WIN32
+	// A filter speaking the framing of PluginWorkerPool in sh. It upper-cases
+	// the content, fails when it contains "fail", exits when it contains
+	// "exit", and sleeps a while when it contains "sleep".
+	const char StubFilter[] =
+		"T=\"${TMPDIR:-/tmp}/_tmp_pluginworker.$$\"\n"
+		"trap 'rm -f \"$T\" \"$T.out\"' EXIT\n"
+		"while IFS= read -r n; do\n"
+		"  dd bs=1 count=\"$n\" of=\"$T\" 2>/dev/null\n"
+		"  if grep -q exit \"$T\"; then exit 0; fi\n"
+		"  if grep -q fail \"$T\"; then printf '1 6\\nfailed'; continue; fi\n"
+		"  if grep -q sleep \"$T\"; then sleep 0.3; fi\n"
+		"  tr a-z A-Z < \"$T\" > \"$T.out\"\n"
+		"  printf '0 %d\\n' $(wc -c < \"$T.out\")\n"
+		"  cat \"$T.out\"\n"
+		"done\n";
+
+	class PluginWorkerPoolTest : public testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			m_stubPath = paths::ConcatPath(env::GetTemporaryPath(), _T("_tmp_pluginworker_stub.sh"));
+			std::ofstream(m_stubPath) << StubFilter;
+		}
+
+		void TearDown() override
+		{
+			TFile(m_stubPath).remove();
+		}
+
+		String StubCommand() const
+		{
+			return _T("/bin/sh \"") + m_stubPath + _T("\"");
+		}
+
+		String m_stubPath;
+	};
+
+	TEST_F(PluginWorkerPoolTest, Call)
+	{
+		PluginWorkerPool pool(StubCommand(), 2);
+		std::string response;
+		String errmsg;
+		EXPECT_TRUE(pool.Call("hello\nworld\n", response, errmsg));
+		EXPECT_EQ("HELLO\nWORLD\n", response);
+		EXPECT_TRUE(pool.Call("", response, errmsg));
+		EXPECT_EQ("", response);
+		// Calls one after the other reuse the same worker
+		EXPECT_TRUE(pool.Call("again", response, errmsg));
+		EXPECT_EQ("AGAIN", response);
+		EXPECT_EQ(1, pool.GetLaunchCount());
+	}
+
+	TEST_F(PluginWorkerPoolTest, Errors)
+	{
+		PluginWorkerPool pool(StubCommand(), 1);
+		std::string response;
+		String errmsg;
+		EXPECT_FALSE(pool.Call("please fail", response, errmsg));
+		EXPECT_EQ(_T("failed"), errmsg);
+		// A failing call keeps the worker
+		EXPECT_TRUE(pool.Call("ok", response, errmsg));
+		EXPECT_EQ(1, pool.GetLaunchCount());
+
+		// A worker which exits is replaced
+		errmsg.clear();
+		EXPECT_FALSE(pool.Call("exit", response, errmsg));
+		EXPECT_FALSE(errmsg.empty());
+		EXPECT_TRUE(pool.Call("ok", response, errmsg));
+		EXPECT_EQ("OK", response);
+		EXPECT_EQ(2, pool.GetLaunchCount());
+
+		PluginWorkerPool missing(_T("/nonexistent/filter"), 1);
+		EXPECT_FALSE(missing.Call("x", response, errmsg));
+	}
+
+	// Calls from several threads run on as many workers at once
+	TEST_F(PluginWorkerPoolTest, Concurrent)
+	{
+		const int WorkerCount = 4;
+		PluginWorkerPool pool(StubCommand(), WorkerCount);
+		const auto start = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		std::vector<std::string> responses(2 * WorkerCount);
+		std::vector<char> results(2 * WorkerCount);
+		for (int i = 0; i < 2 * WorkerCount; ++i)
+		{
+			threads.emplace_back([&, i]()
+				{
+					String errmsg;
+					results[i] = pool.Call("sleep " + std::to_string(i), responses[i], errmsg);
+				});
+		}
+		for (auto& thread : threads)
+			thread.join();
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		for (int i = 0; i < 2 * WorkerCount; ++i)
+		{
+			EXPECT_TRUE(results[i]);
+			EXPECT_EQ("SLEEP " + std::to_string(i), responses[i]);
+		}
+		EXPECT_EQ(WorkerCount, pool.GetLaunchCount());
+		// Two rounds of 0.3 s, not eight
+		EXPECT_LT(elapsed, std::chrono::milliseconds(8 * 300));
+	}
+#endif
+}
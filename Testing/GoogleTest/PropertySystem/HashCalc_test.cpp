@@ -0,0 +1,141 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "cio.h"
+#include "TFile.h"
+#include "Environment.h"
+#include "paths.h"
+#include "HashCalc.h"
+
+namespace
+{
+	const unsigned AllAlgorithms = HashCalc::Flag(HashCalc::MD5) | HashCalc::Flag(HashCalc::SHA1)
+		| HashCalc::Flag(HashCalc::SHA256) | HashCalc::Flag(HashCalc::XXH3);
+
+	std::string ToHex(const std::vector<uint8_t>& hash)
+	{
+		std::string hex;
+		for (uint8_t c : hash)
+		{
+			hex += "0123456789abcdef"[c >> 4];
+			hex += "0123456789abcdef"[c & 0xf];
+		}
+		return hex;
+	}
+
+	std::string ToHex(uint64_t value)
+	{
+		std::vector<uint8_t> bytes;
+		for (int shift = 56; shift >= 0; shift -= 8)
+			bytes.push_back(static_cast<uint8_t>(value >> shift));
+		return ToHex(bytes);
+	}
+
+	HashCalc::Hashes Calculate(const std::string& data, unsigned algorithms)
+	{
+		HashCalc calc(algorithms);
+		calc.Update(data.data(), data.size());
+		HashCalc::Hashes hashes;
+		calc.Finish(hashes);
+		return hashes;
+	}
+
+	std::string MakeData(size_t size)
+	{
+		std::string data(size, '\0');
+		for (size_t i = 0; i < size; ++i)
+			data[i] = static_cast<char>(i * 7 + 3);
+		return data;
+	}
+
+	TEST(HashCalc, KnownDigests)
+	{
+		HashCalc::Hashes hashes = Calculate("abc", AllAlgorithms);
+		EXPECT_EQ("900150983cd24fb0d6963f7d28e17f72", ToHex(hashes[HashCalc::MD5]));
+		EXPECT_EQ("a9993e364706816aba3e25717850c26c9cd0d89d", ToHex(hashes[HashCalc::SHA1]));
+		EXPECT_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", ToHex(hashes[HashCalc::SHA256]));
+		EXPECT_EQ("78af5f94892f3950", ToHex(hashes[HashCalc::XXH3]));
+
+		hashes = Calculate("", AllAlgorithms);
+		EXPECT_EQ("d41d8cd98f00b204e9800998ecf8427e", ToHex(hashes[HashCalc::MD5]));
+		EXPECT_EQ("2d06800538d394c2", ToHex(hashes[HashCalc::XXH3]));
+	}
+
+	TEST(HashCalc, OnlySelectedAlgorithms)
+	{
+		const HashCalc::Hashes hashes = Calculate("abc", HashCalc::Flag(HashCalc::SHA1) | HashCalc::Flag(HashCalc::XXH3));
+		EXPECT_TRUE(hashes[HashCalc::MD5].empty());
+		EXPECT_EQ(20u, hashes[HashCalc::SHA1].size());
+		EXPECT_TRUE(hashes[HashCalc::SHA256].empty());
+		EXPECT_EQ(8u, hashes[HashCalc::XXH3].size());
+	}
+
+	// One digest computed with the others gives its value alone
+	TEST(HashCalc, DigestsDontInterfere)
+	{
+		const std::string data = MakeData(300000);
+		const HashCalc::Hashes all = Calculate(data, AllAlgorithms);
+		for (int i = 0; i < HashCalc::AlgorithmCount; ++i)
+		{
+			const auto algorithm = static_cast<HashCalc::Algorithm>(i);
+			EXPECT_EQ(all[i], Calculate(data, HashCalc::Flag(algorithm))[i]) << i;
+		}
+	}
+
+	// Reference values of xxHash for each of the code paths of XXH3
+	TEST(HashCalc, Xxh3Lengths)
+	{
+		const std::string data = MakeData(100000);
+		const std::pair<size_t, const char *> expected[] =
+		{
+			{ 5, "998620e10e3a4b37" },
+			{ 12, "6829454be0cc3199" },
+			{ 100, "b5937857f0d78c9f" },
+			{ 200, "746cd0025327bf5b" },
+			{ 1000, "6c4f14bd97bd9e82" },
+			{ 5000, "799aaddd7339581d" },
+			{ 100000, "0c056f6fcc340974" },
+		};
+		for (const auto& [len, hex] : expected)
+			EXPECT_EQ(hex, ToHex(Xxh3Hash::Hash(data.data(), len))) << len;
+	}
+
+	// Feeding the data in blocks of any size gives the digest of the whole
+	TEST(HashCalc, Xxh3Blocks)
+	{
+		const std::string data = MakeData(5000);
+		for (size_t len : { 0, 1, 16, 17, 129, 240, 241, 255, 256, 257, 320, 1024, 1025, 2048, 2113, 5000 })
+		{
+			const uint64_t expected = Xxh3Hash::Hash(data.data(), len);
+			for (size_t block : { 1, 7, 63, 64, 65, 256, 257, 1000 })
+			{
+				Xxh3Hash hash;
+				for (size_t pos = 0; pos < len; pos += block)
+					hash.Update(data.data() + pos, (std::min)(block, len - pos));
+				EXPECT_EQ(expected, hash.Finish()) << len << " " << block;
+			}
+		}
+	}
+
+	TEST(HashCalc, HashFile)
+	{
+		const String filename = paths::ConcatPath(env::GetTemporaryPath(), _T("_tmp_hashcalc.bin"));
+		const std::string data = MakeData(3 * 1024 * 1024 + 5);
+		int fd = -1;
+		cio::tsopen_s(&fd, filename, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE);
+		ASSERT_GE(fd, 0);
+		cio::write(fd, data.data(), data.size());
+		cio::close(fd);
+
+		HashCalc::Hashes hashes;
+		EXPECT_TRUE(HashCalc::HashFile(filename, AllAlgorithms, hashes));
+		EXPECT_EQ(Calculate(data, AllAlgorithms), hashes);
+		TFile(filename).remove();
+
+		EXPECT_FALSE(HashCalc::HashFile(filename, AllAlgorithms, hashes));
+		for (const auto& hash : hashes)
+			EXPECT_TRUE(hash.empty());
+	}
+}
@@ -0,0 +1,131 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <vector>
+#include "WordDiffCache.h"
+
+using std::vector;
+
+namespace
+{
+	class WordDiffCacheTest : public testing::Test
+	{
+	protected:
+		WordDiffCacheTest()
+		{
+			strdiff::Init();
+		}
+
+		virtual ~WordDiffCacheTest()
+		{
+			strdiff::Close();
+		}
+
+		/** @brief Make the source of a block of the same lines in both files. */
+		static WordDiffSource MakeSource(const vector<String>& lines1, const vector<String>& lines2, int nLineBegin = 10)
+		{
+			WordDiffSource source;
+			source.nStrings = 2;
+			const vector<String> *lines[2] = { &lines1, &lines2 };
+			for (int i = 0; i < 2; ++i)
+			{
+				source.begin[i] = nLineBegin;
+				source.end[i] = nLineBegin + static_cast<int>(lines[i]->size()) - 1;
+				source.lineCount[i] = nLineBegin + static_cast<int>(lines[i]->size()) + 10;
+				source.offsets[i].push_back(0);
+				for (const auto& line : *lines[i])
+				{
+					source.str[i] += line + _T("\n");
+					source.lineLengths[i].push_back(static_cast<int>(line.length()));
+					source.offsets[i].push_back(static_cast<int>(source.str[i].length()));
+				}
+				source.offsets[i].pop_back();
+			}
+			return source;
+		}
+
+		static void ExpectEqual(const vector<WordDiff>& expected, const vector<WordDiff>& actual)
+		{
+			ASSERT_EQ(expected.size(), actual.size());
+			for (size_t i = 0; i < expected.size(); ++i)
+			{
+				for (int file = 0; file < 2; ++file)
+				{
+					EXPECT_EQ(expected[i].begin[file], actual[i].begin[file]);
+					EXPECT_EQ(expected[i].end[file], actual[i].end[file]);
+					EXPECT_EQ(expected[i].beginline[file], actual[i].beginline[file]);
+					EXPECT_EQ(expected[i].endline[file], actual[i].endline[file]);
+				}
+			}
+		}
+	};
+
+	TEST_F(WordDiffCacheTest, Compute)
+	{
+		WordDiffSource source = MakeSource({ _T("int a = 1;"), _T("int b = 2;") }, { _T("int a = 1;"), _T("int c = 2;") });
+		vector<WordDiff> worddiffs = WordDiffCache::Compute(source, WordDiffOptions());
+		ASSERT_EQ(1u, worddiffs.size());
+		for (int file = 0; file < 2; ++file)
+		{
+			EXPECT_EQ(11, worddiffs[0].beginline[file]);
+			EXPECT_EQ(4, worddiffs[0].begin[file]);
+			EXPECT_EQ(11, worddiffs[0].endline[file]);
+			EXPECT_EQ(5, worddiffs[0].end[file]);
+		}
+	}
+
+	TEST_F(WordDiffCacheTest, PrefetchAndLookup)
+	{
+		WordDiffCache cache;
+		vector<vector<WordDiff>> expected;
+		const int nBlocks = 50;
+		for (int nDiff = 0; nDiff < nBlocks; ++nDiff)
+		{
+			vector<String> lines1, lines2;
+			for (int i = 0; i < 20; ++i)
+			{
+				lines1.push_back(_T("line ") + strutils::to_str(i) + _T(" of block ") + strutils::to_str(nDiff));
+				lines2.push_back(_T("line ") + strutils::to_str(i % 3 == 0 ? i + 1 : i) + _T(" of block ") + strutils::to_str(nDiff));
+			}
+			WordDiffSource source = MakeSource(lines1, lines2, nDiff * 30);
+			expected.push_back(WordDiffCache::Compute(source, WordDiffOptions()));
+			cache.Prefetch(nDiff, std::move(source), WordDiffOptions());
+		}
+		for (int nDiff = 0; nDiff < nBlocks; ++nDiff)
+		{
+			EXPECT_TRUE(cache.Contains(nDiff));
+			vector<WordDiff> worddiffs;
+			ASSERT_TRUE(cache.Lookup(nDiff, worddiffs));
+			ExpectEqual(expected[nDiff], worddiffs);
+		}
+		vector<WordDiff> worddiffs;
+		EXPECT_FALSE(cache.Lookup(nBlocks, worddiffs));
+	}
+
+	TEST_F(WordDiffCacheTest, ClearAndStore)
+	{
+		WordDiffCache cache;
+		for (int nDiff = 0; nDiff < 10; ++nDiff)
+			cache.Prefetch(nDiff, MakeSource({ _T("a b") }, { _T("a c") }), WordDiffOptions());
+		cache.Clear(3);
+		vector<WordDiff> worddiffs;
+		EXPECT_FALSE(cache.Contains(3));
+		EXPECT_FALSE(cache.Lookup(3, worddiffs));
+		EXPECT_TRUE(cache.Lookup(4, worddiffs));
+		EXPECT_EQ(1u, worddiffs.size());
+
+		cache.CancelQueued(5, 7);
+		for (int nDiff = 5; nDiff <= 7; ++nDiff)
+			EXPECT_TRUE(cache.Lookup(nDiff, worddiffs));
+
+		cache.Store(3, vector<WordDiff>(2));
+		EXPECT_TRUE(cache.Lookup(3, worddiffs));
+		EXPECT_EQ(2u, worddiffs.size());
+
+		cache.Clear();
+		for (int nDiff = 0; nDiff < 10; ++nDiff)
+			EXPECT_FALSE(cache.Contains(nDiff));
+		cache.Prefetch(3, MakeSource({ _T("a b") }, { _T("a c") }), WordDiffOptions());
+		EXPECT_TRUE(cache.Lookup(3, worddiffs));
+		EXPECT_EQ(1u, worddiffs.size());
+	}
+}
@@ -315,4 +315,55 @@ namespace
 			EXPECT_EQ(13, pDiff->end[1]);
 		}
 	}
+	// One arena reused for strings of different lengths and options
+	TEST_F(StringDiffsAddsTest, Arena)
+	{
+		const String strs[][2] = {
+			{ _T("abcde fghij klmno"), _T("abcde fgxij klmno pqrst") },
+			{ _T(""), _T("abcde") },
+			{ _T("a\r\nb  c\nd"), _T("a b\r\nc\r\nd") },
+			{ _T("int x = foo(a, b);"), _T("int y = foo(a, c, b);") },
+			{ _T("abcde"), _T("abcde") },
+		};
+		strdiff::WordDiffArena arena;
+		std::vector<strdiff::wdiff> diffs;
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			for (const auto& str : strs)
+			{
+				for (auto eol_mode : { strdiff::EOL_STRICT, strdiff::EOL_AS_SPACE })
+				{
+					for (bool byte_level : { false, true })
+					{
+						std::vector<strdiff::wdiff> expected = strdiff::ComputeWordDiffs(str[0], str[1], true, eol_mode, 1, false, 1, byte_level);
+						strdiff::ComputeWordDiffs(str[0], str[1], true, eol_mode, 1, false, 1, byte_level, arena, diffs);
+						ASSERT_EQ(expected.size(), diffs.size());
+						for (size_t i = 0; i < diffs.size(); ++i)
+						{
+							EXPECT_EQ(expected[i].begin, diffs[i].begin);
+							EXPECT_EQ(expected[i].end, diffs[i].end);
+						}
+					}
+				}
+			}
+		}
+
+		// Same spaces, the EOLs compare as spaces
+		strdiff::ComputeWordDiffs(_T("a\r\nb"), _T("a b"), true, strdiff::EOL_AS_SPACE, 0, false, 0, false, arena, diffs);
+		EXPECT_EQ(0, diffs.size());
+		strdiff::ComputeWordDiffs(_T("a\r\n\nb"), _T("a b"), true, strdiff::EOL_AS_SPACE, 0, false, 0, false, arena, diffs);
+		EXPECT_EQ(1, diffs.size());
+
+		// 3-way
+		const String strs3[3] = { _T("abc def ghi"), _T("abc deg ghi"), _T("abc def ghj") };
+		std::vector<strdiff::wdiff> expected = strdiff::ComputeWordDiffs(3, strs3, true, strdiff::EOL_STRICT, 0, false, 0, false);
+		strdiff::ComputeWordDiffs(3, strs3, true, strdiff::EOL_STRICT, 0, false, 0, false, arena, diffs);
+		ASSERT_EQ(2, expected.size());
+		ASSERT_EQ(expected.size(), diffs.size());
+		for (size_t i = 0; i < diffs.size(); ++i)
+		{
+			EXPECT_EQ(expected[i].begin, diffs[i].begin);
+			EXPECT_EQ(expected[i].end, diffs[i].end);
+		}
+	}
 }  // namespace
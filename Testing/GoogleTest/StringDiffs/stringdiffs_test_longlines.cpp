@@ -0,0 +1,130 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <vector>
+#include "stringdiffs.h"
+
+using std::vector;
+
+namespace
+{
+	// The fixture for testing stringdiff with lines of more words than
+	// the O(NP) diff handles, e.g. minified JavaScript or JSON.
+	class StringDiffsTestLongLines : public testing::Test
+	{
+	protected:
+		StringDiffsTestLongLines()
+		{
+			strdiff::Init();
+			strdiff::SetBreakChars(_T(",:{}[]\"")); // minified JSON
+		}
+
+		virtual ~StringDiffsTestLongLines()
+		{
+			strdiff::Close();
+		}
+
+		/** @brief Minified JSON like line of @p nItems items, 15 words each. */
+		static String MakeLongLine(int nItems)
+		{
+			String line = _T("[");
+			for (int i = 0; i < nItems; ++i)
+				line += _T("{\"id\":") + strutils::to_str(i) + _T(",\"name\":\"item") + strutils::to_str(i) + _T("\"},");
+			line += _T("]");
+			return line;
+		}
+
+		/** @brief Check the text between the diffs is the same on both sides. */
+		static void ExpectSameBetweenDiffs(const String& str1, const String& str2, const vector<strdiff::wdiff>& diffs)
+		{
+			int pos1 = 0, pos2 = 0;
+			for (const auto& diff : diffs)
+			{
+				EXPECT_EQ(str1.substr(pos1, diff.begin[0] - pos1), str2.substr(pos2, diff.begin[1] - pos2));
+				pos1 = diff.end[0] + 1;
+				pos2 = diff.end[1] + 1;
+			}
+			EXPECT_EQ(str1.substr(pos1), str2.substr(pos2));
+		}
+	};
+
+	// Two words changed in a line of 75000 words
+	TEST_F(StringDiffsTestLongLines, WordsChanged)
+	{
+		const String str1 = MakeLongLine(5000);
+		String str2 = str1;
+		const size_t pos1 = str2.find(_T("item1234\""));
+		str2.replace(pos1, 8, _T("ITEM1234"));
+		const size_t pos2 = str2.find(_T("item4321\""));
+		str2.replace(pos2, 8, _T("ITEM4321"));
+		vector<strdiff::wdiff> diffs = strdiff::ComputeWordDiffs(str1, str2, true, strdiff::EOL_STRICT, 0, false, 1, false);
+		ASSERT_EQ(2, diffs.size());
+		EXPECT_EQ(static_cast<int>(pos1), diffs[0].begin[0]);
+		EXPECT_EQ(static_cast<int>(pos1) + 7, diffs[0].end[0]);
+		EXPECT_EQ(static_cast<int>(pos1), diffs[0].begin[1]);
+		EXPECT_EQ(static_cast<int>(pos1) + 7, diffs[0].end[1]);
+		EXPECT_EQ(static_cast<int>(pos2), diffs[1].begin[0]);
+		EXPECT_EQ(static_cast<int>(pos2) + 7, diffs[1].end[0]);
+
+		// Case insensitive, no differences
+		diffs = strdiff::ComputeWordDiffs(str1, str2, false, strdiff::EOL_STRICT, 0, false, 1, false);
+		EXPECT_EQ(0, diffs.size());
+	}
+
+	// Words inserted into and deleted from a line of 75000 words
+	TEST_F(StringDiffsTestLongLines, WordsInsertedAndDeleted)
+	{
+		const String str1 = MakeLongLine(5000);
+		String str2 = str1;
+		const String inserted = _T("{\"id\":-1},");
+		const size_t posInserted = str2.find(_T("{\"id\":2000,"));
+		str2.insert(posInserted, inserted);
+		const String deleted = _T("{\"id\":3000,\"name\":\"item3000\"},");
+		const size_t posDeleted = str1.find(deleted);
+		str2.erase(str2.find(deleted), deleted.length());
+		vector<strdiff::wdiff> diffs = strdiff::ComputeWordDiffs(str1, str2, true, strdiff::EOL_STRICT, 0, false, 1, false);
+		ASSERT_EQ(2, diffs.size());
+		// Inserted, the words may be aligned anywhere among the same words around
+		EXPECT_EQ(diffs[0].begin[0], diffs[0].end[0] + 1);
+		EXPECT_EQ(inserted.length(), static_cast<size_t>(diffs[0].end[1] - diffs[0].begin[1] + 1));
+		EXPECT_LE(static_cast<int>(posInserted) - 10, diffs[0].begin[1]);
+		EXPECT_GE(static_cast<int>(posInserted) + 10, diffs[0].begin[1]);
+		// Deleted
+		EXPECT_EQ(diffs[1].begin[1], diffs[1].end[1] + 1);
+		EXPECT_EQ(deleted.length(), static_cast<size_t>(diffs[1].end[0] - diffs[1].begin[0] + 1));
+		EXPECT_LE(static_cast<int>(posDeleted) - 10, diffs[1].begin[0]);
+		EXPECT_GE(static_cast<int>(posDeleted) + 10, diffs[1].begin[0]);
+		ExpectSameBetweenDiffs(str1, str2, diffs);
+	}
+
+	// Unrelated long lines still get a diff, every difference is covered
+	TEST_F(StringDiffsTestLongLines, Unrelated)
+	{
+		String str1, str2;
+		unsigned seed = 1;
+		for (int i = 0; i < 30000; ++i)
+		{
+			seed = seed * 1103515245 + 12345;
+			str1 += strutils::to_str(static_cast<int>((seed >> 8) % 50)) + _T(",");
+			seed = seed * 1103515245 + 12345;
+			str2 += strutils::to_str(static_cast<int>((seed >> 8) % 50)) + _T(",");
+		}
+		vector<strdiff::wdiff> diffs = strdiff::ComputeWordDiffs(str1, str2, true, strdiff::EOL_STRICT, 0, false, 1, false);
+		ASSERT_FALSE(diffs.empty());
+		ExpectSameBetweenDiffs(str1, str2, diffs);
+	}
+
+	// Byte level diff of a long line
+	TEST_F(StringDiffsTestLongLines, ByteLevel)
+	{
+		const String str1 = MakeLongLine(5000);
+		String str2 = str1;
+		const size_t pos = str2.find(_T("item2500\""));
+		str2[pos + 5] = '9';
+		vector<strdiff::wdiff> diffs = strdiff::ComputeWordDiffs(str1, str2, true, strdiff::EOL_STRICT, 0, false, 1, true);
+		ASSERT_EQ(1, diffs.size());
+		EXPECT_EQ(static_cast<int>(pos) + 5, diffs[0].begin[0]);
+		EXPECT_EQ(static_cast<int>(pos) + 5, diffs[0].end[0]);
+		EXPECT_EQ(static_cast<int>(pos) + 5, diffs[0].begin[1]);
+		EXPECT_EQ(static_cast<int>(pos) + 5, diffs[0].end[1]);
+	}
+}
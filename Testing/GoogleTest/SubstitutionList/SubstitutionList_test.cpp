@@ -59,6 +59,26 @@ namespace
 		EXPECT_EQ(0, list.GetCount());
 	}
 
+	// Text none of the patterns matches, or only a replacement matches
+	TEST_F(SubstitutionListTest, NoMatch)
+	{
+		SubstitutionList list;
+		list.Add("foo", "bar", true, false);
+		list.Add("bar", "baz", true, true);
+		list.Add("^x+$", "y", Poco::RegularExpression::RE_MULTILINE | Poco::RegularExpression::RE_NEWLINE_ANYCRLF);
+		EXPECT_EQ("abc\nxy\n", list.Subst("abc\nxy\n"));
+		EXPECT_EQ("baz", list.Subst("foo"));
+		EXPECT_EQ("Foo", list.Subst("Foo"));
+		EXPECT_EQ("a\ny\n", list.Subst("a\nxxx\n"));
+		EXPECT_EQ("barbar", list.Subst("barbar"));
+		EXPECT_EQ("baz baz", list.Subst("bar bar"));
+		list.RemoveAllFilters();
+		list.Add("a", "b", false, false);
+		list.Add("c", "d", false, false);
+		EXPECT_EQ("bd", list.Subst("AC"));
+		EXPECT_EQ("xyz", list.Subst("xyz"));
+	}
+
 
 
 }  // namespace
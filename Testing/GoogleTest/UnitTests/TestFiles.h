@@ -0,0 +1,28 @@
+/**
+ * @file  TestFiles.h
+ *
+ * @brief Helpers for the tests which write files of their own.
+ */
+#pragma once
+
+#include <gtest/gtest.h>
+#include <string>
+#include "cio.h"
+#include "Environment.h"
+#include "paths.h"
+
+/** @brief Path of @p name in the temporary folder. */
+inline String TempFileName(const String& name)
+{
+	return paths::ConcatPath(env::GetTemporaryPath(), name);
+}
+
+/** @brief Create or overwrite @p filename with @p data. */
+inline void WriteFile(const String& filename, const std::string& data)
+{
+	int fd = -1;
+	cio::tsopen_s(&fd, filename, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE);
+	ASSERT_GE(fd, 0);
+	cio::write(fd, data.data(), data.size());
+	cio::close(fd);
+}
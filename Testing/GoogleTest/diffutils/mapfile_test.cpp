@@ -0,0 +1,182 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "cio.h"
+#include "TFile.h"
+#include "TestFiles.h"
+#include "diff.h"
+#include "CompareOptions.h"
+
+namespace
+{
+	std::string ReadFile(const String& filename)
+	{
+		std::string data;
+		int fd = -1;
+		cio::tsopen_s(&fd, filename, O_RDONLY | O_BINARY, _SH_DENYNO, _S_IREAD);
+		char buf[65536];
+		for (int n; (n = static_cast<int>(cio::read(fd, buf, sizeof(buf)))) > 0; )
+			data.append(buf, n);
+		cio::close(fd);
+		return data;
+	}
+
+	/** @brief Lines of about 1.5 MB, with @p eol, every 100th line changed if @p edited. */
+	std::string MakeText(const char *eol, bool edited)
+	{
+		std::string text;
+		for (int i = 0; text.size() < 1536 * 1024; ++i)
+		{
+			text += "line " + std::to_string(i) + ((edited && i % 100 == 50) ? " changed" : " of the text");
+			text += eol;
+		}
+		return text;
+	}
+
+	/** @brief Result of a compare which must not depend on how the files were read. */
+	struct Result
+	{
+		std::vector<int> changes; /**< line0, line1, deleted, inserted of each change */
+		int counts[2][4]; /**< count_crlfs, count_crs, count_lfs, count_zeros */
+		int missing_newline[2];
+		bool mapped[2];
+	};
+
+	/**
+	 * @brief Compare two files with diffutils, like DiffFileData does.
+	 * If @p preload, the files are read from memory, which is never mapped.
+	 */
+	Result DiffFiles(const String& path0, const String& path1, bool preload)
+	{
+		Result result{};
+		file_data inf[2] = {};
+		const String paths[2] = { path0, path1 };
+		std::string content[2];
+		for (int i = 0; i < 2; ++i)
+		{
+			inf[i].name = "";
+			cio::tsopen_s(&inf[i].desc, paths[i], O_RDONLY | O_BINARY, _SH_DENYNO, _S_IREAD);
+			cio::fstat(inf[i].desc, &inf[i].stat);
+			if (preload)
+			{
+				content[i] = ReadFile(paths[i]);
+				inf[i].preloaded = content[i].data();
+				inf[i].preloaded_size = content[i].size();
+			}
+		}
+		int bin_status = 0, bin_file = 0;
+		change *script = diff_2_files(inf, 0, &bin_status, false, &bin_file);
+		for (change *e = script, *p = nullptr; e != nullptr; e = p)
+		{
+			result.changes.insert(result.changes.end(), { e->line0, e->line1, e->deleted, e->inserted });
+			p = e->link;
+			free(e);
+		}
+		for (int i = 0; i < 2; ++i)
+		{
+			result.counts[i][0] = inf[i].count_crlfs;
+			result.counts[i][1] = inf[i].count_crs;
+			result.counts[i][2] = inf[i].count_lfs;
+			result.counts[i][3] = inf[i].count_zeros;
+			result.missing_newline[i] = inf[i].missing_newline;
+			result.mapped[i] = inf[i].mapped_size != 0;
+		}
+		cleanup_file_buffers(inf);
+		for (int i = 0; i < 2; ++i)
+			cio::close(inf[i].desc);
+		return result;
+	}
+
+	TEST(diffutils, map_file)
+	{
+		const String filename = TempFileName(_T("_tmp_mapfile.txt"));
+		const std::string data(3 * 4096 - 10, 'a');
+		WriteFile(filename, data);
+		int fd = -1;
+		cio::tsopen_s(&fd, filename, O_RDONLY | O_BINARY, _SH_DENYNO, _S_IREAD);
+		size_t mapped_size = 0;
+		char *p = map_file(fd, data.size(), 5, &mapped_size);
+		ASSERT_NE(nullptr, p);
+		EXPECT_LE(data.size() + 5, mapped_size);
+		EXPECT_EQ(data, std::string(p, data.size()));
+		EXPECT_EQ(std::string(5, '\0'), std::string(p + data.size(), 5));
+		// Changes stay in the mapping
+		p[0] = 'b';
+		p[data.size()] = '\n';
+		unmap_file(p, mapped_size);
+		// Too little room after the text, or a size which isn't the file size
+		EXPECT_EQ(nullptr, map_file(fd, data.size(), mapped_size - data.size() + 1, &mapped_size));
+		EXPECT_EQ(nullptr, map_file(fd, data.size() - 1, 5, &mapped_size));
+		cio::close(fd);
+		EXPECT_EQ(data, ReadFile(filename));
+		TFile(filename).remove();
+	}
+
+#ifndef _WIN32
+	// A file truncated while it is mapped reads as newlines past its new end
+	TEST(diffutils, map_file_truncated)
+	{
+		const String filename = TempFileName(_T("_tmp_mapfile_truncated.txt"));
+		const std::string data(3 * 4096 - 10, 'a');
+		WriteFile(filename, data);
+		int fd = -1;
+		cio::tsopen_s(&fd, filename, O_RDONLY | O_BINARY, _SH_DENYNO, _S_IREAD);
+		size_t mapped_size = 0;
+		char *p = map_file(fd, data.size(), 5, &mapped_size);
+		ASSERT_NE(nullptr, p);
+		// Dropped by the truncation, like the sentinels of diffutils
+		p[data.size()] = '\n';
+		WriteFile(filename, data.substr(0, 100));
+		EXPECT_EQ(data.substr(0, 100), std::string(p, 100));
+		EXPECT_EQ(std::string(mapped_size - 4096, '\n'), std::string(p + 4096, mapped_size - 4096));
+		unmap_file(p, mapped_size);
+		cio::close(fd);
+		TFile(filename).remove();
+	}
+#endif
+
+	// Mapped files give the same result as files read into memory
+	TEST(diffutils, read_files_mapped)
+	{
+		const String filename0 = TempFileName(_T("_tmp_mapfile0.txt"));
+		const String filename1 = TempFileName(_T("_tmp_mapfile1.txt"));
+		struct
+		{
+			std::string text0, text1;
+			bool ignoreEOLDifference;
+		} tests[] = {
+			{ MakeText("\n", false), MakeText("\n", true), false },
+			{ MakeText("\r\n", false), MakeText("\r\n", true), false },
+			{ MakeText("\r\n", false), MakeText("\n", true), true },
+			{ MakeText("\r", false), MakeText("\r\n", true), true },
+			{ MakeText("\n", false) + "no newline", MakeText("\n", true) + "no newline", false },
+			{ "\xEF\xBB\xBF" + MakeText("\n", false), MakeText("\n", true), false },
+		};
+		for (const auto& test : tests)
+		{
+			DiffutilsOptions options;
+			options.m_bIgnoreEOLDifference = test.ignoreEOLDifference;
+			options.SetToDiffUtils();
+			WriteFile(filename0, test.text0);
+			WriteFile(filename1, test.text1);
+			const Result mapped = DiffFiles(filename0, filename1, false);
+			const Result read = DiffFiles(filename0, filename1, true);
+			EXPECT_TRUE(mapped.mapped[0] && mapped.mapped[1]);
+			EXPECT_FALSE(read.mapped[0] || read.mapped[1]);
+			EXPECT_FALSE(mapped.changes.empty());
+			EXPECT_EQ(read.changes, mapped.changes);
+			for (int i = 0; i < 2; ++i)
+			{
+				EXPECT_EQ(read.missing_newline[i], mapped.missing_newline[i]);
+				for (int j = 0; j < 4; ++j)
+					EXPECT_EQ(read.counts[i][j], mapped.counts[i][j]);
+			}
+			// The files are never written
+			EXPECT_EQ(test.text0, ReadFile(filename0));
+			EXPECT_EQ(test.text1, ReadFile(filename1));
+		}
+		TFile(filename0).remove();
+		TFile(filename1).remove();
+	}
+}